@@ -0,0 +1,163 @@
+///////////////////////////////////////////////////////////////////////////////
+// benchmarkmain.cpp
+// ============
+// run the microbenchmarks of the scene hot paths against the mock OpenGL
+// and write their results as JSON
+///////////////////////////////////////////////////////////////////////////////
+
+#include <iostream>         // error handling and output
+#include <cstdlib>          // EXIT_FAILURE
+#include <cstring>          // command line parsing
+#include <cstdio>
+
+#include "BenchmarkRunner.h"
+#include "HotPathBenchmarks.h"
+#include "MockGL.h"
+
+// Namespace for declaring global variables
+namespace
+{
+	// command line options for the benchmark run
+	const char* g_OutputFilename = "benchmark_results.json";
+	const char* g_Label = "";
+	const char* g_Filter = nullptr;
+	const char* g_BaselineFilename = nullptr;
+	double g_ThresholdPercent = 10.0;
+	double g_MinimumBatchMilliseconds = 20.0;
+	int g_Batches = 15;
+	bool g_bReportCalls = false;
+}
+
+bool ParseCommandLine(int argc, char* argv[]);
+
+/***********************************************************
+ *  main(int, char*)
+ *
+ *  This function gets called after the application has been
+ *  launched.
+ ***********************************************************/
+int main(int argc, char* argv[])
+{
+	if (ParseCommandLine(argc, argv) == false)
+	{
+		return(EXIT_FAILURE);
+	}
+
+	BenchmarkRunner runner(g_Filter, g_MinimumBatchMilliseconds, g_Batches);
+	printf("Scene hot path benchmarks:\n");
+	HotPathBenchmarks::Run(runner);
+
+	if (runner.GetResults().empty())
+	{
+		std::cerr << "No benchmark matches the filter " << g_Filter << std::endl;
+		return(EXIT_FAILURE);
+	}
+
+	if (g_bReportCalls == true)
+	{
+		MockGL::ReportCalls();
+	}
+
+	int exitCode = EXIT_SUCCESS;
+	if (runner.WriteJson(g_OutputFilename, g_Label) == true)
+	{
+		printf("Wrote the results to %s\n", g_OutputFilename);
+	}
+	else
+	{
+		exitCode = EXIT_FAILURE;
+	}
+
+	// a comparison fails the run when a benchmark became slower,
+	// so that it can gate a change on a build machine
+	if (NULL != g_BaselineFilename)
+	{
+		int regressions = runner.Compare(g_BaselineFilename, g_ThresholdPercent);
+		if (regressions < 0)
+		{
+			exitCode = EXIT_FAILURE;
+		}
+		else if (regressions > 0)
+		{
+			printf("%d benchmarks became more than %.1f%% slower\n", regressions, g_ThresholdPercent);
+			exitCode = EXIT_FAILURE;
+		}
+	}
+
+	return(exitCode);
+}
+
+/***********************************************************
+ *	ParseCommandLine()
+ *
+ *  This function is used to read the options passed on the
+ *  command line.
+ *
+ *    --output <file>       JSON file for the results, by default
+ *                          benchmark_results.json
+ *    --label <text>        label stored with the results, such as
+ *                          the commit they were measured at
+ *    --filter <text>       run only the benchmarks whose name
+ *                          contains the text
+ *    --compare <file>      compare the results with an earlier
+ *                          JSON file and fail when one is slower
+ *    --threshold <pct>     slowdown allowed by the comparison,
+ *                          10 percent by default
+ *    --min-batch-ms <ms>   shortest time of one timed batch
+ *    --batches <n>         timed batches of each benchmark
+ *    --gl-calls            print the OpenGL calls recorded by the
+ *                          mock over the whole run
+ ***********************************************************/
+bool ParseCommandLine(int argc, char* argv[])
+{
+	for (int i = 1; i < argc; i++)
+	{
+		bool bHasValue = (i + 1 < argc);
+
+		if ((strcmp(argv[i], "--output") == 0) && bHasValue)
+		{
+			g_OutputFilename = argv[++i];
+		}
+		else if ((strcmp(argv[i], "--label") == 0) && bHasValue)
+		{
+			g_Label = argv[++i];
+		}
+		else if ((strcmp(argv[i], "--filter") == 0) && bHasValue)
+		{
+			g_Filter = argv[++i];
+		}
+		else if ((strcmp(argv[i], "--compare") == 0) && bHasValue)
+		{
+			g_BaselineFilename = argv[++i];
+		}
+		else if ((strcmp(argv[i], "--threshold") == 0) && bHasValue)
+		{
+			g_ThresholdPercent = atof(argv[++i]);
+		}
+		else if ((strcmp(argv[i], "--min-batch-ms") == 0) && bHasValue)
+		{
+			g_MinimumBatchMilliseconds = atof(argv[++i]);
+		}
+		else if ((strcmp(argv[i], "--batches") == 0) && bHasValue)
+		{
+			g_Batches = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--gl-calls") == 0)
+		{
+			g_bReportCalls = true;
+		}
+		else
+		{
+			std::cerr << "Unknown or incomplete option: " << argv[i] << std::endl;
+			return(false);
+		}
+	}
+
+	if ((g_MinimumBatchMilliseconds <= 0.0) || (g_Batches <= 0))
+	{
+		std::cerr << "The batch time and the number of batches must be positive" << std::endl;
+		return(false);
+	}
+
+	return(true);
+}
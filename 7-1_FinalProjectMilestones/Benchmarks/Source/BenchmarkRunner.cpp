@@ -0,0 +1,283 @@
+///////////////////////////////////////////////////////////////////////////////
+// benchmarkrunner.cpp
+// ============
+// time small pieces of code in isolation and write the results as JSON
+// that can be compared with the results of another build
+///////////////////////////////////////////////////////////////////////////////
+
+#include "BenchmarkRunner.h"
+
+#include "MockGL.h"
+#include "AllocationCounter.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(_MSC_VER)
+#define BENCHMARK_NOINLINE __declspec(noinline)
+#else
+#define BENCHMARK_NOINLINE __attribute__((noinline))
+#endif
+
+// declaration of global variables
+namespace
+{
+	// the batch size stops doubling here, for benchmarks that
+	// the compiler managed to reduce to nothing
+	const long long g_MaxOperationsPerBatch = 1LL << 32;
+
+	// address of the most recent result kept by a benchmark
+	const void* volatile g_pLastResult = NULL;
+
+	double ElapsedNanoseconds(std::chrono::steady_clock::time_point start)
+	{
+		std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+		return(elapsed.count());
+	}
+
+	// read the median time of a benchmark from one line of the
+	// JSON written by WriteJson(), returning false for the lines
+	// that hold no benchmark
+	bool ParseResultLine(const char* line, std::string& name, double& medianNanoseconds)
+	{
+		const char* pName = strstr(line, "\"name\": \"");
+		const char* pMedian = strstr(line, "\"median_ns\": ");
+		if ((NULL == pName) || (NULL == pMedian))
+		{
+			return(false);
+		}
+		pName += strlen("\"name\": \"");
+		const char* pNameEnd = strchr(pName, '"');
+		if (NULL == pNameEnd)
+		{
+			return(false);
+		}
+		name.assign(pName, pNameEnd - pName);
+		medianNanoseconds = strtod(pMedian + strlen("\"median_ns\": "), NULL);
+		return(true);
+	}
+}
+
+/***********************************************************
+ *  BenchmarkRunner()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+BenchmarkRunner::BenchmarkRunner(const char* filter, double minimumBatchMilliseconds, int batches)
+{
+	if (NULL != filter)
+	{
+		m_filter = filter;
+	}
+	m_minimumBatchMilliseconds = minimumBatchMilliseconds;
+	m_batches = std::max(batches, 1);
+}
+
+/***********************************************************
+ *  ~BenchmarkRunner()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+BenchmarkRunner::~BenchmarkRunner()
+{
+}
+
+/***********************************************************
+ *  UseResult()
+ *
+ *  This method is used for publishing the address of a
+ *  benchmark result.  It is never inlined, so the compiler
+ *  has to assume that the result is read.
+ ***********************************************************/
+BENCHMARK_NOINLINE void BenchmarkRunner::UseResult(const void* pValue)
+{
+	g_pLastResult = pValue;
+}
+
+/***********************************************************
+ *  Run()
+ *
+ *  This method is used for timing the benchmark.  The first
+ *  batches, while the batch size is found, also warm up the
+ *  caches and the lazily created state of the code.
+ ***********************************************************/
+void BenchmarkRunner::Run(const char* name, const BENCHMARK_FUNCTION& function)
+{
+	if ((m_filter.empty() == false) && (strstr(name, m_filter.c_str()) == NULL))
+	{
+		return;
+	}
+
+	// double the batch until it takes long enough to time
+	long long operations = 1;
+	while (operations < g_MaxOperationsPerBatch)
+	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		function(operations);
+		if (ElapsedNanoseconds(start) >= m_minimumBatchMilliseconds * 1.0e6)
+		{
+			break;
+		}
+		operations *= 2;
+	}
+
+	long long callsBefore = MockGL::GetTotalCalls();
+	long long allocationsBefore = AllocationCounter::GetThreadAllocations();
+
+	std::vector<double> batchNanoseconds(m_batches);
+	for (int batch = 0; batch < m_batches; batch++)
+	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		function(operations);
+		batchNanoseconds[batch] = ElapsedNanoseconds(start) / operations;
+	}
+
+	long long calls = MockGL::GetTotalCalls() - callsBefore;
+	long long allocations = AllocationCounter::GetThreadAllocations() - allocationsBefore;
+	double totalOperations = (double)operations * m_batches;
+	std::sort(batchNanoseconds.begin(), batchNanoseconds.end());
+
+	RESULT result;
+	result.name = name;
+	result.operationsPerBatch = operations;
+	result.batches = m_batches;
+	result.medianNanoseconds = batchNanoseconds[m_batches / 2];
+	result.minNanoseconds = batchNanoseconds.front();
+	result.maxNanoseconds = batchNanoseconds.back();
+	result.glCallsPerOperation = calls / totalOperations;
+	result.allocationsPerOperation = allocations / totalOperations;
+	m_results.push_back(result);
+
+	printf("  %-40s %12.1f ns/op (%.1f to %.1f), %.1f GL calls/op",
+		name,
+		result.medianNanoseconds,
+		result.minNanoseconds,
+		result.maxNanoseconds,
+		result.glCallsPerOperation);
+	if (AllocationCounter::IsEnabled() == true)
+	{
+		printf(", %.2f allocations/op", result.allocationsPerOperation);
+	}
+	printf("\n");
+}
+
+/***********************************************************
+ *  WriteJson()
+ *
+ *  This method is used for writing the results to a JSON
+ *  file.  Every benchmark is written on a line of its own,
+ *  which keeps the files easy to diff and to read back.
+ ***********************************************************/
+bool BenchmarkRunner::WriteJson(const char* filename, const char* label) const
+{
+	FILE* pFile = fopen(filename, "w");
+	if (NULL == pFile)
+	{
+		printf("Could not write the benchmark results to %s\n", filename);
+		return(false);
+	}
+
+#if defined(_DEBUG)
+	const char* configuration = "Debug";
+#else
+	const char* configuration = "Release";
+#endif
+
+	fprintf(pFile, "{\n");
+	fprintf(pFile, "  \"suite\": \"scene hot paths\",\n");
+	fprintf(pFile, "  \"label\": \"%s\",\n", (NULL != label) ? label : "");
+	fprintf(pFile, "  \"configuration\": \"%s\",\n", configuration);
+	fprintf(pFile, "  \"min_batch_ms\": %.3f,\n", m_minimumBatchMilliseconds);
+	fprintf(pFile, "  \"benchmarks\": [\n");
+	for (size_t i = 0; i < m_results.size(); i++)
+	{
+		const RESULT& result = m_results[i];
+		fprintf(pFile,
+			"    {\"name\": \"%s\", \"median_ns\": %.3f, \"min_ns\": %.3f, \"max_ns\": %.3f, "
+			"\"operations_per_batch\": %lld, \"batches\": %d, "
+			"\"gl_calls_per_op\": %.3f, \"allocations_per_op\": %.3f}%s\n",
+			result.name.c_str(),
+			result.medianNanoseconds,
+			result.minNanoseconds,
+			result.maxNanoseconds,
+			result.operationsPerBatch,
+			result.batches,
+			result.glCallsPerOperation,
+			result.allocationsPerOperation,
+			(i + 1 < m_results.size()) ? "," : "");
+	}
+	fprintf(pFile, "  ]\n");
+	fprintf(pFile, "}\n");
+
+	bool bWritten = (ferror(pFile) == 0);
+	fclose(pFile);
+	return(bWritten);
+}
+
+/***********************************************************
+ *  Compare()
+ *
+ *  This method is used for printing the change of each
+ *  benchmark against an earlier run.  The medians are
+ *  compared, since they are the least disturbed by the
+ *  occasional slow batch.
+ ***********************************************************/
+int BenchmarkRunner::Compare(const char* filename, double thresholdPercent) const
+{
+	FILE* pFile = fopen(filename, "r");
+	if (NULL == pFile)
+	{
+		printf("Could not read the baseline results from %s\n", filename);
+		return(-1);
+	}
+
+	std::vector<std::string> baselineNames;
+	std::vector<double> baselineMedians;
+	char line[1024];
+	while (fgets(line, sizeof(line), pFile) != NULL)
+	{
+		std::string name;
+		double median = 0.0;
+		if (ParseResultLine(line, name, median) == true)
+		{
+			baselineNames.push_back(name);
+			baselineMedians.push_back(median);
+		}
+	}
+	fclose(pFile);
+
+	printf("Compared with %s:\n", filename);
+	int regressions = 0;
+	for (size_t i = 0; i < m_results.size(); i++)
+	{
+		const RESULT& result = m_results[i];
+		std::vector<std::string>::const_iterator found =
+			std::find(baselineNames.begin(), baselineNames.end(), result.name);
+		if (found == baselineNames.end())
+		{
+			printf("  %-40s %12.1f ns/op, not in the baseline\n",
+				result.name.c_str(),
+				result.medianNanoseconds);
+			continue;
+		}
+
+		double baseline = baselineMedians[found - baselineNames.begin()];
+		double changePercent = (baseline > 0.0) ?
+			(result.medianNanoseconds / baseline - 1.0) * 100.0 : 0.0;
+		bool bRegressed = (changePercent > thresholdPercent);
+		if (bRegressed == true)
+		{
+			regressions++;
+		}
+		printf("  %-40s %12.1f -> %12.1f ns/op %+7.1f%%%s\n",
+			result.name.c_str(),
+			baseline,
+			result.medianNanoseconds,
+			changePercent,
+			bRegressed ? "  SLOWER" : "");
+	}
+	return(regressions);
+}
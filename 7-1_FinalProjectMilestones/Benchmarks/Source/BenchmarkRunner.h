@@ -0,0 +1,79 @@
+///////////////////////////////////////////////////////////////////////////////
+// benchmarkrunner.h
+// ============
+// time small pieces of code in isolation and write the results as JSON
+// that can be compared with the results of another build
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  BenchmarkRunner
+ *
+ *  This class times each benchmark in batches of operations.
+ *  The batch size is doubled until one batch takes at least
+ *  the minimum time, so that the clock resolution does not
+ *  matter, and the batch is then repeated to report the
+ *  median, fastest and slowest time of one operation.  The
+ *  OpenGL calls recorded by the mock and the heap allocations
+ *  counted in debug builds are reported per operation as
+ *  well, since a change in either is a change in the work.
+ ***********************************************************/
+class BenchmarkRunner
+{
+public:
+	// function performing the passed in number of operations
+	typedef std::function<void(long long operations)> BENCHMARK_FUNCTION;
+
+	struct RESULT
+	{
+		std::string name;
+		long long operationsPerBatch;
+		int batches;
+		// time of one operation in nanoseconds
+		double medianNanoseconds;
+		double minNanoseconds;
+		double maxNanoseconds;
+		double glCallsPerOperation;
+		// zero unless the allocations are counted
+		double allocationsPerOperation;
+	};
+
+	// constructor - only the benchmarks whose name contains the
+	// filter are run, or all of them when it is NULL
+	BenchmarkRunner(const char* filter, double minimumBatchMilliseconds, int batches);
+	// destructor
+	~BenchmarkRunner();
+
+	// time the benchmark and print its result
+	void Run(const char* name, const BENCHMARK_FUNCTION& function);
+	// get the results of the benchmarks run so far
+	const std::vector<RESULT>& GetResults() const { return(m_results); }
+
+	// write the results to a JSON file, tagged with the label
+	bool WriteJson(const char* filename, const char* label) const;
+	// print the change of every benchmark against the results in
+	// an earlier JSON file, returning the number of benchmarks that
+	// became slower by more than the threshold, or -1 when the
+	// file cannot be read
+	int Compare(const char* filename, double thresholdPercent) const;
+
+	// keep the compiler from discarding a result that is otherwise
+	// unused by the benchmark
+	template <typename T>
+	static void KeepResult(const T& value) { UseResult(&value); }
+
+private:
+	std::string m_filter;
+	double m_minimumBatchMilliseconds;
+	int m_batches;
+	std::vector<RESULT> m_results;
+
+	// publish the address of the result, which forces it to be
+	// stored without copying it
+	static void UseResult(const void* pValue);
+};
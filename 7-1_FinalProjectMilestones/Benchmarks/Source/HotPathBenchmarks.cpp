@@ -0,0 +1,415 @@
+///////////////////////////////////////////////////////////////////////////////
+// hotpathbenchmarks.cpp
+// ============
+// benchmarks of the CPU side functions that run for every object or every
+// frame of the scene
+///////////////////////////////////////////////////////////////////////////////
+
+#include "HotPathBenchmarks.h"
+
+#include "BoundingVolumeHierarchy.h"
+#include "SceneManager.h"
+#include "ViewManager.h"
+#include "ShapeMeshes.h"
+#include "ShaderManager.h"
+#include "camera.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+// declaration of global variables
+namespace
+{
+	// seed of the generated inputs, fixed so that the runs of
+	// different builds can be compared
+	const unsigned int g_InputSeed = 1;
+	// number of generated poses cycled through by the transform
+	// and camera benchmarks
+	const int g_PoseCount = 256;
+	// sizes of the material table, from a small scene to a
+	// generated one
+	const int g_MaterialCounts[] = { 10, 100, 1000, 10000 };
+	// objects in the spatial index, and the share of them moved
+	// before each refit
+	const int g_SpatialObjectCount = 100000;
+	const int g_SpatialMovedCount = 1000;
+	// extent of the generated objects, about that of a stress
+	// scene of 100000 objects
+	const float g_SpatialExtentX = 500.0f;
+	const float g_SpatialExtentZ = 300.0f;
+
+	struct OBJECT_POSE
+	{
+		glm::vec3 scale;
+		glm::vec3 rotationDegrees;
+		glm::vec3 position;
+	};
+
+	// generate poses spread over the extent of a stress scene
+	std::vector<OBJECT_POSE> GeneratePoses()
+	{
+		std::mt19937 random(g_InputSeed);
+		std::uniform_real_distribution<float> scale(0.1f, 4.0f);
+		std::uniform_real_distribution<float> angle(-180.0f, 180.0f);
+		std::uniform_real_distribution<float> position(-50.0f, 50.0f);
+
+		std::vector<OBJECT_POSE> poses(g_PoseCount);
+		for (int i = 0; i < g_PoseCount; i++)
+		{
+			poses[i].scale = glm::vec3(scale(random), scale(random), scale(random));
+			poses[i].rotationDegrees = glm::vec3(angle(random), angle(random), angle(random));
+			poses[i].position = glm::vec3(position(random), position(random), position(random));
+		}
+		return(poses);
+	}
+
+	// generate the tags of a table and the order they are looked
+	// up in, which visits every entry once in a shuffled order
+	void GenerateTags(
+		const char* prefix,
+		int count,
+		std::vector<std::string>& tags,
+		std::vector<std::string>& lookups)
+	{
+		char tag[64];
+		tags.clear();
+		for (int i = 0; i < count; i++)
+		{
+			snprintf(tag, sizeof(tag), "%s%05d", prefix, i);
+			tags.push_back(tag);
+		}
+		lookups = tags;
+		std::shuffle(lookups.begin(), lookups.end(), std::mt19937(g_InputSeed));
+	}
+
+	// generate object bounds the size of the desk parts, spread
+	// over the floor of a stress scene
+	std::vector<BoundingVolumeHierarchy::BOUNDS> GenerateObjectBounds(int count)
+	{
+		std::mt19937 random(g_InputSeed);
+		std::uniform_real_distribution<float> x(-g_SpatialExtentX, g_SpatialExtentX);
+		std::uniform_real_distribution<float> y(0.0f, 4.0f);
+		std::uniform_real_distribution<float> z(-g_SpatialExtentZ, g_SpatialExtentZ);
+		std::uniform_real_distribution<float> size(0.2f, 2.0f);
+
+		std::vector<BoundingVolumeHierarchy::BOUNDS> bounds(count);
+		for (int i = 0; i < count; i++)
+		{
+			glm::vec3 center(x(random), y(random), z(random));
+			glm::vec3 halfSize(size(random), size(random) * 0.5f, size(random));
+			bounds[i].minimum = center - halfSize;
+			bounds[i].maximum = center + halfSize;
+		}
+		return(bounds);
+	}
+
+	// build a benchmark name with the size of its table
+	std::string SizedName(const char* name, int count)
+	{
+		char sizedName[128];
+		snprintf(sizedName, sizeof(sizedName), "%s/%d", name, count);
+		return(sizedName);
+	}
+}
+
+/***********************************************************
+ *  Run()
+ *
+ *  This method is used for running all of the benchmarks.
+ ***********************************************************/
+void HotPathBenchmarks::Run(BenchmarkRunner& runner)
+{
+	RunTransformBenchmarks(runner);
+	RunLookupBenchmarks(runner);
+	RunMeshBenchmarks(runner);
+	RunViewBenchmarks(runner);
+	RunSpatialIndexBenchmarks(runner);
+}
+
+/***********************************************************
+ *  RunTransformBenchmarks()
+ *
+ *  This method is used for timing the composition of the
+ *  scale, rotations and translation of an object into its
+ *  model matrix.
+ ***********************************************************/
+void HotPathBenchmarks::RunTransformBenchmarks(BenchmarkRunner& runner)
+{
+	SceneManager sceneManager(NULL);
+	std::vector<OBJECT_POSE> poses = GeneratePoses();
+
+	runner.Run("SceneManager::SetTransformations", [&](long long operations)
+	{
+		for (long long i = 0; i < operations; i++)
+		{
+			const OBJECT_POSE& pose = poses[i % g_PoseCount];
+			sceneManager.SetTransformations(
+				pose.scale,
+				pose.rotationDegrees.x,
+				pose.rotationDegrees.y,
+				pose.rotationDegrees.z,
+				pose.position);
+			BenchmarkRunner::KeepResult(sceneManager.m_pendingDraw.model);
+		}
+	});
+}
+
+/***********************************************************
+ *  RunLookupBenchmarks()
+ *
+ *  This method is used for timing the lookups of textures
+ *  and materials by tag.  The texture table holds at most
+ *  16 textures, one for each texture unit, so its lookups
+ *  are measured at 10 entries and when full, while the
+ *  material list is measured from 10 up to 10000 entries.
+ ***********************************************************/
+void HotPathBenchmarks::RunLookupBenchmarks(BenchmarkRunner& runner)
+{
+	std::vector<std::string> tags;
+	std::vector<std::string> lookups;
+
+	const int textureCapacity = (int)(sizeof(SceneManager::m_textureIDs) / sizeof(SceneManager::m_textureIDs[0]));
+	const int textureCounts[] = { std::min(10, textureCapacity), textureCapacity };
+	for (int count : textureCounts)
+	{
+		SceneManager sceneManager(NULL);
+		GenerateTags("texture", count, tags, lookups);
+		for (int i = 0; i < count; i++)
+		{
+			sceneManager.m_textureIDs[i].tag = tags[i];
+			sceneManager.m_textureIDs[i].ID = i + 1;
+		}
+		sceneManager.m_loadedTextures = count;
+
+		runner.Run(SizedName("SceneManager::FindTextureSlot", count).c_str(), [&](long long operations)
+		{
+			for (long long i = 0; i < operations; i++)
+			{
+				int slot = sceneManager.FindTextureSlot(lookups[i % count].c_str());
+				BenchmarkRunner::KeepResult(slot);
+			}
+		});
+
+		// the texture table is cleared without deleting textures
+		sceneManager.m_loadedTextures = 0;
+	}
+
+	for (int count : g_MaterialCounts)
+	{
+		SceneManager sceneManager(NULL);
+		GenerateTags("material", count, tags, lookups);
+		for (int i = 0; i < count; i++)
+		{
+			SceneManager::OBJECT_MATERIAL material;
+			material.ambientStrength = 0.2f;
+			material.ambientColor = glm::vec3(0.1f);
+			material.diffuseColor = glm::vec3(0.5f);
+			material.specularColor = glm::vec3(0.3f);
+			material.shininess = 16.0f;
+			material.tag = tags[i];
+			sceneManager.m_objectMaterials.push_back(material);
+		}
+
+		runner.Run(SizedName("SceneManager::FindMaterial", count).c_str(), [&](long long operations)
+		{
+			SceneManager::OBJECT_MATERIAL material;
+			for (long long i = 0; i < operations; i++)
+			{
+				bool bFound = sceneManager.FindMaterial(lookups[i % count].c_str(), material);
+				BenchmarkRunner::KeepResult(bFound);
+				BenchmarkRunner::KeepResult(material);
+			}
+		});
+
+		runner.Run(SizedName("SceneManager::FindMaterialIndex", count).c_str(), [&](long long operations)
+		{
+			for (long long i = 0; i < operations; i++)
+			{
+				int index = sceneManager.FindMaterialIndex(lookups[i % count].c_str());
+				BenchmarkRunner::KeepResult(index);
+			}
+		});
+	}
+}
+
+/***********************************************************
+ *  RunMeshBenchmarks()
+ *
+ *  This method is used for timing the generation of each
+ *  basic shape that the scene draws, including the buffer
+ *  uploads that the mock records instead of performing.
+ ***********************************************************/
+void HotPathBenchmarks::RunMeshBenchmarks(BenchmarkRunner& runner)
+{
+	ShapeMeshes meshes;
+
+	runner.Run("ShapeMeshes::LoadPlaneMesh", [&](long long operations)
+	{
+		for (long long i = 0; i < operations; i++)
+		{
+			meshes.LoadPlaneMesh();
+		}
+	});
+	runner.Run("ShapeMeshes::LoadBoxMesh", [&](long long operations)
+	{
+		for (long long i = 0; i < operations; i++)
+		{
+			meshes.LoadBoxMesh();
+		}
+	});
+	runner.Run("ShapeMeshes::LoadSphereMesh", [&](long long operations)
+	{
+		for (long long i = 0; i < operations; i++)
+		{
+			meshes.LoadSphereMesh();
+		}
+	});
+	runner.Run("ShapeMeshes::LoadCylinderMesh", [&](long long operations)
+	{
+		for (long long i = 0; i < operations; i++)
+		{
+			meshes.LoadCylinderMesh();
+		}
+	});
+	runner.Run("ShapeMeshes::LoadConeMesh", [&](long long operations)
+	{
+		for (long long i = 0; i < operations; i++)
+		{
+			meshes.LoadConeMesh();
+		}
+	});
+}
+
+/***********************************************************
+ *  RunViewBenchmarks()
+ *
+ *  This method is used for timing the view matrix of the
+ *  camera and the preparation of the view and projection
+ *  for a frame, which also uploads them into the shader.
+ ***********************************************************/
+void HotPathBenchmarks::RunViewBenchmarks(BenchmarkRunner& runner)
+{
+	std::vector<OBJECT_POSE> poses = GeneratePoses();
+
+	Camera camera;
+	runner.Run("Camera::GetViewMatrix", [&](long long operations)
+	{
+		for (long long i = 0; i < operations; i++)
+		{
+			const OBJECT_POSE& pose = poses[i % g_PoseCount];
+			camera.Position = pose.position;
+			camera.Front = glm::normalize(-pose.position);
+			glm::mat4 view = camera.GetViewMatrix();
+			BenchmarkRunner::KeepResult(view);
+		}
+	});
+
+	ShaderManager shaderManager;
+	ViewManager viewManager(&shaderManager);
+	const bool bOrthographicModes[] = { false, true };
+	for (bool bOrthographic : bOrthographicModes)
+	{
+		viewManager.SetCameraPose(glm::vec3(0.0f, 5.0f, 12.0f), glm::vec3(0.0f, -0.5f, -2.0f), 80.0f, bOrthographic);
+		runner.Run(bOrthographic ? "ViewManager::PrepareSceneView/orthographic" : "ViewManager::PrepareSceneView/perspective",
+			[&](long long operations)
+		{
+			for (long long i = 0; i < operations; i++)
+			{
+				viewManager.PrepareSceneView();
+				BenchmarkRunner::KeepResult(viewManager.GetProjectionMatrix());
+			}
+		});
+	}
+}
+
+/***********************************************************
+ *  RunSpatialIndexBenchmarks()
+ *
+ *  This method is used for timing the spatial index over as
+ *  many objects as a large stress scene.  The rays start at
+ *  camera heights and point down into the scene, as when
+ *  picking, and the refit moves a share of the objects each
+ *  time, as the dynamic objects of a frame would.
+ ***********************************************************/
+void HotPathBenchmarks::RunSpatialIndexBenchmarks(BenchmarkRunner& runner)
+{
+	std::vector<BoundingVolumeHierarchy::BOUNDS> bounds = GenerateObjectBounds(g_SpatialObjectCount);
+	std::vector<OBJECT_POSE> poses = GeneratePoses();
+
+	BoundingVolumeHierarchy spatialIndex;
+	runner.Run(SizedName("BoundingVolumeHierarchy::Build", g_SpatialObjectCount).c_str(), [&](long long operations)
+	{
+		for (long long i = 0; i < operations; i++)
+		{
+			spatialIndex.Build(bounds);
+			BenchmarkRunner::KeepResult(spatialIndex.GetItemCount());
+		}
+	});
+	spatialIndex.Build(bounds);
+
+	// each refit moves the objects back and forth, so the tree
+	// does not drift between the batches
+	std::vector<int> moved(g_SpatialMovedCount);
+	std::mt19937 random(g_InputSeed);
+	std::uniform_int_distribution<int> pickObject(0, g_SpatialObjectCount - 1);
+	for (int i = 0; i < g_SpatialMovedCount; i++)
+	{
+		moved[i] = pickObject(random);
+	}
+	runner.Run(SizedName("BoundingVolumeHierarchy::Refit", g_SpatialMovedCount).c_str(), [&](long long operations)
+	{
+		for (long long i = 0; i < operations; i++)
+		{
+			glm::vec3 offset((i % 2 == 0) ? 0.5f : -0.5f, 0.0f, 0.0f);
+			for (int j = 0; j < g_SpatialMovedCount; j++)
+			{
+				BoundingVolumeHierarchy::BOUNDS itemBounds = spatialIndex.GetItemBounds(moved[j]);
+				itemBounds.minimum += offset;
+				itemBounds.maximum += offset;
+				spatialIndex.UpdateItem(moved[j], itemBounds);
+			}
+			spatialIndex.Refit();
+		}
+		BenchmarkRunner::KeepResult(spatialIndex.GetRefitInflation());
+	});
+	spatialIndex.Build(bounds);
+
+	std::vector<glm::vec3> origins(g_PoseCount);
+	std::vector<glm::vec3> directions(g_PoseCount);
+	for (int i = 0; i < g_PoseCount; i++)
+	{
+		origins[i] = glm::vec3(poses[i].position.x * 8.0f, 10.0f, poses[i].position.z * 5.0f);
+		glm::vec3 target(poses[(i + 1) % g_PoseCount].position.x * 8.0f, 0.0f, poses[(i + 1) % g_PoseCount].position.z * 5.0f);
+		directions[i] = glm::normalize(target - origins[i]);
+	}
+	runner.Run(SizedName("BoundingVolumeHierarchy::RayCast", g_SpatialObjectCount).c_str(), [&](long long operations)
+	{
+		BoundingVolumeHierarchy::RAY_HIT hit;
+		for (long long i = 0; i < operations; i++)
+		{
+			bool bHit = spatialIndex.RayCast(origins[i % g_PoseCount], directions[i % g_PoseCount], 1000.0f, hit);
+			BenchmarkRunner::KeepResult(bHit);
+			BenchmarkRunner::KeepResult(hit.distance);
+		}
+	});
+
+	std::vector<int> items;
+	items.reserve(g_SpatialObjectCount);
+	runner.Run(SizedName("BoundingVolumeHierarchy::QueryOverlap", g_SpatialObjectCount).c_str(), [&](long long operations)
+	{
+		BoundingVolumeHierarchy::BOUNDS box;
+		for (long long i = 0; i < operations; i++)
+		{
+			glm::vec3 center(poses[i % g_PoseCount].position.x * 8.0f, 1.0f, poses[i % g_PoseCount].position.z * 5.0f);
+			box.minimum = center - glm::vec3(2.0f);
+			box.maximum = center + glm::vec3(2.0f);
+			spatialIndex.QueryOverlap(box, items);
+			BenchmarkRunner::KeepResult(items.size());
+		}
+	});
+}
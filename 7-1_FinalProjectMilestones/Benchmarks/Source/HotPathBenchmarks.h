@@ -0,0 +1,39 @@
+///////////////////////////////////////////////////////////////////////////////
+// hotpathbenchmarks.h
+// ============
+// benchmarks of the CPU side functions that run for every object or every
+// frame of the scene
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "BenchmarkRunner.h"
+
+/***********************************************************
+ *  HotPathBenchmarks
+ *
+ *  This class runs each hot function of the scene on its
+ *  own, over inputs that are generated from a fixed seed so
+ *  that every run does the same work.  It is a friend of the
+ *  SceneManager, which lets it fill the texture and material
+ *  tables to the measured sizes and call the lookups that
+ *  the scene uses internally.
+ ***********************************************************/
+class HotPathBenchmarks
+{
+public:
+	// run all of the benchmarks that match the runner's filter
+	static void Run(BenchmarkRunner& runner);
+
+private:
+	// composing the model matrix of an object
+	static void RunTransformBenchmarks(BenchmarkRunner& runner);
+	// finding the textures and materials by tag
+	static void RunLookupBenchmarks(BenchmarkRunner& runner);
+	// generating the basic shape meshes
+	static void RunMeshBenchmarks(BenchmarkRunner& runner);
+	// calculating the view and projection of a frame
+	static void RunViewBenchmarks(BenchmarkRunner& runner);
+	// building, refitting and querying the spatial index
+	static void RunSpatialIndexBenchmarks(BenchmarkRunner& runner);
+};
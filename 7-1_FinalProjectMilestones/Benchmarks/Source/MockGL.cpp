@@ -0,0 +1,493 @@
+///////////////////////////////////////////////////////////////////////////////
+// mockgl.cpp
+// ============
+// stand in for the OpenGL, GLEW and GLFW libraries, recording the calls
+// made by the benchmarked code instead of reaching a driver
+///////////////////////////////////////////////////////////////////////////////
+
+#include "MockGL.h"
+
+#include <GL/glew.h>
+#include "GLFW/glfw3.h"
+
+#include <cstdio>
+#include <cstring>
+
+// declaration of global variables
+namespace
+{
+	// counter of one entry point, added to the list of recorded
+	// entry points on its first call
+	struct CALL_RECORD
+	{
+		const char* name;
+		long long count;
+		bool bListed;
+		CALL_RECORD* pNext;
+	};
+
+	CALL_RECORD* g_pRecords = NULL;
+	long long g_TotalCalls = 0;
+	// next name handed out for a created object
+	GLuint g_NextObjectName = 1;
+	// simulated time returned by glfwGetTime(), advanced by one
+	// frame at 60 Hz on every call
+	double g_SimulatedSeconds = 0.0;
+
+	void RecordCall(CALL_RECORD& record)
+	{
+		if (record.bListed == false)
+		{
+			record.pNext = g_pRecords;
+			g_pRecords = &record;
+			record.bListed = true;
+		}
+		record.count++;
+		g_TotalCalls++;
+	}
+
+	// fill the array with newly created object names
+	void GenerateNames(GLsizei count, GLuint* pNames)
+	{
+		for (GLsizei i = 0; i < count; i++)
+		{
+			pNames[i] = g_NextObjectName++;
+		}
+	}
+}
+
+// count one call of the named entry point
+#define RECORD_CALL(functionName) \
+	static CALL_RECORD s_record = { functionName, 0, false, NULL }; \
+	RecordCall(s_record)
+
+/***********************************************************
+ *  GetTotalCalls()
+ *
+ *  This function is used for getting the number of calls
+ *  recorded to all of the entry points.
+ ***********************************************************/
+long long MockGL::GetTotalCalls()
+{
+	return(g_TotalCalls);
+}
+
+/***********************************************************
+ *  GetCalls()
+ *
+ *  This function is used for getting the number of calls
+ *  recorded to the named entry point.
+ ***********************************************************/
+long long MockGL::GetCalls(const char* functionName)
+{
+	for (CALL_RECORD* pRecord = g_pRecords; NULL != pRecord; pRecord = pRecord->pNext)
+	{
+		if (strcmp(pRecord->name, functionName) == 0)
+		{
+			return(pRecord->count);
+		}
+	}
+	return(0);
+}
+
+/***********************************************************
+ *  ReportCalls()
+ *
+ *  This function is used for printing the calls recorded to
+ *  every entry point that was used.
+ ***********************************************************/
+void MockGL::ReportCalls()
+{
+	printf("Recorded OpenGL calls:\n");
+	for (CALL_RECORD* pRecord = g_pRecords; NULL != pRecord; pRecord = pRecord->pNext)
+	{
+		if (pRecord->count > 0)
+		{
+			printf("  %-28s %12lld\n", pRecord->name, pRecord->count);
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// OpenGL 1.1 - exported by opengl32 and declared as plain functions by glew.h
+///////////////////////////////////////////////////////////////////////////////
+
+void GLAPIENTRY glBindTexture(GLenum target, GLuint texture) { RECORD_CALL("glBindTexture"); }
+void GLAPIENTRY glBlendFunc(GLenum sfactor, GLenum dfactor) { RECORD_CALL("glBlendFunc"); }
+void GLAPIENTRY glClear(GLbitfield mask) { RECORD_CALL("glClear"); }
+void GLAPIENTRY glClearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha) { RECORD_CALL("glClearColor"); }
+void GLAPIENTRY glColorMask(GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha) { RECORD_CALL("glColorMask"); }
+void GLAPIENTRY glCopyTexSubImage2D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLint x, GLint y, GLsizei width, GLsizei height) { RECORD_CALL("glCopyTexSubImage2D"); }
+void GLAPIENTRY glCullFace(GLenum mode) { RECORD_CALL("glCullFace"); }
+void GLAPIENTRY glDepthFunc(GLenum func) { RECORD_CALL("glDepthFunc"); }
+void GLAPIENTRY glDepthMask(GLboolean flag) { RECORD_CALL("glDepthMask"); }
+void GLAPIENTRY glDisable(GLenum cap) { RECORD_CALL("glDisable"); }
+void GLAPIENTRY glDrawArrays(GLenum mode, GLint first, GLsizei count) { RECORD_CALL("glDrawArrays"); }
+void GLAPIENTRY glDrawElements(GLenum mode, GLsizei count, GLenum type, const void* indices) { RECORD_CALL("glDrawElements"); }
+void GLAPIENTRY glEnable(GLenum cap) { RECORD_CALL("glEnable"); }
+void GLAPIENTRY glFinish(void) { RECORD_CALL("glFinish"); }
+void GLAPIENTRY glFlush(void) { RECORD_CALL("glFlush"); }
+void GLAPIENTRY glPixelStorei(GLenum pname, GLint param) { RECORD_CALL("glPixelStorei"); }
+void GLAPIENTRY glReadBuffer(GLenum mode) { RECORD_CALL("glReadBuffer"); }
+void GLAPIENTRY glTexParameteri(GLenum target, GLenum pname, GLint param) { RECORD_CALL("glTexParameteri"); }
+void GLAPIENTRY glViewport(GLint x, GLint y, GLsizei width, GLsizei height) { RECORD_CALL("glViewport"); }
+
+void GLAPIENTRY glGenTextures(GLsizei n, GLuint* textures)
+{
+	RECORD_CALL("glGenTextures");
+	GenerateNames(n, textures);
+}
+
+void GLAPIENTRY glDeleteTextures(GLsizei n, const GLuint* textures)
+{
+	RECORD_CALL("glDeleteTextures");
+}
+
+GLenum GLAPIENTRY glGetError(void)
+{
+	RECORD_CALL("glGetError");
+	return(GL_NO_ERROR);
+}
+
+void GLAPIENTRY glGetIntegerv(GLenum pname, GLint* params)
+{
+	RECORD_CALL("glGetIntegerv");
+	params[0] = 0;
+}
+
+const GLubyte* GLAPIENTRY glGetString(GLenum name)
+{
+	RECORD_CALL("glGetString");
+	return((const GLubyte*)"MockGL");
+}
+
+void GLAPIENTRY glReadPixels(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, void* pixels)
+{
+	RECORD_CALL("glReadPixels");
+}
+
+void GLAPIENTRY glTexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const void* pixels)
+{
+	RECORD_CALL("glTexImage2D");
+}
+
+void GLAPIENTRY glTexSubImage2D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels)
+{
+	RECORD_CALL("glTexSubImage2D");
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// OpenGL 1.2 and later - function pointers that glewInit() would load
+///////////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+	void GLAPIENTRY MockActiveTexture(GLenum texture) { RECORD_CALL("glActiveTexture"); }
+	void GLAPIENTRY MockAttachShader(GLuint program, GLuint shader) { RECORD_CALL("glAttachShader"); }
+	void GLAPIENTRY MockBindAttribLocation(GLuint program, GLuint index, const GLchar* name) { RECORD_CALL("glBindAttribLocation"); }
+	void GLAPIENTRY MockBindBuffer(GLenum target, GLuint buffer) { RECORD_CALL("glBindBuffer"); }
+	void GLAPIENTRY MockBindBufferBase(GLenum target, GLuint index, GLuint buffer) { RECORD_CALL("glBindBufferBase"); }
+	void GLAPIENTRY MockBindFramebuffer(GLenum target, GLuint framebuffer) { RECORD_CALL("glBindFramebuffer"); }
+	void GLAPIENTRY MockBindImageTexture(GLuint unit, GLuint texture, GLint level, GLboolean layered, GLint layer, GLenum access, GLenum format) { RECORD_CALL("glBindImageTexture"); }
+	void GLAPIENTRY MockBindVertexArray(GLuint array) { RECORD_CALL("glBindVertexArray"); }
+	void GLAPIENTRY MockBlitFramebuffer(GLint srcX0, GLint srcY0, GLint srcX1, GLint srcY1, GLint dstX0, GLint dstY0, GLint dstX1, GLint dstY1, GLbitfield mask, GLenum filter) { RECORD_CALL("glBlitFramebuffer"); }
+	void GLAPIENTRY MockBufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage) { RECORD_CALL("glBufferData"); }
+	void GLAPIENTRY MockBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data) { RECORD_CALL("glBufferSubData"); }
+	void GLAPIENTRY MockClearBufferData(GLenum target, GLenum internalformat, GLenum format, GLenum type, const void* data) { RECORD_CALL("glClearBufferData"); }
+	void GLAPIENTRY MockCompileShader(GLuint shader) { RECORD_CALL("glCompileShader"); }
+	void GLAPIENTRY MockCopyBufferSubData(GLenum readTarget, GLenum writeTarget, GLintptr readOffset, GLintptr writeOffset, GLsizeiptr size) { RECORD_CALL("glCopyBufferSubData"); }
+	void GLAPIENTRY MockCompressedTexImage2D(GLenum target, GLint level, GLenum internalformat, GLsizei width, GLsizei height, GLint border, GLsizei imageSize, const void* data) { RECORD_CALL("glCompressedTexImage2D"); }
+	void GLAPIENTRY MockDeleteProgram(GLuint program) { RECORD_CALL("glDeleteProgram"); }
+	void GLAPIENTRY MockDeleteShader(GLuint shader) { RECORD_CALL("glDeleteShader"); }
+	void GLAPIENTRY MockDetachShader(GLuint program, GLuint shader) { RECORD_CALL("glDetachShader"); }
+	void GLAPIENTRY MockDisableVertexAttribArray(GLuint index) { RECORD_CALL("glDisableVertexAttribArray"); }
+	void GLAPIENTRY MockDispatchCompute(GLuint numGroupsX, GLuint numGroupsY, GLuint numGroupsZ) { RECORD_CALL("glDispatchCompute"); }
+	void GLAPIENTRY MockDrawElementsBaseVertex(GLenum mode, GLsizei count, GLenum type, const void* indices, GLint basevertex) { RECORD_CALL("glDrawElementsBaseVertex"); }
+	void GLAPIENTRY MockDrawElementsInstancedBaseVertexBaseInstance(GLenum mode, GLsizei count, GLenum type, const void* indices, GLsizei instancecount, GLint basevertex, GLuint baseinstance) { RECORD_CALL("glDrawElementsInstancedBaseVertexBaseInstance"); }
+	void GLAPIENTRY MockEnableVertexAttribArray(GLuint index) { RECORD_CALL("glEnableVertexAttribArray"); }
+	void GLAPIENTRY MockFramebufferTexture2D(GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level) { RECORD_CALL("glFramebufferTexture2D"); }
+	void GLAPIENTRY MockGenerateMipmap(GLenum target) { RECORD_CALL("glGenerateMipmap"); }
+	void GLAPIENTRY MockLinkProgram(GLuint program) { RECORD_CALL("glLinkProgram"); }
+	void GLAPIENTRY MockMemoryBarrier(GLbitfield barriers) { RECORD_CALL("glMemoryBarrier"); }
+	void GLAPIENTRY MockMultiDrawElementsIndirect(GLenum mode, GLenum type, const void* indirect, GLsizei drawcount, GLsizei stride) { RECORD_CALL("glMultiDrawElementsIndirect"); }
+	void GLAPIENTRY MockMultiDrawElementsIndirectCountARB(GLenum mode, GLenum type, const void* indirect, GLintptr drawcount, GLsizei maxdrawcount, GLsizei stride) { RECORD_CALL("glMultiDrawElementsIndirectCountARB"); }
+	void GLAPIENTRY MockProgramBinary(GLuint program, GLenum binaryFormat, const void* binary, GLsizei length) { RECORD_CALL("glProgramBinary"); }
+	void GLAPIENTRY MockProgramParameteri(GLuint program, GLenum pname, GLint value) { RECORD_CALL("glProgramParameteri"); }
+	void GLAPIENTRY MockShaderSource(GLuint shader, GLsizei count, const GLchar* const* string, const GLint* length) { RECORD_CALL("glShaderSource"); }
+	void GLAPIENTRY MockTexStorage2D(GLenum target, GLsizei levels, GLenum internalformat, GLsizei width, GLsizei height) { RECORD_CALL("glTexStorage2D"); }
+	void GLAPIENTRY MockUniform1f(GLint location, GLfloat v0) { RECORD_CALL("glUniform1f"); }
+	void GLAPIENTRY MockUniform1i(GLint location, GLint v0) { RECORD_CALL("glUniform1i"); }
+	void GLAPIENTRY MockUniform1ui(GLint location, GLuint v0) { RECORD_CALL("glUniform1ui"); }
+	void GLAPIENTRY MockUniform2f(GLint location, GLfloat v0, GLfloat v1) { RECORD_CALL("glUniform2f"); }
+	void GLAPIENTRY MockUniform3f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2) { RECORD_CALL("glUniform3f"); }
+	void GLAPIENTRY MockUniform4f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3) { RECORD_CALL("glUniform4f"); }
+	void GLAPIENTRY MockUniform2fv(GLint location, GLsizei count, const GLfloat* value) { RECORD_CALL("glUniform2fv"); }
+	void GLAPIENTRY MockUniform3fv(GLint location, GLsizei count, const GLfloat* value) { RECORD_CALL("glUniform3fv"); }
+	void GLAPIENTRY MockUniform4fv(GLint location, GLsizei count, const GLfloat* value) { RECORD_CALL("glUniform4fv"); }
+	void GLAPIENTRY MockUniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value) { RECORD_CALL("glUniformMatrix4fv"); }
+	void GLAPIENTRY MockUseProgram(GLuint program) { RECORD_CALL("glUseProgram"); }
+	void GLAPIENTRY MockVertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* pointer) { RECORD_CALL("glVertexAttribPointer"); }
+	void GLAPIENTRY MockVertexAttribIPointer(GLuint index, GLint size, GLenum type, GLsizei stride, const void* pointer) { RECORD_CALL("glVertexAttribIPointer"); }
+	void GLAPIENTRY MockVertexAttribDivisor(GLuint index, GLuint divisor) { RECORD_CALL("glVertexAttribDivisor"); }
+
+	void GLAPIENTRY MockGenBuffers(GLsizei n, GLuint* buffers)
+	{
+		RECORD_CALL("glGenBuffers");
+		GenerateNames(n, buffers);
+	}
+
+	void GLAPIENTRY MockGenFramebuffers(GLsizei n, GLuint* framebuffers)
+	{
+		RECORD_CALL("glGenFramebuffers");
+		GenerateNames(n, framebuffers);
+	}
+
+	void GLAPIENTRY MockGenVertexArrays(GLsizei n, GLuint* arrays)
+	{
+		RECORD_CALL("glGenVertexArrays");
+		GenerateNames(n, arrays);
+	}
+
+	void GLAPIENTRY MockDeleteBuffers(GLsizei n, const GLuint* buffers) { RECORD_CALL("glDeleteBuffers"); }
+	void GLAPIENTRY MockDeleteFramebuffers(GLsizei n, const GLuint* framebuffers) { RECORD_CALL("glDeleteFramebuffers"); }
+	void GLAPIENTRY MockDeleteVertexArrays(GLsizei n, const GLuint* arrays) { RECORD_CALL("glDeleteVertexArrays"); }
+
+	GLuint GLAPIENTRY MockCreateProgram(void)
+	{
+		RECORD_CALL("glCreateProgram");
+		return(g_NextObjectName++);
+	}
+
+	GLuint GLAPIENTRY MockCreateShader(GLenum type)
+	{
+		RECORD_CALL("glCreateShader");
+		return(g_NextObjectName++);
+	}
+
+	GLenum GLAPIENTRY MockCheckFramebufferStatus(GLenum target)
+	{
+		RECORD_CALL("glCheckFramebufferStatus");
+		return(GL_FRAMEBUFFER_COMPLETE);
+	}
+
+	GLint GLAPIENTRY MockGetAttribLocation(GLuint program, const GLchar* name)
+	{
+		RECORD_CALL("glGetAttribLocation");
+		return(0);
+	}
+
+	GLint GLAPIENTRY MockGetUniformLocation(GLuint program, const GLchar* name)
+	{
+		RECORD_CALL("glGetUniformLocation");
+		return(0);
+	}
+
+	// there is no buffer memory to map, so the uploads fall back to
+	// glBufferSubData()
+	void* GLAPIENTRY MockMapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access)
+	{
+		RECORD_CALL("glMapBufferRange");
+		return(NULL);
+	}
+
+	GLboolean GLAPIENTRY MockUnmapBuffer(GLenum target)
+	{
+		RECORD_CALL("glUnmapBuffer");
+		return(GL_TRUE);
+	}
+
+	// shaders compile and programs link successfully, with an
+	// empty log and no binary to cache
+	void GLAPIENTRY MockGetShaderiv(GLuint shader, GLenum pname, GLint* params)
+	{
+		RECORD_CALL("glGetShaderiv");
+		params[0] = (pname == GL_COMPILE_STATUS) ? GL_TRUE : 0;
+	}
+
+	void GLAPIENTRY MockGetProgramiv(GLuint program, GLenum pname, GLint* params)
+	{
+		RECORD_CALL("glGetProgramiv");
+		params[0] = (pname == GL_LINK_STATUS) ? GL_TRUE : 0;
+	}
+
+	void GLAPIENTRY MockGetShaderInfoLog(GLuint shader, GLsizei bufSize, GLsizei* length, GLchar* infoLog)
+	{
+		RECORD_CALL("glGetShaderInfoLog");
+		if (NULL != length)
+		{
+			length[0] = 0;
+		}
+		if (bufSize > 0)
+		{
+			infoLog[0] = '\0';
+		}
+	}
+
+	void GLAPIENTRY MockGetProgramInfoLog(GLuint program, GLsizei bufSize, GLsizei* length, GLchar* infoLog)
+	{
+		RECORD_CALL("glGetProgramInfoLog");
+		if (NULL != length)
+		{
+			length[0] = 0;
+		}
+		if (bufSize > 0)
+		{
+			infoLog[0] = '\0';
+		}
+	}
+
+	void GLAPIENTRY MockGetProgramBinary(GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat, void* binary)
+	{
+		RECORD_CALL("glGetProgramBinary");
+		if (NULL != length)
+		{
+			length[0] = 0;
+		}
+	}
+}
+
+PFNGLACTIVETEXTUREPROC __glewActiveTexture = MockActiveTexture;
+PFNGLATTACHSHADERPROC __glewAttachShader = MockAttachShader;
+PFNGLBINDATTRIBLOCATIONPROC __glewBindAttribLocation = MockBindAttribLocation;
+PFNGLBINDBUFFERPROC __glewBindBuffer = MockBindBuffer;
+PFNGLBINDBUFFERBASEPROC __glewBindBufferBase = MockBindBufferBase;
+PFNGLBINDFRAMEBUFFERPROC __glewBindFramebuffer = MockBindFramebuffer;
+PFNGLBINDIMAGETEXTUREPROC __glewBindImageTexture = MockBindImageTexture;
+PFNGLBINDVERTEXARRAYPROC __glewBindVertexArray = MockBindVertexArray;
+PFNGLBLITFRAMEBUFFERPROC __glewBlitFramebuffer = MockBlitFramebuffer;
+PFNGLBUFFERDATAPROC __glewBufferData = MockBufferData;
+PFNGLBUFFERSUBDATAPROC __glewBufferSubData = MockBufferSubData;
+PFNGLCHECKFRAMEBUFFERSTATUSPROC __glewCheckFramebufferStatus = MockCheckFramebufferStatus;
+PFNGLCLEARBUFFERDATAPROC __glewClearBufferData = MockClearBufferData;
+PFNGLCOMPILESHADERPROC __glewCompileShader = MockCompileShader;
+PFNGLCOPYBUFFERSUBDATAPROC __glewCopyBufferSubData = MockCopyBufferSubData;
+PFNGLCOMPRESSEDTEXIMAGE2DPROC __glewCompressedTexImage2D = MockCompressedTexImage2D;
+PFNGLCREATEPROGRAMPROC __glewCreateProgram = MockCreateProgram;
+PFNGLCREATESHADERPROC __glewCreateShader = MockCreateShader;
+PFNGLDELETEBUFFERSPROC __glewDeleteBuffers = MockDeleteBuffers;
+PFNGLDELETEFRAMEBUFFERSPROC __glewDeleteFramebuffers = MockDeleteFramebuffers;
+PFNGLDELETEPROGRAMPROC __glewDeleteProgram = MockDeleteProgram;
+PFNGLDELETESHADERPROC __glewDeleteShader = MockDeleteShader;
+PFNGLDELETEVERTEXARRAYSPROC __glewDeleteVertexArrays = MockDeleteVertexArrays;
+PFNGLDETACHSHADERPROC __glewDetachShader = MockDetachShader;
+PFNGLDISABLEVERTEXATTRIBARRAYPROC __glewDisableVertexAttribArray = MockDisableVertexAttribArray;
+PFNGLDISPATCHCOMPUTEPROC __glewDispatchCompute = MockDispatchCompute;
+PFNGLDRAWELEMENTSBASEVERTEXPROC __glewDrawElementsBaseVertex = MockDrawElementsBaseVertex;
+PFNGLDRAWELEMENTSINSTANCEDBASEVERTEXBASEINSTANCEPROC __glewDrawElementsInstancedBaseVertexBaseInstance = MockDrawElementsInstancedBaseVertexBaseInstance;
+PFNGLENABLEVERTEXATTRIBARRAYPROC __glewEnableVertexAttribArray = MockEnableVertexAttribArray;
+PFNGLFRAMEBUFFERTEXTURE2DPROC __glewFramebufferTexture2D = MockFramebufferTexture2D;
+PFNGLGENBUFFERSPROC __glewGenBuffers = MockGenBuffers;
+PFNGLGENERATEMIPMAPPROC __glewGenerateMipmap = MockGenerateMipmap;
+PFNGLGENFRAMEBUFFERSPROC __glewGenFramebuffers = MockGenFramebuffers;
+PFNGLGENVERTEXARRAYSPROC __glewGenVertexArrays = MockGenVertexArrays;
+PFNGLGETATTRIBLOCATIONPROC __glewGetAttribLocation = MockGetAttribLocation;
+PFNGLGETPROGRAMBINARYPROC __glewGetProgramBinary = MockGetProgramBinary;
+PFNGLGETPROGRAMINFOLOGPROC __glewGetProgramInfoLog = MockGetProgramInfoLog;
+PFNGLGETPROGRAMIVPROC __glewGetProgramiv = MockGetProgramiv;
+PFNGLGETSHADERINFOLOGPROC __glewGetShaderInfoLog = MockGetShaderInfoLog;
+PFNGLGETSHADERIVPROC __glewGetShaderiv = MockGetShaderiv;
+PFNGLGETUNIFORMLOCATIONPROC __glewGetUniformLocation = MockGetUniformLocation;
+PFNGLLINKPROGRAMPROC __glewLinkProgram = MockLinkProgram;
+PFNGLMAPBUFFERRANGEPROC __glewMapBufferRange = MockMapBufferRange;
+PFNGLMEMORYBARRIERPROC __glewMemoryBarrier = MockMemoryBarrier;
+PFNGLMULTIDRAWELEMENTSINDIRECTPROC __glewMultiDrawElementsIndirect = MockMultiDrawElementsIndirect;
+PFNGLMULTIDRAWELEMENTSINDIRECTCOUNTARBPROC __glewMultiDrawElementsIndirectCountARB = MockMultiDrawElementsIndirectCountARB;
+PFNGLPROGRAMBINARYPROC __glewProgramBinary = MockProgramBinary;
+PFNGLPROGRAMPARAMETERIPROC __glewProgramParameteri = MockProgramParameteri;
+PFNGLSHADERSOURCEPROC __glewShaderSource = MockShaderSource;
+PFNGLTEXSTORAGE2DPROC __glewTexStorage2D = MockTexStorage2D;
+PFNGLUNIFORM1FPROC __glewUniform1f = MockUniform1f;
+PFNGLUNIFORM1IPROC __glewUniform1i = MockUniform1i;
+PFNGLUNIFORM1UIPROC __glewUniform1ui = MockUniform1ui;
+PFNGLUNIFORM2FPROC __glewUniform2f = MockUniform2f;
+PFNGLUNIFORM3FPROC __glewUniform3f = MockUniform3f;
+PFNGLUNIFORM4FPROC __glewUniform4f = MockUniform4f;
+PFNGLUNIFORM2FVPROC __glewUniform2fv = MockUniform2fv;
+PFNGLUNIFORM3FVPROC __glewUniform3fv = MockUniform3fv;
+PFNGLUNIFORM4FVPROC __glewUniform4fv = MockUniform4fv;
+PFNGLUNIFORMMATRIX4FVPROC __glewUniformMatrix4fv = MockUniformMatrix4fv;
+PFNGLUNMAPBUFFERPROC __glewUnmapBuffer = MockUnmapBuffer;
+PFNGLUSEPROGRAMPROC __glewUseProgram = MockUseProgram;
+PFNGLVERTEXATTRIBPOINTERPROC __glewVertexAttribPointer = MockVertexAttribPointer;
+PFNGLVERTEXATTRIBIPOINTERPROC __glewVertexAttribIPointer = MockVertexAttribIPointer;
+PFNGLVERTEXATTRIBDIVISORPROC __glewVertexAttribDivisor = MockVertexAttribDivisor;
+
+// extensions reported as present, so the scene takes its usual paths
+GLboolean __GLEW_EXT_texture_compression_s3tc = GL_TRUE;
+GLboolean __GLEW_ARB_texture_compression_bptc = GL_TRUE;
+GLboolean __GLEW_ARB_indirect_parameters = GL_TRUE;
+GLboolean __GLEW_VERSION_4_2 = GL_TRUE;
+GLboolean __GLEW_VERSION_4_3 = GL_TRUE;
+
+///////////////////////////////////////////////////////////////////////////////
+// GLFW - there is no window, so no key is ever pressed
+///////////////////////////////////////////////////////////////////////////////
+
+double glfwGetTime(void)
+{
+	RECORD_CALL("glfwGetTime");
+	g_SimulatedSeconds += 1.0 / 60.0;
+	return(g_SimulatedSeconds);
+}
+
+int glfwGetKey(GLFWwindow* window, int key)
+{
+	RECORD_CALL("glfwGetKey");
+	return(GLFW_RELEASE);
+}
+
+GLFWwindow* glfwCreateWindow(int width, int height, const char* title, GLFWmonitor* monitor, GLFWwindow* share)
+{
+	RECORD_CALL("glfwCreateWindow");
+	return(NULL);
+}
+
+void glfwGetCursorPos(GLFWwindow* window, double* xpos, double* ypos)
+{
+	RECORD_CALL("glfwGetCursorPos");
+	*xpos = 0.0;
+	*ypos = 0.0;
+}
+
+void glfwGetFramebufferSize(GLFWwindow* window, int* width, int* height)
+{
+	RECORD_CALL("glfwGetFramebufferSize");
+	*width = 0;
+	*height = 0;
+}
+
+void glfwGetWindowSize(GLFWwindow* window, int* width, int* height)
+{
+	RECORD_CALL("glfwGetWindowSize");
+	*width = 0;
+	*height = 0;
+}
+
+void glfwMakeContextCurrent(GLFWwindow* window) { RECORD_CALL("glfwMakeContextCurrent"); }
+void glfwSetInputMode(GLFWwindow* window, int mode, int value) { RECORD_CALL("glfwSetInputMode"); }
+void glfwSetWindowShouldClose(GLFWwindow* window, int value) { RECORD_CALL("glfwSetWindowShouldClose"); }
+void glfwTerminate(void) { RECORD_CALL("glfwTerminate"); }
+
+GLFWcursorposfun glfwSetCursorPosCallback(GLFWwindow* window, GLFWcursorposfun callback)
+{
+	RECORD_CALL("glfwSetCursorPosCallback");
+	return(NULL);
+}
+
+GLFWframebuffersizefun glfwSetFramebufferSizeCallback(GLFWwindow* window, GLFWframebuffersizefun callback)
+{
+	RECORD_CALL("glfwSetFramebufferSizeCallback");
+	return(NULL);
+}
+
+GLFWmousebuttonfun glfwSetMouseButtonCallback(GLFWwindow* window, GLFWmousebuttonfun callback)
+{
+	RECORD_CALL("glfwSetMouseButtonCallback");
+	return(NULL);
+}
+
+GLFWscrollfun glfwSetScrollCallback(GLFWwindow* window, GLFWscrollfun callback)
+{
+	RECORD_CALL("glfwSetScrollCallback");
+	return(NULL);
+}
@@ -0,0 +1,32 @@
+///////////////////////////////////////////////////////////////////////////////
+// mockgl.h
+// ============
+// stand in for the OpenGL, GLEW and GLFW libraries, recording the calls
+// made by the benchmarked code instead of reaching a driver
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+/***********************************************************
+ *  MockGL
+ *
+ *  The benchmark project links MockGL.cpp in place of the
+ *  opengl32, glew32 and glfw3 libraries.  Every entry point
+ *  the scene code calls is defined there and only counts the
+ *  call, hands out increasing object names and reports
+ *  success, so the CPU side of the scene runs the same on a
+ *  machine without a GPU or a display.  The project defines
+ *  GLEW_STATIC and an empty WINGDIAPI so that the headers
+ *  declare plain functions and variables for the mock to
+ *  define.  The counts are not synchronized, because only
+ *  the benchmark thread calls into the mock.
+ ***********************************************************/
+namespace MockGL
+{
+	// number of calls recorded to all entry points
+	long long GetTotalCalls();
+	// number of calls recorded to the named entry point
+	long long GetCalls(const char* functionName);
+	// print the recorded calls of every entry point that was used
+	void ReportCalls();
+}
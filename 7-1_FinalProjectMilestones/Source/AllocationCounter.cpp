@@ -0,0 +1,218 @@
+///////////////////////////////////////////////////////////////////////////////
+// allocationcounter.cpp
+// ============
+// count the heap allocations made by each thread in debug builds
+///////////////////////////////////////////////////////////////////////////////
+
+#include "AllocationCounter.h"
+
+#include <cstdlib>
+#include <new>
+
+#if defined(_MSC_VER)
+#include <malloc.h>
+#endif
+
+#if defined(_DEBUG)
+
+// declaration of global variables
+namespace
+{
+	// allocations made by the current thread
+	thread_local long long g_ThreadAllocations = 0;
+
+	void* CountedAllocate(size_t bytes)
+	{
+		g_ThreadAllocations++;
+		// every allocation must return a distinct pointer
+		if (bytes == 0)
+		{
+			bytes = 1;
+		}
+		return(malloc(bytes));
+	}
+
+	// allocation for the types aligned past what malloc()
+	// guarantees, such as the cache line aligned nodes
+	void* CountedAllocateAligned(size_t bytes, std::align_val_t alignment)
+	{
+		g_ThreadAllocations++;
+		size_t alignmentBytes = (size_t)alignment;
+		if (bytes == 0)
+		{
+			bytes = 1;
+		}
+#if defined(_MSC_VER)
+		return(_aligned_malloc(bytes, alignmentBytes));
+#else
+		// the size must be a multiple of the alignment
+		bytes = (bytes + alignmentBytes - 1) / alignmentBytes * alignmentBytes;
+		return(aligned_alloc(alignmentBytes, bytes));
+#endif
+	}
+
+	void FreeAligned(void* pMemory)
+	{
+#if defined(_MSC_VER)
+		_aligned_free(pMemory);
+#else
+		free(pMemory);
+#endif
+	}
+}
+
+void* operator new(size_t bytes)
+{
+	void* pMemory = CountedAllocate(bytes);
+	if (NULL == pMemory)
+	{
+		throw std::bad_alloc();
+	}
+	return(pMemory);
+}
+
+void* operator new[](size_t bytes)
+{
+	void* pMemory = CountedAllocate(bytes);
+	if (NULL == pMemory)
+	{
+		throw std::bad_alloc();
+	}
+	return(pMemory);
+}
+
+void* operator new(size_t bytes, const std::nothrow_t&) noexcept
+{
+	return(CountedAllocate(bytes));
+}
+
+void* operator new[](size_t bytes, const std::nothrow_t&) noexcept
+{
+	return(CountedAllocate(bytes));
+}
+
+void operator delete(void* pMemory) noexcept
+{
+	free(pMemory);
+}
+
+void operator delete[](void* pMemory) noexcept
+{
+	free(pMemory);
+}
+
+void operator delete(void* pMemory, size_t) noexcept
+{
+	free(pMemory);
+}
+
+void operator delete[](void* pMemory, size_t) noexcept
+{
+	free(pMemory);
+}
+
+void operator delete(void* pMemory, const std::nothrow_t&) noexcept
+{
+	free(pMemory);
+}
+
+void operator delete[](void* pMemory, const std::nothrow_t&) noexcept
+{
+	free(pMemory);
+}
+
+void* operator new(size_t bytes, std::align_val_t alignment)
+{
+	void* pMemory = CountedAllocateAligned(bytes, alignment);
+	if (NULL == pMemory)
+	{
+		throw std::bad_alloc();
+	}
+	return(pMemory);
+}
+
+void* operator new[](size_t bytes, std::align_val_t alignment)
+{
+	void* pMemory = CountedAllocateAligned(bytes, alignment);
+	if (NULL == pMemory)
+	{
+		throw std::bad_alloc();
+	}
+	return(pMemory);
+}
+
+void* operator new(size_t bytes, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	return(CountedAllocateAligned(bytes, alignment));
+}
+
+void* operator new[](size_t bytes, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	return(CountedAllocateAligned(bytes, alignment));
+}
+
+void operator delete(void* pMemory, std::align_val_t) noexcept
+{
+	FreeAligned(pMemory);
+}
+
+void operator delete[](void* pMemory, std::align_val_t) noexcept
+{
+	FreeAligned(pMemory);
+}
+
+void operator delete(void* pMemory, size_t, std::align_val_t) noexcept
+{
+	FreeAligned(pMemory);
+}
+
+void operator delete[](void* pMemory, size_t, std::align_val_t) noexcept
+{
+	FreeAligned(pMemory);
+}
+
+void operator delete(void* pMemory, std::align_val_t, const std::nothrow_t&) noexcept
+{
+	FreeAligned(pMemory);
+}
+
+void operator delete[](void* pMemory, std::align_val_t, const std::nothrow_t&) noexcept
+{
+	FreeAligned(pMemory);
+}
+
+/***********************************************************
+ *  IsEnabled()
+ *
+ *  This function is used for checking whether the counting
+ *  operators are compiled in.
+ ***********************************************************/
+bool AllocationCounter::IsEnabled()
+{
+	return(true);
+}
+
+/***********************************************************
+ *  GetThreadAllocations()
+ *
+ *  This function is used for getting the number of heap
+ *  allocations the calling thread has made.
+ ***********************************************************/
+long long AllocationCounter::GetThreadAllocations()
+{
+	return(g_ThreadAllocations);
+}
+
+#else
+
+bool AllocationCounter::IsEnabled()
+{
+	return(false);
+}
+
+long long AllocationCounter::GetThreadAllocations()
+{
+	return(0);
+}
+
+#endif
@@ -0,0 +1,26 @@
+///////////////////////////////////////////////////////////////////////////////
+// allocationcounter.h
+// ============
+// count the heap allocations made by each thread in debug builds
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+/***********************************************************
+ *  AllocationCounter
+ *
+ *  In debug builds the global new and delete operators,
+ *  including the ones for over-aligned types, are replaced
+ *  with ones that count every allocation made by the calling
+ *  thread, so that a stretch of code can be checked for heap
+ *  use by comparing the count before and after it.  Release
+ *  builds keep the standard operators and the count stays at
+ *  zero.
+ ***********************************************************/
+namespace AllocationCounter
+{
+	// true when the allocations are being counted
+	bool IsEnabled();
+	// number of allocations made so far by the calling thread
+	long long GetThreadAllocations();
+}
@@ -0,0 +1,184 @@
+///////////////////////////////////////////////////////////////////////////////
+// assetloader.cpp
+// ============
+// read and decode the scene assets on a background thread, and hand them
+// back to the render loop for uploading within a time budget
+///////////////////////////////////////////////////////////////////////////////
+
+#include "AssetLoader.h"
+
+#include <chrono>
+#include <iostream>
+
+/***********************************************************
+ *  AssetLoader()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+AssetLoader::AssetLoader()
+{
+	m_bLoading = false;
+	m_bStopThread = false;
+	m_bInstalling = false;
+	m_queuedCount = 0;
+	m_installedCount = 0;
+
+	m_thread = std::thread(&AssetLoader::LoaderThread, this);
+}
+
+/***********************************************************
+ *  ~AssetLoader()
+ *
+ *  The destructor for the class.  The assets that were not
+ *  started yet are dropped, so closing the window during the
+ *  loading only waits for the asset being loaded.
+ ***********************************************************/
+AssetLoader::~AssetLoader()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_jobMutex);
+		m_pending.clear();
+		m_bStopThread = true;
+	}
+	m_jobReady.notify_all();
+
+	if (m_thread.joinable() == true)
+	{
+		m_thread.join();
+	}
+}
+
+/***********************************************************
+ *  Queue()
+ *
+ *  This method is used for passing an asset to the background
+ *  thread.  The assets are loaded one at a time in the order
+ *  they are queued.
+ ***********************************************************/
+void AssetLoader::Queue(
+	const char* name,
+	const std::function<void()>& load,
+	const std::function<INSTALL_STATUS()>& install)
+{
+	ASSET_JOB job;
+	job.name = name;
+	job.load = load;
+	job.install = install;
+	job.loadMilliseconds = 0.0f;
+	job.installMilliseconds = 0.0f;
+
+	{
+		std::lock_guard<std::mutex> lock(m_jobMutex);
+		m_pending.push_back(job);
+	}
+	m_queuedCount++;
+	m_jobReady.notify_one();
+}
+
+/***********************************************************
+ *  InstallFinished()
+ *
+ *  This method is used for running the install steps of the
+ *  finished assets on the calling thread.  The budget is
+ *  checked after each step, since the time an upload takes
+ *  is not known before it is made.  An asset that is partly
+ *  installed is continued before any other.
+ ***********************************************************/
+int AssetLoader::InstallFinished(double budgetMilliseconds, bool bWait)
+{
+	std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() +
+		std::chrono::microseconds((long long)(budgetMilliseconds * 1000.0));
+
+	int finished = 0;
+	while (true)
+	{
+		if (m_bInstalling == false)
+		{
+			std::unique_lock<std::mutex> lock(m_jobMutex);
+			if ((m_finished.empty() == true) && (bWait == true))
+			{
+				m_jobDone.wait_until(lock, deadline, [this]
+				{
+					return(!m_finished.empty() || (m_pending.empty() && !m_bLoading));
+				});
+			}
+			if (m_finished.empty() == true)
+			{
+				break;
+			}
+			m_installing = std::move(m_finished.front());
+			m_finished.pop_front();
+			m_bInstalling = true;
+		}
+
+		auto start = std::chrono::steady_clock::now();
+		INSTALL_STATUS status = m_installing.install();
+		m_installing.installMilliseconds += std::chrono::duration<float, std::milli>(
+			std::chrono::steady_clock::now() - start).count();
+		if (status != INSTALL_CONTINUE)
+		{
+			if (status == INSTALL_FINISHED)
+			{
+				std::cout << "Swapped in " << m_installing.name << ", loaded in " << m_installing.loadMilliseconds
+					<< " ms and uploaded in " << m_installing.installMilliseconds << " ms" << std::endl;
+				m_installedCount++;
+			}
+			m_installing = ASSET_JOB();
+			m_bInstalling = false;
+			finished++;
+		}
+
+		if (std::chrono::steady_clock::now() >= deadline)
+		{
+			break;
+		}
+	}
+
+	return(finished);
+}
+
+/***********************************************************
+ *  IsBusy()
+ *
+ *  This method is used for checking whether any of the queued
+ *  assets is not installed yet.
+ ***********************************************************/
+bool AssetLoader::IsBusy() const
+{
+	std::lock_guard<std::mutex> lock(m_jobMutex);
+	return((m_pending.empty() == false) || (m_finished.empty() == false) ||
+		(m_bLoading == true) || (m_bInstalling == true));
+}
+
+/***********************************************************
+ *  LoaderThread()
+ *
+ *  This method is run by the background thread.
+ ***********************************************************/
+void AssetLoader::LoaderThread()
+{
+	std::unique_lock<std::mutex> lock(m_jobMutex);
+	while (true)
+	{
+		m_jobReady.wait(lock, [this] { return(!m_pending.empty() || m_bStopThread); });
+		if (m_bStopThread == true)
+		{
+			return;
+		}
+
+		ASSET_JOB job = std::move(m_pending.front());
+		m_pending.pop_front();
+		m_bLoading = true;
+		lock.unlock();
+
+		auto start = std::chrono::steady_clock::now();
+		job.load();
+		job.loadMilliseconds = std::chrono::duration<float, std::milli>(
+			std::chrono::steady_clock::now() - start).count();
+
+		lock.lock();
+		m_finished.push_back(std::move(job));
+		m_bLoading = false;
+		m_jobDone.notify_all();
+	}
+}
@@ -0,0 +1,103 @@
+///////////////////////////////////////////////////////////////////////////////
+// assetloader.h
+// ============
+// read and decode the scene assets on a background thread, and hand them
+// back to the render loop for uploading within a time budget
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/***********************************************************
+ *  AssetLoader
+ *
+ *  This class splits the loading of each asset into a load
+ *  step, which reads and decodes the file on the background
+ *  thread without touching OpenGL, and an install step,
+ *  which uploads the result on the thread that owns the
+ *  context.  The render loop installs the finished assets in
+ *  the order they were queued, stopping once the time budget
+ *  of the frame is spent.  An install step can also upload
+ *  part of its asset and ask to be called again, so a large
+ *  asset is spread over several frames instead of holding up
+ *  the one it lands in.  The two steps of an asset pass their
+ *  data through the state they share.
+ ***********************************************************/
+class AssetLoader
+{
+public:
+	// result of one call of an install step
+	enum INSTALL_STATUS
+	{
+		// the asset is swapped in
+		INSTALL_FINISHED,
+		// the asset could not be loaded, and is left out
+		INSTALL_FAILED,
+		// part of the asset is uploaded, and the step is called
+		// again for the rest
+		INSTALL_CONTINUE
+	};
+
+	// constructor
+	AssetLoader();
+	// destructor, which waits for the asset being loaded
+	~AssetLoader();
+
+	// queue the asset, loading it on the background thread and
+	// installing it from InstallFinished()
+	void Queue(
+		const char* name,
+		const std::function<void()>& load,
+		const std::function<INSTALL_STATUS()>& install);
+	// install the finished assets until the budget is spent,
+	// always making one install step when any has finished - with
+	// bWait true, the call waits up to the budget for more assets
+	// to finish - returning the number that finished
+	int InstallFinished(double budgetMilliseconds, bool bWait);
+	// true while assets are queued, loading or waiting to be installed
+	bool IsBusy() const;
+
+	// number of assets queued, and installed so far without the
+	// ones that could not be loaded
+	int GetQueuedCount() const { return(m_queuedCount); }
+	int GetInstalledCount() const { return(m_installedCount); }
+
+private:
+	struct ASSET_JOB
+	{
+		std::string name;
+		std::function<void()> load;
+		std::function<INSTALL_STATUS()> install;
+		// time taken by the load step, and by the install steps
+		float loadMilliseconds;
+		float installMilliseconds;
+	};
+
+	std::thread m_thread;
+	// assets waiting for the background thread, and the assets it
+	// finished that wait for the render loop
+	std::deque<ASSET_JOB> m_pending;
+	std::deque<ASSET_JOB> m_finished;
+	// true while the background thread runs a load step
+	bool m_bLoading;
+	bool m_bStopThread;
+	// asset whose install step asked to continue, which is only
+	// touched by the render loop
+	ASSET_JOB m_installing;
+	bool m_bInstalling;
+	mutable std::mutex m_jobMutex;
+	std::condition_variable m_jobReady;
+	std::condition_variable m_jobDone;
+
+	int m_queuedCount;
+	int m_installedCount;
+
+	// run the load steps until stopped
+	void LoaderThread();
+};
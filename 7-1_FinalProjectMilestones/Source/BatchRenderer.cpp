@@ -0,0 +1,373 @@
+///////////////////////////////////////////////////////////////////////////////
+// batchrenderer.cpp
+// ============
+// render the loaded scene from a list of camera views into image files,
+// overlapping the rendering, the readback and the PNG encoding
+///////////////////////////////////////////////////////////////////////////////
+
+#include "BatchRenderer.h"
+
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+// declaration of global variables
+namespace
+{
+	// time waited for a readback fence at once
+	const GLuint64 g_FenceWaitNanoseconds = 1000000;
+
+	// skip blank lines and comments in the view file
+	bool IsContentLine(const std::string& line)
+	{
+		size_t start = line.find_first_not_of(" \t\r");
+		return((start != std::string::npos) && (line[start] != '#'));
+	}
+}
+
+/***********************************************************
+ *  BatchRenderer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+BatchRenderer::BatchRenderer(
+	ViewManager* pViewManager,
+	SceneManager* pSceneManager,
+	void (*pRenderFrame)())
+{
+	m_pViewManager = pViewManager;
+	m_pSceneManager = pSceneManager;
+	m_pRenderFrame = pRenderFrame;
+
+	for (int i = 0; i < RING_SIZE; i++)
+	{
+		m_slots[i].bufferSize = 0;
+		m_slots[i].fence = 0;
+		m_slots[i].bPending = false;
+		m_slots[i].view = 0;
+	}
+	m_bStopWriters = false;
+	m_failedImages = 0;
+}
+
+/***********************************************************
+ *  ~BatchRenderer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+BatchRenderer::~BatchRenderer()
+{
+	StopWriters();
+	for (int i = 0; i < RING_SIZE; i++)
+	{
+		if (0 != m_slots[i].fence)
+		{
+			glDeleteSync(m_slots[i].fence);
+		}
+		m_slots[i].pixelBuffer.Reset();
+		m_slots[i].target.Destroy();
+	}
+	m_pViewManager = NULL;
+	m_pSceneManager = NULL;
+	m_pRenderFrame = NULL;
+}
+
+/***********************************************************
+ *  LoadViews()
+ *
+ *  This method is used for reading the camera views.  Each
+ *  line holds the image name, the projection, the camera
+ *  position and front vector and the field of view, as in
+ *  the regression poses, optionally followed by the width
+ *  and height of the image.
+ ***********************************************************/
+bool BatchRenderer::LoadViews(const char* filename, int defaultWidth, int defaultHeight)
+{
+	std::ifstream file(filename);
+	if (!file.is_open())
+	{
+		std::cout << "Could not open the batch views:" << filename << std::endl;
+		return(false);
+	}
+
+	m_views.clear();
+	std::string line;
+	while (std::getline(file, line))
+	{
+		if (IsContentLine(line) == false)
+		{
+			continue;
+		}
+
+		CAMERA_VIEW view;
+		std::string projection;
+		std::istringstream fields(line);
+		fields >> view.name >> projection
+			>> view.position.x >> view.position.y >> view.position.z
+			>> view.front.x >> view.front.y >> view.front.z
+			>> view.zoom;
+		if (fields.fail() || ((projection != "perspective") && (projection != "orthographic")))
+		{
+			std::cout << "Invalid batch view:" << line << std::endl;
+			return(false);
+		}
+		view.bOrthographic = (projection == "orthographic");
+
+		view.width = defaultWidth;
+		view.height = defaultHeight;
+		fields >> view.width >> view.height;
+		if (fields.fail())
+		{
+			view.width = defaultWidth;
+			view.height = defaultHeight;
+		}
+		if ((view.width <= 0) || (view.height <= 0))
+		{
+			std::cout << "Invalid batch image size:" << line << std::endl;
+			return(false);
+		}
+		m_views.push_back(view);
+	}
+
+	return(m_views.empty() == false);
+}
+
+/***********************************************************
+ *  RenderView()
+ *
+ *  This method is used for rendering a view into the target
+ *  of the slot and starting the copy of its pixels into the
+ *  pixel buffer, without waiting for either to finish.
+ ***********************************************************/
+bool BatchRenderer::RenderView(READBACK_SLOT& slot, size_t view)
+{
+	const CAMERA_VIEW& camera = m_views[view];
+	if ((slot.target.GetWidth() != camera.width) || (slot.target.GetHeight() != camera.height))
+	{
+		if (slot.target.Create(camera.width, camera.height) == false)
+		{
+			return(false);
+		}
+	}
+
+	size_t size = (size_t)camera.width * camera.height * 4;
+	if (0 == slot.pixelBuffer.Get())
+	{
+		slot.pixelBuffer.Create("batch readback");
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pixelBuffer.Get());
+	if (slot.bufferSize != size)
+	{
+		glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)size, NULL, GL_STREAM_READ);
+		slot.pixelBuffer.SetBytes(size);
+		slot.bufferSize = size;
+	}
+
+	m_pViewManager->SetAspectRatio((float)camera.width / (float)camera.height);
+	m_pViewManager->SetCameraPose(camera.position, camera.front, camera.zoom, camera.bOrthographic);
+
+	slot.target.Bind();
+	m_pRenderFrame();
+
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, camera.width, camera.height, GL_RGBA, GL_UNSIGNED_BYTE, (void*)0);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	slot.target.Unbind();
+
+	slot.bPending = true;
+	slot.view = view;
+	return(true);
+}
+
+/***********************************************************
+ *  CollectSlot()
+ *
+ *  This method is used for waiting for the readback of the
+ *  slot, copying the pixels out of the mapped buffer and
+ *  handing them to the writers.
+ ***********************************************************/
+void BatchRenderer::CollectSlot(READBACK_SLOT& slot)
+{
+	if (slot.bPending == false)
+	{
+		return;
+	}
+
+	GLenum result = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, g_FenceWaitNanoseconds);
+	while (result == GL_TIMEOUT_EXPIRED)
+	{
+		result = glClientWaitSync(slot.fence, 0, g_FenceWaitNanoseconds);
+	}
+	glDeleteSync(slot.fence);
+	slot.fence = 0;
+	slot.bPending = false;
+
+	const CAMERA_VIEW& camera = m_views[slot.view];
+	WRITE_JOB job;
+	job.filename = m_outputPath + camera.name + ".png";
+	job.image.width = camera.width;
+	job.image.height = camera.height;
+	job.image.channels = 4;
+	job.image.pixels.resize(slot.bufferSize);
+
+	const void* pMapped = NULL;
+	if (result != GL_WAIT_FAILED)
+	{
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pixelBuffer.Get());
+		pMapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr)slot.bufferSize, GL_MAP_READ_BIT);
+		if (NULL != pMapped)
+		{
+			memcpy(job.image.pixels.data(), pMapped, slot.bufferSize);
+			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+		}
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	}
+	if (NULL == pMapped)
+	{
+		std::cout << "Could not read back the batch view:" << camera.name << std::endl;
+		m_failedImages++;
+		return;
+	}
+
+	std::unique_lock<std::mutex> lock(m_jobMutex);
+	m_jobDone.wait(lock, [this] { return((int)m_jobs.size() < MAX_QUEUED_IMAGES); });
+	m_jobs.push_back(std::move(job));
+	m_jobReady.notify_one();
+}
+
+/***********************************************************
+ *  StartWriters()
+ *
+ *  This method is used for starting the writer threads,
+ *  leaving one core for the rendering thread.
+ ***********************************************************/
+void BatchRenderer::StartWriters()
+{
+	int threadCount = std::max((int)std::thread::hardware_concurrency() - 1, 1);
+	m_bStopWriters = false;
+	for (int i = 0; i < threadCount; i++)
+	{
+		m_writers.push_back(std::thread(&BatchRenderer::WriterThread, this));
+	}
+}
+
+/***********************************************************
+ *  StopWriters()
+ *
+ *  This method is used for letting the writer threads finish
+ *  the queued images and waiting for them to exit.
+ ***********************************************************/
+void BatchRenderer::StopWriters()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_jobMutex);
+		m_bStopWriters = true;
+	}
+	m_jobReady.notify_all();
+	for (size_t i = 0; i < m_writers.size(); i++)
+	{
+		m_writers[i].join();
+	}
+	m_writers.clear();
+}
+
+/***********************************************************
+ *  WriterThread()
+ *
+ *  This method is used for flipping and writing the queued
+ *  images until the writers are stopped and the queue is
+ *  empty.
+ ***********************************************************/
+void BatchRenderer::WriterThread()
+{
+	std::unique_lock<std::mutex> lock(m_jobMutex);
+	while (true)
+	{
+		m_jobReady.wait(lock, [this] { return(!m_jobs.empty() || m_bStopWriters); });
+		if (m_jobs.empty() == true)
+		{
+			return;
+		}
+
+		WRITE_JOB job = std::move(m_jobs.front());
+		m_jobs.pop_front();
+		lock.unlock();
+		m_jobDone.notify_all();
+
+		ImageIO::FlipRows(job.image);
+		if (ImageIO::WritePNG(job.filename.c_str(), job.image) == false)
+		{
+			std::cout << "Could not write the batch image:" << job.filename << std::endl;
+			m_failedImages++;
+		}
+
+		lock.lock();
+	}
+}
+
+/***********************************************************
+ *  Run()
+ *
+ *  This method is used for rendering all of the views and
+ *  reporting the throughput.  The images per second count
+ *  everything from the first view to the last file written,
+ *  and the render rate counts the time spent submitting the
+ *  views and collecting their pixels.
+ ***********************************************************/
+int BatchRenderer::Run(const char* viewsFilename, const char* outputDirectory)
+{
+	int defaultWidth = 0;
+	int defaultHeight = 0;
+	m_pViewManager->GetFramebufferSize(defaultWidth, defaultHeight);
+	if (LoadViews(viewsFilename, defaultWidth, defaultHeight) == false)
+	{
+		return(-1);
+	}
+
+	std::error_code error;
+	std::filesystem::create_directories(outputDirectory, error);
+	m_outputPath = std::string(outputDirectory) + "/";
+	m_failedImages = 0;
+
+	StartWriters();
+	double startTime = glfwGetTime();
+	double renderSeconds = 0.0;
+
+	for (size_t i = 0; i < m_views.size(); i++)
+	{
+		// the slot is reused once its previous view has been read
+		double renderStart = glfwGetTime();
+		READBACK_SLOT& slot = m_slots[i % RING_SIZE];
+		CollectSlot(slot);
+		if (RenderView(slot, i) == false)
+		{
+			std::cout << "Could not render the batch view:" << m_views[i].name << std::endl;
+			m_failedImages++;
+		}
+		renderSeconds += glfwGetTime() - renderStart;
+	}
+	for (size_t i = 0; i < RING_SIZE; i++)
+	{
+		CollectSlot(m_slots[(m_views.size() + i) % RING_SIZE]);
+	}
+	StopWriters();
+
+	double totalSeconds = glfwGetTime() - startTime;
+	m_pViewManager->SetAspectRatio(0.0f);
+
+	printf("Rendered %zu views in %.2f s - %.1f images/s, %.1f views/s before writing, %d failed\n",
+		m_views.size(),
+		totalSeconds,
+		(totalSeconds > 0.0) ? m_views.size() / totalSeconds : 0.0,
+		(renderSeconds > 0.0) ? m_views.size() / renderSeconds : 0.0,
+		m_failedImages.load());
+
+	return(m_failedImages.load());
+}
@@ -0,0 +1,111 @@
+///////////////////////////////////////////////////////////////////////////////
+// batchrenderer.h
+// ============
+// render the loaded scene from a list of camera views into image files,
+// overlapping the rendering, the readback and the PNG encoding
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ImageIO.h"
+#include "RenderTarget.h"
+#include "SceneManager.h"
+#include "ViewManager.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/***********************************************************
+ *  BatchRenderer
+ *
+ *  This class renders one image per camera view in a view
+ *  file, reusing the scene that was prepared once for the
+ *  window.  Each view is rendered offscreen and read into a
+ *  pixel buffer object with a fence, and the buffer is only
+ *  mapped when its slot of the ring comes around again, so
+ *  the GPU is already drawing the following views.  The
+ *  images are flipped and written as PNG files by a pool of
+ *  worker threads.
+ ***********************************************************/
+class BatchRenderer
+{
+public:
+	// constructor - the render function draws one complete frame
+	BatchRenderer(
+		ViewManager* pViewManager,
+		SceneManager* pSceneManager,
+		void (*pRenderFrame)());
+	// destructor
+	~BatchRenderer();
+
+	// render every view of the file into the output directory,
+	// returning the number of images that could not be written,
+	// or -1 when the run could not be set up
+	int Run(const char* viewsFilename, const char* outputDirectory);
+
+private:
+	// views rendered before the oldest readback is mapped
+	static const int RING_SIZE = 3;
+	// images waiting for the writers before rendering blocks
+	static const int MAX_QUEUED_IMAGES = 16;
+
+	struct CAMERA_VIEW
+	{
+		std::string name;
+		bool bOrthographic;
+		glm::vec3 position;
+		glm::vec3 front;
+		float zoom;
+		// image size in pixels
+		int width;
+		int height;
+	};
+
+	struct READBACK_SLOT
+	{
+		RenderTarget target;
+		GpuBuffer pixelBuffer;
+		size_t bufferSize;
+		GLsync fence;
+		bool bPending;
+		size_t view;
+	};
+
+	struct WRITE_JOB
+	{
+		std::string filename;
+		IMAGE_DATA image;
+	};
+
+	ViewManager* m_pViewManager;
+	SceneManager* m_pSceneManager;
+	void (*m_pRenderFrame)();
+
+	std::vector<CAMERA_VIEW> m_views;
+	READBACK_SLOT m_slots[RING_SIZE];
+	std::string m_outputPath;
+
+	// writer threads and their queue
+	std::vector<std::thread> m_writers;
+	std::deque<WRITE_JOB> m_jobs;
+	std::mutex m_jobMutex;
+	std::condition_variable m_jobReady;
+	std::condition_variable m_jobDone;
+	bool m_bStopWriters;
+	std::atomic<int> m_failedImages;
+
+	// read the camera views from the text file
+	bool LoadViews(const char* filename, int defaultWidth, int defaultHeight);
+	// render the view into the slot and queue its readback
+	bool RenderView(READBACK_SLOT& slot, size_t view);
+	// wait for the readback of the slot and queue the image
+	void CollectSlot(READBACK_SLOT& slot);
+	void StartWriters();
+	void StopWriters();
+	void WriterThread();
+};
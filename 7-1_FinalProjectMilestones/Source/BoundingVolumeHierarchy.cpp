@@ -0,0 +1,847 @@
+///////////////////////////////////////////////////////////////////////////////
+// boundingvolumehierarchy.cpp
+// ============
+// spatial index over axis aligned bounding boxes for ray casts and
+// overlap queries
+///////////////////////////////////////////////////////////////////////////////
+
+#include "BoundingVolumeHierarchy.h"
+#include "CpuFeatures.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <functional>
+#include <utility>
+
+// declaration of global variables
+namespace
+{
+	// bins per axis for evaluating the split candidates
+	const int g_BinCount = 16;
+	// items kept in a leaf when splitting does not pay off
+	const int g_MaxLeafItems = 4;
+	// deepest level of the tree, which bounds the traversal stack
+	// as every visited node is replaced by up to four children
+	const int g_MaxDepth = 60;
+	const int g_StackSize = 3 * g_MaxDepth + 4;
+	// children of a node in the collapsed tree
+	const int g_NodeWidth = 4;
+
+	float SurfaceArea(const glm::vec3& minimum, const glm::vec3& maximum)
+	{
+		glm::vec3 size = maximum - minimum;
+		if ((size.x < 0.0f) || (size.y < 0.0f) || (size.z < 0.0f))
+		{
+			return(0.0f);
+		}
+		return(2.0f * (size.x * size.y + size.y * size.z + size.z * size.x));
+	}
+
+	// slab test of the ray against the box, returning the entry
+	// distance or FLT_MAX when the box is missed
+	float IntersectBox(
+		const glm::vec3& minimum,
+		const glm::vec3& maximum,
+		const glm::vec3& origin,
+		const glm::vec3& inverseDirection,
+		float maxDistance)
+	{
+		float tx1 = (minimum.x - origin.x) * inverseDirection.x;
+		float tx2 = (maximum.x - origin.x) * inverseDirection.x;
+		float tNear = std::min(tx1, tx2);
+		float tFar = std::max(tx1, tx2);
+		float ty1 = (minimum.y - origin.y) * inverseDirection.y;
+		float ty2 = (maximum.y - origin.y) * inverseDirection.y;
+		tNear = std::max(tNear, std::min(ty1, ty2));
+		tFar = std::min(tFar, std::max(ty1, ty2));
+		float tz1 = (minimum.z - origin.z) * inverseDirection.z;
+		float tz2 = (maximum.z - origin.z) * inverseDirection.z;
+		tNear = std::max(tNear, std::min(tz1, tz2));
+		tFar = std::min(tFar, std::max(tz1, tz2));
+
+		if ((tFar >= tNear) && (tFar >= 0.0f) && (tNear < maxDistance))
+		{
+			return(std::max(tNear, 0.0f));
+		}
+		return(FLT_MAX);
+	}
+
+	// slab test of the ray against the four boxes of a node, with
+	// the rows of the near and far planes picked by the signs of
+	// the direction, returning a mask of the boxes that are hit
+	// and their entry distances
+	int IntersectSlots(
+		const float bounds[6][4],
+		const int nearRow[3],
+		const int farRow[3],
+		const glm::vec3& origin,
+		const glm::vec3& inverseDirection,
+		float maxDistance,
+		float distances[4])
+	{
+#ifdef CPU_FEATURES_SSE2
+		__m128 tNear = _mm_setzero_ps();
+		__m128 tFar = _mm_set1_ps(FLT_MAX);
+		for (int axis = 0; axis < 3; axis++)
+		{
+			__m128 start = _mm_set1_ps(origin[axis]);
+			__m128 scale = _mm_set1_ps(inverseDirection[axis]);
+			tNear = _mm_max_ps(tNear, _mm_mul_ps(_mm_sub_ps(_mm_load_ps(bounds[nearRow[axis]]), start), scale));
+			tFar = _mm_min_ps(tFar, _mm_mul_ps(_mm_sub_ps(_mm_load_ps(bounds[farRow[axis]]), start), scale));
+		}
+		__m128 hit = _mm_and_ps(_mm_cmple_ps(tNear, tFar), _mm_cmplt_ps(tNear, _mm_set1_ps(maxDistance)));
+		_mm_storeu_ps(distances, tNear);
+		return(_mm_movemask_ps(hit));
+#else
+		int mask = 0;
+		for (int slot = 0; slot < 4; slot++)
+		{
+			float tNear = 0.0f;
+			float tFar = FLT_MAX;
+			for (int axis = 0; axis < 3; axis++)
+			{
+				tNear = std::max(tNear, (bounds[nearRow[axis]][slot] - origin[axis]) * inverseDirection[axis]);
+				tFar = std::min(tFar, (bounds[farRow[axis]][slot] - origin[axis]) * inverseDirection[axis]);
+			}
+			distances[slot] = tNear;
+			if ((tNear <= tFar) && (tNear < maxDistance))
+			{
+				mask |= 1 << slot;
+			}
+		}
+		return(mask);
+#endif
+	}
+
+	// overlap test of the box against the four boxes of a node,
+	// returning a mask of the boxes that overlap
+	int OverlapSlots(
+		const float bounds[6][4],
+		const glm::vec3& minimum,
+		const glm::vec3& maximum)
+	{
+#ifdef CPU_FEATURES_SSE2
+		__m128 overlap = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for (int axis = 0; axis < 3; axis++)
+		{
+			overlap = _mm_and_ps(overlap, _mm_cmple_ps(_mm_load_ps(bounds[axis]), _mm_set1_ps(maximum[axis])));
+			overlap = _mm_and_ps(overlap, _mm_cmpge_ps(_mm_load_ps(bounds[axis + 3]), _mm_set1_ps(minimum[axis])));
+		}
+		return(_mm_movemask_ps(overlap));
+#else
+		int mask = 0;
+		for (int slot = 0; slot < 4; slot++)
+		{
+			if ((bounds[0][slot] <= maximum.x) && (bounds[3][slot] >= minimum.x) &&
+				(bounds[1][slot] <= maximum.y) && (bounds[4][slot] >= minimum.y) &&
+				(bounds[2][slot] <= maximum.z) && (bounds[5][slot] >= minimum.z))
+			{
+				mask |= 1 << slot;
+			}
+		}
+		return(mask);
+#endif
+	}
+
+	// start loading both cache lines of a node that is visited
+	// soon, while the other children are tested
+	void PrefetchNode(const void* pNode)
+	{
+#ifdef CPU_FEATURES_SSE2
+		_mm_prefetch((const char*)pNode, _MM_HINT_T0);
+		_mm_prefetch((const char*)pNode + 64, _MM_HINT_T0);
+#endif
+	}
+
+	bool BoxesOverlap(
+		const glm::vec3& minimumA,
+		const glm::vec3& maximumA,
+		const glm::vec3& minimumB,
+		const glm::vec3& maximumB)
+	{
+		return((minimumA.x <= maximumB.x) && (maximumA.x >= minimumB.x) &&
+			(minimumA.y <= maximumB.y) && (maximumA.y >= minimumB.y) &&
+			(minimumA.z <= maximumB.z) && (maximumA.z >= minimumB.z));
+	}
+}
+
+/***********************************************************
+ *  BoundingVolumeHierarchy()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+BoundingVolumeHierarchy::BoundingVolumeHierarchy()
+{
+	m_builtArea = 0.0;
+	m_refitArea = 0.0;
+}
+
+/***********************************************************
+ *  Build()
+ *
+ *  This method is used for building the tree over the item
+ *  bounds.  Nodes are split top down until splitting costs
+ *  more than the leaf by the surface area heuristic, and the
+ *  binary tree is then collapsed for the queries.
+ ***********************************************************/
+void BoundingVolumeHierarchy::Build(const std::vector<BOUNDS>& bounds)
+{
+	m_itemBounds = bounds;
+	m_itemOrder.resize(bounds.size());
+	m_buildNodes.clear();
+	m_nodes.clear();
+	m_orderedBounds.clear();
+	m_itemSlots.clear();
+	m_nodeParents.clear();
+	m_leafNodes.clear();
+	m_dirtyNodes.clear();
+	m_nodeDirty.clear();
+	m_builtArea = 0.0;
+	m_refitArea = 0.0;
+
+	if (bounds.empty() == true)
+	{
+		return;
+	}
+
+	std::vector<glm::vec3> centroids(bounds.size());
+	for (size_t i = 0; i < bounds.size(); i++)
+	{
+		m_itemOrder[i] = (int)i;
+		centroids[i] = (bounds[i].minimum + bounds[i].maximum) * 0.5f;
+	}
+
+	// a binary tree over the items has at most 2N - 1 nodes
+	m_buildNodes.reserve(bounds.size() * 2);
+
+	BVH_NODE root;
+	root.leftFirst = 0;
+	root.count = (int)bounds.size();
+	UpdateLeafBounds(root);
+	m_buildNodes.push_back(root);
+
+	// split the nodes depth first without recursion
+	std::vector<std::pair<int, int>> pending;
+	pending.push_back(std::make_pair(0, 0));
+	while (pending.empty() == false)
+	{
+		int nodeIndex = pending.back().first;
+		int depth = pending.back().second;
+		pending.pop_back();
+
+		if (depth >= g_MaxDepth)
+		{
+			continue;
+		}
+
+		Subdivide(nodeIndex, centroids);
+		if (m_buildNodes[nodeIndex].count == 0)
+		{
+			int left = m_buildNodes[nodeIndex].leftFirst;
+			pending.push_back(std::make_pair(left, depth + 1));
+			pending.push_back(std::make_pair(left + 1, depth + 1));
+		}
+	}
+
+	m_orderedBounds.resize(bounds.size());
+	m_itemSlots.resize(bounds.size());
+	for (size_t i = 0; i < bounds.size(); i++)
+	{
+		m_orderedBounds[i] = bounds[m_itemOrder[i]];
+		m_itemSlots[m_itemOrder[i]] = (int)i;
+	}
+
+	CollapseNodes();
+	std::vector<BVH_NODE>().swap(m_buildNodes);
+	m_nodeDirty.assign(m_nodes.size(), 0);
+
+	for (size_t i = 0; i < m_nodes.size(); i++)
+	{
+		for (int slot = 0; slot < g_NodeWidth; slot++)
+		{
+			m_builtArea += GetSlotArea(m_nodes[i], slot);
+		}
+	}
+	m_refitArea = m_builtArea;
+}
+
+/***********************************************************
+ *  CollapseNodes()
+ *
+ *  This method is used for turning the binary tree into the
+ *  tree that is queried.  Starting from the two children of
+ *  a node, the child node with the largest surface area is
+ *  replaced by its own children until there are four, which
+ *  keeps the boxes that are hit most often closest to the
+ *  root.  The nodes are added after their parents, which are
+ *  remembered for the refits along with the leaf of each item.
+ ***********************************************************/
+void BoundingVolumeHierarchy::CollapseNodes()
+{
+	m_nodes.reserve(m_buildNodes.size() / 2 + 1);
+	m_nodes.push_back(WIDE_NODE());
+	m_nodeParents.reserve(m_nodes.capacity());
+	m_nodeParents.push_back(-1);
+	m_leafNodes.resize(m_itemOrder.size());
+
+	std::vector<std::pair<int, int>> pending;
+	pending.push_back(std::make_pair(0, 0));
+	while (pending.empty() == false)
+	{
+		int buildIndex = pending.back().first;
+		int nodeIndex = pending.back().second;
+		pending.pop_back();
+
+		int children[g_NodeWidth];
+		int childCount = 0;
+		const BVH_NODE& buildNode = m_buildNodes[buildIndex];
+		if (buildNode.count > 0)
+		{
+			// only a root with few items is a leaf
+			children[childCount++] = buildIndex;
+		}
+		else
+		{
+			children[childCount++] = buildNode.leftFirst;
+			children[childCount++] = buildNode.leftFirst + 1;
+		}
+
+		while (childCount < g_NodeWidth)
+		{
+			int largest = -1;
+			float largestArea = -1.0f;
+			for (int i = 0; i < childCount; i++)
+			{
+				const BVH_NODE& child = m_buildNodes[children[i]];
+				float area = SurfaceArea(child.minimum, child.maximum);
+				if ((child.count == 0) && (area > largestArea))
+				{
+					largest = i;
+					largestArea = area;
+				}
+			}
+			if (largest < 0)
+			{
+				break;
+			}
+			int left = m_buildNodes[children[largest]].leftFirst;
+			children[largest] = left;
+			children[childCount++] = left + 1;
+		}
+
+		WIDE_NODE node;
+		for (int slot = 0; slot < g_NodeWidth; slot++)
+		{
+			if (slot >= childCount)
+			{
+				SetSlotBounds(node, slot, glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX));
+				node.child[slot] = 0;
+				node.count[slot] = -1;
+				continue;
+			}
+
+			const BVH_NODE& child = m_buildNodes[children[slot]];
+			SetSlotBounds(node, slot, child.minimum, child.maximum);
+			if (child.count > 0)
+			{
+				node.child[slot] = child.leftFirst;
+				node.count[slot] = child.count;
+				for (int i = 0; i < child.count; i++)
+				{
+					m_leafNodes[child.leftFirst + i] = nodeIndex;
+				}
+			}
+			else
+			{
+				node.child[slot] = (int)m_nodes.size();
+				node.count[slot] = 0;
+				pending.push_back(std::make_pair(children[slot], (int)m_nodes.size()));
+				m_nodes.push_back(WIDE_NODE());
+				m_nodeParents.push_back(nodeIndex);
+			}
+		}
+		m_nodes[nodeIndex] = node;
+	}
+}
+
+/***********************************************************
+ *  SetSlotBounds()
+ *
+ *  This method is used for storing the bounds of a child in
+ *  the rows of its node.
+ ***********************************************************/
+void BoundingVolumeHierarchy::SetSlotBounds(
+	WIDE_NODE& node,
+	int slot,
+	const glm::vec3& minimum,
+	const glm::vec3& maximum)
+{
+	for (int axis = 0; axis < 3; axis++)
+	{
+		node.bounds[axis][slot] = minimum[axis];
+		node.bounds[axis + 3][slot] = maximum[axis];
+	}
+}
+
+/***********************************************************
+ *  GetSlotArea()
+ *
+ *  This method is used for getting the surface area of the
+ *  bounds of a child, which is zero for an unused slot.
+ ***********************************************************/
+float BoundingVolumeHierarchy::GetSlotArea(const WIDE_NODE& node, int slot)
+{
+	glm::vec3 minimum(node.bounds[0][slot], node.bounds[1][slot], node.bounds[2][slot]);
+	glm::vec3 maximum(node.bounds[3][slot], node.bounds[4][slot], node.bounds[5][slot]);
+	return(SurfaceArea(minimum, maximum));
+}
+
+/***********************************************************
+ *  UpdateLeafBounds()
+ *
+ *  This method is used for setting the bounds of the node
+ *  to enclose all of its items.
+ ***********************************************************/
+void BoundingVolumeHierarchy::UpdateLeafBounds(BVH_NODE& node) const
+{
+	node.minimum = glm::vec3(FLT_MAX);
+	node.maximum = glm::vec3(-FLT_MAX);
+	for (int i = 0; i < node.count; i++)
+	{
+		const BOUNDS& item = m_itemBounds[m_itemOrder[node.leftFirst + i]];
+		node.minimum = glm::min(node.minimum, item.minimum);
+		node.maximum = glm::max(node.maximum, item.maximum);
+	}
+}
+
+/***********************************************************
+ *  Subdivide()
+ *
+ *  This method is used for splitting a leaf in two.  The item
+ *  centroids are sorted into bins along each axis, and the
+ *  split between bins with the lowest surface area cost is
+ *  used.  The node stays a leaf when no split is cheaper.
+ ***********************************************************/
+void BoundingVolumeHierarchy::Subdivide(int nodeIndex, const std::vector<glm::vec3>& centroids)
+{
+	BVH_NODE node = m_buildNodes[nodeIndex];
+	if (node.count <= 1)
+	{
+		return;
+	}
+
+	glm::vec3 centroidMin(FLT_MAX);
+	glm::vec3 centroidMax(-FLT_MAX);
+	for (int i = 0; i < node.count; i++)
+	{
+		const glm::vec3& centroid = centroids[m_itemOrder[node.leftFirst + i]];
+		centroidMin = glm::min(centroidMin, centroid);
+		centroidMax = glm::max(centroidMax, centroid);
+	}
+
+	int bestAxis = -1;
+	int bestSplit = 0;
+	float bestCost = FLT_MAX;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		float extent = centroidMax[axis] - centroidMin[axis];
+		if (extent <= 0.0f)
+		{
+			continue;
+		}
+
+		int binCounts[g_BinCount] = { 0 };
+		glm::vec3 binMin[g_BinCount];
+		glm::vec3 binMax[g_BinCount];
+		for (int bin = 0; bin < g_BinCount; bin++)
+		{
+			binMin[bin] = glm::vec3(FLT_MAX);
+			binMax[bin] = glm::vec3(-FLT_MAX);
+		}
+
+		float scale = g_BinCount / extent;
+		for (int i = 0; i < node.count; i++)
+		{
+			int item = m_itemOrder[node.leftFirst + i];
+			int bin = std::min(g_BinCount - 1, (int)((centroids[item][axis] - centroidMin[axis]) * scale));
+			binCounts[bin]++;
+			binMin[bin] = glm::min(binMin[bin], m_itemBounds[item].minimum);
+			binMax[bin] = glm::max(binMax[bin], m_itemBounds[item].maximum);
+		}
+
+		// sweep from both sides to get the cost of every split
+		float leftArea[g_BinCount - 1];
+		int leftCount[g_BinCount - 1];
+		glm::vec3 sweepMin(FLT_MAX);
+		glm::vec3 sweepMax(-FLT_MAX);
+		int sweepCount = 0;
+		for (int split = 0; split < g_BinCount - 1; split++)
+		{
+			sweepCount += binCounts[split];
+			sweepMin = glm::min(sweepMin, binMin[split]);
+			sweepMax = glm::max(sweepMax, binMax[split]);
+			leftCount[split] = sweepCount;
+			leftArea[split] = SurfaceArea(sweepMin, sweepMax);
+		}
+
+		sweepMin = glm::vec3(FLT_MAX);
+		sweepMax = glm::vec3(-FLT_MAX);
+		sweepCount = 0;
+		for (int split = g_BinCount - 2; split >= 0; split--)
+		{
+			sweepCount += binCounts[split + 1];
+			sweepMin = glm::min(sweepMin, binMin[split + 1]);
+			sweepMax = glm::max(sweepMax, binMax[split + 1]);
+			if ((leftCount[split] == 0) || (sweepCount == 0))
+			{
+				continue;
+			}
+
+			float cost = leftCount[split] * leftArea[split] + sweepCount * SurfaceArea(sweepMin, sweepMax);
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestAxis = axis;
+				bestSplit = split;
+			}
+		}
+	}
+
+	// compare with the cost of intersecting all of the items,
+	// splitting large leaves even when the heuristic disagrees
+	float leafCost = node.count * SurfaceArea(node.minimum, node.maximum);
+	if ((bestAxis < 0) || ((bestCost >= leafCost) && (node.count <= g_MaxLeafItems)))
+	{
+		return;
+	}
+
+	// partition the items of the node around the split
+	float scale = g_BinCount / (centroidMax[bestAxis] - centroidMin[bestAxis]);
+	int first = node.leftFirst;
+	int last = node.leftFirst + node.count - 1;
+	while (first <= last)
+	{
+		const glm::vec3& centroid = centroids[m_itemOrder[first]];
+		int bin = std::min(g_BinCount - 1, (int)((centroid[bestAxis] - centroidMin[bestAxis]) * scale));
+		if (bin <= bestSplit)
+		{
+			first++;
+		}
+		else
+		{
+			std::swap(m_itemOrder[first], m_itemOrder[last]);
+			last--;
+		}
+	}
+
+	int leftItems = first - node.leftFirst;
+	if ((leftItems == 0) || (leftItems == node.count))
+	{
+		return;
+	}
+
+	BVH_NODE left;
+	left.leftFirst = node.leftFirst;
+	left.count = leftItems;
+	UpdateLeafBounds(left);
+
+	BVH_NODE right;
+	right.leftFirst = first;
+	right.count = node.count - leftItems;
+	UpdateLeafBounds(right);
+
+	int leftIndex = (int)m_buildNodes.size();
+	m_buildNodes.push_back(left);
+	m_buildNodes.push_back(right);
+
+	m_buildNodes[nodeIndex].leftFirst = leftIndex;
+	m_buildNodes[nodeIndex].count = 0;
+}
+
+/***********************************************************
+ *  UpdateItem()
+ *
+ *  This method is used for changing the bounds of a moved
+ *  item.  The nodes above it are marked up to the first one
+ *  that is marked already, and keep their bounds until
+ *  Refit() is called, so a query before then could miss the
+ *  item.
+ ***********************************************************/
+void BoundingVolumeHierarchy::UpdateItem(int item, const BOUNDS& bounds)
+{
+	if ((item < 0) || (item >= (int)m_itemBounds.size()))
+	{
+		return;
+	}
+	m_itemBounds[item] = bounds;
+	m_orderedBounds[m_itemSlots[item]] = bounds;
+
+	int nodeIndex = m_leafNodes[m_itemSlots[item]];
+	while ((nodeIndex >= 0) && (m_nodeDirty[nodeIndex] == 0))
+	{
+		m_nodeDirty[nodeIndex] = 1;
+		m_dirtyNodes.push_back(nodeIndex);
+		nodeIndex = m_nodeParents[nodeIndex];
+	}
+}
+
+/***********************************************************
+ *  Refit()
+ *
+ *  This method is used for recalculating the bounds of the
+ *  marked nodes from the item bounds, keeping the structure
+ *  of the tree.  Children are always stored after their
+ *  parents, so going through the marked nodes in reverse
+ *  order updates each one after the children below it.
+ ***********************************************************/
+void BoundingVolumeHierarchy::Refit()
+{
+	std::sort(m_dirtyNodes.begin(), m_dirtyNodes.end(), std::greater<int>());
+	for (size_t i = 0; i < m_dirtyNodes.size(); i++)
+	{
+		RefitNode(m_dirtyNodes[i]);
+		m_nodeDirty[m_dirtyNodes[i]] = 0;
+	}
+	m_dirtyNodes.clear();
+}
+
+/***********************************************************
+ *  GetRefitInflation()
+ *
+ *  This method is used for comparing the total surface area
+ *  of the nodes with the area they had when the tree was
+ *  built, which tracks the expected cost of a query.
+ ***********************************************************/
+float BoundingVolumeHierarchy::GetRefitInflation() const
+{
+	if (m_builtArea <= 0.0)
+	{
+		return(1.0f);
+	}
+	return((float)(m_refitArea / m_builtArea));
+}
+
+/***********************************************************
+ *  RefitNode()
+ *
+ *  This method is used for recalculating the bounds of the
+ *  children of the node from their items, or from the bounds
+ *  stored in the child nodes.
+ ***********************************************************/
+void BoundingVolumeHierarchy::RefitNode(int nodeIndex)
+{
+	WIDE_NODE& node = m_nodes[nodeIndex];
+	for (int slot = 0; slot < g_NodeWidth; slot++)
+	{
+		if (node.count[slot] < 0)
+		{
+			continue;
+		}
+
+		glm::vec3 minimum(FLT_MAX);
+		glm::vec3 maximum(-FLT_MAX);
+		if (node.count[slot] > 0)
+		{
+			for (int item = 0; item < node.count[slot]; item++)
+			{
+				const BOUNDS& bounds = m_orderedBounds[node.child[slot] + item];
+				minimum = glm::min(minimum, bounds.minimum);
+				maximum = glm::max(maximum, bounds.maximum);
+			}
+		}
+		else
+		{
+			const WIDE_NODE& child = m_nodes[node.child[slot]];
+			for (int childSlot = 0; childSlot < g_NodeWidth; childSlot++)
+			{
+				for (int axis = 0; axis < 3; axis++)
+				{
+					minimum[axis] = std::min(minimum[axis], child.bounds[axis][childSlot]);
+					maximum[axis] = std::max(maximum[axis], child.bounds[axis + 3][childSlot]);
+				}
+			}
+		}
+		m_refitArea -= GetSlotArea(node, slot);
+		SetSlotBounds(node, slot, minimum, maximum);
+		m_refitArea += GetSlotArea(node, slot);
+	}
+}
+
+/***********************************************************
+ *  RayCast()
+ *
+ *  This method is used for finding the nearest item along
+ *  the ray.  The four children of a node are tested at once,
+ *  taking the near and far plane of each axis from the sign
+ *  of the direction instead of sorting the distances of every
+ *  box.  The leaves that are hit are tested right away, and
+ *  the child nodes are visited nearest first, skipping the
+ *  ones farther than the closest hit so far.  When a test
+ *  function is passed, the items whose bounds are hit are
+ *  tested exactly with it.
+ ***********************************************************/
+bool BoundingVolumeHierarchy::RayCast(
+	const glm::vec3& origin,
+	const glm::vec3& direction,
+	float maxDistance,
+	RAY_HIT& hit,
+	RAY_TEST_FUNCTION pTestFunction,
+	void* pContext) const
+{
+	hit.item = -1;
+	hit.distance = maxDistance;
+
+	if (m_nodes.empty() == true)
+	{
+		return(false);
+	}
+
+	glm::vec3 inverseDirection;
+	int nearRow[3];
+	int farRow[3];
+	for (int axis = 0; axis < 3; axis++)
+	{
+		inverseDirection[axis] = (direction[axis] != 0.0f) ? 1.0f / direction[axis] :
+			((direction[axis] < 0.0f) ? -FLT_MAX : FLT_MAX);
+		nearRow[axis] = (inverseDirection[axis] < 0.0f) ? axis + 3 : axis;
+		farRow[axis] = (inverseDirection[axis] < 0.0f) ? axis : axis + 3;
+	}
+
+	int stackNodes[g_StackSize];
+	float stackDistances[g_StackSize];
+	int stackSize = 0;
+	stackNodes[stackSize] = 0;
+	stackDistances[stackSize] = 0.0f;
+	stackSize++;
+
+	while (stackSize > 0)
+	{
+		stackSize--;
+		if (stackDistances[stackSize] >= hit.distance)
+		{
+			continue;
+		}
+		const WIDE_NODE& node = m_nodes[stackNodes[stackSize]];
+
+		float distances[g_NodeWidth];
+		int mask = IntersectSlots(node.bounds, nearRow, farRow, origin, inverseDirection, hit.distance, distances);
+		int children[g_NodeWidth];
+		int childCount = 0;
+		for (int slot = 0; slot < g_NodeWidth; slot++)
+		{
+			if ((mask & (1 << slot)) == 0)
+			{
+				continue;
+			}
+			if (node.count[slot] == 0)
+			{
+				PrefetchNode(&m_nodes[node.child[slot]]);
+				children[childCount++] = slot;
+				continue;
+			}
+
+			// the bounds of a leaf with one item are the bounds of
+			// the item, which were just tested
+			for (int i = 0; i < node.count[slot]; i++)
+			{
+				float distance = distances[slot];
+				if (node.count[slot] > 1)
+				{
+					const BOUNDS& bounds = m_orderedBounds[node.child[slot] + i];
+					distance = IntersectBox(bounds.minimum, bounds.maximum, origin, inverseDirection, hit.distance);
+				}
+				if (distance >= hit.distance)
+				{
+					continue;
+				}
+				int item = m_itemOrder[node.child[slot] + i];
+				if ((NULL != pTestFunction) &&
+					((pTestFunction(pContext, item, origin, direction, distance) == false) ||
+					(distance >= hit.distance)))
+				{
+					continue;
+				}
+				hit.item = item;
+				hit.distance = distance;
+			}
+		}
+
+		// push the farthest child first so the nearest is visited first
+		for (int i = 1; i < childCount; i++)
+		{
+			for (int j = i; (j > 0) && (distances[children[j - 1]] < distances[children[j]]); j--)
+			{
+				std::swap(children[j - 1], children[j]);
+			}
+		}
+		for (int i = 0; i < childCount; i++)
+		{
+			int slot = children[i];
+			if ((distances[slot] < hit.distance) && (stackSize < g_StackSize))
+			{
+				stackNodes[stackSize] = node.child[slot];
+				stackDistances[stackSize] = distances[slot];
+				stackSize++;
+			}
+		}
+	}
+
+	return(hit.item >= 0);
+}
+
+/***********************************************************
+ *  QueryOverlap()
+ *
+ *  This method is used for collecting all of the items whose
+ *  bounds overlap the passed in box, testing the four
+ *  children of a node at once.
+ ***********************************************************/
+void BoundingVolumeHierarchy::QueryOverlap(const BOUNDS& box, std::vector<int>& items) const
+{
+	items.clear();
+	if (m_nodes.empty() == true)
+	{
+		return;
+	}
+
+	int stack[g_StackSize];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+
+	while (stackSize > 0)
+	{
+		const WIDE_NODE& node = m_nodes[stack[--stackSize]];
+
+		int mask = OverlapSlots(node.bounds, box.minimum, box.maximum);
+		for (int slot = 0; slot < g_NodeWidth; slot++)
+		{
+			if ((mask & (1 << slot)) == 0)
+			{
+				continue;
+			}
+			if (node.count[slot] == 0)
+			{
+				if (stackSize < g_StackSize)
+				{
+					PrefetchNode(&m_nodes[node.child[slot]]);
+					stack[stackSize++] = node.child[slot];
+				}
+				continue;
+			}
+
+			if (node.count[slot] == 1)
+			{
+				items.push_back(m_itemOrder[node.child[slot]]);
+				continue;
+			}
+			for (int i = 0; i < node.count[slot]; i++)
+			{
+				const BOUNDS& bounds = m_orderedBounds[node.child[slot] + i];
+				if (BoxesOverlap(bounds.minimum, bounds.maximum, box.minimum, box.maximum))
+				{
+					items.push_back(m_itemOrder[node.child[slot] + i]);
+				}
+			}
+		}
+	}
+}
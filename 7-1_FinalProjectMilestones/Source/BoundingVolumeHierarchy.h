@@ -0,0 +1,149 @@
+///////////////////////////////////////////////////////////////////////////////
+// boundingvolumehierarchy.h
+// ============
+// spatial index over axis aligned bounding boxes for ray casts and
+// overlap queries
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  BoundingVolumeHierarchy
+ *
+ *  This class contains a tree of bounding boxes over a set
+ *  of items, each identified by its index in the list of
+ *  bounds it was built from.  The tree is built as a binary
+ *  tree with the surface area heuristic, and then collapsed
+ *  into nodes of four children whose bounds are stored per
+ *  axis, so a query tests the four boxes in one pass and
+ *  visits about half as many nodes.  The item bounds are kept
+ *  in the order of the leaves as well.  When items move, the
+ *  nodes above them are marked, and Refit() recalculates only
+ *  the marked nodes without rebuilding the tree.  The queries
+ *  are const, so Refit() is called after the items are
+ *  updated and before the tree is queried again.  Refitting
+ *  lets the boxes grow past what a new build would give, which
+ *  GetRefitInflation() reports so the tree can be rebuilt once
+ *  the queries slow down.
+ ***********************************************************/
+class BoundingVolumeHierarchy
+{
+public:
+	// constructor
+	BoundingVolumeHierarchy();
+
+	struct BOUNDS
+	{
+		glm::vec3 minimum;
+		glm::vec3 maximum;
+	};
+
+	struct RAY_HIT
+	{
+		// index of the item that was hit, or -1
+		int item;
+		// distance along the ray in multiples of its direction
+		float distance;
+	};
+
+	// optional exact test of a ray against an item, called for
+	// the items whose bounds are hit - returns true and sets the
+	// distance when the item itself is hit
+	typedef bool (*RAY_TEST_FUNCTION)(
+		void* pContext,
+		int item,
+		const glm::vec3& origin,
+		const glm::vec3& direction,
+		float& distance);
+
+	// build the tree over the passed in item bounds
+	void Build(const std::vector<BOUNDS>& bounds);
+	// change the bounds of an item, which the queries only see
+	// after Refit()
+	void UpdateItem(int item, const BOUNDS& bounds);
+	// recalculate the bounds of the nodes above the updated items
+	void Refit();
+	// total surface area of the nodes relative to the last build,
+	// which grows as the items are refit away from where they were
+	float GetRefitInflation() const;
+
+	// find the nearest item hit by the ray within the distance
+	bool RayCast(
+		const glm::vec3& origin,
+		const glm::vec3& direction,
+		float maxDistance,
+		RAY_HIT& hit,
+		RAY_TEST_FUNCTION pTestFunction = NULL,
+		void* pContext = NULL) const;
+	// collect the items whose bounds overlap the box
+	void QueryOverlap(const BOUNDS& box, std::vector<int>& items) const;
+
+	int GetItemCount() const { return((int)m_itemBounds.size()); }
+	const BOUNDS& GetItemBounds(int item) const { return(m_itemBounds[item]); }
+
+private:
+	// 32 byte node of the binary tree while it is built - inner
+	// nodes store the index of their first child with the second
+	// right after it, and leaves store the first of their items
+	// in the item order
+	struct BVH_NODE
+	{
+		glm::vec3 minimum;
+		int leftFirst;
+		glm::vec3 maximum;
+		int count;
+	};
+
+	// 128 byte node of the collapsed tree, with the bounds of its
+	// four children stored per axis - children after the parent
+	struct alignas(64) WIDE_NODE
+	{
+		// minimum x, y and z followed by maximum x, y and z
+		float bounds[6][4];
+		// index of the child node, or of the first item of a leaf
+		// in the item order
+		int child[4];
+		// items of a leaf child, 0 for a child node and -1 for an
+		// unused slot, whose bounds are empty
+		int count[4];
+	};
+
+	std::vector<BVH_NODE> m_buildNodes;
+	std::vector<WIDE_NODE> m_nodes;
+	std::vector<BOUNDS> m_itemBounds;
+	// item indices ordered so each leaf holds a contiguous range,
+	// with the bounds in the same order and the position of each
+	// item in it
+	std::vector<int> m_itemOrder;
+	std::vector<BOUNDS> m_orderedBounds;
+	std::vector<int> m_itemSlots;
+	// parent of each node, -1 for the root, and the node holding
+	// each item in the item order
+	std::vector<int> m_nodeParents;
+	std::vector<int> m_leafNodes;
+	// nodes whose bounds are out of date, and whether each is in
+	// the list already
+	std::vector<int> m_dirtyNodes;
+	std::vector<unsigned char> m_nodeDirty;
+	// total surface area of the node children at the last build,
+	// and as refit since
+	double m_builtArea;
+	double m_refitArea;
+
+	// split the node with the binned surface area heuristic
+	void Subdivide(int nodeIndex, const std::vector<glm::vec3>& centroids);
+	// set the node bounds from its items
+	void UpdateLeafBounds(BVH_NODE& node) const;
+	// collapse the binary tree into the tree of four children
+	void CollapseNodes();
+	// set the bounds of a slot of the node
+	static void SetSlotBounds(WIDE_NODE& node, int slot, const glm::vec3& minimum, const glm::vec3& maximum);
+	// surface area of the bounds of a slot of the node
+	static float GetSlotArea(const WIDE_NODE& node, int slot);
+	// recalculate the bounds of the four children of the node
+	void RefitNode(int nodeIndex);
+};
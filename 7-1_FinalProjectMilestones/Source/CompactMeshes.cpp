@@ -0,0 +1,476 @@
+///////////////////////////////////////////////////////////////////////////////
+// compactmeshes.cpp
+// ============
+// build the basic shape meshes with quantized vertex attributes that are
+// decoded in the vertex shader
+///////////////////////////////////////////////////////////////////////////////
+
+#include "CompactMeshes.h"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+
+// declaration of global variables
+namespace
+{
+	const float g_Pi = 3.14159265358979f;
+
+	// segments around the round shapes
+	const int g_RoundSlices = 48;
+	const int g_SphereStacks = 24;
+
+	const char* g_MeshNames[CompactMeshes::MESH_COUNT] = { "plane", "box", "sphere", "cylinder", "cone" };
+
+	typedef CompactMeshes::MESH_VERTEX MESH_VERTEX;
+	typedef CompactMeshes::MESH_DATA MESH_DATA;
+
+	void AddVertex(MESH_DATA& mesh, const glm::vec3& position, const glm::vec3& normal, const glm::vec2& uv)
+	{
+		MESH_VERTEX vertex = { position, normal, uv };
+		mesh.vertices.push_back(vertex);
+	}
+
+	void AddTriangle(MESH_DATA& mesh, uint32_t first, uint32_t second, uint32_t third)
+	{
+		mesh.indices.push_back(first);
+		mesh.indices.push_back(second);
+		mesh.indices.push_back(third);
+	}
+
+	// add two triangles for the four vertices from the passed in one,
+	// given counterclockwise as seen from the front
+	void AddQuad(MESH_DATA& mesh, uint32_t first)
+	{
+		AddTriangle(mesh, first, first + 1, first + 2);
+		AddTriangle(mesh, first, first + 2, first + 3);
+	}
+
+	// the shapes cover the same bounds as the ShapeMeshes versions
+	void BuildPlane(MESH_DATA& mesh)
+	{
+		glm::vec3 up(0.0f, 1.0f, 0.0f);
+		AddVertex(mesh, glm::vec3(-1.0f, 0.0f, 1.0f), up, glm::vec2(0.0f, 0.0f));
+		AddVertex(mesh, glm::vec3(1.0f, 0.0f, 1.0f), up, glm::vec2(1.0f, 0.0f));
+		AddVertex(mesh, glm::vec3(1.0f, 0.0f, -1.0f), up, glm::vec2(1.0f, 1.0f));
+		AddVertex(mesh, glm::vec3(-1.0f, 0.0f, -1.0f), up, glm::vec2(0.0f, 1.0f));
+		AddQuad(mesh, 0);
+	}
+
+	void BuildBox(MESH_DATA& mesh)
+	{
+		// each face as its normal and the two axes across it
+		const glm::vec3 faces[6][3] =
+		{
+			{ glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f) },
+			{ glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f) },
+			{ glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f) },
+			{ glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 1.0f, 0.0f) },
+			{ glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, -1.0f) },
+			{ glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f) }
+		};
+		for (int face = 0; face < 6; face++)
+		{
+			const glm::vec3& normal = faces[face][0];
+			const glm::vec3& across = faces[face][1];
+			const glm::vec3& up = faces[face][2];
+			uint32_t first = (uint32_t)mesh.vertices.size();
+			glm::vec3 center = normal * 0.5f;
+			AddVertex(mesh, center - across * 0.5f - up * 0.5f, normal, glm::vec2(0.0f, 0.0f));
+			AddVertex(mesh, center + across * 0.5f - up * 0.5f, normal, glm::vec2(1.0f, 0.0f));
+			AddVertex(mesh, center + across * 0.5f + up * 0.5f, normal, glm::vec2(1.0f, 1.0f));
+			AddVertex(mesh, center - across * 0.5f + up * 0.5f, normal, glm::vec2(0.0f, 1.0f));
+			AddQuad(mesh, first);
+		}
+	}
+
+	void BuildSphere(MESH_DATA& mesh)
+	{
+		for (int stack = 0; stack <= g_SphereStacks; stack++)
+		{
+			float v = (float)stack / g_SphereStacks;
+			float polar = v * g_Pi;
+			for (int slice = 0; slice <= g_RoundSlices; slice++)
+			{
+				float u = (float)slice / g_RoundSlices;
+				float azimuth = u * 2.0f * g_Pi;
+				glm::vec3 normal(
+					std::sin(polar) * std::cos(azimuth),
+					-std::cos(polar),
+					-std::sin(polar) * std::sin(azimuth));
+				AddVertex(mesh, normal, normal, glm::vec2(u, v));
+			}
+		}
+		uint32_t rowLength = g_RoundSlices + 1;
+		for (int stack = 0; stack < g_SphereStacks; stack++)
+		{
+			for (int slice = 0; slice < g_RoundSlices; slice++)
+			{
+				uint32_t lower = stack * rowLength + slice;
+				uint32_t upper = lower + rowLength;
+				// the rows at the poles collapse to a point, leaving
+				// one triangle per quad
+				if (stack > 0)
+				{
+					AddTriangle(mesh, lower, lower + 1, upper + 1);
+				}
+				if (stack < g_SphereStacks - 1)
+				{
+					AddTriangle(mesh, lower, upper + 1, upper);
+				}
+			}
+		}
+	}
+
+	// add a disc facing up or down at the height
+	void AddDisc(MESH_DATA& mesh, float height, bool bFacingUp)
+	{
+		glm::vec3 normal(0.0f, bFacingUp ? 1.0f : -1.0f, 0.0f);
+		uint32_t center = (uint32_t)mesh.vertices.size();
+		AddVertex(mesh, glm::vec3(0.0f, height, 0.0f), normal, glm::vec2(0.5f, 0.5f));
+		for (int slice = 0; slice <= g_RoundSlices; slice++)
+		{
+			float azimuth = (float)slice / g_RoundSlices * 2.0f * g_Pi;
+			float x = std::cos(azimuth);
+			float z = -std::sin(azimuth);
+			AddVertex(mesh, glm::vec3(x, height, z), normal, glm::vec2(0.5f + 0.5f * x, 0.5f - 0.5f * z));
+		}
+		for (int slice = 0; slice < g_RoundSlices; slice++)
+		{
+			uint32_t edge = center + 1 + slice;
+			if (bFacingUp == true)
+			{
+				AddTriangle(mesh, center, edge, edge + 1);
+			}
+			else
+			{
+				AddTriangle(mesh, center, edge + 1, edge);
+			}
+		}
+	}
+
+	// add the side of a cylinder or cone, narrowing from the
+	// bottom radius to the top radius
+	void AddSide(MESH_DATA& mesh, float topRadius)
+	{
+		uint32_t first = (uint32_t)mesh.vertices.size();
+		for (int slice = 0; slice <= g_RoundSlices; slice++)
+		{
+			float u = (float)slice / g_RoundSlices;
+			float azimuth = u * 2.0f * g_Pi;
+			float x = std::cos(azimuth);
+			float z = -std::sin(azimuth);
+			// the slope of the side tilts the normal upward
+			glm::vec3 normal = glm::normalize(glm::vec3(x, 1.0f - topRadius, z));
+			AddVertex(mesh, glm::vec3(x, 0.0f, z), normal, glm::vec2(u, 0.0f));
+			AddVertex(mesh, glm::vec3(x * topRadius, 1.0f, z * topRadius), normal, glm::vec2(u, 1.0f));
+		}
+		for (int slice = 0; slice < g_RoundSlices; slice++)
+		{
+			uint32_t bottom = first + slice * 2;
+			AddTriangle(mesh, bottom, bottom + 2, bottom + 3);
+			// a cone has no second triangle, its top is a point
+			if (topRadius > 0.0f)
+			{
+				AddTriangle(mesh, bottom, bottom + 3, bottom + 1);
+			}
+		}
+	}
+
+	void BuildCylinder(MESH_DATA& mesh)
+	{
+		AddSide(mesh, 1.0f);
+		AddDisc(mesh, 1.0f, true);
+		AddDisc(mesh, 0.0f, false);
+	}
+
+	void BuildCone(MESH_DATA& mesh)
+	{
+		AddSide(mesh, 0.0f);
+		AddDisc(mesh, 0.0f, false);
+	}
+
+	// convert to a normalized 16-bit integer, from -1 to 1
+	int16_t PackSnorm16(float value)
+	{
+		value = std::fmax(-1.0f, std::fmin(1.0f, value));
+		return((int16_t)std::lround(value * 32767.0f));
+	}
+
+	// convert to a half float, rounding to the nearest value and
+	// flushing the values too small for a normal half to zero
+	uint16_t PackHalf(float value)
+	{
+		uint32_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+		uint32_t sign = (bits >> 16) & 0x8000;
+		int exponent = (int)((bits >> 23) & 0xFF) - 127 + 15;
+		uint32_t mantissa = bits & 0x7FFFFF;
+
+		if (exponent <= 0)
+		{
+			return((uint16_t)sign);
+		}
+		if (exponent >= 31)
+		{
+			return((uint16_t)(sign | 0x7C00));
+		}
+
+		uint32_t half = sign | ((uint32_t)exponent << 10) | (mantissa >> 13);
+		// round to nearest, which may carry into the exponent
+		if ((mantissa & 0x1FFF) > 0x1000 || (((mantissa & 0x1FFF) == 0x1000) && (half & 1)))
+		{
+			half++;
+		}
+		return((uint16_t)half);
+	}
+
+	// fold the unit normal onto the octahedron and flatten it into
+	// two values from -1 to 1
+	glm::vec2 EncodeOctahedral(const glm::vec3& normal)
+	{
+		float sum = std::fabs(normal.x) + std::fabs(normal.y) + std::fabs(normal.z);
+		glm::vec2 encoded(normal.x / sum, normal.y / sum);
+		if (normal.z < 0.0f)
+		{
+			glm::vec2 folded(
+				(1.0f - std::fabs(encoded.y)) * ((encoded.x >= 0.0f) ? 1.0f : -1.0f),
+				(1.0f - std::fabs(encoded.x)) * ((encoded.y >= 0.0f) ? 1.0f : -1.0f));
+			encoded = folded;
+		}
+		return(encoded);
+	}
+}
+
+/***********************************************************
+ *  CompactMeshes()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+CompactMeshes::CompactMeshes()
+{
+	for (int i = 0; i < MESH_COUNT; i++)
+	{
+		m_meshes[i].indexType = GL_UNSIGNED_SHORT;
+		m_meshes[i].indexCount = 0;
+		m_meshes[i].boundsCenter = glm::vec3(0.0f);
+		m_meshes[i].boundsExtent = glm::vec3(1.0f);
+		m_meshes[i].vertexCount = 0;
+		m_meshes[i].compactBytes = 0;
+		m_meshes[i].floatBytes = 0;
+		m_meshes[i].cacheBefore.acmr = 0.0f;
+		m_meshes[i].cacheBefore.atvr = 0.0f;
+		m_meshes[i].cacheAfter = m_meshes[i].cacheBefore;
+	}
+	m_bLoaded = false;
+}
+
+/***********************************************************
+ *  ~CompactMeshes()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+CompactMeshes::~CompactMeshes()
+{
+	// the vertex arrays and buffers are freed by their handles
+}
+
+/***********************************************************
+ *  BuildMesh()
+ *
+ *  This method is used for generating one of the basic
+ *  shapes and reordering it for the vertex cache, then the
+ *  overdraw, then the vertex fetch.
+ ***********************************************************/
+void CompactMeshes::BuildMesh(int mesh, MESH_DATA& data, MeshOptimizer::CACHE_STATS* pCacheBefore)
+{
+	data.vertices.clear();
+	data.indices.clear();
+	switch (mesh)
+	{
+	case 0: BuildPlane(data); break;
+	case 1: BuildBox(data); break;
+	case 2: BuildSphere(data); break;
+	case 3: BuildCylinder(data); break;
+	default: BuildCone(data); break;
+	}
+
+	if (NULL != pCacheBefore)
+	{
+		*pCacheBefore = MeshOptimizer::AnalyzeVertexCache(data.indices, data.vertices.size());
+	}
+	std::vector<glm::vec3> positions(data.vertices.size());
+	for (size_t v = 0; v < data.vertices.size(); v++)
+	{
+		positions[v] = data.vertices[v].position;
+	}
+	MeshOptimizer::OptimizeVertexCache(data.indices, data.vertices.size());
+	MeshOptimizer::OptimizeOverdraw(data.indices, positions);
+	std::vector<uint32_t> remap;
+	size_t usedVertices = MeshOptimizer::OptimizeVertexFetch(data.indices, data.vertices.size(), remap);
+	MeshOptimizer::RemapVertices(data.vertices, remap, usedVertices);
+}
+
+/***********************************************************
+ *  LoadMeshes()
+ *
+ *  This method is used for generating the basic shapes,
+ *  quantizing their vertices and uploading them into vertex
+ *  array objects.
+ ***********************************************************/
+bool CompactMeshes::LoadMeshes()
+{
+	if (m_bLoaded == true)
+	{
+		return(true);
+	}
+
+	for (int i = 0; i < MESH_COUNT; i++)
+	{
+		MESH_BUFFERS& mesh = m_meshes[i];
+		MESH_DATA data;
+		BuildMesh(i, data, &mesh.cacheBefore);
+		mesh.cacheAfter = MeshOptimizer::AnalyzeVertexCache(data.indices, data.vertices.size());
+
+		glm::vec3 boundsMin = data.vertices[0].position;
+		glm::vec3 boundsMax = data.vertices[0].position;
+		for (size_t v = 1; v < data.vertices.size(); v++)
+		{
+			boundsMin = glm::min(boundsMin, data.vertices[v].position);
+			boundsMax = glm::max(boundsMax, data.vertices[v].position);
+		}
+		mesh.boundsCenter = (boundsMin + boundsMax) * 0.5f;
+		mesh.boundsExtent = (boundsMax - boundsMin) * 0.5f;
+		// a flat axis still needs a scale for the division
+		glm::vec3 scale = glm::max(mesh.boundsExtent, glm::vec3(1e-6f));
+
+		std::vector<COMPACT_VERTEX> vertices(data.vertices.size());
+		for (size_t v = 0; v < data.vertices.size(); v++)
+		{
+			glm::vec3 position = (data.vertices[v].position - mesh.boundsCenter) / scale;
+			glm::vec2 normal = EncodeOctahedral(data.vertices[v].normal);
+			COMPACT_VERTEX& vertex = vertices[v];
+			vertex.position[0] = PackSnorm16(position.x);
+			vertex.position[1] = PackSnorm16(position.y);
+			vertex.position[2] = PackSnorm16(position.z);
+			vertex.padding = 0;
+			vertex.normal[0] = PackSnorm16(normal.x);
+			vertex.normal[1] = PackSnorm16(normal.y);
+			vertex.uv[0] = PackHalf(data.vertices[v].uv.x);
+			vertex.uv[1] = PackHalf(data.vertices[v].uv.y);
+		}
+
+		glBindVertexArray(mesh.vao.Create("compact mesh"));
+
+		glBindBuffer(GL_ARRAY_BUFFER, mesh.vertexBuffer.Create("compact mesh vertices"));
+		glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(COMPACT_VERTEX), vertices.data(), GL_STATIC_DRAW);
+		mesh.vertexBuffer.SetBytes(vertices.size() * sizeof(COMPACT_VERTEX));
+
+		// the normalized integers are scaled back to -1 to 1 by the
+		// vertex fetch, and the shader does the rest of the decoding
+		GLsizei stride = sizeof(COMPACT_VERTEX);
+		glVertexAttribPointer(0, 3, GL_SHORT, GL_TRUE, stride, (void*)offsetof(COMPACT_VERTEX, position));
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, stride, (void*)offsetof(COMPACT_VERTEX, normal));
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, stride, (void*)offsetof(COMPACT_VERTEX, uv));
+		glEnableVertexAttribArray(2);
+
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.indexBuffer.Create("compact mesh indices"));
+		size_t indexBytes = 0;
+		if (data.vertices.size() <= 0xFFFF)
+		{
+			std::vector<uint16_t> indices(data.indices.begin(), data.indices.end());
+			indexBytes = indices.size() * sizeof(uint16_t);
+			glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexBytes, indices.data(), GL_STATIC_DRAW);
+			mesh.indexType = GL_UNSIGNED_SHORT;
+		}
+		else
+		{
+			indexBytes = data.indices.size() * sizeof(uint32_t);
+			glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexBytes, data.indices.data(), GL_STATIC_DRAW);
+			mesh.indexType = GL_UNSIGNED_INT;
+		}
+		mesh.indexCount = (GLsizei)data.indices.size();
+		mesh.indexBuffer.SetBytes(indexBytes);
+
+		glBindVertexArray(0);
+
+		mesh.vertexCount = data.vertices.size();
+		mesh.compactBytes = vertices.size() * sizeof(COMPACT_VERTEX) + indexBytes;
+		mesh.floatBytes = data.vertices.size() * sizeof(MESH_VERTEX) + data.indices.size() * sizeof(uint32_t);
+	}
+
+	m_bLoaded = true;
+	return(true);
+}
+
+/***********************************************************
+ *  DrawMesh()
+ *
+ *  This method is used for drawing the passed in mesh.
+ ***********************************************************/
+void CompactMeshes::DrawMesh(int mesh)
+{
+	if ((m_bLoaded == false) || (mesh < 0) || (mesh >= MESH_COUNT))
+	{
+		return;
+	}
+
+	glBindVertexArray(m_meshes[mesh].vao.Get());
+	glDrawElements(GL_TRIANGLES, m_meshes[mesh].indexCount, m_meshes[mesh].indexType, (void*)0);
+	glBindVertexArray(0);
+}
+
+/***********************************************************
+ *  GetMeshBounds()
+ *
+ *  This method is used for getting the values that turn the
+ *  packed positions back into model space.
+ ***********************************************************/
+void CompactMeshes::GetMeshBounds(int mesh, glm::vec3& center, glm::vec3& extent) const
+{
+	center = glm::vec3(0.0f);
+	extent = glm::vec3(1.0f);
+	if ((mesh >= 0) && (mesh < MESH_COUNT))
+	{
+		center = m_meshes[mesh].boundsCenter;
+		extent = m_meshes[mesh].boundsExtent;
+	}
+}
+
+/***********************************************************
+ *  ReportSizes()
+ *
+ *  This method is used for printing the bytes of vertex and
+ *  index data of each mesh, packed and as 32-bit floats.
+ ***********************************************************/
+void CompactMeshes::ReportSizes() const
+{
+	printf("%-10s %9s %12s %12s %7s %15s %15s\n",
+		"mesh", "vertices", "float bytes", "packed bytes", "ratio", "ACMR", "ATVR");
+	size_t totalFloat = 0;
+	size_t totalCompact = 0;
+	for (int i = 0; i < MESH_COUNT; i++)
+	{
+		const MESH_BUFFERS& mesh = m_meshes[i];
+		printf("%-10s %9zu %12zu %12zu %6.2fx %6.3f -> %5.3f %6.3f -> %5.3f\n",
+			g_MeshNames[i],
+			mesh.vertexCount,
+			mesh.floatBytes,
+			mesh.compactBytes,
+			(mesh.compactBytes > 0) ? (double)mesh.floatBytes / mesh.compactBytes : 0.0,
+			mesh.cacheBefore.acmr,
+			mesh.cacheAfter.acmr,
+			mesh.cacheBefore.atvr,
+			mesh.cacheAfter.atvr);
+		totalFloat += mesh.floatBytes;
+		totalCompact += mesh.compactBytes;
+	}
+	printf("%-10s %9s %12zu %12zu %6.2fx\n",
+		"total", "",
+		totalFloat,
+		totalCompact,
+		(totalCompact > 0) ? (double)totalFloat / totalCompact : 0.0);
+}
@@ -0,0 +1,105 @@
+///////////////////////////////////////////////////////////////////////////////
+// compactmeshes.h
+// ============
+// build the basic shape meshes with quantized vertex attributes that are
+// decoded in the vertex shader
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "GpuResources.h"
+#include "MeshOptimizer.h"
+
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  CompactMeshes
+ *
+ *  This class contains the same basic shapes as ShapeMeshes,
+ *  with the vertices packed into 16 bytes instead of 32.
+ *  Positions are normalized 16-bit integers within the mesh
+ *  bounds, normals are octahedral encoded into two 16-bit
+ *  integers, texture coordinates are half floats, and the
+ *  indices are 16-bit whenever the mesh has few enough
+ *  vertices.  The shader variants built with the compact
+ *  vertex flag turn them back into floats.
+ ***********************************************************/
+class CompactMeshes
+{
+public:
+	// constructor
+	CompactMeshes();
+	// destructor
+	~CompactMeshes();
+
+	// number of meshes, in the order of SceneManager::MESH_TYPE
+	static const int MESH_COUNT = 5;
+
+	// packed vertex, as read by the vertex shader
+	struct COMPACT_VERTEX
+	{
+		// position within the mesh bounds, from -32767 to 32767
+		int16_t position[3];
+		int16_t padding;
+		// octahedral encoded normal
+		int16_t normal[2];
+		// half float texture coordinate
+		uint16_t uv[2];
+	};
+
+	// unpacked vertex, the layout of the float meshes
+	struct MESH_VERTEX
+	{
+		glm::vec3 position;
+		glm::vec3 normal;
+		glm::vec2 uv;
+	};
+
+	struct MESH_DATA
+	{
+		std::vector<MESH_VERTEX> vertices;
+		std::vector<uint32_t> indices;
+	};
+
+	// generate the float vertices and the optimized triangle list
+	// of the mesh, also measuring the vertex cache before the
+	// triangles are reordered when asked for
+	static void BuildMesh(int mesh, MESH_DATA& data, MeshOptimizer::CACHE_STATS* pCacheBefore = NULL);
+
+	// generate and upload all of the meshes
+	bool LoadMeshes();
+	// draw the mesh with the currently bound program
+	void DrawMesh(int mesh);
+	// center and half size of the mesh bounds, which the shader
+	// uses for decoding the positions
+	void GetMeshBounds(int mesh, glm::vec3& center, glm::vec3& extent) const;
+	// print the memory used by the meshes, packed and unpacked,
+	// and the vertex cache efficiency before and after optimizing
+	void ReportSizes() const;
+
+private:
+	struct MESH_BUFFERS
+	{
+		GpuVertexArray vao;
+		GpuBuffer vertexBuffer;
+		GpuBuffer indexBuffer;
+		GLenum indexType;
+		GLsizei indexCount;
+		glm::vec3 boundsCenter;
+		glm::vec3 boundsExtent;
+		// sizes of the vertex and index data
+		size_t vertexCount;
+		size_t compactBytes;
+		size_t floatBytes;
+		// simulated vertex cache, in generated and optimized order
+		MeshOptimizer::CACHE_STATS cacheBefore;
+		MeshOptimizer::CACHE_STATS cacheAfter;
+	};
+
+	MESH_BUFFERS m_meshes[MESH_COUNT];
+	bool m_bLoaded;
+};
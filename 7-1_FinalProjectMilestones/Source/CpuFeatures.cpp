@@ -0,0 +1,83 @@
+///////////////////////////////////////////////////////////////////////////////
+// cpufeatures.cpp
+// ============
+// detect the vector instruction sets of the CPU, so that the vector code
+// paths can be built into every executable and selected at runtime
+///////////////////////////////////////////////////////////////////////////////
+
+#include "CpuFeatures.h"
+
+#ifdef CPU_FEATURES_AVX2
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+// declaration of global variables
+namespace
+{
+	// check that both the CPU and the operating system support AVX2
+	bool DetectAVX2()
+	{
+#ifdef CPU_FEATURES_AVX2
+#if defined(_MSC_VER)
+		int info[4];
+		__cpuid(info, 1);
+		bool bOSXSave = (info[2] & (1 << 27)) != 0;
+		bool bAVX = (info[2] & (1 << 28)) != 0;
+		if (!bOSXSave || !bAVX)
+		{
+			return(false);
+		}
+		// the YMM registers must be saved by the operating system
+		if ((_xgetbv(0) & 0x6) != 0x6)
+		{
+			return(false);
+		}
+		__cpuidex(info, 7, 0);
+		return((info[1] & (1 << 5)) != 0);
+#else
+		unsigned int eax = 0;
+		unsigned int ebx = 0;
+		unsigned int ecx = 0;
+		unsigned int edx = 0;
+		if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) == 0)
+		{
+			return(false);
+		}
+		if (((ecx & (1 << 27)) == 0) || ((ecx & (1 << 28)) == 0))
+		{
+			return(false);
+		}
+		unsigned int xcr0Low = 0;
+		unsigned int xcr0High = 0;
+		__asm__("xgetbv" : "=a"(xcr0Low), "=d"(xcr0High) : "c"(0));
+		if ((xcr0Low & 0x6) != 0x6)
+		{
+			return(false);
+		}
+		if (__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) == 0)
+		{
+			return(false);
+		}
+		return((ebx & (1 << 5)) != 0);
+#endif
+#else
+		return(false);
+#endif
+	}
+}
+
+/***********************************************************
+ *  HasAVX2()
+ *
+ *  This function is used for checking whether the AVX2 code
+ *  paths can run, which is only detected by the first call.
+ ***********************************************************/
+bool CpuFeatures::HasAVX2()
+{
+	static const bool bHasAVX2 = DetectAVX2();
+	return(bHasAVX2);
+}
@@ -0,0 +1,41 @@
+///////////////////////////////////////////////////////////////////////////////
+// cpufeatures.h
+// ============
+// detect the vector instruction sets of the CPU, so that the vector code
+// paths can be built into every executable and selected at runtime
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+// the AVX2 code paths are compiled for x86 targets, and only the functions
+// marked with CPU_AVX2_FUNCTION may use the instruction set, so the
+// application still runs on CPUs without AVX2
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define CPU_FEATURES_AVX2
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#define CPU_AVX2_FUNCTION
+#else
+#define CPU_AVX2_FUNCTION __attribute__((target("avx2")))
+#endif
+#endif
+
+// SSE2 is part of every x64 target and of the 32-bit targets built for it,
+// so its code paths are selected when compiling without a check at runtime
+#if defined(_M_X64) || defined(__x86_64__) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2)) || defined(__SSE2__)
+#define CPU_FEATURES_SSE2
+#include <emmintrin.h>
+#endif
+
+/***********************************************************
+ *  CpuFeatures
+ *
+ *  The instruction sets are checked once, on first use, for
+ *  both the CPU and the operating system, which has to save
+ *  the wider registers when it switches threads.
+ ***********************************************************/
+namespace CpuFeatures
+{
+	// true when the AVX2 code paths can be used
+	bool HasAVX2();
+}
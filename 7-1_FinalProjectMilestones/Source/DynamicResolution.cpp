@@ -0,0 +1,240 @@
+///////////////////////////////////////////////////////////////////////////////
+// dynamicresolution.cpp
+// ============
+// render the scene at a reduced resolution that is adjusted from the
+// measured GPU frame time, and upscale it to the window
+///////////////////////////////////////////////////////////////////////////////
+
+#include "DynamicResolution.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// limits and step of the resolution scale
+	const float g_MinScale = 0.5f;
+	const float g_MaxScale = 1.0f;
+	const float g_ScaleStep = 0.05f;
+	// the scale is lowered above this part of the budget, and
+	// raised below the lower part, leaving a band in between
+	// so the scale does not oscillate
+	const float g_DecreaseThreshold = 0.95f;
+	const float g_IncreaseThreshold = 0.75f;
+	// frames to wait after a change, so the effect of the new
+	// scale shows in the measured times first
+	const int g_CooldownFrames = 10;
+	// weight of a new sample in the smoothed GPU time
+	const float g_Smoothing = 0.2f;
+}
+
+/***********************************************************
+ *  DynamicResolution()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+DynamicResolution::DynamicResolution(float targetFramesPerSecond)
+{
+	glGenQueries(QUERY_COUNT, m_queries);
+	for (int i = 0; i < QUERY_COUNT; i++)
+	{
+		m_bQueryPending[i] = false;
+	}
+	m_nextQuery = 0;
+	m_bQueryActive = false;
+
+	m_framebufferWidth = 0;
+	m_framebufferHeight = 0;
+	m_renderWidth = 0;
+	m_renderHeight = 0;
+
+	if (targetFramesPerSecond <= 0.0f)
+	{
+		targetFramesPerSecond = 60.0f;
+	}
+	m_budgetMilliseconds = 1000.0f / targetFramesPerSecond;
+	m_scale = g_MaxScale;
+	m_gpuMilliseconds = 0.0f;
+	m_cooldownFrames = 0;
+
+	m_frames = 0;
+	m_scaleSum = 0.0;
+	m_scaleChanges = 0;
+}
+
+/***********************************************************
+ *  ~DynamicResolution()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+DynamicResolution::~DynamicResolution()
+{
+	glDeleteQueries(QUERY_COUNT, m_queries);
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method is used for binding the offscreen target for
+ *  the scene rendering.  The target is allocated at the full
+ *  framebuffer size and the scale only changes the viewport,
+ *  so changing the scale never reallocates it.
+ ***********************************************************/
+void DynamicResolution::BeginFrame(int framebufferWidth, int framebufferHeight)
+{
+	CollectQueries();
+
+	if ((framebufferWidth != m_framebufferWidth) || (framebufferHeight != m_framebufferHeight))
+	{
+		m_framebufferWidth = framebufferWidth;
+		m_framebufferHeight = framebufferHeight;
+		m_target.Create(framebufferWidth, framebufferHeight);
+	}
+
+	m_renderWidth = std::max(1, (int)(m_framebufferWidth * m_scale + 0.5f));
+	m_renderHeight = std::max(1, (int)(m_framebufferHeight * m_scale + 0.5f));
+
+	m_target.Bind();
+	glViewport(0, 0, m_renderWidth, m_renderHeight);
+
+	// only the rendered part of the target needs clearing
+	glEnable(GL_SCISSOR_TEST);
+	glScissor(0, 0, m_renderWidth, m_renderHeight);
+
+	// skip timing this frame if the query is still in flight
+	m_bQueryActive = (m_bQueryPending[m_nextQuery] == false);
+	if (m_bQueryActive == true)
+	{
+		glBeginQuery(GL_TIME_ELAPSED, m_queries[m_nextQuery]);
+	}
+
+	m_frames++;
+	m_scaleSum += m_scale;
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method is used for upscaling the rendered part of
+ *  the target into the window framebuffer with bilinear
+ *  filtering.
+ ***********************************************************/
+void DynamicResolution::EndFrame()
+{
+	if (m_bQueryActive == true)
+	{
+		glEndQuery(GL_TIME_ELAPSED);
+		m_bQueryPending[m_nextQuery] = true;
+		m_nextQuery = (m_nextQuery + 1) % QUERY_COUNT;
+		m_bQueryActive = false;
+	}
+
+	glDisable(GL_SCISSOR_TEST);
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, m_target.GetFramebuffer());
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+	glBlitFramebuffer(
+		0, 0, m_renderWidth, m_renderHeight,
+		0, 0, m_framebufferWidth, m_framebufferHeight,
+		GL_COLOR_BUFFER_BIT,
+		(m_renderWidth == m_framebufferWidth) ? GL_NEAREST : GL_LINEAR);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glViewport(0, 0, m_framebufferWidth, m_framebufferHeight);
+}
+
+/***********************************************************
+ *  CollectQueries()
+ *
+ *  This method is used for reading the timer queries that
+ *  have finished, oldest first, without waiting for the GPU.
+ ***********************************************************/
+void DynamicResolution::CollectQueries()
+{
+	for (int i = 0; i < QUERY_COUNT; i++)
+	{
+		int query = (m_nextQuery + i) % QUERY_COUNT;
+		if (m_bQueryPending[query] == false)
+		{
+			continue;
+		}
+
+		GLint available = 0;
+		glGetQueryObjectiv(m_queries[query], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (available == 0)
+		{
+			break;
+		}
+
+		GLuint64 elapsedNanoseconds = 0;
+		glGetQueryObjectui64v(m_queries[query], GL_QUERY_RESULT, &elapsedNanoseconds);
+		m_bQueryPending[query] = false;
+		UpdateScale(elapsedNanoseconds / 1000000.0f);
+	}
+}
+
+/***********************************************************
+ *  UpdateScale()
+ *
+ *  This method is used for adjusting the resolution scale
+ *  from a new GPU time sample.  The GPU time is assumed to
+ *  grow with the pixel count, so the scale is lowered by the
+ *  square root of the excess to meet the budget in one step,
+ *  and raised in small steps while there is headroom.
+ ***********************************************************/
+void DynamicResolution::UpdateScale(float gpuMilliseconds)
+{
+	if (m_gpuMilliseconds <= 0.0f)
+	{
+		m_gpuMilliseconds = gpuMilliseconds;
+	}
+	else
+	{
+		m_gpuMilliseconds += (gpuMilliseconds - m_gpuMilliseconds) * g_Smoothing;
+	}
+
+	if (m_cooldownFrames > 0)
+	{
+		m_cooldownFrames--;
+		return;
+	}
+
+	float scale = m_scale;
+	if (m_gpuMilliseconds > m_budgetMilliseconds * g_DecreaseThreshold)
+	{
+		float target = m_budgetMilliseconds * (g_DecreaseThreshold + g_IncreaseThreshold) * 0.5f;
+		scale = m_scale * sqrtf(target / m_gpuMilliseconds);
+		// round down to whole steps
+		scale = floorf(scale / g_ScaleStep) * g_ScaleStep;
+	}
+	else if (m_gpuMilliseconds < m_budgetMilliseconds * g_IncreaseThreshold)
+	{
+		scale = m_scale + g_ScaleStep;
+	}
+	scale = std::min(std::max(scale, g_MinScale), g_MaxScale);
+
+	if (fabsf(scale - m_scale) > 0.001f)
+	{
+		m_scale = scale;
+		m_cooldownFrames = g_CooldownFrames;
+		m_scaleChanges++;
+	}
+}
+
+/***********************************************************
+ *  Report()
+ *
+ *  This method is used for printing the scale statistics.
+ ***********************************************************/
+void DynamicResolution::Report()
+{
+	if (m_frames == 0)
+	{
+		return;
+	}
+
+	std::cout << "Dynamic resolution: average scale " << (m_scaleSum / m_frames)
+		<< ", " << m_scaleChanges << " changes, GPU time " << m_gpuMilliseconds
+		<< " ms for a budget of " << m_budgetMilliseconds << " ms" << std::endl;
+}
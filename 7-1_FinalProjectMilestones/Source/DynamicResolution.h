@@ -0,0 +1,72 @@
+///////////////////////////////////////////////////////////////////////////////
+// dynamicresolution.h
+// ============
+// render the scene at a reduced resolution that is adjusted from the
+// measured GPU frame time, and upscale it to the window
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "RenderTarget.h"
+
+/***********************************************************
+ *  DynamicResolution
+ *
+ *  This class renders the scene into an offscreen target at
+ *  a fraction of the framebuffer size.  The GPU time of each
+ *  frame is measured with timer queries, and the resolution
+ *  scale is lowered when the time exceeds the budget and
+ *  raised again when there is headroom.  The image is then
+ *  upscaled into the window framebuffer.
+ ***********************************************************/
+class DynamicResolution
+{
+public:
+	// constructor
+	DynamicResolution(float targetFramesPerSecond);
+	// destructor
+	~DynamicResolution();
+
+	// bind the offscreen target at the current scale, resizing
+	// it to match the framebuffer
+	void BeginFrame(int framebufferWidth, int framebufferHeight);
+	// upscale the rendered image into the window framebuffer
+	void EndFrame();
+
+	// current fraction of the framebuffer width and height
+	float GetScale() const { return(m_scale); }
+	// smoothed GPU time of the scene rendering
+	float GetGPUMilliseconds() const { return(m_gpuMilliseconds); }
+	// print the scale statistics
+	void Report();
+
+private:
+	// timer queries in flight, read back without waiting
+	static const int QUERY_COUNT = 4;
+
+	RenderTarget m_target;
+	GLuint m_queries[QUERY_COUNT];
+	bool m_bQueryPending[QUERY_COUNT];
+	int m_nextQuery;
+	bool m_bQueryActive;
+
+	int m_framebufferWidth;
+	int m_framebufferHeight;
+	int m_renderWidth;
+	int m_renderHeight;
+
+	float m_budgetMilliseconds;
+	float m_scale;
+	float m_gpuMilliseconds;
+	// frames left before the scale may change again
+	int m_cooldownFrames;
+
+	// statistics
+	long long m_frames;
+	double m_scaleSum;
+	int m_scaleChanges;
+
+	// read the finished timer queries and adjust the scale
+	void CollectQueries();
+	void UpdateScale(float gpuMilliseconds);
+};
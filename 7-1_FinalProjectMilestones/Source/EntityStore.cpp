@@ -0,0 +1,245 @@
+///////////////////////////////////////////////////////////////////////////////
+// entitystore.cpp
+// ============
+// store the components of the scene objects in packed parallel arrays
+// addressed through stable handles
+///////////////////////////////////////////////////////////////////////////////
+
+#include "EntityStore.h"
+
+// declaration of global variables
+namespace
+{
+	// move the last element into the removed position
+	template <typename T>
+	void RemoveBySwap(std::vector<T>& values, size_t index)
+	{
+		if (index + 1 < values.size())
+		{
+			values[index] = values.back();
+		}
+		values.pop_back();
+	}
+}
+
+const EntityStore::ENTITY_HANDLE EntityStore::INVALID_HANDLE = { 0xFFFFFFFF, 0 };
+
+/***********************************************************
+ *  EntityStore()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+EntityStore::EntityStore()
+{
+}
+
+/***********************************************************
+ *  Add()
+ *
+ *  This method is used for adding an object to the end of the
+ *  component arrays.  A free slot is reused for its handle
+ *  when there is one.
+ ***********************************************************/
+EntityStore::ENTITY_HANDLE EntityStore::Add(const ENTITY_DESC& desc)
+{
+	ENTITY_HANDLE handle;
+	if (m_freeSlots.empty() == false)
+	{
+		handle.slot = m_freeSlots.back();
+		m_freeSlots.pop_back();
+	}
+	else
+	{
+		handle.slot = (uint32_t)m_slotIndices.size();
+		m_slotIndices.push_back(-1);
+		m_slotGenerations.push_back(0);
+	}
+	handle.generation = m_slotGenerations[handle.slot];
+	m_slotIndices[handle.slot] = GetCount();
+
+	m_transforms.push_back(desc.transform);
+	m_boundsMin.push_back(desc.boundsMin);
+	m_boundsMax.push_back(desc.boundsMax);
+	m_meshes.push_back(desc.mesh);
+	m_materials.push_back(desc.material);
+	m_textures.push_back(desc.texture);
+	m_uvScales.push_back(desc.uvScale);
+	m_colors.push_back(desc.color);
+	m_flags.push_back(desc.flags);
+	m_indexSlots.push_back(handle.slot);
+
+	return(handle);
+}
+
+/***********************************************************
+ *  Remove()
+ *
+ *  This method is used for removing an object in constant
+ *  time.  The last object is moved into its place, and the
+ *  slot of the removed object gets a new generation so that
+ *  its handles are no longer valid.
+ ***********************************************************/
+bool EntityStore::Remove(ENTITY_HANDLE handle)
+{
+	int index = GetIndex(handle);
+	if (index < 0)
+	{
+		return(false);
+	}
+
+	// point the slot of the moved object at its new position
+	uint32_t lastSlot = m_indexSlots.back();
+	m_slotIndices[lastSlot] = index;
+
+	RemoveBySwap(m_transforms, index);
+	RemoveBySwap(m_boundsMin, index);
+	RemoveBySwap(m_boundsMax, index);
+	RemoveBySwap(m_meshes, index);
+	RemoveBySwap(m_materials, index);
+	RemoveBySwap(m_textures, index);
+	RemoveBySwap(m_uvScales, index);
+	RemoveBySwap(m_colors, index);
+	RemoveBySwap(m_flags, index);
+	RemoveBySwap(m_indexSlots, index);
+
+	m_slotIndices[handle.slot] = -1;
+	m_slotGenerations[handle.slot]++;
+	m_freeSlots.push_back(handle.slot);
+
+	return(true);
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for removing all of the objects.
+ ***********************************************************/
+void EntityStore::Clear()
+{
+	for (size_t i = 0; i < m_indexSlots.size(); i++)
+	{
+		uint32_t slot = m_indexSlots[i];
+		m_slotIndices[slot] = -1;
+		m_slotGenerations[slot]++;
+		m_freeSlots.push_back(slot);
+	}
+
+	m_transforms.clear();
+	m_boundsMin.clear();
+	m_boundsMax.clear();
+	m_meshes.clear();
+	m_materials.clear();
+	m_textures.clear();
+	m_uvScales.clear();
+	m_colors.clear();
+	m_flags.clear();
+	m_indexSlots.clear();
+}
+
+/***********************************************************
+ *  Reserve()
+ *
+ *  This method is used for allocating the component arrays
+ *  for the number of objects ahead of adding them.
+ ***********************************************************/
+void EntityStore::Reserve(size_t count)
+{
+	m_transforms.reserve(count);
+	m_boundsMin.reserve(count);
+	m_boundsMax.reserve(count);
+	m_meshes.reserve(count);
+	m_materials.reserve(count);
+	m_textures.reserve(count);
+	m_uvScales.reserve(count);
+	m_colors.reserve(count);
+	m_flags.reserve(count);
+	m_indexSlots.reserve(count);
+}
+
+/***********************************************************
+ *  IsValid()
+ *
+ *  This method is used for checking whether the handle still
+ *  refers to an object.
+ ***********************************************************/
+bool EntityStore::IsValid(ENTITY_HANDLE handle) const
+{
+	return(GetIndex(handle) >= 0);
+}
+
+/***********************************************************
+ *  GetIndex()
+ *
+ *  This method is used for getting the position of the object
+ *  in the component arrays, which changes when other objects
+ *  are removed.
+ ***********************************************************/
+int EntityStore::GetIndex(ENTITY_HANDLE handle) const
+{
+	if ((handle.slot >= m_slotIndices.size()) ||
+		(m_slotGenerations[handle.slot] != handle.generation))
+	{
+		return(-1);
+	}
+	return(m_slotIndices[handle.slot]);
+}
+
+/***********************************************************
+ *  GetHandle()
+ *
+ *  This method is used for getting the handle of the object
+ *  at the position in the component arrays.
+ ***********************************************************/
+EntityStore::ENTITY_HANDLE EntityStore::GetHandle(int index) const
+{
+	if ((index < 0) || (index >= GetCount()))
+	{
+		return(INVALID_HANDLE);
+	}
+
+	ENTITY_HANDLE handle;
+	handle.slot = m_indexSlots[index];
+	handle.generation = m_slotGenerations[handle.slot];
+	return(handle);
+}
+
+/***********************************************************
+ *  SetTransform()
+ *
+ *  This method is used for moving the object.  The world
+ *  bounds are passed in, since they depend on the mesh.
+ ***********************************************************/
+bool EntityStore::SetTransform(
+	ENTITY_HANDLE handle,
+	const glm::mat4& transform,
+	const glm::vec3& boundsMin,
+	const glm::vec3& boundsMax)
+{
+	int index = GetIndex(handle);
+	if (index < 0)
+	{
+		return(false);
+	}
+
+	m_transforms[index] = transform;
+	m_boundsMin[index] = boundsMin;
+	m_boundsMax[index] = boundsMax;
+	return(true);
+}
+
+/***********************************************************
+ *  AddFlags()
+ *
+ *  This method is used for setting flag bits of the object.
+ ***********************************************************/
+bool EntityStore::AddFlags(ENTITY_HANDLE handle, unsigned int flags)
+{
+	int index = GetIndex(handle);
+	if (index < 0)
+	{
+		return(false);
+	}
+
+	m_flags[index] |= flags;
+	return(true);
+}
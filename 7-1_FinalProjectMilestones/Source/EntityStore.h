@@ -0,0 +1,128 @@
+///////////////////////////////////////////////////////////////////////////////
+// entitystore.h
+// ============
+// store the components of the scene objects in packed parallel arrays
+// addressed through stable handles
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  EntityStore
+ *
+ *  This class contains the scene objects as a structure of
+ *  arrays, with one tightly packed array per component, so
+ *  that passes over a single component stream through
+ *  memory.  Objects are removed by moving the last object
+ *  into the gap, which keeps the arrays packed, and are
+ *  referred to by handles that stay valid while they move
+ *  and are rejected once the object is removed.
+ ***********************************************************/
+class EntityStore
+{
+public:
+	// constructor
+	EntityStore();
+
+	// reference to an object - the generation of the slot is
+	// incremented on removal, invalidating old handles
+	struct ENTITY_HANDLE
+	{
+		uint32_t slot;
+		uint32_t generation;
+	};
+
+	// bits of the flags component
+	enum ENTITY_FLAGS
+	{
+		// hides the objects behind it from the occlusion culling
+		ENTITY_OCCLUDER = 0x01,
+		// drawn with its texture rather than its color
+		ENTITY_TEXTURED = 0x02,
+		// blended with the scene behind it
+		ENTITY_TRANSPARENT = 0x04,
+		// moved after it was added, so it is drawn every frame
+		// rather than from the static layer cache
+		ENTITY_DYNAMIC = 0x08
+	};
+
+	// component values of a new object
+	struct ENTITY_DESC
+	{
+		glm::mat4 transform;
+		// world space bounding box
+		glm::vec3 boundsMin;
+		glm::vec3 boundsMax;
+		int mesh;
+		int material;
+		int texture;
+		glm::vec2 uvScale;
+		glm::vec4 color;
+		unsigned int flags;
+	};
+
+	// handle that never refers to an object
+	static const ENTITY_HANDLE INVALID_HANDLE;
+
+	// add an object at the end of the arrays
+	ENTITY_HANDLE Add(const ENTITY_DESC& desc);
+	// remove the object, moving the last object into its place
+	bool Remove(ENTITY_HANDLE handle);
+	// remove all of the objects, invalidating their handles
+	void Clear();
+	// allocate space for the number of objects
+	void Reserve(size_t count);
+
+	// true when the handle refers to an existing object
+	bool IsValid(ENTITY_HANDLE handle) const;
+	// get the position of the object in the arrays, or -1
+	int GetIndex(ENTITY_HANDLE handle) const;
+	// get the handle of the object at the position in the arrays
+	ENTITY_HANDLE GetHandle(int index) const;
+	// number of objects, which is the length of every array
+	int GetCount() const { return((int)m_transforms.size()); }
+
+	// change the transformation and world bounds of the object
+	bool SetTransform(
+		ENTITY_HANDLE handle,
+		const glm::mat4& transform,
+		const glm::vec3& boundsMin,
+		const glm::vec3& boundsMax);
+	// set the flag bits of the object, keeping the others
+	bool AddFlags(ENTITY_HANDLE handle, unsigned int flags);
+
+	// component arrays, indexed from 0 to GetCount() - 1
+	const glm::mat4* GetTransforms() const { return(m_transforms.data()); }
+	const glm::vec3* GetBoundsMin() const { return(m_boundsMin.data()); }
+	const glm::vec3* GetBoundsMax() const { return(m_boundsMax.data()); }
+	const int* GetMeshes() const { return(m_meshes.data()); }
+	const int* GetMaterials() const { return(m_materials.data()); }
+	const int* GetTextures() const { return(m_textures.data()); }
+	const glm::vec2* GetUVScales() const { return(m_uvScales.data()); }
+	const glm::vec4* GetColors() const { return(m_colors.data()); }
+	const unsigned int* GetFlags() const { return(m_flags.data()); }
+
+private:
+	// components, all of the same length
+	std::vector<glm::mat4> m_transforms;
+	std::vector<glm::vec3> m_boundsMin;
+	std::vector<glm::vec3> m_boundsMax;
+	std::vector<int> m_meshes;
+	std::vector<int> m_materials;
+	std::vector<int> m_textures;
+	std::vector<glm::vec2> m_uvScales;
+	std::vector<glm::vec4> m_colors;
+	std::vector<unsigned int> m_flags;
+	// slot of the handle for each object
+	std::vector<uint32_t> m_indexSlots;
+
+	// position in the arrays for each slot, or -1 when free
+	std::vector<int> m_slotIndices;
+	std::vector<uint32_t> m_slotGenerations;
+	std::vector<uint32_t> m_freeSlots;
+};
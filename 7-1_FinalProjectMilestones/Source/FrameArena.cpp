@@ -0,0 +1,106 @@
+///////////////////////////////////////////////////////////////////////////////
+// framearena.cpp
+// ============
+// linear allocator for the transient data of a single frame
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FrameArena.h"
+
+// declaration of global variables
+namespace
+{
+	// alignment of the allocations within a block, which is at
+	// least that of every basic type
+	const size_t g_Alignment = 16;
+
+	size_t AlignUp(size_t value)
+	{
+		return((value + g_Alignment - 1) & ~(g_Alignment - 1));
+	}
+}
+
+/***********************************************************
+ *  FrameArena()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FrameArena::FrameArena(size_t initialBytes)
+{
+	m_blockBytes = AlignUp(initialBytes);
+	m_pBlock = new unsigned char[m_blockBytes];
+	m_offset = 0;
+	m_usedBytes = 0;
+	m_peakBytes = 0;
+}
+
+/***********************************************************
+ *  ~FrameArena()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+FrameArena::~FrameArena()
+{
+	for (size_t i = 0; i < m_overflowBlocks.size(); i++)
+	{
+		delete[] m_overflowBlocks[i];
+	}
+	delete[] m_pBlock;
+	m_pBlock = NULL;
+}
+
+/***********************************************************
+ *  Reset()
+ *
+ *  This method is used for releasing everything handed out
+ *  in the frame.  When the frame needed extra blocks, they
+ *  are freed and the main block is replaced with one that
+ *  holds the whole frame.
+ ***********************************************************/
+void FrameArena::Reset()
+{
+	if (m_overflowBlocks.empty() == false)
+	{
+		for (size_t i = 0; i < m_overflowBlocks.size(); i++)
+		{
+			delete[] m_overflowBlocks[i];
+		}
+		m_overflowBlocks.clear();
+
+		// leave headroom so that slowly growing frames do not
+		// replace the block every frame
+		delete[] m_pBlock;
+		m_blockBytes = AlignUp(m_peakBytes + m_peakBytes / 4);
+		m_pBlock = new unsigned char[m_blockBytes];
+	}
+
+	m_offset = 0;
+	m_usedBytes = 0;
+}
+
+/***********************************************************
+ *  Allocate()
+ *
+ *  This method is used for handing out memory that stays
+ *  valid until the next reset.
+ ***********************************************************/
+void* FrameArena::Allocate(size_t bytes)
+{
+	bytes = AlignUp(bytes);
+	m_usedBytes += bytes;
+	if (m_usedBytes > m_peakBytes)
+	{
+		m_peakBytes = m_usedBytes;
+	}
+
+	if (m_offset + bytes <= m_blockBytes)
+	{
+		void* pMemory = m_pBlock + m_offset;
+		m_offset += bytes;
+		return(pMemory);
+	}
+
+	// the new operator aligns for any basic type
+	unsigned char* pOverflow = new unsigned char[bytes];
+	m_overflowBlocks.push_back(pOverflow);
+	return(pOverflow);
+}
@@ -0,0 +1,57 @@
+///////////////////////////////////////////////////////////////////////////////
+// framearena.h
+// ============
+// linear allocator for the transient data of a single frame
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+/***********************************************************
+ *  FrameArena
+ *
+ *  This class hands out memory from one block by moving an
+ *  offset forward, and releases everything at once when it
+ *  is reset at the start of the next frame.  A frame that
+ *  needs more than the block takes extra blocks from the
+ *  heap, and the block is then grown on reset to the most
+ *  used so far, so that steady frames never allocate.
+ ***********************************************************/
+class FrameArena
+{
+public:
+	// constructor
+	FrameArena(size_t initialBytes);
+	// destructor
+	~FrameArena();
+
+	// release all of the memory handed out since the last reset
+	void Reset();
+	// get uninitialized memory, aligned for any basic type
+	void* Allocate(size_t bytes);
+
+	// get uninitialized memory for the number of values - the
+	// values are never destroyed, so only plain types are used
+	template <typename T>
+	T* AllocateArray(size_t count)
+	{
+		return((T*)Allocate(count * sizeof(T)));
+	}
+
+	// memory handed out since the last reset, and the most
+	// handed out in any frame
+	size_t GetUsedBytes() const { return(m_usedBytes); }
+	size_t GetPeakBytes() const { return(m_peakBytes); }
+
+private:
+	// main block, reused every frame
+	unsigned char* m_pBlock;
+	size_t m_blockBytes;
+	size_t m_offset;
+	// blocks taken from the heap when the main block ran out
+	std::vector<unsigned char*> m_overflowBlocks;
+	size_t m_usedBytes;
+	size_t m_peakBytes;
+};
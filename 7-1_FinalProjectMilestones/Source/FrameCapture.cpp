@@ -0,0 +1,606 @@
+///////////////////////////////////////////////////////////////////////////////
+// framecapture.cpp
+// ============
+// capture rendered frames without stalling the render loop, by reading
+// them into a ring of pixel buffer objects and encoding them on
+// background threads
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FrameCapture.h"
+#include "ImageIO.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// time to wait for a fence before checking it again
+	const GLuint64 g_FenceWaitNanoseconds = 100000000;
+
+	// convert the RGBA pixels, bottom row first, into the planes
+	// of a top row first YUV 4:2:0 image with BT.601 video range
+	void ConvertToYUV420(
+		const unsigned char* pPixels,
+		int width,
+		int height,
+		std::vector<unsigned char>& yuv)
+	{
+		int chromaWidth = (width + 1) / 2;
+		int chromaHeight = (height + 1) / 2;
+		yuv.resize((size_t)width * height + 2 * (size_t)chromaWidth * chromaHeight);
+
+		unsigned char* pY = yuv.data();
+		unsigned char* pU = pY + (size_t)width * height;
+		unsigned char* pV = pU + (size_t)chromaWidth * chromaHeight;
+
+		for (int y = 0; y < height; y++)
+		{
+			const unsigned char* pRow = pPixels + (size_t)(height - 1 - y) * width * 4;
+			for (int x = 0; x < width; x++)
+			{
+				int r = pRow[x * 4];
+				int g = pRow[x * 4 + 1];
+				int b = pRow[x * 4 + 2];
+				pY[(size_t)y * width + x] = (unsigned char)(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+			}
+		}
+
+		// the chroma is averaged over each 2x2 block of pixels
+		for (int cy = 0; cy < chromaHeight; cy++)
+		{
+			for (int cx = 0; cx < chromaWidth; cx++)
+			{
+				int r = 0;
+				int g = 0;
+				int b = 0;
+				int samples = 0;
+				for (int dy = 0; dy < 2; dy++)
+				{
+					int y = std::min(cy * 2 + dy, height - 1);
+					const unsigned char* pRow = pPixels + (size_t)(height - 1 - y) * width * 4;
+					for (int dx = 0; dx < 2; dx++)
+					{
+						int x = std::min(cx * 2 + dx, width - 1);
+						r += pRow[x * 4];
+						g += pRow[x * 4 + 1];
+						b += pRow[x * 4 + 2];
+						samples++;
+					}
+				}
+				r /= samples;
+				g /= samples;
+				b /= samples;
+				pU[(size_t)cy * chromaWidth + cx] = (unsigned char)(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+				pV[(size_t)cy * chromaWidth + cx] = (unsigned char)(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  FrameCapture()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FrameCapture::FrameCapture(const char* screenshotDirectory)
+{
+	m_screenshotDirectory = screenshotDirectory;
+	m_screenshotCount = 0;
+	m_bScreenshotRequested = false;
+
+	m_bSequenceActive = false;
+	m_format = CAPTURE_PNG;
+	m_framesPerSecond = 60;
+	m_sequenceFrames = 0;
+
+	for (int i = 0; i < RING_SIZE; i++)
+	{
+		m_slots[i].fence = 0;
+		m_slots[i].bPending = false;
+		m_slots[i].bSequenceFrame = false;
+		m_slots[i].frameNumber = 0;
+	}
+	m_nextSlot = 0;
+	m_width = 0;
+	m_height = 0;
+
+	m_activeJobs = 0;
+	m_bStopWorkers = false;
+
+	m_pY4MFile = NULL;
+	m_y4mWidth = 0;
+	m_y4mHeight = 0;
+	m_nextY4MFrame = 0;
+
+	m_capturedFrames = 0;
+	m_stalledFrames = 0;
+	m_droppedFrames = 0;
+	m_captureSeconds = 0.0;
+}
+
+/***********************************************************
+ *  ~FrameCapture()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+FrameCapture::~FrameCapture()
+{
+	Finish();
+}
+
+/***********************************************************
+ *  BeginSequence()
+ *
+ *  This method is used for capturing every following frame.
+ *  PNG sequences are written as numbered files that start
+ *  with the output path, and Y4M streams to the output path.
+ ***********************************************************/
+bool FrameCapture::BeginSequence(const char* outputPath, CAPTURE_FORMAT format, int framesPerSecond)
+{
+	if (m_bSequenceActive == true)
+	{
+		std::cout << "A frame capture sequence is already running" << std::endl;
+		return(false);
+	}
+
+	if (format == CAPTURE_Y4M)
+	{
+		m_pY4MFile = fopen(outputPath, "wb");
+		if (NULL == m_pY4MFile)
+		{
+			std::cout << "Could not open the capture stream:" << outputPath << std::endl;
+			return(false);
+		}
+		m_y4mWidth = 0;
+		m_y4mHeight = 0;
+		m_nextY4MFrame = 0;
+	}
+
+	m_bSequenceActive = true;
+	m_format = format;
+	m_outputPath = outputPath;
+	m_framesPerSecond = (framesPerSecond > 0) ? framesPerSecond : 60;
+	m_sequenceFrames = 0;
+
+	std::cout << "Capturing frames to " << outputPath << std::endl;
+
+	return(true);
+}
+
+/***********************************************************
+ *  RequestScreenshot()
+ *
+ *  This method is used for capturing the next frame to a PNG
+ *  file named after the current date and time.
+ ***********************************************************/
+void FrameCapture::RequestScreenshot()
+{
+	m_bScreenshotRequested = true;
+}
+
+/***********************************************************
+ *  CreateRing()
+ *
+ *  This method is used for creating the pixel buffers that
+ *  receive the frames read back from the framebuffer.
+ ***********************************************************/
+void FrameCapture::CreateRing(int width, int height)
+{
+	DestroyRing();
+
+	for (int i = 0; i < RING_SIZE; i++)
+	{
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, m_slots[i].pixelBuffer.Create("frame capture readback"));
+		glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)width * height * 4, NULL, GL_STREAM_READ);
+		m_slots[i].pixelBuffer.SetBytes((size_t)width * height * 4);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	m_nextSlot = 0;
+	m_width = width;
+	m_height = height;
+}
+
+/***********************************************************
+ *  DestroyRing()
+ *
+ *  This method is used for freeing the pixel buffers.  Any
+ *  readbacks still in flight are discarded.
+ ***********************************************************/
+void FrameCapture::DestroyRing()
+{
+	for (int i = 0; i < RING_SIZE; i++)
+	{
+		if (m_slots[i].fence != 0)
+		{
+			glDeleteSync(m_slots[i].fence);
+			m_slots[i].fence = 0;
+		}
+		m_slots[i].pixelBuffer.Reset();
+		m_slots[i].bPending = false;
+	}
+	m_width = 0;
+	m_height = 0;
+}
+
+/***********************************************************
+ *  CaptureFrame()
+ *
+ *  This method is used for capturing the rendered frame.  It
+ *  is called after rendering and before swapping buffers.
+ *  The earlier readbacks whose fences have signaled are
+ *  collected first, oldest first, and the new readback is
+ *  then queued into the next slot of the ring.
+ ***********************************************************/
+void FrameCapture::CaptureFrame(int width, int height)
+{
+	std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+	bool bCollected = false;
+	for (int i = 0; i < RING_SIZE; i++)
+	{
+		READBACK_SLOT& slot = m_slots[(m_nextSlot + i) % RING_SIZE];
+		if (slot.bPending == true)
+		{
+			// keep the frames in order by stopping at the first one
+			// that is still in flight
+			if (CollectSlot(slot, false) == false)
+			{
+				break;
+			}
+			bCollected = true;
+		}
+	}
+
+	bool bCapture = m_bSequenceActive || m_bScreenshotRequested;
+	if ((bCapture == true) && (width > 0) && (height > 0))
+	{
+		// the window was resized, so finish the frames in flight
+		// before the ring is created with the new size
+		if ((width != m_width) || (height != m_height))
+		{
+			for (int i = 0; i < RING_SIZE; i++)
+			{
+				READBACK_SLOT& slot = m_slots[(m_nextSlot + i) % RING_SIZE];
+				if (slot.bPending == true)
+				{
+					CollectSlot(slot, true);
+				}
+			}
+			CreateRing(width, height);
+		}
+
+		READBACK_SLOT& slot = m_slots[m_nextSlot];
+		if (slot.bPending == true)
+		{
+			// the GPU is more than a ring behind, so wait for it
+			CollectSlot(slot, true);
+			m_stalledFrames++;
+		}
+
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pixelBuffer.Get());
+		glPixelStorei(GL_PACK_ALIGNMENT, 4);
+		glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+		slot.bPending = true;
+		slot.bSequenceFrame = m_bSequenceActive;
+		slot.frameNumber = m_bSequenceActive ? m_sequenceFrames++ : 0;
+		slot.screenshotFilename.clear();
+		if (m_bScreenshotRequested == true)
+		{
+			char timeText[32];
+			time_t now = time(NULL);
+			strftime(timeText, sizeof(timeText), "%Y%m%d_%H%M%S", localtime(&now));
+
+			std::error_code error;
+			std::filesystem::create_directories(m_screenshotDirectory, error);
+			slot.screenshotFilename = m_screenshotDirectory + "/screenshot_" + timeText + "_" +
+				std::to_string(++m_screenshotCount) + ".png";
+			m_bScreenshotRequested = false;
+		}
+
+		m_nextSlot = (m_nextSlot + 1) % RING_SIZE;
+		m_capturedFrames++;
+	}
+
+	if ((bCapture == true) || (bCollected == true))
+	{
+		m_captureSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+	}
+}
+
+/***********************************************************
+ *  CollectSlot()
+ *
+ *  This method is used for copying a finished readback out
+ *  of its pixel buffer and queueing it for encoding.  It
+ *  returns false if the fence has not signaled and waiting
+ *  was not requested.
+ ***********************************************************/
+bool FrameCapture::CollectSlot(READBACK_SLOT& slot, bool bWait)
+{
+	GLenum result = glClientWaitSync(slot.fence, 0, 0);
+	while ((bWait == true) && (result == GL_TIMEOUT_EXPIRED))
+	{
+		result = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, g_FenceWaitNanoseconds);
+	}
+	if (result == GL_TIMEOUT_EXPIRED)
+	{
+		return(false);
+	}
+
+	glDeleteSync(slot.fence);
+	slot.fence = 0;
+	slot.bPending = false;
+
+	if (result == GL_WAIT_FAILED)
+	{
+		m_droppedFrames++;
+		return(true);
+	}
+
+	ENCODE_JOB job;
+	job.width = m_width;
+	job.height = m_height;
+	{
+		std::lock_guard<std::mutex> lock(m_jobMutex);
+		if (m_freeBuffers.empty() == false)
+		{
+			job.pixels.swap(m_freeBuffers.back());
+			m_freeBuffers.pop_back();
+		}
+	}
+
+	size_t size = (size_t)m_width * m_height * 4;
+	job.pixels.resize(size);
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pixelBuffer.Get());
+	const void* pMapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr)size, GL_MAP_READ_BIT);
+	if (NULL != pMapped)
+	{
+		memcpy(job.pixels.data(), pMapped, size);
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	if (NULL == pMapped)
+	{
+		m_droppedFrames++;
+		return(true);
+	}
+
+	if (slot.screenshotFilename.empty() == false)
+	{
+		ENCODE_JOB screenshot;
+		screenshot.format = CAPTURE_PNG;
+		screenshot.filename = slot.screenshotFilename;
+		screenshot.frameNumber = 0;
+		screenshot.width = job.width;
+		screenshot.height = job.height;
+		if (slot.bSequenceFrame == true)
+		{
+			screenshot.pixels = job.pixels;
+		}
+		else
+		{
+			screenshot.pixels.swap(job.pixels);
+		}
+		QueueJob(screenshot);
+	}
+
+	if (slot.bSequenceFrame == true)
+	{
+		job.format = m_format;
+		job.frameNumber = slot.frameNumber;
+		if (m_format == CAPTURE_PNG)
+		{
+			char frameText[16];
+			snprintf(frameText, sizeof(frameText), "_%06lld.png", slot.frameNumber);
+			job.filename = m_outputPath + frameText;
+		}
+		QueueJob(job);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  QueueJob()
+ *
+ *  This method is used for passing a frame to the encoder
+ *  threads.  When the encoders fall behind, the render loop
+ *  waits instead of dropping frames of the sequence.
+ ***********************************************************/
+void FrameCapture::QueueJob(ENCODE_JOB& job)
+{
+	if (m_workers.empty() == true)
+	{
+		StartWorkers();
+	}
+
+	std::unique_lock<std::mutex> lock(m_jobMutex);
+	if ((int)m_jobs.size() >= MAX_QUEUED_FRAMES)
+	{
+		m_stalledFrames++;
+		m_jobDone.wait(lock, [this] { return((int)m_jobs.size() < MAX_QUEUED_FRAMES); });
+	}
+	m_jobs.push_back(std::move(job));
+	m_jobReady.notify_one();
+}
+
+/***********************************************************
+ *  StartWorkers()
+ *
+ *  This method is used for starting the encoder threads,
+ *  leaving half of the cores to the render loop and driver.
+ ***********************************************************/
+void FrameCapture::StartWorkers()
+{
+	int workerCount = (int)std::thread::hardware_concurrency() / 2;
+	workerCount = std::min(std::max(workerCount, 1), 4);
+
+	m_bStopWorkers = false;
+	for (int i = 0; i < workerCount; i++)
+	{
+		m_workers.push_back(std::thread(&FrameCapture::WorkerThread, this));
+	}
+}
+
+/***********************************************************
+ *  StopWorkers()
+ *
+ *  This method is used for stopping the encoder threads once
+ *  all of the queued jobs are encoded.
+ ***********************************************************/
+void FrameCapture::StopWorkers()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_jobMutex);
+		m_bStopWorkers = true;
+	}
+	m_jobReady.notify_all();
+
+	for (size_t i = 0; i < m_workers.size(); i++)
+	{
+		m_workers[i].join();
+	}
+	m_workers.clear();
+}
+
+/***********************************************************
+ *  WorkerThread()
+ *
+ *  This method is run by each encoder thread.
+ ***********************************************************/
+void FrameCapture::WorkerThread()
+{
+	std::unique_lock<std::mutex> lock(m_jobMutex);
+	while (true)
+	{
+		m_jobReady.wait(lock, [this] { return(!m_jobs.empty() || m_bStopWorkers); });
+		if (m_jobs.empty() == true)
+		{
+			return;
+		}
+
+		ENCODE_JOB job = std::move(m_jobs.front());
+		m_jobs.pop_front();
+		m_activeJobs++;
+		lock.unlock();
+		m_jobDone.notify_all();
+
+		EncodeJob(job);
+
+		lock.lock();
+		m_freeBuffers.push_back(std::move(job.pixels));
+		m_activeJobs--;
+		m_jobDone.notify_all();
+	}
+}
+
+/***********************************************************
+ *  EncodeJob()
+ *
+ *  This method is used for encoding a captured frame.
+ ***********************************************************/
+void FrameCapture::EncodeJob(ENCODE_JOB& job)
+{
+	if (job.format == CAPTURE_Y4M)
+	{
+		std::vector<unsigned char> yuv;
+		ConvertToYUV420(job.pixels.data(), job.width, job.height, yuv);
+		WriteY4MFrame(job, yuv);
+		return;
+	}
+
+	IMAGE_DATA image;
+	image.width = job.width;
+	image.height = job.height;
+	image.channels = 4;
+	image.pixels.swap(job.pixels);
+	ImageIO::FlipRows(image);
+	ImageIO::WritePNG(job.filename.c_str(), image);
+	job.pixels.swap(image.pixels);
+}
+
+/***********************************************************
+ *  WriteY4MFrame()
+ *
+ *  This method is used for appending a converted frame to
+ *  the Y4M stream.  The workers take turns by frame number,
+ *  and frames that no longer match the size in the stream
+ *  header are skipped.
+ ***********************************************************/
+void FrameCapture::WriteY4MFrame(ENCODE_JOB& job, std::vector<unsigned char>& yuv)
+{
+	std::unique_lock<std::mutex> lock(m_y4mMutex);
+	m_y4mTurn.wait(lock, [this, &job] { return(m_nextY4MFrame == job.frameNumber); });
+
+	if (job.frameNumber == 0)
+	{
+		m_y4mWidth = job.width;
+		m_y4mHeight = job.height;
+		fprintf(m_pY4MFile, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n",
+			m_y4mWidth, m_y4mHeight, m_framesPerSecond);
+	}
+
+	if ((job.width == m_y4mWidth) && (job.height == m_y4mHeight))
+	{
+		fputs("FRAME\n", m_pY4MFile);
+		fwrite(yuv.data(), 1, yuv.size(), m_pY4MFile);
+	}
+	else
+	{
+		m_droppedFrames++;
+	}
+
+	m_nextY4MFrame++;
+	m_y4mTurn.notify_all();
+}
+
+/***********************************************************
+ *  Finish()
+ *
+ *  This method is used for completing the capture.  All of
+ *  the readbacks in flight are collected, the encoders are
+ *  drained and the capture costs are reported.
+ ***********************************************************/
+void FrameCapture::Finish()
+{
+	for (int i = 0; i < RING_SIZE; i++)
+	{
+		READBACK_SLOT& slot = m_slots[(m_nextSlot + i) % RING_SIZE];
+		if (slot.bPending == true)
+		{
+			CollectSlot(slot, true);
+		}
+	}
+	StopWorkers();
+	DestroyRing();
+
+	if (NULL != m_pY4MFile)
+	{
+		fclose(m_pY4MFile);
+		m_pY4MFile = NULL;
+	}
+	m_bSequenceActive = false;
+
+	if (m_capturedFrames > 0)
+	{
+		std::cout << "Captured " << m_capturedFrames << " frames, "
+			<< m_stalledFrames << " stalled, "
+			<< m_droppedFrames << " dropped, "
+			<< (m_captureSeconds * 1000.0 / m_capturedFrames) << " ms per frame in the render loop" << std::endl;
+		m_capturedFrames = 0;
+		m_stalledFrames = 0;
+		m_droppedFrames = 0;
+		m_captureSeconds = 0.0;
+	}
+}
@@ -0,0 +1,148 @@
+///////////////////////////////////////////////////////////////////////////////
+// framecapture.h
+// ============
+// capture rendered frames without stalling the render loop, by reading
+// them into a ring of pixel buffer objects and encoding them on
+// background threads
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "GpuResources.h"
+
+#include <GL/glew.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/***********************************************************
+ *  FrameCapture
+ *
+ *  This class captures screenshots and image sequences from
+ *  the framebuffer.  Every captured frame is read into a
+ *  pixel buffer object with a fence, and is only mapped a
+ *  few frames later once the fence has signaled, so the CPU
+ *  never waits for the GPU.  The PNG and Y4M encoding runs
+ *  on worker threads.
+ ***********************************************************/
+class FrameCapture
+{
+public:
+	// constructor
+	FrameCapture(const char* screenshotDirectory);
+	// destructor
+	~FrameCapture();
+
+	// output formats for the captured image sequences
+	enum CAPTURE_FORMAT
+	{
+		// numbered PNG files starting with the output path
+		CAPTURE_PNG,
+		// one raw YUV 4:2:0 stream, which can also be a named
+		// pipe read by a video encoder
+		CAPTURE_Y4M
+	};
+
+	// capture every following frame to the output path
+	bool BeginSequence(const char* outputPath, CAPTURE_FORMAT format, int framesPerSecond);
+	// capture the next frame to a new file in the screenshot directory
+	void RequestScreenshot();
+	// queue the readback of the frame in the back buffer, and pass
+	// the finished readbacks of earlier frames to the encoders
+	void CaptureFrame(int width, int height);
+	// wait for all of the readbacks and encoding to complete
+	void Finish();
+	// get the number of sequence frames dropped so far
+	long long GetDroppedFrames() const { return(m_droppedFrames.load()); }
+
+private:
+	// frames in flight between the readback and the mapping
+	static const int RING_SIZE = 3;
+	// frames waiting for the encoders before capturing blocks
+	static const int MAX_QUEUED_FRAMES = 8;
+
+	struct READBACK_SLOT
+	{
+		GpuBuffer pixelBuffer;
+		GLsync fence;
+		bool bPending;
+		bool bSequenceFrame;
+		long long frameNumber;
+		std::string screenshotFilename;
+	};
+
+	struct ENCODE_JOB
+	{
+		CAPTURE_FORMAT format;
+		// PNG file name, empty for frames of the Y4M stream
+		std::string filename;
+		long long frameNumber;
+		int width;
+		int height;
+		// RGBA pixels, bottom row first
+		std::vector<unsigned char> pixels;
+	};
+
+	std::string m_screenshotDirectory;
+	int m_screenshotCount;
+	bool m_bScreenshotRequested;
+
+	// image sequence settings
+	bool m_bSequenceActive;
+	CAPTURE_FORMAT m_format;
+	std::string m_outputPath;
+	int m_framesPerSecond;
+	long long m_sequenceFrames;
+
+	// readback ring
+	READBACK_SLOT m_slots[RING_SIZE];
+	int m_nextSlot;
+	int m_width;
+	int m_height;
+
+	// encoder threads and their queue
+	std::vector<std::thread> m_workers;
+	std::deque<ENCODE_JOB> m_jobs;
+	std::vector<std::vector<unsigned char>> m_freeBuffers;
+	std::mutex m_jobMutex;
+	std::condition_variable m_jobReady;
+	std::condition_variable m_jobDone;
+	int m_activeJobs;
+	bool m_bStopWorkers;
+
+	// the Y4M frames are written in order by whichever worker
+	// converted them
+	FILE* m_pY4MFile;
+	int m_y4mWidth;
+	int m_y4mHeight;
+	long long m_nextY4MFrame;
+	std::mutex m_y4mMutex;
+	std::condition_variable m_y4mTurn;
+
+	// statistics reported when the capture finishes
+	long long m_capturedFrames;
+	long long m_stalledFrames;
+	std::atomic<long long> m_droppedFrames;
+	double m_captureSeconds;
+
+	// create or resize the pixel buffers of the ring
+	void CreateRing(int width, int height);
+	void DestroyRing();
+	// map the finished readback of the slot and queue its encoding,
+	// waiting for the fence only when bWait is true
+	bool CollectSlot(READBACK_SLOT& slot, bool bWait);
+	// queue a job for the encoder threads
+	void QueueJob(ENCODE_JOB& job);
+	void StartWorkers();
+	void StopWorkers();
+	void WorkerThread();
+	// encode a job on the calling worker thread
+	void EncodeJob(ENCODE_JOB& job);
+	void WriteY4MFrame(ENCODE_JOB& job, std::vector<unsigned char>& yuv);
+};
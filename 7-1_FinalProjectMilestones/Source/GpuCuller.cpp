@@ -0,0 +1,545 @@
+///////////////////////////////////////////////////////////////////////////////
+// gpuculler.cpp
+// ============
+// cull the scene objects in a compute shader and draw the visible ones
+// through indirect draw commands, without reading anything back
+///////////////////////////////////////////////////////////////////////////////
+
+#include "GpuCuller.h"
+#include "CompactMeshes.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// threads of the compute shader work groups, matching the
+	// local sizes declared by the shaders
+	const GLuint g_CullGroupSize = 64;
+	const GLuint g_PyramidGroupSize = 8;
+
+	// texture unit of the depth textures, past the units that hold
+	// the 16 texture slots of the scene
+	const GLuint g_DepthTextureUnit = 16;
+
+	// first attribute location of the per-object settings
+	const GLuint g_InstanceLocation = 3;
+
+	// binding points of the storage buffers in the culling shader
+	enum STORAGE_BINDING
+	{
+		BINDING_OBJECTS,
+		BINDING_MESHES,
+		BINDING_BUCKETS,
+		BINDING_COUNTS,
+		BINDING_COMMANDS
+	};
+}
+
+/***********************************************************
+ *  GpuCuller()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+GpuCuller::GpuCuller()
+{
+	m_objectCount = 0;
+	m_bIndirectCount = false;
+	m_objectCountLocation = -1;
+	m_frustumPlanesLocation = -1;
+	m_useOcclusionLocation = -1;
+	m_previousViewProjectionLocation = -1;
+	m_depthPyramidLocation = -1;
+	m_pyramidSizeLocation = -1;
+	m_pyramidLevelsLocation = -1;
+	m_bOcclusion = false;
+	m_sourceDepthLocation = -1;
+	m_sourceLevelLocation = -1;
+	m_depthWidth = 0;
+	m_depthHeight = 0;
+	m_pyramidWidth = 0;
+	m_pyramidHeight = 0;
+	m_pyramidLevels = 0;
+	m_previousViewProjection = glm::mat4(1.0f);
+	m_bHistoryValid = false;
+}
+
+/***********************************************************
+ *  ~GpuCuller()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+GpuCuller::~GpuCuller()
+{
+}
+
+/***********************************************************
+ *  IsSupported()
+ *
+ *  This method is used for checking that the driver has the
+ *  compute shaders, storage buffers and multi-draw indirect
+ *  calls of OpenGL 4.3.
+ ***********************************************************/
+bool GpuCuller::IsSupported()
+{
+	return(GLEW_VERSION_4_3 == GL_TRUE);
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for loading the compute programs,
+ *  caching their uniform locations and uploading the merged
+ *  meshes.  The depth pyramid program is only loaded when
+ *  the occlusion test is enabled.
+ ***********************************************************/
+bool GpuCuller::Initialize(
+	ShaderCache* pShaderCache,
+	const char* cullFilePath,
+	const char* pyramidFilePath,
+	bool bOcclusion)
+{
+	if ((NULL == pShaderCache) || (IsSupported() == false))
+	{
+		return(false);
+	}
+
+	GLuint programID = pShaderCache->LoadComputeProgram(cullFilePath);
+	if (programID == 0)
+	{
+		return(false);
+	}
+	m_cullProgram.Adopt(programID, "culling program");
+	m_objectCountLocation = glGetUniformLocation(programID, "objectCount");
+	m_frustumPlanesLocation = glGetUniformLocation(programID, "frustumPlanes");
+	m_useOcclusionLocation = glGetUniformLocation(programID, "bUseOcclusion");
+	m_previousViewProjectionLocation = glGetUniformLocation(programID, "previousViewProjection");
+	m_depthPyramidLocation = glGetUniformLocation(programID, "depthPyramid");
+	m_pyramidSizeLocation = glGetUniformLocation(programID, "pyramidSize");
+	m_pyramidLevelsLocation = glGetUniformLocation(programID, "pyramidLevels");
+
+	if (bOcclusion == true)
+	{
+		programID = pShaderCache->LoadComputeProgram(pyramidFilePath);
+		if (programID != 0)
+		{
+			m_pyramidProgram.Adopt(programID, "depth pyramid program");
+			m_sourceDepthLocation = glGetUniformLocation(programID, "sourceDepth");
+			m_sourceLevelLocation = glGetUniformLocation(programID, "sourceLevel");
+			m_bOcclusion = true;
+		}
+		else
+		{
+			std::cout << "Could not build the depth pyramid program, culling without occlusion" << std::endl;
+		}
+	}
+
+	// without the count from the buffer, the commands past the
+	// visible objects of a bucket are drawn with no instances
+	m_bIndirectCount = (GLEW_ARB_indirect_parameters == GL_TRUE);
+
+	LoadMeshes();
+
+	std::cout << "GPU culling enabled"
+		<< (m_bOcclusion ? " with occlusion" : "")
+		<< (m_bIndirectCount ? ", draw counts from the GPU" : ", fixed draw counts") << std::endl;
+
+	return(true);
+}
+
+/***********************************************************
+ *  LoadMeshes()
+ *
+ *  This method is used for building the basic shapes into a
+ *  single vertex and index buffer, with a table of where each
+ *  shape starts for the culling pass.  The vertex array also
+ *  reads the per-object settings from the instance buffer.
+ ***********************************************************/
+void GpuCuller::LoadMeshes()
+{
+	std::vector<CompactMeshes::MESH_VERTEX> vertices;
+	std::vector<uint32_t> indices;
+	std::vector<glm::ivec4> meshTable(CompactMeshes::MESH_COUNT);
+	for (int mesh = 0; mesh < CompactMeshes::MESH_COUNT; mesh++)
+	{
+		CompactMeshes::MESH_DATA data;
+		CompactMeshes::BuildMesh(mesh, data);
+		meshTable[mesh] = glm::ivec4(
+			(int)data.indices.size(),
+			(int)indices.size(),
+			(int)vertices.size(),
+			0);
+		vertices.insert(vertices.end(), data.vertices.begin(), data.vertices.end());
+		indices.insert(indices.end(), data.indices.begin(), data.indices.end());
+	}
+
+	glBindVertexArray(m_vertexArray.Create("culled meshes"));
+
+	glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer.Create("culled mesh vertices"));
+	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(CompactMeshes::MESH_VERTEX), vertices.data(), GL_STATIC_DRAW);
+	m_vertexBuffer.SetBytes(vertices.size() * sizeof(CompactMeshes::MESH_VERTEX));
+
+	GLsizei stride = sizeof(CompactMeshes::MESH_VERTEX);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(CompactMeshes::MESH_VERTEX, position));
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(CompactMeshes::MESH_VERTEX, normal));
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(CompactMeshes::MESH_VERTEX, uv));
+	glEnableVertexAttribArray(2);
+
+	// one set of the per-object attributes for each instance, where
+	// the base instance of a command is the index of its object
+	glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer.Create("culled object settings"));
+	GLsizei instanceStride = sizeof(OBJECT_INSTANCE);
+	for (GLuint column = 0; column < 4; column++)
+	{
+		glVertexAttribPointer(g_InstanceLocation + column, 4, GL_FLOAT, GL_FALSE, instanceStride,
+			(void*)(offsetof(OBJECT_INSTANCE, model) + column * sizeof(glm::vec4)));
+	}
+	glVertexAttribPointer(g_InstanceLocation + 4, 4, GL_FLOAT, GL_FALSE, instanceStride, (void*)offsetof(OBJECT_INSTANCE, color));
+	glVertexAttribPointer(g_InstanceLocation + 5, 4, GL_FLOAT, GL_FALSE, instanceStride, (void*)offsetof(OBJECT_INSTANCE, uvScale));
+	glVertexAttribPointer(g_InstanceLocation + 6, 4, GL_FLOAT, GL_FALSE, instanceStride, (void*)offsetof(OBJECT_INSTANCE, ambient));
+	glVertexAttribPointer(g_InstanceLocation + 7, 4, GL_FLOAT, GL_FALSE, instanceStride, (void*)offsetof(OBJECT_INSTANCE, diffuse));
+	glVertexAttribPointer(g_InstanceLocation + 8, 4, GL_FLOAT, GL_FALSE, instanceStride, (void*)offsetof(OBJECT_INSTANCE, specular));
+	for (GLuint location = g_InstanceLocation; location < g_InstanceLocation + 9; location++)
+	{
+		glEnableVertexAttribArray(location);
+		glVertexAttribDivisor(location, 1);
+	}
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer.Create("culled mesh indices"));
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint32_t), indices.data(), GL_STATIC_DRAW);
+	m_indexBuffer.SetBytes(indices.size() * sizeof(uint32_t));
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_meshBuffer.Create("culled mesh table"));
+	glBufferData(GL_SHADER_STORAGE_BUFFER, meshTable.size() * sizeof(glm::ivec4), meshTable.data(), GL_STATIC_DRAW);
+	m_meshBuffer.SetBytes(meshTable.size() * sizeof(glm::ivec4));
+
+	m_bucketBuffer.Create("culling buckets");
+	m_countBuffer.Create("culling draw counts");
+	m_commandBuffer.Create("culling draw commands");
+	m_boundsBuffer.Create("culled object bounds");
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+/***********************************************************
+ *  SetObjects()
+ *
+ *  This method is used for uploading the objects, which then
+ *  stay resident until the next call.  Every bucket is given
+ *  a range of the command buffer large enough for all of its
+ *  objects.
+ ***********************************************************/
+void GpuCuller::SetObjects(
+	const std::vector<OBJECT_INSTANCE>& instances,
+	const std::vector<OBJECT_BOUNDS>& bounds,
+	int bucketCount)
+{
+	m_objectCount = (int)std::min(instances.size(), bounds.size());
+	m_bucketCapacities.assign(std::max(bucketCount, 1), 0);
+	m_bucketFirstCommands.assign(m_bucketCapacities.size(), 0);
+	for (int i = 0; i < m_objectCount; i++)
+	{
+		if (bounds[i].bucket < m_bucketCapacities.size())
+		{
+			m_bucketCapacities[bounds[i].bucket]++;
+		}
+	}
+	int firstCommand = 0;
+	std::vector<GLuint> bucketFirstCommands(m_bucketCapacities.size());
+	for (size_t bucket = 0; bucket < m_bucketCapacities.size(); bucket++)
+	{
+		m_bucketFirstCommands[bucket] = firstCommand;
+		bucketFirstCommands[bucket] = (GLuint)firstCommand;
+		firstCommand += m_bucketCapacities[bucket];
+	}
+
+	// the buffers are sized for at least one object, so that they
+	// can always be bound
+	size_t objectCount = std::max(m_objectCount, 1);
+
+	glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer.Get());
+	glBufferData(GL_ARRAY_BUFFER, objectCount * sizeof(OBJECT_INSTANCE), NULL, GL_STATIC_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, m_objectCount * sizeof(OBJECT_INSTANCE), instances.data());
+	m_instanceBuffer.SetBytes(objectCount * sizeof(OBJECT_INSTANCE));
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_boundsBuffer.Get());
+	glBufferData(GL_SHADER_STORAGE_BUFFER, objectCount * sizeof(OBJECT_BOUNDS), NULL, GL_STATIC_DRAW);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, m_objectCount * sizeof(OBJECT_BOUNDS), bounds.data());
+	m_boundsBuffer.SetBytes(objectCount * sizeof(OBJECT_BOUNDS));
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_bucketBuffer.Get());
+	glBufferData(GL_SHADER_STORAGE_BUFFER, bucketFirstCommands.size() * sizeof(GLuint), bucketFirstCommands.data(), GL_STATIC_DRAW);
+	m_bucketBuffer.SetBytes(bucketFirstCommands.size() * sizeof(GLuint));
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_countBuffer.Get());
+	glBufferData(GL_SHADER_STORAGE_BUFFER, m_bucketCapacities.size() * sizeof(GLuint), NULL, GL_DYNAMIC_DRAW);
+	m_countBuffer.SetBytes(m_bucketCapacities.size() * sizeof(GLuint));
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_commandBuffer.Get());
+	glBufferData(GL_SHADER_STORAGE_BUFFER, objectCount * sizeof(DRAW_COMMAND), NULL, GL_DYNAMIC_DRAW);
+	m_commandBuffer.SetBytes(objectCount * sizeof(DRAW_COMMAND));
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	// the depth of the last frame may not show the new objects
+	m_bHistoryValid = false;
+}
+
+/***********************************************************
+ *  Cull()
+ *
+ *  This method is used for running the culling pass.  The
+ *  draw counts are cleared, the compute shader appends the
+ *  commands of the visible objects, and the barrier makes
+ *  them visible to the indirect draws that follow.
+ ***********************************************************/
+void GpuCuller::Cull(const glm::mat4& viewProjection)
+{
+	if (m_objectCount == 0)
+	{
+		return;
+	}
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_countBuffer.Get());
+	glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, NULL);
+	if (m_bIndirectCount == false)
+	{
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_commandBuffer.Get());
+		glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, NULL);
+	}
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	// planes of the frustum from the rows of the matrix, with the
+	// normals pointing inside
+	glm::vec4 rows[4];
+	for (int row = 0; row < 4; row++)
+	{
+		rows[row] = glm::vec4(viewProjection[0][row], viewProjection[1][row], viewProjection[2][row], viewProjection[3][row]);
+	}
+	glm::vec4 planes[6] =
+	{
+		rows[3] + rows[0],
+		rows[3] - rows[0],
+		rows[3] + rows[1],
+		rows[3] - rows[1],
+		rows[3] + rows[2],
+		rows[3] - rows[2]
+	};
+
+	glUseProgram(m_cullProgram.Get());
+	glUniform1ui(m_objectCountLocation, (GLuint)m_objectCount);
+	glUniform4fv(m_frustumPlanesLocation, 6, glm::value_ptr(planes[0]));
+
+	bool bUseOcclusion = (m_bOcclusion == true) && (m_bHistoryValid == true);
+	glUniform1i(m_useOcclusionLocation, bUseOcclusion);
+	if (bUseOcclusion == true)
+	{
+		glUniformMatrix4fv(m_previousViewProjectionLocation, 1, GL_FALSE, glm::value_ptr(m_previousViewProjection));
+		glUniform2f(m_pyramidSizeLocation, (float)m_pyramidWidth, (float)m_pyramidHeight);
+		glUniform1i(m_pyramidLevelsLocation, m_pyramidLevels);
+		glActiveTexture(GL_TEXTURE0 + g_DepthTextureUnit);
+		glBindTexture(GL_TEXTURE_2D, m_pyramidTexture.Get());
+		glActiveTexture(GL_TEXTURE0);
+		glUniform1i(m_depthPyramidLocation, g_DepthTextureUnit);
+	}
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BINDING_OBJECTS, m_boundsBuffer.Get());
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BINDING_MESHES, m_meshBuffer.Get());
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BINDING_BUCKETS, m_bucketBuffer.Get());
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BINDING_COUNTS, m_countBuffer.Get());
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BINDING_COMMANDS, m_commandBuffer.Get());
+
+	glDispatchCompute((m_objectCount + g_CullGroupSize - 1) / g_CullGroupSize, 1, 1);
+	glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+/***********************************************************
+ *  BeginDraws()
+ *
+ *  This method is used for binding the merged meshes and the
+ *  buffers that the indirect draws read.
+ ***********************************************************/
+void GpuCuller::BeginDraws()
+{
+	glBindVertexArray(m_vertexArray.Get());
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer.Get());
+	if (m_bIndirectCount == true)
+	{
+		glBindBuffer(GL_PARAMETER_BUFFER_ARB, m_countBuffer.Get());
+	}
+}
+
+/***********************************************************
+ *  DrawBucket()
+ *
+ *  This method is used for drawing the commands of the
+ *  bucket.  With the indirect parameters the number of draws
+ *  comes from the count written by the culling pass, and
+ *  otherwise every command of the range is issued, with the
+ *  ones that were not written drawing nothing.
+ ***********************************************************/
+void GpuCuller::DrawBucket(int bucket)
+{
+	int capacity = GetBucketCapacity(bucket);
+	if (capacity == 0)
+	{
+		return;
+	}
+
+	const void* pCommands = (const void*)(m_bucketFirstCommands[bucket] * sizeof(DRAW_COMMAND));
+	if (m_bIndirectCount == true)
+	{
+		glMultiDrawElementsIndirectCountARB(
+			GL_TRIANGLES,
+			GL_UNSIGNED_INT,
+			pCommands,
+			(GLintptr)(bucket * sizeof(GLuint)),
+			capacity,
+			0);
+	}
+	else
+	{
+		glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, pCommands, capacity, 0);
+	}
+}
+
+/***********************************************************
+ *  EndDraws()
+ *
+ *  This method is used for unbinding the merged meshes and
+ *  the command buffers.
+ ***********************************************************/
+void GpuCuller::EndDraws()
+{
+	glBindVertexArray(0);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	if (m_bIndirectCount == true)
+	{
+		glBindBuffer(GL_PARAMETER_BUFFER_ARB, 0);
+	}
+}
+
+/***********************************************************
+ *  GetBucketCapacity()
+ *
+ *  This method is used for getting the number of objects in
+ *  the bucket, which is the most draws it can have.
+ ***********************************************************/
+int GpuCuller::GetBucketCapacity(int bucket) const
+{
+	if ((bucket < 0) || (bucket >= (int)m_bucketCapacities.size()))
+	{
+		return(0);
+	}
+	return(m_bucketCapacities[bucket]);
+}
+
+/***********************************************************
+ *  CreateDepthPyramid()
+ *
+ *  This method is used for creating the copy of the depth
+ *  buffer and the pyramid of its farthest depths.  The first
+ *  level of the pyramid is half the size of the depth, and
+ *  every level after it halves again down to one texel.
+ ***********************************************************/
+void GpuCuller::CreateDepthPyramid(int width, int height)
+{
+	m_depthWidth = width;
+	m_depthHeight = height;
+	m_pyramidWidth = std::max(width / 2, 1);
+	m_pyramidHeight = std::max(height / 2, 1);
+	m_pyramidLevels = 1;
+	while ((std::max(m_pyramidWidth, m_pyramidHeight) >> m_pyramidLevels) > 0)
+	{
+		m_pyramidLevels++;
+	}
+
+	glBindTexture(GL_TEXTURE_2D, m_depthTexture.Create("culling depth copy"));
+	glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH_COMPONENT32F, width, height);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	m_depthTexture.SetBytes((size_t)width * height * sizeof(float));
+
+	glBindTexture(GL_TEXTURE_2D, m_pyramidTexture.Create("culling depth pyramid"));
+	glTexStorage2D(GL_TEXTURE_2D, m_pyramidLevels, GL_R32F, m_pyramidWidth, m_pyramidHeight);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	// the levels add up to a third more than the first one
+	m_pyramidTexture.SetBytes((size_t)m_pyramidWidth * m_pyramidHeight * sizeof(float) * 4 / 3);
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+/***********************************************************
+ *  CaptureDepth()
+ *
+ *  This method is used for copying the depth of the viewport
+ *  after the opaque draws, and reducing it into the pyramid
+ *  that the next frame tests its objects against.  Each level
+ *  keeps the farthest depth of the texels it covers, so a
+ *  test against it never hides a visible object.
+ ***********************************************************/
+void GpuCuller::CaptureDepth(const glm::mat4& viewProjection)
+{
+	if ((m_bOcclusion == false) || (m_objectCount == 0))
+	{
+		return;
+	}
+
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	if ((viewport[2] <= 0) || (viewport[3] <= 0))
+	{
+		return;
+	}
+	if ((viewport[2] != m_depthWidth) || (viewport[3] != m_depthHeight))
+	{
+		CreateDepthPyramid(viewport[2], viewport[3]);
+	}
+
+	glActiveTexture(GL_TEXTURE0 + g_DepthTextureUnit);
+	glBindTexture(GL_TEXTURE_2D, m_depthTexture.Get());
+	glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, viewport[0], viewport[1], viewport[2], viewport[3]);
+
+	glUseProgram(m_pyramidProgram.Get());
+	glUniform1i(m_sourceDepthLocation, g_DepthTextureUnit);
+	int width = m_pyramidWidth;
+	int height = m_pyramidHeight;
+	for (int level = 0; level < m_pyramidLevels; level++)
+	{
+		// the first level reads the depth copy, and the others the
+		// level before them
+		if (level == 0)
+		{
+			glBindTexture(GL_TEXTURE_2D, m_depthTexture.Get());
+			glUniform1i(m_sourceLevelLocation, 0);
+		}
+		else
+		{
+			glBindTexture(GL_TEXTURE_2D, m_pyramidTexture.Get());
+			glUniform1i(m_sourceLevelLocation, level - 1);
+		}
+		glBindImageTexture(0, m_pyramidTexture.Get(), level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+		glDispatchCompute(
+			(width + g_PyramidGroupSize - 1) / g_PyramidGroupSize,
+			(height + g_PyramidGroupSize - 1) / g_PyramidGroupSize,
+			1);
+		glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+
+		width = std::max(width / 2, 1);
+		height = std::max(height / 2, 1);
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glActiveTexture(GL_TEXTURE0);
+
+	m_previousViewProjection = viewProjection;
+	m_bHistoryValid = true;
+}
@@ -0,0 +1,171 @@
+///////////////////////////////////////////////////////////////////////////////
+// gpuculler.h
+// ============
+// cull the scene objects in a compute shader and draw the visible ones
+// through indirect draw commands, without reading anything back
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "GpuResources.h"
+#include "ShaderCache.h"
+
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  GpuCuller
+ *
+ *  This class keeps the opaque scene objects resident in
+ *  video memory and decides on the GPU which of them are
+ *  drawn.  A compute pass tests the world bounds of every
+ *  object against the view frustum, and optionally against a
+ *  depth pyramid built from the previous frame, and appends
+ *  an indirect draw command for each visible object to the
+ *  range of its bucket.  The buckets group the objects that
+ *  share the shader settings that are not per object, so
+ *  each one is drawn by a single multi-draw call.  All of the
+ *  basic shapes live in one vertex and index buffer, and the
+ *  base instance of each command selects the per-object
+ *  attributes, which works on drivers without the
+ *  gl_BaseInstance shader input, such as Mesa llvmpipe.
+ ***********************************************************/
+class GpuCuller
+{
+public:
+	// constructor
+	GpuCuller();
+	// destructor
+	~GpuCuller();
+
+	// per-object settings, read by the vertex shader as instanced
+	// attributes from locations 3 to 11
+	struct OBJECT_INSTANCE
+	{
+		glm::mat4 model;
+		glm::vec4 color;
+		// texture coordinate scale in x and y
+		glm::vec4 uvScale;
+		// material colors, with the ambient strength in the alpha of
+		// the ambient color and the shininess in the alpha of the
+		// specular color
+		glm::vec4 ambient;
+		glm::vec4 diffuse;
+		glm::vec4 specular;
+	};
+
+	// per-object values read by the culling pass, in the std430
+	// layout of the shader
+	struct OBJECT_BOUNDS
+	{
+		// world space bounding box, with w unused
+		glm::vec4 boundsMin;
+		glm::vec4 boundsMax;
+		uint32_t mesh;
+		uint32_t bucket;
+		uint32_t padding[2];
+	};
+
+	// true when the driver has compute shaders and indirect draws
+	static bool IsSupported();
+
+	// load the compute programs and upload the basic shapes, in the
+	// order of SceneManager::MESH_TYPE
+	bool Initialize(
+		ShaderCache* pShaderCache,
+		const char* cullFilePath,
+		const char* pyramidFilePath,
+		bool bOcclusion);
+	// replace the resident objects, which are grouped into the
+	// number of buckets by their bucket field
+	void SetObjects(
+		const std::vector<OBJECT_INSTANCE>& instances,
+		const std::vector<OBJECT_BOUNDS>& bounds,
+		int bucketCount);
+	// run the culling pass for the view of the next draws
+	void Cull(const glm::mat4& viewProjection);
+	// bind the merged meshes and the command buffers for drawing
+	void BeginDraws();
+	// draw the visible objects of the bucket with the bound program
+	void DrawBucket(int bucket);
+	// restore the bindings changed by BeginDraws()
+	void EndDraws();
+	// build the depth pyramid from the depth of the bound framebuffer,
+	// for the occlusion test of the next frame
+	void CaptureDepth(const glm::mat4& viewProjection);
+
+	// number of resident objects
+	int GetObjectCount() const { return(m_objectCount); }
+	// most objects that the bucket can draw
+	int GetBucketCapacity(int bucket) const;
+	int GetBucketCount() const { return((int)m_bucketCapacities.size()); }
+	// true when the objects are also tested against the depth of
+	// the previous frame
+	bool IsOcclusionEnabled() const { return(m_bOcclusion); }
+
+private:
+	// layout of the commands read by glMultiDrawElementsIndirect
+	struct DRAW_COMMAND
+	{
+		GLuint count;
+		GLuint instanceCount;
+		GLuint firstIndex;
+		GLint baseVertex;
+		GLuint baseInstance;
+	};
+
+	// all of the basic shapes, with the index count, first index and
+	// base vertex of each in the mesh table
+	GpuVertexArray m_vertexArray;
+	GpuBuffer m_vertexBuffer;
+	GpuBuffer m_indexBuffer;
+	GpuBuffer m_meshBuffer;
+
+	// resident objects and the buffers written by the culling pass
+	GpuBuffer m_instanceBuffer;
+	GpuBuffer m_boundsBuffer;
+	GpuBuffer m_bucketBuffer;
+	GpuBuffer m_countBuffer;
+	GpuBuffer m_commandBuffer;
+	int m_objectCount;
+	// first command and number of objects of every bucket
+	std::vector<int> m_bucketFirstCommands;
+	std::vector<int> m_bucketCapacities;
+	// true when the draw counts are read from the count buffer,
+	// otherwise the unused commands are cleared to draw nothing
+	bool m_bIndirectCount;
+
+	GpuProgram m_cullProgram;
+	GLint m_objectCountLocation;
+	GLint m_frustumPlanesLocation;
+	GLint m_useOcclusionLocation;
+	GLint m_previousViewProjectionLocation;
+	GLint m_depthPyramidLocation;
+	GLint m_pyramidSizeLocation;
+	GLint m_pyramidLevelsLocation;
+
+	// copy of the depth buffer and its max reduction, with the view
+	// they were captured with
+	bool m_bOcclusion;
+	GpuProgram m_pyramidProgram;
+	GLint m_sourceDepthLocation;
+	GLint m_sourceLevelLocation;
+	GpuTexture m_depthTexture;
+	GpuTexture m_pyramidTexture;
+	int m_depthWidth;
+	int m_depthHeight;
+	int m_pyramidWidth;
+	int m_pyramidHeight;
+	int m_pyramidLevels;
+	glm::mat4 m_previousViewProjection;
+	// false until a pyramid was built for the current objects
+	bool m_bHistoryValid;
+
+	// upload the basic shapes into the merged buffers
+	void LoadMeshes();
+	// recreate the depth copy and pyramid for the viewport size
+	void CreateDepthPyramid(int width, int height);
+};
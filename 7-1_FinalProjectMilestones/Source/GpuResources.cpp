@@ -0,0 +1,329 @@
+///////////////////////////////////////////////////////////////////////////////
+// gpuresources.cpp
+// ============
+// own OpenGL objects through handles that register them in a central
+// tracker, for reporting their memory and the ones left at shutdown
+///////////////////////////////////////////////////////////////////////////////
+
+#include "GpuResources.h"
+
+#include <cstdio>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+// declaration of global variables
+namespace
+{
+	// longest label kept for an object, so that recording one
+	// never allocates
+	const int MAX_LABEL_LENGTH = 32;
+
+	struct OBJECT_RECORD
+	{
+		GpuResources::CATEGORY category;
+		GLuint name;
+		size_t bytes;
+		char label[MAX_LABEL_LENGTH];
+		// false when the entry is free for reuse
+		bool bLive;
+	};
+
+	std::vector<OBJECT_RECORD> g_Records;
+	// entries of the table that are free for reuse
+	std::vector<size_t> g_FreeRecords;
+	GpuResources::CATEGORY_STATS g_Stats[GpuResources::CATEGORY_COUNT] = {};
+
+	// textures by the key of the content they were uploaded from
+	std::unordered_map<uint64_t, std::weak_ptr<GpuTexture>> g_SharedTextures;
+	int g_SharedTextureHits = 0;
+
+	const char* const g_CategoryNames[GpuResources::CATEGORY_COUNT] =
+	{
+		"textures",
+		"buffers",
+		"vertex arrays",
+		"framebuffers",
+		"programs"
+	};
+
+	// find the live record of the object, or NULL - the table is
+	// searched in order because it holds few objects and lookups
+	// only happen when objects are created or deleted
+	OBJECT_RECORD* FindRecord(GpuResources::CATEGORY category, GLuint name)
+	{
+		for (size_t i = 0; i < g_Records.size(); i++)
+		{
+			if ((g_Records[i].bLive == true) &&
+				(g_Records[i].category == category) &&
+				(g_Records[i].name == name))
+			{
+				return(&g_Records[i]);
+			}
+		}
+		return(NULL);
+	}
+}
+
+/***********************************************************
+ *  CreateObject()
+ *
+ *  This function is used for creating an OpenGL object of
+ *  the category and recording it.
+ ***********************************************************/
+GLuint GpuResources::CreateObject(CATEGORY category, const char* label)
+{
+	GLuint name = 0;
+	switch (category)
+	{
+	case CATEGORY_TEXTURE:
+		glGenTextures(1, &name);
+		break;
+	case CATEGORY_BUFFER:
+		glGenBuffers(1, &name);
+		break;
+	case CATEGORY_VERTEX_ARRAY:
+		glGenVertexArrays(1, &name);
+		break;
+	case CATEGORY_FRAMEBUFFER:
+		glGenFramebuffers(1, &name);
+		break;
+	case CATEGORY_PROGRAM:
+		name = glCreateProgram();
+		break;
+	default:
+		break;
+	}
+
+	if (name != 0)
+	{
+		RegisterObject(category, name, label);
+	}
+	return(name);
+}
+
+/***********************************************************
+ *  RegisterObject()
+ *
+ *  This function is used for recording an object, reusing a
+ *  freed entry of the table when there is one.
+ ***********************************************************/
+void GpuResources::RegisterObject(CATEGORY category, GLuint name, const char* label)
+{
+	OBJECT_RECORD* pRecord = NULL;
+	if (g_FreeRecords.empty() == false)
+	{
+		pRecord = &g_Records[g_FreeRecords.back()];
+		g_FreeRecords.pop_back();
+	}
+	else
+	{
+		g_Records.push_back(OBJECT_RECORD());
+		pRecord = &g_Records.back();
+	}
+
+	pRecord->category = category;
+	pRecord->name = name;
+	pRecord->bytes = 0;
+	snprintf(pRecord->label, sizeof(pRecord->label), "%s", (NULL != label) ? label : "");
+	pRecord->bLive = true;
+
+	g_Stats[category].liveCount++;
+	g_Stats[category].createdCount++;
+}
+
+/***********************************************************
+ *  DeleteObject()
+ *
+ *  This function is used for deleting the OpenGL object and
+ *  freeing its entry of the table.
+ ***********************************************************/
+void GpuResources::DeleteObject(CATEGORY category, GLuint name)
+{
+	switch (category)
+	{
+	case CATEGORY_TEXTURE:
+		glDeleteTextures(1, &name);
+		break;
+	case CATEGORY_BUFFER:
+		glDeleteBuffers(1, &name);
+		break;
+	case CATEGORY_VERTEX_ARRAY:
+		glDeleteVertexArrays(1, &name);
+		break;
+	case CATEGORY_FRAMEBUFFER:
+		glDeleteFramebuffers(1, &name);
+		break;
+	case CATEGORY_PROGRAM:
+		glDeleteProgram(name);
+		break;
+	default:
+		break;
+	}
+
+	OBJECT_RECORD* pRecord = FindRecord(category, name);
+	if (NULL == pRecord)
+	{
+		return;
+	}
+	g_Stats[category].liveCount--;
+	g_Stats[category].deletedCount++;
+	g_Stats[category].bytes -= pRecord->bytes;
+	pRecord->bLive = false;
+	g_FreeRecords.push_back((size_t)(pRecord - g_Records.data()));
+}
+
+/***********************************************************
+ *  SetObjectBytes()
+ *
+ *  This function is used for setting the estimated video
+ *  memory of the object, replacing the earlier estimate.
+ ***********************************************************/
+void GpuResources::SetObjectBytes(CATEGORY category, GLuint name, size_t bytes)
+{
+	OBJECT_RECORD* pRecord = FindRecord(category, name);
+	if (NULL == pRecord)
+	{
+		return;
+	}
+	g_Stats[category].bytes -= pRecord->bytes;
+	g_Stats[category].bytes += bytes;
+	pRecord->bytes = bytes;
+}
+
+/***********************************************************
+ *  GetStats()
+ *
+ *  This function is used for getting the counters of the
+ *  category.
+ ***********************************************************/
+GpuResources::CATEGORY_STATS GpuResources::GetStats(CATEGORY category)
+{
+	return(g_Stats[category]);
+}
+
+/***********************************************************
+ *  GetCategoryName()
+ *
+ *  This function is used for getting the display name of
+ *  the category.
+ ***********************************************************/
+const char* GpuResources::GetCategoryName(CATEGORY category)
+{
+	if ((category < 0) || (category >= CATEGORY_COUNT))
+	{
+		return("unknown");
+	}
+	return(g_CategoryNames[category]);
+}
+
+/***********************************************************
+ *  ReportUsage()
+ *
+ *  This function is used for printing the live objects and
+ *  their estimated video memory by category.
+ ***********************************************************/
+void GpuResources::ReportUsage()
+{
+	size_t totalBytes = 0;
+	printf("GPU resources:\n");
+	for (int category = 0; category < CATEGORY_COUNT; category++)
+	{
+		const CATEGORY_STATS& stats = g_Stats[category];
+		printf("  %-14s %5d live, %9.1f KB (%d created, %d deleted)\n",
+			g_CategoryNames[category],
+			stats.liveCount,
+			stats.bytes / 1024.0,
+			stats.createdCount,
+			stats.deletedCount);
+		totalBytes += stats.bytes;
+	}
+	printf("  total %.2f MB, %d texture uploads shared a loaded texture\n",
+		totalBytes / (1024.0 * 1024.0),
+		g_SharedTextureHits);
+}
+
+/***********************************************************
+ *  ReportLeaks()
+ *
+ *  This function is used for printing the objects that were
+ *  never deleted.  Objects created by the shape meshes and
+ *  the shader manager are not owned by handles, so they do
+ *  not appear here.
+ ***********************************************************/
+int GpuResources::ReportLeaks()
+{
+	int leakCount = 0;
+	for (size_t i = 0; i < g_Records.size(); i++)
+	{
+		const OBJECT_RECORD& record = g_Records[i];
+		if (record.bLive == false)
+		{
+			continue;
+		}
+		if (leakCount == 0)
+		{
+			printf("GPU resources still alive at shutdown:\n");
+		}
+		printf("  %s %u \"%s\", %.1f KB\n",
+			g_CategoryNames[record.category],
+			record.name,
+			record.label,
+			record.bytes / 1024.0);
+		leakCount++;
+	}
+	if (leakCount == 0)
+	{
+		printf("GPU resources: no objects left at shutdown\n");
+	}
+	return(leakCount);
+}
+
+/***********************************************************
+ *  FindSharedTexture()
+ *
+ *  This function is used for finding a texture that is still
+ *  alive and was uploaded from the same content.
+ ***********************************************************/
+std::shared_ptr<GpuTexture> GpuResources::FindSharedTexture(uint64_t contentKey)
+{
+	std::unordered_map<uint64_t, std::weak_ptr<GpuTexture>>::iterator found = g_SharedTextures.find(contentKey);
+	if (found == g_SharedTextures.end())
+	{
+		return(std::shared_ptr<GpuTexture>());
+	}
+
+	std::shared_ptr<GpuTexture> texture = found->second.lock();
+	if (texture)
+	{
+		g_SharedTextureHits++;
+	}
+	else
+	{
+		g_SharedTextures.erase(found);
+	}
+	return(texture);
+}
+
+/***********************************************************
+ *  AddSharedTexture()
+ *
+ *  This function is used for offering the texture to later
+ *  uploads of the same content.  Only a weak reference is
+ *  kept, so the texture is deleted with its last owner.
+ ***********************************************************/
+void GpuResources::AddSharedTexture(uint64_t contentKey, const std::shared_ptr<GpuTexture>& texture)
+{
+	g_SharedTextures[contentKey] = texture;
+}
+
+/***********************************************************
+ *  GetSharedTextureHits()
+ *
+ *  This function is used for getting the number of uploads
+ *  that reused a live texture.
+ ***********************************************************/
+int GpuResources::GetSharedTextureHits()
+{
+	return(g_SharedTextureHits);
+}
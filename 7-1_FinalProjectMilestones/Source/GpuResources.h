@@ -0,0 +1,164 @@
+///////////////////////////////////////////////////////////////////////////////
+// gpuresources.h
+// ============
+// own OpenGL objects through handles that register them in a central
+// tracker, for reporting their memory and the ones left at shutdown
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+/***********************************************************
+ *  GpuResources
+ *
+ *  These functions keep a record of every OpenGL object that
+ *  is owned by a GpuHandle, with its category, a label and
+ *  the estimated video memory behind it.  The records live
+ *  in a table whose freed entries are reused, so recreating
+ *  an object, as render targets do when the window is
+ *  resized, does not touch the heap.  The functions must be
+ *  called on the thread of the OpenGL context.
+ ***********************************************************/
+namespace GpuResources
+{
+	enum CATEGORY
+	{
+		CATEGORY_TEXTURE,
+		CATEGORY_BUFFER,
+		CATEGORY_VERTEX_ARRAY,
+		CATEGORY_FRAMEBUFFER,
+		CATEGORY_PROGRAM,
+		CATEGORY_COUNT
+	};
+
+	struct CATEGORY_STATS
+	{
+		// objects alive now
+		int liveCount;
+		// estimated video memory of the live objects
+		size_t bytes;
+		// objects created and deleted since startup
+		int createdCount;
+		int deletedCount;
+	};
+
+	// create an OpenGL object of the category and record it
+	GLuint CreateObject(CATEGORY category, const char* label);
+	// record an object created elsewhere
+	void RegisterObject(CATEGORY category, GLuint name, const char* label);
+	// delete the object and forget its record
+	void DeleteObject(CATEGORY category, GLuint name);
+	// set the estimated video memory of the object
+	void SetObjectBytes(CATEGORY category, GLuint name, size_t bytes);
+
+	// get the counters of the category
+	CATEGORY_STATS GetStats(CATEGORY category);
+	// get the display name of the category
+	const char* GetCategoryName(CATEGORY category);
+	// print the live objects and memory of every category
+	void ReportUsage();
+	// print every object that is still alive, returning their
+	// number - called once all of the owners are destroyed
+	int ReportLeaks();
+}
+
+/***********************************************************
+ *  GpuHandle
+ *
+ *  This class owns one OpenGL object of the category and
+ *  deletes it when the handle is destroyed or reset.  Handles
+ *  can be moved but not copied, so every object has exactly
+ *  one owner, and owners that share an object hold the handle
+ *  through a shared pointer.
+ ***********************************************************/
+template <GpuResources::CATEGORY Category>
+class GpuHandle
+{
+public:
+	GpuHandle() { m_name = 0; }
+	~GpuHandle() { Reset(); }
+
+	GpuHandle(const GpuHandle&) = delete;
+	GpuHandle& operator=(const GpuHandle&) = delete;
+
+	GpuHandle(GpuHandle&& other) noexcept
+	{
+		m_name = other.m_name;
+		other.m_name = 0;
+	}
+
+	GpuHandle& operator=(GpuHandle&& other) noexcept
+	{
+		if (this != &other)
+		{
+			Reset();
+			m_name = other.m_name;
+			other.m_name = 0;
+		}
+		return(*this);
+	}
+
+	// create a new object, deleting the one held before
+	GLuint Create(const char* label)
+	{
+		Reset();
+		m_name = GpuResources::CreateObject(Category, label);
+		return(m_name);
+	}
+
+	// take over an object created elsewhere, such as a linked
+	// shader program
+	void Adopt(GLuint name, const char* label)
+	{
+		Reset();
+		m_name = name;
+		if (m_name != 0)
+		{
+			GpuResources::RegisterObject(Category, m_name, label);
+		}
+	}
+
+	// delete the object
+	void Reset()
+	{
+		if (m_name != 0)
+		{
+			GpuResources::DeleteObject(Category, m_name);
+			m_name = 0;
+		}
+	}
+
+	// set the estimated video memory behind the object
+	void SetBytes(size_t bytes) const
+	{
+		GpuResources::SetObjectBytes(Category, m_name, bytes);
+	}
+
+	GLuint Get() const { return(m_name); }
+
+private:
+	GLuint m_name;
+};
+
+typedef GpuHandle<GpuResources::CATEGORY_TEXTURE> GpuTexture;
+typedef GpuHandle<GpuResources::CATEGORY_BUFFER> GpuBuffer;
+typedef GpuHandle<GpuResources::CATEGORY_VERTEX_ARRAY> GpuVertexArray;
+typedef GpuHandle<GpuResources::CATEGORY_FRAMEBUFFER> GpuFramebuffer;
+typedef GpuHandle<GpuResources::CATEGORY_PROGRAM> GpuProgram;
+
+namespace GpuResources
+{
+	// find a live texture uploaded from the same content key, or
+	// get an empty pointer when there is none
+	std::shared_ptr<GpuTexture> FindSharedTexture(uint64_t contentKey);
+	// make the texture available to later uploads of the same
+	// content, for as long as one of its owners keeps it alive
+	void AddSharedTexture(uint64_t contentKey, const std::shared_ptr<GpuTexture>& texture);
+	// get the number of uploads that reused a live texture
+	int GetSharedTextureHits();
+}
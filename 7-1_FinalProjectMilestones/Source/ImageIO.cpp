@@ -0,0 +1,486 @@
+///////////////////////////////////////////////////////////////////////////////
+// imageio.cpp
+// ============
+// read and write image files for captured and reference frames
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ImageIO.h"
+
+#include "stb_image.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// table for the CRC-32 checksums of the PNG chunks
+	uint32_t g_CRCTable[256];
+	bool g_bCRCTableReady = false;
+
+	void BuildCRCTable()
+	{
+		for (uint32_t n = 0; n < 256; n++)
+		{
+			uint32_t c = n;
+			for (int k = 0; k < 8; k++)
+			{
+				c = (c & 1) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+			}
+			g_CRCTable[n] = c;
+		}
+		g_bCRCTableReady = true;
+	}
+
+	// PNG scanline filters - none, sub, up, average and Paeth
+	const int FILTER_COUNT = 5;
+
+	int PaethPredictor(int left, int above, int upperLeft)
+	{
+		int estimate = left + above - upperLeft;
+		int distanceLeft = abs(estimate - left);
+		int distanceAbove = abs(estimate - above);
+		int distanceUpperLeft = abs(estimate - upperLeft);
+		if ((distanceLeft <= distanceAbove) && (distanceLeft <= distanceUpperLeft))
+		{
+			return(left);
+		}
+		if (distanceAbove <= distanceUpperLeft)
+		{
+			return(above);
+		}
+		return(upperLeft);
+	}
+
+	// filter the row and return the sum of the absolute values
+	// of the filtered bytes as the estimate of its cost
+	unsigned long FilterRow(
+		int filter,
+		const unsigned char* pRow,
+		const unsigned char* pAbove,
+		size_t rowSize,
+		int bytesPerPixel,
+		unsigned char* pOut)
+	{
+		unsigned long sum = 0;
+		for (size_t i = 0; i < rowSize; i++)
+		{
+			int left = (i >= (size_t)bytesPerPixel) ? pRow[i - bytesPerPixel] : 0;
+			int above = (NULL != pAbove) ? pAbove[i] : 0;
+			int upperLeft = ((NULL != pAbove) && (i >= (size_t)bytesPerPixel)) ? pAbove[i - bytesPerPixel] : 0;
+
+			int predicted = 0;
+			switch (filter)
+			{
+			case 1: predicted = left; break;
+			case 2: predicted = above; break;
+			case 3: predicted = (left + above) / 2; break;
+			case 4: predicted = PaethPredictor(left, above, upperLeft); break;
+			default: break;
+			}
+
+			unsigned char value = (unsigned char)(pRow[i] - predicted);
+			pOut[i] = value;
+			sum += (value < 128) ? value : (256 - value);
+		}
+		return(sum);
+	}
+
+	uint32_t UpdateCRC(uint32_t crc, const unsigned char* pData, size_t size)
+	{
+		for (size_t i = 0; i < size; i++)
+		{
+			crc = g_CRCTable[(crc ^ pData[i]) & 0xFF] ^ (crc >> 8);
+		}
+		return(crc);
+	}
+
+	void WriteUInt32(std::vector<unsigned char>& buffer, uint32_t value)
+	{
+		buffer.push_back((unsigned char)(value >> 24));
+		buffer.push_back((unsigned char)(value >> 16));
+		buffer.push_back((unsigned char)(value >> 8));
+		buffer.push_back((unsigned char)(value));
+	}
+
+	// append a PNG chunk with its length, type and checksum
+	void WriteChunk(
+		std::vector<unsigned char>& png,
+		const char* type,
+		const unsigned char* pData,
+		size_t size)
+	{
+		WriteUInt32(png, (uint32_t)size);
+		size_t typeOffset = png.size();
+		png.insert(png.end(), type, type + 4);
+		if (size > 0)
+		{
+			png.insert(png.end(), pData, pData + size);
+		}
+
+		uint32_t crc = UpdateCRC(0xFFFFFFFFu, &png[typeOffset], size + 4);
+		WriteUInt32(png, crc ^ 0xFFFFFFFFu);
+	}
+
+	// base values and extra bits of the deflate length and
+	// distance codes
+	const unsigned short g_LengthBase[29] =
+	{
+		3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+		35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+	};
+	const unsigned char g_LengthExtraBits[29] =
+	{
+		0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+		3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+	};
+	const unsigned short g_DistanceBase[30] =
+	{
+		1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+		257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+		8193, 12289, 16385, 24577
+	};
+	const unsigned char g_DistanceExtraBits[30] =
+	{
+		0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+		7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+	};
+
+	// LZ77 search parameters
+	const int g_WindowSize = 32768;
+	const int g_HashBits = 15;
+	const int g_MaxChainLength = 16;
+	const int g_MinMatch = 3;
+	const int g_MaxMatch = 258;
+
+	// writes the deflate bit stream, least significant bit first
+	struct BIT_WRITER
+	{
+		std::vector<unsigned char>* pStream;
+		uint32_t bits;
+		int bitCount;
+
+		void Write(uint32_t value, int count)
+		{
+			bits |= value << bitCount;
+			bitCount += count;
+			while (bitCount >= 8)
+			{
+				pStream->push_back((unsigned char)(bits & 0xFF));
+				bits >>= 8;
+				bitCount -= 8;
+			}
+		}
+
+		// Huffman codes are stored most significant bit first
+		void WriteCode(uint32_t code, int length)
+		{
+			uint32_t reversed = 0;
+			for (int i = 0; i < length; i++)
+			{
+				reversed = (reversed << 1) | ((code >> i) & 1);
+			}
+			Write(reversed, length);
+		}
+
+		void Flush()
+		{
+			if (bitCount > 0)
+			{
+				pStream->push_back((unsigned char)(bits & 0xFF));
+			}
+			bits = 0;
+			bitCount = 0;
+		}
+	};
+
+	// write a literal or length symbol with the fixed Huffman codes
+	void WriteLiteralLength(BIT_WRITER& writer, int symbol)
+	{
+		if (symbol < 144)
+		{
+			writer.WriteCode(0x30 + symbol, 8);
+		}
+		else if (symbol < 256)
+		{
+			writer.WriteCode(0x190 + (symbol - 144), 9);
+		}
+		else if (symbol < 280)
+		{
+			writer.WriteCode(symbol - 256, 7);
+		}
+		else
+		{
+			writer.WriteCode(0xC0 + (symbol - 280), 8);
+		}
+	}
+
+	void WriteMatch(BIT_WRITER& writer, int length, int distance)
+	{
+		int code = 28;
+		while (g_LengthBase[code] > length)
+		{
+			code--;
+		}
+		WriteLiteralLength(writer, 257 + code);
+		writer.Write(length - g_LengthBase[code], g_LengthExtraBits[code]);
+
+		code = 29;
+		while (g_DistanceBase[code] > distance)
+		{
+			code--;
+		}
+		writer.WriteCode(code, 5);
+		writer.Write(distance - g_DistanceBase[code], g_DistanceExtraBits[code]);
+	}
+
+	// compress the filtered scanlines into a zlib stream with a
+	// single fixed Huffman block, finding repeats with hash chains
+	void EncodeZlib(const std::vector<unsigned char>& data, std::vector<unsigned char>& stream)
+	{
+		stream.clear();
+		stream.reserve(data.size() / 2 + 64);
+		stream.push_back(0x78);
+		stream.push_back(0x01);
+
+		BIT_WRITER writer = { &stream, 0, 0 };
+		// final block with fixed Huffman codes
+		writer.Write(1, 1);
+		writer.Write(1, 2);
+
+		const unsigned char* pData = data.data();
+		const int size = (int)data.size();
+		std::vector<int> head((size_t)1 << g_HashBits, -1);
+		std::vector<int> previous(g_WindowSize, -1);
+
+		int position = 0;
+		while (position < size)
+		{
+			int bestLength = 0;
+			int bestDistance = 0;
+
+			if (position + g_MinMatch <= size)
+			{
+				uint32_t hash = ((pData[position] << 10) ^ (pData[position + 1] << 5) ^ pData[position + 2])
+					& ((1 << g_HashBits) - 1);
+				int maxLength = std::min(g_MaxMatch, size - position);
+
+				int candidate = head[hash];
+				for (int chain = 0; (chain < g_MaxChainLength) && (candidate >= 0); chain++)
+				{
+					if (position - candidate > g_WindowSize - 1)
+					{
+						break;
+					}
+					int length = 0;
+					while ((length < maxLength) && (pData[candidate + length] == pData[position + length]))
+					{
+						length++;
+					}
+					if (length > bestLength)
+					{
+						bestLength = length;
+						bestDistance = position - candidate;
+						if (length == maxLength)
+						{
+							break;
+						}
+					}
+					candidate = previous[candidate & (g_WindowSize - 1)];
+				}
+
+				previous[position & (g_WindowSize - 1)] = head[hash];
+				head[hash] = position;
+			}
+
+			if (bestLength >= g_MinMatch)
+			{
+				WriteMatch(writer, bestLength, bestDistance);
+				// keep the skipped positions searchable
+				for (int i = 1; i < bestLength; i++)
+				{
+					int skipped = position + i;
+					if (skipped + g_MinMatch <= size)
+					{
+						uint32_t hash = ((pData[skipped] << 10) ^ (pData[skipped + 1] << 5) ^ pData[skipped + 2])
+							& ((1 << g_HashBits) - 1);
+						previous[skipped & (g_WindowSize - 1)] = head[hash];
+						head[hash] = skipped;
+					}
+				}
+				position += bestLength;
+			}
+			else
+			{
+				WriteLiteralLength(writer, pData[position]);
+				position++;
+			}
+		}
+
+		// end of block
+		WriteLiteralLength(writer, 256);
+		writer.Flush();
+
+		// Adler-32 checksum of the uncompressed data
+		uint32_t a = 1;
+		uint32_t b = 0;
+		for (size_t i = 0; i < data.size(); i++)
+		{
+			a = (a + data[i]) % 65521;
+			b = (b + a) % 65521;
+		}
+		WriteUInt32(stream, (b << 16) | a);
+	}
+}
+
+/***********************************************************
+ *  ReadImage()
+ *
+ *  This function is used for loading an image file with the
+ *  passed in number of channels, top row first.
+ ***********************************************************/
+bool ImageIO::ReadImage(const char* filename, int channels, IMAGE_DATA& image)
+{
+	int width = 0;
+	int height = 0;
+	int fileChannels = 0;
+
+	// the scene textures are loaded flipped, image files are not
+	stbi_set_flip_vertically_on_load(false);
+	unsigned char* pPixels = stbi_load(filename, &width, &height, &fileChannels, channels);
+	if (NULL == pPixels)
+	{
+		return(false);
+	}
+
+	image.width = width;
+	image.height = height;
+	image.channels = channels;
+	image.pixels.assign(pPixels, pPixels + ((size_t)width * height * channels));
+	stbi_image_free(pPixels);
+
+	return(true);
+}
+
+/***********************************************************
+ *  EncodePNG()
+ *
+ *  This function is used for encoding the image as a PNG.
+ *  Each scanline is filtered to make it more compressible
+ *  before the deflate compression.
+ ***********************************************************/
+void ImageIO::EncodePNG(const IMAGE_DATA& image, std::vector<unsigned char>& png)
+{
+	if (g_bCRCTableReady == false)
+	{
+		BuildCRCTable();
+	}
+
+	static const unsigned char signature[8] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+	png.assign(signature, signature + 8);
+
+	// IHDR - dimensions, 8 bits per channel, RGB or RGBA
+	unsigned char header[13];
+	header[0] = (unsigned char)(image.width >> 24);
+	header[1] = (unsigned char)(image.width >> 16);
+	header[2] = (unsigned char)(image.width >> 8);
+	header[3] = (unsigned char)(image.width);
+	header[4] = (unsigned char)(image.height >> 24);
+	header[5] = (unsigned char)(image.height >> 16);
+	header[6] = (unsigned char)(image.height >> 8);
+	header[7] = (unsigned char)(image.height);
+	header[8] = 8;
+	header[9] = (image.channels == 4) ? 6 : 2;
+	header[10] = 0;
+	header[11] = 0;
+	header[12] = 0;
+	WriteChunk(png, "IHDR", header, sizeof(header));
+
+	// every scanline starts with its filter type, choosing the
+	// filter with the smallest sum of absolute differences
+	size_t rowSize = (size_t)image.width * image.channels;
+	std::vector<unsigned char> scanlines((rowSize + 1) * image.height);
+	std::vector<unsigned char> filtered[FILTER_COUNT];
+	for (int filter = 0; filter < FILTER_COUNT; filter++)
+	{
+		filtered[filter].resize(rowSize);
+	}
+
+	for (int y = 0; y < image.height; y++)
+	{
+		const unsigned char* pRow = &image.pixels[y * rowSize];
+		const unsigned char* pAbove = (y > 0) ? &image.pixels[(y - 1) * rowSize] : NULL;
+
+		int bestFilter = 0;
+		unsigned long bestSum = 0;
+		for (int filter = 0; filter < FILTER_COUNT; filter++)
+		{
+			unsigned long sum = FilterRow(filter, pRow, pAbove, rowSize, image.channels, filtered[filter].data());
+			if ((filter == 0) || (sum < bestSum))
+			{
+				bestFilter = filter;
+				bestSum = sum;
+			}
+		}
+
+		unsigned char* pOut = &scanlines[y * (rowSize + 1)];
+		pOut[0] = (unsigned char)bestFilter;
+		memcpy(pOut + 1, filtered[bestFilter].data(), rowSize);
+	}
+
+	std::vector<unsigned char> stream;
+	EncodeZlib(scanlines, stream);
+	WriteChunk(png, "IDAT", stream.data(), stream.size());
+	WriteChunk(png, "IEND", NULL, 0);
+}
+
+/***********************************************************
+ *  WritePNG()
+ *
+ *  This function is used for writing the image to a file.
+ ***********************************************************/
+bool ImageIO::WritePNG(const char* filename, const IMAGE_DATA& image)
+{
+	if ((image.channels != 3) && (image.channels != 4))
+	{
+		std::cout << "Not implemented to write image with " << image.channels << " channels" << std::endl;
+		return(false);
+	}
+
+	std::vector<unsigned char> png;
+	EncodePNG(image, png);
+
+	std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		std::cout << "Could not write image:" << filename << std::endl;
+		return(false);
+	}
+	file.write((const char*)png.data(), png.size());
+
+	return(true);
+}
+
+/***********************************************************
+ *  FlipRows()
+ *
+ *  This function is used for reversing the order of the rows.
+ ***********************************************************/
+void ImageIO::FlipRows(IMAGE_DATA& image)
+{
+	size_t rowSize = (size_t)image.width * image.channels;
+	std::vector<unsigned char> row(rowSize);
+
+	for (int y = 0; y < image.height / 2; y++)
+	{
+		unsigned char* pTop = &image.pixels[y * rowSize];
+		unsigned char* pBottom = &image.pixels[(image.height - 1 - y) * rowSize];
+		memcpy(row.data(), pTop, rowSize);
+		memcpy(pTop, pBottom, rowSize);
+		memcpy(pBottom, row.data(), rowSize);
+	}
+}
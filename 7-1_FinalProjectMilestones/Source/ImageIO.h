@@ -0,0 +1,43 @@
+///////////////////////////////////////////////////////////////////////////////
+// imageio.h
+// ============
+// read and write image files for captured and reference frames
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  IMAGE_DATA
+ *
+ *  Pixels of an image stored top row first, with the passed
+ *  number of 8-bit channels per pixel.
+ ***********************************************************/
+struct IMAGE_DATA
+{
+	int width;
+	int height;
+	int channels;
+	std::vector<unsigned char> pixels;
+};
+
+/***********************************************************
+ *  ImageIO
+ *
+ *  These functions load image files through stb_image and
+ *  write 8-bit RGB or RGBA PNG files.
+ ***********************************************************/
+namespace ImageIO
+{
+	// load an image file, converting it to the requested channels
+	bool ReadImage(const char* filename, int channels, IMAGE_DATA& image);
+	// encode the image as PNG into the passed in buffer
+	void EncodePNG(const IMAGE_DATA& image, std::vector<unsigned char>& png);
+	// encode the image and write it to a PNG file
+	bool WritePNG(const char* filename, const IMAGE_DATA& image);
+	// flip the rows of the image, converting between the bottom
+	// row first order of OpenGL and the top row first order
+	void FlipRows(IMAGE_DATA& image);
+}
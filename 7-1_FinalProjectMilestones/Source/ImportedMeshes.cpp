@@ -0,0 +1,292 @@
+///////////////////////////////////////////////////////////////////////////////
+// importedmeshes.cpp
+// ============
+// upload the meshes of an imported model through a staging buffer and draw
+// them alongside the basic shapes
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ImportedMeshes.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// size of the staging buffer, which is refilled for every
+	// piece of the model
+	const size_t g_StagingBytes = 4 * 1024 * 1024;
+
+	typedef CompactMeshes::MESH_VERTEX MESH_VERTEX;
+
+	// current time for measuring the upload
+	double GetMilliseconds()
+	{
+		return(std::chrono::duration<double, std::milli>(
+			std::chrono::steady_clock::now().time_since_epoch()).count());
+	}
+}
+
+/***********************************************************
+ *  ImportedMeshes()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ImportedMeshes::ImportedMeshes()
+{
+	m_uploadMilliseconds = 0.0f;
+	m_uploadMesh = 0;
+	m_uploadOffset = 0;
+	m_bUploadIndices = false;
+}
+
+/***********************************************************
+ *  ~ImportedMeshes()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ImportedMeshes::~ImportedMeshes()
+{
+}
+
+/***********************************************************
+ *  StageCopy()
+ *
+ *  This method is used for copying data into the bound
+ *  destination buffer one staging buffer at a time.  The
+ *  staging buffer is invalidated when it is mapped, so the
+ *  driver hands out fresh memory instead of waiting for the
+ *  previous copy out of it to finish.
+ ***********************************************************/
+void ImportedMeshes::StageCopy(const void* pData, size_t bytes, size_t offset)
+{
+	const unsigned char* pBytes = (const unsigned char*)pData;
+	size_t copied = 0;
+	while (copied < bytes)
+	{
+		size_t pieceBytes = std::min(bytes - copied, g_StagingBytes);
+		void* pStaging = glMapBufferRange(GL_COPY_READ_BUFFER, 0, (GLsizeiptr)pieceBytes,
+			GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+		if (NULL == pStaging)
+		{
+			// write the piece straight into the buffer instead
+			glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)(offset + copied), (GLsizeiptr)pieceBytes, pBytes + copied);
+		}
+		else
+		{
+			memcpy(pStaging, pBytes + copied, pieceBytes);
+			glUnmapBuffer(GL_COPY_READ_BUFFER);
+			glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+				0, (GLintptr)(offset + copied), (GLsizeiptr)pieceBytes);
+		}
+		copied += pieceBytes;
+	}
+}
+
+/***********************************************************
+ *  LoadMeshes()
+ *
+ *  This method is used for uploading every mesh of the model
+ *  into the merged vertex and index buffers, which are sized
+ *  for the whole model before any data is copied.
+ ***********************************************************/
+bool ImportedMeshes::LoadMeshes(const ModelImporter::MODEL& model)
+{
+	if (BeginUpload(model) == false)
+	{
+		return(false);
+	}
+	while (UploadPiece(model) == false)
+	{
+	}
+	return(true);
+}
+
+/***********************************************************
+ *  BeginUpload()
+ *
+ *  This method is used for laying out the meshes of the model
+ *  in the merged buffers and creating the buffers and the
+ *  staging buffer.  The meshes cannot be drawn until
+ *  UploadPiece() reports the upload as complete.
+ ***********************************************************/
+bool ImportedMeshes::BeginUpload(const ModelImporter::MODEL& model)
+{
+	double startTime = GetMilliseconds();
+
+	m_meshes.clear();
+	size_t vertexCount = 0;
+	size_t indexCount = 0;
+	for (size_t i = 0; i < model.meshes.size(); i++)
+	{
+		const ModelImporter::MODEL_MESH& mesh = model.meshes[i];
+		MESH_RANGE range;
+		range.indexCount = (GLsizei)mesh.data.indices.size();
+		range.firstIndex = indexCount;
+		range.baseVertex = (GLint)vertexCount;
+		range.boundsMin = mesh.boundsMin;
+		range.boundsMax = mesh.boundsMax;
+		m_meshes.push_back(range);
+		vertexCount += mesh.data.vertices.size();
+		indexCount += mesh.data.indices.size();
+	}
+	if ((vertexCount == 0) || (indexCount == 0) || (vertexCount > (size_t)INT32_MAX))
+	{
+		m_meshes.clear();
+		return(false);
+	}
+
+	size_t vertexBytes = vertexCount * sizeof(MESH_VERTEX);
+	size_t indexBytes = indexCount * sizeof(uint32_t);
+
+	glBindVertexArray(m_vertexArray.Create("imported meshes"));
+	glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer.Create("imported mesh vertices"));
+	glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)vertexBytes, NULL, GL_STATIC_DRAW);
+	m_vertexBuffer.SetBytes(vertexBytes);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer.Create("imported mesh indices"));
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)indexBytes, NULL, GL_STATIC_DRAW);
+	m_indexBuffer.SetBytes(indexBytes);
+
+	GLsizei stride = sizeof(MESH_VERTEX);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(MESH_VERTEX, position));
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(MESH_VERTEX, normal));
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(MESH_VERTEX, uv));
+	glEnableVertexAttribArray(2);
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	// the staging buffer only lives for the upload
+	glBindBuffer(GL_COPY_READ_BUFFER, m_stagingBuffer.Create("imported mesh staging"));
+	glBufferData(GL_COPY_READ_BUFFER, (GLsizeiptr)g_StagingBytes, NULL, GL_STREAM_DRAW);
+	m_stagingBuffer.SetBytes(g_StagingBytes);
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+
+	m_uploadMesh = 0;
+	m_uploadOffset = 0;
+	m_bUploadIndices = false;
+	m_uploadMilliseconds = (float)(GetMilliseconds() - startTime);
+	return(true);
+}
+
+/***********************************************************
+ *  UploadPiece()
+ *
+ *  This method is used for copying at most one staging
+ *  buffer of the model into the merged buffers.  Once every
+ *  piece is copied the staging buffer is deleted and the
+ *  upload is reported.
+ ***********************************************************/
+bool ImportedMeshes::UploadPiece(const ModelImporter::MODEL& model)
+{
+	if (m_stagingBuffer.Get() == 0)
+	{
+		return(true);
+	}
+
+	double startTime = GetMilliseconds();
+	while (true)
+	{
+		if (m_uploadMesh >= model.meshes.size())
+		{
+			if (m_bUploadIndices == false)
+			{
+				m_bUploadIndices = true;
+				m_uploadMesh = 0;
+				m_uploadOffset = 0;
+				continue;
+			}
+			break;
+		}
+
+		const CompactMeshes::MESH_DATA& data = model.meshes[m_uploadMesh].data;
+		const unsigned char* pData = NULL;
+		size_t bytes = 0;
+		size_t destination = 0;
+		GLuint buffer = 0;
+		if (m_bUploadIndices == false)
+		{
+			pData = (const unsigned char*)data.vertices.data();
+			bytes = data.vertices.size() * sizeof(MESH_VERTEX);
+			destination = m_meshes[m_uploadMesh].baseVertex * sizeof(MESH_VERTEX);
+			buffer = m_vertexBuffer.Get();
+		}
+		else
+		{
+			pData = (const unsigned char*)data.indices.data();
+			bytes = data.indices.size() * sizeof(uint32_t);
+			destination = m_meshes[m_uploadMesh].firstIndex * sizeof(uint32_t);
+			buffer = m_indexBuffer.Get();
+		}
+		if (m_uploadOffset >= bytes)
+		{
+			m_uploadMesh++;
+			m_uploadOffset = 0;
+			continue;
+		}
+
+		size_t pieceBytes = std::min(bytes - m_uploadOffset, g_StagingBytes);
+		glBindBuffer(GL_COPY_READ_BUFFER, m_stagingBuffer.Get());
+		glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+		StageCopy(pData + m_uploadOffset, pieceBytes, destination + m_uploadOffset);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		glBindBuffer(GL_COPY_READ_BUFFER, 0);
+		m_uploadOffset += pieceBytes;
+		m_uploadMilliseconds += (float)(GetMilliseconds() - startTime);
+		return(false);
+	}
+
+	m_stagingBuffer.Reset();
+	m_uploadMilliseconds += (float)(GetMilliseconds() - startTime);
+
+	size_t totalBytes = 0;
+	for (size_t i = 0; i < model.meshes.size(); i++)
+	{
+		totalBytes += model.meshes[i].data.vertices.size() * sizeof(MESH_VERTEX);
+		totalBytes += model.meshes[i].data.indices.size() * sizeof(uint32_t);
+	}
+	std::cout << "Uploaded " << m_meshes.size() << " imported meshes, "
+		<< totalBytes / (1024 * 1024) << " MB in " << m_uploadMilliseconds << " ms" << std::endl;
+	return(true);
+}
+
+/***********************************************************
+ *  DrawMesh()
+ *
+ *  This method is used for drawing the passed in mesh from
+ *  its range of the merged buffers.
+ ***********************************************************/
+void ImportedMeshes::DrawMesh(int mesh)
+{
+	if ((mesh < 0) || (mesh >= (int)m_meshes.size()) || (m_meshes[mesh].indexCount == 0))
+	{
+		return;
+	}
+
+	const MESH_RANGE& range = m_meshes[mesh];
+	glBindVertexArray(m_vertexArray.Get());
+	glDrawElementsBaseVertex(GL_TRIANGLES, range.indexCount, GL_UNSIGNED_INT,
+		(void*)(range.firstIndex * sizeof(uint32_t)), range.baseVertex);
+	glBindVertexArray(0);
+}
+
+/***********************************************************
+ *  GetMeshBounds()
+ *
+ *  This method is used for getting the local bounds of the
+ *  passed in mesh.
+ ***********************************************************/
+void ImportedMeshes::GetMeshBounds(int mesh, glm::vec3& boundsMin, glm::vec3& boundsMax) const
+{
+	boundsMin = glm::vec3(0.0f);
+	boundsMax = glm::vec3(0.0f);
+	if ((mesh >= 0) && (mesh < (int)m_meshes.size()))
+	{
+		boundsMin = m_meshes[mesh].boundsMin;
+		boundsMax = m_meshes[mesh].boundsMax;
+	}
+}
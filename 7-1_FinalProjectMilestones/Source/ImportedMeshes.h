@@ -0,0 +1,85 @@
+///////////////////////////////////////////////////////////////////////////////
+// importedmeshes.h
+// ============
+// upload the meshes of an imported model through a staging buffer and draw
+// them alongside the basic shapes
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "GpuResources.h"
+#include "ModelImporter.h"
+
+#include <cstddef>
+#include <vector>
+
+/***********************************************************
+ *  ImportedMeshes
+ *
+ *  This class keeps the meshes of an imported model in one
+ *  vertex buffer and one index buffer, in the float vertex
+ *  layout that the general shaders read, so each mesh is
+ *  drawn from its own range with a base vertex.  The data
+ *  is copied into a fixed-size staging buffer that is mapped
+ *  for writing, and from there into the final buffers on the
+ *  GPU, so a large model never needs a second copy of itself
+ *  in the driver's memory.  The copy can also be made one
+ *  staging buffer at a time, so that a model loaded in the
+ *  background is uploaded over several frames.
+ ***********************************************************/
+class ImportedMeshes
+{
+public:
+	// constructor
+	ImportedMeshes();
+	// destructor
+	~ImportedMeshes();
+
+	// upload the meshes of the model, replacing any uploaded before
+	bool LoadMeshes(const ModelImporter::MODEL& model);
+	// size the buffers for the meshes of the model, replacing any
+	// uploaded before, without copying any of the data yet
+	bool BeginUpload(const ModelImporter::MODEL& model);
+	// copy the next staging buffer of the model passed to
+	// BeginUpload(), returning true once all of it is copied
+	bool UploadPiece(const ModelImporter::MODEL& model);
+	// draw the mesh with the currently bound program
+	void DrawMesh(int mesh);
+	// local bounds of the mesh
+	void GetMeshBounds(int mesh, glm::vec3& boundsMin, glm::vec3& boundsMax) const;
+
+	int GetMeshCount() const { return((int)m_meshes.size()); }
+	// time taken by the last upload
+	float GetUploadMilliseconds() const { return(m_uploadMilliseconds); }
+
+private:
+	// range of the merged buffers holding one mesh
+	struct MESH_RANGE
+	{
+		GLsizei indexCount;
+		size_t firstIndex;
+		GLint baseVertex;
+		glm::vec3 boundsMin;
+		glm::vec3 boundsMax;
+	};
+
+	GpuVertexArray m_vertexArray;
+	GpuBuffer m_vertexBuffer;
+	GpuBuffer m_indexBuffer;
+	std::vector<MESH_RANGE> m_meshes;
+	float m_uploadMilliseconds;
+	// staging buffer of the upload in progress, and the mesh and
+	// byte offset of its next piece, copying the vertices of every
+	// mesh before the indices
+	GpuBuffer m_stagingBuffer;
+	size_t m_uploadMesh;
+	size_t m_uploadOffset;
+	bool m_bUploadIndices;
+
+	// copy the bytes into the bound GL_COPY_WRITE_BUFFER at the
+	// offset, through the staging buffer bound to GL_COPY_READ_BUFFER
+	void StageCopy(const void* pData, size_t bytes, size_t offset);
+};
@@ -0,0 +1,513 @@
+///////////////////////////////////////////////////////////////////////////////
+// inputrecorder.cpp
+// ============
+// record timestamped input and camera state to a binary file and replay
+// the recorded camera path at a fixed simulated timestep for benchmarking
+///////////////////////////////////////////////////////////////////////////////
+
+#include "InputRecorder.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+// declaration of global variables
+namespace
+{
+	// identifies the binary input recording files
+	const char g_RecordingMagic[4] = { 'C', 'R', 'E', 'C' };
+	const uint32_t g_RecordingVersion = 1;
+
+	// size of the payload following the type and time of each record
+	const size_t g_CameraPayloadSize = (13 * sizeof(float)) + 1;
+	const size_t g_KeysPayloadSize = sizeof(uint16_t);
+	const size_t g_MousePayloadSize = 2 * sizeof(float);
+	const size_t g_ScrollPayloadSize = sizeof(float);
+
+	// read a value from the encoded stream, advancing the offset
+	template <typename T>
+	T ReadValue(const std::vector<unsigned char>& data, size_t& offset)
+	{
+		T value;
+		memcpy(&value, &data[offset], sizeof(T));
+		offset += sizeof(T);
+		return(value);
+	}
+
+	glm::vec3 ReadVec3(const std::vector<unsigned char>& data, size_t& offset)
+	{
+		glm::vec3 value;
+		value.x = ReadValue<float>(data, offset);
+		value.y = ReadValue<float>(data, offset);
+		value.z = ReadValue<float>(data, offset);
+		return(value);
+	}
+}
+
+/***********************************************************
+ *  InputRecorder()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+InputRecorder::InputRecorder()
+{
+	m_mode = MODE_IDLE;
+	m_startTime = 0.0;
+	m_bStarted = false;
+	m_lastKeyMask = 0;
+	m_fixedTimeStep = 1.0f / 60.0f;
+	m_replayFrame = 0;
+	m_replaySample = 0;
+	m_lastWallTime = -1.0;
+	memset(m_eventCounts, 0, sizeof(m_eventCounts));
+}
+
+/***********************************************************
+ *  ~InputRecorder()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+InputRecorder::~InputRecorder()
+{
+	Stop();
+}
+
+/***********************************************************
+ *  BeginRecording()
+ *
+ *  This method is used to start capturing the input events
+ *  and camera state.  The records are kept in memory and
+ *  written to the file when recording stops, so that disk
+ *  access never interrupts the recorded frames.
+ ***********************************************************/
+bool InputRecorder::BeginRecording(const char* filename)
+{
+	Stop();
+
+	// make sure the file can be written before any input is captured
+	std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		std::cout << "Could not create input recording:" << filename << std::endl;
+		return(false);
+	}
+	file.close();
+
+	m_filename = filename;
+	m_stream.clear();
+	WriteBytes(g_RecordingMagic, sizeof(g_RecordingMagic));
+	WriteBytes(&g_RecordingVersion, sizeof(g_RecordingVersion));
+	m_bStarted = false;
+	m_lastKeyMask = 0;
+	m_mode = MODE_RECORDING;
+
+	std::cout << "Recording input to:" << filename << std::endl;
+
+	return(true);
+}
+
+/***********************************************************
+ *  BeginReplay()
+ *
+ *  This method is used to load a previously recorded file
+ *  and prepare the camera path for replaying it at the
+ *  passed in fixed simulated timestep.
+ ***********************************************************/
+bool InputRecorder::BeginReplay(const char* filename, float fixedTimeStep)
+{
+	Stop();
+
+	std::ifstream file(filename, std::ios::binary);
+	if (!file.is_open())
+	{
+		std::cout << "Could not open input recording:" << filename << std::endl;
+		return(false);
+	}
+	std::vector<unsigned char> data(
+		(std::istreambuf_iterator<char>(file)),
+		std::istreambuf_iterator<char>());
+
+	size_t headerSize = sizeof(g_RecordingMagic) + sizeof(g_RecordingVersion);
+	if ((data.size() < headerSize) ||
+		(memcmp(&data[0], g_RecordingMagic, sizeof(g_RecordingMagic)) != 0))
+	{
+		std::cout << "Not a valid input recording:" << filename << std::endl;
+		return(false);
+	}
+
+	size_t offset = sizeof(g_RecordingMagic);
+	uint32_t version = ReadValue<uint32_t>(data, offset);
+	if (version != g_RecordingVersion)
+	{
+		std::cout << "Unsupported input recording version " << version << std::endl;
+		return(false);
+	}
+
+	// decode the records - camera samples drive the replay
+	// while the input events are only counted for the report
+	m_samples.clear();
+	memset(m_eventCounts, 0, sizeof(m_eventCounts));
+	bool bValid = true;
+	while ((offset < data.size()) && (bValid == true))
+	{
+		if (data.size() - offset < 1 + sizeof(float))
+		{
+			bValid = false;
+			break;
+		}
+
+		unsigned char type = ReadValue<unsigned char>(data, offset);
+		float time = ReadValue<float>(data, offset);
+
+		size_t payloadSize = 0;
+		switch (type)
+		{
+		case RECORD_CAMERA: payloadSize = g_CameraPayloadSize; break;
+		case RECORD_KEYS: payloadSize = g_KeysPayloadSize; break;
+		case RECORD_MOUSE: payloadSize = g_MousePayloadSize; break;
+		case RECORD_SCROLL: payloadSize = g_ScrollPayloadSize; break;
+		default: bValid = false; break;
+		}
+		if ((bValid == false) || (data.size() - offset < payloadSize))
+		{
+			bValid = false;
+			break;
+		}
+
+		if (type == RECORD_CAMERA)
+		{
+			CAMERA_SAMPLE sample;
+			sample.time = time;
+			sample.position = ReadVec3(data, offset);
+			sample.front = ReadVec3(data, offset);
+			sample.up = ReadVec3(data, offset);
+			sample.yaw = ReadValue<float>(data, offset);
+			sample.pitch = ReadValue<float>(data, offset);
+			sample.zoom = ReadValue<float>(data, offset);
+			sample.movementSpeed = ReadValue<float>(data, offset);
+			sample.bOrthographic = (ReadValue<unsigned char>(data, offset) != 0);
+			m_samples.push_back(sample);
+		}
+		else
+		{
+			offset += payloadSize;
+		}
+		m_eventCounts[type]++;
+	}
+
+	if (bValid == false)
+	{
+		std::cout << "Input recording is truncated, replaying the decoded part only" << std::endl;
+	}
+	if (m_samples.size() == 0)
+	{
+		std::cout << "Input recording has no camera samples:" << filename << std::endl;
+		return(false);
+	}
+
+	m_filename = filename;
+	m_fixedTimeStep = (fixedTimeStep > 0.0f) ? fixedTimeStep : (1.0f / 60.0f);
+	m_replayFrame = 0;
+	m_replaySample = 0;
+	m_lastWallTime = -1.0;
+	m_frameTimes.clear();
+	m_frameTimes.reserve((size_t)(m_samples.back().time / m_fixedTimeStep) + 2);
+	m_mode = MODE_REPLAYING;
+
+	std::cout << "Replaying input from:" << filename
+		<< ", duration:" << m_samples.back().time << "s"
+		<< ", camera samples:" << m_eventCounts[RECORD_CAMERA]
+		<< ", key events:" << m_eventCounts[RECORD_KEYS]
+		<< ", mouse events:" << m_eventCounts[RECORD_MOUSE]
+		<< ", scroll events:" << m_eventCounts[RECORD_SCROLL] << std::endl;
+
+	return(true);
+}
+
+/***********************************************************
+ *  Stop()
+ *
+ *  This method is used to stop recording or replaying.  Any
+ *  recorded data is written out to the recording file.
+ ***********************************************************/
+void InputRecorder::Stop()
+{
+	if (m_mode == MODE_RECORDING)
+	{
+		std::ofstream file(m_filename.c_str(), std::ios::binary | std::ios::trunc);
+		if (file.is_open())
+		{
+			file.write((const char*)m_stream.data(), m_stream.size());
+			std::cout << "Saved input recording:" << m_filename << ", bytes:" << m_stream.size() << std::endl;
+		}
+		else
+		{
+			std::cout << "Could not save input recording:" << m_filename << std::endl;
+		}
+		m_stream.clear();
+	}
+
+	m_mode = MODE_IDLE;
+}
+
+/***********************************************************
+ *  RecordingTime()
+ *
+ *  This method is used for converting an absolute time into
+ *  seconds since the first recorded event.
+ ***********************************************************/
+float InputRecorder::RecordingTime(double time)
+{
+	if (m_bStarted == false)
+	{
+		m_startTime = time;
+		m_bStarted = true;
+	}
+
+	return((float)(time - m_startTime));
+}
+
+/***********************************************************
+ *  WriteBytes()
+ *
+ *  These methods are used for appending raw values to the
+ *  encoded record stream.
+ ***********************************************************/
+void InputRecorder::WriteBytes(const void* pData, size_t size)
+{
+	const unsigned char* pBytes = (const unsigned char*)pData;
+	m_stream.insert(m_stream.end(), pBytes, pBytes + size);
+}
+
+void InputRecorder::WriteFloat(float value)
+{
+	WriteBytes(&value, sizeof(value));
+}
+
+void InputRecorder::WriteVec3(const glm::vec3& value)
+{
+	WriteFloat(value.x);
+	WriteFloat(value.y);
+	WriteFloat(value.z);
+}
+
+/***********************************************************
+ *  RecordKeyState()
+ *
+ *  This method is used for recording the state of the polled
+ *  keyboard keys.  Only changes in the state are stored.
+ ***********************************************************/
+void InputRecorder::RecordKeyState(double time, uint16_t keyMask)
+{
+	if ((m_mode != MODE_RECORDING) || (keyMask == m_lastKeyMask))
+	{
+		return;
+	}
+
+	unsigned char type = RECORD_KEYS;
+	WriteBytes(&type, 1);
+	WriteFloat(RecordingTime(time));
+	WriteBytes(&keyMask, sizeof(keyMask));
+	m_lastKeyMask = keyMask;
+}
+
+/***********************************************************
+ *  RecordMouseMove()
+ *
+ *  This method is used for recording a mouse move event.
+ ***********************************************************/
+void InputRecorder::RecordMouseMove(double time, double xMousePos, double yMousePos)
+{
+	if (m_mode != MODE_RECORDING)
+	{
+		return;
+	}
+
+	unsigned char type = RECORD_MOUSE;
+	WriteBytes(&type, 1);
+	WriteFloat(RecordingTime(time));
+	WriteFloat((float)xMousePos);
+	WriteFloat((float)yMousePos);
+}
+
+/***********************************************************
+ *  RecordScroll()
+ *
+ *  This method is used for recording a mouse scroll event.
+ ***********************************************************/
+void InputRecorder::RecordScroll(double time, double yOffset)
+{
+	if (m_mode != MODE_RECORDING)
+	{
+		return;
+	}
+
+	unsigned char type = RECORD_SCROLL;
+	WriteBytes(&type, 1);
+	WriteFloat(RecordingTime(time));
+	WriteFloat((float)yOffset);
+}
+
+/***********************************************************
+ *  RecordCameraState()
+ *
+ *  This method is used for recording the resulting camera
+ *  state after the input for a frame has been processed.
+ ***********************************************************/
+void InputRecorder::RecordCameraState(double time, const Camera& camera, bool bOrthographic)
+{
+	if (m_mode != MODE_RECORDING)
+	{
+		return;
+	}
+
+	unsigned char type = RECORD_CAMERA;
+	unsigned char orthographic = bOrthographic ? 1 : 0;
+	WriteBytes(&type, 1);
+	WriteFloat(RecordingTime(time));
+	WriteVec3(camera.Position);
+	WriteVec3(camera.Front);
+	WriteVec3(camera.Up);
+	WriteFloat(camera.Yaw);
+	WriteFloat(camera.Pitch);
+	WriteFloat(camera.Zoom);
+	WriteFloat(camera.MovementSpeed);
+	WriteBytes(&orthographic, 1);
+}
+
+/***********************************************************
+ *  SampleCameraPath()
+ *
+ *  This method is used for interpolating the recorded camera
+ *  samples at the passed in time.  The projection mode is
+ *  taken from the most recent sample.
+ ***********************************************************/
+InputRecorder::CAMERA_SAMPLE InputRecorder::SampleCameraPath(float time)
+{
+	// advance to the last sample at or before the requested time
+	while ((m_replaySample + 1 < m_samples.size()) &&
+		(m_samples[m_replaySample + 1].time <= time))
+	{
+		m_replaySample++;
+	}
+
+	const CAMERA_SAMPLE& current = m_samples[m_replaySample];
+	if (m_replaySample + 1 >= m_samples.size())
+	{
+		return(current);
+	}
+
+	const CAMERA_SAMPLE& next = m_samples[m_replaySample + 1];
+	float span = next.time - current.time;
+	float t = (span > 0.0f) ? glm::clamp((time - current.time) / span, 0.0f, 1.0f) : 0.0f;
+
+	CAMERA_SAMPLE sample = current;
+	sample.time = time;
+	sample.position = glm::mix(current.position, next.position, t);
+	sample.front = glm::normalize(glm::mix(current.front, next.front, t));
+	sample.up = glm::normalize(glm::mix(current.up, next.up, t));
+	sample.yaw = glm::mix(current.yaw, next.yaw, t);
+	sample.pitch = glm::mix(current.pitch, next.pitch, t);
+	sample.zoom = glm::mix(current.zoom, next.zoom, t);
+	sample.movementSpeed = glm::mix(current.movementSpeed, next.movementSpeed, t);
+
+	return(sample);
+}
+
+/***********************************************************
+ *  ReplayNextFrame()
+ *
+ *  This method is used for driving the camera for the next
+ *  replayed frame.  The simulated time advances by the fixed
+ *  timestep regardless of how long the frame really took, and
+ *  the real duration of each frame is kept for the report.
+ ***********************************************************/
+bool InputRecorder::ReplayNextFrame(double wallTime, Camera& camera, bool& bOrthographic)
+{
+	if (m_mode != MODE_REPLAYING)
+	{
+		return(false);
+	}
+
+	// the time since the previous replayed frame covers one full frame
+	if (m_lastWallTime >= 0.0)
+	{
+		m_frameTimes.push_back((float)((wallTime - m_lastWallTime) * 1000.0));
+	}
+	m_lastWallTime = wallTime;
+
+	float simulatedTime = m_replayFrame * m_fixedTimeStep;
+	if (simulatedTime > m_samples.back().time)
+	{
+		m_mode = MODE_IDLE;
+		return(false);
+	}
+
+	CAMERA_SAMPLE sample = SampleCameraPath(simulatedTime);
+	camera.Position = sample.position;
+	camera.Front = sample.front;
+	camera.Up = sample.up;
+	camera.Right = glm::normalize(glm::cross(sample.front, camera.WorldUp));
+	camera.Yaw = sample.yaw;
+	camera.Pitch = sample.pitch;
+	camera.Zoom = sample.zoom;
+	camera.MovementSpeed = sample.movementSpeed;
+	bOrthographic = sample.bOrthographic;
+
+	m_replayFrame++;
+
+	return(true);
+}
+
+/***********************************************************
+ *  ReportFrameTimings()
+ *
+ *  This method is used for printing a summary of the replayed
+ *  frame timings and writing every frame time to a CSV file
+ *  so that runs of different builds can be compared.
+ ***********************************************************/
+void InputRecorder::ReportFrameTimings(const char* csvFilename)
+{
+	if (m_frameTimes.size() == 0)
+	{
+		std::cout << "No replayed frames to report" << std::endl;
+		return;
+	}
+
+	std::vector<float> sorted = m_frameTimes;
+	std::sort(sorted.begin(), sorted.end());
+
+	double total = 0.0;
+	for (size_t i = 0; i < sorted.size(); i++)
+	{
+		total += sorted[i];
+	}
+
+	size_t count = sorted.size();
+	std::cout << "Replay frame timings (ms) - frames:" << count
+		<< ", avg:" << (total / count)
+		<< ", min:" << sorted.front()
+		<< ", p50:" << sorted[(count - 1) / 2]
+		<< ", p95:" << sorted[((count - 1) * 95) / 100]
+		<< ", p99:" << sorted[((count - 1) * 99) / 100]
+		<< ", max:" << sorted.back() << std::endl;
+
+	if (NULL != csvFilename)
+	{
+		std::ofstream file(csvFilename, std::ios::trunc);
+		if (!file.is_open())
+		{
+			std::cout << "Could not write frame timings:" << csvFilename << std::endl;
+			return;
+		}
+
+		file << "frame,simulated_time,frame_ms\n";
+		for (size_t i = 0; i < m_frameTimes.size(); i++)
+		{
+			file << i << "," << (i * m_fixedTimeStep) << "," << m_frameTimes[i] << "\n";
+		}
+		std::cout << "Saved frame timings:" << csvFilename << std::endl;
+	}
+}
@@ -0,0 +1,129 @@
+///////////////////////////////////////////////////////////////////////////////
+// inputrecorder.h
+// ============
+// record timestamped input and camera state to a binary file and replay
+// the recorded camera path at a fixed simulated timestep for benchmarking
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "camera.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  InputRecorder
+ *
+ *  This class captures the live input events and camera
+ *  state while recording, and drives the camera from the
+ *  recorded path while replaying so that performance runs
+ *  can be compared frame by frame.
+ ***********************************************************/
+class InputRecorder
+{
+public:
+	// constructor
+	InputRecorder();
+	// destructor
+	~InputRecorder();
+
+	// bit flags for the polled keyboard keys that are recorded
+	enum KEY_FLAGS
+	{
+		KEY_FORWARD = 1 << 0,
+		KEY_BACKWARD = 1 << 1,
+		KEY_LEFT = 1 << 2,
+		KEY_RIGHT = 1 << 3,
+		KEY_UP = 1 << 4,
+		KEY_DOWN = 1 << 5,
+		KEY_PERSPECTIVE = 1 << 6,
+		KEY_ORTHOGRAPHIC = 1 << 7
+	};
+
+	// snapshot of the camera state at one point in time
+	struct CAMERA_SAMPLE
+	{
+		float time;
+		glm::vec3 position;
+		glm::vec3 front;
+		glm::vec3 up;
+		float yaw;
+		float pitch;
+		float zoom;
+		float movementSpeed;
+		bool bOrthographic;
+	};
+
+	// start capturing input into the specified file
+	bool BeginRecording(const char* filename);
+	// load a recording and start replaying it at a fixed timestep
+	bool BeginReplay(const char* filename, float fixedTimeStep);
+	// stop recording or replaying, writing any captured data
+	void Stop();
+
+	bool IsRecording() const { return(m_mode == MODE_RECORDING); }
+	bool IsReplaying() const { return(m_mode == MODE_REPLAYING); }
+
+	// record the live input events as they are received
+	void RecordKeyState(double time, uint16_t keyMask);
+	void RecordMouseMove(double time, double xMousePos, double yMousePos);
+	void RecordScroll(double time, double yOffset);
+	// record the camera state once per rendered frame
+	void RecordCameraState(double time, const Camera& camera, bool bOrthographic);
+
+	// drive the camera for the next replayed frame - returns
+	// false once the end of the recording has been reached
+	bool ReplayNextFrame(double wallTime, Camera& camera, bool& bOrthographic);
+	// get the simulated timestep used while replaying
+	float GetFixedTimeStep() const { return(m_fixedTimeStep); }
+
+	// print the replayed frame timings and write them to a CSV file
+	void ReportFrameTimings(const char* csvFilename);
+
+private:
+	enum RECORDER_MODE
+	{
+		MODE_IDLE,
+		MODE_RECORDING,
+		MODE_REPLAYING
+	};
+
+	// record types stored in the binary stream
+	enum RECORD_TYPE
+	{
+		RECORD_CAMERA = 1,
+		RECORD_KEYS = 2,
+		RECORD_MOUSE = 3,
+		RECORD_SCROLL = 4
+	};
+
+	RECORDER_MODE m_mode;
+	std::string m_filename;
+	// encoded records waiting to be written when recording stops
+	std::vector<unsigned char> m_stream;
+	// time of the first recorded event
+	double m_startTime;
+	bool m_bStarted;
+	uint16_t m_lastKeyMask;
+
+	// decoded camera path and event totals used for replay
+	std::vector<CAMERA_SAMPLE> m_samples;
+	int m_eventCounts[5];
+	float m_fixedTimeStep;
+	int m_replayFrame;
+	size_t m_replaySample;
+	double m_lastWallTime;
+	// measured duration of every replayed frame in milliseconds
+	std::vector<float> m_frameTimes;
+
+	// convert an absolute time into the recording time base
+	float RecordingTime(double time);
+	// append raw values to the encoded record stream
+	void WriteBytes(const void* pData, size_t size);
+	void WriteFloat(float value);
+	void WriteVec3(const glm::vec3& value);
+	// interpolate the recorded camera path at the given time
+	CAMERA_SAMPLE SampleCameraPath(float time);
+};
@@ -0,0 +1,175 @@
+///////////////////////////////////////////////////////////////////////////////
+// instanceddraws.cpp
+// ============
+// draw runs of queued objects that share their shader state as instances
+// of the basic shapes, with the object settings in an instance buffer
+///////////////////////////////////////////////////////////////////////////////
+
+#include "InstancedDraws.h"
+#include "CompactMeshes.h"
+
+#include <cstddef>
+
+// declaration of global variables
+namespace
+{
+	// first attribute location of the per-object settings, as in
+	// the GPU-driven vertex shader
+	const GLuint g_InstanceLocation = 3;
+}
+
+/***********************************************************
+ *  InstancedDraws()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+InstancedDraws::InstancedDraws()
+{
+}
+
+/***********************************************************
+ *  IsSupported()
+ *
+ *  This method is used for checking that the driver can draw
+ *  with a base instance, which selects the settings of the
+ *  first object of a run.
+ ***********************************************************/
+bool InstancedDraws::IsSupported()
+{
+	return(GLEW_VERSION_4_2 == GL_TRUE);
+}
+
+/***********************************************************
+ *  LoadMeshes()
+ *
+ *  This method is used for building the basic shapes into a
+ *  single vertex and index buffer.  The vertex array also
+ *  reads the per-object settings from the instance buffer,
+ *  one set for each instance.
+ ***********************************************************/
+void InstancedDraws::LoadMeshes()
+{
+	std::vector<CompactMeshes::MESH_VERTEX> vertices;
+	std::vector<uint32_t> indices;
+	m_meshRanges.resize(CompactMeshes::MESH_COUNT);
+	for (int mesh = 0; mesh < CompactMeshes::MESH_COUNT; mesh++)
+	{
+		CompactMeshes::MESH_DATA data;
+		CompactMeshes::BuildMesh(mesh, data);
+		m_meshRanges[mesh].indexCount = (GLsizei)data.indices.size();
+		m_meshRanges[mesh].firstIndex = (GLuint)indices.size();
+		m_meshRanges[mesh].baseVertex = (GLint)vertices.size();
+		vertices.insert(vertices.end(), data.vertices.begin(), data.vertices.end());
+		indices.insert(indices.end(), data.indices.begin(), data.indices.end());
+	}
+
+	glBindVertexArray(m_vertexArray.Create("instanced meshes"));
+
+	glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer.Create("instanced mesh vertices"));
+	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(CompactMeshes::MESH_VERTEX), vertices.data(), GL_STATIC_DRAW);
+	m_vertexBuffer.SetBytes(vertices.size() * sizeof(CompactMeshes::MESH_VERTEX));
+
+	GLsizei stride = sizeof(CompactMeshes::MESH_VERTEX);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(CompactMeshes::MESH_VERTEX, position));
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(CompactMeshes::MESH_VERTEX, normal));
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(CompactMeshes::MESH_VERTEX, uv));
+	glEnableVertexAttribArray(2);
+
+	glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer.Create("instanced object settings"));
+	GLsizei instanceStride = sizeof(GpuCuller::OBJECT_INSTANCE);
+	for (GLuint column = 0; column < 4; column++)
+	{
+		glVertexAttribPointer(g_InstanceLocation + column, 4, GL_FLOAT, GL_FALSE, instanceStride,
+			(void*)(offsetof(GpuCuller::OBJECT_INSTANCE, model) + column * sizeof(glm::vec4)));
+	}
+	glVertexAttribPointer(g_InstanceLocation + 4, 4, GL_FLOAT, GL_FALSE, instanceStride, (void*)offsetof(GpuCuller::OBJECT_INSTANCE, color));
+	glVertexAttribPointer(g_InstanceLocation + 5, 4, GL_FLOAT, GL_FALSE, instanceStride, (void*)offsetof(GpuCuller::OBJECT_INSTANCE, uvScale));
+	glVertexAttribPointer(g_InstanceLocation + 6, 4, GL_FLOAT, GL_FALSE, instanceStride, (void*)offsetof(GpuCuller::OBJECT_INSTANCE, ambient));
+	glVertexAttribPointer(g_InstanceLocation + 7, 4, GL_FLOAT, GL_FALSE, instanceStride, (void*)offsetof(GpuCuller::OBJECT_INSTANCE, diffuse));
+	glVertexAttribPointer(g_InstanceLocation + 8, 4, GL_FLOAT, GL_FALSE, instanceStride, (void*)offsetof(GpuCuller::OBJECT_INSTANCE, specular));
+	for (GLuint location = g_InstanceLocation; location < g_InstanceLocation + 9; location++)
+	{
+		glEnableVertexAttribArray(location);
+		glVertexAttribDivisor(location, 1);
+	}
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer.Create("instanced mesh indices"));
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint32_t), indices.data(), GL_STATIC_DRAW);
+	m_indexBuffer.SetBytes(indices.size() * sizeof(uint32_t));
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+/***********************************************************
+ *  ClearInstances()
+ *
+ *  This method is used for dropping the instances of the
+ *  previous queue, keeping their memory.
+ ***********************************************************/
+void InstancedDraws::ClearInstances()
+{
+	m_instances.clear();
+}
+
+/***********************************************************
+ *  AddInstance()
+ *
+ *  This method is used for adding the settings of an object
+ *  to the instances of the queue.
+ ***********************************************************/
+uint32_t InstancedDraws::AddInstance(const GpuCuller::OBJECT_INSTANCE& instance)
+{
+	m_instances.push_back(instance);
+	return((uint32_t)(m_instances.size() - 1));
+}
+
+/***********************************************************
+ *  UploadInstances()
+ *
+ *  This method is used for replacing the contents of the
+ *  instance buffer with the instances of the queue.  The
+ *  buffer is given new storage each time, so the driver does
+ *  not wait for the draws of the previous queue to finish.
+ ***********************************************************/
+void InstancedDraws::UploadInstances()
+{
+	if (m_instances.empty() == true)
+	{
+		return;
+	}
+
+	size_t bytes = m_instances.size() * sizeof(GpuCuller::OBJECT_INSTANCE);
+	glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer.Get());
+	glBufferData(GL_ARRAY_BUFFER, bytes, m_instances.data(), GL_STREAM_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	m_instanceBuffer.SetBytes(bytes);
+}
+
+/***********************************************************
+ *  DrawInstances()
+ *
+ *  This method is used for drawing the mesh for a range of
+ *  the uploaded instances in one call.
+ ***********************************************************/
+void InstancedDraws::DrawInstances(int mesh, uint32_t firstInstance, uint32_t instanceCount)
+{
+	if ((mesh < 0) || (mesh >= (int)m_meshRanges.size()) || (instanceCount == 0))
+	{
+		return;
+	}
+
+	const MESH_RANGE& range = m_meshRanges[mesh];
+	glBindVertexArray(m_vertexArray.Get());
+	glDrawElementsInstancedBaseVertexBaseInstance(
+		GL_TRIANGLES,
+		range.indexCount,
+		GL_UNSIGNED_INT,
+		(void*)(range.firstIndex * sizeof(uint32_t)),
+		instanceCount,
+		range.baseVertex,
+		firstInstance);
+	glBindVertexArray(0);
+}
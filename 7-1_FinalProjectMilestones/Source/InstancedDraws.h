@@ -0,0 +1,77 @@
+///////////////////////////////////////////////////////////////////////////////
+// instanceddraws.h
+// ============
+// draw runs of queued objects that share their shader state as instances
+// of the basic shapes, with the object settings in an instance buffer
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include "GpuCuller.h"
+#include "GpuResources.h"
+
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  InstancedDraws
+ *
+ *  This class lets the draw queue submit a run of objects
+ *  with the same shader variant, texture and mesh in one
+ *  call.  The basic shapes are kept in one vertex and index
+ *  buffer, and the settings of the objects in the runs of a
+ *  queue are collected into an instance buffer in the layout
+ *  that the GPU-driven shader variants read, the same as for
+ *  the GPU culler.  Each run is then drawn with the base
+ *  instance of its first object, instead of setting the model
+ *  and material uniforms for every object.
+ ***********************************************************/
+class InstancedDraws
+{
+public:
+	// constructor
+	InstancedDraws();
+
+	// true when the driver has the base instance draws of
+	// OpenGL 4.2
+	static bool IsSupported();
+
+	// upload the basic shapes, in the order of
+	// SceneManager::MESH_TYPE
+	void LoadMeshes();
+
+	// drop the instances collected for the previous queue
+	void ClearInstances();
+	// add the settings of an object, returning its instance
+	uint32_t AddInstance(const GpuCuller::OBJECT_INSTANCE& instance);
+	// upload the instances added since ClearInstances()
+	void UploadInstances();
+	// draw the mesh once for each instance of the range with the
+	// bound program
+	void DrawInstances(int mesh, uint32_t firstInstance, uint32_t instanceCount);
+
+	// number of instances added for this queue
+	size_t GetInstanceCount() const { return(m_instances.size()); }
+
+private:
+	// place of a basic shape in the merged buffers
+	struct MESH_RANGE
+	{
+		GLsizei indexCount;
+		GLuint firstIndex;
+		GLint baseVertex;
+	};
+
+	// all of the basic shapes, with the range of each
+	GpuVertexArray m_vertexArray;
+	GpuBuffer m_vertexBuffer;
+	GpuBuffer m_indexBuffer;
+	std::vector<MESH_RANGE> m_meshRanges;
+
+	// settings of the objects of this queue, kept between the
+	// queues so that steady frames do not allocate
+	GpuBuffer m_instanceBuffer;
+	std::vector<GpuCuller::OBJECT_INSTANCE> m_instances;
+};
@@ -0,0 +1,57 @@
+///////////////////////////////////////////////////////////////////////////////
+// keyboardlayouts.cpp
+// ============
+// describe the keyboard layouts row by row and expand them at compile time
+// into tables of key placements
+///////////////////////////////////////////////////////////////////////////////
+
+#include "KeyboardLayouts.h"
+
+// the layouts are checked as they are expanded, so a row list
+// that does not add up fails the build
+static_assert(KeyboardLayouts::CountKeys<KeyboardLayouts::COMPACT_LAYOUT>() == 43,
+	"the compact layout must match the hand-built key grid");
+static_assert(KeyboardLayouts::KeyboardTable<KeyboardLayouts::ANSI_LAYOUT>::width == 15.0f,
+	"the rows of the ANSI layout must be 15 keys wide");
+static_assert(KeyboardLayouts::KeyboardTable<KeyboardLayouts::ISO_LAYOUT>::width == 15.0f,
+	"the rows of the ISO layout must be 15 keys wide");
+static_assert(KeyboardLayouts::KeyboardTable<KeyboardLayouts::ISO_LAYOUT>::keys[27].depth == 2.0f,
+	"the ISO enter must reach into the row below it");
+
+/***********************************************************
+ *  GetKeyboardTable()
+ *
+ *  This function is used for getting the compile-time table
+ *  of the layout chosen while the program runs.
+ ***********************************************************/
+KeyboardLayouts::KEYBOARD_TABLE KeyboardLayouts::GetKeyboardTable(KEYBOARD_LAYOUT layout)
+{
+	switch (layout)
+	{
+	case KEYBOARD_ANSI:
+		return(KeyboardTable<ANSI_LAYOUT>::Get());
+	case KEYBOARD_ISO:
+		return(KeyboardTable<ISO_LAYOUT>::Get());
+	default:
+		return(KeyboardTable<COMPACT_LAYOUT>::Get());
+	}
+}
+
+/***********************************************************
+ *  GetKeyboardLayoutName()
+ *
+ *  This function is used for getting the display name of
+ *  the layout.
+ ***********************************************************/
+const char* KeyboardLayouts::GetKeyboardLayoutName(KEYBOARD_LAYOUT layout)
+{
+	switch (layout)
+	{
+	case KEYBOARD_ANSI:
+		return("ANSI");
+	case KEYBOARD_ISO:
+		return("ISO");
+	default:
+		return("compact");
+	}
+}
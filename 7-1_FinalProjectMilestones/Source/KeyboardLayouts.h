@@ -0,0 +1,215 @@
+///////////////////////////////////////////////////////////////////////////////
+// keyboardlayouts.h
+// ============
+// describe the keyboard layouts row by row and expand them at compile time
+// into tables of key placements
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+
+/***********************************************************
+ *  KeyboardLayouts
+ *
+ *  Each layout lists its keys row by row as widths in key
+ *  units, where one unit is a standard key.  Gaps leave
+ *  space without a key, and a key deeper than one unit
+ *  hangs down into the rows below it.  The lists are turned
+ *  into fixed tables of key centers and sizes by constexpr
+ *  functions, so the layouts cost nothing while the scene is
+ *  built beyond copying the table.
+ ***********************************************************/
+namespace KeyboardLayouts
+{
+	// one entry of a layout row list
+	struct KEY_SPEC
+	{
+		// width in key units - zero ends the row
+		float width;
+		// depth in key units, reaching into the following rows
+		float depth;
+		// true for space that is left without a key
+		bool bGap;
+	};
+
+	// placement of one key, in key units from the center of
+	// the top left key
+	struct KEY_INSTANCE
+	{
+		float x;
+		float z;
+		float width;
+		float depth;
+	};
+
+	// expanded layout, as handed to the scene
+	struct KEYBOARD_TABLE
+	{
+		const KEY_INSTANCE* pKeys;
+		int keyCount;
+		// size of the layout in key units
+		float width;
+		float depth;
+	};
+
+	// layouts that can be placed on a desk
+	enum KEYBOARD_LAYOUT
+	{
+		// the hand-built 12 column grid with a spacebar
+		KEYBOARD_COMPACT,
+		// typing block of a US keyboard
+		KEYBOARD_ANSI,
+		// typing block of a European keyboard, with the tall enter
+		KEYBOARD_ISO,
+		KEYBOARD_LAYOUT_COUNT
+	};
+
+	// shorthands for writing the row lists
+	constexpr KEY_SPEC Key(float width = 1.0f, float depth = 1.0f) { return { width, depth, false }; }
+	constexpr KEY_SPEC Gap(float width) { return { width, 1.0f, true }; }
+	constexpr KEY_SPEC RowEnd() { return { 0.0f, 0.0f, false }; }
+
+	struct COMPACT_LAYOUT
+	{
+		static constexpr KEY_SPEC keys[] =
+		{
+			Key(), Key(), Key(), Key(), Key(), Key(), Key(), Key(), Key(), Key(), Key(), Key(), RowEnd(),
+			Key(), Key(), Key(), Key(), Key(), Key(), Key(), Key(), Key(), Key(), Key(), Key(), RowEnd(),
+			Key(), Key(), Key(), Key(), Key(), Key(), Key(), Key(), Key(), Key(), Key(), Key(), RowEnd(),
+			Key(), Key(), Key(), Key(6.0f), Key(), Key(), Key(), RowEnd()
+		};
+	};
+
+	struct ANSI_LAYOUT
+	{
+		static constexpr KEY_SPEC keys[] =
+		{
+			// number row and backspace
+			Key(), Key(), Key(), Key(), Key(), Key(), Key(), Key(), Key(), Key(), Key(), Key(), Key(), Key(2.0f), RowEnd(),
+			// tab, letters and backslash
+			Key(1.5f), Key(), Key(), Key(), Key(), Key(), Key(), Key(), Key(), Key(), Key(), Key(), Key(), Key(1.5f), RowEnd(),
+			// caps lock, letters and enter
+			Key(1.75f), Key(), Key(), Key(), Key(), Key(), Key(), Key(), Key(), Key(), Key(), Key(), Key(2.25f), RowEnd(),
+			// shifts around the letters
+			Key(2.25f), Key(), Key(), Key(), Key(), Key(), Key(), Key(), Key(), Key(), Key(), Key(2.75f), RowEnd(),
+			// modifiers around the spacebar
+			Key(1.25f), Key(1.25f), Key(1.25f), Key(6.25f), Key(1.25f), Key(1.25f), Key(1.25f), Key(1.25f), RowEnd()
+		};
+	};
+
+	struct ISO_LAYOUT
+	{
+		static constexpr KEY_SPEC keys[] =
+		{
+			// number row and backspace
+			Key(), Key(), Key(), Key(), Key(), Key(), Key(), Key(), Key(), Key(), Key(), Key(), Key(), Key(2.0f), RowEnd(),
+			// tab, letters and the two row enter
+			Key(1.5f), Key(), Key(), Key(), Key(), Key(), Key(), Key(), Key(), Key(), Key(), Key(), Key(), Gap(0.25f), Key(1.25f, 2.0f), RowEnd(),
+			// caps lock and letters, leaving room for the enter
+			Key(1.75f), Key(), Key(), Key(), Key(), Key(), Key(), Key(), Key(), Key(), Key(), Key(), Key(), Gap(1.25f), RowEnd(),
+			// short left shift with the extra key beside it
+			Key(1.25f), Key(), Key(), Key(), Key(), Key(), Key(), Key(), Key(), Key(), Key(), Key(), Key(2.75f), RowEnd(),
+			// modifiers around the spacebar
+			Key(1.25f), Key(1.25f), Key(1.25f), Key(6.25f), Key(1.25f), Key(1.25f), Key(1.25f), Key(1.25f), RowEnd()
+		};
+	};
+
+	// number of keys drawn for the layout
+	template <typename LAYOUT>
+	constexpr int CountKeys()
+	{
+		int count = 0;
+		for (const KEY_SPEC& spec : LAYOUT::keys)
+		{
+			if ((spec.width > 0.0f) && (spec.bGap == false))
+			{
+				count++;
+			}
+		}
+		return(count);
+	}
+
+	// width of the widest row and number of rows, in key units
+	template <typename LAYOUT>
+	constexpr float MeasureWidth()
+	{
+		float width = 0.0f;
+		float rowWidth = 0.0f;
+		for (const KEY_SPEC& spec : LAYOUT::keys)
+		{
+			rowWidth += spec.width;
+			if (spec.width == 0.0f)
+			{
+				width = (rowWidth > width) ? rowWidth : width;
+				rowWidth = 0.0f;
+			}
+		}
+		return(width);
+	}
+
+	template <typename LAYOUT>
+	constexpr float MeasureDepth()
+	{
+		float depth = 0.0f;
+		for (const KEY_SPEC& spec : LAYOUT::keys)
+		{
+			if (spec.width == 0.0f)
+			{
+				depth += 1.0f;
+			}
+		}
+		return(depth);
+	}
+
+	// place the keys of the layout from left to right and top
+	// to bottom
+	template <typename LAYOUT>
+	constexpr std::array<KEY_INSTANCE, CountKeys<LAYOUT>()> ExpandLayout()
+	{
+		std::array<KEY_INSTANCE, CountKeys<LAYOUT>()> instances = {};
+		int count = 0;
+		float left = 0.0f;
+		float row = 0.0f;
+		for (const KEY_SPEC& spec : LAYOUT::keys)
+		{
+			if (spec.width == 0.0f)
+			{
+				left = 0.0f;
+				row += 1.0f;
+				continue;
+			}
+			if (spec.bGap == false)
+			{
+				instances[count].x = left + (spec.width * 0.5f) - 0.5f;
+				instances[count].z = row + (spec.depth * 0.5f) - 0.5f;
+				instances[count].width = spec.width;
+				instances[count].depth = spec.depth;
+				count++;
+			}
+			left += spec.width;
+		}
+		return(instances);
+	}
+
+	// expanded keys of the layout, built by the compiler
+	template <typename LAYOUT>
+	struct KeyboardTable
+	{
+		static constexpr std::array<KEY_INSTANCE, CountKeys<LAYOUT>()> keys = ExpandLayout<LAYOUT>();
+		static constexpr float width = MeasureWidth<LAYOUT>();
+		static constexpr float depth = MeasureDepth<LAYOUT>();
+
+		static KEYBOARD_TABLE Get()
+		{
+			KEYBOARD_TABLE table = { keys.data(), (int)keys.size(), width, depth };
+			return(table);
+		}
+	};
+
+	// get the expanded table for the layout
+	KEYBOARD_TABLE GetKeyboardTable(KEYBOARD_LAYOUT layout);
+	// get the display name of the layout
+	const char* GetKeyboardLayoutName(KEYBOARD_LAYOUT layout);
+}
@@ -1,5 +1,11 @@
 #include <iostream>         // error handling and output
 #include <cstdlib>          // EXIT_FAILURE
+#include <cstring>          // command line parsing
+#include <cstdio>           // stress scene size parsing
+#include <iomanip>          // window title formatting
+#include <sstream>
+#include <cassert>          // steady state allocation check
+#include <string>
 
 #include <GL/glew.h>        // GLEW library
 #include "GLFW/glfw3.h"     // GLFW library
@@ -13,6 +19,17 @@
 #include "ViewManager.h"
 #include "ShapeMeshes.h"
 #include "ShaderManager.h"
+#include "InputRecorder.h"
+#include "ShaderCache.h"
+#include "ShaderVariants.h"
+#include "BatchRenderer.h"
+#include "RegressionHarness.h"
+#include "FrameCapture.h"
+#include "DynamicResolution.h"
+#include "StressBenchmark.h"
+#include "AllocationCounter.h"
+#include "GpuResources.h"
+#include "MetricsServer.h"
 
 // Namespace for declaring global variables
 namespace
@@ -25,16 +42,110 @@ namespace
 
 	// scene manager object for managing the 3D scene prepare and render
 	SceneManager* g_SceneManager = nullptr;
-	// shader manager object for dynamic interaction with the shader code
+	// shader manager object, which only builds the general program when
+	// the shader cache cannot
 	ShaderManager* g_ShaderManager = nullptr;
+	// specialized shader programs used for rendering the scene
+	ShaderVariants* g_ShaderVariants = nullptr;
 	// view manager object for managing the 3D view setup and projection to 2D
 	ViewManager* g_ViewManager = nullptr;
+	// input recorder object for capturing and replaying camera paths
+	InputRecorder* g_InputRecorder = nullptr;
+	// frame capture object for screenshots and image sequences
+	FrameCapture* g_FrameCapture = nullptr;
+	// dynamic resolution object for holding the target frame rate
+	DynamicResolution* g_DynamicResolution = nullptr;
+	// metrics server object for exporting the frame counters
+	MetricsServer* g_MetricsServer = nullptr;
+
+	// directory for the cached shader program binaries
+	const char* const SHADER_CACHE_DIRECTORY = "shadercache";
+	// directory holding the block-compressed textures
+	const char* const TEXTURE_CACHE_DIRECTORY = "texturecache";
+	// GLSL files for the scene shaders
+	const char* const VERTEX_SHADER_PATH = "shaders/vertexShader.glsl";
+	const char* const FRAGMENT_SHADER_PATH = "shaders/fragmentShader.glsl";
+	// GLSL files for the compute shaders of the GPU culling
+	const char* const CULLING_SHADER_PATH = "shaders/cullingShader.glsl";
+	const char* const DEPTH_PYRAMID_SHADER_PATH = "shaders/depthPyramidShader.glsl";
+	// GLSL files for copying the cached static layer into the frame
+	const char* const STATIC_LAYER_VERTEX_SHADER_PATH = "shaders/staticLayerVertexShader.glsl";
+	const char* const STATIC_LAYER_FRAGMENT_SHADER_PATH = "shaders/staticLayerFragmentShader.glsl";
+
+	// command line options for recording or replaying the camera input
+	const char* g_RecordFilename = nullptr;
+	const char* g_ReplayFilename = nullptr;
+	float g_ReplayTimeStep = 1.0f / 60.0f;
+	// command line option for the opaque depth prepass
+	bool g_bDepthPrepass = false;
+	// command line option for the quantized vertex layout
+	bool g_bCompactMeshes = false;
+	// command line option for the block-compressed textures
+	bool g_bTextureCompression = true;
+	// command line options for rendering on the CPU
+	bool g_bSoftwareRendering = false;
+	int g_SoftwareThreads = 0;
+
+	// directory holding the regression poses, budgets and references
+	const char* const REGRESSION_DIRECTORY = "regression";
+	// command line options for running the regression checks
+	bool g_bRegression = false;
+	bool g_bRegressionUpdate = false;
+	// command line options for rendering a file of camera views
+	const char* g_BatchFilename = nullptr;
+	const char* g_BatchDirectory = "batch";
+
+	// directory for the screenshots taken with the F12 key
+	const char* const SCREENSHOT_DIRECTORY = "screenshots";
+	// command line options for capturing image sequences
+	const char* g_CaptureFilename = nullptr;
+	FrameCapture::CAPTURE_FORMAT g_CaptureFormat = FrameCapture::CAPTURE_PNG;
+	int g_CaptureFramesPerSecond = 60;
+
+	// command line options for the dynamic resolution scaling
+	bool g_bDynamicResolution = false;
+	float g_TargetFramesPerSecond = 60.0f;
+	// command line option for the CPU occlusion culling
+	bool g_bOcclusionCulling = true;
+	// command line option for drawing the runs of shared state as
+	// instances
+	bool g_bInstancedDraws = true;
+	// command line options for culling and drawing on the GPU
+	bool g_bGpuCulling = false;
+	bool g_bGpuOcclusion = false;
+	// command line option for caching the static objects
+	bool g_bStaticLayerCache = false;
+
+	// command line options for the imported model
+	const char* g_ModelFilename = nullptr;
+	float g_ModelScale = 0.0f;
+
+	// command line option for the localhost metrics port
+	int g_MetricsPort = 0;
+
+	// command line option for loading the assets in the background
+	bool g_bProgressiveStartup = false;
+
+	// command line options for the generated stress scene
+	int g_StressColumns = 0;
+	int g_StressRows = 0;
+	unsigned int g_StressSeed = 1;
+	bool g_bStressBenchmark = false;
+	int g_StressMaxObjects = 1000000;
+
+	// frames rendered before the debug build checks that frames
+	// make no heap allocations - the shader variants are compiled
+	// and the frame arena grows during the first frames
+	const int g_AllocationWarmupFrames = 60;
 }
 
 // Function declarations - all functions that are called manually
 // need to be pre-declared at the beginning of the source code.
 bool InitializeGLFW();
 bool InitializeGLEW();
+bool ParseCommandLine(int argc, char* argv[]);
+void RenderFrame();
+void UpdateWindowTitle();
 
 
 /***********************************************************
@@ -45,17 +156,29 @@ bool InitializeGLEW();
  ***********************************************************/
 int main(int argc, char* argv[])
 {
+	// if the command line options are invalid, then terminate the application
+	if (ParseCommandLine(argc, argv) == false)
+	{
+		return(EXIT_FAILURE);
+	}
+
 	// if GLFW fails initialization, then terminate the application
 	if (InitializeGLFW() == false)
 	{
 		return(EXIT_FAILURE);
 	}
 
-	// try to create a new shader manager object
-	g_ShaderManager = new ShaderManager();
-	// try to create a new view manager object
-	g_ViewManager = new ViewManager(
-		g_ShaderManager);
+	// try to create a new view manager object - the view settings
+	// reach the shader programs through the scene manager, so the
+	// view manager does not upload them itself
+	g_ViewManager = new ViewManager(NULL);
+
+	// the regression checks, the stress benchmark and the batch
+	// views render without showing a window
+	if ((g_bRegression == true) || (g_bStressBenchmark == true) || (NULL != g_BatchFilename))
+	{
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	}
 
 	// try to create the main display window
 	g_Window = g_ViewManager->CreateDisplayWindow(WINDOW_TITLE);
@@ -66,42 +189,293 @@ int main(int argc, char* argv[])
 		return(EXIT_FAILURE);
 	}
 
-	// load the shader code from the external GLSL files
-	g_ShaderManager->LoadShaders(
-		"../../Utilities/shaders/vertexShader.glsl",
-		"../../Utilities/shaders/fragmentShader.glsl");
-	g_ShaderManager->use();
+	// the shader variants own the general program and the programs
+	// specialized from it, which are compiled on first use with the
+	// general program as the fallback for any that fail to build
+	ShaderCache shaderCache(SHADER_CACHE_DIRECTORY);
+	g_ShaderVariants = new ShaderVariants(
+		&shaderCache,
+		VERTEX_SHADER_PATH,
+		FRAGMENT_SHADER_PATH);
+
+	// load the shader code from the external GLSL files, reusing the
+	// program binary cached by a previous launch when it still matches
+	if (g_ShaderVariants->LoadGeneralProgram() == false)
+	{
+		// fall back to the shader manager for building the program
+		// when the cache could not provide it
+		g_ShaderManager = new ShaderManager();
+		g_ShaderVariants->SetGeneralProgram(g_ShaderManager->LoadShaders(
+			VERTEX_SHADER_PATH,
+			FRAGMENT_SHADER_PATH));
+	}
+	g_ShaderVariants->UseGeneralProgram();
 
 	// try to create a new scene manager object and prepare the 3D scene
-	g_SceneManager = new SceneManager(g_ShaderManager);
+	g_SceneManager = new SceneManager(g_ShaderVariants);
+	g_SceneManager->SetDepthPrepass(g_bDepthPrepass);
+	g_SceneManager->SetCompactMeshes(g_bCompactMeshes);
+	g_SceneManager->SetTextureCompression(g_bTextureCompression, TEXTURE_CACHE_DIRECTORY);
+	g_SceneManager->SetSoftwareRendering(g_bSoftwareRendering, g_SoftwareThreads);
+	g_SceneManager->SetOcclusionCulling(g_bOcclusionCulling);
+	g_SceneManager->SetInstancedDraws(g_bInstancedDraws);
+	g_SceneManager->SetGpuCulling(g_bGpuCulling, g_bGpuOcclusion, CULLING_SHADER_PATH, DEPTH_PYRAMID_SHADER_PATH);
+	g_SceneManager->SetStaticLayerCache(g_bStaticLayerCache, STATIC_LAYER_VERTEX_SHADER_PATH, STATIC_LAYER_FRAGMENT_SHADER_PATH);
+	if (NULL != g_ModelFilename)
+	{
+		g_SceneManager->SetModel(g_ModelFilename, g_ModelScale);
+	}
+	g_SceneManager->SetProgressiveLoading(g_bProgressiveStartup);
 	g_SceneManager->PrepareScene();
+	if (g_StressColumns > 0)
+	{
+		g_SceneManager->GenerateStressScene(g_StressColumns, g_StressRows, g_StressSeed);
+	}
+	GpuResources::ReportUsage();
+
+	// set up the recording or replaying of the camera input
+	if ((NULL != g_RecordFilename) || (NULL != g_ReplayFilename))
+	{
+		g_InputRecorder = new InputRecorder();
+		if (NULL != g_ReplayFilename)
+		{
+			if (g_InputRecorder->BeginReplay(g_ReplayFilename, g_ReplayTimeStep) == false)
+			{
+				return(EXIT_FAILURE);
+			}
+			// do not let the display refresh rate limit the replayed frames
+			glfwSwapInterval(0);
+		}
+		else if (g_InputRecorder->BeginRecording(g_RecordFilename) == false)
+		{
+			return(EXIT_FAILURE);
+		}
+		g_ViewManager->SetInputRecorder(g_InputRecorder);
+	}
+
+	// set up the capture of screenshots and image sequences
+	g_FrameCapture = new FrameCapture(SCREENSHOT_DIRECTORY);
+	if ((NULL != g_CaptureFilename) &&
+		(g_FrameCapture->BeginSequence(g_CaptureFilename, g_CaptureFormat, g_CaptureFramesPerSecond) == false))
+	{
+		return(EXIT_FAILURE);
+	}
+
+	// render at a scale that holds the target frame rate
+	if (g_bDynamicResolution == true)
+	{
+		g_DynamicResolution = new DynamicResolution(g_TargetFramesPerSecond);
+	}
+
+	// export the frame and resource counters for scraping
+	if (g_MetricsPort > 0)
+	{
+		g_MetricsServer = new MetricsServer();
+		if (g_MetricsServer->Start(g_MetricsPort) == false)
+		{
+			return(EXIT_FAILURE);
+		}
+		g_MetricsServer->SetTargetFramesPerSecond(g_TargetFramesPerSecond);
+		g_ViewManager->SetMetricsServer(g_MetricsServer);
+	}
+
+	// Enable z-depth
+	glEnable(GL_DEPTH_TEST);
+
+	// render the regression poses instead of running interactively
+	int exitCode = EXIT_SUCCESS;
+	if (g_bRegression == true)
+	{
+		RegressionHarness harness(g_ViewManager, g_SceneManager, &RenderFrame);
+		if (harness.Run(REGRESSION_DIRECTORY, g_bRegressionUpdate) != 0)
+		{
+			exitCode = EXIT_FAILURE;
+		}
+		glfwSetWindowShouldClose(g_Window, true);
+	}
+
+	// render the stress scene at each scale step
+	if (g_bStressBenchmark == true)
+	{
+		StressBenchmark benchmark(g_ViewManager, g_SceneManager, &RenderFrame);
+		benchmark.Run(g_StressMaxObjects, g_StressSeed);
+		glfwSetWindowShouldClose(g_Window, true);
+	}
+
+	// render every view of the batch file into images
+	if (NULL != g_BatchFilename)
+	{
+		BatchRenderer batch(g_ViewManager, g_SceneManager, &RenderFrame);
+		if (batch.Run(g_BatchFilename, g_BatchDirectory) != 0)
+		{
+			exitCode = EXIT_FAILURE;
+		}
+		glfwSetWindowShouldClose(g_Window, true);
+	}
+
+	// seconds since GLFW was initialized at startup until the first
+	// frame was shown and until every asset was swapped in
+	double firstFrameTime = 0.0;
+	double loadedTime = 0.0;
 
 	// loop will keep running until the application is closed 
 	// or until an error has occurred
+	int renderedFrames = 0;
+	// last frame that swapped in assets loaded in the background
+	int lastLoadingFrame = 0;
+	// start of the previous frame, for the time between frames
+	double previousFrameStartTime = 0.0;
 	while (!glfwWindowShouldClose(g_Window))
 	{
-		// Enable z-depth
-		glEnable(GL_DEPTH_TEST);
+		double frameStartTime = glfwGetTime();
+
+		// the previous frame is counted once this one starts, so its
+		// time covers everything the loop did until the next frame
+		if ((NULL != g_MetricsServer) && (previousFrameStartTime > 0.0))
+		{
+			g_MetricsServer->RecordFrame(frameStartTime - previousFrameStartTime, g_SceneManager->GetFrameStats().drawCalls);
+		}
+		previousFrameStartTime = frameStartTime;
+		int framebufferWidth = 0;
+		int framebufferHeight = 0;
+		g_ViewManager->GetFramebufferSize(framebufferWidth, framebufferHeight);
+		long long allocationsBefore = AllocationCounter::GetThreadAllocations();
+		bool bLoadingFrame = g_SceneManager->IsLoading();
 
-		// Clear the frame and z buffers
-		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		// render the 3D scene for the current view, through the
+		// scaled offscreen target when dynamic resolution is on
+		if ((NULL != g_DynamicResolution) && (framebufferWidth > 0) && (framebufferHeight > 0))
+		{
+			g_DynamicResolution->BeginFrame(framebufferWidth, framebufferHeight);
+			RenderFrame();
+			g_DynamicResolution->EndFrame();
+		}
+		else
+		{
+			RenderFrame();
+		}
 
-		// convert from 3D object space to 2D view
-		g_ViewManager->PrepareSceneView();
+		// in debug builds, once the scene has warmed up, rendering a
+		// frame must not touch the heap - the recorded input grows
+		// its event lists, so it is left out of the check, and the
+		// frames swapping in the loaded assets allocate them, so the
+		// scene warms up again after the last of them
+		renderedFrames++;
+		if (bLoadingFrame == true)
+		{
+			lastLoadingFrame = renderedFrames;
+		}
+		if ((AllocationCounter::IsEnabled() == true) &&
+			(renderedFrames - lastLoadingFrame > g_AllocationWarmupFrames) &&
+			(NULL == g_InputRecorder))
+		{
+			long long frameAllocations = AllocationCounter::GetThreadAllocations() - allocationsBefore;
+			if (frameAllocations != 0)
+			{
+				std::cout << "Frame " << renderedFrames << " made " << frameAllocations
+					<< " heap allocations" << std::endl;
+			}
+			assert(frameAllocations == 0);
+		}
 
-		// refresh the 3D scene
-		g_SceneManager->RenderScene();
+		// read the frame back for any screenshot or capture sequence
+		if (g_ViewManager->TakeScreenshotRequest() == true)
+		{
+			g_FrameCapture->RequestScreenshot();
+		}
+		g_FrameCapture->CaptureFrame(framebufferWidth, framebufferHeight);
+
+		// report the object under the cursor when it is clicked
+		glm::vec3 pickOrigin;
+		glm::vec3 pickDirection;
+		if (g_ViewManager->TakePickRequest(pickOrigin, pickDirection) == true)
+		{
+			SceneManager::PICK_RESULT pick;
+			if (g_SceneManager->PickObject(pickOrigin, pickDirection, pick) == true)
+			{
+				std::cout << "Picked object " << pick.entity.slot << " ("
+					<< SceneManager::GetMeshName(pick.mesh) << ") at "
+					<< pick.position.x << ", " << pick.position.y << ", " << pick.position.z
+					<< " - distance " << pick.distance << std::endl;
+			}
+			else
+			{
+				std::cout << "Picked nothing" << std::endl;
+			}
+		}
+
+		// show the frame rate and the rendering statistics
+		UpdateWindowTitle();
 
 
 		// Flips the the back buffer with the front buffer every frame.
 		glfwSwapBuffers(g_Window);
 
+		// report how long the startup took, the assets being
+		// loaded in the background with progressive startup
+		if (firstFrameTime == 0.0)
+		{
+			firstFrameTime = glfwGetTime();
+			std::cout << "Time to first frame: " << firstFrameTime << " s" << std::endl;
+		}
+		if ((loadedTime == 0.0) && (g_SceneManager->IsLoading() == false))
+		{
+			loadedTime = glfwGetTime();
+			std::cout << "Time to fully loaded: " << loadedTime << " s" << std::endl;
+		}
+
 		// query the latest GLFW events
 		glfwPollEvents();
+
+		// export the counters of the frame, which only stores them
+		// and never waits for the metrics server
+		if (NULL != g_MetricsServer)
+		{
+			GpuResources::CATEGORY_STATS textureStats = GpuResources::GetStats(GpuResources::CATEGORY_TEXTURE);
+			g_MetricsServer->SetResources(textureStats.liveCount, textureStats.bytes, g_SceneManager->GetLoadedMeshCount());
+			g_MetricsServer->SetCaptureDroppedFrames(g_FrameCapture->GetDroppedFrames());
+			g_MetricsServer->SetStartupTimes((float)firstFrameTime, (float)loadedTime);
+		}
+	}
+
+	if (NULL != g_MetricsServer)
+	{
+		g_ViewManager->SetMetricsServer(NULL);
+		g_MetricsServer->Stop();
+		delete g_MetricsServer;
+		g_MetricsServer = NULL;
+	}
+
+	if (NULL != g_DynamicResolution)
+	{
+		g_DynamicResolution->Report();
+		delete g_DynamicResolution;
+		g_DynamicResolution = NULL;
+	}
+
+	// write out the frames still being read back or encoded
+	if (NULL != g_FrameCapture)
+	{
+		g_FrameCapture->Finish();
+		delete g_FrameCapture;
+		g_FrameCapture = NULL;
+	}
+
+	// report the replayed frame timings and save any recorded input
+	if (NULL != g_InputRecorder)
+	{
+		if (NULL != g_ReplayFilename)
+		{
+			std::string timingsFilename = std::string(g_ReplayFilename) + ".timings.csv";
+			g_InputRecorder->ReportFrameTimings(timingsFilename.c_str());
+		}
+		g_ViewManager->SetInputRecorder(NULL);
+		delete g_InputRecorder;
+		g_InputRecorder = NULL;
 	}
 
 	// clear the allocated manager objects from memory
+	GpuResources::ReportUsage();
 	if (NULL != g_SceneManager)
 	{
 		delete g_SceneManager;
@@ -112,14 +486,333 @@ int main(int argc, char* argv[])
 		delete g_ViewManager;
 		g_ViewManager = NULL;
 	}
+	if (NULL != g_ShaderVariants)
+	{
+		delete g_ShaderVariants;
+		g_ShaderVariants = NULL;
+	}
 	if (NULL != g_ShaderManager)
 	{
 		delete g_ShaderManager;
 		g_ShaderManager = NULL;
 	}
 
-	// Terminates the program successfully
-	exit(EXIT_SUCCESS); 
+	// every OpenGL object owned by a handle should be gone by now
+	GpuResources::ReportLeaks();
+
+	// Terminates the program, failing when a regression check failed
+	exit(exitCode); 
+}
+
+/***********************************************************
+ *	RenderFrame()
+ *
+ *  This function is used to render one frame of the 3D scene
+ *  into the bound framebuffer.
+ ***********************************************************/
+void RenderFrame()
+{
+	// Clear the frame and z buffers
+	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	// convert from 3D object space to 2D view
+	g_ViewManager->PrepareSceneView();
+	g_SceneManager->SetSceneView(
+		g_ViewManager->GetViewMatrix(),
+		g_ViewManager->GetProjectionMatrix(),
+		g_ViewManager->GetViewPosition());
+
+	// refresh the 3D scene
+	g_SceneManager->RenderScene();
+}
+
+/***********************************************************
+ *	UpdateWindowTitle()
+ *
+ *  This function is used to show the frame rate and the
+ *  rendering statistics of the last frame in the window
+ *  title, refreshed once a second.
+ ***********************************************************/
+void UpdateWindowTitle()
+{
+	static double lastUpdateTime = glfwGetTime();
+	static int frameCount = 0;
+
+	frameCount++;
+	double currentTime = glfwGetTime();
+	if (currentTime - lastUpdateTime < 1.0)
+	{
+		return;
+	}
+
+	const SceneManager::FRAME_STATS& stats = g_SceneManager->GetFrameStats();
+	std::ostringstream title;
+	title << std::fixed << std::setprecision(0)
+		<< WINDOW_TITLE << " - "
+		<< frameCount / (currentTime - lastUpdateTime) << " fps - "
+		<< stats.drawCalls << " draws, "
+		<< stats.occlusionCulled << " occluded, "
+		<< stats.frustumCulled << " outside view";
+	if (stats.cachedDraws > 0)
+	{
+		title << ", " << stats.cachedDraws << " cached";
+	}
+	if (NULL != g_DynamicResolution)
+	{
+		title << " - " << g_DynamicResolution->GetScale() * 100.0f << "% resolution";
+	}
+	glfwSetWindowTitle(g_Window, title.str().c_str());
+
+	lastUpdateTime = currentTime;
+	frameCount = 0;
+}
+
+/***********************************************************
+ *	ParseCommandLine()
+ *
+ *  This function is used to read the options passed on the
+ *  command line.
+ *
+ *    --record <file>       record the camera input to a file
+ *    --replay <file>       replay a recorded camera path
+ *    --replay-step <sec>   fixed timestep used for the replay
+ *    --depth-prepass       lay down the opaque depth before shading
+ *    --compact-meshes      draw the basic shapes from quantized
+ *                          vertices and report their sizes
+ *    --no-texture-compression  upload the textures uncompressed
+ *                          instead of as cached BC1, BC3 or BC7
+ *    --software            render with the multithreaded CPU
+ *                          rasterizer instead of OpenGL
+ *    --software-threads <n>  threads used by the CPU rasterizer,
+ *                          every core by default
+ *    --regression          check the rendered poses against the
+ *                          reference images and budgets
+ *    --regression-update   store the rendered poses as the new
+ *                          reference images
+ *    --capture <prefix>    capture every frame to numbered PNG files
+ *    --capture-y4m <file>  capture every frame to a Y4M video stream
+ *    --capture-fps <n>     frame rate written to the Y4M stream
+ *    --dynamic-resolution  scale the rendering resolution to hold
+ *                          the target frame rate
+ *    --target-fps <n>      frame rate held by the dynamic resolution
+ *    --no-occlusion-culling  draw the objects hidden by occluders
+ *    --no-instancing       draw each object on its own instead of
+ *                          the runs of shared state as instances
+ *    --gpu-culling         cull the opaque objects in a compute
+ *                          shader and draw them indirectly
+ *    --gpu-occlusion       also cull them against the depth of
+ *                          the previous frame
+ *    --static-cache        keep the objects that never moved
+ *                          rendered while the view does not
+ *                          change, drawing only the others
+ *    --model <file>        place the model from an .obj or .glb
+ *                          file on the desk
+ *    --model-scale <s>     scale of the model, fitted to the
+ *                          desk by default
+ *    --progressive-startup  show the first frame with placeholder
+ *                          textures while the textures and the
+ *                          model load in the background
+ *    --stress <cols>x<rows>  draw a generated grid of desks
+ *    --stress-seed <n>     seed for generating the stress scene
+ *    --stress-benchmark    report how the generated scene scales
+ *                          from 10 objects up to the maximum
+ *    --stress-max <n>      most objects in the stress benchmark
+ *    --batch <file>        render an image for every camera view
+ *                          in the file and exit
+ *    --batch-output <dir>  directory for the batch images
+ *    --metrics-port <n>    serve the frame and resource counters
+ *                          in the Prometheus text format on
+ *                          http://127.0.0.1:<n>/metrics
+ ***********************************************************/
+bool ParseCommandLine(int argc, char* argv[])
+{
+	for (int i = 1; i < argc; i++)
+	{
+		bool bHasValue = (i + 1 < argc);
+
+		if ((strcmp(argv[i], "--record") == 0) && bHasValue)
+		{
+			g_RecordFilename = argv[++i];
+		}
+		else if ((strcmp(argv[i], "--replay") == 0) && bHasValue)
+		{
+			g_ReplayFilename = argv[++i];
+		}
+		else if ((strcmp(argv[i], "--replay-step") == 0) && bHasValue)
+		{
+			g_ReplayTimeStep = (float)atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--depth-prepass") == 0)
+		{
+			g_bDepthPrepass = true;
+		}
+		else if (strcmp(argv[i], "--compact-meshes") == 0)
+		{
+			g_bCompactMeshes = true;
+		}
+		else if (strcmp(argv[i], "--no-texture-compression") == 0)
+		{
+			g_bTextureCompression = false;
+		}
+		else if (strcmp(argv[i], "--software") == 0)
+		{
+			g_bSoftwareRendering = true;
+		}
+		else if ((strcmp(argv[i], "--software-threads") == 0) && bHasValue)
+		{
+			g_bSoftwareRendering = true;
+			g_SoftwareThreads = atoi(argv[++i]);
+		}
+		else if ((strcmp(argv[i], "--capture") == 0) && bHasValue)
+		{
+			g_CaptureFilename = argv[++i];
+			g_CaptureFormat = FrameCapture::CAPTURE_PNG;
+		}
+		else if ((strcmp(argv[i], "--capture-y4m") == 0) && bHasValue)
+		{
+			g_CaptureFilename = argv[++i];
+			g_CaptureFormat = FrameCapture::CAPTURE_Y4M;
+		}
+		else if ((strcmp(argv[i], "--capture-fps") == 0) && bHasValue)
+		{
+			g_CaptureFramesPerSecond = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--dynamic-resolution") == 0)
+		{
+			g_bDynamicResolution = true;
+		}
+		else if ((strcmp(argv[i], "--target-fps") == 0) && bHasValue)
+		{
+			g_bDynamicResolution = true;
+			g_TargetFramesPerSecond = (float)atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--no-occlusion-culling") == 0)
+		{
+			g_bOcclusionCulling = false;
+		}
+		else if (strcmp(argv[i], "--no-instancing") == 0)
+		{
+			g_bInstancedDraws = false;
+		}
+		else if (strcmp(argv[i], "--gpu-culling") == 0)
+		{
+			g_bGpuCulling = true;
+		}
+		else if (strcmp(argv[i], "--gpu-occlusion") == 0)
+		{
+			g_bGpuCulling = true;
+			g_bGpuOcclusion = true;
+		}
+		else if (strcmp(argv[i], "--static-cache") == 0)
+		{
+			g_bStaticLayerCache = true;
+		}
+		else if ((strcmp(argv[i], "--model") == 0) && bHasValue)
+		{
+			g_ModelFilename = argv[++i];
+		}
+		else if ((strcmp(argv[i], "--model-scale") == 0) && bHasValue)
+		{
+			g_ModelScale = (float)atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--progressive-startup") == 0)
+		{
+			g_bProgressiveStartup = true;
+		}
+		else if (strcmp(argv[i], "--regression") == 0)
+		{
+			g_bRegression = true;
+		}
+		else if (strcmp(argv[i], "--regression-update") == 0)
+		{
+			g_bRegression = true;
+			g_bRegressionUpdate = true;
+		}
+		else if ((strcmp(argv[i], "--stress") == 0) && bHasValue)
+		{
+			// the grid of desks is given as columns x rows
+			if ((sscanf(argv[++i], "%dx%d", &g_StressColumns, &g_StressRows) != 2) ||
+				(g_StressColumns <= 0) || (g_StressRows <= 0))
+			{
+				std::cerr << "The stress scene size must be given as <columns>x<rows>" << std::endl;
+				return(false);
+			}
+		}
+		else if ((strcmp(argv[i], "--stress-seed") == 0) && bHasValue)
+		{
+			g_StressSeed = (unsigned int)strtoul(argv[++i], NULL, 10);
+		}
+		else if (strcmp(argv[i], "--stress-benchmark") == 0)
+		{
+			g_bStressBenchmark = true;
+		}
+		else if ((strcmp(argv[i], "--stress-max") == 0) && bHasValue)
+		{
+			g_bStressBenchmark = true;
+			g_StressMaxObjects = atoi(argv[++i]);
+		}
+		else if ((strcmp(argv[i], "--batch") == 0) && bHasValue)
+		{
+			g_BatchFilename = argv[++i];
+		}
+		else if ((strcmp(argv[i], "--batch-output") == 0) && bHasValue)
+		{
+			g_BatchDirectory = argv[++i];
+		}
+		else if ((strcmp(argv[i], "--metrics-port") == 0) && bHasValue)
+		{
+			g_MetricsPort = atoi(argv[++i]);
+			if ((g_MetricsPort <= 0) || (g_MetricsPort > 65535))
+			{
+				std::cerr << "The metrics port must be between 1 and 65535" << std::endl;
+				return(false);
+			}
+		}
+		else
+		{
+			std::cerr << "Unknown or incomplete option: " << argv[i] << std::endl;
+			return(false);
+		}
+	}
+
+	if ((NULL != g_RecordFilename) && (NULL != g_ReplayFilename))
+	{
+		std::cerr << "Input cannot be recorded and replayed at the same time" << std::endl;
+		return(false);
+	}
+
+	if ((g_bRegression == true) && ((NULL != g_RecordFilename) || (NULL != g_ReplayFilename)))
+	{
+		std::cerr << "The regression checks use fixed poses and cannot record or replay input" << std::endl;
+		return(false);
+	}
+
+	if ((g_bStressBenchmark == true) &&
+		((g_bRegression == true) || (NULL != g_RecordFilename) || (NULL != g_ReplayFilename)))
+	{
+		std::cerr << "The stress benchmark cannot run with the regression checks or recorded input" << std::endl;
+		return(false);
+	}
+
+	if ((NULL != g_BatchFilename) &&
+		((g_bRegression == true) || (g_bStressBenchmark == true) ||
+		(NULL != g_RecordFilename) || (NULL != g_ReplayFilename)))
+	{
+		std::cerr << "The batch views cannot be rendered with the other run modes or recorded input" << std::endl;
+		return(false);
+	}
+
+	// the other run modes compare or time frames that must show
+	// the finished assets
+	if ((g_bProgressiveStartup == true) &&
+		((g_bRegression == true) || (g_bStressBenchmark == true) || (NULL != g_BatchFilename)))
+	{
+		std::cerr << "Progressive startup cannot be used with the regression checks, stress benchmark or batch views" << std::endl;
+		return(false);
+	}
+
+	return(true);
 }
 
 /***********************************************************
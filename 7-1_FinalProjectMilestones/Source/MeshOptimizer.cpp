@@ -0,0 +1,369 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshoptimizer.cpp
+// ============
+// reorder the triangles and vertices of indexed meshes for the vertex
+// cache, overdraw and vertex fetch
+///////////////////////////////////////////////////////////////////////////////
+
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+
+// declaration of global variables
+namespace
+{
+	// size of the least recently used cache modelled while scoring
+	const int g_ScoreCacheSize = 32;
+	// weights of the vertex scores
+	const float g_LastTriangleScore = 0.75f;
+	const float g_CacheDecayPower = 1.5f;
+	const float g_ValenceBoostScale = 2.0f;
+	const float g_ValenceBoostPower = 0.5f;
+
+	// score a vertex by how recently it was used and how many of
+	// its triangles are still to be drawn
+	float ScoreVertex(int cachePosition, int remainingTriangles)
+	{
+		if (remainingTriangles == 0)
+		{
+			return(-1.0f);
+		}
+
+		float score = 0.0f;
+		if (cachePosition >= 0)
+		{
+			if (cachePosition < 3)
+			{
+				// the vertices of the last triangle get a fixed score,
+				// so that strips do not keep coming back on themselves
+				score = g_LastTriangleScore;
+			}
+			else
+			{
+				float scale = 1.0f / (g_ScoreCacheSize - 3);
+				score = std::pow(1.0f - (cachePosition - 3) * scale, g_CacheDecayPower);
+			}
+		}
+
+		// vertices with few triangles left are finished off first
+		score += g_ValenceBoostScale * std::pow((float)remainingTriangles, -g_ValenceBoostPower);
+		return(score);
+	}
+}
+
+/***********************************************************
+ *  AnalyzeVertexCache()
+ *
+ *  This function is used for counting the vertices that
+ *  miss a first-in first-out cache while drawing the list.
+ ***********************************************************/
+MeshOptimizer::CACHE_STATS MeshOptimizer::AnalyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount)
+{
+	// the time each vertex entered the cache, so a vertex is
+	// cached while fewer than the cache size entered after it
+	std::vector<size_t> entryTimes(vertexCount, 0);
+	size_t time = CACHE_SIZE + 1;
+	size_t misses = 0;
+	for (size_t i = 0; i < indices.size(); i++)
+	{
+		uint32_t vertex = indices[i];
+		if (time - entryTimes[vertex] > (size_t)CACHE_SIZE)
+		{
+			entryTimes[vertex] = time++;
+			misses++;
+		}
+	}
+
+	CACHE_STATS stats;
+	size_t triangles = indices.size() / 3;
+	stats.acmr = (triangles > 0) ? (float)misses / triangles : 0.0f;
+	stats.atvr = (vertexCount > 0) ? (float)misses / vertexCount : 0.0f;
+	return(stats);
+}
+
+/***********************************************************
+ *  OptimizeVertexCache()
+ *
+ *  This function is used for reordering the triangles so
+ *  that each one reuses as many cached vertices as possible.
+ *  The triangle with the best vertex scores is drawn next,
+ *  looking only at the triangles of the cached vertices, and
+ *  falling back to the next undrawn triangle in the list when
+ *  none of them are left.
+ ***********************************************************/
+void MeshOptimizer::OptimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount)
+{
+	size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	// triangles of each vertex, packed by vertex
+	std::vector<int> remaining(vertexCount, 0);
+	for (size_t i = 0; i < triangleCount * 3; i++)
+	{
+		remaining[indices[i]]++;
+	}
+	std::vector<size_t> firstTriangle(vertexCount + 1, 0);
+	for (size_t v = 0; v < vertexCount; v++)
+	{
+		firstTriangle[v + 1] = firstTriangle[v] + remaining[v];
+	}
+	std::vector<uint32_t> vertexTriangles(firstTriangle[vertexCount]);
+	std::vector<size_t> filled(firstTriangle.begin(), firstTriangle.end() - 1);
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		for (int corner = 0; corner < 3; corner++)
+		{
+			vertexTriangles[filled[indices[t * 3 + corner]]++] = (uint32_t)t;
+		}
+	}
+
+	std::vector<float> vertexScores(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++)
+	{
+		vertexScores[v] = ScoreVertex(-1, remaining[v]);
+	}
+	std::vector<float> triangleScores(triangleCount);
+	std::vector<bool> emitted(triangleCount, false);
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		triangleScores[t] =
+			vertexScores[indices[t * 3]] +
+			vertexScores[indices[t * 3 + 1]] +
+			vertexScores[indices[t * 3 + 2]];
+	}
+
+	// the cache grows by up to three vertices before it is trimmed
+	std::vector<uint32_t> cache;
+	std::vector<uint32_t> nextCache;
+	cache.reserve(g_ScoreCacheSize + 3);
+	nextCache.reserve(g_ScoreCacheSize + 3);
+
+	std::vector<uint32_t> optimized;
+	optimized.reserve(triangleCount * 3);
+	size_t scanPosition = 0;
+	int64_t bestTriangle = -1;
+
+	for (size_t drawn = 0; drawn < triangleCount; drawn++)
+	{
+		if (bestTriangle < 0)
+		{
+			while (emitted[scanPosition] == true)
+			{
+				scanPosition++;
+			}
+			bestTriangle = (int64_t)scanPosition;
+		}
+
+		size_t triangle = (size_t)bestTriangle;
+		emitted[triangle] = true;
+
+		// the triangle's vertices move to the front of the cache
+		nextCache.clear();
+		for (int corner = 0; corner < 3; corner++)
+		{
+			uint32_t vertex = indices[triangle * 3 + corner];
+			optimized.push_back(vertex);
+			nextCache.push_back(vertex);
+
+			// the triangle no longer counts for its vertices
+			remaining[vertex]--;
+			size_t first = firstTriangle[vertex];
+			size_t last = first + remaining[vertex];
+			for (size_t k = first; k <= last; k++)
+			{
+				if (vertexTriangles[k] == triangle)
+				{
+					std::swap(vertexTriangles[k], vertexTriangles[last]);
+					break;
+				}
+			}
+		}
+		for (size_t i = 0; i < cache.size(); i++)
+		{
+			uint32_t vertex = cache[i];
+			if ((vertex != nextCache[0]) && (vertex != nextCache[1]) && (vertex != nextCache[2]))
+			{
+				nextCache.push_back(vertex);
+			}
+		}
+		cache.swap(nextCache);
+
+		// rescore the cached vertices and the triangles touching them
+		for (size_t i = 0; i < cache.size(); i++)
+		{
+			uint32_t vertex = cache[i];
+			int position = (i < (size_t)g_ScoreCacheSize) ? (int)i : -1;
+			float score = ScoreVertex(position, remaining[vertex]);
+			float change = score - vertexScores[vertex];
+			vertexScores[vertex] = score;
+
+			size_t first = firstTriangle[vertex];
+			for (size_t k = first; k < first + remaining[vertex]; k++)
+			{
+				triangleScores[vertexTriangles[k]] += change;
+			}
+		}
+
+		// the best of those triangles is drawn next
+		bestTriangle = -1;
+		float bestScore = -1.0f;
+		for (size_t i = 0; i < cache.size(); i++)
+		{
+			uint32_t vertex = cache[i];
+			size_t first = firstTriangle[vertex];
+			for (size_t k = first; k < first + remaining[vertex]; k++)
+			{
+				uint32_t candidate = vertexTriangles[k];
+				if (triangleScores[candidate] > bestScore)
+				{
+					bestScore = triangleScores[candidate];
+					bestTriangle = candidate;
+				}
+			}
+		}
+		if (cache.size() > (size_t)g_ScoreCacheSize)
+		{
+			cache.resize(g_ScoreCacheSize);
+		}
+	}
+
+	indices.swap(optimized);
+}
+
+/***********************************************************
+ *  OptimizeOverdraw()
+ *
+ *  This function is used for ordering the triangles so that
+ *  those likely to be in front are drawn first.  The list is
+ *  split wherever a triangle misses the cache on all three
+ *  vertices, since moving the runs between those points
+ *  changes the cache misses the least, and the runs are
+ *  sorted by how far their surface faces out from the mesh
+ *  center.
+ ***********************************************************/
+void MeshOptimizer::OptimizeOverdraw(
+	std::vector<uint32_t>& indices,
+	const std::vector<glm::vec3>& positions,
+	float threshold)
+{
+	size_t triangleCount = indices.size() / 3;
+	if (triangleCount < 2)
+	{
+		return;
+	}
+
+	// find the runs with the same cache model as the analysis
+	std::vector<size_t> runStarts;
+	std::vector<size_t> entryTimes(positions.size(), 0);
+	size_t time = CACHE_SIZE + 1;
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		int misses = 0;
+		for (int corner = 0; corner < 3; corner++)
+		{
+			uint32_t vertex = indices[t * 3 + corner];
+			if (time - entryTimes[vertex] > (size_t)CACHE_SIZE)
+			{
+				entryTimes[vertex] = time++;
+				misses++;
+			}
+		}
+		if ((misses == 3) || (t == 0))
+		{
+			runStarts.push_back(t);
+		}
+	}
+	runStarts.push_back(triangleCount);
+
+	glm::vec3 meshCenter(0.0f);
+	for (size_t i = 0; i < indices.size(); i++)
+	{
+		meshCenter += positions[indices[i]];
+	}
+	meshCenter = meshCenter * (1.0f / indices.size());
+
+	// the area weighted center and normal of each run
+	size_t runCount = runStarts.size() - 1;
+	std::vector<float> runKeys(runCount);
+	for (size_t run = 0; run < runCount; run++)
+	{
+		glm::vec3 center(0.0f);
+		glm::vec3 normal(0.0f);
+		float area = 0.0f;
+		for (size_t t = runStarts[run]; t < runStarts[run + 1]; t++)
+		{
+			const glm::vec3& a = positions[indices[t * 3]];
+			const glm::vec3& b = positions[indices[t * 3 + 1]];
+			const glm::vec3& c = positions[indices[t * 3 + 2]];
+			glm::vec3 cross = glm::cross(b - a, c - a);
+			float triangleArea = glm::length(cross);
+			center += (a + b + c) * (triangleArea / 3.0f);
+			normal += cross;
+			area += triangleArea;
+		}
+		float normalLength = glm::length(normal);
+		if ((area > 0.0f) && (normalLength > 0.0f))
+		{
+			runKeys[run] = glm::dot(center / area - meshCenter, normal / normalLength);
+		}
+		else
+		{
+			runKeys[run] = 0.0f;
+		}
+	}
+
+	std::vector<uint32_t> runOrder(runCount);
+	for (size_t run = 0; run < runCount; run++)
+	{
+		runOrder[run] = (uint32_t)run;
+	}
+	std::stable_sort(runOrder.begin(), runOrder.end(),
+		[&runKeys](uint32_t first, uint32_t second) { return(runKeys[first] > runKeys[second]); });
+
+	std::vector<uint32_t> sorted;
+	sorted.reserve(indices.size());
+	for (size_t i = 0; i < runCount; i++)
+	{
+		uint32_t run = runOrder[i];
+		sorted.insert(sorted.end(),
+			indices.begin() + runStarts[run] * 3,
+			indices.begin() + runStarts[run + 1] * 3);
+	}
+
+	// a run can still reuse vertices left in the cache by the run
+	// before it, so the misses are checked again
+	CACHE_STATS before = AnalyzeVertexCache(indices, positions.size());
+	CACHE_STATS after = AnalyzeVertexCache(sorted, positions.size());
+	if (after.acmr <= before.acmr * threshold)
+	{
+		indices.swap(sorted);
+	}
+}
+
+/***********************************************************
+ *  OptimizeVertexFetch()
+ *
+ *  This function is used for numbering the vertices in the
+ *  order the triangles first use them, so that the vertex
+ *  fetch walks through the buffer.  Unused vertices are
+ *  dropped and marked with UINT32_MAX in the remap table.
+ ***********************************************************/
+size_t MeshOptimizer::OptimizeVertexFetch(std::vector<uint32_t>& indices, size_t vertexCount, std::vector<uint32_t>& remap)
+{
+	remap.assign(vertexCount, UINT32_MAX);
+	uint32_t nextVertex = 0;
+	for (size_t i = 0; i < indices.size(); i++)
+	{
+		uint32_t& vertex = indices[i];
+		if (remap[vertex] == UINT32_MAX)
+		{
+			remap[vertex] = nextVertex++;
+		}
+		vertex = remap[vertex];
+	}
+	return(nextVertex);
+}
@@ -0,0 +1,80 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshoptimizer.h
+// ============
+// reorder the triangles and vertices of indexed meshes for the vertex
+// cache, overdraw and vertex fetch
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  MeshOptimizer
+ *
+ *  These functions run in order on every generated or
+ *  imported triangle list.  The triangles are first reordered
+ *  so that recently transformed vertices are reused while
+ *  they are still in the post-transform cache, then groups
+ *  of those triangles are ordered so that the ones facing
+ *  outward are drawn first, and finally the vertices are
+ *  renumbered in the order they are first used so that they
+ *  are fetched from memory in sequence.
+ ***********************************************************/
+namespace MeshOptimizer
+{
+	// statistics of a simulated post-transform vertex cache
+	struct CACHE_STATS
+	{
+		// average vertices transformed per triangle, from 0.5
+		// at best to 3
+		float acmr;
+		// average transforms per vertex, 1 at best
+		float atvr;
+	};
+
+	// vertices held by the simulated first-in first-out cache,
+	// which is the size of the cache on most hardware
+	const int CACHE_SIZE = 16;
+
+	// measure the cache misses of the triangle list
+	CACHE_STATS AnalyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount);
+
+	// reorder the triangles for the vertex cache, scoring the
+	// candidates by cache position and remaining use as in
+	// Forsyth's linear-speed vertex cache optimization
+	void OptimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount);
+
+	// reorder the runs of triangles that start with a full cache
+	// miss, so the runs facing away from the mesh center come
+	// first and hide the ones behind them - the new order is only
+	// kept when the cache misses grow by less than the threshold
+	void OptimizeOverdraw(
+		std::vector<uint32_t>& indices,
+		const std::vector<glm::vec3>& positions,
+		float threshold = 1.05f);
+
+	// renumber the vertices in the order they are first used,
+	// filling remap with the new position of each old vertex and
+	// returning the number of vertices that are used
+	size_t OptimizeVertexFetch(std::vector<uint32_t>& indices, size_t vertexCount, std::vector<uint32_t>& remap);
+
+	// move the values of a vertex attribute to their new positions
+	template <typename T>
+	void RemapVertices(std::vector<T>& vertices, const std::vector<uint32_t>& remap, size_t usedCount)
+	{
+		std::vector<T> remapped(usedCount);
+		for (size_t i = 0; i < vertices.size(); i++)
+		{
+			if (remap[i] != UINT32_MAX)
+			{
+				remapped[remap[i]] = vertices[i];
+			}
+		}
+		vertices.swap(remapped);
+	}
+}
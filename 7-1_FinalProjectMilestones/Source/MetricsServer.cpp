@@ -0,0 +1,516 @@
+///////////////////////////////////////////////////////////////////////////////
+// metricsserver.cpp
+// ============
+// serve the frame and resource counters of the running scene in the
+// Prometheus text format over HTTP on localhost
+///////////////////////////////////////////////////////////////////////////////
+
+#include "MetricsServer.h"
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+
+// declaration of global variables
+namespace
+{
+	// upper bounds in seconds of the frame time histogram buckets,
+	// around the budgets of the common display refresh rates
+	const double g_FrameBucketBounds[] = { 0.004, 0.008, 0.012, 0.017, 0.025, 0.034, 0.05, 0.1 };
+	const int g_FrameBoundCount = (int)(sizeof(g_FrameBucketBounds) / sizeof(g_FrameBucketBounds[0]));
+
+	// a frame is skipped once it has taken this much longer than
+	// the budget, so it missed at least one display refresh
+	const float g_SkipFactor = 1.5f;
+	// frame rate judged against until the target is set
+	const float g_DefaultFramesPerSecond = 60.0f;
+
+	// how long the server waits for a connection before checking
+	// whether it was stopped, and for a client to send its request
+	const int g_AcceptWaitMilliseconds = 250;
+	const int g_RequestWaitMilliseconds = 1000;
+	// largest request header read, which is only the request line
+	// and a few headers for a scrape
+	const int g_MaxRequestBytes = 4096;
+
+	const intptr_t g_NoSocket = -1;
+
+	// close the socket of the platform
+	void CloseSocket(intptr_t socketHandle)
+	{
+#if defined(_WIN32)
+		closesocket((SOCKET)socketHandle);
+#else
+		close((int)socketHandle);
+#endif
+	}
+
+	// send all of the bytes, returning false when the client is gone
+	bool SendAll(intptr_t socketHandle, const char* pData, size_t bytes)
+	{
+		int flags = 0;
+#if defined(MSG_NOSIGNAL)
+		// a closed connection must not raise SIGPIPE and end the program
+		flags = MSG_NOSIGNAL;
+#endif
+		while (bytes > 0)
+		{
+#if defined(_WIN32)
+			int sent = send((SOCKET)socketHandle, pData, (int)bytes, flags);
+#else
+			ssize_t sent = send((int)socketHandle, pData, bytes, flags);
+#endif
+			if (sent <= 0)
+			{
+				return(false);
+			}
+			pData += sent;
+			bytes -= (size_t)sent;
+		}
+		return(true);
+	}
+
+	// append one metric with its help and type lines
+	void AppendMetric(std::string& text, const char* name, const char* type, const char* help, double value)
+	{
+		char line[256];
+		snprintf(line, sizeof(line), "# HELP %s %s\n# TYPE %s %s\n%s %.17g\n",
+			name, help, name, type, name, value);
+		text += line;
+	}
+}
+
+/***********************************************************
+ *  MetricsServer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+MetricsServer::MetricsServer()
+{
+	static_assert(g_FrameBoundCount + 1 == FRAME_BUCKET_COUNT,
+		"every frame bucket but the last needs an upper bound");
+
+	for (int i = 0; i < FRAME_BUCKET_COUNT; i++)
+	{
+		m_frameBuckets[i] = 0;
+	}
+	m_frameMicroseconds = 0;
+	m_skippedFrames = 0;
+	m_skipSeconds = g_SkipFactor / g_DefaultFramesPerSecond;
+	m_drawCalls = 0;
+	m_totalDrawCalls = 0;
+	m_textureCount = 0;
+	m_textureBytes = 0;
+	m_meshCount = 0;
+	m_captureDroppedFrames = 0;
+	m_cameraSpeed = 0.0f;
+	m_cameraSpeedChanges = 0;
+	m_firstFrameSeconds = 0.0f;
+	m_loadedSeconds = 0.0f;
+	m_listenSocket = g_NoSocket;
+	m_port = 0;
+	m_bRunning = false;
+}
+
+/***********************************************************
+ *  ~MetricsServer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+MetricsServer::~MetricsServer()
+{
+	Stop();
+}
+
+/***********************************************************
+ *  Start()
+ *
+ *  This method is used for opening the port on the loopback
+ *  address and starting the thread that answers the scrapes.
+ ***********************************************************/
+bool MetricsServer::Start(int port)
+{
+	Stop();
+	if ((port <= 0) || (port > 65535))
+	{
+		std::cerr << "The metrics port must be between 1 and 65535" << std::endl;
+		return(false);
+	}
+
+#if defined(_WIN32)
+	WSADATA wsaData;
+	if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0)
+	{
+		std::cerr << "Could not initialize the sockets for the metrics server" << std::endl;
+		return(false);
+	}
+	SOCKET listenSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	m_listenSocket = (INVALID_SOCKET == listenSocket) ? g_NoSocket : (intptr_t)listenSocket;
+#else
+	m_listenSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if (m_listenSocket != g_NoSocket)
+	{
+		// the port can be opened again straight after a restart
+		int reuse = 1;
+		setsockopt((int)m_listenSocket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+	}
+#endif
+
+	bool bListening = false;
+	if (m_listenSocket != g_NoSocket)
+	{
+		sockaddr_in address;
+		memset(&address, 0, sizeof(address));
+		address.sin_family = AF_INET;
+		address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		address.sin_port = htons((unsigned short)port);
+#if defined(_WIN32)
+		bListening = (bind((SOCKET)m_listenSocket, (const sockaddr*)&address, sizeof(address)) == 0) &&
+			(listen((SOCKET)m_listenSocket, SOMAXCONN) == 0);
+#else
+		bListening = (bind((int)m_listenSocket, (const sockaddr*)&address, sizeof(address)) == 0) &&
+			(listen((int)m_listenSocket, SOMAXCONN) == 0);
+#endif
+	}
+	if (bListening == false)
+	{
+		std::cerr << "Could not open port " << port << " for the metrics server" << std::endl;
+		if (m_listenSocket != g_NoSocket)
+		{
+			CloseSocket(m_listenSocket);
+			m_listenSocket = g_NoSocket;
+		}
+#if defined(_WIN32)
+		WSACleanup();
+#endif
+		return(false);
+	}
+
+	m_port = port;
+	m_bRunning = true;
+	m_serverThread = std::thread(&MetricsServer::Serve, this);
+	std::cout << "Serving metrics on http://127.0.0.1:" << port << "/metrics" << std::endl;
+	return(true);
+}
+
+/***********************************************************
+ *  Stop()
+ *
+ *  This method is used for stopping the server thread, which
+ *  notices within one accept wait, and closing the port.
+ ***********************************************************/
+void MetricsServer::Stop()
+{
+	if (m_serverThread.joinable() == false)
+	{
+		return;
+	}
+
+	m_bRunning = false;
+	m_serverThread.join();
+	CloseSocket(m_listenSocket);
+	m_listenSocket = g_NoSocket;
+	m_port = 0;
+#if defined(_WIN32)
+	WSACleanup();
+#endif
+}
+
+/***********************************************************
+ *  RecordFrame()
+ *
+ *  This method is used for counting a rendered frame in the
+ *  frame time histogram, called by the render loop with the
+ *  time from the start of the frame to the start of the next.
+ ***********************************************************/
+void MetricsServer::RecordFrame(double frameSeconds, int drawCalls)
+{
+	int bucket = 0;
+	while ((bucket < g_FrameBoundCount) && (frameSeconds > g_FrameBucketBounds[bucket]))
+	{
+		bucket++;
+	}
+	m_frameBuckets[bucket].fetch_add(1, std::memory_order_relaxed);
+	m_frameMicroseconds.fetch_add((uint64_t)(frameSeconds * 1000000.0), std::memory_order_relaxed);
+	if (frameSeconds > m_skipSeconds.load(std::memory_order_relaxed))
+	{
+		m_skippedFrames.fetch_add(1, std::memory_order_relaxed);
+	}
+	m_drawCalls.store(drawCalls, std::memory_order_relaxed);
+	m_totalDrawCalls.fetch_add((uint64_t)drawCalls, std::memory_order_relaxed);
+}
+
+/***********************************************************
+ *  SetResources()
+ *
+ *  This method is used for setting the textures and meshes
+ *  loaded by the scene, read on the render thread because
+ *  the resource tracker is not shared with other threads.
+ ***********************************************************/
+void MetricsServer::SetResources(int textureCount, size_t textureBytes, int meshCount)
+{
+	m_textureCount.store(textureCount, std::memory_order_relaxed);
+	m_textureBytes.store((uint64_t)textureBytes, std::memory_order_relaxed);
+	m_meshCount.store(meshCount, std::memory_order_relaxed);
+}
+
+/***********************************************************
+ *  SetCaptureDroppedFrames()
+ *
+ *  This method is used for setting the number of frames the
+ *  image sequence capture dropped since it began.
+ ***********************************************************/
+void MetricsServer::SetCaptureDroppedFrames(long long droppedFrames)
+{
+	m_captureDroppedFrames.store(droppedFrames, std::memory_order_relaxed);
+}
+
+/***********************************************************
+ *  SetCameraSpeed()
+ *
+ *  This method is used for setting the current camera speed.
+ ***********************************************************/
+void MetricsServer::SetCameraSpeed(float speed)
+{
+	m_cameraSpeed.store(speed, std::memory_order_relaxed);
+}
+
+/***********************************************************
+ *  RecordCameraSpeedChange()
+ *
+ *  This method is used for counting a change of the camera
+ *  speed, called from the mouse scroll callback.
+ ***********************************************************/
+void MetricsServer::RecordCameraSpeedChange(float speed)
+{
+	m_cameraSpeed.store(speed, std::memory_order_relaxed);
+	m_cameraSpeedChanges.fetch_add(1, std::memory_order_relaxed);
+}
+
+/***********************************************************
+ *  SetTargetFramesPerSecond()
+ *
+ *  This method is used for setting the frame rate whose
+ *  budget decides which frames count as skipped.
+ ***********************************************************/
+void MetricsServer::SetTargetFramesPerSecond(float framesPerSecond)
+{
+	if (framesPerSecond > 0.0f)
+	{
+		m_skipSeconds.store(g_SkipFactor / framesPerSecond, std::memory_order_relaxed);
+	}
+}
+
+/***********************************************************
+ *  SetStartupTimes()
+ *
+ *  This method is used for setting how long the startup took
+ *  until the first frame and until the assets loaded in the
+ *  background were all swapped in.
+ ***********************************************************/
+void MetricsServer::SetStartupTimes(float firstFrameSeconds, float loadedSeconds)
+{
+	m_firstFrameSeconds.store(firstFrameSeconds, std::memory_order_relaxed);
+	m_loadedSeconds.store(loadedSeconds, std::memory_order_relaxed);
+}
+
+/***********************************************************
+ *  Serve()
+ *
+ *  This method is used for answering one connection at a
+ *  time on the server thread.  The wait for a connection is
+ *  bounded so that a stop request is noticed.
+ ***********************************************************/
+void MetricsServer::Serve()
+{
+	while (m_bRunning.load() == true)
+	{
+		fd_set readSet;
+		FD_ZERO(&readSet);
+#if defined(_WIN32)
+		FD_SET((SOCKET)m_listenSocket, &readSet);
+#else
+		FD_SET((int)m_listenSocket, &readSet);
+#endif
+		timeval timeout;
+		timeout.tv_sec = 0;
+		timeout.tv_usec = g_AcceptWaitMilliseconds * 1000;
+		if (select((int)m_listenSocket + 1, &readSet, NULL, NULL, &timeout) <= 0)
+		{
+			continue;
+		}
+
+#if defined(_WIN32)
+		SOCKET acceptedSocket = accept((SOCKET)m_listenSocket, NULL, NULL);
+		intptr_t clientSocket = (INVALID_SOCKET == acceptedSocket) ? g_NoSocket : (intptr_t)acceptedSocket;
+#else
+		intptr_t clientSocket = accept((int)m_listenSocket, NULL, NULL);
+#endif
+		if (clientSocket == g_NoSocket)
+		{
+			continue;
+		}
+		AnswerRequest(clientSocket);
+		CloseSocket(clientSocket);
+	}
+}
+
+/***********************************************************
+ *  AnswerRequest()
+ *
+ *  This method is used for reading the request header and
+ *  answering a GET of the metrics, or of the root path, with
+ *  the current counters.
+ ***********************************************************/
+void MetricsServer::AnswerRequest(intptr_t clientSocket)
+{
+	// a client that never finishes its request is given up on
+#if defined(_WIN32)
+	DWORD receiveTimeout = g_RequestWaitMilliseconds;
+	setsockopt((SOCKET)clientSocket, SOL_SOCKET, SO_RCVTIMEO, (const char*)&receiveTimeout, sizeof(receiveTimeout));
+#else
+	timeval receiveTimeout;
+	receiveTimeout.tv_sec = g_RequestWaitMilliseconds / 1000;
+	receiveTimeout.tv_usec = (g_RequestWaitMilliseconds % 1000) * 1000;
+	setsockopt((int)clientSocket, SOL_SOCKET, SO_RCVTIMEO, &receiveTimeout, sizeof(receiveTimeout));
+#endif
+
+	char request[g_MaxRequestBytes + 1];
+	int requestBytes = 0;
+	while (requestBytes < g_MaxRequestBytes)
+	{
+#if defined(_WIN32)
+		int received = recv((SOCKET)clientSocket, request + requestBytes, g_MaxRequestBytes - requestBytes, 0);
+#else
+		int received = (int)recv((int)clientSocket, request + requestBytes, g_MaxRequestBytes - requestBytes, 0);
+#endif
+		if (received <= 0)
+		{
+			break;
+		}
+		requestBytes += received;
+		request[requestBytes] = '\0';
+		if (NULL != strstr(request, "\r\n\r\n"))
+		{
+			break;
+		}
+	}
+	request[requestBytes] = '\0';
+
+	std::string body;
+	const char* status = "200 OK";
+	if ((strncmp(request, "GET /metrics ", 13) == 0) ||
+		(strncmp(request, "GET /metrics?", 13) == 0) ||
+		(strncmp(request, "GET / ", 6) == 0))
+	{
+		FormatMetrics(body);
+	}
+	else if (strncmp(request, "GET ", 4) == 0)
+	{
+		status = "404 Not Found";
+		body = "Not found\n";
+	}
+	else
+	{
+		status = "405 Method Not Allowed";
+		body = "Only GET is supported\n";
+	}
+
+	char header[256];
+	int headerBytes = snprintf(header, sizeof(header),
+		"HTTP/1.1 %s\r\n"
+		"Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+		"Content-Length: %zu\r\n"
+		"Connection: close\r\n"
+		"\r\n",
+		status,
+		body.size());
+	if (SendAll(clientSocket, header, (size_t)headerBytes) == true)
+	{
+		SendAll(clientSocket, body.data(), body.size());
+	}
+}
+
+/***********************************************************
+ *  FormatMetrics()
+ *
+ *  This method is used for writing the counters as a scrape
+ *  of the Prometheus text format.  The buckets are read one
+ *  by one, so the frame count is their sum to keep the
+ *  histogram consistent while frames are being recorded.
+ ***********************************************************/
+void MetricsServer::FormatMetrics(std::string& text) const
+{
+	char line[256];
+
+	text += "# HELP scene_frame_time_seconds Time between the starts of consecutive frames.\n";
+	text += "# TYPE scene_frame_time_seconds histogram\n";
+	uint64_t frameCount = 0;
+	for (int i = 0; i < FRAME_BUCKET_COUNT; i++)
+	{
+		frameCount += m_frameBuckets[i].load(std::memory_order_relaxed);
+		if (i < g_FrameBoundCount)
+		{
+			snprintf(line, sizeof(line), "scene_frame_time_seconds_bucket{le=\"%g\"} %llu\n",
+				g_FrameBucketBounds[i], (unsigned long long)frameCount);
+		}
+		else
+		{
+			snprintf(line, sizeof(line), "scene_frame_time_seconds_bucket{le=\"+Inf\"} %llu\n",
+				(unsigned long long)frameCount);
+		}
+		text += line;
+	}
+	snprintf(line, sizeof(line), "scene_frame_time_seconds_sum %.6f\nscene_frame_time_seconds_count %llu\n",
+		m_frameMicroseconds.load(std::memory_order_relaxed) / 1000000.0,
+		(unsigned long long)frameCount);
+	text += line;
+
+	AppendMetric(text, "scene_frames_skipped_total", "counter",
+		"Frames that took longer than the budget of the target frame rate allows.",
+		(double)m_skippedFrames.load(std::memory_order_relaxed));
+	AppendMetric(text, "scene_capture_frames_dropped_total", "counter",
+		"Frames dropped by the image sequence capture.",
+		(double)m_captureDroppedFrames.load(std::memory_order_relaxed));
+	AppendMetric(text, "scene_draw_calls", "gauge",
+		"Draw calls submitted for the last frame.",
+		(double)m_drawCalls.load(std::memory_order_relaxed));
+	AppendMetric(text, "scene_draw_calls_total", "counter",
+		"Draw calls submitted since startup.",
+		(double)m_totalDrawCalls.load(std::memory_order_relaxed));
+	AppendMetric(text, "scene_textures", "gauge",
+		"Textures alive in video memory, including the render targets.",
+		(double)m_textureCount.load(std::memory_order_relaxed));
+	AppendMetric(text, "scene_texture_bytes", "gauge",
+		"Estimated video memory of the live textures.",
+		(double)m_textureBytes.load(std::memory_order_relaxed));
+	AppendMetric(text, "scene_meshes", "gauge",
+		"Meshes loaded for drawing, the basic shapes and the imported model.",
+		(double)m_meshCount.load(std::memory_order_relaxed));
+	AppendMetric(text, "scene_camera_speed", "gauge",
+		"Current movement speed of the camera.",
+		(double)m_cameraSpeed.load(std::memory_order_relaxed));
+	AppendMetric(text, "scene_camera_speed_changes_total", "counter",
+		"Changes of the camera speed made with the mouse wheel.",
+		(double)m_cameraSpeedChanges.load(std::memory_order_relaxed));
+	AppendMetric(text, "scene_startup_first_frame_seconds", "gauge",
+		"Seconds from startup until the first frame was shown, or 0 before it.",
+		(double)m_firstFrameSeconds.load(std::memory_order_relaxed));
+	AppendMetric(text, "scene_startup_loaded_seconds", "gauge",
+		"Seconds from startup until every asset was loaded, or 0 while loading.",
+		(double)m_loadedSeconds.load(std::memory_order_relaxed));
+}
@@ -0,0 +1,93 @@
+///////////////////////////////////////////////////////////////////////////////
+// metricsserver.h
+// ============
+// serve the frame and resource counters of the running scene in the
+// Prometheus text format over HTTP on localhost
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <thread>
+
+/***********************************************************
+ *  MetricsServer
+ *
+ *  This class keeps counters of the frame times, draw calls,
+ *  loaded textures and meshes, skipped frames, camera speed
+ *  changes and startup times, and answers scrapes of them on its own
+ *  thread.  The render loop only stores into atomic counters
+ *  and never takes a lock or waits for the server, so a slow
+ *  or stuck client cannot hold up a frame.  The server only
+ *  listens on the loopback address, so the counters are not
+ *  exposed to the network.
+ ***********************************************************/
+class MetricsServer
+{
+public:
+	// constructor
+	MetricsServer();
+	// destructor
+	~MetricsServer();
+
+	// start answering scrapes on the localhost port
+	bool Start(int port);
+	// stop the server thread and close the port
+	void Stop();
+
+	// count a rendered frame, which is skipped when it took longer
+	// than the budget of the target frame rate allows
+	void RecordFrame(double frameSeconds, int drawCalls);
+	// set the textures and meshes loaded by the scene
+	void SetResources(int textureCount, size_t textureBytes, int meshCount);
+	// set the frames dropped by the image sequence capture
+	void SetCaptureDroppedFrames(long long droppedFrames);
+	// set the camera speed without counting it as a change
+	void SetCameraSpeed(float speed);
+	// count a change of the camera speed made by the user
+	void RecordCameraSpeedChange(float speed);
+	// set the frame rate that the skipped frames are judged by
+	void SetTargetFramesPerSecond(float framesPerSecond);
+	// set the seconds from startup until the first frame was shown
+	// and until every asset was loaded, which are zero until then
+	void SetStartupTimes(float firstFrameSeconds, float loadedSeconds);
+
+	// get the port being served, or zero when stopped
+	int GetPort() const { return(m_port); }
+
+private:
+	// frames counted by each bucket of the frame time histogram,
+	// with the last bucket holding the frames slower than all bounds
+	static const int FRAME_BUCKET_COUNT = 9;
+
+	std::atomic<uint64_t> m_frameBuckets[FRAME_BUCKET_COUNT];
+	std::atomic<uint64_t> m_frameMicroseconds;
+	std::atomic<uint64_t> m_skippedFrames;
+	std::atomic<float> m_skipSeconds;
+	std::atomic<int> m_drawCalls;
+	std::atomic<uint64_t> m_totalDrawCalls;
+	std::atomic<int> m_textureCount;
+	std::atomic<uint64_t> m_textureBytes;
+	std::atomic<int> m_meshCount;
+	std::atomic<long long> m_captureDroppedFrames;
+	std::atomic<float> m_cameraSpeed;
+	std::atomic<uint64_t> m_cameraSpeedChanges;
+	std::atomic<float> m_firstFrameSeconds;
+	std::atomic<float> m_loadedSeconds;
+
+	// listening socket, which is -1 when closed
+	intptr_t m_listenSocket;
+	int m_port;
+	std::thread m_serverThread;
+	std::atomic<bool> m_bRunning;
+
+	// accept and answer connections until stopped
+	void Serve();
+	// answer the request read from the connected socket
+	void AnswerRequest(intptr_t clientSocket);
+	// write every counter in the Prometheus text format
+	void FormatMetrics(std::string& text) const;
+};
@@ -0,0 +1,1737 @@
+///////////////////////////////////////////////////////////////////////////////
+// modelimporter.cpp
+// ============
+// read the meshes and materials of Wavefront OBJ and binary glTF 2.0 files
+// on worker threads, straight from the memory-mapped file
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ModelImporter.h"
+
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <charconv>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// declaration of global variables
+namespace
+{
+	typedef ModelImporter::MODEL MODEL;
+	typedef ModelImporter::MODEL_MESH MODEL_MESH;
+	typedef ModelImporter::MODEL_MATERIAL MODEL_MATERIAL;
+	typedef CompactMeshes::MESH_VERTEX MESH_VERTEX;
+
+	// smallest piece of an OBJ file parsed by one task, so that
+	// small files are not split at all
+	const size_t g_MinimumChunkBytes = 1024 * 1024;
+	// pieces per thread, so that a piece full of faces does not
+	// leave the other threads waiting
+	const int g_ChunksPerThread = 4;
+
+	// marks an OBJ index that was not given
+	const int32_t g_MissingIndex = INT32_MIN;
+
+	// identifiers of the binary glTF container
+	const uint32_t g_GlbMagic = 0x46546C67;
+	const uint32_t g_GlbJsonChunk = 0x4E4F534A;
+	const uint32_t g_GlbBinChunk = 0x004E4942;
+	// glTF component types and primitive mode
+	const int g_ComponentByte = 5120;
+	const int g_ComponentUnsignedByte = 5121;
+	const int g_ComponentShort = 5122;
+	const int g_ComponentUnsignedShort = 5123;
+	const int g_ComponentUnsignedInt = 5125;
+	const int g_ComponentFloat = 5126;
+	const int g_ModeTriangles = 4;
+	// deepest nesting of JSON arrays and objects that is parsed
+	const int g_MaxJsonDepth = 64;
+
+	// current time for measuring the stages of an import
+	double GetMilliseconds()
+	{
+		return(std::chrono::duration<double, std::milli>(
+			std::chrono::steady_clock::now().time_since_epoch()).count());
+	}
+
+	// read-only view of a whole file, paged in by the operating
+	// system as it is touched instead of read up front
+	struct MAPPED_FILE
+	{
+		const unsigned char* pData;
+		size_t size;
+	};
+
+	bool MapFile(const char* filename, MAPPED_FILE& file)
+	{
+		file.pData = NULL;
+		file.size = 0;
+#if defined(_WIN32)
+		HANDLE hFile = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL,
+			OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+		if (hFile == INVALID_HANDLE_VALUE)
+		{
+			return(false);
+		}
+		LARGE_INTEGER fileSize;
+		if ((GetFileSizeEx(hFile, &fileSize) == 0) || (fileSize.QuadPart == 0))
+		{
+			CloseHandle(hFile);
+			return(false);
+		}
+		HANDLE hMapping = CreateFileMappingA(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+		CloseHandle(hFile);
+		if (NULL == hMapping)
+		{
+			return(false);
+		}
+		// the view keeps the file open after the handles are closed
+		void* pView = MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+		CloseHandle(hMapping);
+		if (NULL == pView)
+		{
+			return(false);
+		}
+		file.pData = (const unsigned char*)pView;
+		file.size = (size_t)fileSize.QuadPart;
+#else
+		int descriptor = open(filename, O_RDONLY);
+		if (descriptor < 0)
+		{
+			return(false);
+		}
+		struct stat status;
+		if ((fstat(descriptor, &status) != 0) || (status.st_size == 0))
+		{
+			close(descriptor);
+			return(false);
+		}
+		void* pView = mmap(NULL, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+		close(descriptor);
+		if (pView == MAP_FAILED)
+		{
+			return(false);
+		}
+		// every page is read, so the reading ahead can start now
+		madvise(pView, (size_t)status.st_size, MADV_WILLNEED);
+		file.pData = (const unsigned char*)pView;
+		file.size = (size_t)status.st_size;
+#endif
+		return(true);
+	}
+
+	void UnmapFile(MAPPED_FILE& file)
+	{
+		if (NULL == file.pData)
+		{
+			return;
+		}
+#if defined(_WIN32)
+		UnmapViewOfFile(file.pData);
+#else
+		munmap((void*)file.pData, file.size);
+#endif
+		file.pData = NULL;
+		file.size = 0;
+	}
+
+	// reorder the triangles and vertices of the mesh and measure
+	// its bounds, the same as is done for the basic shapes
+	void FinishMesh(MODEL_MESH& mesh)
+	{
+		CompactMeshes::MESH_DATA& data = mesh.data;
+		mesh.boundsMin = glm::vec3(0.0f);
+		mesh.boundsMax = glm::vec3(0.0f);
+		if (data.indices.empty() == true)
+		{
+			data.vertices.clear();
+			return;
+		}
+
+		std::vector<glm::vec3> positions(data.vertices.size());
+		for (size_t v = 0; v < data.vertices.size(); v++)
+		{
+			positions[v] = data.vertices[v].position;
+		}
+		MeshOptimizer::OptimizeVertexCache(data.indices, data.vertices.size());
+		MeshOptimizer::OptimizeOverdraw(data.indices, positions);
+		std::vector<uint32_t> remap;
+		size_t usedVertices = MeshOptimizer::OptimizeVertexFetch(data.indices, data.vertices.size(), remap);
+		MeshOptimizer::RemapVertices(data.vertices, remap, usedVertices);
+
+		mesh.boundsMin = data.vertices[0].position;
+		mesh.boundsMax = data.vertices[0].position;
+		for (size_t v = 1; v < data.vertices.size(); v++)
+		{
+			mesh.boundsMin = glm::min(mesh.boundsMin, data.vertices[v].position);
+			mesh.boundsMax = glm::max(mesh.boundsMax, data.vertices[v].position);
+		}
+	}
+
+	// fill in the normals of the flagged vertices from the area
+	// weighted normals of the triangles around them
+	void GenerateNormals(CompactMeshes::MESH_DATA& data, const std::vector<bool>& missingNormals)
+	{
+		for (size_t v = 0; v < data.vertices.size(); v++)
+		{
+			if (missingNormals[v] == true)
+			{
+				data.vertices[v].normal = glm::vec3(0.0f);
+			}
+		}
+		for (size_t i = 0; i + 2 < data.indices.size(); i += 3)
+		{
+			uint32_t corners[3] = { data.indices[i], data.indices[i + 1], data.indices[i + 2] };
+			glm::vec3 edge1 = data.vertices[corners[1]].position - data.vertices[corners[0]].position;
+			glm::vec3 edge2 = data.vertices[corners[2]].position - data.vertices[corners[0]].position;
+			glm::vec3 faceNormal = glm::cross(edge1, edge2);
+			for (int c = 0; c < 3; c++)
+			{
+				if (missingNormals[corners[c]] == true)
+				{
+					data.vertices[corners[c]].normal += faceNormal;
+				}
+			}
+		}
+		for (size_t v = 0; v < data.vertices.size(); v++)
+		{
+			if (missingNormals[v] == true)
+			{
+				float length = glm::length(data.vertices[v].normal);
+				data.vertices[v].normal = (length > 0.0f) ?
+					data.vertices[v].normal / length : glm::vec3(0.0f, 1.0f, 0.0f);
+			}
+		}
+	}
+
+	/*** text parsing ***/
+
+	const char* SkipSpaces(const char* p, const char* pEnd)
+	{
+		while ((p < pEnd) && ((*p == ' ') || (*p == '\t')))
+		{
+			p++;
+		}
+		return(p);
+	}
+
+	// the rest of the line without the surrounding spaces
+	std::string_view GetLineText(const char* p, const char* pEnd)
+	{
+		p = SkipSpaces(p, pEnd);
+		while ((pEnd > p) && ((pEnd[-1] == ' ') || (pEnd[-1] == '\t')))
+		{
+			pEnd--;
+		}
+		return(std::string_view(p, (size_t)(pEnd - p)));
+	}
+
+	// true when the line starts with the keyword followed by a space
+	bool MatchKeyword(const char* p, const char* pEnd, const char* keyword, size_t length)
+	{
+		return(((size_t)(pEnd - p) > length) &&
+			(memcmp(p, keyword, length) == 0) &&
+			((p[length] == ' ') || (p[length] == '\t')));
+	}
+
+	// read the number at the position, leaving the value as it was
+	// when there is none
+	const char* ParseFloat(const char* p, const char* pEnd, float& value)
+	{
+		p = SkipSpaces(p, pEnd);
+		if ((p < pEnd) && (*p == '+'))
+		{
+			p++;
+		}
+		std::from_chars_result result = std::from_chars(p, pEnd, value);
+		if (result.ec != std::errc())
+		{
+			return(p);
+		}
+		return(result.ptr);
+	}
+
+	/*** OBJ ***/
+
+	// position, texture coordinate and normal index of a face
+	// corner, where the relative indices count back from the end
+	// of the chunk and are only resolved once the chunks before
+	// it are counted
+	struct OBJ_CORNER
+	{
+		int32_t index[3];
+		uint32_t relativeMask;
+	};
+
+	// run of faces that share a group and material, which either
+	// were set in the chunk or carry on from the chunk before it
+	struct OBJ_SEGMENT
+	{
+		size_t firstCorner;
+		std::string_view object;
+		std::string_view material;
+		bool bObjectSet;
+		bool bMaterialSet;
+	};
+
+	// everything parsed from one piece of the file
+	struct OBJ_CHUNK
+	{
+		const char* pBegin;
+		const char* pEnd;
+		std::vector<glm::vec3> positions;
+		std::vector<glm::vec2> uvs;
+		std::vector<glm::vec3> normals;
+		std::vector<OBJ_CORNER> corners;
+		std::vector<OBJ_SEGMENT> segments;
+		std::vector<std::string_view> materialLibraries;
+		// attributes of the chunks before this one
+		size_t firstAttributes[3];
+	};
+
+	// corners of a mesh that lie in one chunk
+	struct CORNER_RANGE
+	{
+		const OBJ_CORNER* pFirst;
+		size_t count;
+	};
+
+	struct VERTEX_KEY
+	{
+		int32_t index[3];
+
+		bool operator==(const VERTEX_KEY& other) const
+		{
+			return((index[0] == other.index[0]) &&
+				(index[1] == other.index[1]) &&
+				(index[2] == other.index[2]));
+		}
+	};
+
+	struct VERTEX_KEY_HASH
+	{
+		size_t operator()(const VERTEX_KEY& key) const
+		{
+			uint64_t hash = (uint32_t)key.index[0];
+			hash = hash * 0x9E3779B97F4A7C15ULL + (uint32_t)key.index[1];
+			hash = hash * 0x9E3779B97F4A7C15ULL + (uint32_t)key.index[2];
+			return((size_t)(hash ^ (hash >> 29)));
+		}
+	};
+
+	// start a new run of faces when the group or material changes,
+	// reusing the current run when it has no faces yet
+	OBJ_SEGMENT& BeginSegment(OBJ_CHUNK& chunk)
+	{
+		OBJ_SEGMENT& current = chunk.segments.back();
+		if (current.firstCorner == chunk.corners.size())
+		{
+			return(current);
+		}
+		OBJ_SEGMENT segment = current;
+		segment.firstCorner = chunk.corners.size();
+		chunk.segments.push_back(segment);
+		return(chunk.segments.back());
+	}
+
+	// parse the corners of one face and split it into a fan of
+	// triangles
+	void ParseFace(const char* p, const char* pEnd, OBJ_CHUNK& chunk, std::vector<OBJ_CORNER>& polygon)
+	{
+		size_t counts[3] = { chunk.positions.size(), chunk.uvs.size(), chunk.normals.size() };
+
+		polygon.clear();
+		while (true)
+		{
+			p = SkipSpaces(p, pEnd);
+			if (p >= pEnd)
+			{
+				break;
+			}
+
+			OBJ_CORNER corner;
+			corner.relativeMask = 0;
+			for (int attribute = 0; attribute < 3; attribute++)
+			{
+				corner.index[attribute] = g_MissingIndex;
+			}
+			for (int attribute = 0; attribute < 3; attribute++)
+			{
+				int32_t value = 0;
+				std::from_chars_result result = std::from_chars(p, pEnd, value);
+				if (result.ec == std::errc())
+				{
+					p = result.ptr;
+					if (value > 0)
+					{
+						corner.index[attribute] = value - 1;
+					}
+					else if (value < 0)
+					{
+						corner.index[attribute] = (int32_t)counts[attribute] + value;
+						corner.relativeMask |= (1u << attribute);
+					}
+				}
+				if ((p >= pEnd) || (*p != '/'))
+				{
+					break;
+				}
+				p++;
+			}
+			// skip anything that is not part of an index
+			while ((p < pEnd) && (*p != ' ') && (*p != '\t'))
+			{
+				p++;
+			}
+			if (corner.index[0] != g_MissingIndex)
+			{
+				polygon.push_back(corner);
+			}
+		}
+
+		for (size_t i = 2; i < polygon.size(); i++)
+		{
+			chunk.corners.push_back(polygon[0]);
+			chunk.corners.push_back(polygon[i - 1]);
+			chunk.corners.push_back(polygon[i]);
+		}
+	}
+
+	// parse the lines of one piece of an OBJ file
+	void ParseObjChunk(OBJ_CHUNK& chunk)
+	{
+		OBJ_SEGMENT first;
+		first.firstCorner = 0;
+		first.bObjectSet = false;
+		first.bMaterialSet = false;
+		chunk.segments.push_back(first);
+
+		std::vector<OBJ_CORNER> polygon;
+		const char* p = chunk.pBegin;
+		while (p < chunk.pEnd)
+		{
+			const char* pLineEnd = (const char*)memchr(p, '\n', (size_t)(chunk.pEnd - p));
+			if (NULL == pLineEnd)
+			{
+				pLineEnd = chunk.pEnd;
+			}
+			const char* pNext = (pLineEnd < chunk.pEnd) ? pLineEnd + 1 : pLineEnd;
+			if ((pLineEnd > p) && (pLineEnd[-1] == '\r'))
+			{
+				pLineEnd--;
+			}
+
+			const char* pLine = SkipSpaces(p, pLineEnd);
+			if (MatchKeyword(pLine, pLineEnd, "v", 1) == true)
+			{
+				glm::vec3 position(0.0f);
+				const char* pValue = ParseFloat(pLine + 1, pLineEnd, position.x);
+				pValue = ParseFloat(pValue, pLineEnd, position.y);
+				ParseFloat(pValue, pLineEnd, position.z);
+				chunk.positions.push_back(position);
+			}
+			else if (MatchKeyword(pLine, pLineEnd, "vt", 2) == true)
+			{
+				glm::vec2 uv(0.0f);
+				const char* pValue = ParseFloat(pLine + 2, pLineEnd, uv.x);
+				ParseFloat(pValue, pLineEnd, uv.y);
+				chunk.uvs.push_back(uv);
+			}
+			else if (MatchKeyword(pLine, pLineEnd, "vn", 2) == true)
+			{
+				glm::vec3 normal(0.0f);
+				const char* pValue = ParseFloat(pLine + 2, pLineEnd, normal.x);
+				pValue = ParseFloat(pValue, pLineEnd, normal.y);
+				ParseFloat(pValue, pLineEnd, normal.z);
+				chunk.normals.push_back(normal);
+			}
+			else if (MatchKeyword(pLine, pLineEnd, "f", 1) == true)
+			{
+				ParseFace(pLine + 1, pLineEnd, chunk, polygon);
+			}
+			else if ((MatchKeyword(pLine, pLineEnd, "o", 1) == true) ||
+				(MatchKeyword(pLine, pLineEnd, "g", 1) == true))
+			{
+				OBJ_SEGMENT& segment = BeginSegment(chunk);
+				segment.object = GetLineText(pLine + 1, pLineEnd);
+				segment.bObjectSet = true;
+			}
+			else if (MatchKeyword(pLine, pLineEnd, "usemtl", 6) == true)
+			{
+				OBJ_SEGMENT& segment = BeginSegment(chunk);
+				segment.material = GetLineText(pLine + 6, pLineEnd);
+				segment.bMaterialSet = true;
+			}
+			else if (MatchKeyword(pLine, pLineEnd, "mtllib", 6) == true)
+			{
+				chunk.materialLibraries.push_back(GetLineText(pLine + 6, pLineEnd));
+			}
+
+			p = pNext;
+		}
+	}
+
+	// turn the relative indices of the chunk into absolute ones
+	// and mark the indices outside the file as missing
+	void ResolveObjChunk(OBJ_CHUNK& chunk, const size_t totals[3])
+	{
+		for (size_t i = 0; i < chunk.corners.size(); i++)
+		{
+			OBJ_CORNER& corner = chunk.corners[i];
+			for (int attribute = 0; attribute < 3; attribute++)
+			{
+				int64_t index = corner.index[attribute];
+				if (index == g_MissingIndex)
+				{
+					continue;
+				}
+				if ((corner.relativeMask & (1u << attribute)) != 0)
+				{
+					index += (int64_t)chunk.firstAttributes[attribute];
+				}
+				if ((index < 0) || (index >= (int64_t)totals[attribute]))
+				{
+					index = g_MissingIndex;
+				}
+				corner.index[attribute] = (int32_t)index;
+			}
+			corner.relativeMask = 0;
+		}
+	}
+
+	// build the indexed triangle list of one group and material,
+	// sharing the vertices whose three indices are the same
+	void BuildObjMesh(
+		const std::vector<CORNER_RANGE>& ranges,
+		const std::vector<glm::vec3>& positions,
+		const std::vector<glm::vec2>& uvs,
+		const std::vector<glm::vec3>& normals,
+		MODEL_MESH& mesh)
+	{
+		size_t cornerCount = 0;
+		for (size_t r = 0; r < ranges.size(); r++)
+		{
+			cornerCount += ranges[r].count;
+		}
+
+		CompactMeshes::MESH_DATA& data = mesh.data;
+		data.indices.reserve(cornerCount);
+		std::unordered_map<VERTEX_KEY, uint32_t, VERTEX_KEY_HASH> vertexIndices;
+		vertexIndices.reserve(cornerCount / 2);
+		std::vector<bool> missingNormals;
+		bool bAnyMissingNormal = false;
+
+		for (size_t r = 0; r < ranges.size(); r++)
+		{
+			const OBJ_CORNER* pCorners = ranges[r].pFirst;
+			for (size_t i = 0; i + 2 < ranges[r].count; i += 3)
+			{
+				// a triangle with a position outside the file is dropped
+				if ((pCorners[i].index[0] == g_MissingIndex) ||
+					(pCorners[i + 1].index[0] == g_MissingIndex) ||
+					(pCorners[i + 2].index[0] == g_MissingIndex))
+				{
+					continue;
+				}
+
+				for (int c = 0; c < 3; c++)
+				{
+					const OBJ_CORNER& corner = pCorners[i + c];
+					VERTEX_KEY key = { { corner.index[0], corner.index[1], corner.index[2] } };
+					std::pair<std::unordered_map<VERTEX_KEY, uint32_t, VERTEX_KEY_HASH>::iterator, bool> inserted =
+						vertexIndices.insert(std::make_pair(key, (uint32_t)data.vertices.size()));
+					if (inserted.second == true)
+					{
+						MESH_VERTEX vertex;
+						vertex.position = positions[corner.index[0]];
+						vertex.uv = (corner.index[1] != g_MissingIndex) ? uvs[corner.index[1]] : glm::vec2(0.0f);
+						vertex.normal = (corner.index[2] != g_MissingIndex) ? normals[corner.index[2]] : glm::vec3(0.0f);
+						data.vertices.push_back(vertex);
+						missingNormals.push_back(corner.index[2] == g_MissingIndex);
+						bAnyMissingNormal |= (corner.index[2] == g_MissingIndex);
+					}
+					data.indices.push_back(inserted.first->second);
+				}
+			}
+		}
+
+		if (bAnyMissingNormal == true)
+		{
+			GenerateNormals(data, missingNormals);
+		}
+		FinishMesh(mesh);
+	}
+
+	// read the materials of an MTL file, which is small enough to
+	// be parsed on one thread
+	void ParseMtlFile(const std::string& filename, std::vector<MODEL_MATERIAL>& materials)
+	{
+		MAPPED_FILE file;
+		if (MapFile(filename.c_str(), file) == false)
+		{
+			printf("Could not open the material library %s\n", filename.c_str());
+			return;
+		}
+
+		const char* p = (const char*)file.pData;
+		const char* pEnd = p + file.size;
+		MODEL_MATERIAL* pMaterial = NULL;
+		while (p < pEnd)
+		{
+			const char* pLineEnd = (const char*)memchr(p, '\n', (size_t)(pEnd - p));
+			if (NULL == pLineEnd)
+			{
+				pLineEnd = pEnd;
+			}
+			const char* pNext = (pLineEnd < pEnd) ? pLineEnd + 1 : pLineEnd;
+			if ((pLineEnd > p) && (pLineEnd[-1] == '\r'))
+			{
+				pLineEnd--;
+			}
+
+			const char* pLine = SkipSpaces(p, pLineEnd);
+			if (MatchKeyword(pLine, pLineEnd, "newmtl", 6) == true)
+			{
+				// the defaults of the MTL format
+				MODEL_MATERIAL material;
+				material.name = std::string(GetLineText(pLine + 6, pLineEnd));
+				material.ambientColor = glm::vec3(0.2f);
+				material.diffuseColor = glm::vec3(0.8f);
+				material.specularColor = glm::vec3(0.0f);
+				material.shininess = 1.0f;
+				material.opacity = 1.0f;
+				materials.push_back(material);
+				pMaterial = &materials.back();
+			}
+			else if (NULL != pMaterial)
+			{
+				glm::vec3* pColor = NULL;
+				if (MatchKeyword(pLine, pLineEnd, "Ka", 2) == true)
+				{
+					pColor = &pMaterial->ambientColor;
+				}
+				else if (MatchKeyword(pLine, pLineEnd, "Kd", 2) == true)
+				{
+					pColor = &pMaterial->diffuseColor;
+				}
+				else if (MatchKeyword(pLine, pLineEnd, "Ks", 2) == true)
+				{
+					pColor = &pMaterial->specularColor;
+				}
+				else if (MatchKeyword(pLine, pLineEnd, "Ns", 2) == true)
+				{
+					ParseFloat(pLine + 2, pLineEnd, pMaterial->shininess);
+				}
+				else if (MatchKeyword(pLine, pLineEnd, "d", 1) == true)
+				{
+					ParseFloat(pLine + 1, pLineEnd, pMaterial->opacity);
+				}
+				else if (MatchKeyword(pLine, pLineEnd, "Tr", 2) == true)
+				{
+					float transparency = 0.0f;
+					ParseFloat(pLine + 2, pLineEnd, transparency);
+					pMaterial->opacity = 1.0f - transparency;
+				}
+
+				if (NULL != pColor)
+				{
+					// a single value is a gray
+					const char* pValue = ParseFloat(pLine + 2, pLineEnd, pColor->r);
+					pColor->g = pColor->r;
+					pColor->b = pColor->r;
+					pValue = ParseFloat(pValue, pLineEnd, pColor->g);
+					ParseFloat(pValue, pLineEnd, pColor->b);
+				}
+			}
+
+			p = pNext;
+		}
+		UnmapFile(file);
+	}
+
+	/*** JSON ***/
+
+	enum JSON_TYPE
+	{
+		JSON_NULL,
+		JSON_BOOLEAN,
+		JSON_NUMBER,
+		JSON_STRING,
+		JSON_ARRAY,
+		JSON_OBJECT
+	};
+
+	// parsed value, with the strings left in place in the file and
+	// their escapes untouched, which the names never need
+	struct JSON_VALUE
+	{
+		JSON_TYPE type;
+		double number;
+		std::string_view text;
+		// values of an array or object, by their position in the
+		// document, with the keys of the object members
+		std::vector<int> children;
+		std::vector<std::string_view> keys;
+	};
+
+	struct JSON_DOCUMENT
+	{
+		std::vector<JSON_VALUE> values;
+	};
+
+	const char* SkipJsonSpaces(const char* p, const char* pEnd)
+	{
+		while ((p < pEnd) && ((*p == ' ') || (*p == '\t') || (*p == '\n') || (*p == '\r')))
+		{
+			p++;
+		}
+		return(p);
+	}
+
+	// read a string that starts at the opening quote, leaving the
+	// view between the quotes
+	bool ParseJsonString(const char*& p, const char* pEnd, std::string_view& text)
+	{
+		const char* pStart = ++p;
+		while ((p < pEnd) && (*p != '"'))
+		{
+			p += (*p == '\\') ? 2 : 1;
+		}
+		if (p >= pEnd)
+		{
+			return(false);
+		}
+		text = std::string_view(pStart, (size_t)(p - pStart));
+		p++;
+		return(true);
+	}
+
+	// parse the value at the position, returning its index in the
+	// document or -1 when the text is not valid JSON
+	int ParseJsonValue(JSON_DOCUMENT& document, const char*& p, const char* pEnd, int depth)
+	{
+		p = SkipJsonSpaces(p, pEnd);
+		if ((p >= pEnd) || (depth > g_MaxJsonDepth))
+		{
+			return(-1);
+		}
+
+		int index = (int)document.values.size();
+		document.values.push_back(JSON_VALUE());
+		JSON_VALUE value;
+		value.type = JSON_NULL;
+		value.number = 0.0;
+
+		if ((*p == '{') || (*p == '['))
+		{
+			bool bObject = (*p == '{');
+			char closing = bObject ? '}' : ']';
+			value.type = bObject ? JSON_OBJECT : JSON_ARRAY;
+			p = SkipJsonSpaces(p + 1, pEnd);
+			if ((p < pEnd) && (*p == closing))
+			{
+				p++;
+			}
+			else
+			{
+				while (true)
+				{
+					if (bObject == true)
+					{
+						std::string_view key;
+						p = SkipJsonSpaces(p, pEnd);
+						if ((p >= pEnd) || (*p != '"') || (ParseJsonString(p, pEnd, key) == false))
+						{
+							return(-1);
+						}
+						p = SkipJsonSpaces(p, pEnd);
+						if ((p >= pEnd) || (*p != ':'))
+						{
+							return(-1);
+						}
+						p++;
+						value.keys.push_back(key);
+					}
+					int child = ParseJsonValue(document, p, pEnd, depth + 1);
+					if (child < 0)
+					{
+						return(-1);
+					}
+					value.children.push_back(child);
+
+					p = SkipJsonSpaces(p, pEnd);
+					if ((p < pEnd) && (*p == ','))
+					{
+						p++;
+						continue;
+					}
+					if ((p < pEnd) && (*p == closing))
+					{
+						p++;
+						break;
+					}
+					return(-1);
+				}
+			}
+		}
+		else if (*p == '"')
+		{
+			value.type = JSON_STRING;
+			if (ParseJsonString(p, pEnd, value.text) == false)
+			{
+				return(-1);
+			}
+		}
+		else if (((size_t)(pEnd - p) >= 4) && (memcmp(p, "true", 4) == 0))
+		{
+			value.type = JSON_BOOLEAN;
+			value.number = 1.0;
+			p += 4;
+		}
+		else if (((size_t)(pEnd - p) >= 5) && (memcmp(p, "false", 5) == 0))
+		{
+			value.type = JSON_BOOLEAN;
+			p += 5;
+		}
+		else if (((size_t)(pEnd - p) >= 4) && (memcmp(p, "null", 4) == 0))
+		{
+			p += 4;
+		}
+		else
+		{
+			value.type = JSON_NUMBER;
+			std::from_chars_result result = std::from_chars(p, pEnd, value.number);
+			if (result.ec != std::errc())
+			{
+				return(-1);
+			}
+			p = result.ptr;
+		}
+
+		// the children were added after the placeholder, which may
+		// have moved, so the value is only stored now
+		document.values[index] = std::move(value);
+		return(index);
+	}
+
+	// get the member of the object, or NULL
+	const JSON_VALUE* FindMember(const JSON_DOCUMENT& document, const JSON_VALUE* pObject, const char* key)
+	{
+		if ((NULL == pObject) || (pObject->type != JSON_OBJECT))
+		{
+			return(NULL);
+		}
+		for (size_t i = 0; i < pObject->keys.size(); i++)
+		{
+			if (pObject->keys[i] == key)
+			{
+				return(&document.values[pObject->children[i]]);
+			}
+		}
+		return(NULL);
+	}
+
+	// get the element of the array, or NULL
+	const JSON_VALUE* GetElement(const JSON_DOCUMENT& document, const JSON_VALUE* pArray, int element)
+	{
+		if ((NULL == pArray) || (pArray->type != JSON_ARRAY) ||
+			(element < 0) || (element >= (int)pArray->children.size()))
+		{
+			return(NULL);
+		}
+		return(&document.values[pArray->children[element]]);
+	}
+
+	double GetNumber(const JSON_DOCUMENT& document, const JSON_VALUE* pObject, const char* key, double defaultValue)
+	{
+		const JSON_VALUE* pValue = FindMember(document, pObject, key);
+		if ((NULL == pValue) || ((pValue->type != JSON_NUMBER) && (pValue->type != JSON_BOOLEAN)))
+		{
+			return(defaultValue);
+		}
+		return(pValue->number);
+	}
+
+	int GetInteger(const JSON_DOCUMENT& document, const JSON_VALUE* pObject, const char* key, int defaultValue)
+	{
+		return((int)GetNumber(document, pObject, key, defaultValue));
+	}
+
+	// read the numbers of an array member into the values, leaving
+	// the values that are not given as they were
+	void GetNumbers(const JSON_DOCUMENT& document, const JSON_VALUE* pObject, const char* key, float* pValues, int count)
+	{
+		const JSON_VALUE* pArray = FindMember(document, pObject, key);
+		for (int i = 0; i < count; i++)
+		{
+			const JSON_VALUE* pValue = GetElement(document, pArray, i);
+			if ((NULL != pValue) && (pValue->type == JSON_NUMBER))
+			{
+				pValues[i] = (float)pValue->number;
+			}
+		}
+	}
+
+	/*** glTF ***/
+
+	// the parsed JSON chunk and the binary chunk it points into
+	struct GLB_CONTEXT
+	{
+		JSON_DOCUMENT document;
+		const JSON_VALUE* pRoot;
+		const unsigned char* pBinary;
+		size_t binarySize;
+	};
+
+	// values of an accessor, checked to lie inside the binary chunk
+	struct ACCESSOR_DATA
+	{
+		const unsigned char* pData;
+		size_t count;
+		size_t stride;
+		int componentType;
+		int components;
+		bool bNormalized;
+	};
+
+	int GetComponentSize(int componentType)
+	{
+		switch (componentType)
+		{
+		case g_ComponentByte:
+		case g_ComponentUnsignedByte:
+			return(1);
+		case g_ComponentShort:
+		case g_ComponentUnsignedShort:
+			return(2);
+		case g_ComponentUnsignedInt:
+		case g_ComponentFloat:
+			return(4);
+		default:
+			return(0);
+		}
+	}
+
+	int GetComponentCount(std::string_view type)
+	{
+		if (type == "SCALAR") return(1);
+		if (type == "VEC2") return(2);
+		if (type == "VEC3") return(3);
+		if (type == "VEC4") return(4);
+		if (type == "MAT4") return(16);
+		return(0);
+	}
+
+	// find the values of the accessor, which must be stored in the
+	// binary chunk, as sparse accessors and external buffers are
+	// not supported
+	bool GetAccessor(const GLB_CONTEXT& context, int accessor, ACCESSOR_DATA& data)
+	{
+		const JSON_DOCUMENT& document = context.document;
+		const JSON_VALUE* pAccessor = GetElement(document, FindMember(document, context.pRoot, "accessors"), accessor);
+		if ((NULL == pAccessor) || (NULL != FindMember(document, pAccessor, "sparse")))
+		{
+			return(false);
+		}
+		const JSON_VALUE* pType = FindMember(document, pAccessor, "type");
+		int view = GetInteger(document, pAccessor, "bufferView", -1);
+		const JSON_VALUE* pView = GetElement(document, FindMember(document, context.pRoot, "bufferViews"), view);
+		if ((NULL == pType) || (NULL == pView) || (GetInteger(document, pView, "buffer", 0) != 0))
+		{
+			return(false);
+		}
+
+		data.componentType = GetInteger(document, pAccessor, "componentType", 0);
+		data.components = GetComponentCount(pType->text);
+		data.bNormalized = (GetNumber(document, pAccessor, "normalized", 0.0) != 0.0);
+		data.count = (size_t)GetNumber(document, pAccessor, "count", 0.0);
+		size_t elementSize = (size_t)GetComponentSize(data.componentType) * data.components;
+		data.stride = (size_t)GetNumber(document, pView, "byteStride", 0.0);
+		if (data.stride == 0)
+		{
+			data.stride = elementSize;
+		}
+
+		size_t viewOffset = (size_t)GetNumber(document, pView, "byteOffset", 0.0);
+		size_t viewLength = (size_t)GetNumber(document, pView, "byteLength", 0.0);
+		size_t accessorOffset = (size_t)GetNumber(document, pAccessor, "byteOffset", 0.0);
+		if ((elementSize == 0) || (data.count == 0) ||
+			(viewOffset > context.binarySize) || (viewLength > context.binarySize - viewOffset) ||
+			(accessorOffset > viewLength) || (elementSize > viewLength - accessorOffset) ||
+			(data.count - 1 > (viewLength - accessorOffset - elementSize) / data.stride))
+		{
+			return(false);
+		}
+		data.pData = context.pBinary + viewOffset + accessorOffset;
+		return(true);
+	}
+
+	// read one component as a float, scaling the normalized
+	// integers to the range of the type
+	float ReadComponent(const unsigned char* p, int componentType, bool bNormalized)
+	{
+		switch (componentType)
+		{
+		case g_ComponentFloat:
+		{
+			float value;
+			memcpy(&value, p, sizeof(value));
+			return(value);
+		}
+		case g_ComponentUnsignedByte:
+			return(bNormalized ? p[0] / 255.0f : (float)p[0]);
+		case g_ComponentByte:
+			return(bNormalized ? std::max((int8_t)p[0] / 127.0f, -1.0f) : (float)(int8_t)p[0]);
+		case g_ComponentUnsignedShort:
+		{
+			uint16_t value;
+			memcpy(&value, p, sizeof(value));
+			return(bNormalized ? value / 65535.0f : (float)value);
+		}
+		case g_ComponentShort:
+		{
+			int16_t value;
+			memcpy(&value, p, sizeof(value));
+			return(bNormalized ? std::max(value / 32767.0f, -1.0f) : (float)value);
+		}
+		case g_ComponentUnsignedInt:
+		{
+			uint32_t value;
+			memcpy(&value, p, sizeof(value));
+			return((float)value);
+		}
+		default:
+			return(0.0f);
+		}
+	}
+
+	uint32_t ReadIndex(const unsigned char* p, int componentType)
+	{
+		if (componentType == g_ComponentUnsignedByte)
+		{
+			return(p[0]);
+		}
+		if (componentType == g_ComponentUnsignedShort)
+		{
+			uint16_t value;
+			memcpy(&value, p, sizeof(value));
+			return(value);
+		}
+		uint32_t value;
+		memcpy(&value, p, sizeof(value));
+		return(value);
+	}
+
+	// decode the vertices and indices of a triangle primitive,
+	// returning false when it cannot be read
+	bool DecodePrimitive(const GLB_CONTEXT& context, const JSON_VALUE* pPrimitive, MODEL_MESH& mesh)
+	{
+		const JSON_DOCUMENT& document = context.document;
+		if (GetInteger(document, pPrimitive, "mode", g_ModeTriangles) != g_ModeTriangles)
+		{
+			return(false);
+		}
+		const JSON_VALUE* pAttributes = FindMember(document, pPrimitive, "attributes");
+
+		ACCESSOR_DATA positions;
+		if ((GetAccessor(context, GetInteger(document, pAttributes, "POSITION", -1), positions) == false) ||
+			(positions.components != 3))
+		{
+			return(false);
+		}
+		ACCESSOR_DATA normals;
+		bool bNormals = (GetAccessor(context, GetInteger(document, pAttributes, "NORMAL", -1), normals) == true) &&
+			(normals.components == 3) && (normals.count == positions.count);
+		ACCESSOR_DATA uvs;
+		bool bUVs = (GetAccessor(context, GetInteger(document, pAttributes, "TEXCOORD_0", -1), uvs) == true) &&
+			(uvs.components == 2) && (uvs.count == positions.count);
+
+		int positionSize = GetComponentSize(positions.componentType);
+		int normalSize = bNormals ? GetComponentSize(normals.componentType) : 0;
+		int uvSize = bUVs ? GetComponentSize(uvs.componentType) : 0;
+		CompactMeshes::MESH_DATA& data = mesh.data;
+		data.vertices.resize(positions.count);
+		for (size_t v = 0; v < positions.count; v++)
+		{
+			MESH_VERTEX& vertex = data.vertices[v];
+			const unsigned char* pPosition = positions.pData + v * positions.stride;
+			for (int c = 0; c < 3; c++)
+			{
+				vertex.position[c] = ReadComponent(pPosition + c * positionSize, positions.componentType, positions.bNormalized);
+			}
+			vertex.normal = glm::vec3(0.0f);
+			if (bNormals == true)
+			{
+				const unsigned char* pNormal = normals.pData + v * normals.stride;
+				for (int c = 0; c < 3; c++)
+				{
+					vertex.normal[c] = ReadComponent(pNormal + c * normalSize, normals.componentType, normals.bNormalized);
+				}
+			}
+			vertex.uv = glm::vec2(0.0f);
+			if (bUVs == true)
+			{
+				const unsigned char* pUV = uvs.pData + v * uvs.stride;
+				vertex.uv.x = ReadComponent(pUV, uvs.componentType, uvs.bNormalized);
+				vertex.uv.y = ReadComponent(pUV + uvSize, uvs.componentType, uvs.bNormalized);
+			}
+		}
+
+		// a primitive without indices draws its vertices in order
+		int indexAccessor = GetInteger(document, pPrimitive, "indices", -1);
+		if (indexAccessor >= 0)
+		{
+			ACCESSOR_DATA indices;
+			if ((GetAccessor(context, indexAccessor, indices) == false) || (indices.components != 1) ||
+				((indices.componentType != g_ComponentUnsignedByte) &&
+				(indices.componentType != g_ComponentUnsignedShort) &&
+				(indices.componentType != g_ComponentUnsignedInt)))
+			{
+				return(false);
+			}
+			data.indices.reserve(indices.count - indices.count % 3);
+			for (size_t i = 0; i + 2 < indices.count; i += 3)
+			{
+				uint32_t corners[3];
+				for (int c = 0; c < 3; c++)
+				{
+					corners[c] = ReadIndex(indices.pData + (i + c) * indices.stride, indices.componentType);
+				}
+				if ((corners[0] < positions.count) && (corners[1] < positions.count) && (corners[2] < positions.count))
+				{
+					data.indices.push_back(corners[0]);
+					data.indices.push_back(corners[1]);
+					data.indices.push_back(corners[2]);
+				}
+			}
+		}
+		else
+		{
+			data.indices.resize(positions.count - positions.count % 3);
+			for (size_t i = 0; i < data.indices.size(); i++)
+			{
+				data.indices[i] = (uint32_t)i;
+			}
+		}
+
+		if (bNormals == false)
+		{
+			GenerateNormals(data, std::vector<bool>(data.vertices.size(), true));
+		}
+		FinishMesh(mesh);
+		return(true);
+	}
+
+	// local transformation of a node, from its matrix or from its
+	// translation, rotation quaternion and scale
+	glm::mat4 GetNodeTransform(const JSON_DOCUMENT& document, const JSON_VALUE* pNode)
+	{
+		glm::mat4 transform(1.0f);
+		if (NULL != FindMember(document, pNode, "matrix"))
+		{
+			float values[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+			GetNumbers(document, pNode, "matrix", values, 16);
+			for (int column = 0; column < 4; column++)
+			{
+				for (int row = 0; row < 4; row++)
+				{
+					transform[column][row] = values[column * 4 + row];
+				}
+			}
+			return(transform);
+		}
+
+		float translation[3] = { 0.0f, 0.0f, 0.0f };
+		float rotation[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+		float scale[3] = { 1.0f, 1.0f, 1.0f };
+		GetNumbers(document, pNode, "translation", translation, 3);
+		GetNumbers(document, pNode, "rotation", rotation, 4);
+		GetNumbers(document, pNode, "scale", scale, 3);
+
+		float x = rotation[0];
+		float y = rotation[1];
+		float z = rotation[2];
+		float w = rotation[3];
+		transform[0] = glm::vec4(1.0f - 2.0f * (y * y + z * z), 2.0f * (x * y + z * w), 2.0f * (x * z - y * w), 0.0f) * scale[0];
+		transform[1] = glm::vec4(2.0f * (x * y - z * w), 1.0f - 2.0f * (x * x + z * z), 2.0f * (y * z + x * w), 0.0f) * scale[1];
+		transform[2] = glm::vec4(2.0f * (x * z + y * w), 2.0f * (y * z - x * w), 1.0f - 2.0f * (x * x + y * y), 0.0f) * scale[2];
+		transform[3] = glm::vec4(translation[0], translation[1], translation[2], 1.0f);
+		return(transform);
+	}
+
+	// turn a metallic-roughness material into the terms of the
+	// Blinn-Phong shading of the scene
+	MODEL_MATERIAL ConvertGltfMaterial(const JSON_DOCUMENT& document, const JSON_VALUE* pMaterial)
+	{
+		const JSON_VALUE* pPbr = FindMember(document, pMaterial, "pbrMetallicRoughness");
+		float baseColor[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+		GetNumbers(document, pPbr, "baseColorFactor", baseColor, 4);
+		float metallic = (float)GetNumber(document, pPbr, "metallicFactor", 1.0);
+		float roughness = (float)GetNumber(document, pPbr, "roughnessFactor", 1.0);
+		glm::vec3 base(baseColor[0], baseColor[1], baseColor[2]);
+
+		MODEL_MATERIAL material;
+		const JSON_VALUE* pName = FindMember(document, pMaterial, "name");
+		material.name = (NULL != pName) ? std::string(pName->text) : std::string();
+		material.ambientColor = glm::vec3(0.2f);
+		// metals have no diffuse reflection and a highlight tinted
+		// with their color, other surfaces a dim white highlight
+		material.diffuseColor = base * (1.0f - metallic * 0.75f);
+		material.specularColor = glm::mix(glm::vec3(0.04f), base, metallic) * (1.0f - roughness * 0.5f);
+		// the exponent whose highlight is as wide as the GGX lobe
+		float alpha = std::max(roughness * roughness, 0.01f);
+		material.shininess = std::min(std::max(2.0f / (alpha * alpha) - 2.0f, 1.0f), 256.0f);
+		material.opacity = 1.0f;
+		const JSON_VALUE* pAlphaMode = FindMember(document, pMaterial, "alphaMode");
+		if ((NULL != pAlphaMode) && (pAlphaMode->text == "BLEND"))
+		{
+			material.opacity = baseColor[3];
+		}
+		return(material);
+	}
+}
+
+/***********************************************************
+ *  ModelImporter()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ModelImporter::ModelImporter(int threadCount)
+{
+	m_threadCount = threadCount;
+	if (m_threadCount <= 0)
+	{
+		m_threadCount = std::max((int)std::thread::hardware_concurrency(), 1);
+	}
+}
+
+/***********************************************************
+ *  ~ModelImporter()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ModelImporter::~ModelImporter()
+{
+}
+
+/***********************************************************
+ *  RunTasks()
+ *
+ *  This method is used for running the task once for every
+ *  index.  The threads take the next index from a shared
+ *  counter, so the long tasks do not hold up the others,
+ *  and the calling thread works alongside them.
+ ***********************************************************/
+void ModelImporter::RunTasks(size_t taskCount, const std::function<void(size_t)>& task)
+{
+	std::atomic<size_t> nextTask(0);
+	auto runTasks = [&]()
+	{
+		while (true)
+		{
+			size_t taskIndex = nextTask.fetch_add(1);
+			if (taskIndex >= taskCount)
+			{
+				break;
+			}
+			task(taskIndex);
+		}
+	};
+
+	int threadCount = (int)std::min((size_t)m_threadCount, taskCount);
+	std::vector<std::thread> threads;
+	for (int i = 1; i < threadCount; i++)
+	{
+		threads.push_back(std::thread(runTasks));
+	}
+	runTasks();
+	for (size_t i = 0; i < threads.size(); i++)
+	{
+		threads[i].join();
+	}
+}
+
+/***********************************************************
+ *  Import()
+ *
+ *  This method is used for mapping the model file into
+ *  memory and reading it with the parser of its format.
+ *  The mapping is released once the meshes are decoded, so
+ *  nothing in the model points into the file.
+ ***********************************************************/
+bool ModelImporter::Import(const char* filename, MODEL& model)
+{
+	model.meshes.clear();
+	model.materials.clear();
+	model.nodes.clear();
+	memset(&model.stats, 0, sizeof(model.stats));
+
+	std::string path = filename;
+	size_t dot = path.find_last_of('.');
+	std::string extension = (dot != std::string::npos) ? path.substr(dot + 1) : std::string();
+	for (size_t i = 0; i < extension.size(); i++)
+	{
+		extension[i] = (char)tolower((unsigned char)extension[i]);
+	}
+	if ((extension != "obj") && (extension != "glb"))
+	{
+		printf("Model %s is not an .obj or .glb file\n", filename);
+		return(false);
+	}
+
+	double startTime = GetMilliseconds();
+	MAPPED_FILE file;
+	if (MapFile(filename, file) == false)
+	{
+		printf("Could not open the model %s\n", filename);
+		return(false);
+	}
+	model.stats.fileBytes = file.size;
+	model.stats.mapMilliseconds = (float)(GetMilliseconds() - startTime);
+
+	bool bSuccess = false;
+	if (extension == "obj")
+	{
+		size_t slash = path.find_last_of("/\\");
+		std::string directory = (slash != std::string::npos) ? path.substr(0, slash + 1) : std::string();
+		bSuccess = ImportObj((const char*)file.pData, file.size, directory, model);
+	}
+	else
+	{
+		bSuccess = ImportGlb(file.pData, file.size, model);
+	}
+	UnmapFile(file);
+
+	for (size_t i = 0; i < model.meshes.size(); i++)
+	{
+		model.stats.vertexCount += model.meshes[i].data.vertices.size();
+		model.stats.triangleCount += model.meshes[i].data.indices.size() / 3;
+	}
+	if ((bSuccess == true) && (model.stats.triangleCount == 0))
+	{
+		printf("Model %s has no triangles\n", filename);
+		bSuccess = false;
+	}
+	return(bSuccess);
+}
+
+/***********************************************************
+ *  ImportObj()
+ *
+ *  This method is used for reading an OBJ file.  The text is
+ *  split into chunks at line boundaries that are parsed in
+ *  parallel, the chunks are then joined by resolving their
+ *  relative indices and carrying the current group and
+ *  material over from the chunk before, and finally every
+ *  group and material is built into a mesh on its own task.
+ ***********************************************************/
+bool ModelImporter::ImportObj(const char* pText, size_t size, const std::string& directory, MODEL& model)
+{
+	double startTime = GetMilliseconds();
+
+	// split the text, moving every boundary to the next line
+	size_t chunkCount = std::max((size_t)1,
+		std::min((size_t)m_threadCount * g_ChunksPerThread, size / g_MinimumChunkBytes));
+	std::vector<OBJ_CHUNK> chunks;
+	chunks.reserve(chunkCount);
+	const char* pEnd = pText + size;
+	const char* pBegin = pText;
+	for (size_t i = 0; (i < chunkCount) && (pBegin < pEnd); i++)
+	{
+		const char* pChunkEnd = pEnd;
+		if (i + 1 < chunkCount)
+		{
+			pChunkEnd = pText + (size / chunkCount) * (i + 1);
+			pChunkEnd = std::max(pChunkEnd, pBegin);
+			const char* pNewline = (const char*)memchr(pChunkEnd, '\n', (size_t)(pEnd - pChunkEnd));
+			pChunkEnd = (NULL != pNewline) ? pNewline + 1 : pEnd;
+		}
+		OBJ_CHUNK chunk;
+		chunk.pBegin = pBegin;
+		chunk.pEnd = pChunkEnd;
+		chunks.push_back(chunk);
+		pBegin = pChunkEnd;
+	}
+
+	RunTasks(chunks.size(), [&](size_t index)
+	{
+		ParseObjChunk(chunks[index]);
+	});
+
+	// count the attributes before every chunk, then join them into
+	// the arrays that the whole file indexes
+	size_t totals[3] = { 0, 0, 0 };
+	for (size_t i = 0; i < chunks.size(); i++)
+	{
+		chunks[i].firstAttributes[0] = totals[0];
+		chunks[i].firstAttributes[1] = totals[1];
+		chunks[i].firstAttributes[2] = totals[2];
+		totals[0] += chunks[i].positions.size();
+		totals[1] += chunks[i].uvs.size();
+		totals[2] += chunks[i].normals.size();
+	}
+	if ((totals[0] > (size_t)INT32_MAX) || (totals[1] > (size_t)INT32_MAX) || (totals[2] > (size_t)INT32_MAX))
+	{
+		printf("OBJ file has too many vertices\n");
+		return(false);
+	}
+	std::vector<glm::vec3> positions(totals[0]);
+	std::vector<glm::vec2> uvs(totals[1]);
+	std::vector<glm::vec3> normals(totals[2]);
+	RunTasks(chunks.size(), [&](size_t index)
+	{
+		OBJ_CHUNK& chunk = chunks[index];
+		std::copy(chunk.positions.begin(), chunk.positions.end(), positions.begin() + chunk.firstAttributes[0]);
+		std::copy(chunk.uvs.begin(), chunk.uvs.end(), uvs.begin() + chunk.firstAttributes[1]);
+		std::copy(chunk.normals.begin(), chunk.normals.end(), normals.begin() + chunk.firstAttributes[2]);
+		std::vector<glm::vec3>().swap(chunk.positions);
+		std::vector<glm::vec2>().swap(chunk.uvs);
+		std::vector<glm::vec3>().swap(chunk.normals);
+		ResolveObjChunk(chunk, totals);
+	});
+
+	// the materials named by the file, by their name, where a
+	// later library replaces a material of the same name
+	for (size_t i = 0; i < chunks.size(); i++)
+	{
+		for (size_t j = 0; j < chunks[i].materialLibraries.size(); j++)
+		{
+			ParseMtlFile(directory + std::string(chunks[i].materialLibraries[j]), model.materials);
+		}
+	}
+	std::map<std::string_view, int> materialIndices;
+	for (size_t m = 0; m < model.materials.size(); m++)
+	{
+		materialIndices[model.materials[m].name] = (int)m;
+	}
+
+	// carry the group and material across the chunks, and collect
+	// the corners of every group and material
+	std::map<std::pair<std::string_view, std::string_view>, size_t> meshIndices;
+	std::vector<std::vector<CORNER_RANGE>> meshRanges;
+	std::string_view currentObject;
+	std::string_view currentMaterial;
+	for (size_t i = 0; i < chunks.size(); i++)
+	{
+		const OBJ_CHUNK& chunk = chunks[i];
+		for (size_t s = 0; s < chunk.segments.size(); s++)
+		{
+			const OBJ_SEGMENT& segment = chunk.segments[s];
+			if (segment.bObjectSet == true)
+			{
+				currentObject = segment.object;
+			}
+			if (segment.bMaterialSet == true)
+			{
+				currentMaterial = segment.material;
+			}
+			size_t lastCorner = (s + 1 < chunk.segments.size()) ?
+				chunk.segments[s + 1].firstCorner : chunk.corners.size();
+			if (lastCorner == segment.firstCorner)
+			{
+				continue;
+			}
+
+			std::pair<std::string_view, std::string_view> key(currentObject, currentMaterial);
+			std::map<std::pair<std::string_view, std::string_view>, size_t>::iterator found = meshIndices.find(key);
+			if (found == meshIndices.end())
+			{
+				found = meshIndices.insert(std::make_pair(key, model.meshes.size())).first;
+				MODEL_MESH mesh;
+				mesh.name = currentObject.empty() ? std::string("mesh") : std::string(currentObject);
+				std::map<std::string_view, int>::iterator material = materialIndices.find(currentMaterial);
+				mesh.material = (material != materialIndices.end()) ? material->second : -1;
+				model.meshes.push_back(mesh);
+				meshRanges.push_back(std::vector<CORNER_RANGE>());
+			}
+			CORNER_RANGE range = { &chunk.corners[segment.firstCorner], lastCorner - segment.firstCorner };
+			meshRanges[found->second].push_back(range);
+		}
+	}
+	model.stats.parseMilliseconds = (float)(GetMilliseconds() - startTime);
+
+	startTime = GetMilliseconds();
+	RunTasks(model.meshes.size(), [&](size_t index)
+	{
+		BuildObjMesh(meshRanges[index], positions, uvs, normals, model.meshes[index]);
+	});
+	model.stats.decodeMilliseconds = (float)(GetMilliseconds() - startTime);
+
+	// an OBJ file places every mesh once, as it is
+	for (size_t i = 0; i < model.meshes.size(); i++)
+	{
+		ModelImporter::MODEL_NODE node;
+		node.mesh = (int)i;
+		node.transform = glm::mat4(1.0f);
+		model.nodes.push_back(node);
+	}
+	return(true);
+}
+
+/***********************************************************
+ *  ImportGlb()
+ *
+ *  This method is used for reading a binary glTF file.  The
+ *  JSON chunk is parsed in place, every triangle primitive
+ *  of every mesh becomes a mesh that is decoded from the
+ *  binary chunk on its own task, and the nodes of the scene
+ *  place the meshes with their combined transformations.
+ ***********************************************************/
+bool ModelImporter::ImportGlb(const unsigned char* pBytes, size_t size, MODEL& model)
+{
+	double startTime = GetMilliseconds();
+
+	// 12 byte header followed by the JSON chunk and the optional
+	// binary chunk, each with a length and a type
+	uint32_t header[5];
+	if (size < sizeof(header))
+	{
+		printf("glTF file is too short\n");
+		return(false);
+	}
+	memcpy(header, pBytes, sizeof(header));
+	if ((header[0] != g_GlbMagic) || (header[1] != 2) || (header[4] != g_GlbJsonChunk) ||
+		(header[3] > size - sizeof(header)))
+	{
+		printf("Not a binary glTF 2.0 file\n");
+		return(false);
+	}
+	const char* pJson = (const char*)pBytes + sizeof(header);
+	size_t jsonSize = header[3];
+
+	GLB_CONTEXT context;
+	context.pBinary = NULL;
+	context.binarySize = 0;
+	size_t binaryChunk = sizeof(header) + ((jsonSize + 3) & ~(size_t)3);
+	if (binaryChunk + 8 <= size)
+	{
+		uint32_t chunkHeader[2];
+		memcpy(chunkHeader, pBytes + binaryChunk, sizeof(chunkHeader));
+		if ((chunkHeader[1] == g_GlbBinChunk) && (chunkHeader[0] <= size - binaryChunk - 8))
+		{
+			context.pBinary = pBytes + binaryChunk + 8;
+			context.binarySize = chunkHeader[0];
+		}
+	}
+
+	const char* p = pJson;
+	if (ParseJsonValue(context.document, p, pJson + jsonSize, 0) != 0)
+	{
+		printf("glTF file has invalid JSON\n");
+		return(false);
+	}
+	const JSON_DOCUMENT& document = context.document;
+	context.pRoot = &document.values[0];
+
+	const JSON_VALUE* pBuffers = FindMember(document, context.pRoot, "buffers");
+	for (size_t i = 0; (NULL != pBuffers) && (i < pBuffers->children.size()); i++)
+	{
+		if (NULL != FindMember(document, GetElement(document, pBuffers, (int)i), "uri"))
+		{
+			printf("glTF buffers in external files are not supported, only the .glb binary chunk is read\n");
+			break;
+		}
+	}
+
+	const JSON_VALUE* pMaterials = FindMember(document, context.pRoot, "materials");
+	for (size_t i = 0; (NULL != pMaterials) && (i < pMaterials->children.size()); i++)
+	{
+		model.materials.push_back(ConvertGltfMaterial(document, GetElement(document, pMaterials, (int)i)));
+	}
+
+	// one model mesh for every primitive, with the first of each
+	// glTF mesh for the nodes to find them
+	const JSON_VALUE* pMeshes = FindMember(document, context.pRoot, "meshes");
+	std::vector<const JSON_VALUE*> primitives;
+	std::vector<size_t> firstPrimitives;
+	for (size_t i = 0; (NULL != pMeshes) && (i < pMeshes->children.size()); i++)
+	{
+		const JSON_VALUE* pMesh = GetElement(document, pMeshes, (int)i);
+		const JSON_VALUE* pPrimitives = FindMember(document, pMesh, "primitives");
+		const JSON_VALUE* pName = FindMember(document, pMesh, "name");
+		firstPrimitives.push_back(primitives.size());
+		for (size_t j = 0; (NULL != pPrimitives) && (j < pPrimitives->children.size()); j++)
+		{
+			const JSON_VALUE* pPrimitive = GetElement(document, pPrimitives, (int)j);
+			primitives.push_back(pPrimitive);
+
+			MODEL_MESH mesh;
+			mesh.name = (NULL != pName) ? std::string(pName->text) : std::string("mesh");
+			mesh.material = GetInteger(document, pPrimitive, "material", -1);
+			if (mesh.material >= (int)model.materials.size())
+			{
+				mesh.material = -1;
+			}
+			model.meshes.push_back(mesh);
+		}
+	}
+	firstPrimitives.push_back(primitives.size());
+	model.stats.parseMilliseconds = (float)(GetMilliseconds() - startTime);
+
+	startTime = GetMilliseconds();
+	std::vector<char> decoded(primitives.size(), 0);
+	RunTasks(primitives.size(), [&](size_t index)
+	{
+		decoded[index] = DecodePrimitive(context, primitives[index], model.meshes[index]) ? 1 : 0;
+	});
+	model.stats.decodeMilliseconds = (float)(GetMilliseconds() - startTime);
+	int skipped = 0;
+	for (size_t i = 0; i < decoded.size(); i++)
+	{
+		if (decoded[i] == 0)
+		{
+			model.meshes[i].data.vertices.clear();
+			model.meshes[i].data.indices.clear();
+			skipped++;
+		}
+	}
+	if (skipped > 0)
+	{
+		printf("Skipped %d glTF primitives that are not triangle lists stored in the binary chunk\n", skipped);
+	}
+
+	// walk the nodes of the scene, or every root node when the
+	// file has no scene
+	const JSON_VALUE* pNodes = FindMember(document, context.pRoot, "nodes");
+	size_t nodeCount = (NULL != pNodes) ? pNodes->children.size() : 0;
+	std::vector<int> roots;
+	const JSON_VALUE* pScene = GetElement(document, FindMember(document, context.pRoot, "scenes"),
+		GetInteger(document, context.pRoot, "scene", 0));
+	const JSON_VALUE* pSceneNodes = FindMember(document, pScene, "nodes");
+	if (NULL != pSceneNodes)
+	{
+		for (size_t i = 0; i < pSceneNodes->children.size(); i++)
+		{
+			roots.push_back((int)document.values[pSceneNodes->children[i]].number);
+		}
+	}
+	else
+	{
+		std::vector<bool> bChild(nodeCount, false);
+		for (size_t i = 0; i < nodeCount; i++)
+		{
+			const JSON_VALUE* pChildren = FindMember(document, GetElement(document, pNodes, (int)i), "children");
+			for (size_t c = 0; (NULL != pChildren) && (c < pChildren->children.size()); c++)
+			{
+				size_t child = (size_t)document.values[pChildren->children[c]].number;
+				if (child < nodeCount)
+				{
+					bChild[child] = true;
+				}
+			}
+		}
+		for (size_t i = 0; i < nodeCount; i++)
+		{
+			if (bChild[i] == false)
+			{
+				roots.push_back((int)i);
+			}
+		}
+	}
+
+	// every node is visited once, which also stops a broken file
+	// whose nodes form a loop
+	std::vector<bool> bVisited(nodeCount, false);
+	std::vector<std::pair<int, glm::mat4>> stack;
+	for (size_t i = 0; i < roots.size(); i++)
+	{
+		stack.push_back(std::make_pair(roots[i], glm::mat4(1.0f)));
+	}
+	while (stack.empty() == false)
+	{
+		int nodeIndex = stack.back().first;
+		glm::mat4 parent = stack.back().second;
+		stack.pop_back();
+		if ((nodeIndex < 0) || (nodeIndex >= (int)nodeCount) || (bVisited[nodeIndex] == true))
+		{
+			continue;
+		}
+		bVisited[nodeIndex] = true;
+
+		const JSON_VALUE* pNode = GetElement(document, pNodes, nodeIndex);
+		glm::mat4 transform = parent * GetNodeTransform(document, pNode);
+		int mesh = GetInteger(document, pNode, "mesh", -1);
+		if ((mesh >= 0) && (mesh + 1 < (int)firstPrimitives.size()))
+		{
+			for (size_t m = firstPrimitives[mesh]; m < firstPrimitives[mesh + 1]; m++)
+			{
+				if (model.meshes[m].data.indices.empty() == false)
+				{
+					ModelImporter::MODEL_NODE node;
+					node.mesh = (int)m;
+					node.transform = transform;
+					model.nodes.push_back(node);
+				}
+			}
+		}
+
+		const JSON_VALUE* pChildren = FindMember(document, pNode, "children");
+		for (size_t c = 0; (NULL != pChildren) && (c < pChildren->children.size()); c++)
+		{
+			stack.push_back(std::make_pair((int)document.values[pChildren->children[c]].number, transform));
+		}
+	}
+
+	// a file with meshes but no nodes shows the meshes as they are
+	if ((nodeCount == 0) && (model.nodes.empty() == true))
+	{
+		for (size_t i = 0; i < model.meshes.size(); i++)
+		{
+			if (model.meshes[i].data.indices.empty() == false)
+			{
+				ModelImporter::MODEL_NODE node;
+				node.mesh = (int)i;
+				node.transform = glm::mat4(1.0f);
+				model.nodes.push_back(node);
+			}
+		}
+	}
+	return(true);
+}
+
+/***********************************************************
+ *  ReportModel()
+ *
+ *  This method is used for printing the size of the model
+ *  and the time taken by each stage of its import.
+ ***********************************************************/
+void ModelImporter::ReportModel(const char* filename, const MODEL& model)
+{
+	const IMPORT_STATS& stats = model.stats;
+	double seconds = (stats.mapMilliseconds + stats.parseMilliseconds + stats.decodeMilliseconds) / 1000.0;
+	printf("Imported %s: %zu meshes, %zu placements, %zu materials, %zu vertices, %zu triangles\n",
+		filename,
+		model.meshes.size(),
+		model.nodes.size(),
+		model.materials.size(),
+		stats.vertexCount,
+		stats.triangleCount);
+	printf("  %.1f MB in %.1f ms map, %.1f ms parse, %.1f ms decode (%.0f MB/s)\n",
+		stats.fileBytes / (1024.0 * 1024.0),
+		stats.mapMilliseconds,
+		stats.parseMilliseconds,
+		stats.decodeMilliseconds,
+		(seconds > 0.0) ? stats.fileBytes / (1024.0 * 1024.0) / seconds : 0.0);
+}
@@ -0,0 +1,112 @@
+///////////////////////////////////////////////////////////////////////////////
+// modelimporter.h
+// ============
+// read the meshes and materials of Wavefront OBJ and binary glTF 2.0 files
+// on worker threads, straight from the memory-mapped file
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include "CompactMeshes.h"
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  ModelImporter
+ *
+ *  This class turns a model file into optimized triangle
+ *  lists in the float vertex layout of the basic shapes.
+ *  The file is mapped into memory rather than read, and the
+ *  text and JSON are parsed in place, so names and numbers
+ *  are never copied out before they are converted.  An OBJ
+ *  file is split at line boundaries and the pieces are
+ *  parsed in parallel, with the relative indices resolved
+ *  once the vertex counts of the earlier pieces are known.
+ *  Every mesh, which is a group and material of an OBJ file
+ *  or a primitive of a glTF file, is then decoded and
+ *  reordered for the vertex cache on its own worker task.
+ *  Textures referenced by the materials are not loaded.
+ ***********************************************************/
+class ModelImporter
+{
+public:
+	// constructor, using every core when the thread count is zero
+	ModelImporter(int threadCount = 0);
+	// destructor
+	~ModelImporter();
+
+	// look of a part of the model, in the terms of an MTL file
+	struct MODEL_MATERIAL
+	{
+		std::string name;
+		// the ambient color is scaled by the diffuse color when
+		// the part is shaded
+		glm::vec3 ambientColor;
+		glm::vec3 diffuseColor;
+		glm::vec3 specularColor;
+		float shininess;
+		// from 0 for invisible to 1 for opaque
+		float opacity;
+	};
+
+	// triangles of one part of the model that share a material
+	struct MODEL_MESH
+	{
+		std::string name;
+		CompactMeshes::MESH_DATA data;
+		// index into the materials, or -1 for none
+		int material;
+		// bounds of the positions in model space
+		glm::vec3 boundsMin;
+		glm::vec3 boundsMax;
+	};
+
+	// placement of a mesh within the model
+	struct MODEL_NODE
+	{
+		int mesh;
+		glm::mat4 transform;
+	};
+
+	// sizes and time taken by the stages of an import
+	struct IMPORT_STATS
+	{
+		size_t fileBytes;
+		size_t vertexCount;
+		size_t triangleCount;
+		float mapMilliseconds;
+		float parseMilliseconds;
+		float decodeMilliseconds;
+	};
+
+	struct MODEL
+	{
+		std::vector<MODEL_MESH> meshes;
+		std::vector<MODEL_MATERIAL> materials;
+		std::vector<MODEL_NODE> nodes;
+		IMPORT_STATS stats;
+	};
+
+	// read the .obj or .glb file, chosen by its extension
+	bool Import(const char* filename, MODEL& model);
+	// print the sizes and stage times of the imported model
+	static void ReportModel(const char* filename, const MODEL& model);
+	// get the number of threads the meshes are decoded on
+	int GetThreadCount() const { return(m_threadCount); }
+
+private:
+	int m_threadCount;
+
+	// parse the mapped text of an OBJ file, with the MTL files
+	// it names looked up next to it
+	bool ImportObj(const char* pText, size_t size, const std::string& directory, MODEL& model);
+	// parse the mapped bytes of a binary glTF file
+	bool ImportGlb(const unsigned char* pBytes, size_t size, MODEL& model);
+	// run the task once for every index, spread over the threads
+	void RunTasks(size_t taskCount, const std::function<void(size_t)>& task);
+};
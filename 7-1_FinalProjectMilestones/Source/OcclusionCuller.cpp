@@ -0,0 +1,415 @@
+///////////////////////////////////////////////////////////////////////////////
+// occlusionculler.cpp
+// ============
+// cull hidden objects on the CPU by rasterizing occluders into a small
+// depth buffer and testing object bounds against its depth pyramid
+///////////////////////////////////////////////////////////////////////////////
+
+#include "OcclusionCuller.h"
+#include "CpuFeatures.h"
+
+#include <algorithm>
+#include <cmath>
+
+// declaration of global variables
+namespace
+{
+	// edge functions and depth plane of a triangle, evaluated at
+	// the pixel centers as A * x + B * y + C
+	struct TRIANGLE_SETUP
+	{
+		float edgeA[3];
+		float edgeB[3];
+		float edgeC[3];
+		float depthA;
+		float depthB;
+		float depthC;
+		int minX;
+		int maxX;
+		int minY;
+		int maxY;
+	};
+
+	// corners of a box, indexed by the bits x = 1, y = 2, z = 4
+	const int g_BoxTriangles[12][3] =
+	{
+		{ 0, 2, 3 }, { 0, 3, 1 },	// -z
+		{ 4, 5, 7 }, { 4, 7, 6 },	// +z
+		{ 0, 4, 6 }, { 0, 6, 2 },	// -x
+		{ 1, 3, 7 }, { 1, 7, 5 },	// +x
+		{ 0, 1, 5 }, { 0, 5, 4 },	// -y
+		{ 2, 6, 7 }, { 2, 7, 3 }	// +y
+	};
+
+	void RasterizeRowsScalar(float* pDepth, int width, const TRIANGLE_SETUP& setup)
+	{
+		for (int y = setup.minY; y <= setup.maxY; y++)
+		{
+			// same evaluation order as the AVX2 rows, so both give
+			// identical results
+			float py = y + 0.5f;
+			float rowEdge0 = setup.edgeB[0] * py + setup.edgeC[0];
+			float rowEdge1 = setup.edgeB[1] * py + setup.edgeC[1];
+			float rowEdge2 = setup.edgeB[2] * py + setup.edgeC[2];
+			float rowDepth = setup.depthB * py + setup.depthC;
+			float* pRow = pDepth + y * width;
+			for (int x = setup.minX; x <= setup.maxX; x++)
+			{
+				float px = x + 0.5f;
+				if ((setup.edgeA[0] * px + rowEdge0 >= 0.0f) &&
+					(setup.edgeA[1] * px + rowEdge1 >= 0.0f) &&
+					(setup.edgeA[2] * px + rowEdge2 >= 0.0f))
+				{
+					float z = setup.depthA * px + rowDepth;
+					pRow[x] = std::min(pRow[x], z);
+				}
+			}
+		}
+	}
+
+#ifdef CPU_FEATURES_AVX2
+	// rasterize blocks of eight pixels, which are aligned so that
+	// they never cross the edge of the depth buffer
+	CPU_AVX2_FUNCTION
+	void RasterizeRowsAVX2(float* pDepth, int width, const TRIANGLE_SETUP& setup)
+	{
+		const __m256 offsets = _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f);
+		const __m256 zero = _mm256_setzero_ps();
+		const __m256 edgeA0 = _mm256_set1_ps(setup.edgeA[0]);
+		const __m256 edgeA1 = _mm256_set1_ps(setup.edgeA[1]);
+		const __m256 edgeA2 = _mm256_set1_ps(setup.edgeA[2]);
+		const __m256 depthA = _mm256_set1_ps(setup.depthA);
+
+		for (int y = setup.minY; y <= setup.maxY; y++)
+		{
+			float py = y + 0.5f;
+			__m256 rowEdge0 = _mm256_set1_ps(setup.edgeB[0] * py + setup.edgeC[0]);
+			__m256 rowEdge1 = _mm256_set1_ps(setup.edgeB[1] * py + setup.edgeC[1]);
+			__m256 rowEdge2 = _mm256_set1_ps(setup.edgeB[2] * py + setup.edgeC[2]);
+			__m256 rowDepth = _mm256_set1_ps(setup.depthB * py + setup.depthC);
+			float* pRow = pDepth + y * width;
+
+			for (int x = setup.minX & ~7; x <= setup.maxX; x += 8)
+			{
+				__m256 px = _mm256_add_ps(_mm256_set1_ps((float)x), offsets);
+				__m256 edge0 = _mm256_add_ps(_mm256_mul_ps(edgeA0, px), rowEdge0);
+				__m256 edge1 = _mm256_add_ps(_mm256_mul_ps(edgeA1, px), rowEdge1);
+				__m256 edge2 = _mm256_add_ps(_mm256_mul_ps(edgeA2, px), rowEdge2);
+				__m256 inside = _mm256_and_ps(
+					_mm256_and_ps(
+						_mm256_cmp_ps(edge0, zero, _CMP_GE_OQ),
+						_mm256_cmp_ps(edge1, zero, _CMP_GE_OQ)),
+					_mm256_cmp_ps(edge2, zero, _CMP_GE_OQ));
+				if (_mm256_movemask_ps(inside) == 0)
+				{
+					continue;
+				}
+
+				__m256 z = _mm256_add_ps(_mm256_mul_ps(depthA, px), rowDepth);
+				__m256 previous = _mm256_loadu_ps(pRow + x);
+				__m256 closer = _mm256_min_ps(previous, z);
+				_mm256_storeu_ps(pRow + x, _mm256_blendv_ps(previous, closer, inside));
+			}
+		}
+	}
+#endif
+}
+
+/***********************************************************
+ *  OcclusionCuller()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+OcclusionCuller::OcclusionCuller()
+{
+	m_viewProjection = glm::mat4(1.0f);
+	m_bUseAVX2 = CpuFeatures::HasAVX2();
+
+	int width = DEPTH_WIDTH;
+	int height = DEPTH_HEIGHT;
+	while (true)
+	{
+		DEPTH_LEVEL level;
+		level.width = width;
+		level.height = height;
+		level.depth.assign((size_t)width * height, 1.0f);
+		m_levels.push_back(level);
+
+		if ((width == 1) && (height == 1))
+		{
+			break;
+		}
+		width = std::max(1, width / 2);
+		height = std::max(1, height / 2);
+	}
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method is used for clearing the depth buffer to the
+ *  far plane for the passed in view.
+ ***********************************************************/
+void OcclusionCuller::BeginFrame(const glm::mat4& viewProjection)
+{
+	m_viewProjection = viewProjection;
+	std::fill(m_levels[0].depth.begin(), m_levels[0].depth.end(), 1.0f);
+}
+
+/***********************************************************
+ *  RasterizeOccluderBox()
+ *
+ *  This method is used for rasterizing the twelve triangles
+ *  of the box into the depth buffer.  Flat boxes, such as
+ *  planes, only produce the triangles with an area.
+ ***********************************************************/
+void OcclusionCuller::RasterizeOccluderBox(
+	const glm::mat4& model,
+	const glm::vec3& boxMin,
+	const glm::vec3& boxMax)
+{
+	glm::mat4 transform = m_viewProjection * model;
+
+	glm::vec4 corners[8];
+	for (int i = 0; i < 8; i++)
+	{
+		glm::vec4 corner(
+			(i & 1) ? boxMax.x : boxMin.x,
+			(i & 2) ? boxMax.y : boxMin.y,
+			(i & 4) ? boxMax.z : boxMin.z,
+			1.0f);
+		corners[i] = transform * corner;
+	}
+
+	for (int i = 0; i < 12; i++)
+	{
+		RasterizeClipTriangle(
+			corners[g_BoxTriangles[i][0]],
+			corners[g_BoxTriangles[i][1]],
+			corners[g_BoxTriangles[i][2]]);
+	}
+}
+
+/***********************************************************
+ *  RasterizeClipTriangle()
+ *
+ *  This method is used for clipping the triangle in clip
+ *  space against the near plane, and rasterizing the one or
+ *  two triangles that are left.  The other planes are
+ *  handled by clamping to the depth buffer.
+ ***********************************************************/
+void OcclusionCuller::RasterizeClipTriangle(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c)
+{
+	const glm::vec4 input[3] = { a, b, c };
+	glm::vec4 clipped[4];
+	int clippedCount = 0;
+
+	for (int i = 0; i < 3; i++)
+	{
+		const glm::vec4& current = input[i];
+		const glm::vec4& next = input[(i + 1) % 3];
+		float currentDistance = current.z + current.w;
+		float nextDistance = next.z + next.w;
+
+		if (currentDistance >= 0.0f)
+		{
+			clipped[clippedCount++] = current;
+		}
+		if ((currentDistance >= 0.0f) != (nextDistance >= 0.0f))
+		{
+			float t = currentDistance / (currentDistance - nextDistance);
+			clipped[clippedCount++] = current + (next - current) * t;
+		}
+	}
+
+	if (clippedCount < 3)
+	{
+		return;
+	}
+
+	// project to the pixels of the depth buffer, with depth
+	// in the range of 0 at the near plane to 1 at the far plane
+	glm::vec3 screen[4];
+	for (int i = 0; i < clippedCount; i++)
+	{
+		float inverseW = 1.0f / std::max(clipped[i].w, 1e-6f);
+		screen[i].x = (clipped[i].x * inverseW * 0.5f + 0.5f) * DEPTH_WIDTH;
+		screen[i].y = (clipped[i].y * inverseW * 0.5f + 0.5f) * DEPTH_HEIGHT;
+		screen[i].z = clipped[i].z * inverseW * 0.5f + 0.5f;
+	}
+
+	RasterizeScreenTriangle(screen[0], screen[1], screen[2]);
+	if (clippedCount == 4)
+	{
+		RasterizeScreenTriangle(screen[0], screen[2], screen[3]);
+	}
+}
+
+/***********************************************************
+ *  RasterizeScreenTriangle()
+ *
+ *  This method is used for setting up the edge functions and
+ *  the depth plane of the triangle, and filling the pixels
+ *  whose centers are inside it with the nearest depth.
+ ***********************************************************/
+void OcclusionCuller::RasterizeScreenTriangle(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c)
+{
+	glm::vec3 v0 = a;
+	glm::vec3 v1 = b;
+	glm::vec3 v2 = c;
+
+	// occluders are closed or flat, so both windings are drawn
+	float area = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+	if (fabsf(area) < 1e-6f)
+	{
+		return;
+	}
+	if (area < 0.0f)
+	{
+		std::swap(v1, v2);
+		area = -area;
+	}
+
+	TRIANGLE_SETUP setup;
+	setup.minX = std::max(0, (int)floorf(std::min(v0.x, std::min(v1.x, v2.x))));
+	setup.maxX = std::min(DEPTH_WIDTH - 1, (int)ceilf(std::max(v0.x, std::max(v1.x, v2.x))));
+	setup.minY = std::max(0, (int)floorf(std::min(v0.y, std::min(v1.y, v2.y))));
+	setup.maxY = std::min(DEPTH_HEIGHT - 1, (int)ceilf(std::max(v0.y, std::max(v1.y, v2.y))));
+	if ((setup.minX > setup.maxX) || (setup.minY > setup.maxY))
+	{
+		return;
+	}
+
+	// edge i is opposite vertex i, and is positive inside
+	const glm::vec3* pVertices[3] = { &v0, &v1, &v2 };
+	for (int i = 0; i < 3; i++)
+	{
+		const glm::vec3& from = *pVertices[(i + 1) % 3];
+		const glm::vec3& to = *pVertices[(i + 2) % 3];
+		setup.edgeA[i] = from.y - to.y;
+		setup.edgeB[i] = to.x - from.x;
+		setup.edgeC[i] = from.x * to.y - from.y * to.x;
+	}
+
+	// the edge functions divided by the area are the barycentric
+	// weights, which interpolate the depth linearly on screen
+	float inverseArea = 1.0f / area;
+	setup.depthA = (setup.edgeA[0] * v0.z + setup.edgeA[1] * v1.z + setup.edgeA[2] * v2.z) * inverseArea;
+	setup.depthB = (setup.edgeB[0] * v0.z + setup.edgeB[1] * v1.z + setup.edgeB[2] * v2.z) * inverseArea;
+	setup.depthC = (setup.edgeC[0] * v0.z + setup.edgeC[1] * v1.z + setup.edgeC[2] * v2.z) * inverseArea;
+
+	float* pDepth = m_levels[0].depth.data();
+#ifdef CPU_FEATURES_AVX2
+	if (m_bUseAVX2 == true)
+	{
+		RasterizeRowsAVX2(pDepth, DEPTH_WIDTH, setup);
+		return;
+	}
+#endif
+	RasterizeRowsScalar(pDepth, DEPTH_WIDTH, setup);
+}
+
+/***********************************************************
+ *  BuildHierarchy()
+ *
+ *  This method is used for building the depth pyramid, where
+ *  each texel holds the farthest depth of the four texels
+ *  below it, so a single texel bounds a whole region.
+ ***********************************************************/
+void OcclusionCuller::BuildHierarchy()
+{
+	for (size_t level = 1; level < m_levels.size(); level++)
+	{
+		const DEPTH_LEVEL& source = m_levels[level - 1];
+		DEPTH_LEVEL& target = m_levels[level];
+
+		for (int y = 0; y < target.height; y++)
+		{
+			int sourceY0 = std::min(y * 2, source.height - 1);
+			int sourceY1 = std::min(y * 2 + 1, source.height - 1);
+			for (int x = 0; x < target.width; x++)
+			{
+				int sourceX0 = std::min(x * 2, source.width - 1);
+				int sourceX1 = std::min(x * 2 + 1, source.width - 1);
+				float farthest = std::max(
+					std::max(source.depth[sourceY0 * source.width + sourceX0], source.depth[sourceY0 * source.width + sourceX1]),
+					std::max(source.depth[sourceY1 * source.width + sourceX0], source.depth[sourceY1 * source.width + sourceX1]));
+				target.depth[y * target.width + x] = farthest;
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  TestBounds()
+ *
+ *  This method is used for testing whether the bounding box
+ *  is hidden.  The nearest depth of the box is compared with
+ *  the farthest depth of the pyramid level where its screen
+ *  rectangle, grown by a pixel for safety, covers at most
+ *  three texels in each direction.  Boxes that cross the
+ *  near plane are always visible.
+ ***********************************************************/
+OcclusionCuller::VISIBILITY OcclusionCuller::TestBounds(
+	const glm::mat4& model,
+	const glm::vec3& boxMin,
+	const glm::vec3& boxMax) const
+{
+	glm::mat4 transform = m_viewProjection * model;
+
+	glm::vec3 minimum(1e30f);
+	glm::vec3 maximum(-1e30f);
+	for (int i = 0; i < 8; i++)
+	{
+		glm::vec4 corner(
+			(i & 1) ? boxMax.x : boxMin.x,
+			(i & 2) ? boxMax.y : boxMin.y,
+			(i & 4) ? boxMax.z : boxMin.z,
+			1.0f);
+		glm::vec4 clip = transform * corner;
+		if ((clip.w <= 1e-6f) || (clip.z < -clip.w))
+		{
+			return(VISIBLE);
+		}
+
+		glm::vec3 ndc = glm::vec3(clip) / clip.w;
+		minimum = glm::min(minimum, ndc);
+		maximum = glm::max(maximum, ndc);
+	}
+
+	if ((maximum.x < -1.0f) || (minimum.x > 1.0f) ||
+		(maximum.y < -1.0f) || (minimum.y > 1.0f) ||
+		(minimum.z > 1.0f))
+	{
+		return(OUTSIDE_FRUSTUM);
+	}
+
+	float nearestDepth = minimum.z * 0.5f + 0.5f;
+	int x0 = std::max(0, (int)floorf((minimum.x * 0.5f + 0.5f) * DEPTH_WIDTH) - 1);
+	int x1 = std::min(DEPTH_WIDTH - 1, (int)floorf((maximum.x * 0.5f + 0.5f) * DEPTH_WIDTH) + 1);
+	int y0 = std::max(0, (int)floorf((minimum.y * 0.5f + 0.5f) * DEPTH_HEIGHT) - 1);
+	int y1 = std::min(DEPTH_HEIGHT - 1, (int)floorf((maximum.y * 0.5f + 0.5f) * DEPTH_HEIGHT) + 1);
+
+	size_t level = 0;
+	while ((level + 1 < m_levels.size()) &&
+		(((x1 >> level) - (x0 >> level) > 2) || ((y1 >> level) - (y0 >> level) > 2)))
+	{
+		level++;
+	}
+
+	const DEPTH_LEVEL& depthLevel = m_levels[level];
+	int levelX1 = std::min(x1 >> level, depthLevel.width - 1);
+	int levelY1 = std::min(y1 >> level, depthLevel.height - 1);
+	for (int y = y0 >> level; y <= levelY1; y++)
+	{
+		for (int x = x0 >> level; x <= levelX1; x++)
+		{
+			if (nearestDepth <= depthLevel.depth[y * depthLevel.width + x])
+			{
+				return(VISIBLE);
+			}
+		}
+	}
+
+	return(OCCLUDED);
+}
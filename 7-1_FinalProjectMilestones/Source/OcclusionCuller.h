@@ -0,0 +1,81 @@
+///////////////////////////////////////////////////////////////////////////////
+// occlusionculler.h
+// ============
+// cull hidden objects on the CPU by rasterizing occluders into a small
+// depth buffer and testing object bounds against its depth pyramid
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  OcclusionCuller
+ *
+ *  This class contains a low resolution depth buffer that
+ *  the designated occluders are rasterized into each frame,
+ *  eight pixels at a time with AVX2 when the CPU supports
+ *  it.  A hierarchy of farthest depths is then built, and
+ *  the screen rectangle of each object's bounding box is
+ *  tested against it to find the objects that are hidden.
+ ***********************************************************/
+class OcclusionCuller
+{
+public:
+	// constructor
+	OcclusionCuller();
+
+	// size of the depth buffer in pixels - the width is a
+	// multiple of the eight pixel rasterizer blocks
+	static const int DEPTH_WIDTH = 256;
+	static const int DEPTH_HEIGHT = 128;
+
+	// results of testing the bounds of an object
+	enum VISIBILITY
+	{
+		VISIBLE,
+		OCCLUDED,
+		OUTSIDE_FRUSTUM
+	};
+
+	// clear the depth buffer for the passed in view
+	void BeginFrame(const glm::mat4& viewProjection);
+	// rasterize the box, in the object space of the model
+	// transformation, as an occluder
+	void RasterizeOccluderBox(
+		const glm::mat4& model,
+		const glm::vec3& boxMin,
+		const glm::vec3& boxMax);
+	// build the depth pyramid after all occluders are drawn
+	void BuildHierarchy();
+	// test the bounding box, in the object space of the model
+	// transformation, against the depth pyramid
+	VISIBILITY TestBounds(
+		const glm::mat4& model,
+		const glm::vec3& boxMin,
+		const glm::vec3& boxMax) const;
+
+	// true when the AVX2 rasterizer is used
+	bool IsUsingAVX2() const { return(m_bUseAVX2); }
+
+private:
+	struct DEPTH_LEVEL
+	{
+		int width;
+		int height;
+		std::vector<float> depth;
+	};
+
+	glm::mat4 m_viewProjection;
+	// level 0 is the rasterized depth buffer, and every level
+	// above holds the farthest depth of four texels below it
+	std::vector<DEPTH_LEVEL> m_levels;
+	bool m_bUseAVX2;
+
+	// clip the triangle against the near plane and rasterize it
+	void RasterizeClipTriangle(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c);
+	// rasterize the triangle given in depth buffer pixels
+	void RasterizeScreenTriangle(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c);
+};
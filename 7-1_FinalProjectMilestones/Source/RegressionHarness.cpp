@@ -0,0 +1,496 @@
+///////////////////////////////////////////////////////////////////////////////
+// regressionharness.cpp
+// ============
+// render the scene from fixed camera poses and check the images against
+// stored references and the frame against stored performance budgets
+///////////////////////////////////////////////////////////////////////////////
+
+#include "RegressionHarness.h"
+#include "RenderTarget.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+// declaration of global variables
+namespace
+{
+	// files inside the regression directory
+	const char* g_PosesFilename = "poses.txt";
+	const char* g_BudgetsFilename = "budgets.txt";
+	const char* g_ReferenceFolder = "reference";
+	const char* g_OutputFolder = "output";
+
+	// frames rendered before timing, so that lazily compiled
+	// shader variants and driver uploads are not measured
+	const int g_WarmupFrames = 3;
+	// timed frames, the median of which is checked
+	const int g_TimedFrames = 15;
+	// color difference at which a pixel counts as changed,
+	// well above the just noticeable difference of about 2.3
+	const float g_ChangedDeltaE = 5.0f;
+
+	// budget field of a pose that has not been measured yet
+	const char* g_UnmeasuredBudget = "-";
+	// frame time allowed over the measured median when the budgets
+	// are written from a run that updates the references
+	const float g_FrameBudgetHeadroom = 1.2f;
+	// image differences allowed for a pose without a budget, which
+	// cover the rounding differences between drivers
+	const float g_DefaultMeanDeltaE = 1.0f;
+	const float g_DefaultChangedPercent = 0.5f;
+
+	struct LAB_COLOR
+	{
+		float L;
+		float a;
+		float b;
+	};
+
+	float SRGBToLinear(float value)
+	{
+		if (value <= 0.04045f)
+		{
+			return(value / 12.92f);
+		}
+		return(powf((value + 0.055f) / 1.055f, 2.4f));
+	}
+
+	float LabCurve(float t)
+	{
+		if (t > 0.008856f)
+		{
+			return(cbrtf(t));
+		}
+		return(7.787f * t + 16.0f / 116.0f);
+	}
+
+	// convert the image to CIELAB after a 3x3 box filter, so
+	// that single pixel differences in the rasterization of
+	// edges between drivers are not counted as regressions
+	void ConvertToLab(const IMAGE_DATA& image, std::vector<LAB_COLOR>& lab)
+	{
+		static float linearTable[256];
+		static bool bTableReady = false;
+		if (bTableReady == false)
+		{
+			for (int i = 0; i < 256; i++)
+			{
+				linearTable[i] = SRGBToLinear(i / 255.0f);
+			}
+			bTableReady = true;
+		}
+
+		lab.resize((size_t)image.width * image.height);
+		for (int y = 0; y < image.height; y++)
+		{
+			for (int x = 0; x < image.width; x++)
+			{
+				float rgb[3] = { 0.0f, 0.0f, 0.0f };
+				int samples = 0;
+				for (int dy = -1; dy <= 1; dy++)
+				{
+					int sy = std::min(std::max(y + dy, 0), image.height - 1);
+					for (int dx = -1; dx <= 1; dx++)
+					{
+						int sx = std::min(std::max(x + dx, 0), image.width - 1);
+						const unsigned char* pPixel = &image.pixels[((size_t)sy * image.width + sx) * image.channels];
+						rgb[0] += linearTable[pPixel[0]];
+						rgb[1] += linearTable[pPixel[1]];
+						rgb[2] += linearTable[pPixel[2]];
+						samples++;
+					}
+				}
+				float r = rgb[0] / samples;
+				float g = rgb[1] / samples;
+				float b = rgb[2] / samples;
+
+				// linear sRGB to XYZ relative to the D65 white point
+				float fx = LabCurve((0.4124f * r + 0.3576f * g + 0.1805f * b) / 0.95047f);
+				float fy = LabCurve(0.2126f * r + 0.7152f * g + 0.0722f * b);
+				float fz = LabCurve((0.0193f * r + 0.1192f * g + 0.9505f * b) / 1.08883f);
+
+				LAB_COLOR& color = lab[(size_t)y * image.width + x];
+				color.L = 116.0f * fy - 16.0f;
+				color.a = 500.0f * (fx - fy);
+				color.b = 200.0f * (fy - fz);
+			}
+		}
+	}
+
+	// skip blank lines and comments in the text files
+	bool IsContentLine(const std::string& line)
+	{
+		size_t start = line.find_first_not_of(" \t\r");
+		return((start != std::string::npos) && (line[start] != '#'));
+	}
+}
+
+/***********************************************************
+ *  RegressionHarness()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+RegressionHarness::RegressionHarness(
+	ViewManager* pViewManager,
+	SceneManager* pSceneManager,
+	void (*pRenderFrame)())
+{
+	m_pViewManager = pViewManager;
+	m_pSceneManager = pSceneManager;
+	m_pRenderFrame = pRenderFrame;
+}
+
+/***********************************************************
+ *  ~RegressionHarness()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+RegressionHarness::~RegressionHarness()
+{
+	m_pViewManager = NULL;
+	m_pSceneManager = NULL;
+	m_pRenderFrame = NULL;
+}
+
+/***********************************************************
+ *  LoadPoses()
+ *
+ *  This method is used for reading the camera poses.  Each
+ *  line holds the pose name, the projection, the camera
+ *  position and front vector, and the field of view.
+ ***********************************************************/
+bool RegressionHarness::LoadPoses(const std::string& filename)
+{
+	std::ifstream file(filename);
+	if (!file.is_open())
+	{
+		std::cout << "Could not open the regression poses:" << filename << std::endl;
+		return(false);
+	}
+
+	m_poses.clear();
+	std::string line;
+	while (std::getline(file, line))
+	{
+		if (IsContentLine(line) == false)
+		{
+			continue;
+		}
+
+		CAMERA_POSE pose;
+		std::string projection;
+		std::istringstream fields(line);
+		fields >> pose.name >> projection
+			>> pose.position.x >> pose.position.y >> pose.position.z
+			>> pose.front.x >> pose.front.y >> pose.front.z
+			>> pose.zoom;
+		if (fields.fail() || ((projection != "perspective") && (projection != "orthographic")))
+		{
+			std::cout << "Invalid regression pose:" << line << std::endl;
+			return(false);
+		}
+		pose.bOrthographic = (projection == "orthographic");
+		m_poses.push_back(pose);
+	}
+
+	return(m_poses.empty() == false);
+}
+
+/***********************************************************
+ *  LoadBudgets()
+ *
+ *  This method is used for reading the budgets.  Each line
+ *  holds the pose name, the frame time in milliseconds, the
+ *  draw calls, the mean color difference and the percent of
+ *  changed pixels that are allowed.  The frame time and draw
+ *  calls are both - until they have been measured.
+ ***********************************************************/
+bool RegressionHarness::LoadBudgets(const std::string& filename)
+{
+	std::ifstream file(filename);
+	if (!file.is_open())
+	{
+		std::cout << "Could not open the regression budgets:" << filename << std::endl;
+		return(false);
+	}
+
+	m_budgets.clear();
+	std::string line;
+	while (std::getline(file, line))
+	{
+		if (IsContentLine(line) == false)
+		{
+			continue;
+		}
+
+		std::string name;
+		std::string frameField;
+		std::string drawField;
+		POSE_BUDGET budget;
+		std::istringstream fields(line);
+		fields >> name >> frameField >> drawField
+			>> budget.maxMeanDeltaE >> budget.maxChangedPercent;
+
+		budget.bMeasured = (frameField != g_UnmeasuredBudget) || (drawField != g_UnmeasuredBudget);
+		budget.maxFrameMilliseconds = 0.0f;
+		budget.maxDrawCalls = 0;
+		if ((fields.fail() == false) && (budget.bMeasured == true))
+		{
+			std::istringstream values(frameField + " " + drawField);
+			values >> budget.maxFrameMilliseconds >> budget.maxDrawCalls;
+			if (values.fail())
+			{
+				fields.setstate(std::ios::failbit);
+			}
+		}
+		if (fields.fail())
+		{
+			std::cout << "Invalid regression budget:" << line << std::endl;
+			return(false);
+		}
+		m_budgets[name] = budget;
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  MeasureFrameTime()
+ *
+ *  This method is used for timing the frame rendering.  Each
+ *  frame waits for the GPU to finish, and the median is used
+ *  so that a single stall does not fail the run.
+ ***********************************************************/
+float RegressionHarness::MeasureFrameTime()
+{
+	for (int i = 0; i < g_WarmupFrames; i++)
+	{
+		m_pRenderFrame();
+	}
+	glFinish();
+
+	std::vector<float> frameTimes;
+	for (int i = 0; i < g_TimedFrames; i++)
+	{
+		double startTime = glfwGetTime();
+		m_pRenderFrame();
+		glFinish();
+		frameTimes.push_back((float)((glfwGetTime() - startTime) * 1000.0));
+	}
+
+	std::sort(frameTimes.begin(), frameTimes.end());
+	return(frameTimes[frameTimes.size() / 2]);
+}
+
+/***********************************************************
+ *  CompareImages()
+ *
+ *  This method is used for comparing the rendered image with
+ *  its reference by the CIELAB color difference.  The heat
+ *  map shows the scaled difference of every pixel in red.
+ ***********************************************************/
+bool RegressionHarness::CompareImages(
+	const IMAGE_DATA& reference,
+	const IMAGE_DATA& image,
+	float& meanDeltaE,
+	float& changedPercent,
+	IMAGE_DATA& difference)
+{
+	meanDeltaE = 0.0f;
+	changedPercent = 100.0f;
+
+	if ((reference.width != image.width) || (reference.height != image.height))
+	{
+		std::cout << "  reference is " << reference.width << "x" << reference.height
+			<< ", rendered image is " << image.width << "x" << image.height << std::endl;
+		return(false);
+	}
+
+	std::vector<LAB_COLOR> referenceLab;
+	std::vector<LAB_COLOR> imageLab;
+	ConvertToLab(reference, referenceLab);
+	ConvertToLab(image, imageLab);
+
+	difference.width = image.width;
+	difference.height = image.height;
+	difference.channels = 3;
+	difference.pixels.assign((size_t)image.width * image.height * 3, 0);
+
+	double totalDeltaE = 0.0;
+	size_t changedPixels = 0;
+	for (size_t i = 0; i < imageLab.size(); i++)
+	{
+		float dL = imageLab[i].L - referenceLab[i].L;
+		float da = imageLab[i].a - referenceLab[i].a;
+		float db = imageLab[i].b - referenceLab[i].b;
+		float deltaE = sqrtf(dL * dL + da * da + db * db);
+
+		totalDeltaE += deltaE;
+		if (deltaE > g_ChangedDeltaE)
+		{
+			changedPixels++;
+		}
+		difference.pixels[i * 3] = (unsigned char)std::min(deltaE * 10.0f, 255.0f);
+	}
+
+	meanDeltaE = (float)(totalDeltaE / imageLab.size());
+	changedPercent = 100.0f * changedPixels / imageLab.size();
+
+	return(true);
+}
+
+/***********************************************************
+ *  Run()
+ *
+ *  This method is used for rendering every pose into an
+ *  offscreen target and checking the results.  The images of
+ *  failed poses and their difference maps are written to the
+ *  output folder for review.  Updating the references also
+ *  writes budgets measured from the run to the output folder,
+ *  to be reviewed before they replace the stored ones.
+ ***********************************************************/
+int RegressionHarness::Run(const char* directory, bool bUpdateReferences)
+{
+	std::string basePath = std::string(directory) + "/";
+	std::string referencePath = basePath + g_ReferenceFolder + "/";
+	std::string outputPath = basePath + g_OutputFolder + "/";
+
+	if ((LoadPoses(basePath + g_PosesFilename) == false) ||
+		(LoadBudgets(basePath + g_BudgetsFilename) == false))
+	{
+		return(-1);
+	}
+
+	std::error_code error;
+	std::filesystem::create_directories(outputPath, error);
+	std::ofstream measuredBudgets;
+	if (bUpdateReferences == true)
+	{
+		std::filesystem::create_directories(referencePath, error);
+		measuredBudgets.open(outputPath + g_BudgetsFilename);
+		measuredBudgets << "# Budgets measured by --regression-update, with "
+			<< g_FrameBudgetHeadroom << "x the median frame time\n";
+	}
+
+	// render at the size of the window so the aspect ratio of
+	// the projection matches the image
+	int width = 0;
+	int height = 0;
+	m_pViewManager->GetFramebufferSize(width, height);
+
+	RenderTarget target;
+	if (target.Create(width, height) == false)
+	{
+		return(-1);
+	}
+
+	int failures = 0;
+	for (size_t i = 0; i < m_poses.size(); i++)
+	{
+		const CAMERA_POSE& pose = m_poses[i];
+		m_pViewManager->SetCameraPose(pose.position, pose.front, pose.zoom, pose.bOrthographic);
+
+		target.Bind();
+		float frameMilliseconds = MeasureFrameTime();
+		SceneManager::FRAME_STATS stats = m_pSceneManager->GetFrameStats();
+
+		IMAGE_DATA image;
+		image.width = target.GetWidth();
+		image.height = target.GetHeight();
+		image.channels = 4;
+		target.ReadPixels(image.pixels);
+		target.Unbind();
+		ImageIO::FlipRows(image);
+
+		std::string imageFilename = pose.name + ".png";
+		if (bUpdateReferences == true)
+		{
+			ImageIO::WritePNG((referencePath + imageFilename).c_str(), image);
+			printf("UPDATED %-20s frame %6.2f ms  draws %4d\n",
+				pose.name.c_str(), frameMilliseconds, stats.drawCalls);
+
+			// the image tolerances are kept from the stored budget
+			float meanDeltaE = g_DefaultMeanDeltaE;
+			float changedPercent = g_DefaultChangedPercent;
+			std::map<std::string, POSE_BUDGET>::const_iterator stored = m_budgets.find(pose.name);
+			if (stored != m_budgets.end())
+			{
+				meanDeltaE = stored->second.maxMeanDeltaE;
+				changedPercent = stored->second.maxChangedPercent;
+			}
+			measuredBudgets << std::left << std::setw(20) << pose.name << std::right
+				<< std::fixed << std::setprecision(1)
+				<< std::setw(5) << ceilf(frameMilliseconds * g_FrameBudgetHeadroom * 10.0f) / 10.0f
+				<< std::setw(6) << stats.drawCalls
+				<< std::setw(7) << meanDeltaE
+				<< std::setw(7) << changedPercent << "\n";
+			continue;
+		}
+
+		std::map<std::string, POSE_BUDGET>::const_iterator budget = m_budgets.find(pose.name);
+		IMAGE_DATA reference;
+		if (budget == m_budgets.end())
+		{
+			printf("FAIL    %-20s no budget in %s\n", pose.name.c_str(), g_BudgetsFilename);
+			failures++;
+			continue;
+		}
+		if (budget->second.bMeasured == false)
+		{
+			printf("FAIL    %-20s budget not measured, run with --regression-update\n", pose.name.c_str());
+			failures++;
+			continue;
+		}
+		if (ImageIO::ReadImage((referencePath + imageFilename).c_str(), 4, reference) == false)
+		{
+			printf("FAIL    %-20s no reference image, run with --regression-update\n", pose.name.c_str());
+			failures++;
+			continue;
+		}
+
+		float meanDeltaE = 0.0f;
+		float changedPercent = 0.0f;
+		IMAGE_DATA difference;
+		bool bPassed = CompareImages(reference, image, meanDeltaE, changedPercent, difference);
+		bPassed = bPassed &&
+			(meanDeltaE <= budget->second.maxMeanDeltaE) &&
+			(changedPercent <= budget->second.maxChangedPercent) &&
+			(frameMilliseconds <= budget->second.maxFrameMilliseconds) &&
+			(stats.drawCalls <= budget->second.maxDrawCalls);
+
+		printf("%s %-20s frame %6.2f/%6.2f ms  draws %4d/%4d  dE %5.2f/%5.2f  changed %5.2f/%5.2f%%\n",
+			bPassed ? "PASS   " : "FAIL   ",
+			pose.name.c_str(),
+			frameMilliseconds, budget->second.maxFrameMilliseconds,
+			stats.drawCalls, budget->second.maxDrawCalls,
+			meanDeltaE, budget->second.maxMeanDeltaE,
+			changedPercent, budget->second.maxChangedPercent);
+
+		if (bPassed == false)
+		{
+			failures++;
+			ImageIO::WritePNG((outputPath + imageFilename).c_str(), image);
+			if (difference.pixels.empty() == false)
+			{
+				ImageIO::WritePNG((outputPath + pose.name + "_diff.png").c_str(), difference);
+			}
+		}
+	}
+
+	if (bUpdateReferences == false)
+	{
+		printf("%d of %d regression poses failed\n", failures, (int)m_poses.size());
+	}
+	else
+	{
+		printf("Measured budgets written to %s%s\n", outputPath.c_str(), g_BudgetsFilename);
+	}
+
+	return(failures);
+}
@@ -0,0 +1,85 @@
+///////////////////////////////////////////////////////////////////////////////
+// regressionharness.h
+// ============
+// render the scene from fixed camera poses and check the images against
+// stored references and the frame against stored performance budgets
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ImageIO.h"
+#include "SceneManager.h"
+#include "ViewManager.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  RegressionHarness
+ *
+ *  This class renders the scene offscreen from the camera
+ *  poses listed in the regression directory.  Every image is
+ *  compared with its reference using a perceptual color
+ *  difference, and the frame time and draw calls are checked
+ *  against the budgets for the pose.
+ ***********************************************************/
+class RegressionHarness
+{
+public:
+	// constructor - the render function draws one complete frame
+	RegressionHarness(
+		ViewManager* pViewManager,
+		SceneManager* pSceneManager,
+		void (*pRenderFrame)());
+	// destructor
+	~RegressionHarness();
+
+	// render and check all of the poses, or store the rendered
+	// images as the new references - returns the number of
+	// failed poses, or -1 when the run could not be set up
+	int Run(const char* directory, bool bUpdateReferences);
+
+private:
+	struct CAMERA_POSE
+	{
+		std::string name;
+		bool bOrthographic;
+		glm::vec3 position;
+		glm::vec3 front;
+		float zoom;
+	};
+
+	struct POSE_BUDGET
+	{
+		// false until the frame time and draw calls are measured on
+		// the reference machine, which the file shows with a -
+		bool bMeasured;
+		float maxFrameMilliseconds;
+		int maxDrawCalls;
+		// mean CIELAB color difference over the image
+		float maxMeanDeltaE;
+		// percent of pixels with a clearly visible difference
+		float maxChangedPercent;
+	};
+
+	ViewManager* m_pViewManager;
+	SceneManager* m_pSceneManager;
+	void (*m_pRenderFrame)();
+
+	std::vector<CAMERA_POSE> m_poses;
+	std::map<std::string, POSE_BUDGET> m_budgets;
+
+	// read the camera poses and budgets from the text files
+	bool LoadPoses(const std::string& filename);
+	bool LoadBudgets(const std::string& filename);
+	// render the frame repeatedly and return the median time
+	float MeasureFrameTime();
+	// compare the images and build a heat map of the differences
+	bool CompareImages(
+		const IMAGE_DATA& reference,
+		const IMAGE_DATA& image,
+		float& meanDeltaE,
+		float& changedPercent,
+		IMAGE_DATA& difference);
+};
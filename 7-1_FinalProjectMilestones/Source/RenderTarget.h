@@ -0,0 +1,57 @@
+///////////////////////////////////////////////////////////////////////////////
+// rendertarget.h
+// ============
+// manage an offscreen framebuffer with color and depth textures
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "GpuResources.h"
+
+#include <GL/glew.h>
+
+#include <vector>
+
+/***********************************************************
+ *  RenderTarget
+ *
+ *  This class contains an OpenGL framebuffer object with an
+ *  RGBA8 color texture and a 24-bit depth texture, so the
+ *  scene can be rendered without a visible window and the
+ *  results can be read back or sampled.
+ ***********************************************************/
+class RenderTarget
+{
+public:
+	// constructor
+	RenderTarget();
+	// destructor
+	~RenderTarget();
+
+	// create the framebuffer and its textures with the passed in size
+	bool Create(int width, int height);
+	// free the framebuffer and its textures
+	void Destroy();
+
+	// bind the framebuffer for rendering and set the viewport
+	void Bind();
+	// bind the default framebuffer again
+	void Unbind();
+
+	// read the color texture back into the passed in buffer
+	// as RGBA pixels, bottom row first
+	void ReadPixels(std::vector<unsigned char>& pixels);
+
+	GLuint GetFramebuffer() const { return(m_framebuffer.Get()); }
+	GLuint GetColorTexture() const { return(m_colorTexture.Get()); }
+	GLuint GetDepthTexture() const { return(m_depthTexture.Get()); }
+	int GetWidth() const { return(m_width); }
+	int GetHeight() const { return(m_height); }
+
+private:
+	GpuFramebuffer m_framebuffer;
+	GpuTexture m_colorTexture;
+	GpuTexture m_depthTexture;
+	int m_width;
+	int m_height;
+};
@@ -15,15 +15,370 @@
 #endif
 
 #include <glm/gtx/transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <random>
 
 // declaration of global variables
 namespace
 {
-	const char* g_ModelName = "model";
-	const char* g_ColorValueName = "objectColor";
-	const char* g_TextureValueName = "objectTexture";
-	const char* g_UseTextureName = "bUseTexture";
-	const char* g_UseLightingName = "bUseLighting";
+	// view distance covered by the depth bits of the sort keys,
+	// matching the far plane of the scene projection
+	const float g_SortDepthRange = 100.0f;
+
+	// buckets of the GPU-driven draws, which are the untextured
+	// objects and the objects of each of the 16 texture slots
+	const int g_GpuBucketCount = 17;
+
+	// texture slots held in m_textureIDs, one for each texture unit
+	// the scene binds
+	const int g_TextureSlotCount = 16;
+
+	// fewest sorted draws sharing their state that are drawn as
+	// instances rather than one at a time
+	const size_t g_MinInstanceRun = 2;
+
+	// bits of the sort keys left for the texture, material and mesh
+	// ids and the fine depth of the opaque draws, and for the ids of
+	// the transparent draws
+	const int g_OpaqueStateBits = 48;
+	const int g_TransparentStateBits = 32;
+
+	// number of bits that hold every value below the count
+	int CountBits(size_t count)
+	{
+		int bits = 0;
+		while ((bits < 63) && (((size_t)1 << bits) < count))
+		{
+			bits++;
+		}
+		return(bits);
+	}
+
+	// fit the ids into the bits of a key field, keeping the highest
+	// bits when the scene has more ids than fit
+	uint64_t FitStateKey(uint64_t stateKey, int stateBits, int fieldBits)
+	{
+		return((stateBits > fieldBits) ? (stateKey >> (stateBits - fieldBits)) : stateKey);
+	}
+
+	// the low bits of the ids that FitStateKey() leaves out
+	uint64_t GetTieKey(uint64_t stateKey, int stateBits, int fieldBits)
+	{
+		return((stateBits > fieldBits) ? (stateKey & (((uint64_t)1 << (stateBits - fieldBits)) - 1)) : 0);
+	}
+
+	// move the keys and positions into the order of one byte of the
+	// keys, keeping equal bytes in their order - returns false
+	// without moving anything when every key has the same byte
+	bool RadixSortPass(
+		const uint64_t* pKeys,
+		const uint32_t* pOrder,
+		uint64_t* pSortedKeys,
+		uint32_t* pSortedOrder,
+		size_t count,
+		int shift)
+	{
+		size_t offsets[256] = { 0 };
+		for (size_t i = 0; i < count; i++)
+		{
+			offsets[(pKeys[i] >> shift) & 0xFF]++;
+		}
+		if (offsets[(pKeys[0] >> shift) & 0xFF] == count)
+		{
+			return(false);
+		}
+
+		size_t total = 0;
+		for (int digit = 0; digit < 256; digit++)
+		{
+			size_t digitCount = offsets[digit];
+			offsets[digit] = total;
+			total += digitCount;
+		}
+
+		for (size_t i = 0; i < count; i++)
+		{
+			size_t position = offsets[(pKeys[i] >> shift) & 0xFF]++;
+			pSortedKeys[position] = pKeys[i];
+			pSortedOrder[position] = pOrder[i];
+		}
+		return(true);
+	}
+
+	// starting size of the frame arena, enough for the draws of the
+	// hand-built desk - larger scenes grow it during their first frame
+	const size_t g_FrameArenaBytes = 64 * 1024;
+
+	// build the key that finds a texture uploaded from the same
+	// pixels with the same settings, with the FNV-1a hash
+	uint64_t HashTextureContent(
+		const unsigned char* pPixels,
+		int width,
+		int height,
+		int channels,
+		int settings)
+	{
+		uint64_t hash = 14695981039346656037ULL;
+		int32_t fields[4] = { width, height, channels, settings };
+		const unsigned char* pBytes = (const unsigned char*)fields;
+		for (size_t i = 0; i < sizeof(fields); i++)
+		{
+			hash ^= pBytes[i];
+			hash *= 1099511628211ULL;
+		}
+		size_t size = (size_t)width * height * channels;
+		for (size_t i = 0; i < size; i++)
+		{
+			hash ^= pPixels[i];
+			hash *= 1099511628211ULL;
+		}
+		return(hash);
+	}
+
+	// local bounds of the basic shape meshes, by MESH_TYPE
+	const glm::vec3 g_MeshBoundsMin[] =
+	{
+		glm::vec3(-1.0f, 0.0f, -1.0f),
+		glm::vec3(-0.5f, -0.5f, -0.5f),
+		glm::vec3(-1.0f, -1.0f, -1.0f),
+		glm::vec3(-1.0f, 0.0f, -1.0f),
+		glm::vec3(-1.0f, 0.0f, -1.0f)
+	};
+	const glm::vec3 g_MeshBoundsMax[] =
+	{
+		glm::vec3(1.0f, 0.0f, 1.0f),
+		glm::vec3(0.5f, 0.5f, 0.5f),
+		glm::vec3(1.0f, 1.0f, 1.0f),
+		glm::vec3(1.0f, 1.0f, 1.0f),
+		glm::vec3(1.0f, 1.0f, 1.0f)
+	};
+
+	// boxes inside the basic shapes that are rasterized when they
+	// are drawn as occluders, so an occluder never hides more than
+	// the shape covers - the cone is too thin to be an occluder
+	const bool g_MeshHasOccluder[] = { true, true, true, true, false };
+	const glm::vec3 g_MeshOccluderMin[] =
+	{
+		glm::vec3(-1.0f, 0.0f, -1.0f),
+		glm::vec3(-0.5f, -0.5f, -0.5f),
+		glm::vec3(-0.577f, -0.577f, -0.577f),
+		glm::vec3(-0.707f, 0.0f, -0.707f),
+		glm::vec3(0.0f)
+	};
+	const glm::vec3 g_MeshOccluderMax[] =
+	{
+		glm::vec3(1.0f, 0.0f, 1.0f),
+		glm::vec3(0.5f, 0.5f, 0.5f),
+		glm::vec3(0.577f, 0.577f, 0.577f),
+		glm::vec3(0.707f, 1.0f, 0.707f),
+		glm::vec3(0.0f)
+	};
+
+	// materials and textures of the hand-built desk, by DESK_PART
+	const char* g_DefaultDeskMaterials[] =
+	{
+		"deskMaterial",
+		"keyboardMaterial",
+		"keyCapMaterial",
+		"mouseMaterial",
+		"pumpkinMaterial",
+		"pumpkinMaterial"
+	};
+	const char* g_DefaultDeskTextures[] =
+	{
+		"deskTexture",
+		"keyboardBaseTexture",
+		"keyCapTexture",
+		"mouseTexture",
+		"pumpkinTexture",
+		"mouseTexture"
+	};
+
+	// objects added by AddDesk() besides the keys, which are the
+	// surface, keyboard base and trim, mouse and pumpkin parts
+	const int g_DeskObjectsBesideKeys = 7;
+
+	// growth of the spatial index boxes from refitting the moved
+	// objects, past which the index is built again
+	const float g_MaxRefitInflation = 1.5f;
+
+	// size and spacing of the keys, where the spacing is one
+	// key unit of the keyboard layouts
+	const float g_KeyWidth = 0.45f;
+	const float g_KeyHeight = 0.15f;
+	const float g_KeyDepth = 0.45f;
+	const float g_KeySpacing = 0.55f;
+	// space between the keyboard edge and the top left key,
+	// and the least border left around the keys
+	const float g_KeyboardInset = 0.3f;
+	const float g_KeyboardBorder = 0.5f;
+	// distance between the generated desks, leaving an aisle
+	// around the 20 by 10 desk surface
+	const float g_DeskSpacingX = 24.0f;
+	const float g_DeskSpacingZ = 14.0f;
+
+	const char* g_MeshNames[] = { "plane", "box", "sphere", "cylinder", "cone" };
+
+	// farthest distance searched by the picking rays
+	const float g_PickDistance = 1000.0f;
+
+	// the imported model is fitted into this size and stands on the
+	// hand-built desk, behind and to the right of the keyboard
+	const float g_ModelFitSize = 4.0f;
+	const glm::vec3 g_ModelPosition(4.0f, 0.0f, -2.5f);
+
+	// light gray pixel of the texture that the slots hold while
+	// their images are loading
+	const unsigned char g_PlaceholderPixel[4] = { 192, 192, 192, 255 };
+	// time PrepareScene() waits for the assets that finish quickly,
+	// before the first frame is shown with the placeholders
+	const double g_FirstFrameBudgetMilliseconds = 250.0;
+	// time each frame may spend uploading the finished assets, of
+	// which at least one is uploaded every frame
+	const double g_FrameUploadBudgetMilliseconds = 2.0;
+
+	// local bounds of a basic shape or imported mesh
+	void GetMeshLocalBounds(
+		const ImportedMeshes* pImportedMeshes,
+		int mesh,
+		glm::vec3& boundsMin,
+		glm::vec3& boundsMax)
+	{
+		if (mesh < SceneManager::MESH_FIRST_IMPORTED)
+		{
+			boundsMin = g_MeshBoundsMin[mesh];
+			boundsMax = g_MeshBoundsMax[mesh];
+		}
+		else if (NULL != pImportedMeshes)
+		{
+			pImportedMeshes->GetMeshBounds(mesh - SceneManager::MESH_FIRST_IMPORTED, boundsMin, boundsMax);
+		}
+		else
+		{
+			boundsMin = glm::vec3(0.0f);
+			boundsMax = glm::vec3(0.0f);
+		}
+	}
+
+	// world space bounding box of the local bounds transformed by
+	// the model transformation, from the transformed center and
+	// extents
+	BoundingVolumeHierarchy::BOUNDS CalculateWorldBounds(
+		const glm::mat4& model,
+		const glm::vec3& boundsMin,
+		const glm::vec3& boundsMax)
+	{
+		glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+		glm::vec3 extent = (boundsMax - boundsMin) * 0.5f;
+
+		glm::vec3 worldCenter = glm::vec3(model * glm::vec4(center, 1.0f));
+		glm::vec3 worldExtent =
+			glm::abs(glm::vec3(model[0])) * extent.x +
+			glm::abs(glm::vec3(model[1])) * extent.y +
+			glm::abs(glm::vec3(model[2])) * extent.z;
+
+		BoundingVolumeHierarchy::BOUNDS bounds;
+		bounds.minimum = worldCenter - worldExtent;
+		bounds.maximum = worldCenter + worldExtent;
+		return(bounds);
+	}
+
+	// objects and meshes that the picking rays are tested against
+	struct RAY_TEST_CONTEXT
+	{
+		const EntityStore* pEntities;
+		const ImportedMeshes* pImportedMeshes;
+	};
+
+	// exact ray test against a scene object for the spatial index,
+	// in the object space of the entity - the sphere is tested as a
+	// sphere, and the other shapes against their local bounds
+	bool TestRayAgainstEntity(
+		void* pContext,
+		int item,
+		const glm::vec3& origin,
+		const glm::vec3& direction,
+		float& distance)
+	{
+		const RAY_TEST_CONTEXT* pRayContext = (const RAY_TEST_CONTEXT*)pContext;
+		const EntityStore* pEntities = pRayContext->pEntities;
+		const glm::mat4& model = pEntities->GetTransforms()[item];
+		int mesh = pEntities->GetMeshes()[item];
+
+		// the transformation is affine, so distances along the
+		// ray are the same in object space
+		glm::mat4 inverseModel = glm::inverse(model);
+		glm::vec3 localOrigin = glm::vec3(inverseModel * glm::vec4(origin, 1.0f));
+		glm::vec3 localDirection = glm::vec3(inverseModel * glm::vec4(direction, 0.0f));
+
+		if (mesh == SceneManager::MESH_SPHERE)
+		{
+			float a = glm::dot(localDirection, localDirection);
+			float b = glm::dot(localOrigin, localDirection);
+			float c = glm::dot(localOrigin, localOrigin) - 1.0f;
+			float discriminant = b * b - a * c;
+			if ((a <= 0.0f) || (discriminant < 0.0f))
+			{
+				return(false);
+			}
+			float root = std::sqrt(discriminant);
+			float t = (-b - root) / a;
+			if (t < 0.0f)
+			{
+				t = (-b + root) / a;
+			}
+			if (t < 0.0f)
+			{
+				return(false);
+			}
+			distance = t;
+			return(true);
+		}
+
+		glm::vec3 boundsMin;
+		glm::vec3 boundsMax;
+		GetMeshLocalBounds(pRayContext->pImportedMeshes, mesh, boundsMin, boundsMax);
+
+		float tNear = 0.0f;
+		float tFar = FLT_MAX;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			float minimum = boundsMin[axis];
+			float maximum = boundsMax[axis];
+			if (std::fabs(localDirection[axis]) < 1e-8f)
+			{
+				if ((localOrigin[axis] < minimum) || (localOrigin[axis] > maximum))
+				{
+					return(false);
+				}
+				continue;
+			}
+			float t1 = (minimum - localOrigin[axis]) / localDirection[axis];
+			float t2 = (maximum - localOrigin[axis]) / localDirection[axis];
+			tNear = std::max(tNear, std::min(t1, t2));
+			tFar = std::min(tFar, std::max(t1, t2));
+			if (tNear > tFar)
+			{
+				return(false);
+			}
+		}
+		distance = tNear;
+		return(true);
+	}
+
+	// current time for measuring the stages of a frame
+	double GetMilliseconds()
+	{
+		return(std::chrono::duration<double, std::milli>(
+			std::chrono::steady_clock::now().time_since_epoch()).count());
+	}
 }
 
 /***********************************************************
@@ -31,10 +386,93 @@ namespace
  *
  *  The constructor for the class
  ***********************************************************/
-SceneManager::SceneManager(ShaderManager *pShaderManager)
+SceneManager::SceneManager(ShaderVariants *pShaderVariants) :
+	m_frameArena(g_FrameArenaBytes)
 {
-	m_pShaderManager = pShaderManager;
+	m_pShaderVariants = pShaderVariants;
 	m_basicMeshes = new ShapeMeshes();
+	m_pCompactMeshes = NULL;
+	m_bCompactMeshes = false;
+	m_pSoftwareRasterizer = NULL;
+	m_bSoftwareRendering = false;
+	m_softwareThreads = 0;
+	m_pTextureCompressor = NULL;
+	m_bTextureCompression = false;
+	m_loadedTextures = 0;
+
+	for (int i = 0; i < ShaderVariants::TOTAL_LIGHTS; i++)
+	{
+		m_lightSources[i].position = glm::vec3(0.0f);
+		m_lightSources[i].ambientColor = glm::vec3(0.0f);
+		m_lightSources[i].diffuseColor = glm::vec3(0.0f);
+		m_lightSources[i].specularColor = glm::vec3(0.0f);
+		m_lightSources[i].isEnabled = false;
+	}
+	m_bUseLighting = false;
+	m_lightSerial = 1;
+
+	m_viewMatrix = glm::mat4(1.0f);
+	m_projectionMatrix = glm::mat4(1.0f);
+	m_viewPosition = glm::vec3(0.0f);
+	m_viewSerial = 1;
+
+	m_pendingDraw.model = glm::mat4(1.0f);
+	m_pendingDraw.color = glm::vec4(1.0f);
+	m_pendingDraw.uvScale = glm::vec2(1.0f, 1.0f);
+	m_pendingDraw.mesh = MESH_BOX;
+	m_pendingDraw.materialIndex = -1;
+	m_pendingDraw.textureSlot = -1;
+	m_pendingDraw.bUseTexture = false;
+	m_pendingDraw.bTransparent = false;
+	m_pendingDraw.bOccluder = false;
+	m_pendingDraw.variantFlags = 0;
+	m_pendingDraw.sortKey = 0;
+	m_pendingDraw.tieKey = 0;
+
+	m_pDrawQueue = NULL;
+	m_drawCount = 0;
+	m_pDrawOrder = NULL;
+	m_tieKeyBits = 0;
+	m_pInstanceRuns = NULL;
+	m_pInstancedDraws = NULL;
+	m_bInstancedDraws = true;
+	m_bDepthPrepass = false;
+
+	m_frameStats.queuedDraws = 0;
+	m_frameStats.drawCalls = 0;
+	m_frameStats.programChanges = 0;
+	m_frameStats.occlusionCulled = 0;
+	m_frameStats.frustumCulled = 0;
+	m_frameStats.indexMilliseconds = 0.0f;
+	m_frameStats.cullMilliseconds = 0.0f;
+	m_frameStats.sortMilliseconds = 0.0f;
+	m_frameStats.submitMilliseconds = 0.0f;
+	m_frameStats.arenaBytes = 0;
+	m_frameStats.cachedDraws = 0;
+
+	m_bOcclusionCulling = false;
+	m_pGpuCuller = NULL;
+	m_bGpuCulling = false;
+	m_bGpuOcclusion = false;
+	m_gpuObjectSerial = 0;
+	m_pStaticLayer = NULL;
+	m_bStaticLayerCache = false;
+	m_staticLayerDraws = 0;
+	m_objectSerial = 1;
+	m_staticSerial = 1;
+	m_bSpatialRebuild = true;
+	m_pImportedMeshes = NULL;
+	m_modelScale = 0.0f;
+	m_pAssetLoader = NULL;
+	m_bProgressiveLoading = false;
+
+	m_defaultDesk.origin = glm::vec3(0.0f);
+	m_defaultDesk.keyboard = KeyboardLayouts::KEYBOARD_COMPACT;
+	for (int i = 0; i < DESK_PART_COUNT; i++)
+	{
+		m_defaultDesk.materialTags[i] = g_DefaultDeskMaterials[i];
+		m_defaultDesk.textureTags[i] = g_DefaultDeskTextures[i];
+	}
 }
 
 /***********************************************************
@@ -44,9 +482,52 @@ SceneManager::SceneManager(ShaderManager *pShaderManager)
  ***********************************************************/
 SceneManager::~SceneManager()
 {
-	m_pShaderManager = NULL;
+	// the loader thread may still be using the texture compressor
+	if (NULL != m_pAssetLoader)
+	{
+		delete m_pAssetLoader;
+		m_pAssetLoader = NULL;
+	}
+	DestroyGLTextures();
+	m_placeholderTexture.reset();
+	m_pShaderVariants = NULL;
 	delete m_basicMeshes;
 	m_basicMeshes = NULL;
+	if (NULL != m_pCompactMeshes)
+	{
+		delete m_pCompactMeshes;
+		m_pCompactMeshes = NULL;
+	}
+	if (NULL != m_pSoftwareRasterizer)
+	{
+		delete m_pSoftwareRasterizer;
+		m_pSoftwareRasterizer = NULL;
+	}
+	if (NULL != m_pTextureCompressor)
+	{
+		delete m_pTextureCompressor;
+		m_pTextureCompressor = NULL;
+	}
+	if (NULL != m_pGpuCuller)
+	{
+		delete m_pGpuCuller;
+		m_pGpuCuller = NULL;
+	}
+	if (NULL != m_pInstancedDraws)
+	{
+		delete m_pInstancedDraws;
+		m_pInstancedDraws = NULL;
+	}
+	if (NULL != m_pImportedMeshes)
+	{
+		delete m_pImportedMeshes;
+		m_pImportedMeshes = NULL;
+	}
+	if (NULL != m_pStaticLayer)
+	{
+		delete m_pStaticLayer;
+		m_pStaticLayer = NULL;
+	}
 }
 
 /***********************************************************
@@ -55,14 +536,61 @@ SceneManager::~SceneManager()
  *  This method is used for loading textures from image files,
  *  configuring the texture mapping parameters in OpenGL,
  *  generating the mipmaps, and loading the read texture into
- *  the next available texture slot in memory.
+ *  the next available texture slot in memory.  With texture
+ *  compression enabled the image and its mipmaps are encoded
+ *  in the passed in format and quality instead.  An image
+ *  that is already in video memory with the same settings,
+ *  under another tag, shares that texture.  With progressive
+ *  loading the slot holds the placeholder texture until the
+ *  image is decoded in the background and swapped in.
+ ***********************************************************/
+bool SceneManager::CreateGLTexture(
+	const char* filename,
+	const char* tag,
+	TextureCompressor::TEXTURE_FORMAT format,
+	TextureCompressor::QUALITY quality)
+{
+	if (NULL != m_pAssetLoader)
+	{
+		return(QueueTexture(filename, tag, format, quality));
+	}
+
+	if (m_loadedTextures >= g_TextureSlotCount)
+	{
+		std::cout << "Could not load texture " << filename << ", all "
+			<< g_TextureSlotCount << " texture slots are in use" << std::endl;
+		return false;
+	}
+
+	DECODED_TEXTURE decoded;
+	if (DecodeTexture(filename, format, quality, decoded) == false)
+	{
+		// Error loading the image
+		return false;
+	}
+
+	InstallTexture(decoded, m_loadedTextures, tag);
+	m_loadedTextures++;
+
+	return true;
+}
+
+/***********************************************************
+ *  DecodeTexture()
+ *
+ *  This method is used for reading the pixels of the image
+ *  file and the key of the texture they make.  It makes no
+ *  OpenGL calls, so it can run on the asset loader thread.
  ***********************************************************/
-bool SceneManager::CreateGLTexture(const char* filename, std::string tag)
+bool SceneManager::DecodeTexture(
+	const char* filename,
+	TextureCompressor::TEXTURE_FORMAT format,
+	TextureCompressor::QUALITY quality,
+	DECODED_TEXTURE& decoded)
 {
 	int width = 0;
 	int height = 0;
 	int colorChannels = 0;
-	GLuint textureID = 0;
 
 	// indicate to always flip images vertically when loaded
 	stbi_set_flip_vertically_on_load(true);
@@ -75,13 +603,99 @@ bool SceneManager::CreateGLTexture(const char* filename, std::string tag)
 		&colorChannels,
 		0);
 
-	// if the image was successfully read from the image file
-	if (image)
+	if (!image)
+	{
+		std::cout << "Could not load image:" << filename << std::endl;
+		return false;
+	}
+
+	std::cout << "Successfully loaded image:" << filename << ", width:" << width << ", height:" << height << ", channels:" << colorChannels << std::endl;
+
+	if ((colorChannels != 3) && (colorChannels != 4))
+	{
+		std::cout << "Not implemented to handle image with " << colorChannels << " channels" << std::endl;
+		stbi_image_free(image);
+		return false;
+	}
+
+	decoded.filename = filename;
+	decoded.pixels.assign(image, image + (size_t)width * height * colorChannels);
+	decoded.width = width;
+	decoded.height = height;
+	decoded.channels = colorChannels;
+	decoded.format = format;
+	decoded.quality = quality;
+	decoded.bEncodeTried = false;
+	decoded.bEncoded = false;
+	decoded.compressed.format = TextureCompressor::FORMAT_UNCOMPRESSED;
+
+	// free the image data from local memory
+	stbi_image_free(image);
+
+	// note whether any of the pixels are see-through, so that the
+	// draws using the texture are rendered in the transparent pass
+	decoded.bHasAlpha = false;
+	if (colorChannels == 4)
+	{
+		for (int i = 3; (i < width * height * 4) && (decoded.bHasAlpha == false); i += 4)
+		{
+			decoded.bHasAlpha = (decoded.pixels[i] < 255);
+		}
+	}
+
+	// the settings that change the uploaded texture are part of
+	// the key, so the same image is not shared across formats
+	int settings = (NULL != m_pTextureCompressor) ? (((int)format << 8) | ((int)quality << 1) | 1) : 0;
+	decoded.contentKey = HashTextureContent(decoded.pixels.data(), width, height, colorChannels, settings);
+
+	return true;
+}
+
+/***********************************************************
+ *  EncodeTexture()
+ *
+ *  This method is used for encoding the decoded image and its
+ *  mipmaps, when texture compression is enabled.  Like the
+ *  decoding, it can run on the asset loader thread.
+ ***********************************************************/
+void SceneManager::EncodeTexture(DECODED_TEXTURE& decoded)
+{
+	decoded.bEncodeTried = true;
+	decoded.bEncoded = false;
+	decoded.compressed.format = TextureCompressor::FORMAT_UNCOMPRESSED;
+	if ((NULL != m_pTextureCompressor) &&
+		(m_pTextureCompressor->Compress(
+			decoded.pixels.data(),
+			decoded.width,
+			decoded.height,
+			decoded.channels,
+			decoded.bHasAlpha,
+			decoded.format,
+			decoded.quality,
+			decoded.compressed) == true))
 	{
-		std::cout << "Successfully loaded image:" << filename << ", width:" << width << ", height:" << height << ", channels:" << colorChannels << std::endl;
+		decoded.bEncoded = true;
+	}
+}
 
-		glGenTextures(1, &textureID);
-		glBindTexture(GL_TEXTURE_2D, textureID);
+/***********************************************************
+ *  InstallTexture()
+ *
+ *  This method is used for uploading the decoded image, or
+ *  sharing the texture already uploaded from the same pixels,
+ *  and registering it in the texture slot with the tag.
+ ***********************************************************/
+void SceneManager::InstallTexture(DECODED_TEXTURE& decoded, int slot, const char* tag)
+{
+	std::shared_ptr<GpuTexture> texture = GpuResources::FindSharedTexture(decoded.contentKey);
+	if (texture)
+	{
+		std::cout << "Sharing the texture already loaded from the same image for:" << tag << std::endl;
+	}
+	else
+	{
+		texture = std::make_shared<GpuTexture>();
+		glBindTexture(GL_TEXTURE_2D, texture->Create(tag));
 
 		// set the texture wrapping parameters
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
@@ -90,37 +704,160 @@ bool SceneManager::CreateGLTexture(const char* filename, std::string tag)
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-		// if the loaded image is in RGB format
-		if (colorChannels == 3)
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
-		// if the loaded image is in RGBA format - it supports transparency
-		else if (colorChannels == 4)
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
+		// upload the encoded blocks with their own mipmaps, unless
+		// the driver cannot sample the format
+		if (decoded.bEncodeTried == false)
+		{
+			EncodeTexture(decoded);
+		}
+		if (decoded.bEncoded == true)
+		{
+			m_pTextureCompressor->ReportTexture(decoded.filename.c_str(), decoded.width, decoded.height, decoded.compressed);
+		}
+
+		const TextureCompressor::COMPRESSED_TEXTURE& compressed = decoded.compressed;
+		if (compressed.format != TextureCompressor::FORMAT_UNCOMPRESSED)
+		{
+			TextureCompressor::Upload(compressed);
+			size_t bytes = 0;
+			for (size_t level = 0; level < compressed.levels.size(); level++)
+			{
+				bytes += compressed.levels[level].blocks.size();
+			}
+			texture->SetBytes(bytes);
+		}
 		else
 		{
-			std::cout << "Not implemented to handle image with " << colorChannels << " channels" << std::endl;
-			return false;
+			// if the loaded image is in RGB format
+			if (decoded.channels == 3)
+				glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, decoded.width, decoded.height, 0, GL_RGB, GL_UNSIGNED_BYTE, decoded.pixels.data());
+			// if the loaded image is in RGBA format - it supports transparency
+			else
+				glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, decoded.width, decoded.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, decoded.pixels.data());
+
+			// generate the texture mipmaps for mapping textures to lower resolutions
+			glGenerateMipmap(GL_TEXTURE_2D);
+
+			// drivers store both formats with four bytes per pixel,
+			// and the mipmaps add a third
+			texture->SetBytes((size_t)decoded.width * decoded.height * 4 * 4 / 3);
 		}
 
-		// generate the texture mipmaps for mapping textures to lower resolutions
-		glGenerateMipmap(GL_TEXTURE_2D);
+		GpuResources::AddSharedTexture(decoded.contentKey, texture);
+	}
 
-		// free the image data from local memory
-		stbi_image_free(image);
-		glBindTexture(GL_TEXTURE_2D, 0); // Unbind the texture
+	// the software rasterizer samples its own copy of the pixels
+	if (NULL != m_pSoftwareRasterizer)
+	{
+		m_pSoftwareRasterizer->SetTexture(slot, decoded.width, decoded.height, decoded.channels, decoded.pixels.data());
+	}
+
+	glBindTexture(GL_TEXTURE_2D, 0); // Unbind the texture
+
+	// register the loaded texture and associate it with the special tag string
+	m_textureIDs[slot].ID = texture->Get();
+	m_textureIDs[slot].tag = tag;
+	m_textureIDs[slot].bHasAlpha = decoded.bHasAlpha;
+	m_textureIDs[slot].texture = texture;
+}
 
-		// register the loaded texture and associate it with the special tag string
-		m_textureIDs[m_loadedTextures].ID = textureID;
-		m_textureIDs[m_loadedTextures].tag = tag;
-		m_loadedTextures++;
+/***********************************************************
+ *  QueueTexture()
+ *
+ *  This method is used for filling the next texture slot with
+ *  the placeholder texture, and queueing the image file on the
+ *  asset loader.  Once it is decoded, the texture replaces the
+ *  placeholder in the slot and on its texture unit, and the
+ *  objects using it move to the transparent pass when some of
+ *  its pixels are see-through.  The image is not queued when
+ *  every texture slot is taken.
+ ***********************************************************/
+bool SceneManager::QueueTexture(
+	const char* filename,
+	const char* tag,
+	TextureCompressor::TEXTURE_FORMAT format,
+	TextureCompressor::QUALITY quality)
+{
+	if (m_loadedTextures >= g_TextureSlotCount)
+	{
+		std::cout << "Could not queue texture " << filename << ", all "
+			<< g_TextureSlotCount << " texture slots are in use" << std::endl;
+		return false;
+	}
 
-		return true;
+	int slot = m_loadedTextures;
+	m_textureIDs[slot].ID = m_placeholderTexture->Get();
+	m_textureIDs[slot].tag = tag;
+	m_textureIDs[slot].bHasAlpha = false;
+	m_textureIDs[slot].texture = m_placeholderTexture;
+	if (NULL != m_pSoftwareRasterizer)
+	{
+		m_pSoftwareRasterizer->SetTexture(slot, 1, 1, 4, g_PlaceholderPixel);
 	}
+	m_loadedTextures++;
+
+	std::shared_ptr<DECODED_TEXTURE> decoded = std::make_shared<DECODED_TEXTURE>();
+	std::string file = filename;
+	std::string name = tag;
+	m_pAssetLoader->Queue(
+		filename,
+		[this, decoded, file, format, quality]()
+		{
+			if (DecodeTexture(file.c_str(), format, quality, *decoded) == true)
+			{
+				EncodeTexture(*decoded);
+			}
+		},
+		[this, decoded, slot, name]()
+		{
+			// the placeholder stays when the image could not be read
+			if (decoded->pixels.empty() == true)
+			{
+				return(AssetLoader::INSTALL_FAILED);
+			}
+
+			// the upload leaves the active unit unbound, so all of
+			// the units are bound again
+			InstallTexture(*decoded, slot, name.c_str());
+			BindGLTextures();
+
+			if (decoded->bHasAlpha == true)
+			{
+				const int* pTextures = m_entities.GetTextures();
+				const unsigned int* pFlags = m_entities.GetFlags();
+				for (int i = 0; i < m_entities.GetCount(); i++)
+				{
+					if (((pFlags[i] & EntityStore::ENTITY_TEXTURED) != 0) && (pTextures[i] == slot))
+					{
+						m_entities.AddFlags(m_entities.GetHandle(i), EntityStore::ENTITY_TRANSPARENT);
+					}
+				}
+				m_objectSerial++;
+			}
+			m_staticSerial++;
+			return(AssetLoader::INSTALL_FINISHED);
+		});
 
-	std::cout << "Could not load image:" << filename << std::endl;
+	return true;
+}
 
-	// Error loading the image
-	return false;
+/***********************************************************
+ *  CreatePlaceholderTexture()
+ *
+ *  This method is used for uploading the 1x1 texture that the
+ *  texture slots hold while their images are loading.
+ ***********************************************************/
+void SceneManager::CreatePlaceholderTexture()
+{
+	m_placeholderTexture = std::make_shared<GpuTexture>();
+	glBindTexture(GL_TEXTURE_2D, m_placeholderTexture->Create("placeholder texture"));
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, g_PlaceholderPixel);
+	m_placeholderTexture->SetBytes(4);
+	glBindTexture(GL_TEXTURE_2D, 0);
 }
 
 /***********************************************************
@@ -143,14 +880,19 @@ void SceneManager::BindGLTextures()
  *  DestroyGLTextures()
  *
  *  This method is used for freeing the memory in all the
- *  used texture memory slots.
+ *  used texture memory slots.  A texture shared by several
+ *  tags is deleted with the last of them.
  ***********************************************************/
 void SceneManager::DestroyGLTextures()
 {
 	for (int i = 0; i < m_loadedTextures; i++)
 	{
-		glGenTextures(1, &m_textureIDs[i].ID);
+		m_textureIDs[i].texture.reset();
+		m_textureIDs[i].ID = 0;
+		m_textureIDs[i].tag.clear();
+		m_textureIDs[i].bHasAlpha = false;
 	}
+	m_loadedTextures = 0;
 }
 
 /***********************************************************
@@ -159,7 +901,7 @@ void SceneManager::DestroyGLTextures()
  *  This method is used for getting an ID for the previously
  *  loaded texture bitmap associated with the passed in tag.
  ***********************************************************/
-int SceneManager::FindTextureID(std::string tag)
+int SceneManager::FindTextureID(const char* tag)
 {
 	int textureID = -1;
 	int index = 0;
@@ -167,7 +909,7 @@ int SceneManager::FindTextureID(std::string tag)
 
 	while ((index < m_loadedTextures) && (bFound == false))
 	{
-		if (m_textureIDs[index].tag.compare(tag) == 0)
+		if (strcmp(m_textureIDs[index].tag.c_str(), tag) == 0)
 		{
 			textureID = m_textureIDs[index].ID;
 			bFound = true;
@@ -185,7 +927,7 @@ int SceneManager::FindTextureID(std::string tag)
  *  This method is used for getting a slot index for the previously
  *  loaded texture bitmap associated with the passed in tag.
  ***********************************************************/
-int SceneManager::FindTextureSlot(std::string tag)
+int SceneManager::FindTextureSlot(const char* tag)
 {
 	int textureSlot = -1;
 	int index = 0;
@@ -193,7 +935,7 @@ int SceneManager::FindTextureSlot(std::string tag)
 
 	while ((index < m_loadedTextures) && (bFound == false))
 	{
-		if (m_textureIDs[index].tag.compare(tag) == 0)
+		if (strcmp(m_textureIDs[index].tag.c_str(), tag) == 0)
 		{
 			textureSlot = index;
 			bFound = true;
@@ -211,7 +953,7 @@ int SceneManager::FindTextureSlot(std::string tag)
  *  This method is used for getting a material from the previously
  *  defined materials list that is associated with the passed in tag.
  ***********************************************************/
-bool SceneManager::FindMaterial(std::string tag, OBJECT_MATERIAL& material)
+bool SceneManager::FindMaterial(const char* tag, OBJECT_MATERIAL& material)
 {
 	if (m_objectMaterials.size() == 0)
 	{
@@ -222,7 +964,7 @@ bool SceneManager::FindMaterial(std::string tag, OBJECT_MATERIAL& material)
 	bool bFound = false;
 	while ((index < m_objectMaterials.size()) && (bFound == false))
 	{
-		if (m_objectMaterials[index].tag.compare(tag) == 0)
+		if (strcmp(m_objectMaterials[index].tag.c_str(), tag) == 0)
 		{
 			bFound = true;
 			material.ambientColor = m_objectMaterials[index].ambientColor;
@@ -240,11 +982,31 @@ bool SceneManager::FindMaterial(std::string tag, OBJECT_MATERIAL& material)
 	return(true);
 }
 
+/***********************************************************
+ *  FindMaterialIndex()
+ *
+ *  This method is used for getting the index of the defined
+ *  material that is associated with the passed in tag.
+ ***********************************************************/
+int SceneManager::FindMaterialIndex(const char* tag)
+{
+	for (int index = 0; index < (int)m_objectMaterials.size(); index++)
+	{
+		if (strcmp(m_objectMaterials[index].tag.c_str(), tag) == 0)
+		{
+			return(index);
+		}
+	}
+
+	return(-1);
+}
+
 /***********************************************************
  *  SetTransformations()
  *
  *  This method is used for setting the transform buffer
- *  using the passed in transformation values.
+ *  using the passed in transformation values.  The result is
+ *  kept with the settings for the next queued draw.
  ***********************************************************/
 void SceneManager::SetTransformations(
 	glm::vec3 scaleXYZ,
@@ -272,17 +1034,15 @@ void SceneManager::SetTransformations(
 
 	modelView = translation * rotationX * rotationY * rotationZ * scale;
 
-	if (NULL != m_pShaderManager)
-	{
-		m_pShaderManager->setMat4Value(g_ModelName, modelView);
-	}
+	m_pendingDraw.model = modelView;
 }
 
 /***********************************************************
  *  SetShaderColor()
  *
  *  This method is used for setting the passed in color
- *  into the shader for the next draw command
+ *  into the shader for the next draw command.  Colored draws
+ *  use the shader variant without texturing.
  ***********************************************************/
 void SceneManager::SetShaderColor(
 	float redColorValue,
@@ -298,11 +1058,8 @@ void SceneManager::SetShaderColor(
 	currentColor.b = blueColorValue;
 	currentColor.a = alphaValue;
 
-	if (NULL != m_pShaderManager)
-	{
-		m_pShaderManager->setIntValue(g_UseTextureName, false);
-		m_pShaderManager->setVec4Value(g_ColorValueName, currentColor);
-	}
+	m_pendingDraw.bUseTexture = false;
+	m_pendingDraw.color = currentColor;
 }
 
 /***********************************************************
@@ -312,16 +1069,14 @@ void SceneManager::SetShaderColor(
  *  associated with the passed in ID into the shader.
  ***********************************************************/
 void SceneManager::SetShaderTexture(
-	std::string textureTag)
+	const char* textureTag)
 {
-	if (NULL != m_pShaderManager)
-	{
-		m_pShaderManager->setIntValue(g_UseTextureName, true);
+	int textureSlot = -1;
+	textureSlot = FindTextureSlot(textureTag);
 
-		int textureID = -1;
-		textureID = FindTextureSlot(textureTag);
-		m_pShaderManager->setSampler2DValue(g_TextureValueName, textureID);
-	}
+	// a missing texture falls back to the current color
+	m_pendingDraw.bUseTexture = (textureSlot >= 0);
+	m_pendingDraw.textureSlot = textureSlot;
 }
 
 /***********************************************************
@@ -332,10 +1087,7 @@ void SceneManager::SetShaderTexture(
  ***********************************************************/
 void SceneManager::SetTextureUVScale(float u, float v)
 {
-	if (NULL != m_pShaderManager)
-	{
-		m_pShaderManager->setVec2Value("UVscale", glm::vec2(u, v));
-	}
+	m_pendingDraw.uvScale = glm::vec2(u, v);
 }
 
 /***********************************************************
@@ -345,98 +1097,1503 @@ void SceneManager::SetTextureUVScale(float u, float v)
  *  into the shader.
  ***********************************************************/
 void SceneManager::SetShaderMaterial(
-	std::string materialTag)
+	const char* materialTag)
 {
 	if (m_objectMaterials.size() > 0)
 	{
-		OBJECT_MATERIAL material;
-		bool bReturn = false;
-
-		bReturn = FindMaterial(materialTag, material);
-		if (bReturn == true)
-		{
-			m_pShaderManager->setVec3Value("material.ambientColor", material.ambientColor);
-			m_pShaderManager->setFloatValue("material.ambientStrength", material.ambientStrength);
-			m_pShaderManager->setVec3Value("material.diffuseColor", material.diffuseColor);
-			m_pShaderManager->setVec3Value("material.specularColor", material.specularColor);
-			m_pShaderManager->setFloatValue("material.shininess", material.shininess);
-		}
+		m_pendingDraw.materialIndex = FindMaterialIndex(materialTag);
 	}
 }
-/**************************************************************/
-/*** STUDENTS CAN MODIFY the code in the methods BELOW for  ***/
-/*** preparing and rendering their own 3D replicated scenes.***/
-/*** Please refer to the code in the OpenGL sample project  ***/
-/*** for assistance.                                        ***/
-/**************************************************************/
 
- /***********************************************************
-  *  LoadSceneTextures()
-  *
-  *  This method is used for preparing the 3D scene by loading
-  *  the shapes, textures in memory to support the 3D scene
-  *  rendering
-  ***********************************************************/
-void SceneManager::LoadSceneTextures()
+/***********************************************************
+ *  SetSceneView()
+ *
+ *  This method is used for setting the view and projection
+ *  that the queued draws are rendered with.  The values are
+ *  uploaded into each shader variant before it is used.
+ ***********************************************************/
+void SceneManager::SetSceneView(
+	const glm::mat4& view,
+	const glm::mat4& projection,
+	const glm::vec3& viewPosition)
 {
-	// Load wood texture for the desk
-	if (!CreateGLTexture("textures/dark_wood.jpg", "deskTexture"))
-	{
-		std::cout << "Failed to load desk wood texture!" << std::endl;
-	}
+	m_viewMatrix = view;
+	m_projectionMatrix = projection;
+	m_viewPosition = viewPosition;
+	m_viewSerial++;
+}
 
-	// Load texture for keyboard base
-	if (!CreateGLTexture("textures/black_plastic.jpg", "keyboardBaseTexture"))
+/***********************************************************
+ *  AddSceneObject()
+ *
+ *  This method is used for adding an object to the scene that
+ *  draws the passed in mesh with the current shader settings.
+ *  The objects are kept until the scene is regenerated, and
+ *  are drawn every frame by QueueSceneDraws().
+ ***********************************************************/
+EntityStore::ENTITY_HANDLE SceneManager::AddSceneObject(int mesh, bool bOccluder)
+{
+	glm::vec3 boundsMin;
+	glm::vec3 boundsMax;
+	GetMeshLocalBounds(m_pImportedMeshes, mesh, boundsMin, boundsMax);
+	BoundingVolumeHierarchy::BOUNDS bounds = CalculateWorldBounds(m_pendingDraw.model, boundsMin, boundsMax);
+
+	EntityStore::ENTITY_DESC desc;
+	desc.transform = m_pendingDraw.model;
+	desc.boundsMin = bounds.minimum;
+	desc.boundsMax = bounds.maximum;
+	desc.mesh = mesh;
+	desc.material = m_pendingDraw.materialIndex;
+	desc.texture = m_pendingDraw.textureSlot;
+	desc.uvScale = m_pendingDraw.uvScale;
+	desc.color = m_pendingDraw.color;
+	desc.flags = 0;
+	if (bOccluder == true)
 	{
-		std::cout << "Failed to load keyboard base texture!" << std::endl;
+		desc.flags |= EntityStore::ENTITY_OCCLUDER;
 	}
 
-	// Load texture for keyboard keys
-	if (!CreateGLTexture("textures/white_plastic.jpg", "keyCapTexture"))
+	bool bTransparent = false;
+	if (m_pendingDraw.bUseTexture == true)
 	{
-		std::cout << "Failed to load key cap texture!" << std::endl;
+		desc.flags |= EntityStore::ENTITY_TEXTURED;
+		bTransparent = m_textureIDs[m_pendingDraw.textureSlot].bHasAlpha;
 	}
-
-	// Load mouse texture
-	if (!CreateGLTexture("textures/key_surface.jpg", "mouseTexture"))
+	else
 	{
-		std::cout << "Failed to load mouse texture!" << std::endl;
+		bTransparent = (m_pendingDraw.color.a < 1.0f);
 	}
-
-	// Load Halloween gadget texture (pumpkin pattern)
-	if (!CreateGLTexture("textures/pumpkin.jpg", "pumpkinTexture"))
+	if (bTransparent == true)
 	{
-		std::cout << "Failed to load pumpkin texture!" << std::endl;
+		desc.flags |= EntityStore::ENTITY_TRANSPARENT;
 	}
 
-	// Bind the loaded textures to OpenGL texture slots
-	BindGLTextures();
+	m_objectSerial++;
+	m_staticSerial++;
+	m_bSpatialRebuild = true;
+	return(m_entities.Add(desc));
 }
 
 /***********************************************************
- *  DefineObjectMaterials()
+ *  QueueSceneDraws()
  *
- *  This method is used for configuring the various material
- *  settings for all of the objects within the 3D scene.
+ *  This method is used for queueing a draw of every object,
+ *  streaming through the component arrays of the entities.
+ *  Opaque draws are sorted by shader variant, then roughly
+ *  front to back, then by texture, material and mesh.
+ *  Transparent draws come after all opaque draws and are
+ *  strictly sorted back to front.  The ids of the textures,
+ *  materials and meshes get as many bits of the key as the
+ *  scene needs, and the fine depth of the opaque draws keeps
+ *  the bits that are left.  When a scene has more ids than
+ *  fit, the key keeps their highest bits and the rest go into
+ *  the tie key, which SortDrawQueue() orders the draws that
+ *  share a key by, so draws with different state are still
+ *  never mixed.  The opaque basic shapes are left out when
+ *  the GPU culler draws them, and only the objects of the
+ *  passed in layer are queued.
  ***********************************************************/
-void SceneManager::DefineObjectMaterials()
+void SceneManager::QueueSceneDraws(DRAW_LAYER layer)
 {
-	// Desk material - polished wood surface
-	OBJECT_MATERIAL deskMaterial;
-	deskMaterial.tag = "deskMaterial";
-	deskMaterial.ambientStrength = 0.3f;
-	deskMaterial.ambientColor = glm::vec3(0.5f, 0.35f, 0.2f);    // Dark wood color
-	deskMaterial.diffuseColor = glm::vec3(0.6f, 0.45f, 0.3f);    // Medium wood color
-	deskMaterial.specularColor = glm::vec3(0.7f, 0.7f, 0.7f);    // Polished wood reflection
-	deskMaterial.shininess = 32.0f;                              // Moderately polished
-	m_objectMaterials.push_back(deskMaterial);
+	int count = m_entities.GetCount();
+	const glm::mat4* pTransforms = m_entities.GetTransforms();
+	const int* pMeshes = m_entities.GetMeshes();
+	const int* pMaterials = m_entities.GetMaterials();
+	const int* pTextures = m_entities.GetTextures();
+	const glm::vec2* pUVScales = m_entities.GetUVScales();
+	const glm::vec4* pColors = m_entities.GetColors();
+	const unsigned int* pFlags = m_entities.GetFlags();
+
+	// the queue only lives until the end of the frame, so it is
+	// taken from the arena rather than the heap
+	m_pDrawQueue = m_frameArena.AllocateArray<DRAW_COMMAND>(count);
+	m_drawCount = 0;
+	m_pDrawOrder = NULL;
+	m_pInstanceRuns = NULL;
+	bool bGpuOpaque = (NULL != m_pGpuCuller);
+
+	int meshCount = MESH_FIRST_IMPORTED + ((NULL != m_pImportedMeshes) ? m_pImportedMeshes->GetMeshCount() : 0);
+	int textureBits = CountBits(g_GpuBucketCount);
+	int materialBits = CountBits(m_objectMaterials.size() + 1);
+	int meshBits = CountBits(meshCount);
+	int stateBits = textureBits + materialBits + meshBits;
+	int fineDepthBits = std::max(g_OpaqueStateBits - stateBits, 0);
+	uint64_t fineDepthMax = ((uint64_t)1 << fineDepthBits) - 1;
+	m_tieKeyBits = std::max(stateBits - g_TransparentStateBits, 0);
+
+	for (int i = 0; i < count; i++)
+	{
+		if ((bGpuOpaque == true) && ((pFlags[i] & EntityStore::ENTITY_TRANSPARENT) == 0) &&
+			(pMeshes[i] < MESH_FIRST_IMPORTED))
+		{
+			continue;
+		}
 
-	// Keyboard base material - plastic with slight reflection
-	OBJECT_MATERIAL keyboardMaterial;
-	keyboardMaterial.tag = "keyboardMaterial";
-	keyboardMaterial.ambientStrength = 0.2f;
-	keyboardMaterial.ambientColor = glm::vec3(0.2f, 0.2f, 0.2f);   // Dark plastic
-	keyboardMaterial.diffuseColor = glm::vec3(0.3f, 0.3f, 0.3f);   // Black plastic
+		// the transparent objects are blended over whatever is
+		// drawn behind them, so they are never cached
+		bool bStatic = ((pFlags[i] & (EntityStore::ENTITY_TRANSPARENT | EntityStore::ENTITY_DYNAMIC)) == 0);
+		if (((layer == DRAW_STATIC) && (bStatic == false)) ||
+			((layer == DRAW_DYNAMIC) && (bStatic == true)))
+		{
+			continue;
+		}
+
+		DRAW_COMMAND command;
+		command.model = pTransforms[i];
+		command.color = pColors[i];
+		command.uvScale = pUVScales[i];
+		command.mesh = pMeshes[i];
+		command.materialIndex = pMaterials[i];
+		command.textureSlot = pTextures[i];
+		command.bUseTexture = ((pFlags[i] & EntityStore::ENTITY_TEXTURED) != 0);
+		command.bTransparent = ((pFlags[i] & EntityStore::ENTITY_TRANSPARENT) != 0);
+		command.bOccluder = ((pFlags[i] & EntityStore::ENTITY_OCCLUDER) != 0);
+
+		command.variantFlags = 0;
+		if (command.bUseTexture == true)
+		{
+			command.variantFlags |= ShaderVariants::VARIANT_TEXTURE;
+		}
+		if (m_bUseLighting == true)
+		{
+			command.variantFlags |= ShaderVariants::VARIANT_LIGHTING;
+		}
+		// the imported meshes only have float vertices
+		if ((NULL != m_pCompactMeshes) && (command.mesh < MESH_FIRST_IMPORTED))
+		{
+			command.variantFlags |= ShaderVariants::VARIANT_COMPACT_VERTICES;
+		}
+
+		// distance of the object origin along the view direction
+		glm::vec4 viewOrigin = m_viewMatrix * command.model[3];
+		float depth = glm::clamp(-viewOrigin.z / g_SortDepthRange, 0.0f, 1.0f);
+
+		uint64_t variantKey = command.variantFlags & 0x7F;
+		uint64_t textureKey = (command.bUseTexture == true) ? command.textureSlot + 1 : 0;
+		uint64_t materialKey = command.materialIndex + 1;
+		uint64_t meshKey = command.mesh;
+		uint64_t stateKey = (((textureKey << materialBits) | materialKey) << meshBits) | meshKey;
+
+		if (command.bTransparent == false)
+		{
+			// the coarse depth buckets are finer close to the camera,
+			// where most of the occluding surfaces are
+			uint64_t depthBucket = (uint64_t)(std::sqrt(depth) * 0xFF);
+			uint64_t fineDepth = (uint64_t)(depth * fineDepthMax);
+			command.sortKey =
+				(variantKey << 56) |
+				(depthBucket << 48) |
+				(FitStateKey(stateKey, stateBits, g_OpaqueStateBits) << fineDepthBits) |
+				fineDepth;
+			command.tieKey = GetTieKey(stateKey, stateBits, g_OpaqueStateBits);
+		}
+		else
+		{
+			uint64_t fineDepth = (uint64_t)(depth * 0xFFFFFF);
+			command.sortKey =
+				((uint64_t)1 << 63) |
+				((0xFFFFFF - fineDepth) << 39) |
+				(variantKey << 32) |
+				FitStateKey(stateKey, stateBits, g_TransparentStateBits);
+			command.tieKey = GetTieKey(stateKey, stateBits, g_TransparentStateBits);
+		}
+
+		m_pDrawQueue[m_drawCount++] = command;
+	}
+}
+
+/***********************************************************
+ *  DrawMesh()
+ *
+ *  This method is used for drawing the passed in basic shape
+ *  or imported mesh.
+ ***********************************************************/
+void SceneManager::DrawMesh(int mesh, bool bCompact)
+{
+	if (bCompact == true)
+	{
+		m_pCompactMeshes->DrawMesh(mesh);
+		return;
+	}
+
+	switch (mesh)
+	{
+	case MESH_PLANE: m_basicMeshes->DrawPlaneMesh(); break;
+	case MESH_BOX: m_basicMeshes->DrawBoxMesh(); break;
+	case MESH_SPHERE: m_basicMeshes->DrawSphereMesh(); break;
+	case MESH_CYLINDER: m_basicMeshes->DrawCylinderMesh(); break;
+	case MESH_CONE: m_basicMeshes->DrawConeMesh(); break;
+	default:
+		if (NULL != m_pImportedMeshes)
+		{
+			m_pImportedMeshes->DrawMesh(mesh - MESH_FIRST_IMPORTED);
+		}
+		break;
+	}
+}
+
+/***********************************************************
+ *  ApplyViewSettings()
+ *
+ *  This method is used for uploading the view settings into
+ *  the shader variant if they changed since its last use.
+ ***********************************************************/
+void SceneManager::ApplyViewSettings(ShaderVariants::SHADER_VARIANT* pVariant)
+{
+	if (pVariant->viewSerial == m_viewSerial)
+	{
+		return;
+	}
+
+	glUniformMatrix4fv(pVariant->viewLocation, 1, GL_FALSE, glm::value_ptr(m_viewMatrix));
+	glUniformMatrix4fv(pVariant->projectionLocation, 1, GL_FALSE, glm::value_ptr(m_projectionMatrix));
+	glUniform3fv(pVariant->viewPositionLocation, 1, glm::value_ptr(m_viewPosition));
+	pVariant->viewSerial = m_viewSerial;
+}
+
+/***********************************************************
+ *  ApplyLightSources()
+ *
+ *  This method is used for uploading the light sources into
+ *  the shader variant if they changed since its last use.
+ ***********************************************************/
+void SceneManager::ApplyLightSources(ShaderVariants::SHADER_VARIANT* pVariant)
+{
+	if (pVariant->lightSerial == m_lightSerial)
+	{
+		return;
+	}
+
+	for (int i = 0; i < ShaderVariants::TOTAL_LIGHTS; i++)
+	{
+		const GLint* pLocations = pVariant->lightLocations[i];
+		glUniform3fv(pLocations[ShaderVariants::LIGHT_POSITION], 1, glm::value_ptr(m_lightSources[i].position));
+		glUniform3fv(pLocations[ShaderVariants::LIGHT_AMBIENT_COLOR], 1, glm::value_ptr(m_lightSources[i].ambientColor));
+		glUniform3fv(pLocations[ShaderVariants::LIGHT_DIFFUSE_COLOR], 1, glm::value_ptr(m_lightSources[i].diffuseColor));
+		glUniform3fv(pLocations[ShaderVariants::LIGHT_SPECULAR_COLOR], 1, glm::value_ptr(m_lightSources[i].specularColor));
+		glUniform1i(pLocations[ShaderVariants::LIGHT_IS_ENABLED], m_lightSources[i].isEnabled);
+	}
+	pVariant->lightSerial = m_lightSerial;
+}
+
+/***********************************************************
+ *  ApplyMaterial()
+ *
+ *  This method is used for uploading the material values
+ *  into the shader variant.
+ ***********************************************************/
+void SceneManager::ApplyMaterial(ShaderVariants::SHADER_VARIANT* pVariant, int materialIndex)
+{
+	if ((materialIndex < 0) || (materialIndex >= (int)m_objectMaterials.size()))
+	{
+		return;
+	}
+
+	const OBJECT_MATERIAL& material = m_objectMaterials[materialIndex];
+	const GLint* pLocations = pVariant->materialLocations;
+	glUniform3fv(pLocations[ShaderVariants::MATERIAL_AMBIENT_COLOR], 1, glm::value_ptr(material.ambientColor));
+	glUniform1f(pLocations[ShaderVariants::MATERIAL_AMBIENT_STRENGTH], material.ambientStrength);
+	glUniform3fv(pLocations[ShaderVariants::MATERIAL_DIFFUSE_COLOR], 1, glm::value_ptr(material.diffuseColor));
+	glUniform3fv(pLocations[ShaderVariants::MATERIAL_SPECULAR_COLOR], 1, glm::value_ptr(material.specularColor));
+	glUniform1f(pLocations[ShaderVariants::MATERIAL_SHININESS], material.shininess);
+}
+
+/***********************************************************
+ *  FlushDrawQueue()
+ *
+ *  This method is used for sorting and submitting the queued
+ *  draws.  The opaque draws are rendered without blending,
+ *  optionally after a depth-only prepass, and the transparent
+ *  draws are blended on top without writing depth.  With the
+ *  GPU culler, the opaque objects are culled and drawn by it,
+ *  and the depth they leave is kept for culling the next
+ *  frame.
+ ***********************************************************/
+void SceneManager::FlushDrawQueue()
+{
+	if (NULL == m_pShaderVariants)
+	{
+		m_drawCount = 0;
+		return;
+	}
+
+	m_frameStats.queuedDraws = (int)m_drawCount;
+	if (NULL != m_pGpuCuller)
+	{
+		m_frameStats.queuedDraws += m_pGpuCuller->GetObjectCount();
+	}
+	m_frameStats.drawCalls = 0;
+	m_frameStats.programChanges = 0;
+	m_frameStats.occlusionCulled = 0;
+	m_frameStats.frustumCulled = 0;
+	double stageStart = GetMilliseconds();
+
+	// the spatial index covers every object, including the ones
+	// that are culled from this frame
+	UpdateSpatialIndex();
+	double indexEnd = GetMilliseconds();
+
+	// the GPU culler tests the opaque objects itself, which leaves
+	// no occluders in the queue
+	if (NULL != m_pGpuCuller)
+	{
+		m_pGpuCuller->Cull(m_projectionMatrix * m_viewMatrix);
+	}
+	else if (m_bOcclusionCulling == true)
+	{
+		CullOccludedDraws();
+	}
+	double cullEnd = GetMilliseconds();
+
+	SortDrawQueue();
+	double sortEnd = GetMilliseconds();
+
+	// the transparent draws are sorted after all of the opaque draws
+	size_t transparentStart = 0;
+	while ((transparentStart < m_drawCount) &&
+		(m_pDrawQueue[m_pDrawOrder[transparentStart]].bTransparent == false))
+	{
+		transparentStart++;
+	}
+
+	if (NULL != m_pSoftwareRasterizer)
+	{
+		// the rasterizer blends the transparent draws itself, as
+		// they come after the opaque ones in the sorted order
+		RenderSoftwareDraws();
+	}
+	else
+	{
+		// the runs may not cross from the opaque draws into the
+		// blended ones
+		if (NULL != m_pInstancedDraws)
+		{
+			m_pInstancedDraws->ClearInstances();
+			FindInstanceRuns(0, transparentStart);
+			FindInstanceRuns(transparentStart, m_drawCount);
+			m_pInstancedDraws->UploadInstances();
+		}
+
+		// opaque pass
+		glDisable(GL_BLEND);
+		bool bHasOpaque = (transparentStart > 0) || (NULL != m_pGpuCuller);
+		if ((m_bDepthPrepass == true) && (bHasOpaque == true))
+		{
+			glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+			SubmitDraws(0, transparentStart, true);
+			if (NULL != m_pGpuCuller)
+			{
+				SubmitGpuDraws(true);
+			}
+			glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+			// only the surfaces that won the depth test get shaded
+			glDepthFunc(GL_LEQUAL);
+			glDepthMask(GL_FALSE);
+		}
+		SubmitDraws(0, transparentStart, false);
+		if (NULL != m_pGpuCuller)
+		{
+			SubmitGpuDraws(false);
+			m_pGpuCuller->CaptureDepth(m_projectionMatrix * m_viewMatrix);
+		}
+		glDepthFunc(GL_LESS);
+
+		// transparent pass
+		if (transparentStart < m_drawCount)
+		{
+			glEnable(GL_BLEND);
+			glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+			glDepthMask(GL_FALSE);
+			SubmitDraws(transparentStart, m_drawCount, false);
+			glDisable(GL_BLEND);
+		}
+		glDepthMask(GL_TRUE);
+	}
+
+	m_frameStats.indexMilliseconds = (float)(indexEnd - stageStart);
+	m_frameStats.cullMilliseconds = (float)(cullEnd - indexEnd);
+	m_frameStats.sortMilliseconds = (float)(sortEnd - cullEnd);
+	m_frameStats.submitMilliseconds = (float)(GetMilliseconds() - sortEnd);
+	m_frameStats.arenaBytes = m_frameArena.GetUsedBytes();
+
+	// the queue memory is reclaimed by the next arena reset
+	m_drawCount = 0;
+
+	// leave the general program active between the frames
+	if (NULL != m_pShaderVariants)
+	{
+		m_pShaderVariants->UseGeneralProgram();
+	}
+}
+
+/***********************************************************
+ *  RenderSoftwareDraws()
+ *
+ *  This method is used for handing the sorted draws to the
+ *  software rasterizer with the same settings the shader
+ *  programs get, rendering them at the size of the viewport,
+ *  and copying the result into the viewport of the bound
+ *  framebuffer so that the presenting and frame capture work
+ *  as they do for OpenGL.
+ ***********************************************************/
+void SceneManager::RenderSoftwareDraws()
+{
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	int width = viewport[2];
+	int height = viewport[3];
+
+	m_pSoftwareRasterizer->Resize(width, height);
+	m_pSoftwareRasterizer->SetView(m_viewMatrix, m_projectionMatrix, m_viewPosition);
+	SoftwareRasterizer::LIGHT_SOURCE lights[ShaderVariants::TOTAL_LIGHTS];
+	for (int i = 0; i < ShaderVariants::TOTAL_LIGHTS; i++)
+	{
+		lights[i].position = m_lightSources[i].position;
+		lights[i].ambientColor = m_lightSources[i].ambientColor;
+		lights[i].diffuseColor = m_lightSources[i].diffuseColor;
+		lights[i].specularColor = m_lightSources[i].specularColor;
+		lights[i].bEnabled = m_lightSources[i].isEnabled;
+	}
+	m_pSoftwareRasterizer->SetLightSources(lights, m_bUseLighting);
+
+	// a draw without a material keeps the one before it, as the
+	// material uniforms do
+	SoftwareRasterizer::MATERIAL material;
+	material.ambientColor = glm::vec3(0.0f);
+	material.ambientStrength = 0.0f;
+	material.diffuseColor = glm::vec3(0.0f);
+	material.specularColor = glm::vec3(0.0f);
+	material.shininess = 1.0f;
+
+	m_pSoftwareRasterizer->BeginFrame();
+	for (size_t i = 0; i < m_drawCount; i++)
+	{
+		const DRAW_COMMAND& command = m_pDrawQueue[m_pDrawOrder[i]];
+		if ((command.materialIndex >= 0) && (command.materialIndex < (int)m_objectMaterials.size()))
+		{
+			const OBJECT_MATERIAL& objectMaterial = m_objectMaterials[command.materialIndex];
+			material.ambientColor = objectMaterial.ambientColor;
+			material.ambientStrength = objectMaterial.ambientStrength;
+			material.diffuseColor = objectMaterial.diffuseColor;
+			material.specularColor = objectMaterial.specularColor;
+			material.shininess = objectMaterial.shininess;
+		}
+
+		SoftwareRasterizer::DRAW draw;
+		draw.model = command.model;
+		draw.color = command.color;
+		draw.uvScale = command.uvScale;
+		draw.material = material;
+		draw.mesh = command.mesh;
+		draw.texture = command.textureSlot;
+		draw.bUseTexture = command.bUseTexture;
+		draw.bTransparent = command.bTransparent;
+		m_pSoftwareRasterizer->AddDraw(draw);
+		m_frameStats.drawCalls++;
+	}
+	m_pSoftwareRasterizer->RenderFrame();
+
+	// creating the target binds the default framebuffer, so the
+	// bound ones are kept aside first
+	GLint drawFramebuffer = 0;
+	GLint readFramebuffer = 0;
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &drawFramebuffer);
+	glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &readFramebuffer);
+	if ((m_softwareTarget.GetWidth() != width) || (m_softwareTarget.GetHeight() != height))
+	{
+		if (m_softwareTarget.Create(width, height) == false)
+		{
+			return;
+		}
+	}
+
+	glBindTexture(GL_TEXTURE_2D, m_softwareTarget.GetColorTexture());
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, m_pSoftwareRasterizer->GetPitch());
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE,
+		m_pSoftwareRasterizer->GetColorBuffer());
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, m_softwareTarget.GetFramebuffer());
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, drawFramebuffer);
+	glBlitFramebuffer(
+		0, 0, width, height,
+		viewport[0], viewport[1], viewport[0] + width, viewport[1] + height,
+		GL_COLOR_BUFFER_BIT,
+		GL_NEAREST);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, readFramebuffer);
+}
+
+/***********************************************************
+ *  CullOccludedDraws()
+ *
+ *  This method is used for removing the queued draws that
+ *  cannot be seen.  The opaque occluders are rasterized into
+ *  the CPU depth buffer first, and the bounds of every other
+ *  draw are then tested against it.  The occluders are never
+ *  culled themselves.
+ ***********************************************************/
+void SceneManager::CullOccludedDraws()
+{
+	m_occlusionCuller.BeginFrame(m_projectionMatrix * m_viewMatrix);
+
+	for (size_t i = 0; i < m_drawCount; i++)
+	{
+		const DRAW_COMMAND& command = m_pDrawQueue[i];
+		if ((command.bOccluder == true) && (command.bTransparent == false) &&
+			(command.mesh < MESH_FIRST_IMPORTED) && (g_MeshHasOccluder[command.mesh] == true))
+		{
+			m_occlusionCuller.RasterizeOccluderBox(
+				command.model,
+				g_MeshOccluderMin[command.mesh],
+				g_MeshOccluderMax[command.mesh]);
+		}
+	}
+	m_occlusionCuller.BuildHierarchy();
+
+	size_t kept = 0;
+	for (size_t i = 0; i < m_drawCount; i++)
+	{
+		const DRAW_COMMAND& command = m_pDrawQueue[i];
+		OcclusionCuller::VISIBILITY visibility = OcclusionCuller::VISIBLE;
+		if (command.bOccluder == false)
+		{
+			glm::vec3 boundsMin;
+			glm::vec3 boundsMax;
+			GetMeshLocalBounds(m_pImportedMeshes, command.mesh, boundsMin, boundsMax);
+			visibility = m_occlusionCuller.TestBounds(command.model, boundsMin, boundsMax);
+		}
+
+		if (visibility == OcclusionCuller::OCCLUDED)
+		{
+			m_frameStats.occlusionCulled++;
+		}
+		else if (visibility == OcclusionCuller::OUTSIDE_FRUSTUM)
+		{
+			m_frameStats.frustumCulled++;
+		}
+		else
+		{
+			m_pDrawQueue[kept++] = command;
+		}
+	}
+	m_drawCount = kept;
+}
+
+/***********************************************************
+ *  SortDrawQueue()
+ *
+ *  This method is used for ordering the queued draws by their
+ *  sort keys.  The keys are radix sorted a byte at a time,
+ *  which keeps draws with equal keys in the order they were
+ *  queued, and the bytes that are the same for every draw are
+ *  skipped.  When the ids did not fit into the keys, the tie
+ *  keys are sorted first, so the draws that share a key end
+ *  up ordered by the rest of their ids.  Only the positions
+ *  of the draws are moved, and all of the scratch memory
+ *  comes from the frame arena.
+ ***********************************************************/
+void SceneManager::SortDrawQueue()
+{
+	size_t count = m_drawCount;
+	uint64_t* pKeys = m_frameArena.AllocateArray<uint64_t>(count);
+	uint64_t* pSortedKeys = m_frameArena.AllocateArray<uint64_t>(count);
+	uint32_t* pOrder = m_frameArena.AllocateArray<uint32_t>(count);
+	uint32_t* pSortedOrder = m_frameArena.AllocateArray<uint32_t>(count);
+
+	for (size_t i = 0; i < count; i++)
+	{
+		pKeys[i] = m_pDrawQueue[i].tieKey;
+		pOrder[i] = (uint32_t)i;
+	}
+	for (int shift = 0; (shift < m_tieKeyBits) && (count > 1); shift += 8)
+	{
+		if (RadixSortPass(pKeys, pOrder, pSortedKeys, pSortedOrder, count, shift) == true)
+		{
+			std::swap(pKeys, pSortedKeys);
+			std::swap(pOrder, pSortedOrder);
+		}
+	}
+
+	for (size_t i = 0; i < count; i++)
+	{
+		pKeys[i] = m_pDrawQueue[pOrder[i]].sortKey;
+	}
+	for (int shift = 0; (shift < 64) && (count > 1); shift += 8)
+	{
+		if (RadixSortPass(pKeys, pOrder, pSortedKeys, pSortedOrder, count, shift) == true)
+		{
+			std::swap(pKeys, pSortedKeys);
+			std::swap(pOrder, pSortedOrder);
+		}
+	}
+
+	m_pDrawOrder = pOrder;
+}
+
+/***********************************************************
+ *  UpdateSpatialIndex()
+ *
+ *  This method is used for keeping the spatial index in step
+ *  with the scene objects.  The tree is rebuilt when objects
+ *  were added or removed, since removing one moves another
+ *  object into its place - when objects only move, just their
+ *  new bounds are refit into the existing tree, until the
+ *  boxes have grown enough that rebuilding pays off.
+ ***********************************************************/
+void SceneManager::UpdateSpatialIndex()
+{
+	const glm::vec3* pBoundsMin = m_entities.GetBoundsMin();
+	const glm::vec3* pBoundsMax = m_entities.GetBoundsMax();
+
+	if (m_bSpatialRebuild == false)
+	{
+		if (m_spatialMoved.empty() == true)
+		{
+			return;
+		}
+
+		for (size_t i = 0; i < m_spatialMoved.size(); i++)
+		{
+			int index = m_spatialMoved[i];
+			m_spatialBounds[index].minimum = pBoundsMin[index];
+			m_spatialBounds[index].maximum = pBoundsMax[index];
+			m_spatialIndex.UpdateItem(index, m_spatialBounds[index]);
+		}
+		m_spatialMoved.clear();
+		m_spatialIndex.Refit();
+		if (m_spatialIndex.GetRefitInflation() <= g_MaxRefitInflation)
+		{
+			return;
+		}
+	}
+
+	int count = m_entities.GetCount();
+	m_spatialBounds.resize(count);
+	for (int i = 0; i < count; i++)
+	{
+		m_spatialBounds[i].minimum = pBoundsMin[i];
+		m_spatialBounds[i].maximum = pBoundsMax[i];
+	}
+	m_spatialIndex.Build(m_spatialBounds);
+	m_spatialMoved.clear();
+	m_bSpatialRebuild = false;
+}
+
+/***********************************************************
+ *  PickObject()
+ *
+ *  This method is used for finding the nearest object hit by
+ *  the passed in ray, including the changes to the objects
+ *  made since the last frame.
+ ***********************************************************/
+bool SceneManager::PickObject(
+	const glm::vec3& origin,
+	const glm::vec3& direction,
+	PICK_RESULT& result)
+{
+	result.entity = EntityStore::INVALID_HANDLE;
+	result.mesh = -1;
+	result.distance = g_PickDistance;
+	result.position = origin;
+
+	UpdateSpatialIndex();
+
+	RAY_TEST_CONTEXT context;
+	context.pEntities = &m_entities;
+	context.pImportedMeshes = m_pImportedMeshes;
+
+	BoundingVolumeHierarchy::RAY_HIT hit;
+	if (m_spatialIndex.RayCast(
+		origin,
+		direction,
+		g_PickDistance,
+		hit,
+		&TestRayAgainstEntity,
+		(void*)&context) == false)
+	{
+		return(false);
+	}
+
+	result.entity = m_entities.GetHandle(hit.item);
+	result.mesh = m_entities.GetMeshes()[hit.item];
+	result.distance = hit.distance;
+	result.position = origin + direction * hit.distance;
+	return(true);
+}
+
+/***********************************************************
+ *  QueryObjectsInBox()
+ *
+ *  This method is used for collecting the objects whose world
+ *  bounds overlap the passed in box.
+ ***********************************************************/
+void SceneManager::QueryObjectsInBox(
+	const glm::vec3& boxMin,
+	const glm::vec3& boxMax,
+	std::vector<EntityStore::ENTITY_HANDLE>& objects)
+{
+	objects.clear();
+	UpdateSpatialIndex();
+
+	BoundingVolumeHierarchy::BOUNDS box;
+	box.minimum = boxMin;
+	box.maximum = boxMax;
+
+	std::vector<int> items;
+	m_spatialIndex.QueryOverlap(box, items);
+	for (size_t i = 0; i < items.size(); i++)
+	{
+		objects.push_back(m_entities.GetHandle(items[i]));
+	}
+}
+
+/***********************************************************
+ *  SetObjectTransform()
+ *
+ *  This method is used for moving a scene object.  Its world
+ *  bounds follow, and are refit into the spatial index before
+ *  it is next used.  A moved object becomes dynamic, so it leaves
+ *  the static layer once and is drawn every frame from then
+ *  on.
+ ***********************************************************/
+bool SceneManager::SetObjectTransform(EntityStore::ENTITY_HANDLE entity, const glm::mat4& model)
+{
+	int index = m_entities.GetIndex(entity);
+	if (index < 0)
+	{
+		return(false);
+	}
+
+	glm::vec3 boundsMin;
+	glm::vec3 boundsMax;
+	GetMeshLocalBounds(m_pImportedMeshes, m_entities.GetMeshes()[index], boundsMin, boundsMax);
+	BoundingVolumeHierarchy::BOUNDS bounds = CalculateWorldBounds(model, boundsMin, boundsMax);
+	m_objectSerial++;
+	if ((m_entities.GetFlags()[index] & EntityStore::ENTITY_DYNAMIC) == 0)
+	{
+		m_entities.AddFlags(entity, EntityStore::ENTITY_DYNAMIC);
+		m_staticSerial++;
+	}
+	if (m_bSpatialRebuild == false)
+	{
+		m_spatialMoved.push_back(index);
+	}
+	return(m_entities.SetTransform(entity, model, bounds.minimum, bounds.maximum));
+}
+
+/***********************************************************
+ *  RemoveObject()
+ *
+ *  This method is used for removing a scene object.
+ ***********************************************************/
+bool SceneManager::RemoveObject(EntityStore::ENTITY_HANDLE entity)
+{
+	int index = m_entities.GetIndex(entity);
+	if (index < 0)
+	{
+		return(false);
+	}
+
+	m_objectSerial++;
+	if ((m_entities.GetFlags()[index] & EntityStore::ENTITY_DYNAMIC) == 0)
+	{
+		m_staticSerial++;
+	}
+	m_bSpatialRebuild = true;
+	return(m_entities.Remove(entity));
+}
+
+/***********************************************************
+ *  GetMeshName()
+ *
+ *  This method is used for getting the display name of the
+ *  passed in basic shape mesh.
+ ***********************************************************/
+const char* SceneManager::GetMeshName(int mesh)
+{
+	if (mesh >= MESH_FIRST_IMPORTED)
+	{
+		return("model");
+	}
+	if (mesh < MESH_PLANE)
+	{
+		return("unknown");
+	}
+	return(g_MeshNames[mesh]);
+}
+
+/***********************************************************
+ *  FindInstanceRuns()
+ *
+ *  This method is used for finding the runs of consecutive
+ *  sorted draws of a basic shape with the same variant and
+ *  texture slot.  The sort keys put such draws next to each
+ *  other, and each run of two or more is drawn in one call by
+ *  the GPU-driven variant, which reads the model and material
+ *  of every draw from the instances collected here.  The runs
+ *  are the same for the depth prepass and the shading, so both
+ *  passes draw them from the same vertices.
+ ***********************************************************/
+void SceneManager::FindInstanceRuns(size_t first, size_t last)
+{
+	if (NULL == m_pInstanceRuns)
+	{
+		m_pInstanceRuns = m_frameArena.AllocateArray<INSTANCE_RUN>(m_drawCount);
+	}
+
+	size_t start = first;
+	while (start < last)
+	{
+		const DRAW_COMMAND& command = m_pDrawQueue[m_pDrawOrder[start]];
+		size_t end = start + 1;
+		while ((end < last) && (command.mesh < MESH_FIRST_IMPORTED))
+		{
+			const DRAW_COMMAND& next = m_pDrawQueue[m_pDrawOrder[end]];
+			if ((next.mesh != command.mesh) ||
+				(next.variantFlags != command.variantFlags) ||
+				(next.bUseTexture != command.bUseTexture) ||
+				((command.bUseTexture == true) && (next.textureSlot != command.textureSlot)))
+			{
+				break;
+			}
+			end++;
+		}
+
+		// the general program cannot read the instanced settings
+		bool bInstanced = (end - start >= g_MinInstanceRun);
+		if (bInstanced == true)
+		{
+			unsigned int variantFlags = (command.variantFlags & ~ShaderVariants::VARIANT_COMPACT_VERTICES) |
+				ShaderVariants::VARIANT_GPU_DRIVEN;
+			bInstanced = (m_pShaderVariants->GetVariant(variantFlags)->bGeneral == false);
+			if ((bInstanced == true) && (m_bDepthPrepass == true) && (command.bTransparent == false))
+			{
+				bInstanced = (m_pShaderVariants->GetVariant(
+					ShaderVariants::VARIANT_DEPTH_ONLY | ShaderVariants::VARIANT_GPU_DRIVEN)->bGeneral == false);
+			}
+		}
+
+		for (size_t i = start; i < end; i++)
+		{
+			m_pInstanceRuns[i].count = 0;
+			m_pInstanceRuns[i].firstInstance = 0;
+			if (bInstanced == false)
+			{
+				continue;
+			}
+
+			const DRAW_COMMAND& draw = m_pDrawQueue[m_pDrawOrder[i]];
+			GpuCuller::OBJECT_INSTANCE instance;
+			instance.model = draw.model;
+			instance.color = draw.color;
+			instance.uvScale = glm::vec4(draw.uvScale, 0.0f, 0.0f);
+			// a draw without a material is left unlit by the lights
+			instance.ambient = glm::vec4(0.0f);
+			instance.diffuse = glm::vec4(0.0f);
+			instance.specular = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+			if ((draw.materialIndex >= 0) && (draw.materialIndex < (int)m_objectMaterials.size()))
+			{
+				const OBJECT_MATERIAL& material = m_objectMaterials[draw.materialIndex];
+				instance.ambient = glm::vec4(material.ambientColor, material.ambientStrength);
+				instance.diffuse = glm::vec4(material.diffuseColor, 0.0f);
+				instance.specular = glm::vec4(material.specularColor, material.shininess);
+			}
+			uint32_t index = m_pInstancedDraws->AddInstance(instance);
+			if (i == start)
+			{
+				m_pInstanceRuns[i].count = (uint32_t)(end - start);
+				m_pInstanceRuns[i].firstInstance = index;
+			}
+		}
+
+		start = end;
+	}
+}
+
+/***********************************************************
+ *  SubmitDraws()
+ *
+ *  This method is used for submitting a range of the sorted
+ *  draws.  Each draw runs with the shader variant specialized
+ *  for its texture and lighting mode, and uniforms are only
+ *  uploaded when they differ from the previous draw.  Depth
+ *  only draws all share the minimal depth variant.  The runs
+ *  of draws that share their state are drawn in one instanced
+ *  call with the GPU-driven variant.
+ ***********************************************************/
+void SceneManager::SubmitDraws(size_t first, size_t last, bool bDepthOnly)
+{
+	ShaderVariants::SHADER_VARIANT* pVariant = NULL;
+	bool bCompact = false;
+	int currentMesh = -1;
+	int currentMaterial = -2;
+	int currentTexture = -2;
+	glm::vec2 currentUVScale;
+	glm::vec4 currentColor;
+
+	for (size_t i = first; i < last; i++)
+	{
+		const DRAW_COMMAND& command = m_pDrawQueue[m_pDrawOrder[i]];
+		uint32_t runCount = (NULL != m_pInstanceRuns) ? m_pInstanceRuns[i].count : 0;
+
+		unsigned int variantFlags = command.variantFlags;
+		if (runCount > 0)
+		{
+			variantFlags = ShaderVariants::VARIANT_GPU_DRIVEN;
+			if (bDepthOnly == true)
+			{
+				variantFlags |= ShaderVariants::VARIANT_DEPTH_ONLY;
+			}
+			else
+			{
+				variantFlags |= (command.variantFlags & ~ShaderVariants::VARIANT_COMPACT_VERTICES);
+			}
+		}
+		else if (bDepthOnly == true)
+		{
+			// the depth must come from the same vertices as the shading
+			variantFlags = ShaderVariants::VARIANT_DEPTH_ONLY |
+				(command.variantFlags & ShaderVariants::VARIANT_COMPACT_VERTICES);
+		}
+
+		ShaderVariants::SHADER_VARIANT* pNextVariant = m_pShaderVariants->GetVariant(variantFlags);
+		if (pNextVariant != pVariant)
+		{
+			pVariant = pNextVariant;
+			glUseProgram(pVariant->programID);
+			m_frameStats.programChanges++;
+			ApplyViewSettings(pVariant);
+			ApplyLightSources(pVariant);
+
+			// the general program only reads the float meshes
+			bCompact = ((pVariant->flags & ShaderVariants::VARIANT_COMPACT_VERTICES) != 0);
+
+			// the tracked uniform values belong to the previous program
+			currentMesh = -1;
+			currentMaterial = -2;
+			currentTexture = -2;
+			currentUVScale = glm::vec2(-1.0f, -1.0f);
+			currentColor = glm::vec4(-1.0f);
+		}
+
+		if (runCount > 0)
+		{
+			if ((bDepthOnly == false) && (command.bUseTexture == true) && (command.textureSlot != currentTexture))
+			{
+				glUniform1i(pVariant->textureLocation, command.textureSlot);
+				currentTexture = command.textureSlot;
+			}
+			m_pInstancedDraws->DrawInstances(command.mesh, m_pInstanceRuns[i].firstInstance, runCount);
+			m_frameStats.drawCalls++;
+			i += runCount - 1;
+			continue;
+		}
+
+		glUniformMatrix4fv(pVariant->modelLocation, 1, GL_FALSE, glm::value_ptr(command.model));
+
+		if ((bCompact == true) && (command.mesh != currentMesh))
+		{
+			glm::vec3 center;
+			glm::vec3 extent;
+			m_pCompactMeshes->GetMeshBounds(command.mesh, center, extent);
+			glUniform3fv(pVariant->meshCenterLocation, 1, glm::value_ptr(center));
+			glUniform3fv(pVariant->meshExtentLocation, 1, glm::value_ptr(extent));
+			currentMesh = command.mesh;
+		}
+
+		m_frameStats.drawCalls++;
+		if (bDepthOnly == true)
+		{
+			DrawMesh(command.mesh, bCompact);
+			continue;
+		}
+
+		// only the general program selects the modes with uniforms
+		if (pVariant->bGeneral == true)
+		{
+			glUniform1i(pVariant->useTextureLocation, command.bUseTexture);
+			glUniform1i(pVariant->useLightingLocation, m_bUseLighting);
+		}
+
+		if (command.materialIndex != currentMaterial)
+		{
+			ApplyMaterial(pVariant, command.materialIndex);
+			currentMaterial = command.materialIndex;
+		}
+
+		if (command.bUseTexture == true)
+		{
+			if (command.textureSlot != currentTexture)
+			{
+				glUniform1i(pVariant->textureLocation, command.textureSlot);
+				currentTexture = command.textureSlot;
+			}
+			if (command.uvScale != currentUVScale)
+			{
+				glUniform2f(pVariant->uvScaleLocation, command.uvScale.x, command.uvScale.y);
+				currentUVScale = command.uvScale;
+			}
+		}
+		else if (command.color != currentColor)
+		{
+			glUniform4fv(pVariant->colorLocation, 1, glm::value_ptr(command.color));
+			currentColor = command.color;
+		}
+
+		DrawMesh(command.mesh, bCompact);
+	}
+}
+
+/***********************************************************
+ *  UploadGpuObjects()
+ *
+ *  This method is used for replacing the objects resident in
+ *  the GPU culler with the opaque basic shapes.  Each object
+ *  carries its own material values, and goes into the bucket
+ *  of its texture slot, or the untextured bucket.
+ ***********************************************************/
+void SceneManager::UploadGpuObjects()
+{
+	int count = m_entities.GetCount();
+	const glm::mat4* pTransforms = m_entities.GetTransforms();
+	const glm::vec3* pBoundsMin = m_entities.GetBoundsMin();
+	const glm::vec3* pBoundsMax = m_entities.GetBoundsMax();
+	const int* pMeshes = m_entities.GetMeshes();
+	const int* pMaterials = m_entities.GetMaterials();
+	const int* pTextures = m_entities.GetTextures();
+	const glm::vec2* pUVScales = m_entities.GetUVScales();
+	const glm::vec4* pColors = m_entities.GetColors();
+	const unsigned int* pFlags = m_entities.GetFlags();
+
+	std::vector<GpuCuller::OBJECT_INSTANCE> instances;
+	std::vector<GpuCuller::OBJECT_BOUNDS> bounds;
+	instances.reserve(count);
+	bounds.reserve(count);
+	for (int i = 0; i < count; i++)
+	{
+		// the transparent objects and the imported meshes, which are
+		// not in the merged shapes, are still drawn from the CPU queue
+		if (((pFlags[i] & EntityStore::ENTITY_TRANSPARENT) != 0) || (pMeshes[i] >= MESH_FIRST_IMPORTED))
+		{
+			continue;
+		}
+
+		GpuCuller::OBJECT_INSTANCE instance;
+		instance.model = pTransforms[i];
+		instance.color = pColors[i];
+		instance.uvScale = glm::vec4(pUVScales[i], 0.0f, 0.0f);
+		// an object without a material is left unlit by the lights
+		instance.ambient = glm::vec4(0.0f);
+		instance.diffuse = glm::vec4(0.0f);
+		instance.specular = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+		if ((pMaterials[i] >= 0) && (pMaterials[i] < (int)m_objectMaterials.size()))
+		{
+			const OBJECT_MATERIAL& material = m_objectMaterials[pMaterials[i]];
+			instance.ambient = glm::vec4(material.ambientColor, material.ambientStrength);
+			instance.diffuse = glm::vec4(material.diffuseColor, 0.0f);
+			instance.specular = glm::vec4(material.specularColor, material.shininess);
+		}
+		instances.push_back(instance);
+
+		GpuCuller::OBJECT_BOUNDS objectBounds;
+		objectBounds.boundsMin = glm::vec4(pBoundsMin[i], 0.0f);
+		objectBounds.boundsMax = glm::vec4(pBoundsMax[i], 0.0f);
+		objectBounds.mesh = (uint32_t)pMeshes[i];
+		objectBounds.bucket = 0;
+		if ((pFlags[i] & EntityStore::ENTITY_TEXTURED) != 0)
+		{
+			objectBounds.bucket = (uint32_t)(pTextures[i] + 1);
+		}
+		objectBounds.padding[0] = 0;
+		objectBounds.padding[1] = 0;
+		bounds.push_back(objectBounds);
+	}
+
+	m_pGpuCuller->SetObjects(instances, bounds, g_GpuBucketCount);
+	m_gpuObjectSerial = m_objectSerial;
+}
+
+/***********************************************************
+ *  SubmitGpuDraws()
+ *
+ *  This method is used for drawing the opaque objects that
+ *  passed the GPU culling, with one multi-draw call for each
+ *  bucket.  The per-object settings come from the instanced
+ *  attributes, so only the texture slot of the bucket is set
+ *  between the calls.
+ ***********************************************************/
+void SceneManager::SubmitGpuDraws(bool bDepthOnly)
+{
+	ShaderVariants::SHADER_VARIANT* pVariant = NULL;
+
+	m_pGpuCuller->BeginDraws();
+	for (int bucket = 0; bucket < m_pGpuCuller->GetBucketCount(); bucket++)
+	{
+		if (m_pGpuCuller->GetBucketCapacity(bucket) == 0)
+		{
+			continue;
+		}
+
+		bool bUseTexture = (bucket > 0);
+		unsigned int variantFlags = ShaderVariants::VARIANT_GPU_DRIVEN;
+		if (bDepthOnly == true)
+		{
+			variantFlags |= ShaderVariants::VARIANT_DEPTH_ONLY;
+		}
+		else
+		{
+			if (bUseTexture == true)
+			{
+				variantFlags |= ShaderVariants::VARIANT_TEXTURE;
+			}
+			if (m_bUseLighting == true)
+			{
+				variantFlags |= ShaderVariants::VARIANT_LIGHTING;
+			}
+		}
+
+		ShaderVariants::SHADER_VARIANT* pNextVariant = m_pShaderVariants->GetVariant(variantFlags);
+		// the general program cannot read the instanced settings
+		if (pNextVariant->bGeneral == true)
+		{
+			continue;
+		}
+		if (pNextVariant != pVariant)
+		{
+			pVariant = pNextVariant;
+			glUseProgram(pVariant->programID);
+			m_frameStats.programChanges++;
+			ApplyViewSettings(pVariant);
+			ApplyLightSources(pVariant);
+		}
+
+		if ((bDepthOnly == false) && (bUseTexture == true))
+		{
+			glUniform1i(pVariant->textureLocation, bucket - 1);
+		}
+
+		m_pGpuCuller->DrawBucket(bucket);
+		m_frameStats.drawCalls++;
+	}
+	m_pGpuCuller->EndDraws();
+}
+
+/***********************************************************
+ *  LoadModel()
+ *
+ *  This method is used for importing the model file and
+ *  uploading its meshes after the basic shapes.  Every
+ *  material of the model is added to the defined materials
+ *  under the file name and its own name, and its diffuse
+ *  color and opacity become the color of the objects that
+ *  use it.  The objects are placed on the hand-built desk,
+ *  with the model standing on the desk surface.  With
+ *  progressive loading the model is imported in the
+ *  background and uploaded over several frames, and its
+ *  objects are added to the scene once it is uploaded.
+ ***********************************************************/
+void SceneManager::LoadModel()
+{
+	if (NULL != m_pAssetLoader)
+	{
+		std::shared_ptr<MODEL_UPLOAD> upload = std::make_shared<MODEL_UPLOAD>();
+		upload->bStarted = false;
+		upload->rasterizerMesh = 0;
+		std::string path = m_modelPath;
+		m_pAssetLoader->Queue(
+			m_modelPath.c_str(),
+			[upload, path]()
+			{
+				ModelImporter importer;
+				bool bImported = importer.Import(path.c_str(), upload->model);
+				ModelImporter::ReportModel(path.c_str(), upload->model);
+				if (bImported == false)
+				{
+					std::cout << "Could not import the model " << path << std::endl;
+					upload->model = ModelImporter::MODEL();
+				}
+			},
+			[this, upload]()
+			{
+				return(InstallModelStep(*upload));
+			});
+		return;
+	}
+
+	ModelImporter importer;
+	ModelImporter::MODEL model;
+	bool bImported = importer.Import(m_modelPath.c_str(), model);
+	ModelImporter::ReportModel(m_modelPath.c_str(), model);
+	if (bImported == false)
+	{
+		std::cout << "Could not import the model " << m_modelPath << std::endl;
+		return;
+	}
+
+	InstallModel(model);
+}
+
+/***********************************************************
+ *  InstallModel()
+ *
+ *  This method is used for uploading the meshes of the
+ *  imported model, adding its materials, and placing its
+ *  meshes on the desk.  It returns false when the meshes
+ *  could not be uploaded.
+ ***********************************************************/
+bool SceneManager::InstallModel(const ModelImporter::MODEL& model)
+{
+	m_pImportedMeshes = new ImportedMeshes();
+	if (m_pImportedMeshes->LoadMeshes(model) == false)
+	{
+		delete m_pImportedMeshes;
+		m_pImportedMeshes = NULL;
+		return(false);
+	}
+
+	// the software rasterizer keeps its own copy of the vertices
+	if (NULL != m_pSoftwareRasterizer)
+	{
+		for (size_t i = 0; i < model.meshes.size(); i++)
+		{
+			CopyModelMeshToRasterizer(model, i);
+		}
+	}
+
+	PlaceModel(model);
+	return(true);
+}
+
+/***********************************************************
+ *  InstallModelStep()
+ *
+ *  This method is used for making one step of installing the
+ *  model imported in the background, which is either laying
+ *  out its buffers, copying one staging buffer of its
+ *  meshes, or copying one of its meshes into the software
+ *  rasterizer.  Once all of it is uploaded the model is
+ *  placed and its objects are added to the scene.
+ ***********************************************************/
+AssetLoader::INSTALL_STATUS SceneManager::InstallModelStep(MODEL_UPLOAD& upload)
+{
+	const ModelImporter::MODEL& model = upload.model;
+	if (upload.bStarted == false)
+	{
+		upload.bStarted = true;
+		if (model.meshes.empty() == true)
+		{
+			return(AssetLoader::INSTALL_FAILED);
+		}
+		m_pImportedMeshes = new ImportedMeshes();
+		if (m_pImportedMeshes->BeginUpload(model) == false)
+		{
+			delete m_pImportedMeshes;
+			m_pImportedMeshes = NULL;
+			return(AssetLoader::INSTALL_FAILED);
+		}
+		return(AssetLoader::INSTALL_CONTINUE);
+	}
+
+	if (m_pImportedMeshes->UploadPiece(model) == false)
+	{
+		return(AssetLoader::INSTALL_CONTINUE);
+	}
+
+	if ((NULL != m_pSoftwareRasterizer) && (upload.rasterizerMesh < model.meshes.size()))
+	{
+		CopyModelMeshToRasterizer(model, upload.rasterizerMesh);
+		upload.rasterizerMesh++;
+		return(AssetLoader::INSTALL_CONTINUE);
+	}
+
+	PlaceModel(model);
+	AddModelObjects();
+	return(AssetLoader::INSTALL_FINISHED);
+}
+
+/***********************************************************
+ *  CopyModelMeshToRasterizer()
+ *
+ *  This method is used for giving the software rasterizer its
+ *  own float copy of one mesh of the imported model.
+ ***********************************************************/
+void SceneManager::CopyModelMeshToRasterizer(const ModelImporter::MODEL& model, size_t mesh)
+{
+	const CompactMeshes::MESH_DATA& data = model.meshes[mesh].data;
+	std::vector<glm::vec3> positions(data.vertices.size());
+	std::vector<glm::vec3> normals(data.vertices.size());
+	std::vector<glm::vec2> uvs(data.vertices.size());
+	for (size_t v = 0; v < data.vertices.size(); v++)
+	{
+		positions[v] = data.vertices[v].position;
+		normals[v] = data.vertices[v].normal;
+		uvs[v] = data.vertices[v].uv;
+	}
+	m_pSoftwareRasterizer->SetMesh(MESH_FIRST_IMPORTED + (int)mesh, positions, normals, uvs, data.indices);
+}
+
+/***********************************************************
+ *  PlaceModel()
+ *
+ *  This method is used for adding the materials of the
+ *  uploaded model, and fitting its meshes onto the desk as
+ *  the model objects.
+ ***********************************************************/
+void SceneManager::PlaceModel(const ModelImporter::MODEL& model)
+{
+	// the shader tints the diffuse light with the object color, so
+	// the material itself reflects white
+	int firstMaterial = (int)m_objectMaterials.size();
+	for (size_t i = 0; i < model.materials.size(); i++)
+	{
+		const ModelImporter::MODEL_MATERIAL& imported = model.materials[i];
+		OBJECT_MATERIAL material;
+		material.tag = m_modelPath + ":" + imported.name;
+		material.ambientStrength = 1.0f;
+		material.ambientColor = imported.ambientColor;
+		material.diffuseColor = glm::vec3(1.0f);
+		material.specularColor = imported.specularColor;
+		material.shininess = imported.shininess;
+		m_objectMaterials.push_back(material);
+	}
+
+	// bounds of the whole model, for fitting it onto the desk
+	glm::vec3 modelMin(FLT_MAX);
+	glm::vec3 modelMax(-FLT_MAX);
+	for (size_t i = 0; i < model.nodes.size(); i++)
+	{
+		const ModelImporter::MODEL_MESH& mesh = model.meshes[model.nodes[i].mesh];
+		BoundingVolumeHierarchy::BOUNDS bounds = CalculateWorldBounds(model.nodes[i].transform, mesh.boundsMin, mesh.boundsMax);
+		modelMin = glm::min(modelMin, bounds.minimum);
+		modelMax = glm::max(modelMax, bounds.maximum);
+	}
+	glm::vec3 size = modelMax - modelMin;
+	float scale = m_modelScale;
+	if (scale <= 0.0f)
+	{
+		float largest = std::max(size.x, std::max(size.y, size.z));
+		scale = (largest > 0.0f) ? g_ModelFitSize / largest : 1.0f;
+	}
+	glm::vec3 base((modelMin.x + modelMax.x) * 0.5f, modelMin.y, (modelMin.z + modelMax.z) * 0.5f);
+	glm::mat4 placement =
+		glm::translate(g_ModelPosition) *
+		glm::scale(glm::vec3(scale)) *
+		glm::translate(-base);
+
+	m_modelObjects.clear();
+	for (size_t i = 0; i < model.nodes.size(); i++)
+	{
+		const ModelImporter::MODEL_MESH& mesh = model.meshes[model.nodes[i].mesh];
+		MODEL_OBJECT object;
+		object.model = placement * model.nodes[i].transform;
+		object.mesh = MESH_FIRST_IMPORTED + model.nodes[i].mesh;
+		object.materialIndex = -1;
+		object.color = glm::vec4(0.8f, 0.8f, 0.8f, 1.0f);
+		if (mesh.material >= 0)
+		{
+			const ModelImporter::MODEL_MATERIAL& imported = model.materials[mesh.material];
+			object.materialIndex = firstMaterial + mesh.material;
+			object.color = glm::vec4(imported.diffuseColor, imported.opacity);
+		}
+		m_modelObjects.push_back(object);
+	}
+}
+
+/***********************************************************
+ *  AddModelObjects()
+ *
+ *  This method is used for adding an object for every
+ *  placement of a mesh of the imported model.
+ ***********************************************************/
+void SceneManager::AddModelObjects()
+{
+	for (size_t i = 0; i < m_modelObjects.size(); i++)
+	{
+		const MODEL_OBJECT& object = m_modelObjects[i];
+		m_pendingDraw.model = object.model;
+		m_pendingDraw.materialIndex = object.materialIndex;
+		SetShaderColor(object.color.r, object.color.g, object.color.b, object.color.a);
+		AddSceneObject(object.mesh);
+	}
+}
+/**************************************************************/
+/*** STUDENTS CAN MODIFY the code in the methods BELOW for  ***/
+/*** preparing and rendering their own 3D replicated scenes.***/
+/*** Please refer to the code in the OpenGL sample project  ***/
+/*** for assistance.                                        ***/
+/**************************************************************/
+
+ /***********************************************************
+  *  LoadSceneTextures()
+  *
+  *  This method is used for preparing the 3D scene by loading
+  *  the shapes, textures in memory to support the 3D scene
+  *  rendering
+  ***********************************************************/
+void SceneManager::LoadSceneTextures()
+{
+	// Load wood texture for the desk - the grain fills most of the
+	// view, so it is encoded at the higher quality
+	if (!CreateGLTexture("textures/dark_wood.jpg", "deskTexture",
+		TextureCompressor::FORMAT_AUTO, TextureCompressor::QUALITY_HIGH))
+	{
+		std::cout << "Failed to load desk wood texture!" << std::endl;
+	}
+
+	// Load texture for keyboard base
+	if (!CreateGLTexture("textures/black_plastic.jpg", "keyboardBaseTexture"))
+	{
+		std::cout << "Failed to load keyboard base texture!" << std::endl;
+	}
+
+	// Load texture for keyboard keys
+	if (!CreateGLTexture("textures/white_plastic.jpg", "keyCapTexture"))
+	{
+		std::cout << "Failed to load key cap texture!" << std::endl;
+	}
+
+	// Load mouse texture
+	if (!CreateGLTexture("textures/key_surface.jpg", "mouseTexture"))
+	{
+		std::cout << "Failed to load mouse texture!" << std::endl;
+	}
+
+	// Load Halloween gadget texture (pumpkin pattern)
+	if (!CreateGLTexture("textures/pumpkin.jpg", "pumpkinTexture"))
+	{
+		std::cout << "Failed to load pumpkin texture!" << std::endl;
+	}
+
+	// Bind the loaded textures to OpenGL texture slots
+	BindGLTextures();
+}
+
+/***********************************************************
+ *  DefineObjectMaterials()
+ *
+ *  This method is used for configuring the various material
+ *  settings for all of the objects within the 3D scene.
+ ***********************************************************/
+void SceneManager::DefineObjectMaterials()
+{
+	// Desk material - polished wood surface
+	OBJECT_MATERIAL deskMaterial;
+	deskMaterial.tag = "deskMaterial";
+	deskMaterial.ambientStrength = 0.3f;
+	deskMaterial.ambientColor = glm::vec3(0.5f, 0.35f, 0.2f);    // Dark wood color
+	deskMaterial.diffuseColor = glm::vec3(0.6f, 0.45f, 0.3f);    // Medium wood color
+	deskMaterial.specularColor = glm::vec3(0.7f, 0.7f, 0.7f);    // Polished wood reflection
+	deskMaterial.shininess = 32.0f;                              // Moderately polished
+	m_objectMaterials.push_back(deskMaterial);
+
+	// Keyboard base material - plastic with slight reflection
+	OBJECT_MATERIAL keyboardMaterial;
+	keyboardMaterial.tag = "keyboardMaterial";
+	keyboardMaterial.ambientStrength = 0.2f;
+	keyboardMaterial.ambientColor = glm::vec3(0.2f, 0.2f, 0.2f);   // Dark plastic
+	keyboardMaterial.diffuseColor = glm::vec3(0.3f, 0.3f, 0.3f);   // Black plastic
 	keyboardMaterial.specularColor = glm::vec3(0.5f, 0.5f, 0.5f);  // Slight plastic shine
 	keyboardMaterial.shininess = 16.0f;                            // Low shine
 	m_objectMaterials.push_back(keyboardMaterial);
@@ -481,27 +2638,30 @@ void SceneManager::DefineObjectMaterials()
 void SceneManager::SetupSceneLights()
 {
 	// Enable lighting in the shader
-	m_pShaderManager->setBoolValue(g_UseLightingName, true);
+	m_bUseLighting = true;
 
 	// Primary light source - office/desk lamp style lighting
 	// Positioned above the scene with warm white color
-	m_pShaderManager->setBoolValue("lightSources[0].isEnabled", true);
-	m_pShaderManager->setVec3Value("lightSources[0].position", glm::vec3(0.0f, 10.0f, 2.0f));
-	m_pShaderManager->setVec3Value("lightSources[0].ambientColor", glm::vec3(0.3f, 0.3f, 0.3f));
-	m_pShaderManager->setVec3Value("lightSources[0].diffuseColor", glm::vec3(1.0f, 0.95f, 0.9f)); // Warm white
-	m_pShaderManager->setVec3Value("lightSources[0].specularColor", glm::vec3(1.0f, 1.0f, 1.0f));
+	m_lightSources[0].isEnabled = true;
+	m_lightSources[0].position = glm::vec3(0.0f, 10.0f, 2.0f);
+	m_lightSources[0].ambientColor = glm::vec3(0.3f, 0.3f, 0.3f);
+	m_lightSources[0].diffuseColor = glm::vec3(1.0f, 0.95f, 0.9f); // Warm white
+	m_lightSources[0].specularColor = glm::vec3(1.0f, 1.0f, 1.0f);
 
 	// Secondary light source - accent lighting from the pumpkin (Halloween themed)
 	// Positioned near the pumpkin with orange glow
-	m_pShaderManager->setBoolValue("lightSources[1].isEnabled", true);
-	m_pShaderManager->setVec3Value("lightSources[1].position", glm::vec3(7.0f, 2.0f, 0.0f)); // Near pumpkin
-	m_pShaderManager->setVec3Value("lightSources[1].ambientColor", glm::vec3(0.1f, 0.05f, 0.0f));
-	m_pShaderManager->setVec3Value("lightSources[1].diffuseColor", glm::vec3(0.8f, 0.4f, 0.0f)); // Orange glow
-	m_pShaderManager->setVec3Value("lightSources[1].specularColor", glm::vec3(0.6f, 0.3f, 0.0f));
+	m_lightSources[1].isEnabled = true;
+	m_lightSources[1].position = glm::vec3(7.0f, 2.0f, 0.0f); // Near pumpkin
+	m_lightSources[1].ambientColor = glm::vec3(0.1f, 0.05f, 0.0f);
+	m_lightSources[1].diffuseColor = glm::vec3(0.8f, 0.4f, 0.0f); // Orange glow
+	m_lightSources[1].specularColor = glm::vec3(0.6f, 0.3f, 0.0f);
 
 	// Disable unused light sources
-	m_pShaderManager->setBoolValue("lightSources[2].isEnabled", false);
-	m_pShaderManager->setBoolValue("lightSources[3].isEnabled", false);
+	m_lightSources[2].isEnabled = false;
+	m_lightSources[3].isEnabled = false;
+
+	// the shader variants pick up the changed lights before their next draw
+	m_lightSerial++;
 }
 
 /***********************************************************
@@ -513,6 +2673,14 @@ void SceneManager::SetupSceneLights()
  ***********************************************************/
 void SceneManager::PrepareScene()
 {
+	// the rasterizer must exist before the textures are loaded,
+	// so that it gets a copy of their pixels
+	if (m_bSoftwareRendering == true)
+	{
+		m_pSoftwareRasterizer = new SoftwareRasterizer(m_softwareThreads);
+		std::cout << "Rendering on the CPU with " << m_pSoftwareRasterizer->GetThreadCount() << " threads" << std::endl;
+	}
+
 	// Define materials for all objects in the scene
 	DefineObjectMaterials();
 
@@ -520,7 +2688,22 @@ void SceneManager::PrepareScene()
 	SetupSceneLights();
 
 	// Load textures for the 3D scene
+	if (m_bTextureCompression == true)
+	{
+		m_pTextureCompressor = new TextureCompressor(m_textureCacheDirectory.c_str());
+	}
+	// with progressive loading the images are decoded in the
+	// background, and the slots hold the placeholder meanwhile
+	if (m_bProgressiveLoading == true)
+	{
+		m_pAssetLoader = new AssetLoader();
+		CreatePlaceholderTexture();
+	}
 	LoadSceneTextures();
+	if ((NULL != m_pTextureCompressor) && (NULL == m_pAssetLoader))
+	{
+		m_pTextureCompressor->ReportTotals();
+	}
 
 	// Load required meshes for desk, keyboard, mouse, and Halloween gadget
 	m_basicMeshes->LoadPlaneMesh();  // for desk surface
@@ -528,6 +2711,290 @@ void SceneManager::PrepareScene()
 	m_basicMeshes->LoadSphereMesh(); // for mouse components
 	m_basicMeshes->LoadCylinderMesh(); // for Halloween gadget base
 	m_basicMeshes->LoadConeMesh();
+
+	// the same shapes with the quantized vertices
+	if (m_bCompactMeshes == true)
+	{
+		m_pCompactMeshes = new CompactMeshes();
+		m_pCompactMeshes->LoadMeshes();
+		m_pCompactMeshes->ReportSizes();
+	}
+
+	// the GPU culler draws the opaque objects from its own copy of
+	// the shapes, with the variants that read the instanced settings
+	if ((m_bGpuCulling == true) && (NULL == m_pSoftwareRasterizer) && (NULL != m_pShaderVariants))
+	{
+		if (GpuCuller::IsSupported() == false)
+		{
+			std::cout << "GPU culling needs OpenGL 4.3, drawing the objects from the CPU" << std::endl;
+		}
+		else if (m_pShaderVariants->GetVariant(ShaderVariants::VARIANT_GPU_DRIVEN)->bGeneral == true)
+		{
+			std::cout << "GPU-driven shader variant could not be built, drawing the objects from the CPU" << std::endl;
+		}
+		else
+		{
+			m_pGpuCuller = new GpuCuller();
+			if (m_pGpuCuller->Initialize(
+				m_pShaderVariants->GetShaderCache(),
+				m_cullShaderPath.c_str(),
+				m_pyramidShaderPath.c_str(),
+				m_bGpuOcclusion) == false)
+			{
+				std::cout << "Could not build the culling program, drawing the objects from the CPU" << std::endl;
+				delete m_pGpuCuller;
+				m_pGpuCuller = NULL;
+			}
+		}
+	}
+
+	// runs of draws that share their state are drawn instanced from
+	// another copy of the shapes, with the same variants
+	if ((m_bInstancedDraws == true) && (NULL == m_pSoftwareRasterizer) && (NULL != m_pShaderVariants))
+	{
+		if (InstancedDraws::IsSupported() == false)
+		{
+			std::cout << "Instanced draws need OpenGL 4.2, drawing each object on its own" << std::endl;
+		}
+		else
+		{
+			m_pInstancedDraws = new InstancedDraws();
+			m_pInstancedDraws->LoadMeshes();
+		}
+	}
+
+	// the static layer is drawn with OpenGL over the objects the
+	// CPU queues, so it is left out when others draw the opaque ones
+	if ((m_bStaticLayerCache == true) && (NULL != m_pShaderVariants))
+	{
+		if ((NULL != m_pSoftwareRasterizer) || (NULL != m_pGpuCuller))
+		{
+			std::cout << "The static layer cache is not used with software rendering or GPU culling" << std::endl;
+		}
+		else
+		{
+			m_pStaticLayer = new StaticLayerCache();
+			if (m_pStaticLayer->Initialize(
+				m_pShaderVariants->GetShaderCache(),
+				m_layerVertexShaderPath.c_str(),
+				m_layerFragmentShaderPath.c_str()) == false)
+			{
+				std::cout << "Could not build the static layer program, drawing every object each frame" << std::endl;
+				delete m_pStaticLayer;
+				m_pStaticLayer = NULL;
+			}
+		}
+	}
+
+	// the imported meshes are numbered after the basic shapes
+	if (m_modelPath.empty() == false)
+	{
+		LoadModel();
+	}
+
+	// the software rasterizer draws the float versions of the
+	// generated shapes
+	if (NULL != m_pSoftwareRasterizer)
+	{
+		for (int mesh = 0; mesh < CompactMeshes::MESH_COUNT; mesh++)
+		{
+			CompactMeshes::MESH_DATA data;
+			CompactMeshes::BuildMesh(mesh, data);
+			std::vector<glm::vec3> positions(data.vertices.size());
+			std::vector<glm::vec3> normals(data.vertices.size());
+			std::vector<glm::vec2> uvs(data.vertices.size());
+			for (size_t v = 0; v < data.vertices.size(); v++)
+			{
+				positions[v] = data.vertices[v].position;
+				normals[v] = data.vertices[v].normal;
+				uvs[v] = data.vertices[v].uv;
+			}
+			m_pSoftwareRasterizer->SetMesh(mesh, positions, normals, uvs, data.indices);
+		}
+	}
+
+	// add the objects of the hand-built desk
+	AddDesk(m_defaultDesk);
+	AddModelObjects();
+
+	// the assets that finish within the budget are in the first
+	// frame, and the others are swapped in by the later frames
+	if (NULL != m_pAssetLoader)
+	{
+		InstallLoadedAssets(g_FirstFrameBudgetMilliseconds, true);
+		if (NULL != m_pAssetLoader)
+		{
+			std::cout << "Showing the first frame with " << m_pAssetLoader->GetInstalledCount() << " of "
+				<< m_pAssetLoader->GetQueuedCount() << " assets loaded" << std::endl;
+		}
+	}
+}
+
+/***********************************************************
+ *  InstallLoadedAssets()
+ *
+ *  This method is used for swapping in the assets that the
+ *  asset loader finished, within the time budget.  Once every
+ *  asset is swapped in, the loader is stopped and the totals
+ *  of the compressed textures are reported.
+ ***********************************************************/
+void SceneManager::InstallLoadedAssets(double budgetMilliseconds, bool bWait)
+{
+	m_pAssetLoader->InstallFinished(budgetMilliseconds, bWait);
+	if (m_pAssetLoader->IsBusy() == true)
+	{
+		return;
+	}
+
+	std::cout << "Loaded " << m_pAssetLoader->GetInstalledCount() << " of "
+		<< m_pAssetLoader->GetQueuedCount() << " assets in the background" << std::endl;
+	delete m_pAssetLoader;
+	m_pAssetLoader = NULL;
+	if (NULL != m_pTextureCompressor)
+	{
+		m_pTextureCompressor->ReportTotals();
+	}
+}
+
+/***********************************************************
+ *  GenerateStressScene()
+ *
+ *  This method is used for generating a grid of desks that
+ *  replaces the hand-built desk, for finding how the
+ *  rendering scales with the number of objects.  Every desk
+ *  part gets a random material and texture from the defined
+ *  ones, and the lights are spread over the grid, all from a
+ *  seeded generator so that runs are repeatable.
+ ***********************************************************/
+void SceneManager::GenerateStressScene(int columns, int rows, unsigned int seed)
+{
+	std::mt19937 random(seed);
+
+	columns = std::max(columns, 1);
+	rows = std::max(rows, 1);
+	m_entities.Clear();
+	m_objectSerial++;
+	m_staticSerial++;
+	m_bSpatialRebuild = true;
+
+	// tags of everything defined, which are looked up as each
+	// desk is added
+	std::vector<const char*> materialTags;
+	std::vector<const char*> textureTags;
+	for (size_t i = 0; i < m_objectMaterials.size(); i++)
+	{
+		materialTags.push_back(m_objectMaterials[i].tag.c_str());
+	}
+	for (int i = 0; i < m_loadedTextures; i++)
+	{
+		textureTags.push_back(m_textureIDs[i].tag.c_str());
+	}
+	// without any, the parts fall back to the defaults
+	if (materialTags.empty() == true)
+	{
+		materialTags.push_back(g_DefaultDeskMaterials[DESK_SURFACE]);
+	}
+	if (textureTags.empty() == true)
+	{
+		textureTags.push_back(g_DefaultDeskTextures[DESK_SURFACE]);
+	}
+	std::uniform_int_distribution<int> pickMaterial(0, (int)materialTags.size() - 1);
+	std::uniform_int_distribution<int> pickTexture(0, (int)textureTags.size() - 1);
+	std::uniform_int_distribution<int> pickKeyboard(0, KeyboardLayouts::KEYBOARD_LAYOUT_COUNT - 1);
+
+	// the grid is centered on the hand-built desk, and the desks
+	// are laid out first so the objects of their keyboards can be
+	// reserved at once
+	std::vector<DESK_LAYOUT> desks((size_t)columns * rows);
+	size_t objectCount = 0;
+	for (int row = 0; row < rows; row++)
+	{
+		for (int column = 0; column < columns; column++)
+		{
+			DESK_LAYOUT& desk = desks[(size_t)row * columns + column];
+			desk.origin = glm::vec3(
+				(column - (columns - 1) * 0.5f) * g_DeskSpacingX,
+				0.0f,
+				(row - (rows - 1) * 0.5f) * g_DeskSpacingZ);
+			for (int part = 0; part < DESK_PART_COUNT; part++)
+			{
+				desk.materialTags[part] = materialTags[pickMaterial(random)];
+				desk.textureTags[part] = textureTags[pickTexture(random)];
+			}
+			desk.keyboard = (KeyboardLayouts::KEYBOARD_LAYOUT)pickKeyboard(random);
+			objectCount += GetDeskObjectCount(desk.keyboard);
+		}
+	}
+	m_entities.Reserve(objectCount);
+	for (size_t i = 0; i < desks.size(); i++)
+	{
+		AddDesk(desks[i]);
+	}
+
+	// spread the lights over the grid above the desks
+	float halfWidth = columns * g_DeskSpacingX * 0.5f;
+	float halfDepth = rows * g_DeskSpacingZ * 0.5f;
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	for (int i = 0; i < ShaderVariants::TOTAL_LIGHTS; i++)
+	{
+		glm::vec3 color(0.5f + 0.5f * unit(random), 0.5f + 0.5f * unit(random), 0.5f + 0.5f * unit(random));
+		m_lightSources[i].isEnabled = true;
+		m_lightSources[i].position = glm::vec3(
+			(unit(random) * 2.0f - 1.0f) * halfWidth,
+			5.0f + 10.0f * unit(random),
+			(unit(random) * 2.0f - 1.0f) * halfDepth);
+		m_lightSources[i].ambientColor = color * 0.1f;
+		m_lightSources[i].diffuseColor = color;
+		m_lightSources[i].specularColor = color;
+	}
+	m_bUseLighting = true;
+	m_lightSerial++;
+}
+
+/***********************************************************
+ *  GenerateStressObjects()
+ *
+ *  This method is used for generating the smallest square grid
+ *  of desks that holds the passed in number of objects, even
+ *  when every desk gets the keyboard with the fewest keys.
+ *  The objects past the count are removed again from the end.
+ ***********************************************************/
+void SceneManager::GenerateStressObjects(int objectCount, unsigned int seed)
+{
+	objectCount = std::max(objectCount, 1);
+	int fewestPerDesk = GetDeskObjectCount((KeyboardLayouts::KEYBOARD_LAYOUT)0);
+	for (int layout = 1; layout < KeyboardLayouts::KEYBOARD_LAYOUT_COUNT; layout++)
+	{
+		fewestPerDesk = std::min(fewestPerDesk, GetDeskObjectCount((KeyboardLayouts::KEYBOARD_LAYOUT)layout));
+	}
+	int desks = (objectCount + fewestPerDesk - 1) / fewestPerDesk;
+	int columns = (int)std::ceil(std::sqrt((double)desks));
+	int rows = (desks + columns - 1) / columns;
+
+	GenerateStressScene(columns, rows, seed);
+	while (m_entities.GetCount() > objectCount)
+	{
+		m_entities.Remove(m_entities.GetHandle(m_entities.GetCount() - 1));
+	}
+	m_objectSerial++;
+	m_staticSerial++;
+	m_bSpatialRebuild = true;
+}
+
+/***********************************************************
+ *  ClearStressScene()
+ *
+ *  This method is used for returning to the hand-built desk.
+ ***********************************************************/
+void SceneManager::ClearStressScene()
+{
+	m_entities.Clear();
+	m_objectSerial++;
+	m_staticSerial++;
+	m_bSpatialRebuild = true;
+	AddDesk(m_defaultDesk);
+	AddModelObjects();
+	SetupSceneLights();
 }
 
 /***********************************************************
@@ -537,6 +3004,124 @@ void SceneManager::PrepareScene()
  *  transforming and drawing the basic 3D shapes
  ***********************************************************/
 void SceneManager::RenderScene()
+{
+	// everything taken from the arena by the last frame is
+	// released at once, including both queues of a layered frame
+	m_frameArena.Reset();
+
+	// swap in the assets that finished loading since the last
+	// frame, without holding up the frame for the others
+	if (NULL != m_pAssetLoader)
+	{
+		InstallLoadedAssets(g_FrameUploadBudgetMilliseconds, false);
+	}
+
+	// the objects stay resident in the GPU culler until the scene
+	// objects change
+	if ((NULL != m_pGpuCuller) && (m_gpuObjectSerial != m_objectSerial))
+	{
+		UploadGpuObjects();
+	}
+
+	// the static objects come from the cached layer while it
+	// is still current
+	if (NULL != m_pStaticLayer)
+	{
+		RenderLayeredScene();
+		return;
+	}
+
+	// the objects were added once by PrepareScene(), and only
+	// need to be queued for the current view
+	QueueSceneDraws();
+
+	// sort and submit all of the queued draws
+	FlushDrawQueue();
+	m_frameStats.cachedDraws = 0;
+}
+
+/***********************************************************
+ *  RenderLayeredScene()
+ *
+ *  This method is used for rendering the frame from the
+ *  static layer cache.  While the view, the lights, the
+ *  static objects or the viewport size keep changing, every
+ *  object is drawn into the frame as without the cache.  Once
+ *  they have stayed the same for a few frames, the opaque
+ *  static objects are first rendered into the layer.  The
+ *  layer is then copied into the frame, and the dynamic and
+ *  transparent objects are drawn over it.  The counters of
+ *  the frame add up both passes.
+ ***********************************************************/
+void SceneManager::RenderLayeredScene()
+{
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+
+	StaticLayerCache::LAYER_KEY key;
+	key.view = m_viewMatrix;
+	key.projection = m_projectionMatrix;
+	key.viewPosition = m_viewPosition;
+	key.lightSerial = m_lightSerial;
+	key.staticSerial = m_staticSerial;
+	key.width = viewport[2];
+	key.height = viewport[3];
+
+	FRAME_STATS layerStats;
+	memset(&layerStats, 0, sizeof(layerStats));
+	bool bSettled = m_pStaticLayer->TrackKey(key);
+	bool bUpdated = false;
+	if (m_pStaticLayer->IsCurrent(key) == false)
+	{
+		if ((bSettled == false) || (m_pStaticLayer->BeginUpdate(key) == false))
+		{
+			// while the key keeps changing the layer would be
+			// rendered for a single frame, so every object is
+			// drawn into the frame instead
+			QueueSceneDraws(DRAW_ALL);
+			FlushDrawQueue();
+			m_frameStats.cachedDraws = 0;
+			return;
+		}
+		QueueSceneDraws(DRAW_STATIC);
+		FlushDrawQueue();
+		m_pStaticLayer->EndUpdate();
+		layerStats = m_frameStats;
+		m_staticLayerDraws = m_frameStats.queuedDraws;
+		bUpdated = true;
+	}
+
+	m_pStaticLayer->Composite();
+	QueueSceneDraws(DRAW_DYNAMIC);
+	FlushDrawQueue();
+
+	m_frameStats.queuedDraws += layerStats.queuedDraws;
+	m_frameStats.drawCalls += layerStats.drawCalls + 1;
+	m_frameStats.programChanges += layerStats.programChanges + 1;
+	m_frameStats.occlusionCulled += layerStats.occlusionCulled;
+	m_frameStats.frustumCulled += layerStats.frustumCulled;
+	m_frameStats.cachedDraws = (bUpdated == true) ? 0 : m_staticLayerDraws;
+}
+
+/***********************************************************
+ *  GetDeskObjectCount()
+ *
+ *  This method is used for getting the number of objects that
+ *  AddDesk() adds for a desk with the keyboard layout.
+ ***********************************************************/
+int SceneManager::GetDeskObjectCount(KeyboardLayouts::KEYBOARD_LAYOUT layout)
+{
+	return(g_DeskObjectsBesideKeys + KeyboardLayouts::GetKeyboardTable(layout).keyCount);
+}
+
+/***********************************************************
+ *  AddDesk()
+ *
+ *  This method is used for adding the objects of one desk with
+ *  its keyboard, mouse and pumpkin, placed at the origin of
+ *  the layout and using its materials and textures.
+ ***********************************************************/
+void SceneManager::AddDesk(const DESK_LAYOUT& desk)
 {
 	// Declare the variables for the transformations
 	glm::vec3 scaleXYZ;
@@ -547,103 +3132,83 @@ void SceneManager::RenderScene()
 
 	/*** DESK SURFACE ***/
 	scaleXYZ = glm::vec3(20.0f, 0.5f, 10.0f);
-	positionXYZ = glm::vec3(0.0f, -0.25f, 0.0f);
+	positionXYZ = desk.origin + glm::vec3(0.0f, -0.25f, 0.0f);
 	SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-	SetShaderMaterial("deskMaterial");       // Apply desk material for lighting properties
-	SetShaderTexture("deskTexture");         // Apply wood texture to the desk
+	SetShaderMaterial(desk.materialTags[DESK_SURFACE]);   // Apply desk material for lighting properties
+	SetShaderTexture(desk.textureTags[DESK_SURFACE]);     // Apply wood texture to the desk
 	SetTextureUVScale(4.0f, 2.0f);           // Adjust UV scale to avoid stretching
-	m_basicMeshes->DrawPlaneMesh();
+	// the large shapes are occluders for culling the hidden objects
+	AddSceneObject(MESH_PLANE, true);
 
 	/*** KEYBOARD ***/
 	float keyboardXPosition = -5.0f;
 
+	// the base is grown from the hand-built size to fit the keys
+	KeyboardLayouts::KEYBOARD_TABLE keyboard = KeyboardLayouts::GetKeyboardTable(desk.keyboard);
+	float keyboardWidth = std::max(7.0f,
+		(keyboard.width * g_KeySpacing) - (g_KeySpacing - g_KeyWidth) + g_KeyboardBorder);
+	float keyboardDepth = std::max(3.0f,
+		(keyboard.depth * g_KeySpacing) - (g_KeySpacing - g_KeyDepth) + g_KeyboardBorder);
+
 	/*** KEYBOARD - Base ***/
-	scaleXYZ = glm::vec3(7.0f, 0.2f, 3.0f);
-	positionXYZ = glm::vec3(keyboardXPosition, 0.1f, 0.0f);
+	scaleXYZ = glm::vec3(keyboardWidth, 0.2f, keyboardDepth);
+	positionXYZ = desk.origin + glm::vec3(keyboardXPosition, 0.1f, 0.0f);
 	SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-	SetShaderMaterial("keyboardMaterial");    // Apply keyboard material for lighting
-	SetShaderTexture("keyboardBaseTexture");  // Apply dark texture to keyboard base
+	SetShaderMaterial(desk.materialTags[DESK_KEYBOARD]);  // Apply keyboard material for lighting
+	SetShaderTexture(desk.textureTags[DESK_KEYBOARD]);    // Apply dark texture to keyboard base
 	SetTextureUVScale(2.0f, 1.0f);
-	m_basicMeshes->DrawBoxMesh();
+	AddSceneObject(MESH_BOX, true);
 
 	/*** KEYBOARD - Accent Trim ***/
-	scaleXYZ = glm::vec3(7.2f, 0.05f, 3.2f);
-	positionXYZ = glm::vec3(keyboardXPosition, 0.05f, 0.0f);
+	scaleXYZ = glm::vec3(keyboardWidth + 0.2f, 0.05f, keyboardDepth + 0.2f);
+	positionXYZ = desk.origin + glm::vec3(keyboardXPosition, 0.05f, 0.0f);
 	SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-	SetShaderMaterial("keyboardMaterial");    // Apply keyboard material
+	SetShaderMaterial(desk.materialTags[DESK_KEYBOARD]);  // Apply keyboard material
 	SetShaderColor(0.7f, 0.7f, 0.7f, 1.0f);   // Silver trim without texture
-	m_basicMeshes->DrawBoxMesh();
-
-	// Define key dimensions and spacing
-	float keyWidth = 0.45f;
-	float keyHeight = 0.15f;
-	float keyDepth = 0.45f;
-	float keySpacingX = 0.55f;
-	float keySpacingZ = 0.55f;
-
-	// Calculate keyboard dimensions
-	float keyboardWidth = 7.0f;
-	float keyboardDepth = 3.0f;
+	AddSceneObject(MESH_BOX);
 
 	// Calculate starting position for first key (top left of the keyboard)
-	float startX = keyboardXPosition - (keyboardWidth / 2) + (keyWidth / 2) + 0.3f;
-	float startZ = -(keyboardDepth / 2) + (keyDepth / 2) + 0.3f;
-	float keyY = 0.2f + (keyHeight / 2); // Position on top of keyboard base
-
-	// Number of keys in each row
-	int keysPerRow = 12;
-	int rows = 4;
+	float startX = keyboardXPosition - (keyboardWidth / 2) + (g_KeyWidth / 2) + g_KeyboardInset;
+	float startZ = -(keyboardDepth / 2) + (g_KeyDepth / 2) + g_KeyboardInset;
+	float keyY = 0.2f + (g_KeyHeight / 2); // Position on top of keyboard base
 
 	// Set material and texture for keys
-	SetShaderMaterial("keyCapMaterial");     // Apply key cap material for lighting
-	SetShaderTexture("keyCapTexture");       // Apply texture to keys
-	SetTextureUVScale(1.0f, 1.0f);
-
-	// Draw all keys
-	for (int row = 0; row < rows; row++) {
-		for (int col = 0; col < keysPerRow; col++) {
-			// Skip positions for spacebar
-			if (row == 3 && col > 2 && col < 9) {
-				continue;
-			}
+	SetShaderMaterial(desk.materialTags[DESK_KEYS]);      // Apply key cap material for lighting
+	SetShaderTexture(desk.textureTags[DESK_KEYS]);        // Apply texture to keys
 
-			scaleXYZ = glm::vec3(keyWidth, keyHeight, keyDepth);
-			positionXYZ = glm::vec3(startX + (col * keySpacingX), keyY, startZ + (row * keySpacingZ));
-
-			SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-			m_basicMeshes->DrawBoxMesh();
-		}
+	// place the keys from the compile-time layout table, with the
+	// texture repeated once per key unit
+	for (int i = 0; i < keyboard.keyCount; i++)
+	{
+		const KeyboardLayouts::KEY_INSTANCE& key = keyboard.pKeys[i];
+		m_pendingDraw.model =
+			glm::translate(desk.origin + glm::vec3(startX + (key.x * g_KeySpacing), keyY, startZ + (key.z * g_KeySpacing))) *
+			glm::scale(glm::vec3(key.width * g_KeyWidth, g_KeyHeight, key.depth * g_KeyDepth));
+		SetTextureUVScale(key.width, key.depth);
+		AddSceneObject(MESH_BOX);
 	}
 
-	// Add a larger spacebar with texture and material
-	scaleXYZ = glm::vec3(keyWidth * 6, keyHeight, keyDepth);
-	positionXYZ = glm::vec3(startX + (5.5f * keySpacingX), keyY, startZ + (3 * keySpacingZ));
-	SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-	SetShaderMaterial("keyCapMaterial");     // Apply same material as other keys
-	SetTextureUVScale(6.0f, 1.0f);
-	m_basicMeshes->DrawBoxMesh();
-
 	/*** MOUSE ***/
 	float mouseXPosition = 1.0f;
 	float mouseZPosition = 0.0f;
 
 	// Mouse base (main body) with material and texture
 	scaleXYZ = glm::vec3(1.8f, 0.6f, 2.5f);
-	positionXYZ = glm::vec3(mouseXPosition, 0.3f, mouseZPosition);
+	positionXYZ = desk.origin + glm::vec3(mouseXPosition, 0.3f, mouseZPosition);
 	SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-	SetShaderMaterial("mouseMaterial");      // Apply mouse material for lighting
-	SetShaderTexture("mouseTexture");
+	SetShaderMaterial(desk.materialTags[DESK_MOUSE]);     // Apply mouse material for lighting
+	SetShaderTexture(desk.textureTags[DESK_MOUSE]);
 	SetTextureUVScale(1.0f, 1.0f);
-	m_basicMeshes->DrawBoxMesh();
+	AddSceneObject(MESH_BOX, true);
 
 	// Mouse top with material and texture
 	scaleXYZ = glm::vec3(1.8f, 0.4f, 2.5f);
-	positionXYZ = glm::vec3(mouseXPosition, 0.65f, mouseZPosition);
+	positionXYZ = desk.origin + glm::vec3(mouseXPosition, 0.65f, mouseZPosition);
 	SetTransformations(scaleXYZ, 0.0f, 0.0f, 0.0f, positionXYZ);
-	SetShaderMaterial("mouseMaterial");      // Apply mouse material for lighting
-	SetShaderTexture("mouseTexture");
+	SetShaderMaterial(desk.materialTags[DESK_MOUSE]);     // Apply mouse material for lighting
+	SetShaderTexture(desk.textureTags[DESK_MOUSE]);
 	SetTextureUVScale(1.0f, 0.5f);
-	m_basicMeshes->DrawSphereMesh();
+	AddSceneObject(MESH_SPHERE);
 
 	/*** HALLOWEEN GADGET ***/
 	float pumpkinXPosition = 7.0f;
@@ -651,19 +3216,20 @@ void SceneManager::RenderScene()
 
 	// Base cylinder with pumpkin texture and material
 	scaleXYZ = glm::vec3(1.2f, 1.5f, 1.2f);
-	positionXYZ = glm::vec3(pumpkinXPosition, 0.75f, pumpkinZPosition);
+	positionXYZ = desk.origin + glm::vec3(pumpkinXPosition, 0.75f, pumpkinZPosition);
 	SetTransformations(scaleXYZ, 0.0f, 0.0f, 0.0f, positionXYZ);
-	SetShaderMaterial("pumpkinMaterial");    // Apply pumpkin material for lighting
-	SetShaderTexture("pumpkinTexture");      // Use pumpkin texture for the base
+	SetShaderMaterial(desk.materialTags[DESK_PUMPKIN_BASE]); // Apply pumpkin material for lighting
+	SetShaderTexture(desk.textureTags[DESK_PUMPKIN_BASE]);   // Use pumpkin texture for the base
 	SetTextureUVScale(1.0f, 1.0f);
-	m_basicMeshes->DrawCylinderMesh();
+	AddSceneObject(MESH_CYLINDER);
 
 	// Top sphere (pumpkin head) with material and texture
 	scaleXYZ = glm::vec3(1.3f, 1.3f, 1.3f);
-	positionXYZ = glm::vec3(pumpkinXPosition, 2.0f, pumpkinZPosition);
+	positionXYZ = desk.origin + glm::vec3(pumpkinXPosition, 2.0f, pumpkinZPosition);
 	SetTransformations(scaleXYZ, 0.0f, 0.0f, 0.0f, positionXYZ);
-	SetShaderMaterial("pumpkinMaterial");    // Apply pumpkin material for lighting
-	SetShaderTexture("mouseTexture");        // Same texture as mouse
+	SetShaderMaterial(desk.materialTags[DESK_PUMPKIN_HEAD]); // Apply pumpkin material for lighting
+	SetShaderTexture(desk.textureTags[DESK_PUMPKIN_HEAD]);   // Same texture as mouse
 	SetTextureUVScale(1.0f, 1.0f);
-	m_basicMeshes->DrawSphereMesh();
+	AddSceneObject(MESH_SPHERE, true);
+
 }
\ No newline at end of file
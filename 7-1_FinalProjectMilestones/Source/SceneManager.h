@@ -9,9 +9,26 @@
 
 #pragma once
 
-#include "ShaderManager.h"
+#include "ShaderVariants.h"
 #include "ShapeMeshes.h"
+#include "CompactMeshes.h"
+#include "OcclusionCuller.h"
+#include "BoundingVolumeHierarchy.h"
+#include "EntityStore.h"
+#include "FrameArena.h"
+#include "KeyboardLayouts.h"
+#include "SoftwareRasterizer.h"
+#include "RenderTarget.h"
+#include "TextureCompressor.h"
+#include "GpuResources.h"
+#include "GpuCuller.h"
+#include "InstancedDraws.h"
+#include "ImportedMeshes.h"
+#include "StaticLayerCache.h"
+#include "AssetLoader.h"
 
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -25,7 +42,7 @@ class SceneManager
 {
 public:
 	// constructor
-	SceneManager(ShaderManager *pShaderManager);
+	SceneManager(ShaderVariants *pShaderVariants);
 	// destructor
 	~SceneManager();
 
@@ -33,6 +50,11 @@ public:
 	{
 		std::string tag;
 		uint32_t ID;
+		// true when some of the pixels are see-through
+		bool bHasAlpha;
+		// owner of the texture, shared with the other tags that
+		// loaded the same image
+		std::shared_ptr<GpuTexture> texture;
 	};
 
 	struct OBJECT_MATERIAL
@@ -45,29 +67,316 @@ public:
 		std::string tag;
 	};
 
+	struct LIGHT_SOURCE
+	{
+		glm::vec3 position;
+		glm::vec3 ambientColor;
+		glm::vec3 diffuseColor;
+		glm::vec3 specularColor;
+		bool isEnabled;
+	};
+
+	// basic shapes that can be drawn, followed by the meshes of the
+	// imported model
+	enum MESH_TYPE
+	{
+		MESH_PLANE,
+		MESH_BOX,
+		MESH_SPHERE,
+		MESH_CYLINDER,
+		MESH_CONE,
+		MESH_FIRST_IMPORTED
+	};
+
+	// shader settings for one queued draw
+	struct DRAW_COMMAND
+	{
+		glm::mat4 model;
+		glm::vec4 color;
+		glm::vec2 uvScale;
+		int mesh;
+		int materialIndex;
+		int textureSlot;
+		bool bUseTexture;
+		// true when the draw needs blending with the scene behind it
+		bool bTransparent;
+		// true when the draw hides the objects behind it from the
+		// occlusion culling
+		bool bOccluder;
+		unsigned int variantFlags;
+		uint64_t sortKey;
+		// low bits of the ids that did not fit into the sort key,
+		// which order the draws that share a key
+		uint64_t tieKey;
+	};
+
+	// consecutive sorted draws that are drawn as instances of one
+	// mesh, stored at the position of the first draw
+	struct INSTANCE_RUN
+	{
+		// draws in the run, or zero when the draw is not instanced
+		uint32_t count;
+		uint32_t firstInstance;
+	};
+
+	// objects queued by a pass over the scene
+	enum DRAW_LAYER
+	{
+		DRAW_ALL,
+		// the opaque objects that never moved, which are kept by
+		// the static layer cache
+		DRAW_STATIC,
+		// everything else, drawn on top of the cached layer
+		DRAW_DYNAMIC
+	};
+
+	// counters for the most recently rendered frame
+	struct FRAME_STATS
+	{
+		// draws queued by the scene
+		int queuedDraws;
+		// draw calls submitted, including the depth prepass
+		int drawCalls;
+		// shader program switches
+		int programChanges;
+		// draws skipped by the occlusion culling
+		int occlusionCulled;
+		int frustumCulled;
+		// CPU time of the stages of flushing the draw queue
+		float indexMilliseconds;
+		float cullMilliseconds;
+		float sortMilliseconds;
+		float submitMilliseconds;
+		// transient memory taken from the frame arena
+		size_t arenaBytes;
+		// static draws copied from the static layer cache instead
+		// of being drawn again
+		int cachedDraws;
+	};
+
+	// parts of a desk that are given their own material and texture
+	enum DESK_PART
+	{
+		DESK_SURFACE,
+		DESK_KEYBOARD,
+		DESK_KEYS,
+		DESK_MOUSE,
+		DESK_PUMPKIN_BASE,
+		DESK_PUMPKIN_HEAD,
+		DESK_PART_COUNT
+	};
+
+	// placement and look of one desk in the scene
+	struct DESK_LAYOUT
+	{
+		glm::vec3 origin;
+		KeyboardLayouts::KEYBOARD_LAYOUT keyboard;
+		const char* materialTags[DESK_PART_COUNT];
+		const char* textureTags[DESK_PART_COUNT];
+	};
+
+	// placement and look of one mesh of the imported model
+	struct MODEL_OBJECT
+	{
+		glm::mat4 model;
+		glm::vec4 color;
+		int mesh;
+		int materialIndex;
+	};
+
+	// object found under a picking ray
+	struct PICK_RESULT
+	{
+		EntityStore::ENTITY_HANDLE entity;
+		int mesh;
+		// distance along the ray in world units
+		float distance;
+		glm::vec3 position;
+	};
+
 private:
-	// pointer to shader manager object
-	ShaderManager* m_pShaderManager;
+	// the microbenchmarks fill the texture and material tables and
+	// time the lookups directly
+	friend class HotPathBenchmarks;
+
+	// pointer to the general and the specialized shader programs
+	ShaderVariants* m_pShaderVariants;
 	// pointer to basic shapes object
 	ShapeMeshes* m_basicMeshes;
+	// basic shapes with quantized vertices, when enabled
+	CompactMeshes* m_pCompactMeshes;
+	bool m_bCompactMeshes;
+	// encoder for the block-compressed textures, when enabled
+	TextureCompressor* m_pTextureCompressor;
+	bool m_bTextureCompression;
+	std::string m_textureCacheDirectory;
 	// total number of loaded textures
 	int m_loadedTextures;
 	// loaded textures info
 	TEXTURE_INFO m_textureIDs[16];
 	// defined object materials
 	std::vector<OBJECT_MATERIAL> m_objectMaterials;
+	// configured light sources
+	LIGHT_SOURCE m_lightSources[ShaderVariants::TOTAL_LIGHTS];
+	bool m_bUseLighting;
+	// incremented whenever the light sources change
+	unsigned int m_lightSerial;
+	// view settings for the frame being rendered
+	glm::mat4 m_viewMatrix;
+	glm::mat4 m_projectionMatrix;
+	glm::vec3 m_viewPosition;
+	// incremented whenever the view settings change
+	unsigned int m_viewSerial;
+	// shader settings collected for the next queued draw
+	DRAW_COMMAND m_pendingDraw;
+	// transient memory for the draw queue, reset every frame
+	FrameArena m_frameArena;
+	// draws queued for sorting and submission, held in the arena
+	DRAW_COMMAND* m_pDrawQueue;
+	size_t m_drawCount;
+	// positions of the queued draws in the order of their sort keys
+	uint32_t* m_pDrawOrder;
+	// bits of the tie keys of the queued draws, zero while the ids
+	// fit into the sort keys
+	int m_tieKeyBits;
+	// runs of the sorted draws in the order of the draws, held in
+	// the arena, when they are drawn instanced
+	INSTANCE_RUN* m_pInstanceRuns;
+	// instanced drawing of the runs of draws that share their
+	// variant, mesh and texture, when enabled
+	InstancedDraws* m_pInstancedDraws;
+	bool m_bInstancedDraws;
+	// true to lay down the opaque depth before shading
+	bool m_bDepthPrepass;
+	// counters for the most recently rendered frame
+	FRAME_STATS m_frameStats;
+	// CPU rasterizer drawing the scene instead of OpenGL, when
+	// enabled, and the target its frames are uploaded into
+	SoftwareRasterizer* m_pSoftwareRasterizer;
+	bool m_bSoftwareRendering;
+	int m_softwareThreads;
+	RenderTarget m_softwareTarget;
+	// CPU depth buffer for culling the hidden draws
+	OcclusionCuller m_occlusionCuller;
+	bool m_bOcclusionCulling;
+	// compute culling and indirect draws of the opaque objects,
+	// when enabled, with the files of its compute shaders
+	GpuCuller* m_pGpuCuller;
+	bool m_bGpuCulling;
+	bool m_bGpuOcclusion;
+	std::string m_cullShaderPath;
+	std::string m_pyramidShaderPath;
+	// object serial of the objects resident in the GPU culler
+	unsigned int m_gpuObjectSerial;
+	// color and depth of the static objects for the current view,
+	// when enabled, with the files of its shaders
+	StaticLayerCache* m_pStaticLayer;
+	bool m_bStaticLayerCache;
+	std::string m_layerVertexShaderPath;
+	std::string m_layerFragmentShaderPath;
+	// draws kept by the static layer at its last update
+	int m_staticLayerDraws;
+	// meshes of the imported model, when one is set, with the
+	// objects that place them on the hand-built desk
+	ImportedMeshes* m_pImportedMeshes;
+	std::string m_modelPath;
+	float m_modelScale;
+	std::vector<MODEL_OBJECT> m_modelObjects;
+	// objects of the scene, built once and drawn every frame
+	EntityStore m_entities;
+	// incremented whenever objects are added, moved or removed
+	unsigned int m_objectSerial;
+	// incremented whenever the objects of the static layer change,
+	// which is not when the dynamic objects move
+	unsigned int m_staticSerial;
+	// spatial index over the world bounds of the objects, with
+	// the items in the order of the entity arrays
+	BoundingVolumeHierarchy m_spatialIndex;
+	std::vector<BoundingVolumeHierarchy::BOUNDS> m_spatialBounds;
+	// true when objects were added or removed since the index was
+	// built, and the objects moved since it was last refit
+	bool m_bSpatialRebuild;
+	std::vector<int> m_spatialMoved;
+	// the hand-built desk, used when no stress scene is set up
+	DESK_LAYOUT m_defaultDesk;
+	// background loading of the textures and model while the
+	// first frames are shown, when enabled, which is deleted once
+	// every asset is swapped in
+	AssetLoader* m_pAssetLoader;
+	bool m_bProgressiveLoading;
+	// 1x1 texture held by the texture slots until their images load
+	std::shared_ptr<GpuTexture> m_placeholderTexture;
+
+	// pixels of a texture image and its encoded levels, ready
+	// for uploading
+	struct DECODED_TEXTURE
+	{
+		std::string filename;
+		std::vector<unsigned char> pixels;
+		int width;
+		int height;
+		int channels;
+		// true when some of the pixels are see-through
+		bool bHasAlpha;
+		// key of the pixels and settings, for sharing the texture
+		uint64_t contentKey;
+		TextureCompressor::TEXTURE_FORMAT format;
+		TextureCompressor::QUALITY quality;
+		// true once the encoding was tried, and when it succeeded
+		bool bEncodeTried;
+		bool bEncoded;
+		TextureCompressor::COMPRESSED_TEXTURE compressed;
+	};
 
-	// load texture images and convert to OpenGL texture data
-	bool CreateGLTexture(const char* filename, std::string tag);
+	// model imported in the background, while it is uploaded
+	// over several frames
+	struct MODEL_UPLOAD
+	{
+		ModelImporter::MODEL model;
+		// true once the buffers of the model are laid out
+		bool bStarted;
+		// next mesh copied into the software rasterizer
+		size_t rasterizerMesh;
+	};
+
+	// load texture images and convert to OpenGL texture data, in
+	// the block-compressed format when compression is enabled
+	bool CreateGLTexture(
+		const char* filename,
+		const char* tag,
+		TextureCompressor::TEXTURE_FORMAT format = TextureCompressor::FORMAT_AUTO,
+		TextureCompressor::QUALITY quality = TextureCompressor::QUALITY_FAST);
+	// read the pixels of the image file, and encode them when
+	// compression is enabled, without any OpenGL calls
+	bool DecodeTexture(
+		const char* filename,
+		TextureCompressor::TEXTURE_FORMAT format,
+		TextureCompressor::QUALITY quality,
+		DECODED_TEXTURE& decoded);
+	void EncodeTexture(DECODED_TEXTURE& decoded);
+	// upload the decoded image into the texture slot
+	void InstallTexture(DECODED_TEXTURE& decoded, int slot, const char* tag);
+	// fill the next texture slot with the placeholder and load the
+	// image file in the background, false when the slots are full
+	bool QueueTexture(
+		const char* filename,
+		const char* tag,
+		TextureCompressor::TEXTURE_FORMAT format,
+		TextureCompressor::QUALITY quality);
+	// upload the texture held by the slots while they load
+	void CreatePlaceholderTexture();
+	// swap in the assets finished by the asset loader
+	void InstallLoadedAssets(double budgetMilliseconds, bool bWait);
 	// bind loaded OpenGL textures to slots in memory
 	void BindGLTextures();
 	// free the loaded OpenGL textures
 	void DestroyGLTextures();
 	// find a loaded texture by tag
-	int FindTextureID(std::string tag);
-	int FindTextureSlot(std::string tag);
+	int FindTextureID(const char* tag);
+	int FindTextureSlot(const char* tag);
 	// find a defined material by tag
-	bool FindMaterial(std::string tag, OBJECT_MATERIAL& material);
+	bool FindMaterial(const char* tag, OBJECT_MATERIAL& material);
+	int FindMaterialIndex(const char* tag);
 
 	// set the transformation values 
 	// into the transform buffer
@@ -87,7 +396,7 @@ private:
 
 	// set the texture data into the shader
 	void SetShaderTexture(
-		std::string textureTag);
+		const char* textureTag);
 
 	// set the UV scale for the texture mapping
 	void SetTextureUVScale(
@@ -95,9 +404,174 @@ private:
 
 	// set the object material into the shader
 	void SetShaderMaterial(
-		std::string materialTag);
+		const char* materialTag);
+
+	// add an object drawing the mesh with the current shader
+	// settings, optionally as an occluder for the occlusion culling
+	EntityStore::ENTITY_HANDLE AddSceneObject(int mesh, bool bOccluder = false);
+	// queue a draw of every object in the layer of the scene
+	void QueueSceneDraws(DRAW_LAYER layer = DRAW_ALL);
+	// draw the moving objects over the static layer cache, which
+	// is rendered again first when it is out of date
+	void RenderLayeredScene();
+	// remove the queued draws that are hidden by the occluders
+	void CullOccludedDraws();
+	// rebuild or refit the spatial index for the scene objects
+	void UpdateSpatialIndex();
+	// number of objects added for a desk with the keyboard layout
+	static int GetDeskObjectCount(KeyboardLayouts::KEYBOARD_LAYOUT layout);
+	// add the objects of one desk and the things on it
+	void AddDesk(const DESK_LAYOUT& desk);
+	// import the model file and upload its meshes and materials
+	void LoadModel();
+	// upload the meshes and materials of the imported model
+	bool InstallModel(const ModelImporter::MODEL& model);
+	// make the next step of uploading the model imported in the
+	// background
+	AssetLoader::INSTALL_STATUS InstallModelStep(MODEL_UPLOAD& upload);
+	// copy a mesh of the imported model into the software rasterizer
+	void CopyModelMeshToRasterizer(const ModelImporter::MODEL& model, size_t mesh);
+	// add the materials of the uploaded model and place its meshes
+	void PlaceModel(const ModelImporter::MODEL& model);
+	// add the objects of the imported model
+	void AddModelObjects();
+	// sort and submit the queued draws
+	void FlushDrawQueue();
+	// order the queued draws by their sort keys
+	void SortDrawQueue();
+	// find the runs of a range of the sorted draws that can be
+	// drawn instanced, and collect their instances
+	void FindInstanceRuns(size_t first, size_t last);
+	// submit a range of the sorted draws
+	void SubmitDraws(size_t first, size_t last, bool bDepthOnly);
+	// upload the opaque objects into the GPU culler
+	void UploadGpuObjects();
+	// draw the opaque objects that passed the GPU culling
+	void SubmitGpuDraws(bool bDepthOnly);
+	// render the sorted draws with the software rasterizer and
+	// copy the frame into the bound framebuffer
+	void RenderSoftwareDraws();
+	// draw the passed in basic shape or imported mesh, from the
+	// compact meshes when the bound program decodes them
+	void DrawMesh(int mesh, bool bCompact);
+	// upload the view and light settings into the shader variant
+	void ApplyViewSettings(ShaderVariants::SHADER_VARIANT* pVariant);
+	void ApplyLightSources(ShaderVariants::SHADER_VARIANT* pVariant);
+	// upload the material into the shader variant
+	void ApplyMaterial(ShaderVariants::SHADER_VARIANT* pVariant, int materialIndex);
 
 public:
+	// set the view settings used for rendering the next frame
+	void SetSceneView(
+		const glm::mat4& view,
+		const glm::mat4& projection,
+		const glm::vec3& viewPosition);
+	// enable the depth-only prepass for the opaque draws
+	void SetDepthPrepass(bool bEnable) { m_bDepthPrepass = bEnable; }
+	// enable the culling of draws hidden by the occluders
+	void SetOcclusionCulling(bool bEnable) { m_bOcclusionCulling = bEnable; }
+	// draw the runs of sorted draws that share their state as
+	// instances, which must be chosen before the scene is prepared
+	void SetInstancedDraws(bool bEnable) { m_bInstancedDraws = bEnable; }
+	// draw the basic shapes with the quantized vertex layout,
+	// which must be chosen before the scene is prepared
+	void SetCompactMeshes(bool bEnable) { m_bCompactMeshes = bEnable; }
+	// render with the CPU rasterizer instead of OpenGL, on the
+	// number of threads or every core when it is zero, which must
+	// be chosen before the scene is prepared
+	void SetSoftwareRendering(bool bEnable, int threadCount = 0)
+	{
+		m_bSoftwareRendering = bEnable;
+		m_softwareThreads = threadCount;
+	}
+	// encode the textures into compressed blocks cached in the
+	// directory, which must be chosen before the scene is prepared
+	void SetTextureCompression(bool bEnable, const char* cacheDirectory)
+	{
+		m_bTextureCompression = bEnable;
+		m_textureCacheDirectory = cacheDirectory;
+	}
+	// cull and draw the opaque objects on the GPU, optionally also
+	// against the depth of the previous frame, with the compute
+	// shaders from the files, which must be chosen before the scene
+	// is prepared
+	void SetGpuCulling(
+		bool bEnable,
+		bool bOcclusion,
+		const char* cullFilePath,
+		const char* pyramidFilePath)
+	{
+		m_bGpuCulling = bEnable;
+		m_bGpuOcclusion = bOcclusion;
+		m_cullShaderPath = cullFilePath;
+		m_pyramidShaderPath = pyramidFilePath;
+	}
+	// keep the static objects rendered while the view, lights and
+	// static objects do not change, copying them into each frame
+	// with the shaders from the files, which must be chosen before
+	// the scene is prepared
+	void SetStaticLayerCache(
+		bool bEnable,
+		const char* vertexFilePath,
+		const char* fragmentFilePath)
+	{
+		m_bStaticLayerCache = bEnable;
+		m_layerVertexShaderPath = vertexFilePath;
+		m_layerFragmentShaderPath = fragmentFilePath;
+	}
+	// place the model from the .obj or .glb file on the desk, at the
+	// scale or fitted to the desk when it is zero, which must be
+	// chosen before the scene is prepared
+	void SetModel(const char* filePath, float scale)
+	{
+		m_modelPath = filePath;
+		m_modelScale = scale;
+	}
+	// show the first frame with placeholder textures and load the
+	// textures and model in the background, swapping them in as
+	// they finish, which must be chosen before the scene is prepared
+	void SetProgressiveLoading(bool bEnable) { m_bProgressiveLoading = bEnable; }
+	// true while assets are still being loaded in the background
+	bool IsLoading() const { return(NULL != m_pAssetLoader); }
+	// get the software rasterizer, or NULL when rendering with OpenGL
+	const SoftwareRasterizer* GetSoftwareRasterizer() const { return(m_pSoftwareRasterizer); }
+	// get the counters for the most recently rendered frame
+	const FRAME_STATS& GetFrameStats() const { return(m_frameStats); }
+
+	// find the nearest object hit by the world space ray
+	bool PickObject(
+		const glm::vec3& origin,
+		const glm::vec3& direction,
+		PICK_RESULT& result);
+	// collect the objects whose world bounds overlap the box
+	void QueryObjectsInBox(
+		const glm::vec3& boxMin,
+		const glm::vec3& boxMax,
+		std::vector<EntityStore::ENTITY_HANDLE>& objects);
+	// get the display name of the basic shape mesh
+	static const char* GetMeshName(int mesh);
+
+	// replace the hand-built desk with a grid of generated desks,
+	// with the materials, textures and lights picked by the seed
+	void GenerateStressScene(int columns, int rows, unsigned int seed);
+	// generate just enough desks for the number of objects
+	void GenerateStressObjects(int objectCount, unsigned int seed);
+	// return to the hand-built desk and its lights
+	void ClearStressScene();
+	// get the number of objects drawn each frame
+	int GetSceneObjectCount() const { return(m_entities.GetCount()); }
+	// get the number of meshes that objects can be drawn with, the
+	// basic shapes and the meshes of the imported model
+	int GetLoadedMeshCount() const
+	{
+		return(MESH_FIRST_IMPORTED + ((NULL != m_pImportedMeshes) ? m_pImportedMeshes->GetMeshCount() : 0));
+	}
+
+	// move the object, returning false when it no longer exists
+	bool SetObjectTransform(EntityStore::ENTITY_HANDLE entity, const glm::mat4& model);
+	// remove the object from the scene
+	bool RemoveObject(EntityStore::ENTITY_HANDLE entity);
+
 
 	// The following methods are for the students to 
 	// customize for their own 3D scene
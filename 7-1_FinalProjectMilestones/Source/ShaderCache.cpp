@@ -0,0 +1,490 @@
+///////////////////////////////////////////////////////////////////////////////
+// shadercache.cpp
+// ============
+// compile GLSL shader programs and cache the linked program binaries on
+// disk so that later launches can skip the compile and link steps
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ShaderCache.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+// declaration of global variables
+namespace
+{
+	// identifies the cached program binary files
+	const char g_CacheMagic[4] = { 'S', 'B', 'I', 'N' };
+	const uint32_t g_CacheVersion = 1;
+
+	// header stored in front of every cached program binary
+	struct CACHE_HEADER
+	{
+		char magic[4];
+		uint32_t version;
+		uint64_t key;
+		uint32_t binaryFormat;
+		uint32_t binaryLength;
+		float compileMilliseconds;
+	};
+
+	// FNV-1a hash used for building the cache key
+	uint64_t HashBytes(uint64_t hash, const void* pData, size_t size)
+	{
+		const unsigned char* pBytes = (const unsigned char*)pData;
+		for (size_t i = 0; i < size; i++)
+		{
+			hash ^= pBytes[i];
+			hash *= 1099511628211ULL;
+		}
+		return(hash);
+	}
+
+	uint64_t HashString(uint64_t hash, const char* pText)
+	{
+		// the terminator is hashed too so that the fields stay separated
+		if (NULL == pText)
+		{
+			pText = "";
+		}
+		return(HashBytes(hash, pText, strlen(pText) + 1));
+	}
+
+	// get the elapsed milliseconds since the passed in time
+	float ElapsedMilliseconds(std::chrono::steady_clock::time_point start)
+	{
+		std::chrono::duration<float, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+		return(elapsed.count());
+	}
+}
+
+/***********************************************************
+ *  ShaderCache()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ShaderCache::ShaderCache(const char* cacheDirectory)
+{
+	m_cacheDirectory = cacheDirectory;
+	m_bBinariesSupported = false;
+}
+
+/***********************************************************
+ *  ~ShaderCache()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ShaderCache::~ShaderCache()
+{
+}
+
+/***********************************************************
+ *  LoadProgram()
+ *
+ *  This method is used for building a shader program from
+ *  the passed in GLSL files.  A cached program binary is used
+ *  when one exists for the same sources, defines and driver,
+ *  otherwise the program is compiled, linked and cached.
+ ***********************************************************/
+GLuint ShaderCache::LoadProgram(
+	const char* vertexFilePath,
+	const char* fragmentFilePath,
+	const std::string& defines)
+{
+	std::string vertexSource;
+	std::string fragmentSource;
+	if ((ReadSourceFile(vertexFilePath, vertexSource) == false) ||
+		(ReadSourceFile(fragmentFilePath, fragmentSource) == false))
+	{
+		return(0);
+	}
+	vertexSource = InsertDefines(vertexSource, defines);
+	fragmentSource = InsertDefines(fragmentSource, defines);
+
+	return(BuildProgram(vertexSource, fragmentSource, defines));
+}
+
+/***********************************************************
+ *  LoadComputeProgram()
+ *
+ *  This method is used for building a compute program from
+ *  the passed in GLSL file, cached the same way as the
+ *  vertex and fragment programs.
+ ***********************************************************/
+GLuint ShaderCache::LoadComputeProgram(
+	const char* computeFilePath,
+	const std::string& defines)
+{
+	std::string computeSource;
+	if (ReadSourceFile(computeFilePath, computeSource) == false)
+	{
+		return(0);
+	}
+	computeSource = InsertDefines(computeSource, defines);
+
+	return(BuildProgram(computeSource, std::string(), defines));
+}
+
+/***********************************************************
+ *  BuildProgram()
+ *
+ *  This method is used for creating the program from the
+ *  prepared sources, from a cached binary when one exists
+ *  for the same sources, defines and driver.
+ ***********************************************************/
+GLuint ShaderCache::BuildProgram(
+	const std::string& firstSource,
+	const std::string& fragmentSource,
+	const std::string& defines)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	// program binaries need at least one binary format from the driver
+	GLint numFormats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+	m_bBinariesSupported = (numFormats > 0);
+
+	uint64_t key = CalculateKey(firstSource, fragmentSource, defines);
+
+	if (m_bBinariesSupported == true)
+	{
+		float compileMilliseconds = 0.0f;
+		GLuint programID = LoadCachedProgram(key, compileMilliseconds);
+		if (programID != 0)
+		{
+			std::cout << "Shader program loaded from cache in " << ElapsedMilliseconds(start)
+				<< " ms (compile and link took " << compileMilliseconds << " ms)" << std::endl;
+			return(programID);
+		}
+	}
+
+	std::chrono::steady_clock::time_point compileStart = std::chrono::steady_clock::now();
+	GLuint programID = CompileProgram(firstSource, fragmentSource);
+	if (programID == 0)
+	{
+		return(0);
+	}
+	float compileMilliseconds = ElapsedMilliseconds(compileStart);
+
+	std::cout << "Shader program compiled and linked in " << compileMilliseconds << " ms" << std::endl;
+
+	if (m_bBinariesSupported == true)
+	{
+		SaveCachedProgram(key, programID, compileMilliseconds);
+	}
+	else
+	{
+		std::cout << "Shader program binaries are not supported by the driver, cache disabled" << std::endl;
+	}
+
+	return(programID);
+}
+
+/***********************************************************
+ *  ReadSourceFile()
+ *
+ *  This method is used for reading a shader source file.
+ ***********************************************************/
+bool ShaderCache::ReadSourceFile(const char* filePath, std::string& source)
+{
+	std::ifstream file(filePath);
+	if (!file.is_open())
+	{
+		std::cout << "Could not open shader source:" << filePath << std::endl;
+		return(false);
+	}
+
+	std::stringstream stream;
+	stream << file.rdbuf();
+	source = stream.str();
+
+	return(true);
+}
+
+/***********************************************************
+ *  InsertDefines()
+ *
+ *  This method is used for inserting the preprocessor defines
+ *  into the shader source.  GLSL requires the #version line to
+ *  come first, so the defines are placed right after it.
+ ***********************************************************/
+std::string ShaderCache::InsertDefines(const std::string& source, const std::string& defines)
+{
+	if (defines.empty())
+	{
+		return(source);
+	}
+
+	size_t insertPosition = 0;
+	size_t versionPosition = source.find("#version");
+	if (versionPosition != std::string::npos)
+	{
+		size_t lineEnd = source.find('\n', versionPosition);
+		insertPosition = (lineEnd == std::string::npos) ? source.size() : lineEnd + 1;
+	}
+
+	std::string result = source.substr(0, insertPosition);
+	if ((insertPosition > 0) && (result[insertPosition - 1] != '\n'))
+	{
+		result += '\n';
+	}
+	result += defines;
+	if (defines[defines.size() - 1] != '\n')
+	{
+		result += '\n';
+	}
+	result += source.substr(insertPosition);
+
+	return(result);
+}
+
+/***********************************************************
+ *  CalculateKey()
+ *
+ *  This method is used for calculating the cache key.  The
+ *  driver strings are part of the key because the binaries
+ *  are only valid for the driver that produced them.
+ ***********************************************************/
+uint64_t ShaderCache::CalculateKey(
+	const std::string& vertexSource,
+	const std::string& fragmentSource,
+	const std::string& defines)
+{
+	uint64_t hash = 14695981039346656037ULL;
+
+	hash = HashString(hash, vertexSource.c_str());
+	hash = HashString(hash, fragmentSource.c_str());
+	hash = HashString(hash, defines.c_str());
+	hash = HashString(hash, (const char*)glGetString(GL_VENDOR));
+	hash = HashString(hash, (const char*)glGetString(GL_RENDERER));
+	hash = HashString(hash, (const char*)glGetString(GL_VERSION));
+
+	return(hash);
+}
+
+/***********************************************************
+ *  GetCacheFilePath()
+ *
+ *  This method is used for getting the path of the cache
+ *  file for the passed in key.
+ ***********************************************************/
+std::string ShaderCache::GetCacheFilePath(uint64_t key)
+{
+	char filename[32];
+	snprintf(filename, sizeof(filename), "%016llx.bin", (unsigned long long)key);
+
+	return(m_cacheDirectory + "/" + filename);
+}
+
+/***********************************************************
+ *  LoadCachedProgram()
+ *
+ *  This method is used for creating the program from the
+ *  cached binary.  Stale or rejected binaries are removed so
+ *  that they are rebuilt by the caller.
+ ***********************************************************/
+GLuint ShaderCache::LoadCachedProgram(uint64_t key, float& compileMilliseconds)
+{
+	std::string filePath = GetCacheFilePath(key);
+	std::ifstream file(filePath.c_str(), std::ios::binary);
+	if (!file.is_open())
+	{
+		return(0);
+	}
+
+	CACHE_HEADER header;
+	file.read((char*)&header, sizeof(header));
+	if ((!file) ||
+		(memcmp(header.magic, g_CacheMagic, sizeof(g_CacheMagic)) != 0) ||
+		(header.version != g_CacheVersion) ||
+		(header.key != key) ||
+		(header.binaryLength == 0))
+	{
+		file.close();
+		std::remove(filePath.c_str());
+		return(0);
+	}
+
+	std::vector<char> binary(header.binaryLength);
+	file.read(binary.data(), binary.size());
+	if (!file)
+	{
+		file.close();
+		std::remove(filePath.c_str());
+		return(0);
+	}
+	file.close();
+
+	GLuint programID = glCreateProgram();
+	glProgramBinary(programID, header.binaryFormat, binary.data(), (GLsizei)binary.size());
+
+	// the driver may reject a binary, for example after an update
+	GLint linkStatus = GL_FALSE;
+	glGetProgramiv(programID, GL_LINK_STATUS, &linkStatus);
+	if (linkStatus != GL_TRUE)
+	{
+		std::cout << "Cached shader program was rejected by the driver, recompiling" << std::endl;
+		glDeleteProgram(programID);
+		std::remove(filePath.c_str());
+		return(0);
+	}
+
+	compileMilliseconds = header.compileMilliseconds;
+
+	return(programID);
+}
+
+/***********************************************************
+ *  SaveCachedProgram()
+ *
+ *  This method is used for writing the binary of the linked
+ *  program into the cache directory.  The file is written
+ *  under a temporary name and renamed into place, so another
+ *  run never reads a partly written file.
+ ***********************************************************/
+void ShaderCache::SaveCachedProgram(uint64_t key, GLuint programID, float compileMilliseconds)
+{
+	GLint binaryLength = 0;
+	glGetProgramiv(programID, GL_PROGRAM_BINARY_LENGTH, &binaryLength);
+	if (binaryLength <= 0)
+	{
+		return;
+	}
+
+	std::vector<char> binary(binaryLength);
+	GLenum binaryFormat = 0;
+	GLsizei writtenLength = 0;
+	glGetProgramBinary(programID, binaryLength, &writtenLength, &binaryFormat, binary.data());
+	if (writtenLength <= 0)
+	{
+		return;
+	}
+
+	std::error_code error;
+	std::filesystem::create_directories(m_cacheDirectory, error);
+
+	std::string filePath = GetCacheFilePath(key);
+	std::string tempPath = filePath + "." +
+		std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()) + ".tmp";
+	std::ofstream file(tempPath.c_str(), std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		std::cout << "Could not write shader cache file:" << tempPath << std::endl;
+		return;
+	}
+
+	CACHE_HEADER header;
+	memcpy(header.magic, g_CacheMagic, sizeof(g_CacheMagic));
+	header.version = g_CacheVersion;
+	header.key = key;
+	header.binaryFormat = binaryFormat;
+	header.binaryLength = (uint32_t)writtenLength;
+	header.compileMilliseconds = compileMilliseconds;
+	file.write((const char*)&header, sizeof(header));
+	file.write(binary.data(), writtenLength);
+	file.close();
+	if (file.fail())
+	{
+		std::cout << "Could not write shader cache file:" << tempPath << std::endl;
+		std::filesystem::remove(tempPath, error);
+		return;
+	}
+
+	std::filesystem::rename(tempPath, filePath, error);
+	if (error)
+	{
+		std::cout << "Could not replace shader cache file:" << filePath << std::endl;
+		std::filesystem::remove(tempPath, error);
+	}
+}
+
+/***********************************************************
+ *  CompileProgram()
+ *
+ *  This method is used for compiling and linking the shader
+ *  program.  The binary retrievable hint is set so that the
+ *  linked program can be stored in the cache.  Without a
+ *  fragment source, the first source is a compute shader.
+ ***********************************************************/
+GLuint ShaderCache::CompileProgram(const std::string& firstSource, const std::string& fragmentSource)
+{
+	bool bCompute = fragmentSource.empty();
+	GLuint vertexShaderID = CompileShader(bCompute ? GL_COMPUTE_SHADER : GL_VERTEX_SHADER, firstSource);
+	GLuint fragmentShaderID = bCompute ? 0 : CompileShader(GL_FRAGMENT_SHADER, fragmentSource);
+	if ((vertexShaderID == 0) || ((bCompute == false) && (fragmentShaderID == 0)))
+	{
+		glDeleteShader(vertexShaderID);
+		glDeleteShader(fragmentShaderID);
+		return(0);
+	}
+
+	GLuint programID = glCreateProgram();
+	glAttachShader(programID, vertexShaderID);
+	if (bCompute == false)
+	{
+		glAttachShader(programID, fragmentShaderID);
+	}
+	if (m_bBinariesSupported == true)
+	{
+		glProgramParameteri(programID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
+	glLinkProgram(programID);
+
+	// the shader objects are no longer needed once linked
+	glDetachShader(programID, vertexShaderID);
+	glDeleteShader(vertexShaderID);
+	if (bCompute == false)
+	{
+		glDetachShader(programID, fragmentShaderID);
+		glDeleteShader(fragmentShaderID);
+	}
+
+	GLint linkStatus = GL_FALSE;
+	glGetProgramiv(programID, GL_LINK_STATUS, &linkStatus);
+	if (linkStatus != GL_TRUE)
+	{
+		GLint logLength = 0;
+		glGetProgramiv(programID, GL_INFO_LOG_LENGTH, &logLength);
+		std::vector<char> log(logLength + 1, '\0');
+		glGetProgramInfoLog(programID, logLength, NULL, log.data());
+		std::cout << "Shader program link failed: " << log.data() << std::endl;
+		glDeleteProgram(programID);
+		return(0);
+	}
+
+	return(programID);
+}
+
+/***********************************************************
+ *  CompileShader()
+ *
+ *  This method is used for compiling one shader stage.
+ ***********************************************************/
+GLuint ShaderCache::CompileShader(GLenum shaderType, const std::string& source)
+{
+	GLuint shaderID = glCreateShader(shaderType);
+	const char* pSource = source.c_str();
+	glShaderSource(shaderID, 1, &pSource, NULL);
+	glCompileShader(shaderID);
+
+	GLint compileStatus = GL_FALSE;
+	glGetShaderiv(shaderID, GL_COMPILE_STATUS, &compileStatus);
+	if (compileStatus != GL_TRUE)
+	{
+		GLint logLength = 0;
+		glGetShaderiv(shaderID, GL_INFO_LOG_LENGTH, &logLength);
+		std::vector<char> log(logLength + 1, '\0');
+		glGetShaderInfoLog(shaderID, logLength, NULL, log.data());
+		std::cout << "Shader compile failed: " << log.data() << std::endl;
+		glDeleteShader(shaderID);
+		return(0);
+	}
+
+	return(shaderID);
+}
@@ -0,0 +1,77 @@
+///////////////////////////////////////////////////////////////////////////////
+// shadercache.h
+// ============
+// compile GLSL shader programs and cache the linked program binaries on
+// disk so that later launches can skip the compile and link steps
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstdint>
+#include <string>
+
+/***********************************************************
+ *  ShaderCache
+ *
+ *  This class builds shader programs from GLSL source files.
+ *  The linked program binaries are stored on disk, keyed by
+ *  a hash of the sources, the defines and the OpenGL driver
+ *  strings, and are reloaded when the key still matches.
+ ***********************************************************/
+class ShaderCache
+{
+public:
+	// constructor
+	ShaderCache(const char* cacheDirectory);
+	// destructor
+	~ShaderCache();
+
+	// build the shader program from the vertex and fragment shader
+	// files - the defines are inserted after the #version line
+	GLuint LoadProgram(
+		const char* vertexFilePath,
+		const char* fragmentFilePath,
+		const std::string& defines = "");
+	// build the compute program from the compute shader file, with
+	// the defines inserted the same way
+	GLuint LoadComputeProgram(
+		const char* computeFilePath,
+		const std::string& defines = "");
+
+private:
+	// directory holding the cached program binaries
+	std::string m_cacheDirectory;
+	// false when the driver does not support program binaries
+	bool m_bBinariesSupported;
+
+	// read the whole text file into the passed in string
+	bool ReadSourceFile(const char* filePath, std::string& source);
+	// insert the defines after the #version line of the source
+	std::string InsertDefines(const std::string& source, const std::string& defines);
+	// load the program from the cache, or compile, link and cache
+	// it - an empty fragment source builds a compute program
+	GLuint BuildProgram(
+		const std::string& firstSource,
+		const std::string& fragmentSource,
+		const std::string& defines);
+	// calculate the cache key for the program
+	uint64_t CalculateKey(
+		const std::string& vertexSource,
+		const std::string& fragmentSource,
+		const std::string& defines);
+	// get the cache file path for the passed in key
+	std::string GetCacheFilePath(uint64_t key);
+
+	// try to create the program from a cached binary
+	GLuint LoadCachedProgram(uint64_t key, float& compileMilliseconds);
+	// store the binary of the linked program in the cache
+	void SaveCachedProgram(uint64_t key, GLuint programID, float compileMilliseconds);
+	// compile and link the program from the shader sources, with
+	// the first source as the compute shader when there is no
+	// fragment source
+	GLuint CompileProgram(const std::string& firstSource, const std::string& fragmentSource);
+	// compile a single shader stage
+	GLuint CompileShader(GLenum shaderType, const std::string& source);
+};
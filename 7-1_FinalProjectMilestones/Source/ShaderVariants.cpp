@@ -0,0 +1,276 @@
+///////////////////////////////////////////////////////////////////////////////
+// shadervariants.cpp
+// ============
+// manage the specialized shader program variants that are compiled from
+// #define permutations of the scene shaders
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ShaderVariants.h"
+
+#include <cstdio>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	const char* g_ModelName = "model";
+	const char* g_ViewName = "view";
+	const char* g_ProjectionName = "projection";
+	const char* g_ViewPositionName = "viewPosition";
+	const char* g_ColorValueName = "objectColor";
+	const char* g_TextureValueName = "objectTexture";
+	const char* g_UVScaleName = "UVscale";
+	const char* g_UseTextureName = "bUseTexture";
+	const char* g_UseLightingName = "bUseLighting";
+	const char* g_MeshCenterName = "meshBoundsCenter";
+	const char* g_MeshExtentName = "meshBoundsExtent";
+
+	const char* g_MaterialNames[ShaderVariants::MATERIAL_UNIFORM_COUNT] =
+	{
+		"material.ambientColor",
+		"material.ambientStrength",
+		"material.diffuseColor",
+		"material.specularColor",
+		"material.shininess"
+	};
+
+	const char* g_LightFieldNames[ShaderVariants::LIGHT_UNIFORM_COUNT] =
+	{
+		"position",
+		"ambientColor",
+		"diffuseColor",
+		"specularColor",
+		"isEnabled"
+	};
+}
+
+/***********************************************************
+ *  ShaderVariants()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ShaderVariants::ShaderVariants(
+	ShaderCache* pShaderCache,
+	const char* vertexFilePath,
+	const char* fragmentFilePath)
+{
+	m_pShaderCache = pShaderCache;
+	m_vertexFilePath = vertexFilePath;
+	m_fragmentFilePath = fragmentFilePath;
+
+	for (int i = 0; i < VARIANT_COUNT; i++)
+	{
+		InitializeVariant(m_variants[i], 0, i, false);
+		m_bAttempted[i] = false;
+	}
+	InitializeVariant(m_generalVariant, 0, 0, true);
+}
+
+/***********************************************************
+ *  ~ShaderVariants()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ShaderVariants::~ShaderVariants()
+{
+	// the programs are freed by their handles, except a general
+	// program that was built elsewhere
+	m_pShaderCache = NULL;
+}
+
+/***********************************************************
+ *  LoadGeneralProgram()
+ *
+ *  This method is used for building the general program from
+ *  the scene shaders without any defines.
+ ***********************************************************/
+bool ShaderVariants::LoadGeneralProgram()
+{
+	if (NULL == m_pShaderCache)
+	{
+		return(false);
+	}
+
+	GLuint programID = m_pShaderCache->LoadProgram(
+		m_vertexFilePath.c_str(),
+		m_fragmentFilePath.c_str());
+	if (programID == 0)
+	{
+		return(false);
+	}
+
+	m_generalProgram.Adopt(programID, "general shader program");
+	InitializeVariant(m_generalVariant, programID, 0, true);
+	return(true);
+}
+
+/***********************************************************
+ *  SetGeneralProgram()
+ *
+ *  This method is used for using a general program that was
+ *  built without the shader cache.
+ ***********************************************************/
+void ShaderVariants::SetGeneralProgram(GLuint programID)
+{
+	m_generalProgram.Reset();
+	InitializeVariant(m_generalVariant, programID, 0, true);
+}
+
+/***********************************************************
+ *  UseGeneralProgram()
+ *
+ *  This method is used for activating the general program.
+ ***********************************************************/
+void ShaderVariants::UseGeneralProgram()
+{
+	glUseProgram(m_generalVariant.programID);
+}
+
+/***********************************************************
+ *  InitializeVariant()
+ *
+ *  This method is used for initializing the variant and
+ *  caching the locations of all the uniforms that are set
+ *  while rendering, so no lookups happen per draw.
+ ***********************************************************/
+void ShaderVariants::InitializeVariant(
+	SHADER_VARIANT& variant,
+	GLuint programID,
+	unsigned int flags,
+	bool bGeneral)
+{
+	variant.programID = programID;
+	variant.flags = flags;
+	variant.bGeneral = bGeneral;
+	variant.viewSerial = 0;
+	variant.lightSerial = 0;
+
+	variant.modelLocation = -1;
+	variant.viewLocation = -1;
+	variant.projectionLocation = -1;
+	variant.viewPositionLocation = -1;
+	variant.colorLocation = -1;
+	variant.textureLocation = -1;
+	variant.uvScaleLocation = -1;
+	variant.useTextureLocation = -1;
+	variant.useLightingLocation = -1;
+	variant.meshCenterLocation = -1;
+	variant.meshExtentLocation = -1;
+	for (int i = 0; i < MATERIAL_UNIFORM_COUNT; i++)
+	{
+		variant.materialLocations[i] = -1;
+	}
+	for (int light = 0; light < TOTAL_LIGHTS; light++)
+	{
+		for (int field = 0; field < LIGHT_UNIFORM_COUNT; field++)
+		{
+			variant.lightLocations[light][field] = -1;
+		}
+	}
+
+	if (programID == 0)
+	{
+		return;
+	}
+
+	variant.modelLocation = glGetUniformLocation(programID, g_ModelName);
+	variant.viewLocation = glGetUniformLocation(programID, g_ViewName);
+	variant.projectionLocation = glGetUniformLocation(programID, g_ProjectionName);
+	variant.viewPositionLocation = glGetUniformLocation(programID, g_ViewPositionName);
+	variant.colorLocation = glGetUniformLocation(programID, g_ColorValueName);
+	variant.textureLocation = glGetUniformLocation(programID, g_TextureValueName);
+	variant.uvScaleLocation = glGetUniformLocation(programID, g_UVScaleName);
+	variant.useTextureLocation = glGetUniformLocation(programID, g_UseTextureName);
+	variant.useLightingLocation = glGetUniformLocation(programID, g_UseLightingName);
+	variant.meshCenterLocation = glGetUniformLocation(programID, g_MeshCenterName);
+	variant.meshExtentLocation = glGetUniformLocation(programID, g_MeshExtentName);
+	for (int i = 0; i < MATERIAL_UNIFORM_COUNT; i++)
+	{
+		variant.materialLocations[i] = glGetUniformLocation(programID, g_MaterialNames[i]);
+	}
+	for (int light = 0; light < TOTAL_LIGHTS; light++)
+	{
+		for (int field = 0; field < LIGHT_UNIFORM_COUNT; field++)
+		{
+			char uniformName[64];
+			snprintf(uniformName, sizeof(uniformName), "lightSources[%d].%s", light, g_LightFieldNames[field]);
+			variant.lightLocations[light][field] = glGetUniformLocation(programID, uniformName);
+		}
+	}
+}
+
+/***********************************************************
+ *  BuildDefines()
+ *
+ *  This method is used for building the #define lines that
+ *  specialize the shaders for the passed in feature flags.
+ ***********************************************************/
+std::string ShaderVariants::BuildDefines(unsigned int flags)
+{
+	std::string defines;
+
+	defines += (flags & VARIANT_TEXTURE) ? "#define USE_TEXTURE 1\n" : "#define USE_TEXTURE 0\n";
+	defines += (flags & VARIANT_LIGHTING) ? "#define USE_LIGHTING 1\n" : "#define USE_LIGHTING 0\n";
+	if (flags & VARIANT_DEPTH_ONLY)
+	{
+		defines += "#define DEPTH_ONLY 1\n";
+	}
+	if (flags & VARIANT_COMPACT_VERTICES)
+	{
+		defines += "#define COMPACT_VERTICES 1\n";
+	}
+	if (flags & VARIANT_GPU_DRIVEN)
+	{
+		defines += "#define GPU_DRIVEN 1\n";
+	}
+
+	return(defines);
+}
+
+/***********************************************************
+ *  GetVariant()
+ *
+ *  This method is used for getting the specialized program
+ *  for the passed in feature flags.  The program is compiled
+ *  on the first request, and the general program is used if
+ *  the variant cannot be built.
+ ***********************************************************/
+ShaderVariants::SHADER_VARIANT* ShaderVariants::GetVariant(unsigned int flags)
+{
+	if (flags >= VARIANT_COUNT)
+	{
+		return(&m_generalVariant);
+	}
+
+	if (m_bAttempted[flags] == false)
+	{
+		m_bAttempted[flags] = true;
+
+		GLuint programID = 0;
+		if (NULL != m_pShaderCache)
+		{
+			programID = m_pShaderCache->LoadProgram(
+				m_vertexFilePath.c_str(),
+				m_fragmentFilePath.c_str(),
+				BuildDefines(flags));
+		}
+
+		if (programID != 0)
+		{
+			m_programs[flags].Adopt(programID, "shader variant");
+			InitializeVariant(m_variants[flags], programID, flags, false);
+		}
+		else
+		{
+			std::cout << "Could not build shader variant " << flags
+				<< ", using the general shader program" << std::endl;
+		}
+	}
+
+	if (m_variants[flags].programID == 0)
+	{
+		return(&m_generalVariant);
+	}
+
+	return(&m_variants[flags]);
+}
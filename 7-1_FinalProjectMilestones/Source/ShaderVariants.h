@@ -0,0 +1,137 @@
+///////////////////////////////////////////////////////////////////////////////
+// shadervariants.h
+// ============
+// manage the specialized shader program variants that are compiled from
+// #define permutations of the scene shaders
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "GpuResources.h"
+#include "ShaderCache.h"
+
+#include <string>
+
+/***********************************************************
+ *  ShaderVariants
+ *
+ *  This class contains the specialized shader programs that
+ *  are built from the scene shaders with #define permutations
+ *  of the texture and lighting modes.  Variants are compiled
+ *  the first time they are requested and kept afterwards.
+ *  It also owns the general program, which the variants fall
+ *  back to and which stays active between the frames.
+ ***********************************************************/
+class ShaderVariants
+{
+public:
+	// constructor
+	ShaderVariants(
+		ShaderCache* pShaderCache,
+		const char* vertexFilePath,
+		const char* fragmentFilePath);
+	// destructor
+	~ShaderVariants();
+
+	// number of light sources supported by the shaders
+	static const int TOTAL_LIGHTS = 4;
+
+	// feature flags selecting the compile-time shader modes
+	enum VARIANT_FLAGS
+	{
+		VARIANT_TEXTURE = 1 << 0,
+		VARIANT_LIGHTING = 1 << 1,
+		VARIANT_DEPTH_ONLY = 1 << 2,
+		// reads the quantized vertices of the compact meshes
+		VARIANT_COMPACT_VERTICES = 1 << 3,
+		// reads the object settings from the instanced attributes
+		// of the GPU-driven draws instead of uniforms
+		VARIANT_GPU_DRIVEN = 1 << 4,
+		VARIANT_COUNT = 1 << 5
+	};
+
+	// indices of the cached material uniform locations
+	enum MATERIAL_UNIFORM
+	{
+		MATERIAL_AMBIENT_COLOR,
+		MATERIAL_AMBIENT_STRENGTH,
+		MATERIAL_DIFFUSE_COLOR,
+		MATERIAL_SPECULAR_COLOR,
+		MATERIAL_SHININESS,
+		MATERIAL_UNIFORM_COUNT
+	};
+
+	// indices of the cached light source uniform locations
+	enum LIGHT_UNIFORM
+	{
+		LIGHT_POSITION,
+		LIGHT_AMBIENT_COLOR,
+		LIGHT_DIFFUSE_COLOR,
+		LIGHT_SPECULAR_COLOR,
+		LIGHT_IS_ENABLED,
+		LIGHT_UNIFORM_COUNT
+	};
+
+	struct SHADER_VARIANT
+	{
+		GLuint programID;
+		unsigned int flags;
+		// true for the general program that branches on uniforms
+		bool bGeneral;
+		// cached uniform locations
+		GLint modelLocation;
+		GLint viewLocation;
+		GLint projectionLocation;
+		GLint viewPositionLocation;
+		GLint colorLocation;
+		GLint textureLocation;
+		GLint uvScaleLocation;
+		GLint useTextureLocation;
+		GLint useLightingLocation;
+		GLint meshCenterLocation;
+		GLint meshExtentLocation;
+		GLint materialLocations[MATERIAL_UNIFORM_COUNT];
+		GLint lightLocations[TOTAL_LIGHTS][LIGHT_UNIFORM_COUNT];
+		// serial numbers of the view and light settings last
+		// uploaded into this program
+		unsigned int viewSerial;
+		unsigned int lightSerial;
+	};
+
+	// build the general program through the shader cache, which
+	// reuses the binary of a previous launch when it still matches
+	bool LoadGeneralProgram();
+	// use a general program built elsewhere, which stays owned by
+	// its builder
+	void SetGeneralProgram(GLuint programID);
+	// make the general program the active one
+	void UseGeneralProgram();
+
+	// get the program variant for the passed in feature flags,
+	// compiling it the first time it is requested
+	SHADER_VARIANT* GetVariant(unsigned int flags);
+	// get the general program that branches on uniforms
+	SHADER_VARIANT* GetGeneralVariant() { return(&m_generalVariant); }
+	// get the cache that the variants are built through
+	ShaderCache* GetShaderCache() { return(m_pShaderCache); }
+
+private:
+	ShaderCache* m_pShaderCache;
+	std::string m_vertexFilePath;
+	std::string m_fragmentFilePath;
+
+	// compiled variants indexed by the feature flags, and the
+	// handles owning their programs
+	SHADER_VARIANT m_variants[VARIANT_COUNT];
+	GpuProgram m_programs[VARIANT_COUNT];
+	// true once compiling a variant has been attempted
+	bool m_bAttempted[VARIANT_COUNT];
+	// general program, with its handle when it was built here
+	SHADER_VARIANT m_generalVariant;
+	GpuProgram m_generalProgram;
+
+	// initialize the variant and cache its uniform locations
+	void InitializeVariant(SHADER_VARIANT& variant, GLuint programID, unsigned int flags, bool bGeneral);
+	// build the #define lines for the passed in feature flags
+	std::string BuildDefines(unsigned int flags);
+};
@@ -0,0 +1,960 @@
+///////////////////////////////////////////////////////////////////////////////
+// softwarerasterizer.cpp
+// ============
+// render the scene draws on the CPU with a tiled, multithreaded rasterizer
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SoftwareRasterizer.h"
+#include "CpuFeatures.h"
+
+#include <algorithm>
+#include <cmath>
+
+// declaration of global variables
+namespace
+{
+	// pixels covered by the edge functions at once
+	const int g_BlockWidth = 8;
+	// color the buffers are cleared to, opaque black
+	const uint32_t g_ClearColor = 0xFF000000;
+	// triangles with less screen area than this cover no pixels
+	const float g_MinimumArea = 1e-8f;
+
+	// blend two vertices of a clipped edge
+	template <typename VERTEX>
+	VERTEX LerpVertex(const VERTEX& first, const VERTEX& second, float t)
+	{
+		VERTEX vertex;
+		vertex.clip = first.clip + (second.clip - first.clip) * t;
+		vertex.world = first.world + (second.world - first.world) * t;
+		vertex.normal = first.normal + (second.normal - first.normal) * t;
+		vertex.uv = first.uv + (second.uv - first.uv) * t;
+		return(vertex);
+	}
+
+	// pack the color into the RGBA bytes of a pixel
+	uint32_t PackColor(const glm::vec4& color)
+	{
+		uint32_t red = (uint32_t)(std::min(std::max(color.r, 0.0f), 1.0f) * 255.0f + 0.5f);
+		uint32_t green = (uint32_t)(std::min(std::max(color.g, 0.0f), 1.0f) * 255.0f + 0.5f);
+		uint32_t blue = (uint32_t)(std::min(std::max(color.b, 0.0f), 1.0f) * 255.0f + 0.5f);
+		uint32_t alpha = (uint32_t)(std::min(std::max(color.a, 0.0f), 1.0f) * 255.0f + 0.5f);
+		return(red | (green << 8) | (blue << 16) | (alpha << 24));
+	}
+
+	glm::vec4 UnpackColor(uint32_t pixel)
+	{
+		const float scale = 1.0f / 255.0f;
+		return(glm::vec4(
+			(pixel & 0xFF) * scale,
+			((pixel >> 8) & 0xFF) * scale,
+			((pixel >> 16) & 0xFF) * scale,
+			(pixel >> 24) * scale));
+	}
+
+	// wrap the texel coordinate for repeating textures
+	int WrapTexel(int coordinate, int size)
+	{
+		coordinate %= size;
+		return((coordinate < 0) ? coordinate + size : coordinate);
+	}
+
+	// edge functions and depth of a triangle, for covering the
+	// blocks of pixels inside it
+	struct BLOCK_SETUP
+	{
+		float edgeA[3];
+		float edgeB[3];
+		float edgeC[3];
+		bool bTopLeft[3];
+		float inverseArea;
+		float depth0;
+		float depthDelta1;
+		float depthDelta2;
+	};
+
+	// work out which pixels of the block of eight starting at x are
+	// inside the triangle and closer than the depth row, returning
+	// them as a mask, with their weights and depths
+	unsigned int CoverBlockScalar(
+		const BLOCK_SETUP& setup,
+		int x,
+		float pixelY,
+		const float* pDepthRow,
+		float* pWeights1,
+		float* pWeights2,
+		float* pDepths)
+	{
+		unsigned int mask = 0;
+		for (int lane = 0; lane < g_BlockWidth; lane++)
+		{
+			float pixelX = x + lane + 0.5f;
+			float edgeValues[3];
+			bool bInside = true;
+			for (int edge = 0; edge < 3; edge++)
+			{
+				float rowValue = setup.edgeB[edge] * pixelY + setup.edgeC[edge];
+				edgeValues[edge] = setup.edgeA[edge] * pixelX + rowValue;
+				bInside = bInside && ((edgeValues[edge] > 0.0f) ||
+					((edgeValues[edge] == 0.0f) && (setup.bTopLeft[edge] == true)));
+			}
+			pWeights1[lane] = edgeValues[1] * setup.inverseArea;
+			pWeights2[lane] = edgeValues[2] * setup.inverseArea;
+			pDepths[lane] = setup.depth0 + (pWeights1[lane] * setup.depthDelta1 + pWeights2[lane] * setup.depthDelta2);
+			if ((bInside == true) && (pDepths[lane] < pDepthRow[x + lane]))
+			{
+				mask |= 1u << lane;
+			}
+		}
+		return(mask);
+	}
+
+#ifdef CPU_FEATURES_AVX2
+	// the same block covered with one vector per value, adding in
+	// the same order as the scalar lanes so both give identical
+	// results
+	CPU_AVX2_FUNCTION
+	unsigned int CoverBlockAVX2(
+		const BLOCK_SETUP& setup,
+		int x,
+		float pixelY,
+		const float* pDepthRow,
+		float* pWeights1,
+		float* pWeights2,
+		float* pDepths)
+	{
+		const __m256 laneOffsets = _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f);
+		const __m256 zero = _mm256_setzero_ps();
+		const __m256 allBits = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+
+		__m256 pixelX = _mm256_add_ps(_mm256_set1_ps((float)x), laneOffsets);
+		__m256 inside = allBits;
+		__m256 edgeValues[3];
+		for (int edge = 0; edge < 3; edge++)
+		{
+			__m256 rowValue = _mm256_set1_ps(setup.edgeB[edge] * pixelY + setup.edgeC[edge]);
+			edgeValues[edge] = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(setup.edgeA[edge]), pixelX), rowValue);
+			__m256 topLeft = (setup.bTopLeft[edge] == true) ? allBits : zero;
+			__m256 edgeInside = _mm256_or_ps(
+				_mm256_cmp_ps(edgeValues[edge], zero, _CMP_GT_OQ),
+				_mm256_and_ps(_mm256_cmp_ps(edgeValues[edge], zero, _CMP_EQ_OQ), topLeft));
+			inside = _mm256_and_ps(inside, edgeInside);
+		}
+		if (_mm256_movemask_ps(inside) == 0)
+		{
+			return(0);
+		}
+
+		__m256 inverseArea = _mm256_set1_ps(setup.inverseArea);
+		__m256 weight1 = _mm256_mul_ps(edgeValues[1], inverseArea);
+		__m256 weight2 = _mm256_mul_ps(edgeValues[2], inverseArea);
+		__m256 depth = _mm256_add_ps(_mm256_set1_ps(setup.depth0), _mm256_add_ps(
+			_mm256_mul_ps(weight1, _mm256_set1_ps(setup.depthDelta1)),
+			_mm256_mul_ps(weight2, _mm256_set1_ps(setup.depthDelta2))));
+		__m256 depthPass = _mm256_cmp_ps(depth, _mm256_loadu_ps(pDepthRow + x), _CMP_LT_OQ);
+		_mm256_storeu_ps(pWeights1, weight1);
+		_mm256_storeu_ps(pWeights2, weight2);
+		_mm256_storeu_ps(pDepths, depth);
+		return((unsigned int)_mm256_movemask_ps(_mm256_and_ps(inside, depthPass)));
+	}
+#endif
+}
+
+/***********************************************************
+ *  SoftwareRasterizer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+SoftwareRasterizer::SoftwareRasterizer(int threadCount)
+{
+	if (threadCount <= 0)
+	{
+		threadCount = (int)std::thread::hardware_concurrency();
+	}
+	m_threadCount = std::max(threadCount, 1);
+	m_bUseAVX2 = CpuFeatures::HasAVX2();
+
+	m_width = 0;
+	m_height = 0;
+	m_pitch = 0;
+	m_tilesX = 0;
+	m_tilesY = 0;
+	m_viewProjection = glm::mat4(1.0f);
+	m_viewPosition = glm::vec3(0.0f);
+	for (int i = 0; i < TOTAL_LIGHTS; i++)
+	{
+		m_lightSources[i].position = glm::vec3(0.0f);
+		m_lightSources[i].ambientColor = glm::vec3(0.0f);
+		m_lightSources[i].diffuseColor = glm::vec3(0.0f);
+		m_lightSources[i].specularColor = glm::vec3(0.0f);
+		m_lightSources[i].bEnabled = false;
+	}
+	m_bUseLighting = false;
+	m_binnedTriangles = 0;
+
+	m_threadData.resize(m_threadCount);
+	m_job = JOB_GEOMETRY;
+	m_jobSerial = 0;
+	m_busyWorkers = 0;
+	m_bQuit = false;
+	m_nextTile = 0;
+	for (int i = 1; i < m_threadCount; i++)
+	{
+		m_workers.push_back(std::thread(&SoftwareRasterizer::WorkerLoop, this, i));
+	}
+}
+
+/***********************************************************
+ *  ~SoftwareRasterizer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+SoftwareRasterizer::~SoftwareRasterizer()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_bQuit = true;
+	}
+	m_startCondition.notify_all();
+	for (size_t i = 0; i < m_workers.size(); i++)
+	{
+		m_workers[i].join();
+	}
+}
+
+/***********************************************************
+ *  SetMesh()
+ *
+ *  This method is used for storing the vertices and the
+ *  triangle list of a mesh, in the same numbering as the
+ *  meshes of the draws.
+ ***********************************************************/
+void SoftwareRasterizer::SetMesh(
+	int mesh,
+	const std::vector<glm::vec3>& positions,
+	const std::vector<glm::vec3>& normals,
+	const std::vector<glm::vec2>& uvs,
+	const std::vector<uint32_t>& indices)
+{
+	if (mesh < 0)
+	{
+		return;
+	}
+	if (mesh >= (int)m_meshes.size())
+	{
+		m_meshes.resize(mesh + 1);
+	}
+
+	MESH& target = m_meshes[mesh];
+	target.positions = positions;
+	target.normals = normals;
+	target.uvs = uvs;
+	target.indices = indices;
+	// every vertex needs all of its attributes
+	target.normals.resize(positions.size(), glm::vec3(0.0f, 1.0f, 0.0f));
+	target.uvs.resize(positions.size(), glm::vec2(0.0f, 0.0f));
+}
+
+/***********************************************************
+ *  SetTexture()
+ *
+ *  This method is used for storing a copy of the texture
+ *  image as RGBA pixels, in the same slot as the OpenGL
+ *  texture it was loaded into.
+ ***********************************************************/
+bool SoftwareRasterizer::SetTexture(int texture, int width, int height, int channels, const unsigned char* pPixels)
+{
+	if ((texture < 0) || (width <= 0) || (height <= 0) || (NULL == pPixels) ||
+		((channels != 3) && (channels != 4)))
+	{
+		return(false);
+	}
+	if (texture >= (int)m_textures.size())
+	{
+		m_textures.resize(texture + 1);
+	}
+
+	TEXTURE& target = m_textures[texture];
+	target.width = width;
+	target.height = height;
+	target.pixels.resize((size_t)width * height * 4);
+	for (size_t i = 0; i < (size_t)width * height; i++)
+	{
+		target.pixels[i * 4] = pPixels[i * channels];
+		target.pixels[i * 4 + 1] = pPixels[i * channels + 1];
+		target.pixels[i * 4 + 2] = pPixels[i * channels + 2];
+		target.pixels[i * 4 + 3] = (channels == 4) ? pPixels[i * channels + 3] : 255;
+	}
+	return(true);
+}
+
+/***********************************************************
+ *  Resize()
+ *
+ *  This method is used for setting the size of the frame
+ *  buffers.  The rows and columns are padded to whole tiles
+ *  so that the eight pixel blocks never leave the buffers.
+ ***********************************************************/
+void SoftwareRasterizer::Resize(int width, int height)
+{
+	width = std::max(width, 1);
+	height = std::max(height, 1);
+	if ((width == m_width) && (height == m_height))
+	{
+		return;
+	}
+
+	m_width = width;
+	m_height = height;
+	m_tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+	m_tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+	m_pitch = m_tilesX * TILE_SIZE;
+	m_colorBuffer.assign((size_t)m_pitch * m_tilesY * TILE_SIZE, g_ClearColor);
+	m_depthBuffer.assign((size_t)m_pitch * m_tilesY * TILE_SIZE, 1.0f);
+
+	for (int i = 0; i < m_threadCount; i++)
+	{
+		m_threadData[i].bins.resize((size_t)m_tilesX * m_tilesY);
+	}
+}
+
+/***********************************************************
+ *  SetView()
+ *
+ *  This method is used for setting the camera of the next
+ *  frame.
+ ***********************************************************/
+void SoftwareRasterizer::SetView(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& viewPosition)
+{
+	m_viewProjection = projection * view;
+	m_viewPosition = viewPosition;
+}
+
+/***********************************************************
+ *  SetLightSources()
+ *
+ *  This method is used for setting the light sources of the
+ *  next frame.  Without lighting the surfaces are drawn with
+ *  their plain color or texture.
+ ***********************************************************/
+void SoftwareRasterizer::SetLightSources(const LIGHT_SOURCE* pLights, bool bUseLighting)
+{
+	for (int i = 0; i < TOTAL_LIGHTS; i++)
+	{
+		m_lightSources[i] = pLights[i];
+	}
+	m_bUseLighting = bUseLighting;
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method is used for starting a new list of draws.
+ ***********************************************************/
+void SoftwareRasterizer::BeginFrame()
+{
+	m_draws.clear();
+}
+
+/***********************************************************
+ *  AddDraw()
+ *
+ *  This method is used for adding a draw to the frame.  The
+ *  draws are blended in the order they are added, so the
+ *  transparent ones must come last and back to front.
+ ***********************************************************/
+void SoftwareRasterizer::AddDraw(const DRAW& draw)
+{
+	m_draws.push_back(draw);
+}
+
+/***********************************************************
+ *  RenderFrame()
+ *
+ *  This method is used for rendering the collected draws.
+ *  The draws are split between the threads by their number
+ *  of triangles for the geometry, and the tiles are handed
+ *  out one at a time for the rasterizing, so that the busy
+ *  parts of the screen do not hold up a single thread.
+ ***********************************************************/
+void SoftwareRasterizer::RenderFrame()
+{
+	if ((m_width == 0) || (m_height == 0))
+	{
+		return;
+	}
+
+	// the buffers keep their capacity, so after the first frames
+	// nothing is allocated here
+	m_drawTriangles.resize(m_draws.size() + 1);
+	m_drawTriangles[0] = 0;
+	for (size_t i = 0; i < m_draws.size(); i++)
+	{
+		size_t triangles = 0;
+		int mesh = m_draws[i].mesh;
+		if ((mesh >= 0) && (mesh < (int)m_meshes.size()))
+		{
+			triangles = m_meshes[mesh].indices.size() / 3;
+		}
+		m_drawTriangles[i + 1] = m_drawTriangles[i] + triangles;
+	}
+
+	size_t totalTriangles = m_drawTriangles.back();
+	for (int i = 0; i < m_threadCount; i++)
+	{
+		// each thread starts with the first draw beyond its share
+		size_t first = totalTriangles * i / m_threadCount;
+		size_t last = totalTriangles * (i + 1) / m_threadCount;
+		m_threadData[i].firstDraw = std::lower_bound(m_drawTriangles.begin(), m_drawTriangles.end() - 1, first) - m_drawTriangles.begin();
+		m_threadData[i].lastDraw = std::lower_bound(m_drawTriangles.begin(), m_drawTriangles.end() - 1, last) - m_drawTriangles.begin();
+	}
+	m_threadData[m_threadCount - 1].lastDraw = m_draws.size();
+
+	RunJob(JOB_GEOMETRY);
+
+	m_binnedTriangles = 0;
+	for (int i = 0; i < m_threadCount; i++)
+	{
+		m_binnedTriangles += m_threadData[i].triangles.size();
+	}
+
+	m_nextTile = 0;
+	RunJob(JOB_RASTER);
+}
+
+/***********************************************************
+ *  RunJob()
+ *
+ *  This method is used for running a job on all of the
+ *  threads, including the calling one, and waiting until
+ *  every thread has finished its part.
+ ***********************************************************/
+void SoftwareRasterizer::RunJob(JOB job)
+{
+	if (m_threadCount > 1)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_job = job;
+			m_jobSerial++;
+			m_busyWorkers = m_threadCount - 1;
+		}
+		m_startCondition.notify_all();
+	}
+
+	DoJob(job, 0);
+
+	if (m_threadCount > 1)
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_doneCondition.wait(lock, [this]() { return(m_busyWorkers == 0); });
+	}
+}
+
+/***********************************************************
+ *  WorkerLoop()
+ *
+ *  This method is used for running the jobs on a worker
+ *  thread until the rasterizer is destroyed.
+ ***********************************************************/
+void SoftwareRasterizer::WorkerLoop(int thread)
+{
+	unsigned int serial = 0;
+	for (;;)
+	{
+		JOB job;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_startCondition.wait(lock, [this, serial]() { return((m_bQuit == true) || (m_jobSerial != serial)); });
+			if (m_bQuit == true)
+			{
+				return;
+			}
+			serial = m_jobSerial;
+			job = m_job;
+		}
+
+		DoJob(job, thread);
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_busyWorkers--;
+		if (m_busyWorkers == 0)
+		{
+			m_doneCondition.notify_one();
+		}
+	}
+}
+
+/***********************************************************
+ *  DoJob()
+ *
+ *  This method is used for running one thread's part of the
+ *  passed in job.
+ ***********************************************************/
+void SoftwareRasterizer::DoJob(JOB job, int thread)
+{
+	switch (job)
+	{
+	case JOB_GEOMETRY: ProcessGeometry(thread); break;
+	case JOB_RASTER: RasterizeTiles(); break;
+	default: break;
+	}
+}
+
+/***********************************************************
+ *  ProcessGeometry()
+ *
+ *  This method is used for transforming the vertices of the
+ *  thread's draws and setting up their triangles.  The
+ *  triangles outside one of the frustum planes are dropped,
+ *  and the ones crossing the near plane are clipped against
+ *  it, so that every vertex left is in front of the camera.
+ ***********************************************************/
+void SoftwareRasterizer::ProcessGeometry(int thread)
+{
+	THREAD_DATA& data = m_threadData[thread];
+	data.triangles.clear();
+	for (size_t i = 0; i < data.bins.size(); i++)
+	{
+		data.bins[i].clear();
+	}
+
+	for (size_t d = data.firstDraw; d < data.lastDraw; d++)
+	{
+		const DRAW& draw = m_draws[d];
+		if ((draw.mesh < 0) || (draw.mesh >= (int)m_meshes.size()))
+		{
+			continue;
+		}
+		const MESH& mesh = m_meshes[draw.mesh];
+
+		// the same transforms as the vertex shader
+		glm::mat4 clipMatrix = m_viewProjection * draw.model;
+		glm::mat3 normalMatrix = glm::mat3(glm::transpose(glm::inverse(draw.model)));
+		data.vertices.resize(mesh.positions.size());
+		for (size_t v = 0; v < mesh.positions.size(); v++)
+		{
+			glm::vec4 position(mesh.positions[v], 1.0f);
+			CLIP_VERTEX& vertex = data.vertices[v];
+			vertex.clip = clipMatrix * position;
+			vertex.world = glm::vec3(draw.model * position);
+			vertex.normal = normalMatrix * mesh.normals[v];
+			vertex.uv = mesh.uvs[v];
+		}
+
+		for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+		{
+			const CLIP_VERTEX* pTriangle[3] =
+			{
+				&data.vertices[mesh.indices[i]],
+				&data.vertices[mesh.indices[i + 1]],
+				&data.vertices[mesh.indices[i + 2]]
+			};
+
+			// drop the triangles with all corners outside one plane
+			bool bOutside = false;
+			for (int axis = 0; (axis < 3) && (bOutside == false); axis++)
+			{
+				bool bBelow = true;
+				bool bAbove = true;
+				for (int corner = 0; corner < 3; corner++)
+				{
+					const glm::vec4& clip = pTriangle[corner]->clip;
+					bBelow = bBelow && (clip[axis] < -clip.w);
+					bAbove = bAbove && (clip[axis] > clip.w);
+				}
+				bOutside = bBelow || bAbove;
+			}
+			if (bOutside == true)
+			{
+				continue;
+			}
+
+			float distances[3];
+			int insideCount = 0;
+			for (int corner = 0; corner < 3; corner++)
+			{
+				distances[corner] = pTriangle[corner]->clip.z + pTriangle[corner]->clip.w;
+				insideCount += (distances[corner] >= 0.0f) ? 1 : 0;
+			}
+			if (insideCount == 3)
+			{
+				BinTriangle(data, pTriangle, (uint32_t)d);
+				continue;
+			}
+
+			// cut off the part behind the near plane, leaving a
+			// triangle or a quad that is drawn as two triangles
+			CLIP_VERTEX clipped[4];
+			int clippedCount = 0;
+			for (int corner = 0; corner < 3; corner++)
+			{
+				int next = (corner + 1) % 3;
+				if (distances[corner] >= 0.0f)
+				{
+					clipped[clippedCount++] = *pTriangle[corner];
+				}
+				if ((distances[corner] >= 0.0f) != (distances[next] >= 0.0f))
+				{
+					float t = distances[corner] / (distances[corner] - distances[next]);
+					clipped[clippedCount++] = LerpVertex(*pTriangle[corner], *pTriangle[next], t);
+				}
+			}
+			for (int corner = 2; corner < clippedCount; corner++)
+			{
+				const CLIP_VERTEX* pClipped[3] = { &clipped[0], &clipped[corner - 1], &clipped[corner] };
+				BinTriangle(data, pClipped, (uint32_t)d);
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  BinTriangle()
+ *
+ *  This method is used for projecting a clipped triangle onto
+ *  the screen, setting up its edge functions and adding it to
+ *  the bins of the tiles under its bounds.  Both windings are
+ *  drawn, as the OpenGL path does not cull back faces.
+ ***********************************************************/
+void SoftwareRasterizer::BinTriangle(THREAD_DATA& data, const CLIP_VERTEX* pVertices[3], uint32_t draw)
+{
+	float screenX[3];
+	float screenY[3];
+	float depth[3];
+	float inverseW[3];
+	for (int corner = 0; corner < 3; corner++)
+	{
+		const glm::vec4& clip = pVertices[corner]->clip;
+		inverseW[corner] = 1.0f / clip.w;
+		screenX[corner] = (clip.x * inverseW[corner] * 0.5f + 0.5f) * m_width;
+		screenY[corner] = (clip.y * inverseW[corner] * 0.5f + 0.5f) * m_height;
+		depth[corner] = clip.z * inverseW[corner] * 0.5f + 0.5f;
+	}
+
+	float area =
+		(screenX[1] - screenX[0]) * (screenY[2] - screenY[0]) -
+		(screenX[2] - screenX[0]) * (screenY[1] - screenY[0]);
+	if (!(std::fabs(area) > g_MinimumArea))
+	{
+		return;
+	}
+
+	// clockwise triangles are turned around so that the inside
+	// of every edge function is positive
+	int order[3] = { 0, 1, 2 };
+	if (area < 0.0f)
+	{
+		std::swap(order[1], order[2]);
+		area = -area;
+	}
+
+	float minX = std::min(screenX[0], std::min(screenX[1], screenX[2]));
+	float maxX = std::max(screenX[0], std::max(screenX[1], screenX[2]));
+	float minY = std::min(screenY[0], std::min(screenY[1], screenY[2]));
+	float maxY = std::max(screenY[0], std::max(screenY[1], screenY[2]));
+
+	RASTER_TRIANGLE triangle;
+	// the pixel centers are at the half coordinates, and the
+	// bounds are clamped before the conversion to integers
+	triangle.minX = (int)std::floor(std::min(std::max(minX - 0.5f, 0.0f), (float)m_width));
+	triangle.minY = (int)std::floor(std::min(std::max(minY - 0.5f, 0.0f), (float)m_height));
+	triangle.maxX = (int)std::ceil(std::max(std::min(maxX - 0.5f, (float)(m_width - 1)), -1.0f));
+	triangle.maxY = (int)std::ceil(std::max(std::min(maxY - 0.5f, (float)(m_height - 1)), -1.0f));
+	if ((triangle.minX > triangle.maxX) || (triangle.minY > triangle.maxY))
+	{
+		return;
+	}
+
+	for (int corner = 0; corner < 3; corner++)
+	{
+		const CLIP_VERTEX& vertex = *pVertices[order[corner]];
+		triangle.depth[corner] = depth[order[corner]];
+		triangle.inverseW[corner] = inverseW[order[corner]];
+		triangle.world[corner] = vertex.world;
+		triangle.normal[corner] = vertex.normal;
+		triangle.uv[corner] = vertex.uv;
+	}
+
+	for (int edge = 0; edge < 3; edge++)
+	{
+		int first = order[(edge + 1) % 3];
+		int second = order[(edge + 2) % 3];
+		float deltaX = screenX[second] - screenX[first];
+		float deltaY = screenY[second] - screenY[first];
+		triangle.edgeA[edge] = -deltaY;
+		triangle.edgeB[edge] = deltaX;
+		triangle.edgeC[edge] = deltaY * screenX[first] - deltaX * screenY[first];
+		// with the rows going up, the left edges go down and the
+		// top edges go left, and they own the pixels on them
+		triangle.bTopLeft[edge] = (deltaY < 0.0f) || ((deltaY == 0.0f) && (deltaX < 0.0f));
+	}
+	triangle.inverseArea = 1.0f / area;
+	triangle.draw = draw;
+
+	uint32_t index = (uint32_t)data.triangles.size();
+	data.triangles.push_back(triangle);
+	for (int tileY = triangle.minY / TILE_SIZE; tileY <= triangle.maxY / TILE_SIZE; tileY++)
+	{
+		for (int tileX = triangle.minX / TILE_SIZE; tileX <= triangle.maxX / TILE_SIZE; tileX++)
+		{
+			data.bins[(size_t)tileY * m_tilesX + tileX].push_back(index);
+		}
+	}
+}
+
+/***********************************************************
+ *  RasterizeTiles()
+ *
+ *  This method is used for taking tiles until none are left,
+ *  clearing each one and drawing the triangles binned for it
+ *  by every thread.  The threads took the draws in order, so
+ *  going through their bins in order keeps the draw order.
+ ***********************************************************/
+void SoftwareRasterizer::RasterizeTiles()
+{
+	int tileCount = m_tilesX * m_tilesY;
+	for (;;)
+	{
+		int tile = m_nextTile.fetch_add(1);
+		if (tile >= tileCount)
+		{
+			return;
+		}
+		int tileX = tile % m_tilesX;
+		int tileY = tile / m_tilesX;
+
+		for (int y = tileY * TILE_SIZE; y < (tileY + 1) * TILE_SIZE; y++)
+		{
+			size_t row = (size_t)y * m_pitch + tileX * TILE_SIZE;
+			std::fill(m_colorBuffer.begin() + row, m_colorBuffer.begin() + row + TILE_SIZE, g_ClearColor);
+			std::fill(m_depthBuffer.begin() + row, m_depthBuffer.begin() + row + TILE_SIZE, 1.0f);
+		}
+
+		for (int thread = 0; thread < m_threadCount; thread++)
+		{
+			const THREAD_DATA& data = m_threadData[thread];
+			const std::vector<uint32_t>& bin = data.bins[tile];
+			for (size_t i = 0; i < bin.size(); i++)
+			{
+				RasterizeTriangle(data.triangles[bin[i]], tileX, tileY);
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  RasterizeTriangle()
+ *
+ *  This method is used for drawing the part of a triangle
+ *  inside a tile.  The edge functions, the depth and the
+ *  depth test are worked out for blocks of eight pixels, and
+ *  the pixels that pass are shaded one at a time.
+ ***********************************************************/
+void SoftwareRasterizer::RasterizeTriangle(const RASTER_TRIANGLE& triangle, int tileX, int tileY)
+{
+	int startX = std::max(triangle.minX, tileX * TILE_SIZE);
+	int endX = std::min(triangle.maxX, (tileX + 1) * TILE_SIZE - 1);
+	int startY = std::max(triangle.minY, tileY * TILE_SIZE);
+	int endY = std::min(triangle.maxY, (tileY + 1) * TILE_SIZE - 1);
+	if ((startX > endX) || (startY > endY))
+	{
+		return;
+	}
+
+	const DRAW& draw = m_draws[triangle.draw];
+	BLOCK_SETUP setup;
+	for (int edge = 0; edge < 3; edge++)
+	{
+		setup.edgeA[edge] = triangle.edgeA[edge];
+		setup.edgeB[edge] = triangle.edgeB[edge];
+		setup.edgeC[edge] = triangle.edgeC[edge];
+		setup.bTopLeft[edge] = triangle.bTopLeft[edge];
+	}
+	setup.inverseArea = triangle.inverseArea;
+	setup.depth0 = triangle.depth[0];
+	setup.depthDelta1 = triangle.depth[1] - triangle.depth[0];
+	setup.depthDelta2 = triangle.depth[2] - triangle.depth[0];
+
+	// the blocks start on multiples of eight within the tile
+	int blockStartX = startX & ~(g_BlockWidth - 1);
+	for (int y = startY; y <= endY; y++)
+	{
+		float pixelY = y + 0.5f;
+		float* pDepthRow = &m_depthBuffer[(size_t)y * m_pitch];
+		uint32_t* pColorRow = &m_colorBuffer[(size_t)y * m_pitch];
+
+		for (int x = blockStartX; x <= endX; x += g_BlockWidth)
+		{
+			float weights1[g_BlockWidth];
+			float weights2[g_BlockWidth];
+			float depths[g_BlockWidth];
+			unsigned int mask = 0;
+#ifdef CPU_FEATURES_AVX2
+			if (m_bUseAVX2 == true)
+			{
+				mask = CoverBlockAVX2(setup, x, pixelY, pDepthRow, weights1, weights2, depths);
+			}
+			else
+#endif
+			{
+				mask = CoverBlockScalar(setup, x, pixelY, pDepthRow, weights1, weights2, depths);
+			}
+
+			// keep to the pixels of the tile that are on the screen
+			for (int lane = 0; lane < g_BlockWidth; lane++)
+			{
+				if ((x + lane < startX) || (x + lane > endX))
+				{
+					mask &= ~(1u << lane);
+				}
+			}
+
+			for (int lane = 0; (lane < g_BlockWidth) && (mask != 0); lane++)
+			{
+				if ((mask & (1u << lane)) == 0)
+				{
+					continue;
+				}
+				mask &= ~(1u << lane);
+
+				glm::vec4 color = ShadePixel(triangle, weights1[lane], weights2[lane]);
+				uint32_t& pixel = pColorRow[x + lane];
+				if (draw.bTransparent == true)
+				{
+					glm::vec4 behind = UnpackColor(pixel);
+					color = color * color.a + behind * (1.0f - color.a);
+				}
+				else
+				{
+					pDepthRow[x + lane] = depths[lane];
+				}
+				pixel = PackColor(color);
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  ShadePixel()
+ *
+ *  This method is used for shading a covered pixel.  The
+ *  vertex values are blended with weights divided by the
+ *  vertex w, which keeps the texture mapping correct under
+ *  perspective, and the lighting is the Blinn-Phong model of
+ *  the fragment shader.
+ ***********************************************************/
+glm::vec4 SoftwareRasterizer::ShadePixel(const RASTER_TRIANGLE& triangle, float weight1, float weight2) const
+{
+	float perspective0 = (1.0f - weight1 - weight2) * triangle.inverseW[0];
+	float perspective1 = weight1 * triangle.inverseW[1];
+	float perspective2 = weight2 * triangle.inverseW[2];
+	float scale = 1.0f / (perspective0 + perspective1 + perspective2);
+	perspective0 *= scale;
+	perspective1 *= scale;
+	perspective2 *= scale;
+
+	const DRAW& draw = m_draws[triangle.draw];
+	glm::vec4 surfaceColor = draw.color;
+	if (draw.bUseTexture == true)
+	{
+		glm::vec2 uv =
+			triangle.uv[0] * perspective0 +
+			triangle.uv[1] * perspective1 +
+			triangle.uv[2] * perspective2;
+		surfaceColor = SampleTexture(draw.texture, uv * draw.uvScale);
+	}
+	if (m_bUseLighting == false)
+	{
+		return(surfaceColor);
+	}
+
+	glm::vec3 position =
+		triangle.world[0] * perspective0 +
+		triangle.world[1] * perspective1 +
+		triangle.world[2] * perspective2;
+	glm::vec3 normal = glm::normalize(
+		triangle.normal[0] * perspective0 +
+		triangle.normal[1] * perspective1 +
+		triangle.normal[2] * perspective2);
+	glm::vec3 viewDirection = glm::normalize(m_viewPosition - position);
+	glm::vec3 surface(surfaceColor.r, surfaceColor.g, surfaceColor.b);
+
+	const MATERIAL& material = draw.material;
+	glm::vec3 lightingResult(0.0f);
+	for (int i = 0; i < TOTAL_LIGHTS; i++)
+	{
+		const LIGHT_SOURCE& light = m_lightSources[i];
+		if (light.bEnabled == false)
+		{
+			continue;
+		}
+
+		glm::vec3 lightDirection = glm::normalize(light.position - position);
+		glm::vec3 halfwayDirection = glm::normalize(lightDirection + viewDirection);
+
+		glm::vec3 ambient = light.ambientColor * material.ambientColor * material.ambientStrength;
+		glm::vec3 diffuse = std::max(glm::dot(normal, lightDirection), 0.0f) * light.diffuseColor * material.diffuseColor;
+		glm::vec3 specular = std::pow(std::max(glm::dot(normal, halfwayDirection), 0.0f), material.shininess) *
+			light.specularColor * material.specularColor;
+
+		lightingResult += ((ambient + diffuse) * surface) + specular;
+	}
+	return(glm::vec4(lightingResult, surfaceColor.a));
+}
+
+/***********************************************************
+ *  SampleTexture()
+ *
+ *  This method is used for reading the texture with bilinear
+ *  filtering and repeating texture coordinates, as set up for
+ *  the OpenGL textures.
+ ***********************************************************/
+glm::vec4 SoftwareRasterizer::SampleTexture(int texture, const glm::vec2& uv) const
+{
+	if ((texture < 0) || (texture >= (int)m_textures.size()) || (m_textures[texture].pixels.empty() == true))
+	{
+		// an unbound texture reads as opaque black
+		return(glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+	}
+
+	const TEXTURE& image = m_textures[texture];
+	float texelX = uv.x * image.width - 0.5f;
+	float texelY = uv.y * image.height - 0.5f;
+	float floorX = std::floor(texelX);
+	float floorY = std::floor(texelY);
+	float fractionX = texelX - floorX;
+	float fractionY = texelY - floorY;
+
+	int x0 = WrapTexel((int)floorX, image.width);
+	int y0 = WrapTexel((int)floorY, image.height);
+	int x1 = (x0 + 1 == image.width) ? 0 : x0 + 1;
+	int y1 = (y0 + 1 == image.height) ? 0 : y0 + 1;
+
+	const uint8_t* pPixels = image.pixels.data();
+	const uint8_t* pCorners[4] =
+	{
+		pPixels + ((size_t)y0 * image.width + x0) * 4,
+		pPixels + ((size_t)y0 * image.width + x1) * 4,
+		pPixels + ((size_t)y1 * image.width + x0) * 4,
+		pPixels + ((size_t)y1 * image.width + x1) * 4
+	};
+	float weights[4] =
+	{
+		(1.0f - fractionX) * (1.0f - fractionY),
+		fractionX * (1.0f - fractionY),
+		(1.0f - fractionX) * fractionY,
+		fractionX * fractionY
+	};
+
+	glm::vec4 color(0.0f);
+	for (int corner = 0; corner < 4; corner++)
+	{
+		color += glm::vec4(
+			pCorners[corner][0],
+			pCorners[corner][1],
+			pCorners[corner][2],
+			pCorners[corner][3]) * weights[corner];
+	}
+	return(color * (1.0f / 255.0f));
+}
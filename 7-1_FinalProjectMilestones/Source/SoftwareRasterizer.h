@@ -0,0 +1,232 @@
+///////////////////////////////////////////////////////////////////////////////
+// softwarerasterizer.h
+// ============
+// render the scene draws on the CPU with a tiled, multithreaded rasterizer
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/***********************************************************
+ *  SoftwareRasterizer
+ *
+ *  This class renders the same draws as the shader programs
+ *  without a GPU.  The draws of a frame are collected first,
+ *  then the worker threads transform and clip their share of
+ *  the triangles and sort them into bins of screen tiles, and
+ *  finally each tile is rasterized by one thread, going
+ *  through the bins in the order the draws were added.  The
+ *  edge functions and the depth test run on eight pixels at a
+ *  time with AVX2 when the CPU supports it, and the covered
+ *  pixels are shaded with the Blinn-Phong model of the
+ *  fragment shader.
+ ***********************************************************/
+class SoftwareRasterizer
+{
+public:
+	// constructor, using every core when the thread count is zero
+	SoftwareRasterizer(int threadCount = 0);
+	// destructor
+	~SoftwareRasterizer();
+
+	// most light sources, as in the fragment shader
+	static const int TOTAL_LIGHTS = 4;
+	// width and height of the screen tiles in pixels
+	static const int TILE_SIZE = 64;
+
+	struct MATERIAL
+	{
+		glm::vec3 ambientColor;
+		float ambientStrength;
+		glm::vec3 diffuseColor;
+		glm::vec3 specularColor;
+		float shininess;
+	};
+
+	struct LIGHT_SOURCE
+	{
+		glm::vec3 position;
+		glm::vec3 ambientColor;
+		glm::vec3 diffuseColor;
+		glm::vec3 specularColor;
+		bool bEnabled;
+	};
+
+	// settings of one draw, as the shader uniforms
+	struct DRAW
+	{
+		glm::mat4 model;
+		glm::vec4 color;
+		glm::vec2 uvScale;
+		MATERIAL material;
+		int mesh;
+		int texture;
+		bool bUseTexture;
+		// true to blend with the scene behind without writing depth
+		bool bTransparent;
+	};
+
+	// store the triangle list of the mesh
+	void SetMesh(
+		int mesh,
+		const std::vector<glm::vec3>& positions,
+		const std::vector<glm::vec3>& normals,
+		const std::vector<glm::vec2>& uvs,
+		const std::vector<uint32_t>& indices);
+	// store a copy of the texture pixels, bottom row first, with
+	// three or four channels
+	bool SetTexture(int texture, int width, int height, int channels, const unsigned char* pPixels);
+
+	// set the size of the color and depth buffers
+	void Resize(int width, int height);
+	// set the view settings for the next frame
+	void SetView(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& viewPosition);
+	// set the light sources for the next frame
+	void SetLightSources(const LIGHT_SOURCE* pLights, bool bUseLighting);
+
+	// start collecting the draws of a frame
+	void BeginFrame();
+	// add a draw, rendered after the ones added before it
+	void AddDraw(const DRAW& draw);
+	// clear the buffers and render the collected draws
+	void RenderFrame();
+
+	// RGBA pixels of the rendered frame, bottom row first, with
+	// rows of the pitch in pixels
+	const uint32_t* GetColorBuffer() const { return(m_colorBuffer.data()); }
+	int GetPitch() const { return(m_pitch); }
+	int GetWidth() const { return(m_width); }
+	int GetHeight() const { return(m_height); }
+	int GetThreadCount() const { return(m_threadCount); }
+	// triangles that reached the tile bins in the last frame
+	size_t GetBinnedTriangles() const { return(m_binnedTriangles); }
+
+private:
+	struct MESH
+	{
+		std::vector<glm::vec3> positions;
+		std::vector<glm::vec3> normals;
+		std::vector<glm::vec2> uvs;
+		std::vector<uint32_t> indices;
+	};
+
+	struct TEXTURE
+	{
+		int width;
+		int height;
+		std::vector<uint8_t> pixels;
+	};
+
+	// vertex after the transform, in clip space and world space
+	struct CLIP_VERTEX
+	{
+		glm::vec4 clip;
+		glm::vec3 world;
+		glm::vec3 normal;
+		glm::vec2 uv;
+	};
+
+	// triangle set up for rasterizing, with its vertices in
+	// counterclockwise order on the screen
+	struct RASTER_TRIANGLE
+	{
+		// edge functions A * x + B * y + C, one per vertex and
+		// positive inside, for the edge across from the vertex
+		float edgeA[3];
+		float edgeB[3];
+		float edgeC[3];
+		// true for the edges that own the pixels exactly on them
+		bool bTopLeft[3];
+		float inverseArea;
+		// depth and one over w of the vertices
+		float depth[3];
+		float inverseW[3];
+		glm::vec3 world[3];
+		glm::vec3 normal[3];
+		glm::vec2 uv[3];
+		// pixel bounds on the screen
+		int minX;
+		int minY;
+		int maxX;
+		int maxY;
+		uint32_t draw;
+	};
+
+	// work of one thread, kept apart from the other threads
+	struct alignas(64) THREAD_DATA
+	{
+		std::vector<CLIP_VERTEX> vertices;
+		std::vector<RASTER_TRIANGLE> triangles;
+		// triangles overlapping each tile
+		std::vector<std::vector<uint32_t>> bins;
+		size_t firstDraw;
+		size_t lastDraw;
+	};
+
+	enum JOB
+	{
+		JOB_GEOMETRY,
+		JOB_RASTER
+	};
+
+	std::vector<MESH> m_meshes;
+	std::vector<TEXTURE> m_textures;
+
+	// frame buffers, padded to whole tiles
+	std::vector<uint32_t> m_colorBuffer;
+	std::vector<float> m_depthBuffer;
+	int m_width;
+	int m_height;
+	int m_pitch;
+	int m_tilesX;
+	int m_tilesY;
+
+	glm::mat4 m_viewProjection;
+	glm::vec3 m_viewPosition;
+	LIGHT_SOURCE m_lightSources[TOTAL_LIGHTS];
+	bool m_bUseLighting;
+
+	std::vector<DRAW> m_draws;
+	// running total of the triangles before each draw
+	std::vector<size_t> m_drawTriangles;
+	size_t m_binnedTriangles;
+	// true when the blocks are covered with the AVX2 kernel
+	bool m_bUseAVX2;
+
+	// worker threads, with the calling thread as thread zero
+	int m_threadCount;
+	std::vector<THREAD_DATA> m_threadData;
+	std::vector<std::thread> m_workers;
+	std::mutex m_mutex;
+	std::condition_variable m_startCondition;
+	std::condition_variable m_doneCondition;
+	JOB m_job;
+	unsigned int m_jobSerial;
+	int m_busyWorkers;
+	bool m_bQuit;
+	std::atomic<int> m_nextTile;
+
+	// run the job on every thread and wait for all of them
+	void RunJob(JOB job);
+	void WorkerLoop(int thread);
+	void DoJob(JOB job, int thread);
+
+	// transform, clip and bin the triangles of the thread's draws
+	void ProcessGeometry(int thread);
+	// set up the screen triangle and add it to the bins it overlaps
+	void BinTriangle(THREAD_DATA& data, const CLIP_VERTEX* pVertices[3], uint32_t draw);
+	// clear the tiles and rasterize their binned triangles
+	void RasterizeTiles();
+	void RasterizeTriangle(const RASTER_TRIANGLE& triangle, int tileX, int tileY);
+	// shade one covered pixel
+	glm::vec4 ShadePixel(const RASTER_TRIANGLE& triangle, float weight1, float weight2) const;
+	glm::vec4 SampleTexture(int texture, const glm::vec2& uv) const;
+};
@@ -0,0 +1,217 @@
+///////////////////////////////////////////////////////////////////////////////
+// staticlayercache.cpp
+// ============
+// keep the rendered color and depth of the objects that do not move, and
+// copy them into the frame so only the moving objects are drawn again
+///////////////////////////////////////////////////////////////////////////////
+
+#include "StaticLayerCache.h"
+
+#include <algorithm>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// texture units of the layer, past the units that hold the
+	// 16 texture slots of the scene
+	const GLuint g_ColorTextureUnit = 16;
+	const GLuint g_DepthTextureUnit = 17;
+	// frames in a row the key has to stay the same before the
+	// layer is rendered
+	const int g_SettleFrames = 3;
+}
+
+/***********************************************************
+ *  StaticLayerCache()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+StaticLayerCache::StaticLayerCache()
+{
+	m_key = LAYER_KEY();
+	m_bValid = false;
+	m_lastKey = LAYER_KEY();
+	m_stableFrames = 0;
+	m_previousFramebuffer = 0;
+	for (int i = 0; i < 4; i++)
+	{
+		m_previousViewport[i] = 0;
+	}
+	m_updateCount = 0;
+	m_compositeCount = 0;
+}
+
+/***********************************************************
+ *  ~StaticLayerCache()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+StaticLayerCache::~StaticLayerCache()
+{
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for loading the program that copies
+ *  the layer, and pointing its samplers at the texture units
+ *  the layer is bound to.
+ ***********************************************************/
+bool StaticLayerCache::Initialize(
+	ShaderCache* pShaderCache,
+	const char* vertexFilePath,
+	const char* fragmentFilePath)
+{
+	if (NULL == pShaderCache)
+	{
+		return(false);
+	}
+
+	GLuint programID = pShaderCache->LoadProgram(vertexFilePath, fragmentFilePath);
+	if (programID == 0)
+	{
+		return(false);
+	}
+	m_program.Adopt(programID, "static layer program");
+	m_vertexArray.Create("static layer triangle");
+
+	glUseProgram(programID);
+	glUniform1i(glGetUniformLocation(programID, "layerColor"), g_ColorTextureUnit);
+	glUniform1i(glGetUniformLocation(programID, "layerDepth"), g_DepthTextureUnit);
+	glUseProgram(0);
+
+	std::cout << "Static objects are cached while the view does not change" << std::endl;
+
+	return(true);
+}
+
+/***********************************************************
+ *  IsCurrent()
+ *
+ *  This method is used for checking whether the layer holds
+ *  the static objects as they would be rendered for the key.
+ ***********************************************************/
+bool StaticLayerCache::IsCurrent(const LAYER_KEY& key) const
+{
+	return((m_bValid == true) && (IsSameKey(m_key, key) == true));
+}
+
+/***********************************************************
+ *  TrackKey()
+ *
+ *  This method is used for counting the frames in a row that
+ *  were rendered with the same key.  A moving camera changes
+ *  the key every frame, and the layer is not worth rendering
+ *  until the camera stops.
+ ***********************************************************/
+bool StaticLayerCache::TrackKey(const LAYER_KEY& key)
+{
+	if ((m_stableFrames > 0) && (IsSameKey(m_lastKey, key) == true))
+	{
+		m_stableFrames = std::min(m_stableFrames + 1, g_SettleFrames);
+	}
+	else
+	{
+		m_lastKey = key;
+		m_stableFrames = 1;
+	}
+	return(m_stableFrames >= g_SettleFrames);
+}
+
+/***********************************************************
+ *  IsSameKey()
+ *
+ *  This method is used for comparing two keys.  The matrices
+ *  are compared exactly, since a camera that is not moved
+ *  produces the very same values every frame.
+ ***********************************************************/
+bool StaticLayerCache::IsSameKey(const LAYER_KEY& first, const LAYER_KEY& second)
+{
+	return((first.lightSerial == second.lightSerial) &&
+		(first.staticSerial == second.staticSerial) &&
+		(first.width == second.width) &&
+		(first.height == second.height) &&
+		(first.view == second.view) &&
+		(first.projection == second.projection) &&
+		(first.viewPosition == second.viewPosition));
+}
+
+/***********************************************************
+ *  BeginUpdate()
+ *
+ *  This method is used for binding the layer target for the
+ *  static objects.  The target is cleared with the clear
+ *  color the frame was cleared with.
+ ***********************************************************/
+bool StaticLayerCache::BeginUpdate(const LAYER_KEY& key)
+{
+	m_bValid = false;
+	if ((key.width <= 0) || (key.height <= 0))
+	{
+		return(false);
+	}
+
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &m_previousFramebuffer);
+	glGetIntegerv(GL_VIEWPORT, m_previousViewport);
+
+	if ((m_target.GetWidth() != key.width) || (m_target.GetHeight() != key.height))
+	{
+		if (m_target.Create(key.width, key.height) == false)
+		{
+			glBindFramebuffer(GL_FRAMEBUFFER, m_previousFramebuffer);
+			return(false);
+		}
+	}
+
+	m_target.Bind();
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	m_key = key;
+	return(true);
+}
+
+/***********************************************************
+ *  EndUpdate()
+ *
+ *  This method is used for returning to the framebuffer of
+ *  the frame once the static objects are rendered.
+ ***********************************************************/
+void StaticLayerCache::EndUpdate()
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, m_previousFramebuffer);
+	glViewport(m_previousViewport[0], m_previousViewport[1], m_previousViewport[2], m_previousViewport[3]);
+	m_bValid = true;
+	m_updateCount++;
+}
+
+/***********************************************************
+ *  Composite()
+ *
+ *  This method is used for writing the color and depth of the
+ *  layer over the whole viewport.  The depth test passes
+ *  everywhere so the cleared depth is replaced as well.
+ ***********************************************************/
+void StaticLayerCache::Composite()
+{
+	if (m_bValid == false)
+	{
+		return;
+	}
+
+	glUseProgram(m_program.Get());
+	glActiveTexture(GL_TEXTURE0 + g_ColorTextureUnit);
+	glBindTexture(GL_TEXTURE_2D, m_target.GetColorTexture());
+	glActiveTexture(GL_TEXTURE0 + g_DepthTextureUnit);
+	glBindTexture(GL_TEXTURE_2D, m_target.GetDepthTexture());
+	glActiveTexture(GL_TEXTURE0);
+
+	glDisable(GL_BLEND);
+	glDepthFunc(GL_ALWAYS);
+	glDepthMask(GL_TRUE);
+	glBindVertexArray(m_vertexArray.Get());
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	glBindVertexArray(0);
+	glDepthFunc(GL_LESS);
+
+	m_compositeCount++;
+}
@@ -0,0 +1,100 @@
+///////////////////////////////////////////////////////////////////////////////
+// staticlayercache.h
+// ============
+// keep the rendered color and depth of the objects that do not move, and
+// copy them into the frame so only the moving objects are drawn again
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "GpuResources.h"
+#include "RenderTarget.h"
+#include "ShaderCache.h"
+
+/***********************************************************
+ *  StaticLayerCache
+ *
+ *  This class holds an offscreen target with the opaque
+ *  static objects rendered for one view.  As long as the
+ *  view, the lights, the static objects and the viewport size
+ *  stay the same, every frame starts by copying the color
+ *  and depth of the target into the framebuffer with a
+ *  full-viewport triangle, and only the moving and the
+ *  transparent objects are drawn on top, depth tested against
+ *  the copied depth.  The copy is drawn rather than blitted
+ *  because a depth blit needs the depth format of the window
+ *  to match the target.  While the key changes every frame,
+ *  as when the camera moves, the layer would be rendered and
+ *  thrown away each frame, so it is only rendered once the
+ *  key has stayed the same for a few frames.
+ ***********************************************************/
+class StaticLayerCache
+{
+public:
+	// constructor
+	StaticLayerCache();
+	// destructor
+	~StaticLayerCache();
+
+	// everything the rendered layer depends on
+	struct LAYER_KEY
+	{
+		glm::mat4 view;
+		glm::mat4 projection;
+		glm::vec3 viewPosition;
+		unsigned int lightSerial;
+		unsigned int staticSerial;
+		int width;
+		int height;
+	};
+
+	// load the program that copies the layer into the frame
+	bool Initialize(
+		ShaderCache* pShaderCache,
+		const char* vertexFilePath,
+		const char* fragmentFilePath);
+
+	// true when the layer was rendered with the same key
+	bool IsCurrent(const LAYER_KEY& key) const;
+	// count the frames in a row with the same key, called once
+	// per frame, and return true once the key has settled
+	bool TrackKey(const LAYER_KEY& key);
+	// bind and clear the layer target for rendering the static
+	// objects, resizing it to the key
+	bool BeginUpdate(const LAYER_KEY& key);
+	// bind the framebuffer and viewport that were active before
+	// BeginUpdate() again, and keep the layer for the key
+	void EndUpdate();
+	// copy the color and depth of the layer into the bound framebuffer
+	void Composite();
+
+	// number of times the layer was rendered and copied
+	int GetUpdateCount() const { return(m_updateCount); }
+	int GetCompositeCount() const { return(m_compositeCount); }
+
+private:
+	RenderTarget m_target;
+	GpuProgram m_program;
+	// the triangle is generated from the vertex index, but core
+	// profiles draw nothing without a vertex array bound
+	GpuVertexArray m_vertexArray;
+
+	// key of the rendered layer, valid once an update finished
+	LAYER_KEY m_key;
+	bool m_bValid;
+	// key of the last frame, and the frames in a row it was seen
+	LAYER_KEY m_lastKey;
+	int m_stableFrames;
+	// framebuffer and viewport to return to after an update
+	GLint m_previousFramebuffer;
+	GLint m_previousViewport[4];
+
+	int m_updateCount;
+	int m_compositeCount;
+
+	// true when both keys would render the same layer
+	static bool IsSameKey(const LAYER_KEY& first, const LAYER_KEY& second);
+};
@@ -0,0 +1,180 @@
+///////////////////////////////////////////////////////////////////////////////
+// stressbenchmark.cpp
+// ============
+// render generated scenes of increasing size and report how the frame
+// time, memory use and load time scale with the number of objects
+///////////////////////////////////////////////////////////////////////////////
+
+#include "StressBenchmark.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <unistd.h>
+#endif
+
+// declaration of global variables
+namespace
+{
+	// objects in the smallest step, multiplied by ten each step
+	const int g_FirstStepObjects = 10;
+	// frames timed for each step, fewer when the frames are slow
+	const int g_TimedFrames = 9;
+	const int g_MinimumTimedFrames = 3;
+	const double g_StepTimeLimitSeconds = 10.0;
+	// the remaining steps are skipped once a frame takes longer
+	const float g_GiveUpMilliseconds = 5000.0f;
+
+	// memory currently used by the process in megabytes
+	double GetProcessMemoryMegabytes()
+	{
+#if defined(_WIN32)
+		PROCESS_MEMORY_COUNTERS counters;
+		if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)) == 0)
+		{
+			return(0.0);
+		}
+		return(counters.WorkingSetSize / (1024.0 * 1024.0));
+#else
+		long totalPages = 0;
+		long residentPages = 0;
+		FILE* pFile = fopen("/proc/self/statm", "r");
+		if (NULL == pFile)
+		{
+			return(0.0);
+		}
+		if (fscanf(pFile, "%ld %ld", &totalPages, &residentPages) != 2)
+		{
+			residentPages = 0;
+		}
+		fclose(pFile);
+		return(residentPages * (double)sysconf(_SC_PAGESIZE) / (1024.0 * 1024.0));
+#endif
+	}
+}
+
+/***********************************************************
+ *  StressBenchmark()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+StressBenchmark::StressBenchmark(
+	ViewManager* pViewManager,
+	SceneManager* pSceneManager,
+	void (*pRenderFrame)())
+{
+	m_pViewManager = pViewManager;
+	m_pSceneManager = pSceneManager;
+	m_pRenderFrame = pRenderFrame;
+}
+
+/***********************************************************
+ *  ~StressBenchmark()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+StressBenchmark::~StressBenchmark()
+{
+	m_pViewManager = NULL;
+	m_pSceneManager = NULL;
+	m_pRenderFrame = NULL;
+}
+
+/***********************************************************
+ *  Run()
+ *
+ *  This method is used for rendering the generated scene at
+ *  each scale step and printing one line of results for it.
+ *  The load time covers generating the desks and drawing the
+ *  first frame, which builds the spatial index.  The camera
+ *  stays at the default pose over the middle of the grid, so
+ *  the larger steps also measure the culling of the objects
+ *  out of view.
+ ***********************************************************/
+int StressBenchmark::Run(int maxObjects, unsigned int seed)
+{
+	m_pViewManager->SetCameraPose(
+		glm::vec3(0.0f, 5.0f, 12.0f),
+		glm::vec3(0.0f, -0.5f, -2.0f),
+		80.0f,
+		false);
+
+	std::cout << std::setw(10) << "objects"
+		<< std::setw(11) << "load ms"
+		<< std::setw(11) << "frame ms"
+		<< std::setw(8) << "draws"
+		<< std::setw(10) << "culled"
+		<< std::setw(10) << "index ms"
+		<< std::setw(10) << "cull ms"
+		<< std::setw(10) << "sort ms"
+		<< std::setw(10) << "submit ms"
+		<< std::setw(10) << "arena KB"
+		<< std::setw(11) << "memory MB" << std::endl;
+
+	int completedObjects = 0;
+	for (long long objects = g_FirstStepObjects; objects <= maxObjects; objects *= 10)
+	{
+		double loadStart = glfwGetTime();
+		m_pSceneManager->GenerateStressObjects((int)objects, seed);
+		m_pRenderFrame();
+		glFinish();
+		float loadMilliseconds = (float)((glfwGetTime() - loadStart) * 1000.0);
+
+		std::vector<float> frameTimes;
+		double stepStart = glfwGetTime();
+		while ((int)frameTimes.size() < g_TimedFrames)
+		{
+			double frameStart = glfwGetTime();
+			m_pRenderFrame();
+			glFinish();
+			double frameEnd = glfwGetTime();
+			frameTimes.push_back((float)((frameEnd - frameStart) * 1000.0));
+
+			if (((int)frameTimes.size() >= g_MinimumTimedFrames) &&
+				(frameEnd - stepStart > g_StepTimeLimitSeconds))
+			{
+				break;
+			}
+		}
+		std::sort(frameTimes.begin(), frameTimes.end());
+		float frameMilliseconds = frameTimes[frameTimes.size() / 2];
+
+		SceneManager::FRAME_STATS stats = m_pSceneManager->GetFrameStats();
+		// the row is formatted apart so the precision set for it
+		// does not stay on std::cout
+		std::ostringstream row;
+		row << std::fixed
+			<< std::setw(10) << objects
+			<< std::setprecision(1) << std::setw(11) << loadMilliseconds
+			<< std::setprecision(2) << std::setw(11) << frameMilliseconds
+			<< std::setw(8) << stats.drawCalls
+			<< std::setw(10) << stats.occlusionCulled + stats.frustumCulled
+			<< std::setw(10) << stats.indexMilliseconds
+			<< std::setw(10) << stats.cullMilliseconds
+			<< std::setw(10) << stats.sortMilliseconds
+			<< std::setw(10) << stats.submitMilliseconds
+			<< std::setprecision(1) << std::setw(10) << stats.arenaBytes / 1024.0f
+			<< std::setw(11) << GetProcessMemoryMegabytes();
+		std::cout << row.str() << std::endl;
+
+		completedObjects = (int)objects;
+		if (frameMilliseconds > g_GiveUpMilliseconds)
+		{
+			std::cout << "stopping after " << objects << " objects, the frames take longer than "
+				<< g_GiveUpMilliseconds << " ms" << std::endl;
+			break;
+		}
+	}
+
+	m_pSceneManager->ClearStressScene();
+	return(completedObjects);
+}
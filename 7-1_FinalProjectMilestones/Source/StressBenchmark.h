@@ -0,0 +1,42 @@
+///////////////////////////////////////////////////////////////////////////////
+// stressbenchmark.h
+// ============
+// render generated scenes of increasing size and report how the frame
+// time, memory use and load time scale with the number of objects
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "SceneManager.h"
+#include "ViewManager.h"
+
+/***********************************************************
+ *  StressBenchmark
+ *
+ *  This class steps the generated stress scene from ten
+ *  objects up to the passed in maximum, ten times more at
+ *  each step.  For every step it measures the time to load
+ *  the scene and draw its first frame, the median frame time
+ *  with the time of each stage of the draw queue, and the
+ *  memory used by the process.
+ ***********************************************************/
+class StressBenchmark
+{
+public:
+	// constructor - the render function draws one complete frame
+	StressBenchmark(
+		ViewManager* pViewManager,
+		SceneManager* pSceneManager,
+		void (*pRenderFrame)());
+	// destructor
+	~StressBenchmark();
+
+	// run all of the scale steps with the seeded scene, returning
+	// the number of objects of the last step that was completed
+	int Run(int maxObjects, unsigned int seed);
+
+private:
+	ViewManager* m_pViewManager;
+	SceneManager* m_pSceneManager;
+	void (*m_pRenderFrame)();
+};
@@ -0,0 +1,1327 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturecompressor.cpp
+// ============
+// encode texture images and their mipmaps into BC1, BC3 or BC7 blocks and
+// cache the encoded textures on disk
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TextureCompressor.h"
+#include "CpuFeatures.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <thread>
+
+// declaration of global variables
+namespace
+{
+	// identifies the cached texture files
+	const char g_CacheMagic[4] = { 'B', 'T', 'E', 'X' };
+	// changed whenever the encoder produces different blocks
+	const uint32_t g_CacheVersion = 1;
+
+	// header stored in front of the levels of every cached texture
+	struct CACHE_HEADER
+	{
+		char magic[4];
+		uint32_t version;
+		uint64_t key;
+		uint32_t format;
+		int32_t width;
+		int32_t height;
+		int32_t levelCount;
+		float psnr;
+		float encodeMilliseconds;
+	};
+
+	// weights of the second endpoint for the BC1 indices
+	const float g_BC1Weights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+	// weights of the second endpoint for the BC7 indices, in 64ths
+	const int g_BC7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	// pixels of one 4x4 block, with one array per channel so that
+	// eight pixels are compared at a time
+	struct BLOCK_PIXELS
+	{
+		float channels[4][16];
+	};
+
+	// colors a block can decode to, as the decoder produces them
+	struct BLOCK_PALETTE
+	{
+		float colors[16][4];
+		int size;
+	};
+
+	// one row of blocks of one level, encoded by one thread
+	struct ROW_TASK
+	{
+		int level;
+		int blockY;
+	};
+
+	// collects the bits of a BC7 block from the lowest bit up
+	struct BIT_WRITER
+	{
+		uint8_t* pBytes;
+		int position;
+
+		void Write(uint32_t value, int bits)
+		{
+			for (int i = 0; i < bits; i++)
+			{
+				if ((value >> i) & 1)
+				{
+					pBytes[position >> 3] |= (uint8_t)(1 << (position & 7));
+				}
+				position++;
+			}
+		}
+	};
+
+	// FNV-1a hash used for building the cache key
+	uint64_t HashBytes(uint64_t hash, const void* pData, size_t size)
+	{
+		const unsigned char* pBytes = (const unsigned char*)pData;
+		for (size_t i = 0; i < size; i++)
+		{
+			hash ^= pBytes[i];
+			hash *= 1099511628211ULL;
+		}
+		return(hash);
+	}
+
+	// get the elapsed milliseconds since the passed in time
+	float ElapsedMilliseconds(std::chrono::steady_clock::time_point start)
+	{
+		std::chrono::duration<float, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+		return(elapsed.count());
+	}
+
+	// get the number of mip levels down to one pixel
+	int CountMipLevels(int width, int height)
+	{
+		int levels = 1;
+		while ((width > 1) || (height > 1))
+		{
+			width = std::max(width / 2, 1);
+			height = std::max(height / 2, 1);
+			levels++;
+		}
+		return(levels);
+	}
+
+	// get the video memory of the RGBA8 texture with its mipmaps
+	size_t GetUncompressedBytes(int width, int height)
+	{
+		size_t bytes = 0;
+		int levels = CountMipLevels(width, height);
+		for (int level = 0; level < levels; level++)
+		{
+			bytes += (size_t)width * height * 4;
+			width = std::max(width / 2, 1);
+			height = std::max(height / 2, 1);
+		}
+		return(bytes);
+	}
+
+	// build the next smaller mip level with a box filter, repeating
+	// the last row or column of levels with an odd size
+	void DownsampleLevel(const std::vector<uint8_t>& source, int width, int height, std::vector<uint8_t>& target)
+	{
+		int targetWidth = std::max(width / 2, 1);
+		int targetHeight = std::max(height / 2, 1);
+		target.resize((size_t)targetWidth * targetHeight * 4);
+
+		for (int y = 0; y < targetHeight; y++)
+		{
+			const uint8_t* pRow0 = &source[(size_t)std::min(y * 2, height - 1) * width * 4];
+			const uint8_t* pRow1 = &source[(size_t)std::min(y * 2 + 1, height - 1) * width * 4];
+			for (int x = 0; x < targetWidth; x++)
+			{
+				int x0 = std::min(x * 2, width - 1) * 4;
+				int x1 = std::min(x * 2 + 1, width - 1) * 4;
+				uint8_t* pTarget = &target[((size_t)y * targetWidth + x) * 4];
+				for (int c = 0; c < 4; c++)
+				{
+					pTarget[c] = (uint8_t)((pRow0[x0 + c] + pRow0[x1 + c] + pRow1[x0 + c] + pRow1[x1 + c] + 2) >> 2);
+				}
+			}
+		}
+	}
+
+	// copy the block out of the RGBA level, repeating the edge
+	// pixels for the blocks that reach past the level
+	void FetchBlock(const std::vector<uint8_t>& image, int width, int height, int blockX, int blockY, BLOCK_PIXELS& block)
+	{
+		for (int y = 0; y < 4; y++)
+		{
+			int row = std::min(blockY * 4 + y, height - 1);
+			for (int x = 0; x < 4; x++)
+			{
+				int column = std::min(blockX * 4 + x, width - 1);
+				const uint8_t* pPixel = &image[((size_t)row * width + column) * 4];
+				for (int c = 0; c < 4; c++)
+				{
+					block.channels[c][y * 4 + x] = (float)pPixel[c];
+				}
+			}
+		}
+	}
+
+	// pick the nearest palette color for every pixel, comparing the
+	// channels with a nonzero weight - both kernels add the channels
+	// in the same order so that they produce the same blocks
+	void FindNearestScalar(
+		const BLOCK_PIXELS& block,
+		const BLOCK_PALETTE& palette,
+		const float weights[4],
+		uint8_t indices[16],
+		float errors[16])
+	{
+		for (int i = 0; i < 16; i++)
+		{
+			float best = FLT_MAX;
+			int bestIndex = 0;
+			for (int p = 0; p < palette.size; p++)
+			{
+				float distance = 0.0f;
+				for (int c = 0; c < 4; c++)
+				{
+					float delta = block.channels[c][i] - palette.colors[p][c];
+					distance = distance + delta * delta * weights[c];
+				}
+				if (distance < best)
+				{
+					best = distance;
+					bestIndex = p;
+				}
+			}
+			errors[i] = best;
+			indices[i] = (uint8_t)bestIndex;
+		}
+	}
+
+#ifdef CPU_FEATURES_AVX2
+	CPU_AVX2_FUNCTION
+	void FindNearestAVX2(
+		const BLOCK_PIXELS& block,
+		const BLOCK_PALETTE& palette,
+		const float weights[4],
+		uint8_t indices[16],
+		float errors[16])
+	{
+		for (int first = 0; first < 16; first += 8)
+		{
+			__m256 pixel[4];
+			for (int c = 0; c < 4; c++)
+			{
+				pixel[c] = _mm256_loadu_ps(&block.channels[c][first]);
+			}
+
+			__m256 best = _mm256_set1_ps(FLT_MAX);
+			__m256i bestIndex = _mm256_setzero_si256();
+			for (int p = 0; p < palette.size; p++)
+			{
+				__m256 distance = _mm256_setzero_ps();
+				for (int c = 0; c < 4; c++)
+				{
+					__m256 delta = _mm256_sub_ps(pixel[c], _mm256_set1_ps(palette.colors[p][c]));
+					distance = _mm256_add_ps(distance,
+						_mm256_mul_ps(_mm256_mul_ps(delta, delta), _mm256_set1_ps(weights[c])));
+				}
+				__m256 closer = _mm256_cmp_ps(distance, best, _CMP_LT_OQ);
+				best = _mm256_blendv_ps(best, distance, closer);
+				bestIndex = _mm256_blendv_epi8(bestIndex, _mm256_set1_epi32(p), _mm256_castps_si256(closer));
+			}
+
+			int laneIndices[8];
+			_mm256_storeu_si256((__m256i*)laneIndices, bestIndex);
+			_mm256_storeu_ps(&errors[first], best);
+			for (int lane = 0; lane < 8; lane++)
+			{
+				indices[first + lane] = (uint8_t)laneIndices[lane];
+			}
+		}
+	}
+#endif
+
+	// pick the nearest palette colors with the kernel the CPU
+	// supports, and return the summed squared error
+	float FindNearestIndices(
+		const BLOCK_PIXELS& block,
+		const BLOCK_PALETTE& palette,
+		const float weights[4],
+		uint8_t indices[16],
+		float errors[16])
+	{
+#ifdef CPU_FEATURES_AVX2
+		if (CpuFeatures::HasAVX2() == true)
+		{
+			FindNearestAVX2(block, palette, weights, indices, errors);
+		}
+		else
+#endif
+		{
+			FindNearestScalar(block, palette, weights, indices, errors);
+		}
+
+		float total = 0.0f;
+		for (int i = 0; i < 16; i++)
+		{
+			total += errors[i];
+		}
+		return(total);
+	}
+
+	// place the endpoints at the ends of the colors of the block
+	// along their principal axis, found by power iteration on the
+	// covariance of the first channels
+	void FitEndpoints(const BLOCK_PIXELS& block, int channelCount, float endpoints[2][4])
+	{
+		float mean[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+		float minimum[4] = { 255.0f, 255.0f, 255.0f, 255.0f };
+		float maximum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+		for (int c = 0; c < 4; c++)
+		{
+			for (int i = 0; i < 16; i++)
+			{
+				mean[c] += block.channels[c][i];
+				minimum[c] = std::min(minimum[c], block.channels[c][i]);
+				maximum[c] = std::max(maximum[c], block.channels[c][i]);
+			}
+			mean[c] /= 16.0f;
+			endpoints[0][c] = mean[c];
+			endpoints[1][c] = mean[c];
+		}
+
+		// the iteration starts along the diagonal of the bounds
+		float axis[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+		float length = 0.0f;
+		for (int c = 0; c < channelCount; c++)
+		{
+			axis[c] = maximum[c] - minimum[c];
+			length += axis[c] * axis[c];
+		}
+		if (length < 1.0e-6f)
+		{
+			return;
+		}
+
+		float covariance[4][4] = {};
+		for (int i = 0; i < 16; i++)
+		{
+			for (int a = 0; a < channelCount; a++)
+			{
+				float deltaA = block.channels[a][i] - mean[a];
+				for (int b = 0; b < channelCount; b++)
+				{
+					covariance[a][b] += deltaA * (block.channels[b][i] - mean[b]);
+				}
+			}
+		}
+
+		length = sqrtf(length);
+		for (int c = 0; c < channelCount; c++)
+		{
+			axis[c] /= length;
+		}
+		for (int iteration = 0; iteration < 8; iteration++)
+		{
+			float next[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+			float nextLength = 0.0f;
+			for (int a = 0; a < channelCount; a++)
+			{
+				for (int b = 0; b < channelCount; b++)
+				{
+					next[a] += covariance[a][b] * axis[b];
+				}
+				nextLength += next[a] * next[a];
+			}
+			if (nextLength < 1.0e-12f)
+			{
+				break;
+			}
+			nextLength = sqrtf(nextLength);
+			for (int c = 0; c < channelCount; c++)
+			{
+				axis[c] = next[c] / nextLength;
+			}
+		}
+
+		float projectionMin = FLT_MAX;
+		float projectionMax = -FLT_MAX;
+		for (int i = 0; i < 16; i++)
+		{
+			float projection = 0.0f;
+			for (int c = 0; c < channelCount; c++)
+			{
+				projection += (block.channels[c][i] - mean[c]) * axis[c];
+			}
+			projectionMin = std::min(projectionMin, projection);
+			projectionMax = std::max(projectionMax, projection);
+		}
+		for (int c = 0; c < channelCount; c++)
+		{
+			endpoints[0][c] = std::clamp(mean[c] + axis[c] * projectionMin, 0.0f, 255.0f);
+			endpoints[1][c] = std::clamp(mean[c] + axis[c] * projectionMax, 0.0f, 255.0f);
+		}
+	}
+
+	// solve for the endpoints that best reproduce the pixels with
+	// the chosen indices by least squares, returning false when the
+	// indices do not separate the two endpoints
+	bool RefitEndpoints(
+		const BLOCK_PIXELS& block,
+		int channelCount,
+		const uint8_t indices[16],
+		const float* pIndexWeights,
+		float endpoints[2][4])
+	{
+		float sum00 = 0.0f;
+		float sum01 = 0.0f;
+		float sum11 = 0.0f;
+		float target0[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+		float target1[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+		for (int i = 0; i < 16; i++)
+		{
+			float weight1 = pIndexWeights[indices[i]];
+			float weight0 = 1.0f - weight1;
+			sum00 += weight0 * weight0;
+			sum01 += weight0 * weight1;
+			sum11 += weight1 * weight1;
+			for (int c = 0; c < channelCount; c++)
+			{
+				target0[c] += weight0 * block.channels[c][i];
+				target1[c] += weight1 * block.channels[c][i];
+			}
+		}
+
+		float determinant = sum00 * sum11 - sum01 * sum01;
+		if (fabsf(determinant) < 1.0e-6f)
+		{
+			return(false);
+		}
+		for (int c = 0; c < channelCount; c++)
+		{
+			endpoints[0][c] = std::clamp((sum11 * target0[c] - sum01 * target1[c]) / determinant, 0.0f, 255.0f);
+			endpoints[1][c] = std::clamp((sum00 * target1[c] - sum01 * target0[c]) / determinant, 0.0f, 255.0f);
+		}
+		return(true);
+	}
+
+	uint16_t QuantizeRGB565(const float color[4])
+	{
+		int red = (int)(color[0] * 31.0f / 255.0f + 0.5f);
+		int green = (int)(color[1] * 63.0f / 255.0f + 0.5f);
+		int blue = (int)(color[2] * 31.0f / 255.0f + 0.5f);
+		return((uint16_t)((red << 11) | (green << 5) | blue));
+	}
+
+	// build the four colors of a BC1 block, with the interpolated
+	// colors rounded down as most decoders do
+	void BuildBC1Palette(uint16_t color0, uint16_t color1, BLOCK_PALETTE& palette)
+	{
+		int expanded[2][3];
+		uint16_t colors[2] = { color0, color1 };
+		for (int e = 0; e < 2; e++)
+		{
+			int red = (colors[e] >> 11) & 31;
+			int green = (colors[e] >> 5) & 63;
+			int blue = colors[e] & 31;
+			expanded[e][0] = (red << 3) | (red >> 2);
+			expanded[e][1] = (green << 2) | (green >> 4);
+			expanded[e][2] = (blue << 3) | (blue >> 2);
+		}
+
+		palette.size = 4;
+		for (int c = 0; c < 3; c++)
+		{
+			palette.colors[0][c] = (float)expanded[0][c];
+			palette.colors[1][c] = (float)expanded[1][c];
+			palette.colors[2][c] = (float)((2 * expanded[0][c] + expanded[1][c]) / 3);
+			palette.colors[3][c] = (float)((expanded[0][c] + 2 * expanded[1][c]) / 3);
+		}
+		for (int p = 0; p < 4; p++)
+		{
+			palette.colors[p][3] = 255.0f;
+		}
+	}
+
+	// encode the colors of the block as 8 bytes of BC1
+	void EncodeBC1(
+		const BLOCK_PIXELS& block,
+		TextureCompressor::QUALITY quality,
+		uint8_t* pOutput,
+		float errors[16])
+	{
+		const float weights[4] = { 1.0f, 1.0f, 1.0f, 0.0f };
+		float endpoints[2][4];
+		FitEndpoints(block, 3, endpoints);
+
+		uint16_t bestColors[2] = { 0, 0 };
+		uint8_t bestIndices[16] = {};
+		float bestError = FLT_MAX;
+		int passes = (quality == TextureCompressor::QUALITY_HIGH) ? 3 : 1;
+		for (int pass = 0; pass < passes; pass++)
+		{
+			uint16_t color0 = QuantizeRGB565(endpoints[0]);
+			uint16_t color1 = QuantizeRGB565(endpoints[1]);
+			// the first color must be the larger one to select the
+			// four color mode, and equal colors select the three
+			// color mode where only the first index is the same color
+			if (color0 < color1)
+			{
+				std::swap(color0, color1);
+			}
+			BLOCK_PALETTE palette;
+			BuildBC1Palette(color0, color1, palette);
+			if (color0 == color1)
+			{
+				palette.size = 1;
+			}
+
+			uint8_t indices[16];
+			float pixelErrors[16];
+			float error = FindNearestIndices(block, palette, weights, indices, pixelErrors);
+			if (error < bestError)
+			{
+				bestError = error;
+				bestColors[0] = color0;
+				bestColors[1] = color1;
+				memcpy(bestIndices, indices, sizeof(indices));
+				memcpy(errors, pixelErrors, sizeof(pixelErrors));
+			}
+			if ((color0 == color1) || (RefitEndpoints(block, 3, indices, g_BC1Weights, endpoints) == false))
+			{
+				break;
+			}
+		}
+
+		uint32_t indexBits = 0;
+		for (int i = 0; i < 16; i++)
+		{
+			indexBits |= (uint32_t)bestIndices[i] << (i * 2);
+		}
+		pOutput[0] = (uint8_t)(bestColors[0] & 0xFF);
+		pOutput[1] = (uint8_t)(bestColors[0] >> 8);
+		pOutput[2] = (uint8_t)(bestColors[1] & 0xFF);
+		pOutput[3] = (uint8_t)(bestColors[1] >> 8);
+		for (int i = 0; i < 4; i++)
+		{
+			pOutput[4 + i] = (uint8_t)(indexBits >> (i * 8));
+		}
+	}
+
+	// build the alpha values of a BC3 block - a larger first value
+	// interpolates eight values, otherwise six are interpolated and
+	// the last two are fully transparent and fully opaque
+	void BuildBC3AlphaPalette(int alpha0, int alpha1, BLOCK_PALETTE& palette)
+	{
+		memset(palette.colors, 0, sizeof(palette.colors));
+		palette.size = 8;
+		palette.colors[0][3] = (float)alpha0;
+		palette.colors[1][3] = (float)alpha1;
+		if (alpha0 > alpha1)
+		{
+			for (int k = 2; k < 8; k++)
+			{
+				palette.colors[k][3] = (float)(((8 - k) * alpha0 + (k - 1) * alpha1) / 7);
+			}
+		}
+		else
+		{
+			for (int k = 2; k < 6; k++)
+			{
+				palette.colors[k][3] = (float)(((6 - k) * alpha0 + (k - 1) * alpha1) / 5);
+			}
+			palette.colors[6][3] = 0.0f;
+			palette.colors[7][3] = 255.0f;
+		}
+	}
+
+	// encode the alpha of the block as the first 8 bytes of BC3
+	void EncodeBC3Alpha(
+		const BLOCK_PIXELS& block,
+		TextureCompressor::QUALITY quality,
+		uint8_t* pOutput,
+		float errors[16])
+	{
+		const float weights[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+		float minimum = 255.0f;
+		float maximum = 0.0f;
+		float innerMinimum = 255.0f;
+		float innerMaximum = 0.0f;
+		for (int i = 0; i < 16; i++)
+		{
+			float alpha = block.channels[3][i];
+			minimum = std::min(minimum, alpha);
+			maximum = std::max(maximum, alpha);
+			if ((alpha > 0.0f) && (alpha < 255.0f))
+			{
+				innerMinimum = std::min(innerMinimum, alpha);
+				innerMaximum = std::max(innerMaximum, alpha);
+			}
+		}
+
+		int alpha0 = (int)maximum;
+		int alpha1 = (int)minimum;
+		BLOCK_PALETTE palette;
+		BuildBC3AlphaPalette(alpha0, alpha1, palette);
+		uint8_t indices[16];
+		float error = FindNearestIndices(block, palette, weights, indices, errors);
+
+		// blocks mixing cut-out and partly transparent pixels can
+		// keep the exact ends and spend the other values between
+		if ((quality == TextureCompressor::QUALITY_HIGH) && (innerMinimum <= innerMaximum))
+		{
+			int inner0 = (int)innerMinimum;
+			int inner1 = (int)innerMaximum;
+			BLOCK_PALETTE innerPalette;
+			BuildBC3AlphaPalette(inner0, inner1, innerPalette);
+			uint8_t innerIndices[16];
+			float innerErrors[16];
+			float innerError = FindNearestIndices(block, innerPalette, weights, innerIndices, innerErrors);
+			if (innerError < error)
+			{
+				alpha0 = inner0;
+				alpha1 = inner1;
+				memcpy(indices, innerIndices, sizeof(indices));
+				memcpy(errors, innerErrors, sizeof(innerErrors));
+			}
+		}
+
+		uint64_t indexBits = 0;
+		for (int i = 0; i < 16; i++)
+		{
+			indexBits |= (uint64_t)indices[i] << (i * 3);
+		}
+		pOutput[0] = (uint8_t)alpha0;
+		pOutput[1] = (uint8_t)alpha1;
+		for (int i = 0; i < 6; i++)
+		{
+			pOutput[2 + i] = (uint8_t)(indexBits >> (i * 8));
+		}
+	}
+
+	// quantize the endpoint to 7 bits per channel below the shared
+	// parity bit
+	void QuantizeBC7Endpoint(const float endpoint[4], int parity, int quantized[4])
+	{
+		for (int c = 0; c < 4; c++)
+		{
+			int value = (int)floorf((endpoint[c] - parity) * 0.5f + 0.5f);
+			quantized[c] = std::clamp(value, 0, 127);
+		}
+	}
+
+	// get the squared error of the endpoint after quantizing it
+	float GetBC7EndpointError(const float endpoint[4], int parity)
+	{
+		int quantized[4];
+		QuantizeBC7Endpoint(endpoint, parity, quantized);
+		float error = 0.0f;
+		for (int c = 0; c < 4; c++)
+		{
+			float delta = (float)((quantized[c] << 1) | parity) - endpoint[c];
+			error += delta * delta;
+		}
+		return(error);
+	}
+
+	void BuildBC7Palette(const int endpoint0[4], const int endpoint1[4], int parity0, int parity1, BLOCK_PALETTE& palette)
+	{
+		palette.size = 16;
+		for (int c = 0; c < 4; c++)
+		{
+			int value0 = (endpoint0[c] << 1) | parity0;
+			int value1 = (endpoint1[c] << 1) | parity1;
+			for (int k = 0; k < 16; k++)
+			{
+				palette.colors[k][c] = (float)(((64 - g_BC7Weights[k]) * value0 + g_BC7Weights[k] * value1 + 32) >> 6);
+			}
+		}
+	}
+
+	// encode the block as 16 bytes of BC7 mode 6, which has one
+	// pair of RGBA endpoints and sixteen interpolated colors - it
+	// is the mode best suited to the smooth photographic textures
+	// of the scene, so the partitioned modes are not searched
+	void EncodeBC7(
+		const BLOCK_PIXELS& block,
+		TextureCompressor::QUALITY quality,
+		uint8_t* pOutput,
+		float errors[16])
+	{
+		const float weights[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+		float indexWeights[16];
+		for (int k = 0; k < 16; k++)
+		{
+			indexWeights[k] = g_BC7Weights[k] / 64.0f;
+		}
+
+		float endpoints[2][4];
+		FitEndpoints(block, 4, endpoints);
+
+		int bestQuantized[2][4] = {};
+		int bestParity[2] = { 0, 0 };
+		uint8_t bestIndices[16] = {};
+		float bestError = FLT_MAX;
+		bool bHighQuality = (quality == TextureCompressor::QUALITY_HIGH);
+		int passes = bHighQuality ? 3 : 1;
+		for (int pass = 0; pass < passes; pass++)
+		{
+			// the high quality tries every pair of parity bits, and
+			// the fast one takes the closest bit for each endpoint
+			int fastParity0 = (GetBC7EndpointError(endpoints[0], 1) < GetBC7EndpointError(endpoints[0], 0)) ? 1 : 0;
+			int fastParity1 = (GetBC7EndpointError(endpoints[1], 1) < GetBC7EndpointError(endpoints[1], 0)) ? 1 : 0;
+
+			uint8_t passIndices[16] = {};
+			float passError = FLT_MAX;
+			for (int combination = 0; combination < 4; combination++)
+			{
+				int parity0 = combination & 1;
+				int parity1 = combination >> 1;
+				if ((bHighQuality == false) && ((parity0 != fastParity0) || (parity1 != fastParity1)))
+				{
+					continue;
+				}
+
+				int quantized[2][4];
+				QuantizeBC7Endpoint(endpoints[0], parity0, quantized[0]);
+				QuantizeBC7Endpoint(endpoints[1], parity1, quantized[1]);
+				BLOCK_PALETTE palette;
+				BuildBC7Palette(quantized[0], quantized[1], parity0, parity1, palette);
+
+				uint8_t indices[16];
+				float pixelErrors[16];
+				float error = FindNearestIndices(block, palette, weights, indices, pixelErrors);
+				if (error < passError)
+				{
+					passError = error;
+					memcpy(passIndices, indices, sizeof(indices));
+				}
+				if (error < bestError)
+				{
+					bestError = error;
+					memcpy(bestQuantized, quantized, sizeof(quantized));
+					bestParity[0] = parity0;
+					bestParity[1] = parity1;
+					memcpy(bestIndices, indices, sizeof(indices));
+					memcpy(errors, pixelErrors, sizeof(pixelErrors));
+				}
+			}
+			if (RefitEndpoints(block, 4, passIndices, indexWeights, endpoints) == false)
+			{
+				break;
+			}
+		}
+
+		// the first index is stored without its top bit, so the
+		// endpoints are swapped when it is set - the weights are
+		// symmetric, so the block decodes to the same colors
+		if (bestIndices[0] & 8)
+		{
+			for (int c = 0; c < 4; c++)
+			{
+				std::swap(bestQuantized[0][c], bestQuantized[1][c]);
+			}
+			std::swap(bestParity[0], bestParity[1]);
+			for (int i = 0; i < 16; i++)
+			{
+				bestIndices[i] = (uint8_t)(15 - bestIndices[i]);
+			}
+		}
+
+		memset(pOutput, 0, 16);
+		BIT_WRITER writer = { pOutput, 0 };
+		// mode 6 is selected by a one after six zero bits
+		writer.Write(1 << 6, 7);
+		for (int c = 0; c < 4; c++)
+		{
+			writer.Write((uint32_t)bestQuantized[0][c], 7);
+			writer.Write((uint32_t)bestQuantized[1][c], 7);
+		}
+		writer.Write((uint32_t)bestParity[0], 1);
+		writer.Write((uint32_t)bestParity[1], 1);
+		writer.Write(bestIndices[0], 3);
+		for (int i = 1; i < 16; i++)
+		{
+			writer.Write(bestIndices[i], 4);
+		}
+	}
+
+	// encode one block in the format, returning the squared error
+	// of each pixel over the channels the format stores
+	void EncodeBlock(
+		TextureCompressor::TEXTURE_FORMAT format,
+		const BLOCK_PIXELS& block,
+		TextureCompressor::QUALITY quality,
+		uint8_t* pOutput,
+		float errors[16])
+	{
+		if (format == TextureCompressor::FORMAT_BC1)
+		{
+			EncodeBC1(block, quality, pOutput, errors);
+		}
+		else if (format == TextureCompressor::FORMAT_BC3)
+		{
+			float alphaErrors[16];
+			EncodeBC3Alpha(block, quality, pOutput, alphaErrors);
+			EncodeBC1(block, quality, pOutput + 8, errors);
+			for (int i = 0; i < 16; i++)
+			{
+				errors[i] += alphaErrors[i];
+			}
+		}
+		else
+		{
+			EncodeBC7(block, quality, pOutput, errors);
+		}
+	}
+}
+
+/***********************************************************
+ *  TextureCompressor()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TextureCompressor::TextureCompressor(const char* cacheDirectory, int threadCount)
+{
+	m_cacheDirectory = cacheDirectory;
+	m_threadCount = threadCount;
+	if (m_threadCount <= 0)
+	{
+		m_threadCount = std::max((int)std::thread::hardware_concurrency(), 1);
+	}
+
+	// BC7 is part of OpenGL 4.2, BC1 and BC3 are an extension that
+	// every desktop driver has
+	m_bS3TCSupported = (GLEW_EXT_texture_compression_s3tc != 0);
+	m_bBPTCSupported = (GLEW_ARB_texture_compression_bptc != 0);
+	if (m_bS3TCSupported == false)
+	{
+		std::cout << "The driver does not support BC1 and BC3 textures, uploading them uncompressed" << std::endl;
+	}
+
+	m_uncompressedBytes = 0;
+	m_compressedBytes = 0;
+	m_reportedTextures = 0;
+}
+
+/***********************************************************
+ *  ~TextureCompressor()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+TextureCompressor::~TextureCompressor()
+{
+}
+
+/***********************************************************
+ *  ChooseFormat()
+ *
+ *  This method is used for resolving the format of a
+ *  texture.  BC1 stores no alpha, so see-through images are
+ *  moved up to BC3, and formats the driver cannot sample are
+ *  replaced with the nearest supported one.
+ ***********************************************************/
+TextureCompressor::TEXTURE_FORMAT TextureCompressor::ChooseFormat(
+	TEXTURE_FORMAT format,
+	QUALITY quality,
+	bool bHasAlpha) const
+{
+	if (format == FORMAT_AUTO)
+	{
+		if (quality == QUALITY_HIGH)
+		{
+			format = FORMAT_BC7;
+		}
+		else
+		{
+			format = bHasAlpha ? FORMAT_BC3 : FORMAT_BC1;
+		}
+	}
+	if ((format == FORMAT_BC1) && (bHasAlpha == true))
+	{
+		format = FORMAT_BC3;
+	}
+	if ((format == FORMAT_BC7) && (m_bBPTCSupported == false))
+	{
+		format = bHasAlpha ? FORMAT_BC3 : FORMAT_BC1;
+	}
+	if (((format == FORMAT_BC1) || (format == FORMAT_BC3)) && (m_bS3TCSupported == false))
+	{
+		format = FORMAT_UNCOMPRESSED;
+	}
+
+	return(format);
+}
+
+/***********************************************************
+ *  Compress()
+ *
+ *  This method is used for encoding the image and a full
+ *  chain of mipmaps in the chosen format.  The levels are
+ *  taken from the cache when it holds the same pixels with
+ *  the same settings, otherwise they are encoded and cached.
+ ***********************************************************/
+bool TextureCompressor::Compress(
+	const unsigned char* pPixels,
+	int width,
+	int height,
+	int channels,
+	bool bHasAlpha,
+	TEXTURE_FORMAT format,
+	QUALITY quality,
+	COMPRESSED_TEXTURE& texture)
+{
+	texture.levels.clear();
+	texture.psnr = 0.0f;
+	texture.encodeMilliseconds = 0.0f;
+	texture.bFromCache = false;
+	texture.format = ChooseFormat(format, quality, bHasAlpha);
+
+	if ((NULL == pPixels) || (width <= 0) || (height <= 0) || ((channels != 3) && (channels != 4)))
+	{
+		return(false);
+	}
+	if (texture.format == FORMAT_UNCOMPRESSED)
+	{
+		return(true);
+	}
+
+	uint64_t key = CalculateKey(pPixels, width, height, channels, texture.format, quality);
+	if (LoadCachedTexture(key, width, height, texture.format, texture) == true)
+	{
+		return(true);
+	}
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	// every level is built as RGBA, with opaque alpha for RGB images
+	std::vector<std::vector<uint8_t>> images(1);
+	images[0].resize((size_t)width * height * 4);
+	for (size_t i = 0; i < (size_t)width * height; i++)
+	{
+		for (int c = 0; c < 4; c++)
+		{
+			images[0][i * 4 + c] = (c < channels) ? pPixels[i * channels + c] : 255;
+		}
+	}
+
+	int levelCount = CountMipLevels(width, height);
+	texture.levels.resize(levelCount);
+	texture.levels[0].width = width;
+	texture.levels[0].height = height;
+	for (int level = 1; level < levelCount; level++)
+	{
+		const MIP_LEVEL& previous = texture.levels[level - 1];
+		std::vector<uint8_t> image;
+		DownsampleLevel(images[level - 1], previous.width, previous.height, image);
+		images.push_back(std::move(image));
+		texture.levels[level].width = std::max(previous.width / 2, 1);
+		texture.levels[level].height = std::max(previous.height / 2, 1);
+	}
+
+	double squaredError = EncodeLevels(images, quality, texture);
+
+	// BC1 is measured over the color channels only
+	int errorChannels = (texture.format == FORMAT_BC1) ? 3 : 4;
+	double meanSquaredError = squaredError / ((double)width * height * errorChannels);
+	texture.psnr = (meanSquaredError > 0.0) ? (float)(10.0 * log10(255.0 * 255.0 / meanSquaredError)) : 99.0f;
+	texture.encodeMilliseconds = ElapsedMilliseconds(start);
+
+	SaveCachedTexture(key, texture);
+
+	return(true);
+}
+
+/***********************************************************
+ *  EncodeLevels()
+ *
+ *  This method is used for encoding the blocks of every
+ *  level.  The rows of blocks of all levels are handed out
+ *  to the threads one at a time, so the small levels do not
+ *  leave threads idle, and the errors of the rows are summed
+ *  in order so that the result does not depend on timing.
+ ***********************************************************/
+double TextureCompressor::EncodeLevels(
+	const std::vector<std::vector<uint8_t>>& images,
+	QUALITY quality,
+	COMPRESSED_TEXTURE& texture)
+{
+	int blockBytes = GetBlockBytes(texture.format);
+	std::vector<ROW_TASK> tasks;
+	for (size_t level = 0; level < texture.levels.size(); level++)
+	{
+		MIP_LEVEL& mip = texture.levels[level];
+		int blocksX = (mip.width + 3) / 4;
+		int blocksY = (mip.height + 3) / 4;
+		mip.blocks.resize((size_t)blocksX * blocksY * blockBytes);
+		for (int blockY = 0; blockY < blocksY; blockY++)
+		{
+			ROW_TASK task = { (int)level, blockY };
+			tasks.push_back(task);
+		}
+	}
+
+	std::vector<double> rowErrors(tasks.size(), 0.0);
+	std::atomic<size_t> nextTask(0);
+	auto encodeRows = [&]()
+	{
+		size_t taskIndex = 0;
+		while ((taskIndex = nextTask++) < tasks.size())
+		{
+			const ROW_TASK& task = tasks[taskIndex];
+			MIP_LEVEL& mip = texture.levels[task.level];
+			int blocksX = (mip.width + 3) / 4;
+			double rowError = 0.0;
+			for (int blockX = 0; blockX < blocksX; blockX++)
+			{
+				BLOCK_PIXELS block;
+				FetchBlock(images[task.level], mip.width, mip.height, blockX, task.blockY, block);
+				float errors[16];
+				EncodeBlock(texture.format, block, quality,
+					&mip.blocks[((size_t)task.blockY * blocksX + blockX) * blockBytes], errors);
+
+				// the repeated edge pixels are not part of the image
+				if (task.level == 0)
+				{
+					for (int y = 0; (y < 4) && (task.blockY * 4 + y < mip.height); y++)
+					{
+						for (int x = 0; (x < 4) && (blockX * 4 + x < mip.width); x++)
+						{
+							rowError += errors[y * 4 + x];
+						}
+					}
+				}
+			}
+			rowErrors[taskIndex] = rowError;
+		}
+	};
+
+	int threadCount = std::min(m_threadCount, (int)tasks.size());
+	std::vector<std::thread> threads;
+	for (int i = 1; i < threadCount; i++)
+	{
+		threads.push_back(std::thread(encodeRows));
+	}
+	encodeRows();
+	for (size_t i = 0; i < threads.size(); i++)
+	{
+		threads[i].join();
+	}
+
+	double squaredError = 0.0;
+	for (size_t i = 0; i < tasks.size(); i++)
+	{
+		squaredError += rowErrors[i];
+	}
+	return(squaredError);
+}
+
+/***********************************************************
+ *  Upload()
+ *
+ *  This method is used for uploading the encoded levels
+ *  into the texture bound to GL_TEXTURE_2D.
+ ***********************************************************/
+void TextureCompressor::Upload(const COMPRESSED_TEXTURE& texture)
+{
+	GLenum internalFormat = GetInternalFormat(texture.format);
+	for (size_t level = 0; level < texture.levels.size(); level++)
+	{
+		const MIP_LEVEL& mip = texture.levels[level];
+		glCompressedTexImage2D(
+			GL_TEXTURE_2D,
+			(GLint)level,
+			internalFormat,
+			mip.width,
+			mip.height,
+			0,
+			(GLsizei)mip.blocks.size(),
+			mip.blocks.data());
+	}
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)texture.levels.size() - 1);
+}
+
+/***********************************************************
+ *  GetInternalFormat()
+ *
+ *  This method is used for getting the OpenGL internal
+ *  format of the texture format.
+ ***********************************************************/
+GLenum TextureCompressor::GetInternalFormat(TEXTURE_FORMAT format)
+{
+	switch (format)
+	{
+	case FORMAT_BC1:
+		return(GL_COMPRESSED_RGB_S3TC_DXT1_EXT);
+	case FORMAT_BC3:
+		return(GL_COMPRESSED_RGBA_S3TC_DXT5_EXT);
+	case FORMAT_BC7:
+		return(GL_COMPRESSED_RGBA_BPTC_UNORM);
+	default:
+		return(GL_RGBA8);
+	}
+}
+
+/***********************************************************
+ *  GetBlockBytes()
+ *
+ *  This method is used for getting the size of one 4x4
+ *  block of the texture format.
+ ***********************************************************/
+int TextureCompressor::GetBlockBytes(TEXTURE_FORMAT format)
+{
+	switch (format)
+	{
+	case FORMAT_BC1:
+		return(8);
+	case FORMAT_BC3:
+	case FORMAT_BC7:
+		return(16);
+	default:
+		return(64);
+	}
+}
+
+/***********************************************************
+ *  GetFormatName()
+ *
+ *  This method is used for getting the display name of the
+ *  texture format.
+ ***********************************************************/
+const char* TextureCompressor::GetFormatName(TEXTURE_FORMAT format)
+{
+	switch (format)
+	{
+	case FORMAT_AUTO:
+		return("auto");
+	case FORMAT_BC1:
+		return("BC1");
+	case FORMAT_BC3:
+		return("BC3");
+	case FORMAT_BC7:
+		return("BC7");
+	default:
+		return("RGBA8");
+	}
+}
+
+/***********************************************************
+ *  ReportTexture()
+ *
+ *  This method is used for printing the video memory of the
+ *  texture next to its size as RGBA8, which is how drivers
+ *  store the uncompressed RGB and RGBA textures, together
+ *  with the quality of the encoding.
+ ***********************************************************/
+void TextureCompressor::ReportTexture(const char* name, int width, int height, const COMPRESSED_TEXTURE& texture)
+{
+	size_t uncompressedBytes = GetUncompressedBytes(width, height);
+	size_t compressedBytes = 0;
+	for (size_t level = 0; level < texture.levels.size(); level++)
+	{
+		compressedBytes += texture.levels[level].blocks.size();
+	}
+	if (texture.format == FORMAT_UNCOMPRESSED)
+	{
+		compressedBytes = uncompressedBytes;
+	}
+
+	m_uncompressedBytes += uncompressedBytes;
+	m_compressedBytes += compressedBytes;
+	m_reportedTextures++;
+
+	if (texture.format == FORMAT_UNCOMPRESSED)
+	{
+		printf("Texture %s: RGBA8 %dx%d, %.0f KB with mipmaps\n",
+			name, width, height, uncompressedBytes / 1024.0);
+		return;
+	}
+
+	char timing[64];
+	if (texture.bFromCache == true)
+	{
+		snprintf(timing, sizeof(timing), "loaded from cache");
+	}
+	else
+	{
+		snprintf(timing, sizeof(timing), "encoded in %.0f ms", texture.encodeMilliseconds);
+	}
+	printf("Texture %s: %s %dx%d, %.0f KB -> %.0f KB with mipmaps (%.1fx), PSNR %.1f dB, %s\n",
+		name,
+		GetFormatName(texture.format),
+		width,
+		height,
+		uncompressedBytes / 1024.0,
+		compressedBytes / 1024.0,
+		(double)uncompressedBytes / (double)std::max(compressedBytes, (size_t)1),
+		texture.psnr,
+		timing);
+}
+
+/***********************************************************
+ *  ReportTotals()
+ *
+ *  This method is used for printing the video memory of all
+ *  reported textures.
+ ***********************************************************/
+void TextureCompressor::ReportTotals() const
+{
+	printf("Texture memory for %d textures: %.2f MB, %.2f MB as RGBA8 (%.1fx smaller)\n",
+		m_reportedTextures,
+		m_compressedBytes / (1024.0 * 1024.0),
+		m_uncompressedBytes / (1024.0 * 1024.0),
+		(double)m_uncompressedBytes / (double)std::max(m_compressedBytes, (size_t)1));
+}
+
+/***********************************************************
+ *  CalculateKey()
+ *
+ *  This method is used for calculating the cache key from
+ *  the pixels and every setting that changes the blocks.
+ ***********************************************************/
+uint64_t TextureCompressor::CalculateKey(
+	const unsigned char* pPixels,
+	int width,
+	int height,
+	int channels,
+	TEXTURE_FORMAT format,
+	QUALITY quality) const
+{
+	uint64_t hash = 14695981039346656037ULL;
+	int32_t settings[5] = { width, height, channels, (int32_t)format, (int32_t)quality };
+
+	hash = HashBytes(hash, &g_CacheVersion, sizeof(g_CacheVersion));
+	hash = HashBytes(hash, settings, sizeof(settings));
+	hash = HashBytes(hash, pPixels, (size_t)width * height * channels);
+
+	return(hash);
+}
+
+/***********************************************************
+ *  GetCacheFilePath()
+ *
+ *  This method is used for getting the path of the cache
+ *  file for the passed in key.
+ ***********************************************************/
+std::string TextureCompressor::GetCacheFilePath(uint64_t key) const
+{
+	char filename[32];
+	snprintf(filename, sizeof(filename), "%016llx.btex", (unsigned long long)key);
+
+	return(m_cacheDirectory + "/" + filename);
+}
+
+/***********************************************************
+ *  LoadCachedTexture()
+ *
+ *  This method is used for reading the encoded levels from
+ *  the cache.  Files that do not match the expected layout
+ *  are removed so that they are encoded again.
+ ***********************************************************/
+bool TextureCompressor::LoadCachedTexture(
+	uint64_t key,
+	int width,
+	int height,
+	TEXTURE_FORMAT format,
+	COMPRESSED_TEXTURE& texture)
+{
+	std::string filePath = GetCacheFilePath(key);
+	std::ifstream file(filePath.c_str(), std::ios::binary);
+	if (!file.is_open())
+	{
+		return(false);
+	}
+
+	int levelCount = CountMipLevels(width, height);
+	CACHE_HEADER header;
+	file.read((char*)&header, sizeof(header));
+	if ((!file) ||
+		(memcmp(header.magic, g_CacheMagic, sizeof(g_CacheMagic)) != 0) ||
+		(header.version != g_CacheVersion) ||
+		(header.key != key) ||
+		(header.format != (uint32_t)format) ||
+		(header.width != width) ||
+		(header.height != height) ||
+		(header.levelCount != levelCount))
+	{
+		file.close();
+		std::remove(filePath.c_str());
+		return(false);
+	}
+
+	int blockBytes = GetBlockBytes(format);
+	texture.levels.resize(levelCount);
+	for (int level = 0; level < levelCount; level++)
+	{
+		MIP_LEVEL& mip = texture.levels[level];
+		mip.width = width;
+		mip.height = height;
+		mip.blocks.resize((size_t)((width + 3) / 4) * ((height + 3) / 4) * blockBytes);
+		file.read((char*)mip.blocks.data(), mip.blocks.size());
+		width = std::max(width / 2, 1);
+		height = std::max(height / 2, 1);
+	}
+	if (!file)
+	{
+		file.close();
+		std::remove(filePath.c_str());
+		texture.levels.clear();
+		return(false);
+	}
+
+	texture.psnr = header.psnr;
+	texture.encodeMilliseconds = header.encodeMilliseconds;
+	texture.bFromCache = true;
+
+	return(true);
+}
+
+/***********************************************************
+ *  SaveCachedTexture()
+ *
+ *  This method is used for writing the encoded levels into
+ *  the cache directory.
+ ***********************************************************/
+void TextureCompressor::SaveCachedTexture(uint64_t key, const COMPRESSED_TEXTURE& texture)
+{
+	std::error_code error;
+	std::filesystem::create_directories(m_cacheDirectory, error);
+
+	std::string filePath = GetCacheFilePath(key);
+	std::ofstream file(filePath.c_str(), std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		std::cout << "Could not write texture cache file:" << filePath << std::endl;
+		return;
+	}
+
+	CACHE_HEADER header;
+	memcpy(header.magic, g_CacheMagic, sizeof(g_CacheMagic));
+	header.version = g_CacheVersion;
+	header.key = key;
+	header.format = (uint32_t)texture.format;
+	header.width = texture.levels[0].width;
+	header.height = texture.levels[0].height;
+	header.levelCount = (int32_t)texture.levels.size();
+	header.psnr = texture.psnr;
+	header.encodeMilliseconds = texture.encodeMilliseconds;
+	file.write((const char*)&header, sizeof(header));
+	for (size_t level = 0; level < texture.levels.size(); level++)
+	{
+		file.write((const char*)texture.levels[level].blocks.data(), texture.levels[level].blocks.size());
+	}
+}
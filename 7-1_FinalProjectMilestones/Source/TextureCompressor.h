@@ -0,0 +1,143 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturecompressor.h
+// ============
+// encode texture images and their mipmaps into BC1, BC3 or BC7 blocks and
+// cache the encoded textures on disk
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  TextureCompressor
+ *
+ *  This class transcodes the loaded texture images into the
+ *  block-compressed formats that the GPU samples directly.
+ *  The mipmaps are built on the CPU, because compressed
+ *  textures cannot generate their own, and the 4x4 blocks of
+ *  all levels are shared among worker threads.  The endpoints
+ *  of each block follow the principal axis of its colors and
+ *  the indices are picked by comparing eight pixels at a time
+ *  with AVX2 when the CPU supports it.  The encoded
+ *  levels are stored on disk, keyed by a hash of the pixels
+ *  and the settings, and are reloaded while the key matches.
+ ***********************************************************/
+class TextureCompressor
+{
+public:
+	enum TEXTURE_FORMAT
+	{
+		// BC1 for opaque images and BC3 for see-through ones, or
+		// BC7 for either at the high quality
+		FORMAT_AUTO,
+		FORMAT_UNCOMPRESSED,
+		// 4 bits per pixel, without alpha
+		FORMAT_BC1,
+		// 8 bits per pixel, with interpolated alpha
+		FORMAT_BC3,
+		// 8 bits per pixel, with higher precision endpoints
+		FORMAT_BC7
+	};
+
+	enum QUALITY
+	{
+		// one pass of endpoint fitting
+		QUALITY_FAST,
+		// refitted endpoints and every BC7 parity bit choice
+		QUALITY_HIGH
+	};
+
+	struct MIP_LEVEL
+	{
+		int width;
+		int height;
+		std::vector<uint8_t> blocks;
+	};
+
+	struct COMPRESSED_TEXTURE
+	{
+		// format chosen for the texture, never FORMAT_AUTO
+		TEXTURE_FORMAT format;
+		std::vector<MIP_LEVEL> levels;
+		// peak signal to noise ratio of the first level in dB
+		float psnr;
+		// time spent encoding, when the texture was not cached
+		float encodeMilliseconds;
+		bool bFromCache;
+	};
+
+	// constructor, using every core when the thread count is zero
+	TextureCompressor(const char* cacheDirectory, int threadCount = 0);
+	// destructor
+	~TextureCompressor();
+
+	// resolve the automatic format for the image and fall back to
+	// the formats that the driver supports
+	TEXTURE_FORMAT ChooseFormat(TEXTURE_FORMAT format, QUALITY quality, bool bHasAlpha) const;
+
+	// encode the image, with three or four channels, and its
+	// mipmaps, or load them from the cache - the texture format
+	// is FORMAT_UNCOMPRESSED when it should be uploaded as is
+	bool Compress(
+		const unsigned char* pPixels,
+		int width,
+		int height,
+		int channels,
+		bool bHasAlpha,
+		TEXTURE_FORMAT format,
+		QUALITY quality,
+		COMPRESSED_TEXTURE& texture);
+
+	// upload all of the levels into the bound 2D texture
+	static void Upload(const COMPRESSED_TEXTURE& texture);
+	// get the OpenGL internal format of the compressed format
+	static GLenum GetInternalFormat(TEXTURE_FORMAT format);
+	// get the bytes of one 4x4 block of the compressed format
+	static int GetBlockBytes(TEXTURE_FORMAT format);
+	// get the display name of the format
+	static const char* GetFormatName(TEXTURE_FORMAT format);
+
+	// print the sizes and quality of the texture and add them to
+	// the totals
+	void ReportTexture(const char* name, int width, int height, const COMPRESSED_TEXTURE& texture);
+	// print the video memory of all reported textures
+	void ReportTotals() const;
+
+private:
+	// directory holding the encoded textures
+	std::string m_cacheDirectory;
+	int m_threadCount;
+	bool m_bS3TCSupported;
+	bool m_bBPTCSupported;
+	// video memory of the reported textures, with their mipmaps
+	size_t m_uncompressedBytes;
+	size_t m_compressedBytes;
+	int m_reportedTextures;
+
+	// calculate the cache key for the image and settings
+	uint64_t CalculateKey(
+		const unsigned char* pPixels,
+		int width,
+		int height,
+		int channels,
+		TEXTURE_FORMAT format,
+		QUALITY quality) const;
+	// get the cache file path for the passed in key
+	std::string GetCacheFilePath(uint64_t key) const;
+	// try to load the encoded levels from the cache
+	bool LoadCachedTexture(uint64_t key, int width, int height, TEXTURE_FORMAT format, COMPRESSED_TEXTURE& texture);
+	// store the encoded levels in the cache
+	void SaveCachedTexture(uint64_t key, const COMPRESSED_TEXTURE& texture);
+	// encode the blocks of all levels on the worker threads,
+	// returning the squared error summed over the first level
+	double EncodeLevels(
+		const std::vector<std::vector<uint8_t>>& images,
+		QUALITY quality,
+		COMPRESSED_TEXTURE& texture);
+};
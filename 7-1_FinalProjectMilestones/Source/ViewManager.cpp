@@ -17,9 +17,15 @@
 // declaration of the global variables and defines
 namespace
 {
-	// Variables for window width and height
+	// Variables for the initial window width and height
 	const int WINDOW_WIDTH = 1000;
 	const int WINDOW_HEIGHT = 800;
+	// size of the window framebuffer in pixels, which differs
+	// from the window size on HiDPI displays and after resizing
+	int g_FramebufferWidth = WINDOW_WIDTH;
+	int g_FramebufferHeight = WINDOW_HEIGHT;
+	// aspect ratio used instead of the framebuffer's, when set
+	float g_AspectRatioOverride = 0.0f;
 	const char* g_ViewName = "view";
 	const char* g_ProjectionName = "projection";
 
@@ -42,6 +48,17 @@ namespace
 	// the following variable is false when orthographic projection
 	// is off and true when it is on
 	bool bOrthographicProjection = false;
+
+	// optional recorder for capturing or replaying the camera input
+	InputRecorder* g_pInputRecorder = nullptr;
+	// optional server exporting the camera speed changes
+	MetricsServer* g_pMetricsServer = nullptr;
+
+	// cursor position of a pick click that has not been handled,
+	// in window coordinates
+	bool g_bPickRequested = false;
+	double g_PickX = 0.0;
+	double g_PickY = 0.0;
 }
 
 /*******
@@ -55,6 +72,10 @@ ViewManager::ViewManager(
 	// initialize the member variables
 	m_pShaderManager = pShaderManager;
 	m_pWindow = NULL;
+	m_bScreenshotRequested = false;
+	m_viewMatrix = glm::mat4(1.0f);
+	m_projectionMatrix = glm::mat4(1.0f);
+	m_viewPosition = glm::vec3(0.0f);
 	g_pCamera = new Camera();
 	// default camera view parameters
 	g_pCamera->Position = glm::vec3(0.0f, 5.0f, 12.0f);
@@ -81,6 +102,71 @@ ViewManager::~ViewManager()
 	}
 }
 
+/*******
+ *  SetInputRecorder()
+ *
+ *  This method is used to set the recorder that captures the
+ *  live input, or that drives the camera during a replay.
+ *******/
+void ViewManager::SetInputRecorder(InputRecorder* pInputRecorder)
+{
+	g_pInputRecorder = pInputRecorder;
+}
+
+/*******
+ *  SetMetricsServer()
+ *
+ *  This method is used to set the server that exports the
+ *  camera speed, starting from the current speed.
+ *******/
+void ViewManager::SetMetricsServer(MetricsServer* pMetricsServer)
+{
+	g_pMetricsServer = pMetricsServer;
+	if ((NULL != g_pMetricsServer) && (NULL != g_pCamera))
+	{
+		g_pMetricsServer->SetCameraSpeed(g_pCamera->MovementSpeed);
+	}
+}
+
+/*******
+ *  SetCameraPose()
+ *
+ *  This method is used to place the camera at a fixed pose,
+ *  for rendering the scene from known viewpoints.  The yaw
+ *  and pitch are derived from the front vector so that later
+ *  mouse movement continues from the pose.
+ *******/
+void ViewManager::SetCameraPose(
+	const glm::vec3& position,
+	const glm::vec3& front,
+	float zoom,
+	bool bOrthographic)
+{
+	glm::vec3 direction = glm::normalize(front);
+
+	g_pCamera->Position = position;
+	g_pCamera->Front = direction;
+	g_pCamera->Right = glm::normalize(glm::cross(direction, g_pCamera->WorldUp));
+	g_pCamera->Up = glm::normalize(glm::cross(g_pCamera->Right, direction));
+	g_pCamera->Yaw = glm::degrees(atan2f(direction.z, direction.x));
+	g_pCamera->Pitch = glm::degrees(asinf(direction.y));
+	g_pCamera->Zoom = zoom;
+
+	bOrthographicProjection = bOrthographic;
+}
+
+/*******
+ *  SetAspectRatio()
+ *
+ *  This method is used to fix the aspect ratio of the
+ *  projection, for offscreen images with a different shape
+ *  than the window.
+ *******/
+void ViewManager::SetAspectRatio(float aspectRatio)
+{
+	g_AspectRatioOverride = aspectRatio;
+}
+
 /*******
  *  CreateDisplayWindow()
  *
@@ -113,9 +199,15 @@ GLFWwindow* ViewManager::CreateDisplayWindow(const char* windowTitle)
 	// Register the scroll callback for movement speed adjustment
 	glfwSetScrollCallback(window, &ViewManager::MouseScrollCallback);
 
-	// enable blending for supporting tranparent rendering
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	// this callback is used to receive framebuffer resize events
+	glfwSetFramebufferSizeCallback(window, &ViewManager::FramebufferSizeCallback);
+	glfwGetFramebufferSize(window, &g_FramebufferWidth, &g_FramebufferHeight);
+
+	// this callback is used to receive the clicks for picking
+	glfwSetMouseButtonCallback(window, &ViewManager::MouseButtonCallback);
+
+	// blending for transparent rendering is only enabled by the
+	// scene manager during its transparent pass
 
 	m_pWindow = window;
 
@@ -130,6 +222,16 @@ GLFWwindow* ViewManager::CreateDisplayWindow(const char* windowTitle)
  *******/
 void ViewManager::Mouse_Position_Callback(GLFWwindow* window, double xMousePos, double yMousePos)
 {
+	if (NULL != g_pInputRecorder)
+	{
+		// live mouse input is ignored while a recorded camera path is replayed
+		if (g_pInputRecorder->IsReplaying())
+		{
+			return;
+		}
+		g_pInputRecorder->RecordMouseMove(glfwGetTime(), xMousePos, yMousePos);
+	}
+
 	// when the first mouse move event is received, this needs to be recorded so that
 	// all subsequent mouse moves can correctly calculate the X position offset and Y
 	// position offset for proper operation
@@ -165,6 +267,17 @@ void ViewManager::Mouse_Position_Callback(GLFWwindow* window, double xMousePos,
  *******/
 void ViewManager::MouseScrollCallback(GLFWwindow* window, double xOffset, double yOffset)
 {
+	if (NULL != g_pInputRecorder)
+	{
+		// live scroll input is ignored while a recorded camera path is replayed
+		if (g_pInputRecorder->IsReplaying())
+		{
+			return;
+		}
+		g_pInputRecorder->RecordScroll(glfwGetTime(), yOffset);
+	}
+
+	float previousSpeed = g_pCamera->MovementSpeed;
 	g_MovementSpeedMultiplier += static_cast<float>(yOffset) * 0.1f;
 
 	// Ensure speed multiplier stays within reasonable bounds
@@ -177,6 +290,52 @@ void ViewManager::MouseScrollCallback(GLFWwindow* window, double xOffset, double
 	g_pCamera->MovementSpeed = 10.0f * g_MovementSpeedMultiplier;
 
 	std::cout << "Camera speed: " << g_pCamera->MovementSpeed << std::endl;
+
+	// scrolling against the limits does not change the speed
+	if ((NULL != g_pMetricsServer) && (g_pCamera->MovementSpeed != previousSpeed))
+	{
+		g_pMetricsServer->RecordCameraSpeedChange(g_pCamera->MovementSpeed);
+	}
+}
+
+/*******
+ *  FramebufferSizeCallback()
+ *
+ *  This method is called from GLFW when the framebuffer of
+ *  the display window is resized.
+ *******/
+void ViewManager::FramebufferSizeCallback(GLFWwindow* window, int width, int height)
+{
+	g_FramebufferWidth = width;
+	g_FramebufferHeight = height;
+	glViewport(0, 0, width, height);
+}
+
+/*******
+ *  MouseButtonCallback()
+ *
+ *  This method is called from GLFW when a mouse button is
+ *  pressed or released within the active GLFW display window.
+ *******/
+void ViewManager::MouseButtonCallback(GLFWwindow* window, int button, int action, int mods)
+{
+	if ((button == GLFW_MOUSE_BUTTON_LEFT) && (action == GLFW_PRESS))
+	{
+		glfwGetCursorPos(window, &g_PickX, &g_PickY);
+		g_bPickRequested = true;
+	}
+}
+
+/*******
+ *  GetFramebufferSize()
+ *
+ *  This method is used to get the size of the framebuffer of
+ *  the display window in pixels.
+ *******/
+void ViewManager::GetFramebufferSize(int& width, int& height) const
+{
+	width = g_FramebufferWidth;
+	height = g_FramebufferHeight;
 }
 
 /*******
@@ -219,6 +378,18 @@ void ViewManager::ProcessKeyboardEvents()
 		oKeyPressed = false;
 	}
 
+	// request a screenshot of the next frame with the F12 key
+	static bool f12KeyPressed = false;
+	if (glfwGetKey(m_pWindow, GLFW_KEY_F12) == GLFW_PRESS && !f12KeyPressed)
+	{
+		m_bScreenshotRequested = true;
+		f12KeyPressed = true;
+	}
+	else if (glfwGetKey(m_pWindow, GLFW_KEY_F12) == GLFW_RELEASE)
+	{
+		f12KeyPressed = false;
+	}
+
 	// process camera zooming in and out
 	if (glfwGetKey(m_pWindow, GLFW_KEY_W) == GLFW_PRESS)
 	{
@@ -250,6 +421,81 @@ void ViewManager::ProcessKeyboardEvents()
 		// Move camera down
 		g_pCamera->ProcessKeyboard(DOWN, gDeltaTime);
 	}
+
+	// record the state of the polled keys when capturing input
+	if ((NULL != g_pInputRecorder) && g_pInputRecorder->IsRecording())
+	{
+		uint16_t keyMask = 0;
+		if (glfwGetKey(m_pWindow, GLFW_KEY_W) == GLFW_PRESS)
+			keyMask |= InputRecorder::KEY_FORWARD;
+		if (glfwGetKey(m_pWindow, GLFW_KEY_S) == GLFW_PRESS)
+			keyMask |= InputRecorder::KEY_BACKWARD;
+		if (glfwGetKey(m_pWindow, GLFW_KEY_A) == GLFW_PRESS)
+			keyMask |= InputRecorder::KEY_LEFT;
+		if (glfwGetKey(m_pWindow, GLFW_KEY_D) == GLFW_PRESS)
+			keyMask |= InputRecorder::KEY_RIGHT;
+		if (glfwGetKey(m_pWindow, GLFW_KEY_Q) == GLFW_PRESS)
+			keyMask |= InputRecorder::KEY_UP;
+		if (glfwGetKey(m_pWindow, GLFW_KEY_E) == GLFW_PRESS)
+			keyMask |= InputRecorder::KEY_DOWN;
+		if (glfwGetKey(m_pWindow, GLFW_KEY_P) == GLFW_PRESS)
+			keyMask |= InputRecorder::KEY_PERSPECTIVE;
+		if (glfwGetKey(m_pWindow, GLFW_KEY_O) == GLFW_PRESS)
+			keyMask |= InputRecorder::KEY_ORTHOGRAPHIC;
+		g_pInputRecorder->RecordKeyState(glfwGetTime(), keyMask);
+	}
+}
+
+/*******
+ *  TakeScreenshotRequest()
+ *
+ *  This method is used to check whether the screenshot key
+ *  was pressed since the last call.
+ *******/
+bool ViewManager::TakeScreenshotRequest()
+{
+	bool bRequested = m_bScreenshotRequested;
+	m_bScreenshotRequested = false;
+	return(bRequested);
+}
+
+/*******
+ *  TakePickRequest()
+ *
+ *  This method is used to check whether the pick button was
+ *  clicked since the last call, and to get the ray from the
+ *  camera through the clicked pixel.  The ray is unprojected
+ *  with the view settings of the most recent frame, and its
+ *  direction is normalized so hit distances are in world units.
+ *******/
+bool ViewManager::TakePickRequest(glm::vec3& origin, glm::vec3& direction)
+{
+	if ((g_bPickRequested == false) || (NULL == m_pWindow))
+	{
+		return(false);
+	}
+	g_bPickRequested = false;
+
+	// the cursor is in window coordinates, which are scaled
+	// from the framebuffer pixels on HiDPI displays
+	int windowWidth = 0;
+	int windowHeight = 0;
+	glfwGetWindowSize(m_pWindow, &windowWidth, &windowHeight);
+	if ((windowWidth <= 0) || (windowHeight <= 0))
+	{
+		return(false);
+	}
+
+	float ndcX = (float)(2.0 * g_PickX / windowWidth - 1.0);
+	float ndcY = (float)(1.0 - 2.0 * g_PickY / windowHeight);
+
+	glm::mat4 inverseViewProjection = glm::inverse(m_projectionMatrix * m_viewMatrix);
+	glm::vec4 nearPoint = inverseViewProjection * glm::vec4(ndcX, ndcY, -1.0f, 1.0f);
+	glm::vec4 farPoint = inverseViewProjection * glm::vec4(ndcX, ndcY, 1.0f, 1.0f);
+
+	origin = glm::vec3(nearPoint) / nearPoint.w;
+	direction = glm::normalize(glm::vec3(farPoint) / farPoint.w - origin);
+	return(true);
 }
 
 /*******
@@ -263,21 +509,57 @@ void ViewManager::PrepareSceneView()
 {
 	glm::mat4 view;
 	glm::mat4 projection;
+	glm::vec3 viewPosition;
 
 	// per-frame timing
 	float currentFrame = glfwGetTime();
 	gDeltaTime = currentFrame - gLastFrame;
 	gLastFrame = currentFrame;
 
-	// process any keyboard events that may be waiting in the 
-	// event queue
-	ProcessKeyboardEvents();
+	// the aspect ratio follows the framebuffer, which has a zero
+	// size while the window is minimized
+	float aspectRatio = 1.0f;
+	if (g_AspectRatioOverride > 0.0f)
+	{
+		aspectRatio = g_AspectRatioOverride;
+	}
+	else if ((g_FramebufferWidth > 0) && (g_FramebufferHeight > 0))
+	{
+		aspectRatio = (float)g_FramebufferWidth / (float)g_FramebufferHeight;
+	}
+
+	if ((NULL != g_pInputRecorder) && g_pInputRecorder->IsReplaying())
+	{
+		// the recorded camera path drives the view at a fixed
+		// simulated timestep, so only the escape key is handled
+		if (glfwGetKey(m_pWindow, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+		{
+			glfwSetWindowShouldClose(m_pWindow, true);
+		}
+
+		gDeltaTime = g_pInputRecorder->GetFixedTimeStep();
+		if (!g_pInputRecorder->ReplayNextFrame(glfwGetTime(), *g_pCamera, bOrthographicProjection))
+		{
+			// the end of the recording has been reached
+			glfwSetWindowShouldClose(m_pWindow, true);
+		}
+	}
+	else
+	{
+		// process any keyboard events that may be waiting in the 
+		// event queue
+		ProcessKeyboardEvents();
+
+		if (NULL != g_pInputRecorder)
+		{
+			g_pInputRecorder->RecordCameraState(glfwGetTime(), *g_pCamera, bOrthographicProjection);
+		}
+	}
 
 	// Define the projection matrix based on current projection mode
 	if (bOrthographicProjection)
 	{
 		// Orthographic projection for 2D view
-		float aspectRatio = (float)WINDOW_WIDTH / (float)WINDOW_HEIGHT;
 		float orthoSize = 10.0f; // Controls the size of the orthographic view
 
 		projection = glm::ortho(
@@ -292,6 +574,9 @@ void ViewManager::PrepareSceneView()
 			glm::vec3(0.0f, 0.0f, 0.0f),   // Look at the origin/center
 			glm::vec3(0.0f, 0.0f, -1.0f)   // Up vector (inverted Z as up for top-down view)
 		);
+
+		// Use fixed position for orthographic view
+		viewPosition = glm::vec3(0.0f, 15.0f, 0.1f);
 	}
 	else
 	{
@@ -301,10 +586,18 @@ void ViewManager::PrepareSceneView()
 		// Perspective projection for 3D view
 		projection = glm::perspective(
 			glm::radians(g_pCamera->Zoom),
-			(GLfloat)WINDOW_WIDTH / (GLfloat)WINDOW_HEIGHT,
+			aspectRatio,
 			0.1f, 100.0f);
+
+		// Use camera position for perspective view
+		viewPosition = g_pCamera->Position;
 	}
 
+	// keep the view settings for the scene rendering
+	m_viewMatrix = view;
+	m_projectionMatrix = projection;
+	m_viewPosition = viewPosition;
+
 	// if the shader manager object is valid
 	if (NULL != m_pShaderManager)
 	{
@@ -313,13 +606,6 @@ void ViewManager::PrepareSceneView()
 		// set the projection matrix into the shader for proper rendering
 		m_pShaderManager->setMat4Value(g_ProjectionName, projection);
 		// set the view position for lighting calculations
-		if (bOrthographicProjection) {
-			// Use fixed position for orthographic view
-			m_pShaderManager->setVec3Value("viewPosition", glm::vec3(0.0f, 15.0f, 0.1f));
-		}
-		else {
-			// Use camera position for perspective view
-			m_pShaderManager->setVec3Value("viewPosition", g_pCamera->Position);
-		}
+		m_pShaderManager->setVec3Value("viewPosition", viewPosition);
 	}
 }
\ No newline at end of file
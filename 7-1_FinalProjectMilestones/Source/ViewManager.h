@@ -11,6 +11,8 @@
 
 #include "ShaderManager.h"
 #include "camera.h"
+#include "InputRecorder.h"
+#include "MetricsServer.h"
 
 // GLFW library
 #include "GLFW/glfw3.h" 
@@ -28,12 +30,38 @@ public:
 	static void Mouse_Position_Callback(GLFWwindow* window, double xMousePos, double yMousePos);
 	// mouse scroll callback for adjusting camera movement speed
 	static void MouseScrollCallback(GLFWwindow* window, double xOffset, double yOffset);
+	// framebuffer size callback for keeping the viewport and the
+	// projection in step with the window
+	static void FramebufferSizeCallback(GLFWwindow* window, int width, int height);
+	// mouse button callback for picking objects under the cursor
+	static void MouseButtonCallback(GLFWwindow* window, int button, int action, int mods);
+
+	// set the recorder used for capturing or replaying camera input
+	void SetInputRecorder(InputRecorder* pInputRecorder);
+	// set the server that the camera speed changes are counted by
+	void SetMetricsServer(MetricsServer* pMetricsServer);
+	// place the camera at a fixed pose and select the projection
+	void SetCameraPose(
+		const glm::vec3& position,
+		const glm::vec3& front,
+		float zoom,
+		bool bOrthographic);
+	// use a fixed aspect ratio for the projection, for rendering
+	// images of another shape than the window, or follow the
+	// framebuffer again when it is zero
+	void SetAspectRatio(float aspectRatio);
 
 private:
 	// pointer to shader manager object
 	ShaderManager* m_pShaderManager;
 	// active OpenGL display window
 	GLFWwindow* m_pWindow;
+	// true when a screenshot key press has not been handled yet
+	bool m_bScreenshotRequested;
+	// view settings calculated for the current frame
+	glm::mat4 m_viewMatrix;
+	glm::mat4 m_projectionMatrix;
+	glm::vec3 m_viewPosition;
 
 	// process keyboard events for interaction with the 3D scene
 	void ProcessKeyboardEvents();
@@ -44,4 +72,18 @@ public:
 	
 	// prepare the conversion from 3D object display to 2D scene display
 	void PrepareSceneView();
+
+	// get the view settings calculated by PrepareSceneView()
+	const glm::mat4& GetViewMatrix() const { return(m_viewMatrix); }
+	const glm::mat4& GetProjectionMatrix() const { return(m_projectionMatrix); }
+	const glm::vec3& GetViewPosition() const { return(m_viewPosition); }
+
+	// return true once for each press of the screenshot key
+	bool TakeScreenshotRequest();
+	// return true once for each click of the pick button, with
+	// the world space ray through the clicked pixel
+	bool TakePickRequest(glm::vec3& origin, glm::vec3& direction);
+
+	// get the size of the window framebuffer in pixels
+	void GetFramebufferSize(int& width, int& height) const;
 };
\ No newline at end of file
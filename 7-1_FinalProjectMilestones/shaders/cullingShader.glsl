@@ -0,0 +1,162 @@
+///////////////////////////////////////////////////////////////////////////////
+// cullingShader.glsl
+// ============
+// test the world bounds of every scene object against the view frustum and
+// the depth pyramid of the previous frame, and append an indirect draw
+// command for each visible object to the range of its bucket
+///////////////////////////////////////////////////////////////////////////////
+#version 430 core
+
+layout (local_size_x = 64) in;
+
+struct ObjectBounds
+{
+	vec4 boundsMin;
+	vec4 boundsMax;
+	// mesh in x and bucket in y
+	uvec4 drawInfo;
+};
+
+// layout of the commands read by glMultiDrawElementsIndirect
+struct DrawCommand
+{
+	uint count;
+	uint instanceCount;
+	uint firstIndex;
+	int baseVertex;
+	uint baseInstance;
+};
+
+layout (std430, binding = 0) readonly buffer ObjectBuffer
+{
+	ObjectBounds objects[];
+};
+
+// index count, first index and base vertex of each mesh
+layout (std430, binding = 1) readonly buffer MeshBuffer
+{
+	ivec4 meshes[];
+};
+
+// first command of the range of each bucket
+layout (std430, binding = 2) readonly buffer BucketBuffer
+{
+	uint bucketFirstCommands[];
+};
+
+// visible objects of each bucket, which are the draw counts
+layout (std430, binding = 3) buffer CountBuffer
+{
+	uint bucketCounts[];
+};
+
+layout (std430, binding = 4) writeonly buffer CommandBuffer
+{
+	DrawCommand commands[];
+};
+
+uniform uint objectCount;
+// planes of the view frustum, with the normals pointing inside
+uniform vec4 frustumPlanes[6];
+
+uniform bool bUseOcclusion;
+uniform mat4 previousViewProjection;
+// farthest depth of the previous frame, at half the viewport size
+// and halving with each level
+uniform sampler2D depthPyramid;
+uniform vec2 pyramidSize;
+uniform int pyramidLevels;
+
+// true when some of the bounds are inside every plane
+bool IsInsideFrustum(vec3 boundsMin, vec3 boundsMax)
+{
+	for (int i = 0; i < 6; i++)
+	{
+		// the corner farthest along the plane normal
+		vec3 corner = mix(boundsMin, boundsMax, greaterThanEqual(frustumPlanes[i].xyz, vec3(0.0f)));
+		if (dot(frustumPlanes[i].xyz, corner) + frustumPlanes[i].w < 0.0f)
+		{
+			return(false);
+		}
+	}
+	return(true);
+}
+
+// true when the bounds were behind the depth of the previous frame
+bool IsOccluded(vec3 boundsMin, vec3 boundsMax)
+{
+	vec2 screenMin = vec2(1.0f);
+	vec2 screenMax = vec2(0.0f);
+	float nearestDepth = 1.0f;
+	for (int i = 0; i < 8; i++)
+	{
+		vec3 corner = vec3(
+			((i & 1) != 0) ? boundsMax.x : boundsMin.x,
+			((i & 2) != 0) ? boundsMax.y : boundsMin.y,
+			((i & 4) != 0) ? boundsMax.z : boundsMin.z);
+		vec4 clip = previousViewProjection * vec4(corner, 1.0f);
+		// bounds reaching behind the camera are never culled
+		if (clip.w <= 0.0f)
+		{
+			return(false);
+		}
+		vec3 ndc = clip.xyz / clip.w;
+		screenMin = min(screenMin, ndc.xy * 0.5f + 0.5f);
+		screenMax = max(screenMax, ndc.xy * 0.5f + 0.5f);
+		nearestDepth = min(nearestDepth, ndc.z * 0.5f + 0.5f);
+	}
+	screenMin = clamp(screenMin, vec2(0.0f), vec2(1.0f));
+	screenMax = clamp(screenMax, vec2(0.0f), vec2(1.0f));
+
+	// the level where the bounds cover at most two by two texels
+	vec2 size = (screenMax - screenMin) * pyramidSize;
+	int level = int(ceil(log2(max(max(size.x, size.y), 1.0f))));
+	level = clamp(level, 0, pyramidLevels - 1);
+
+	// the texels are found through the first level, as the last
+	// texel of a level with an odd size also covers the one left over
+	ivec2 levelSize = textureSize(depthPyramid, level);
+	ivec2 texelMin = min(ivec2(screenMin * pyramidSize) >> level, levelSize - 1);
+	ivec2 texelMax = min(ivec2(screenMax * pyramidSize) >> level, levelSize - 1);
+
+	float farthestDepth = max(
+		max(texelFetch(depthPyramid, texelMin, level).r,
+			texelFetch(depthPyramid, ivec2(texelMax.x, texelMin.y), level).r),
+		max(texelFetch(depthPyramid, ivec2(texelMin.x, texelMax.y), level).r,
+			texelFetch(depthPyramid, texelMax, level).r));
+
+	return(nearestDepth > farthestDepth);
+}
+
+void main()
+{
+	uint index = gl_GlobalInvocationID.x;
+	if (index >= objectCount)
+	{
+		return;
+	}
+
+	vec3 boundsMin = objects[index].boundsMin.xyz;
+	vec3 boundsMax = objects[index].boundsMax.xyz;
+	if (!IsInsideFrustum(boundsMin, boundsMax))
+	{
+		return;
+	}
+	if (bUseOcclusion && IsOccluded(boundsMin, boundsMax))
+	{
+		return;
+	}
+
+	uint bucket = objects[index].drawInfo.y;
+	uint slot = atomicAdd(bucketCounts[bucket], 1u);
+	ivec4 mesh = meshes[objects[index].drawInfo.x];
+
+	// the base instance selects the per-object vertex attributes
+	DrawCommand command;
+	command.count = uint(mesh.x);
+	command.instanceCount = 1u;
+	command.firstIndex = uint(mesh.y);
+	command.baseVertex = mesh.z;
+	command.baseInstance = index;
+	commands[bucketFirstCommands[bucket] + slot] = command;
+}
@@ -0,0 +1,49 @@
+///////////////////////////////////////////////////////////////////////////////
+// depthPyramidShader.glsl
+// ============
+// reduce the depth buffer, or the level before, into one level of the
+// depth pyramid that keeps the farthest depth of the texels it covers
+///////////////////////////////////////////////////////////////////////////////
+#version 430 core
+
+layout (local_size_x = 8, local_size_y = 8) in;
+
+// depth buffer copy or the pyramid, read at the source level
+uniform sampler2D sourceDepth;
+uniform int sourceLevel;
+
+layout (r32f, binding = 0) writeonly uniform image2D destinationDepth;
+
+void main()
+{
+	ivec2 destination = ivec2(gl_GlobalInvocationID.xy);
+	ivec2 destinationSize = imageSize(destinationDepth);
+	if (any(greaterThanEqual(destination, destinationSize)))
+	{
+		return;
+	}
+
+	// every texel covers two by two source texels, and the last row
+	// and column also cover the one left over by an odd source size
+	ivec2 sourceSize = textureSize(sourceDepth, sourceLevel);
+	ivec2 first = destination * 2;
+	ivec2 last = min(first + 1, sourceSize - 1);
+	if (destination.x == destinationSize.x - 1)
+	{
+		last.x = sourceSize.x - 1;
+	}
+	if (destination.y == destinationSize.y - 1)
+	{
+		last.y = sourceSize.y - 1;
+	}
+
+	float depth = 0.0f;
+	for (int y = first.y; y <= last.y; y++)
+	{
+		for (int x = first.x; x <= last.x; x++)
+		{
+			depth = max(depth, texelFetch(sourceDepth, ivec2(x, y), sourceLevel).r);
+		}
+	}
+	imageStore(destinationDepth, destination, vec4(depth));
+}
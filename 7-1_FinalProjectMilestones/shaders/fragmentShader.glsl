@@ -0,0 +1,134 @@
+///////////////////////////////////////////////////////////////////////////////
+// fragmentShader.glsl
+// ============
+// shade the mesh surface with the object color or texture and the
+// Blinn-Phong material and light source settings
+//
+// When USE_TEXTURE or USE_LIGHTING are defined, the mode is a compile-time
+// constant and the unused shading path is removed from the program.  The
+// general program without the defines selects the mode with uniforms.
+// DEPTH_ONLY builds the minimal program used for the depth prepass.
+// GPU_DRIVEN takes the object color, UV scale and material from the
+// vertex shader, which reads them per object for the indirect draws.
+///////////////////////////////////////////////////////////////////////////////
+#version 330 core
+
+in vec3 fragmentPosition;
+in vec3 fragmentVertexNormal;
+in vec2 fragmentTextureCoordinate;
+
+out vec4 outFragmentColor;
+
+struct Material
+{
+	vec3 ambientColor;
+	float ambientStrength;
+	vec3 diffuseColor;
+	vec3 specularColor;
+	float shininess;
+};
+
+struct LightSource
+{
+	vec3 position;
+	vec3 ambientColor;
+	vec3 diffuseColor;
+	vec3 specularColor;
+	bool isEnabled;
+};
+
+#define TOTAL_LIGHTS 4
+
+#ifdef USE_TEXTURE
+const bool bUseTexture = (USE_TEXTURE != 0);
+#else
+uniform bool bUseTexture = false;
+#endif
+
+#ifdef USE_LIGHTING
+const bool bUseLighting = (USE_LIGHTING != 0);
+#else
+uniform bool bUseLighting = false;
+#endif
+
+#ifdef GPU_DRIVEN
+flat in vec4 fragmentObjectColor;
+flat in vec2 fragmentUVScale;
+flat in vec4 fragmentMaterialAmbient;
+flat in vec4 fragmentMaterialDiffuse;
+flat in vec4 fragmentMaterialSpecular;
+
+// filled from the inputs at the start of main()
+vec4 objectColor;
+vec2 UVscale;
+Material material;
+#else
+uniform vec4 objectColor = vec4(1.0f);
+uniform vec2 UVscale = vec2(1.0f, 1.0f);
+uniform Material material;
+#endif
+uniform sampler2D objectTexture;
+uniform vec3 viewPosition;
+uniform LightSource lightSources[TOTAL_LIGHTS];
+
+// calculate the Blinn-Phong contribution of one light source
+vec3 CalculateLightSource(LightSource light, vec3 normal, vec3 viewDirection, vec3 surfaceColor)
+{
+	vec3 lightDirection = normalize(light.position - fragmentPosition);
+	vec3 halfwayDirection = normalize(lightDirection + viewDirection);
+
+	vec3 ambient = light.ambientColor * material.ambientColor * material.ambientStrength;
+	vec3 diffuse = max(dot(normal, lightDirection), 0.0f) * light.diffuseColor * material.diffuseColor;
+	vec3 specular = pow(max(dot(normal, halfwayDirection), 0.0f), material.shininess) *
+		light.specularColor * material.specularColor;
+
+	return(((ambient + diffuse) * surfaceColor) + specular);
+}
+
+#ifdef DEPTH_ONLY
+void main()
+{
+	// the color writes are masked off during the depth prepass
+	outFragmentColor = vec4(0.0f);
+}
+#else
+void main()
+{
+#ifdef GPU_DRIVEN
+	objectColor = fragmentObjectColor;
+	UVscale = fragmentUVScale;
+	material.ambientColor = fragmentMaterialAmbient.rgb;
+	material.ambientStrength = fragmentMaterialAmbient.a;
+	material.diffuseColor = fragmentMaterialDiffuse.rgb;
+	material.specularColor = fragmentMaterialSpecular.rgb;
+	material.shininess = fragmentMaterialSpecular.a;
+#endif
+
+	vec4 surfaceColor = objectColor;
+	if (bUseTexture)
+	{
+		surfaceColor = texture(objectTexture, fragmentTextureCoordinate * UVscale);
+	}
+
+	if (bUseLighting)
+	{
+		vec3 normal = normalize(fragmentVertexNormal);
+		vec3 viewDirection = normalize(viewPosition - fragmentPosition);
+		vec3 lightingResult = vec3(0.0f);
+
+		for (int i = 0; i < TOTAL_LIGHTS; i++)
+		{
+			if (lightSources[i].isEnabled)
+			{
+				lightingResult += CalculateLightSource(lightSources[i], normal, viewDirection, surfaceColor.rgb);
+			}
+		}
+
+		outFragmentColor = vec4(lightingResult, surfaceColor.a);
+	}
+	else
+	{
+		outFragmentColor = surfaceColor;
+	}
+}
+#endif
@@ -0,0 +1,23 @@
+///////////////////////////////////////////////////////////////////////////////
+// staticLayerFragmentShader.glsl
+// ============
+// write the cached color and depth of the static layer, so the objects
+// drawn on top of it are hidden by the static objects in front of them
+///////////////////////////////////////////////////////////////////////////////
+#version 330 core
+
+in vec2 fragmentTextureCoordinate;
+
+out vec4 outFragmentColor;
+
+uniform sampler2D layerColor;
+uniform sampler2D layerDepth;
+
+void main()
+{
+	// the layer has the size of the viewport, so every fragment
+	// reads exactly its own texel
+	ivec2 texel = ivec2(fragmentTextureCoordinate * vec2(textureSize(layerColor, 0)));
+	outFragmentColor = texelFetch(layerColor, texel, 0);
+	gl_FragDepth = texelFetch(layerDepth, texel, 0).r;
+}
@@ -0,0 +1,17 @@
+///////////////////////////////////////////////////////////////////////////////
+// staticLayerVertexShader.glsl
+// ============
+// cover the viewport with one triangle for copying the cached static layer
+// into the framebuffer, generated from the vertex index without any buffers
+///////////////////////////////////////////////////////////////////////////////
+#version 330 core
+
+out vec2 fragmentTextureCoordinate;
+
+void main()
+{
+	// the corners are (-1, -1), (3, -1) and (-1, 3)
+	vec2 position = vec2(float((gl_VertexID & 1) * 4 - 1), float((gl_VertexID & 2) * 2 - 1));
+	fragmentTextureCoordinate = position * 0.5 + 0.5;
+	gl_Position = vec4(position, 0.0, 1.0);
+}
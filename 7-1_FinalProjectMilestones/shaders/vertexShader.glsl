@@ -0,0 +1,91 @@
+///////////////////////////////////////////////////////////////////////////////
+// vertexShader.glsl
+// ============
+// transform the mesh vertices into clip space and pass the world-space
+// position, normal and texture coordinate on to the fragment shader
+//
+// GPU_DRIVEN builds the program for the indirect draws of the GPU culling,
+// which read the model transformation and the object settings from
+// instanced attributes selected by the base instance of each draw.
+///////////////////////////////////////////////////////////////////////////////
+#version 330 core
+
+layout (location = 0) in vec3 inVertexPosition;
+#ifdef COMPACT_VERTICES
+// octahedral encoded normal of the compact meshes
+layout (location = 1) in vec2 inVertexNormal;
+#else
+layout (location = 1) in vec3 inVertexNormal;
+#endif
+layout (location = 2) in vec2 inTextureCoordinate;
+
+out vec3 fragmentPosition;
+out vec3 fragmentVertexNormal;
+out vec2 fragmentTextureCoordinate;
+
+#ifdef GPU_DRIVEN
+// one set per object, using attribute locations 3 to 11
+layout (location = 3) in mat4 inObjectModel;
+layout (location = 7) in vec4 inObjectColor;
+layout (location = 8) in vec4 inObjectUVScale;
+layout (location = 9) in vec4 inMaterialAmbient;
+layout (location = 10) in vec4 inMaterialDiffuse;
+layout (location = 11) in vec4 inMaterialSpecular;
+
+flat out vec4 fragmentObjectColor;
+flat out vec2 fragmentUVScale;
+flat out vec4 fragmentMaterialAmbient;
+flat out vec4 fragmentMaterialDiffuse;
+flat out vec4 fragmentMaterialSpecular;
+#else
+uniform mat4 model;
+#endif
+uniform mat4 view;
+uniform mat4 projection;
+
+#ifdef COMPACT_VERTICES
+// the compact positions run from -1 to 1 across the mesh bounds
+uniform vec3 meshBoundsCenter;
+uniform vec3 meshBoundsExtent;
+
+// unfold the normal from the octahedron
+vec3 DecodeNormal(vec2 encoded)
+{
+	vec3 normal = vec3(encoded, 1.0f - abs(encoded.x) - abs(encoded.y));
+	float fold = max(-normal.z, 0.0f);
+	normal.x += (normal.x >= 0.0f) ? -fold : fold;
+	normal.y += (normal.y >= 0.0f) ? -fold : fold;
+	return(normalize(normal));
+}
+#endif
+
+// the depth prepass and the shading pass must produce identical depth
+invariant gl_Position;
+
+void main()
+{
+#ifdef COMPACT_VERTICES
+	vec3 vertexPosition = meshBoundsCenter + inVertexPosition * meshBoundsExtent;
+	vec3 vertexNormal = DecodeNormal(inVertexNormal);
+#else
+	vec3 vertexPosition = inVertexPosition;
+	vec3 vertexNormal = inVertexNormal;
+#endif
+#ifdef GPU_DRIVEN
+	mat4 objectModel = inObjectModel;
+	fragmentObjectColor = inObjectColor;
+	fragmentUVScale = inObjectUVScale.xy;
+	fragmentMaterialAmbient = inMaterialAmbient;
+	fragmentMaterialDiffuse = inMaterialDiffuse;
+	fragmentMaterialSpecular = inMaterialSpecular;
+#else
+	mat4 objectModel = model;
+#endif
+	vec4 worldPosition = objectModel * vec4(vertexPosition, 1.0f);
+
+	gl_Position = projection * view * worldPosition;
+
+	fragmentPosition = vec3(worldPosition);
+	fragmentVertexNormal = mat3(transpose(inverse(objectModel))) * vertexNormal;
+	fragmentTextureCoordinate = inTextureCoordinate;
+}